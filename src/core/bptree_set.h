@@ -0,0 +1,456 @@
+// Copyright 2023, DragonflyDB authors.  All rights reserved.
+// See LICENSE for licensing terms.
+//
+
+#pragma once
+
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <new>
+#include <type_traits>
+
+#ifdef __clang__
+#include <experimental/memory_resource>
+namespace PMR_NS = std::experimental::pmr;
+#else
+#include <memory_resource>
+namespace PMR_NS = std::pmr;
+#endif
+
+namespace dfly {
+namespace detail {
+
+// BPTree is a counted B+-tree over trivially copyable ordered items. It is designed as a
+// cache-friendly replacement for the zskiplist backing SortedMap: nodes are sized to a
+// couple of cache lines and hold many items each, so a lookup touches O(log_B n) lines
+// instead of the pointer-chasing towers of a skiplist. Inner nodes carry per-subtree item
+// counts, which makes rank queries and rank-based iteration O(log n).
+//
+// Items are stored by value and routing copies of items live in inner nodes, therefore T
+// must be trivially copyable and comparable via Comp (three-way, memcmp-style result).
+// Typical usage packs (score, member-id) into a single value.
+template <typename T> struct BPTreeDefaultComp {
+  int operator()(const T& a, const T& b) const {
+    if (a < b)
+      return -1;
+    return a > b ? 1 : 0;
+  }
+};
+
+template <typename T, typename Comp = BPTreeDefaultComp<T>> class BPTree {
+  static_assert(std::is_trivially_copyable<T>::value, "BPTree stores items by value");
+
+  // Target ~4 cache lines per node.
+  static constexpr unsigned kTargetNodeSize = 256;
+
+ public:
+  explicit BPTree(PMR_NS::memory_resource* mr = PMR_NS::get_default_resource(),
+                  Comp comp = Comp{})
+      : mr_(mr), comp_(comp) {
+  }
+
+  BPTree(const BPTree&) = delete;
+  BPTree& operator=(const BPTree&) = delete;
+
+  ~BPTree() {
+    Clear();
+  }
+
+  size_t Size() const {
+    return size_;
+  }
+
+  bool Contains(const T& item) const;
+
+  // Returns true if the item was inserted, false if an equal item already exists.
+  bool Insert(const T& item);
+
+  // Returns true if the item was found and removed.
+  bool Delete(const T& item);
+
+  // Returns the number of items strictly smaller than item.
+  size_t Rank(const T& item) const;
+
+  // Calls cb(item) for items with ranks [rank_start, rank_start + len), in order.
+  // Stops early if cb returns false and returns false in that case.
+  bool Iterate(size_t rank_start, size_t len, std::function<bool(const T&)> cb) const;
+
+  void Clear();
+
+  size_t NodeCount() const {
+    return node_count_;
+  }
+
+ private:
+  struct Node {
+    uint16_t num_items = 0;
+    bool leaf = true;
+  };
+
+  static constexpr unsigned kLeafCap = (kTargetNodeSize - sizeof(Node)) / sizeof(T);
+
+  struct LeafNode : public Node {
+    T items[kLeafCap];
+  };
+
+  // Inner node holds keys[0..n-1] and children[0..n], where keys[i] is the smallest item
+  // of the subtree children[i + 1]. counts[i] caches the item count of children[i].
+  static constexpr unsigned kInnerCap =
+      (kTargetNodeSize - sizeof(Node) - sizeof(void*)) / (sizeof(T) + sizeof(void*) + 8);
+
+  struct InnerNode : public Node {
+    T keys[kInnerCap];
+    Node* children[kInnerCap + 1];
+    uint64_t counts[kInnerCap + 1];
+  };
+
+  static_assert(kLeafCap >= 4 && kInnerCap >= 4, "T is too large for the node budget");
+
+  LeafNode* NewLeaf() {
+    void* ptr = mr_->allocate(sizeof(LeafNode), alignof(LeafNode));
+    ++node_count_;
+    return new (ptr) LeafNode{};
+  }
+
+  InnerNode* NewInner() {
+    void* ptr = mr_->allocate(sizeof(InnerNode), alignof(InnerNode));
+    ++node_count_;
+    return new (ptr) InnerNode{};
+  }
+
+  void FreeNode(Node* node) {
+    --node_count_;
+    if (node->leaf)
+      mr_->deallocate(node, sizeof(LeafNode), alignof(LeafNode));
+    else
+      mr_->deallocate(node, sizeof(InnerNode), alignof(InnerNode));
+  }
+
+  void DestroyRec(Node* node);
+
+  // Returns the position of the first item >= item in the leaf/inner keys array.
+  unsigned LowerBound(const T* arr, unsigned len, const T& item) const {
+    unsigned i = 0;
+    while (i < len && comp_(arr[i], item) < 0)
+      ++i;
+    return i;
+  }
+
+  struct SplitResult {
+    Node* right = nullptr;  // null if no split happened.
+    T sep;                  // smallest item of the right node.
+  };
+
+  // Inserts into the subtree. Returns {nullptr} if inserted without a split,
+  // {right, sep} if the node was split. Sets inserted=false on duplicate.
+  SplitResult InsertRec(Node* node, const T& item, bool* inserted);
+
+  bool DeleteRec(Node* node, const T& item);
+
+  static size_t SubtreeCount(const Node* node);
+
+  bool IterateRec(const Node* node, size_t skip, size_t* len,
+                  const std::function<bool(const T&)>& cb) const;
+
+  PMR_NS::memory_resource* mr_;
+  Comp comp_;
+  Node* root_ = nullptr;
+  size_t size_ = 0;
+  size_t node_count_ = 0;
+};
+
+template <typename T, typename Comp> size_t BPTree<T, Comp>::SubtreeCount(const Node* node) {
+  if (node->leaf)
+    return node->num_items;
+
+  const InnerNode* in = static_cast<const InnerNode*>(node);
+  size_t res = 0;
+  for (unsigned i = 0; i <= in->num_items; ++i)
+    res += in->counts[i];
+  return res;
+}
+
+template <typename T, typename Comp> bool BPTree<T, Comp>::Contains(const T& item) const {
+  const Node* node = root_;
+  while (node) {
+    if (node->leaf) {
+      const LeafNode* leaf = static_cast<const LeafNode*>(node);
+      unsigned pos = LowerBound(leaf->items, leaf->num_items, item);
+      return pos < leaf->num_items && comp_(leaf->items[pos], item) == 0;
+    }
+
+    // Separators are routing copies that may outlive the item itself (deletion is lazy),
+    // so equality is answered only at the leaf level.
+    const InnerNode* in = static_cast<const InnerNode*>(node);
+    unsigned pos = LowerBound(in->keys, in->num_items, item);
+    if (pos < in->num_items && comp_(in->keys[pos], item) <= 0)
+      ++pos;
+    node = in->children[pos];
+  }
+  return false;
+}
+
+template <typename T, typename Comp> bool BPTree<T, Comp>::Insert(const T& item) {
+  if (!root_) {
+    LeafNode* leaf = NewLeaf();
+    leaf->items[0] = item;
+    leaf->num_items = 1;
+    root_ = leaf;
+    size_ = 1;
+    return true;
+  }
+
+  bool inserted = true;
+  SplitResult sr = InsertRec(root_, item, &inserted);
+  if (!inserted)
+    return false;
+
+  if (sr.right) {
+    InnerNode* new_root = NewInner();
+    new_root->leaf = false;
+    new_root->num_items = 1;
+    new_root->keys[0] = sr.sep;
+    new_root->children[0] = root_;
+    new_root->children[1] = sr.right;
+    new_root->counts[0] = SubtreeCount(root_);
+    new_root->counts[1] = SubtreeCount(sr.right);
+    root_ = new_root;
+  }
+  ++size_;
+  return true;
+}
+
+template <typename T, typename Comp>
+auto BPTree<T, Comp>::InsertRec(Node* node, const T& item, bool* inserted) -> SplitResult {
+  if (node->leaf) {
+    LeafNode* leaf = static_cast<LeafNode*>(node);
+    unsigned pos = LowerBound(leaf->items, leaf->num_items, item);
+    if (pos < leaf->num_items && comp_(leaf->items[pos], item) == 0) {
+      *inserted = false;
+      return {};
+    }
+
+    if (leaf->num_items < kLeafCap) {
+      memmove(leaf->items + pos + 1, leaf->items + pos, (leaf->num_items - pos) * sizeof(T));
+      leaf->items[pos] = item;
+      ++leaf->num_items;
+      return {};
+    }
+
+    // Split the leaf in the middle and retry the insert into the proper half.
+    LeafNode* right = NewLeaf();
+    unsigned mid = kLeafCap / 2;
+    right->num_items = kLeafCap - mid;
+    memcpy(right->items, leaf->items + mid, right->num_items * sizeof(T));
+    leaf->num_items = mid;
+
+    LeafNode* dest = comp_(item, right->items[0]) < 0 ? leaf : right;
+    pos = LowerBound(dest->items, dest->num_items, item);
+    memmove(dest->items + pos + 1, dest->items + pos, (dest->num_items - pos) * sizeof(T));
+    dest->items[pos] = item;
+    ++dest->num_items;
+
+    return SplitResult{right, right->items[0]};
+  }
+
+  InnerNode* in = static_cast<InnerNode*>(node);
+  unsigned pos = LowerBound(in->keys, in->num_items, item);
+  unsigned child_idx = pos;
+  if (pos < in->num_items && comp_(in->keys[pos], item) <= 0)
+    child_idx = pos + 1;
+
+  SplitResult child_sr = InsertRec(in->children[child_idx], item, inserted);
+  if (!*inserted)
+    return {};
+
+  ++in->counts[child_idx];
+
+  if (child_sr.right) {
+    // The child split: counts of both halves must be recomputed, and the separator
+    // inserted at child_idx.
+    in->counts[child_idx] = SubtreeCount(in->children[child_idx]);
+    uint64_t right_count = SubtreeCount(child_sr.right);
+
+    if (in->num_items < kInnerCap) {
+      memmove(in->keys + child_idx + 1, in->keys + child_idx,
+              (in->num_items - child_idx) * sizeof(T));
+      memmove(in->children + child_idx + 2, in->children + child_idx + 1,
+              (in->num_items - child_idx) * sizeof(Node*));
+      memmove(in->counts + child_idx + 2, in->counts + child_idx + 1,
+              (in->num_items - child_idx) * sizeof(uint64_t));
+      in->keys[child_idx] = child_sr.sep;
+      in->children[child_idx + 1] = child_sr.right;
+      in->counts[child_idx + 1] = right_count;
+      ++in->num_items;
+      return {};
+    }
+
+    // Split this inner node: push up the middle key.
+    InnerNode* right = NewInner();
+    right->leaf = false;
+    unsigned mid = kInnerCap / 2;
+    T up_key = in->keys[mid];
+
+    right->num_items = kInnerCap - mid - 1;
+    memcpy(right->keys, in->keys + mid + 1, right->num_items * sizeof(T));
+    memcpy(right->children, in->children + mid + 1, (right->num_items + 1) * sizeof(Node*));
+    memcpy(right->counts, in->counts + mid + 1, (right->num_items + 1) * sizeof(uint64_t));
+    in->num_items = mid;
+
+    InnerNode* dest = comp_(child_sr.sep, up_key) < 0 ? in : right;
+    unsigned dpos = LowerBound(dest->keys, dest->num_items, child_sr.sep);
+    memmove(dest->keys + dpos + 1, dest->keys + dpos, (dest->num_items - dpos) * sizeof(T));
+    memmove(dest->children + dpos + 2, dest->children + dpos + 1,
+            (dest->num_items - dpos) * sizeof(Node*));
+    memmove(dest->counts + dpos + 2, dest->counts + dpos + 1,
+            (dest->num_items - dpos) * sizeof(uint64_t));
+    dest->keys[dpos] = child_sr.sep;
+    dest->children[dpos + 1] = child_sr.right;
+    dest->counts[dpos + 1] = right_count;
+    ++dest->num_items;
+
+    return SplitResult{right, up_key};
+  }
+  return {};
+}
+
+template <typename T, typename Comp> bool BPTree<T, Comp>::Delete(const T& item) {
+  if (!root_)
+    return false;
+
+  if (!DeleteRec(root_, item))
+    return false;
+
+  --size_;
+
+  // Collapse degenerate roots.
+  while (!root_->leaf) {
+    InnerNode* in = static_cast<InnerNode*>(root_);
+    if (in->num_items != 0)
+      break;
+    Node* child = in->children[0];
+    FreeNode(root_);
+    root_ = child;
+  }
+  if (root_->leaf && root_->num_items == 0) {
+    FreeNode(root_);
+    root_ = nullptr;
+  }
+  return true;
+}
+
+template <typename T, typename Comp> bool BPTree<T, Comp>::DeleteRec(Node* node, const T& item) {
+  if (node->leaf) {
+    LeafNode* leaf = static_cast<LeafNode*>(node);
+    unsigned pos = LowerBound(leaf->items, leaf->num_items, item);
+    if (pos == leaf->num_items || comp_(leaf->items[pos], item) != 0)
+      return false;
+    memmove(leaf->items + pos, leaf->items + pos + 1, (leaf->num_items - pos - 1) * sizeof(T));
+    --leaf->num_items;
+    return true;
+  }
+
+  InnerNode* in = static_cast<InnerNode*>(node);
+  unsigned pos = LowerBound(in->keys, in->num_items, item);
+  unsigned child_idx = pos;
+  if (pos < in->num_items && comp_(in->keys[pos], item) <= 0)
+    child_idx = pos + 1;
+
+  Node* child = in->children[child_idx];
+  if (!DeleteRec(child, item))
+    return false;
+
+  --in->counts[child_idx];
+
+  // Deletion is lazy: we do not rebalance underfull nodes, only remove the ones that
+  // became empty. Search and rank queries stay correct since separators are routing
+  // copies, and density recovers as new items are inserted.
+  if (in->counts[child_idx] == 0 && in->num_items > 0) {
+    DestroyRec(child);
+    unsigned key_idx = child_idx == 0 ? 0 : child_idx - 1;
+    memmove(in->keys + key_idx, in->keys + key_idx + 1,
+            (in->num_items - key_idx - 1) * sizeof(T));
+    memmove(in->children + child_idx, in->children + child_idx + 1,
+            (in->num_items - child_idx) * sizeof(Node*));
+    memmove(in->counts + child_idx, in->counts + child_idx + 1,
+            (in->num_items - child_idx) * sizeof(uint64_t));
+    --in->num_items;
+  }
+  return true;
+}
+
+template <typename T, typename Comp> size_t BPTree<T, Comp>::Rank(const T& item) const {
+  size_t rank = 0;
+  const Node* node = root_;
+  while (node) {
+    if (node->leaf) {
+      const LeafNode* leaf = static_cast<const LeafNode*>(node);
+      return rank + LowerBound(leaf->items, leaf->num_items, item);
+    }
+    const InnerNode* in = static_cast<const InnerNode*>(node);
+    unsigned pos = LowerBound(in->keys, in->num_items, item);
+    unsigned child_idx = pos;
+    if (pos < in->num_items && comp_(in->keys[pos], item) <= 0)
+      child_idx = pos + 1;
+    for (unsigned i = 0; i < child_idx; ++i)
+      rank += in->counts[i];
+    node = in->children[child_idx];
+  }
+  return rank;
+}
+
+template <typename T, typename Comp>
+bool BPTree<T, Comp>::Iterate(size_t rank_start, size_t len,
+                              std::function<bool(const T&)> cb) const {
+  if (!root_ || len == 0)
+    return true;
+  return IterateRec(root_, rank_start, &len, cb);
+}
+
+template <typename T, typename Comp>
+bool BPTree<T, Comp>::IterateRec(const Node* node, size_t skip, size_t* len,
+                                 const std::function<bool(const T&)>& cb) const {
+  if (node->leaf) {
+    const LeafNode* leaf = static_cast<const LeafNode*>(node);
+    for (unsigned i = skip; i < leaf->num_items && *len > 0; ++i) {
+      if (!cb(leaf->items[i]))
+        return false;
+      --*len;
+    }
+    return true;
+  }
+
+  const InnerNode* in = static_cast<const InnerNode*>(node);
+  for (unsigned i = 0; i <= in->num_items && *len > 0; ++i) {
+    if (skip >= in->counts[i]) {
+      skip -= in->counts[i];
+      continue;
+    }
+    if (!IterateRec(in->children[i], skip, len, cb))
+      return false;
+    skip = 0;
+  }
+  return true;
+}
+
+template <typename T, typename Comp> void BPTree<T, Comp>::Clear() {
+  if (root_) {
+    DestroyRec(root_);
+    root_ = nullptr;
+  }
+  size_ = 0;
+}
+
+template <typename T, typename Comp> void BPTree<T, Comp>::DestroyRec(Node* node) {
+  if (!node->leaf) {
+    InnerNode* in = static_cast<InnerNode*>(node);
+    for (unsigned i = 0; i <= in->num_items; ++i)
+      DestroyRec(in->children[i]);
+  }
+  FreeNode(node);
+}
+
+}  // namespace detail
+}  // namespace dfly
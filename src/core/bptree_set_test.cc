@@ -0,0 +1,106 @@
+// Copyright 2023, DragonflyDB authors.  All rights reserved.
+// See LICENSE for licensing terms.
+//
+
+#include "core/bptree_set.h"
+
+#include <random>
+#include <set>
+#include <vector>
+
+#include "base/gtest.h"
+#include "base/logging.h"
+
+namespace dfly {
+
+using detail::BPTree;
+
+class BPTreeSetTest : public ::testing::Test {
+ protected:
+  BPTree<uint64_t> tree_;
+};
+
+TEST_F(BPTreeSetTest, Basic) {
+  EXPECT_EQ(0u, tree_.Size());
+  EXPECT_TRUE(tree_.Insert(10));
+  EXPECT_FALSE(tree_.Insert(10));
+  EXPECT_TRUE(tree_.Insert(5));
+  EXPECT_TRUE(tree_.Insert(20));
+  EXPECT_EQ(3u, tree_.Size());
+
+  EXPECT_TRUE(tree_.Contains(5));
+  EXPECT_TRUE(tree_.Contains(10));
+  EXPECT_FALSE(tree_.Contains(11));
+
+  EXPECT_EQ(0u, tree_.Rank(5));
+  EXPECT_EQ(1u, tree_.Rank(10));
+  EXPECT_EQ(2u, tree_.Rank(20));
+  EXPECT_EQ(3u, tree_.Rank(100));
+
+  EXPECT_TRUE(tree_.Delete(10));
+  EXPECT_FALSE(tree_.Delete(10));
+  EXPECT_FALSE(tree_.Contains(10));
+  EXPECT_EQ(2u, tree_.Size());
+}
+
+TEST_F(BPTreeSetTest, Ordered) {
+  constexpr size_t kNumItems = 30000;
+  for (size_t i = 0; i < kNumItems; ++i) {
+    ASSERT_TRUE(tree_.Insert(i * 2));
+  }
+  EXPECT_EQ(kNumItems, tree_.Size());
+
+  for (size_t i = 0; i < kNumItems; ++i) {
+    ASSERT_TRUE(tree_.Contains(i * 2)) << i;
+    ASSERT_FALSE(tree_.Contains(i * 2 + 1)) << i;
+    ASSERT_EQ(i, tree_.Rank(i * 2)) << i;
+  }
+
+  // Rank-based iteration returns items in order.
+  std::vector<uint64_t> items;
+  tree_.Iterate(100, 50, [&](uint64_t v) {
+    items.push_back(v);
+    return true;
+  });
+  ASSERT_EQ(50u, items.size());
+  for (size_t i = 0; i < items.size(); ++i) {
+    EXPECT_EQ((100 + i) * 2, items[i]);
+  }
+}
+
+TEST_F(BPTreeSetTest, RandomInsertDelete) {
+  std::mt19937 gen(10);
+  std::uniform_int_distribution<uint64_t> dist(0, 100000);
+  std::set<uint64_t> shadow;
+
+  for (unsigned i = 0; i < 200000; ++i) {
+    uint64_t val = dist(gen);
+    if (gen() % 3 == 0) {
+      ASSERT_EQ(shadow.erase(val) == 1, tree_.Delete(val)) << val;
+    } else {
+      ASSERT_EQ(shadow.insert(val).second, tree_.Insert(val)) << val;
+    }
+  }
+
+  ASSERT_EQ(shadow.size(), tree_.Size());
+
+  std::vector<uint64_t> items;
+  tree_.Iterate(0, tree_.Size(), [&](uint64_t v) {
+    items.push_back(v);
+    return true;
+  });
+  ASSERT_EQ(shadow.size(), items.size());
+  auto it = shadow.begin();
+  for (size_t i = 0; i < items.size(); ++i, ++it) {
+    ASSERT_EQ(*it, items[i]) << i;
+    ASSERT_EQ(i, tree_.Rank(items[i]));
+  }
+
+  for (uint64_t v : items) {
+    ASSERT_TRUE(tree_.Delete(v));
+  }
+  EXPECT_EQ(0u, tree_.Size());
+  EXPECT_EQ(0u, tree_.NodeCount());
+}
+
+}  // namespace dfly
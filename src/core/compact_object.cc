@@ -5,6 +5,7 @@
 #include "core/compact_object.h"
 
 // #define XXH_INLINE_ALL
+#include <lz4.h>
 #include <xxhash.h>
 
 extern "C" {
@@ -26,6 +27,7 @@ extern "C" {
 #include "base/pod_array.h"
 #include "core/detail/bitpacking.h"
 #include "core/sorted_map.h"
+#include "core/sparse_bitmap.h"
 #include "core/string_map.h"
 #include "core/string_set.h"
 
@@ -44,9 +46,22 @@ constexpr size_t kAlignSize = 8u;
 // Approximation since does not account for listpacks.
 size_t QlMAllocSize(quicklist* ql) {
   size_t res = ql->len * sizeof(quicklistNode) + znallocx(sizeof(quicklist));
+  if (ql->compress) {
+    // Compressed lists walk the nodes so MEMORY USAGE reflects the actual
+    // (compressed) payload sizes instead of the per-member approximation.
+    return res + quicklistPayloadBytes(ql);
+  }
   return res + ql->count * 16;  // we account for each member 16 bytes.
 }
 
+// Approximated dictionary size.
+size_t DictMallocSize(dict* d) {
+  size_t res = zmalloc_usable_size(d->ht_table[0]) + zmalloc_usable_size(d->ht_table[1]) +
+               znallocx(sizeof(dict));
+
+  return res + dictSize(d) * 16;  // approximation.
+}
+
 inline void FreeObjSet(unsigned encoding, void* ptr, MemoryResource* mr) {
   switch (encoding) {
     case kEncodingStrMap: {
@@ -69,7 +84,7 @@ inline void FreeObjSet(unsigned encoding, void* ptr, MemoryResource* mr) {
 size_t MallocUsedSet(unsigned encoding, void* ptr) {
   switch (encoding) {
     case kEncodingStrMap /*OBJ_ENCODING_HT*/:
-      return 0;  // TODO
+      return DictMallocSize((dict*)ptr);
     case kEncodingStrMap2: {
       StringSet* ss = (StringSet*)ptr;
       return ss->ObjMallocUsed() + ss->SetMallocUsed();
@@ -101,7 +116,7 @@ size_t MallocUsedZSet(unsigned encoding, void* ptr) {
       return lpBytes(reinterpret_cast<uint8_t*>(ptr));
     case OBJ_ENCODING_SKIPLIST: {
       detail::SortedMap* ss = (detail::SortedMap*)ptr;
-      return ss->MallocSize();  // DictMallocSize(zs->dict);
+      return ss->MallocSize();
     }
   }
   LOG(DFATAL) << "Unknown set encoding type " << encoding;
@@ -109,8 +124,21 @@ size_t MallocUsedZSet(unsigned encoding, void* ptr) {
 }
 
 size_t MallocUsedStream(unsigned encoding, void* streamv) {
-  // stream* str_obj = (stream*)streamv;
-  return 0;  // TODO
+  stream* s = (stream*)streamv;
+  size_t res = zmalloc_size(s);
+
+  // The radix tree keys its nodes by stream id and stores the entries in listpacks.
+  // We sum the listpack blobs but do not account for the rax nodes themselves,
+  // nor for the consumer groups - this is a lower bound.
+  raxIterator ri;
+  raxStart(&ri, s->rax_tree);
+  raxSeek(&ri, "^", NULL, 0);
+  while (raxNext(&ri)) {
+    res += lpBytes((uint8_t*)ri.data);
+  }
+  raxStop(&ri);
+
+  return res;
 }
 
 inline void FreeObjHash(unsigned encoding, void* ptr) {
@@ -176,6 +204,11 @@ struct TL {
   size_t small_str_bytes;
   base::PODArray<uint8_t> tmp_buf;
   string tmp_str;
+
+  // At-rest lz4 compression, see CompactObj::SetCompressionThreshold.
+  size_t comp_threshold = 0;
+  size_t lz4_comp_bytes = 0;
+  size_t lz4_raw_bytes = 0;
 };
 
 thread_local TL tl;
@@ -256,6 +289,19 @@ size_t RobjWrapper::Size() const {
         default:
           LOG(FATAL) << "Unexpected encoding " << encoding_;
       };
+    case OBJ_HASH:
+      switch (encoding_) {
+        case kEncodingListPack:
+          return lpLength((uint8_t*)inner_obj_) / 2;
+        case kEncodingStrMap2: {
+          StringMap* sm = (StringMap*)inner_obj_;
+          return sm->Size();
+        }
+        default:
+          LOG(FATAL) << "Unexpected encoding " << encoding_;
+      }
+    case OBJ_STREAM:
+      return ((stream*)inner_obj_)->length;
     default:;
   }
   return 0;
@@ -342,9 +388,12 @@ void RobjWrapper::SetString(string_view s, MemoryResource* mr) {
     if (s.size() > cur_cap) {
       MakeInnerRoom(cur_cap, s.size(), mr);
     }
+  }
+
+  if (!s.empty()) {
     memcpy(inner_obj_, s.data(), s.size());
-    sz_ = s.size();
   }
+  sz_ = s.size();
 }
 
 bool RobjWrapper::DefragIfNeeded(float ratio) {
@@ -452,6 +501,7 @@ bool RobjWrapper::Reallocate(MemoryResource* mr) {
 void RobjWrapper::Init(unsigned type, unsigned encoding, void* inner) {
   type_ = type;
   encoding_ = encoding;
+  write_pressure_ = 0;
   Set(inner, 0);
 }
 
@@ -485,10 +535,16 @@ using namespace std;
 auto CompactObj::GetStats() -> Stats {
   Stats res;
   res.small_string_bytes = tl.small_str_bytes;
+  res.lz4_compressed_bytes = tl.lz4_comp_bytes;
+  res.lz4_raw_bytes = tl.lz4_raw_bytes;
 
   return res;
 }
 
+void CompactObj::SetCompressionThreshold(size_t threshold) {
+  tl.comp_threshold = threshold;
+}
+
 void CompactObj::InitThreadLocal(MemoryResource* mr) {
   tl.local_mr = mr;
   tl.tmp_buf = base::PODArray<uint8_t>{mr};
@@ -534,6 +590,12 @@ size_t CompactObj::Size() const {
       case ROBJ_TAG:
         raw_size = u_.r_obj.Size();
         break;
+      case LZ4_TAG:
+        raw_size = u_.lz4_blob.raw_size;
+        break;
+      case SBMP_TAG:
+        raw_size = u_.sbmp.ptr->byte_size();
+        break;
       default:
         LOG(DFATAL) << "Should not reach " << int(taglen_);
     }
@@ -570,6 +632,11 @@ uint64_t CompactObj::HashCode() const {
       absl::AlphaNum an(u_.ival);
       return XXH3_64bits_withSeed(an.data(), an.size(), kHashSeed);
     }
+    case LZ4_TAG:
+    case SBMP_TAG: {
+      GetString(&tl.tmp_str);
+      return XXH3_64bits_withSeed(tl.tmp_str.data(), tl.tmp_str.size(), kHashSeed);
+    }
   }
   // We need hash only for keys.
   LOG(DFATAL) << "Should not reach " << int(taglen_);
@@ -581,14 +648,26 @@ uint64_t CompactObj::HashCode(string_view str) {
   return XXH3_64bits_withSeed(str.data(), str.size(), kHashSeed);
 }
 
+void CompactObj::HashMany(absl::Span<const string_view> strs, absl::Span<uint64_t> dest) {
+  DCHECK_EQ(strs.size(), dest.size());
+
+  constexpr size_t kPrefetchDist = 4;
+  for (size_t i = 0; i < strs.size(); ++i) {
+    if (i + kPrefetchDist < strs.size())
+      __builtin_prefetch(strs[i + kPrefetchDist].data(), 0, 1);
+    dest[i] = XXH3_64bits_withSeed(strs[i].data(), strs[i].size(), kHashSeed);
+  }
+}
+
 unsigned CompactObj::ObjType() const {
-  if (IsInline() || taglen_ == INT_TAG || taglen_ == SMALL_TAG || taglen_ == EXTERNAL_TAG)
+  if (IsInline() || taglen_ == INT_TAG || taglen_ == SMALL_TAG || taglen_ == EXTERNAL_TAG ||
+      taglen_ == LZ4_TAG || taglen_ == SBMP_TAG)
     return OBJ_STRING;
 
   if (taglen_ == ROBJ_TAG)
     return u_.r_obj.type();
 
-  if (taglen_ == JSON_TAG) {
+  if (taglen_ == JSON_TAG || taglen_ == JSON_BLOB_TAG) {
     return OBJ_JSON;
   }
 
@@ -689,7 +768,12 @@ std::optional<int64_t> CompactObj::TryGetInt() const {
 }
 
 auto CompactObj::GetJson() const -> JsonType* {
-  if (ObjType() == OBJ_JSON) {
+  if (taglen_ == JSON_BLOB_TAG) {
+    // Materialization does not change the observable value, so it is safe to perform
+    // from a const accessor.
+    const_cast<CompactObj*>(this)->MaterializeJson();
+  }
+  if (taglen_ == JSON_TAG) {
     return u_.json_obj.json_ptr;
   }
   return nullptr;
@@ -706,6 +790,41 @@ void CompactObj::SetJson(JsonType&& j) {
   }
 }
 
+void CompactObj::SetJsonBlob(std::string_view blob) {
+  DCHECK(!blob.empty());
+
+  SetMeta(JSON_BLOB_TAG);
+  void* ptr = tl.local_mr->allocate(blob.size());
+  memcpy(ptr, blob.data(), blob.size());
+  u_.json_blob.ptr = reinterpret_cast<uint8_t*>(ptr);
+  u_.json_blob.size = blob.size();
+}
+
+void CompactObj::MaterializeJson() {
+  DCHECK_EQ(JSON_BLOB_TAG, taglen_);
+
+  string_view blob{reinterpret_cast<char*>(u_.json_blob.ptr), u_.json_blob.size};
+  std::optional<JsonType> json = JsonFromCbor(blob);
+  CHECK(json.has_value()) << "failed to decode a stored json blob of size " << blob.size();
+
+  SetMeta(JSON_TAG, mask_);  // frees the blob
+  void* ptr = tl.local_mr->allocate(sizeof(JsonType), kAlignSize);
+  u_.json_obj.json_ptr = new (ptr) JsonType(std::move(*json));
+}
+
+SparseBitmap* CompactObj::InitSparseBitmap() {
+  uint8_t mask = mask_ & ~kEncMask;
+  SetMeta(SBMP_TAG, mask);  // frees the previous value
+  void* ptr = tl.local_mr->allocate(sizeof(SparseBitmap), kAlignSize);
+  u_.sbmp.ptr = new (ptr) SparseBitmap(tl.local_mr);
+  return u_.sbmp.ptr;
+}
+
+SparseBitmap* CompactObj::GetSparseBitmap() const {
+  DCHECK_EQ(SBMP_TAG, taglen_);
+  return u_.sbmp.ptr;
+}
+
 void CompactObj::SetString(std::string_view str) {
   uint8_t mask = mask_ & ~kEncMask;
 
@@ -732,6 +851,9 @@ void CompactObj::SetString(std::string_view str) {
 
   DCHECK_GT(str.size(), kInlineLen);
 
+  if (tl.comp_threshold && str.size() >= tl.comp_threshold && TrySetLz4(str, mask))
+    return;
+
   string_view encoded = str;
   bool is_ascii = kUseAsciiEncoding && detail::validate_ascii_fast(str.data(), str.size());
 
@@ -774,10 +896,50 @@ void CompactObj::SetString(std::string_view str) {
     }
   }
 
+  // When a raw string grows in place (APPEND, SETRANGE build-up), reuse the existing robj
+  // buffer instead of freeing it: MakeInnerRoom grows geometrically and the spare malloc'd
+  // capacity (mimalloc rounds to size classes anyway) lets repeated appends amortize to O(1)
+  // copies. For shrinking overwrites we keep the old free-and-allocate-exact behavior so a
+  // large value replaced by a small one does not pin its old allocation.
+  if (taglen_ == ROBJ_TAG && u_.r_obj.type() == OBJ_STRING && encoded.size() >= u_.r_obj.Size()) {
+    mask_ = mask;
+    u_.r_obj.SetString(encoded, tl.local_mr);
+    return;
+  }
+
   SetMeta(ROBJ_TAG, mask);
   u_.r_obj.SetString(encoded, tl.local_mr);
 }
 
+bool CompactObj::TrySetLz4(string_view str, uint8_t mask) {
+  DCHECK_GT(str.size(), kInlineLen);
+
+  int bound = LZ4_compressBound(str.size());
+  if (bound <= 0)  // str exceeds LZ4_MAX_INPUT_SIZE.
+    return false;
+
+  tl.tmp_buf.resize(bound);
+  int comp_size = LZ4_compress_default(str.data(), reinterpret_cast<char*>(tl.tmp_buf.data()),
+                                       str.size(), bound);
+
+  // Require at least 1/8 of savings (same bar as the ascii packing), otherwise keep the
+  // plain representation and its cheaper reads.
+  if (comp_size <= 0 || size_t(comp_size) > str.size() - str.size() / 8)
+    return false;
+
+  SetMeta(LZ4_TAG, mask & ~kEncMask);
+  void* ptr = tl.local_mr->allocate(comp_size);
+  memcpy(ptr, tl.tmp_buf.data(), comp_size);
+  u_.lz4_blob.ptr = reinterpret_cast<uint8_t*>(ptr);
+  u_.lz4_blob.comp_size = comp_size;
+  u_.lz4_blob.raw_size = str.size();
+
+  tl.lz4_comp_bytes += comp_size;
+  tl.lz4_raw_bytes += str.size();
+
+  return true;
+}
+
 string_view CompactObj::GetSlice(string* scratch) const {
   uint8_t is_encoded = mask_ & kEncMask;
 
@@ -843,6 +1005,20 @@ string_view CompactObj::GetSlice(string* scratch) const {
     return *scratch;
   }
 
+  if (taglen_ == LZ4_TAG) {
+    scratch->resize(u_.lz4_blob.raw_size);
+    int res = LZ4_decompress_safe(reinterpret_cast<const char*>(u_.lz4_blob.ptr), scratch->data(),
+                                  u_.lz4_blob.comp_size, u_.lz4_blob.raw_size);
+    CHECK_EQ(res, int(u_.lz4_blob.raw_size));
+    return *scratch;
+  }
+
+  if (taglen_ == SBMP_TAG) {
+    scratch->resize(u_.sbmp.ptr->byte_size());
+    u_.sbmp.ptr->Materialize(scratch->data());
+    return *scratch;
+  }
+
   LOG(FATAL) << "Bad tag " << int(taglen_);
 
   return string_view{};
@@ -874,7 +1050,8 @@ bool CompactObj::HasAllocated() const {
       (taglen_ == ROBJ_TAG && u_.r_obj.inner_obj() == nullptr))
     return false;
 
-  DCHECK(taglen_ == ROBJ_TAG || taglen_ == SMALL_TAG || taglen_ == JSON_TAG);
+  DCHECK(taglen_ == ROBJ_TAG || taglen_ == SMALL_TAG || taglen_ == JSON_TAG ||
+         taglen_ == JSON_BLOB_TAG || taglen_ == LZ4_TAG || taglen_ == SBMP_TAG);
   return true;
 }
 
@@ -952,6 +1129,18 @@ void CompactObj::GetString(char* dest) const {
     return;
   }
 
+  if (taglen_ == LZ4_TAG) {
+    int res = LZ4_decompress_safe(reinterpret_cast<const char*>(u_.lz4_blob.ptr), dest,
+                                  u_.lz4_blob.comp_size, u_.lz4_blob.raw_size);
+    CHECK_EQ(res, int(u_.lz4_blob.raw_size));
+    return;
+  }
+
+  if (taglen_ == SBMP_TAG) {
+    u_.sbmp.ptr->Materialize(dest);
+    return;
+  }
+
   LOG(FATAL) << "Bad tag " << int(taglen_);
 }
 
@@ -990,6 +1179,15 @@ void CompactObj::Free() {
     VLOG(1) << "Freeing JSON object";
     u_.json_obj.json_ptr->~JsonType();
     tl.local_mr->deallocate(u_.json_obj.json_ptr, kAlignSize);
+  } else if (taglen_ == JSON_BLOB_TAG) {
+    tl.local_mr->deallocate(u_.json_blob.ptr, u_.json_blob.size);
+  } else if (taglen_ == LZ4_TAG) {
+    tl.lz4_comp_bytes -= u_.lz4_blob.comp_size;
+    tl.lz4_raw_bytes -= u_.lz4_blob.raw_size;
+    tl.local_mr->deallocate(u_.lz4_blob.ptr, u_.lz4_blob.comp_size);
+  } else if (taglen_ == SBMP_TAG) {
+    u_.sbmp.ptr->~SparseBitmap();
+    tl.local_mr->deallocate(u_.sbmp.ptr, sizeof(SparseBitmap), kAlignSize);
   } else {
     LOG(FATAL) << "Unsupported tag " << int(taglen_);
   }
@@ -1010,10 +1208,22 @@ size_t CompactObj::MallocUsed() const {
     return zmalloc_size(u_.json_obj.json_ptr);
   }
 
+  if (taglen_ == JSON_BLOB_TAG) {
+    return u_.json_blob.size;
+  }
+
   if (taglen_ == SMALL_TAG) {
     return u_.small_str.MallocUsed();
   }
 
+  if (taglen_ == LZ4_TAG) {
+    return u_.lz4_blob.comp_size;
+  }
+
+  if (taglen_ == SBMP_TAG) {
+    return sizeof(SparseBitmap) + u_.sbmp.ptr->MallocUsed();
+  }
+
   LOG(DFATAL) << "should not reach";
   return 0;
 }
@@ -1038,6 +1248,19 @@ bool CompactObj::operator==(const CompactObj& o) const {
   if (taglen_ == SMALL_TAG)
     return u_.small_str.Equal(o.u_.small_str);
 
+  if (taglen_ == SBMP_TAG) {
+    string tmp1, tmp2;
+    GetString(&tmp1);
+    o.GetString(&tmp2);
+    return tmp1 == tmp2;
+  }
+
+  // lz4 compression is deterministic, so equal payloads have equal blobs.
+  if (taglen_ == LZ4_TAG)
+    return u_.lz4_blob.raw_size == o.u_.lz4_blob.raw_size &&
+           u_.lz4_blob.comp_size == o.u_.lz4_blob.comp_size &&
+           memcmp(u_.lz4_blob.ptr, o.u_.lz4_blob.ptr, u_.lz4_blob.comp_size) == 0;
+
   DCHECK(IsInline() && o.IsInline());
 
   return memcmp(u_.inline_str, o.u_.inline_str, taglen_) == 0;
@@ -1054,6 +1277,18 @@ bool CompactObj::EqualNonInline(std::string_view sv) const {
       return u_.r_obj.Equal(sv);
     case SMALL_TAG:
       return u_.small_str.Equal(sv);
+    case LZ4_TAG: {
+      if (sv.size() != u_.lz4_blob.raw_size)
+        return false;
+      GetString(&tl.tmp_str);
+      return sv == tl.tmp_str;
+    }
+    case SBMP_TAG: {
+      if (sv.size() != u_.sbmp.ptr->byte_size())
+        return false;
+      GetString(&tl.tmp_str);
+      return sv == tl.tmp_str;
+    }
     default:
       break;
   }
@@ -5,6 +5,7 @@
 #pragma once
 
 #include <absl/base/internal/endian.h>
+#include <absl/types/span.h>
 
 #ifdef __clang__
 #include <experimental/memory_resource>
@@ -23,6 +24,8 @@ typedef struct redisObject robj;
 
 namespace dfly {
 
+class SparseBitmap;
+
 constexpr unsigned kEncodingIntSet = 0;
 constexpr unsigned kEncodingStrMap = 1;   // for set/map encodings of strings
 constexpr unsigned kEncodingStrMap2 = 2;  // for set/map encodings of strings using DenseSet
@@ -58,6 +61,21 @@ class RobjWrapper {
   unsigned encoding() const {
     return encoding_;
   }
+
+  unsigned write_pressure() const {
+    return write_pressure_;
+  }
+
+  void BumpWritePressure() {
+    if (write_pressure_ < kWritePressureLimit)
+      ++write_pressure_;
+  }
+
+  void DecayWritePressure() const {
+    if (write_pressure_ > 0)
+      --write_pressure_;
+  }
+
   void* inner_obj() const {
     return inner_obj_;
   }
@@ -92,7 +110,15 @@ class RobjWrapper {
 
   uint32_t type_ : 4;
   uint32_t encoding_ : 4;
-  uint32_t : 24;
+
+  // Saturating counter approximating recent write pressure on the container: mutating ops
+  // bump it, read ops decay it. Used to drive adaptive encoding conversions, see
+  // CompactObj::BumpWritePressure. Mutable since reads update it through const objects,
+  // similarly to lru/lfu metadata.
+  mutable uint32_t write_pressure_ : 4;
+  uint32_t : 20;
+
+  static constexpr unsigned kWritePressureLimit = 15;  // 4 bits.
 
 } __attribute__((packed));
 
@@ -111,6 +137,14 @@ class CompactObj {
     ROBJ_TAG = 19,
     EXTERNAL_TAG = 20,
     JSON_TAG = 21,
+    JSON_BLOB_TAG = 22,
+
+    // An lz4-compressed string value, see SetString/TrySetLz4. Decompressed lazily on read.
+    LZ4_TAG = 23,
+
+    // A mostly-zero string value backed by a SparseBitmap (a page table of 4KB chunks),
+    // see InitSparseBitmap. Generic readers materialize it through GetSlice/GetString.
+    SBMP_TAG = 24,
   };
 
   enum MaskBit {
@@ -126,6 +160,11 @@ class CompactObj {
     ASCII2_ENC_BIT = 0x10,
     IO_PENDING = 0x20,
     STICKY = 0x40,
+
+    // Set by the cache hit path and cleared when the eviction policy inspects the entry as a
+    // candidate, so a hot item is spared as long as it keeps being accessed between eviction
+    // attempts (CLOCK second-chance). Relevant only when running with --cache_mode.
+    TOUCHED = 0x80,
   };
 
   static constexpr uint8_t kEncMask = ASCII1_ENC_BIT | ASCII2_ENC_BIT;
@@ -153,6 +192,14 @@ class CompactObj {
 
   CompactObj& operator=(CompactObj&& o) noexcept;
 
+  // Assigns a string value, releasing the previous representation. Allows containers to
+  // materialize a CompactObj key directly inside their storage from a string_view, without
+  // the caller constructing (and possibly destroying) a temporary object.
+  CompactObj& operator=(std::string_view str) {
+    SetString(str);
+    return *this;
+  }
+
   // Returns object size depending on the semantics.
   // For strings - returns the length of the string.
   // For containers - returns number of elements in the container.
@@ -184,6 +231,12 @@ class CompactObj {
   uint64_t HashCode() const;
   static uint64_t HashCode(std::string_view str);
 
+  // Hashes strs[i] into dest[i] for the whole batch. Prefetches the string data a few
+  // entries ahead, so the independent hash computations overlap their cache misses -
+  // profitable when pre-hashing all keys of a pipelined batch.
+  // Requires: strs.size() == dest.size().
+  static void HashMany(absl::Span<const std::string_view> strs, absl::Span<uint64_t> dest);
+
   bool operator==(const CompactObj& o) const;
 
   bool operator==(std::string_view sl) const;
@@ -246,6 +299,36 @@ class CompactObj {
     }
   }
 
+  bool WasTouched() const {
+    return mask_ & TOUCHED;
+  }
+
+  // mask_ is mutable, so hit tracking works through const lookup paths as well.
+  void SetTouched(bool e) const {
+    if (e) {
+      mask_ |= TOUCHED;
+    } else {
+      mask_ &= ~TOUCHED;
+    }
+  }
+
+  // Write pressure tracking for adaptive container encoding decisions. Mutating container
+  // ops bump the (saturating) counter and read ops decay it, so it approximates how
+  // write-heavy the recent access pattern is. No-op for non ROBJ_TAG objects.
+  unsigned WritePressure() const {
+    return taglen_ == ROBJ_TAG ? u_.r_obj.write_pressure() : 0;
+  }
+
+  void BumpWritePressure() {
+    if (taglen_ == ROBJ_TAG)
+      u_.r_obj.BumpWritePressure();
+  }
+
+  void DecayWritePressure() const {
+    if (taglen_ == ROBJ_TAG)
+      u_.r_obj.DecayWritePressure();
+  }
+
   unsigned Encoding() const;
   unsigned ObjType() const;
 
@@ -293,9 +376,26 @@ class CompactObj {
   // into here, no copying is allowed!
   void SetJson(JsonType&& j);
 
-  // pre condition - the type here is OBJ_JSON and was set with SetJson
+  // Will set this to hold OBJ_JSON in the compact binary form produced by JsonToCbor.
+  // The blob costs roughly the serialized size instead of the materialized tree and
+  // is decoded back into a json tree by the first GetJson() call.
+  void SetJsonBlob(std::string_view blob);
+
+  // pre condition - the type here is OBJ_JSON and was set with SetJson or SetJsonBlob.
+  // Materializes the binary form if needed.
   JsonType* GetJson() const;
 
+  bool IsSparseBitmap() const {
+    return taglen_ == SBMP_TAG;
+  }
+
+  // Switches this object to the sparse bitmap representation (an OBJ_STRING for readers)
+  // and returns the owned, initially empty bitmap for the caller to populate.
+  SparseBitmap* InitSparseBitmap();
+
+  // Requires: IsSparseBitmap().
+  SparseBitmap* GetSparseBitmap() const;
+
   // dest must have at least Size() bytes available
   void GetString(char* dest) const;
 
@@ -303,6 +403,12 @@ class CompactObj {
     return taglen_ == EXTERNAL_TAG;
   }
 
+  // Whether the payload lives in the SmallString arena of the thread that created it.
+  // Such objects may only be accessed (and freed) from that thread.
+  bool UsesSmallString() const {
+    return taglen_ == SMALL_TAG;
+  }
+
   void SetExternal(size_t offset, size_t sz);
   std::pair<size_t, size_t> GetExternalSlice() const;
 
@@ -323,6 +429,10 @@ class CompactObj {
 
   struct Stats {
     size_t small_string_bytes = 0;
+
+    // At-rest lz4 compression accounting: bytes stored vs. the original payload sizes.
+    size_t lz4_compressed_bytes = 0;
+    size_t lz4_raw_bytes = 0;
   };
 
   static Stats GetStats();
@@ -330,6 +440,11 @@ class CompactObj {
   static void InitThreadLocal(MemoryResource* mr);
   static MemoryResource* memory_resource();  // thread-local.
 
+  // Enables transparent lz4 compression of string values at rest for this thread: SetString
+  // compresses payloads of at least `threshold` bytes that compress well enough, and readers
+  // decompress lazily. 0 (the default) disables compression.
+  static void SetCompressionThreshold(size_t threshold);
+
  private:
   size_t DecodedLen(size_t sz) const;
 
@@ -340,6 +455,13 @@ class CompactObj {
 
   bool HasAllocated() const;
 
+  // Requires: taglen_ == JSON_BLOB_TAG. Decodes the blob into a json tree.
+  void MaterializeJson();
+
+  // Tries to store str as an lz4-compressed blob. Returns false (leaving the object
+  // unchanged) if the payload does not compress well enough to be worth it.
+  bool TrySetLz4(std::string_view str, uint8_t mask);
+
   bool CmpEncoded(std::string_view sv) const;
 
   void SetMeta(uint8_t taglen, uint8_t mask = 0) {
@@ -366,6 +488,25 @@ class CompactObj {
     size_t unneeded = 0;
   } __attribute__((packed));
 
+  // CBOR encoding of a json value, see SetJsonBlob.
+  struct JsonBlob {
+    uint8_t* ptr = nullptr;
+    uint32_t size = 0;
+  } __attribute__((packed));
+
+  // lz4-compressed string payload, see TrySetLz4.
+  struct Lz4Blob {
+    uint8_t* ptr = nullptr;
+    uint32_t comp_size = 0;
+    uint32_t raw_size = 0;
+  } __attribute__((packed));
+
+  // Sparse bitmap value, see InitSparseBitmap.
+  struct SbmpWrapper {
+    SparseBitmap* ptr = nullptr;
+    size_t unneeded = 0;
+  } __attribute__((packed));
+
   // My main data structure. Union of representations.
   // RobjWrapper is kInlineLen=16 bytes, so we employ SSO of that size via inline_str.
   // In case of int values, we waste 8 bytes. I am assuming it's ok and it's not the data type
@@ -376,6 +517,9 @@ class CompactObj {
     SmallString small_str;
     detail::RobjWrapper r_obj;
     JsonWrapper json_obj;
+    JsonBlob json_blob;
+    Lz4Blob lz4_blob;
+    SbmpWrapper sbmp;
     int64_t ival __attribute__((packed));
     ExternalPtr ext_ptr;
 
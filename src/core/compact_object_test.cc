@@ -295,6 +295,23 @@ TEST_F(CompactObjectTest, InlineAsciiEncoded) {
   EXPECT_EQ(s.size(), obj.Size());
 }
 
+TEST_F(CompactObjectTest, HashMany) {
+  vector<string> strs;
+  vector<string_view> views;
+  for (unsigned i = 0; i < 100; ++i) {
+    strs.push_back(absl::StrCat("key:", i, string(i % 30, 'x')));
+  }
+  for (const auto& s : strs)
+    views.push_back(s);
+
+  vector<uint64_t> hashes(views.size());
+  CompactObj::HashMany(absl::MakeSpan(views), absl::MakeSpan(hashes));
+
+  for (size_t i = 0; i < views.size(); ++i) {
+    EXPECT_EQ(CompactObj::HashCode(views[i]), hashes[i]) << i;
+  }
+}
+
 TEST_F(CompactObjectTest, Int) {
   cobj_.SetString("0");
   EXPECT_EQ(0, cobj_.TryGetInt());
@@ -311,6 +328,52 @@ TEST_F(CompactObjectTest, Int) {
   EXPECT_TRUE(cobj_.HasExpire());
 }
 
+TEST_F(CompactObjectTest, Lz4Compression) {
+  CompactObj::SetCompressionThreshold(64);
+
+  string val(1000, 'a');
+  val += "some json-like payload that repeats itself over and over and over again";
+  cobj_.SetString(val);
+  EXPECT_EQ(OBJ_STRING, cobj_.ObjType());
+  EXPECT_EQ(val.size(), cobj_.Size());
+  EXPECT_LT(cobj_.MallocUsed(), val.size() / 2);
+  EXPECT_EQ(val, cobj_.GetSlice(&tmp_));
+  EXPECT_TRUE(cobj_ == val);
+  EXPECT_FALSE(cobj_ == string(val.size(), 'b'));
+
+  string copy;
+  cobj_.GetString(&copy);
+  EXPECT_EQ(val, copy);
+
+  // Incompressible payload keeps the plain representation.
+  string noise(1000, 0);
+  uint64_t state = kSeed;
+  for (auto& c : noise) {
+    state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+    c = char(state >> 33);
+  }
+  cobj_.SetString(noise);
+  EXPECT_EQ(noise, cobj_.GetSlice(&tmp_));
+  EXPECT_GE(cobj_.MallocUsed(), noise.size());
+
+  CompactObj::SetCompressionThreshold(0);
+}
+
+TEST_F(CompactObjectTest, TouchBit) {
+  cobj_.SetString("foobar");
+  EXPECT_FALSE(cobj_.WasTouched());
+
+  cobj_.SetTouched(true);
+  EXPECT_TRUE(cobj_.WasTouched());
+
+  // Overwriting the value is an access as well, the bit survives it.
+  cobj_.SetString("another value that is long enough to not be inlined");
+  EXPECT_TRUE(cobj_.WasTouched());
+
+  cobj_.SetTouched(false);
+  EXPECT_FALSE(cobj_.WasTouched());
+}
+
 TEST_F(CompactObjectTest, MediumString) {
   string tmp(511, 'b');
 
@@ -326,6 +389,35 @@ TEST_F(CompactObjectTest, MediumString) {
   EXPECT_EQ(27463, cobj_.Size());
 }
 
+TEST_F(CompactObjectTest, StringGrowInPlace) {
+  // Large enough so that the raw robj representation is used throughout.
+  string val(20000, 'a');
+  cobj_.SetString(val);
+  EXPECT_EQ(val.size(), cobj_.Size());
+
+  // Simulates the APPEND pattern: overwrite with an ever-growing value.
+  string res;
+  for (unsigned i = 1; i <= 16; ++i) {
+    val.append(1000, char('a' + i));
+    cobj_.SetString(val);
+    EXPECT_EQ(val.size(), cobj_.Size());
+    cobj_.GetString(&res);
+    EXPECT_EQ(val, res);
+  }
+
+  // Same-size and shrinking overwrites must be reflected as well.
+  val.assign(val.size(), 'd');
+  cobj_.SetString(val);
+  cobj_.GetString(&res);
+  EXPECT_EQ(val, res);
+
+  val.resize(15000, 'e');
+  cobj_.SetString(val);
+  EXPECT_EQ(val.size(), cobj_.Size());
+  cobj_.GetString(&res);
+  EXPECT_EQ(val, res);
+}
+
 TEST_F(CompactObjectTest, AsciiUtil) {
   std::string_view data{"aaaaaabb"};
   uint8_t buf[32];
@@ -542,6 +634,28 @@ TEST_F(CompactObjectTest, JsonTypeTest) {
   ASSERT_TRUE(failed_json == nullptr);
 }
 
+TEST_F(CompactObjectTest, JsonBlobTest) {
+  std::string_view json_str = R"({"a":{}, "b":{"a":1}, "c":{"a":1, "b":2}})";
+  std::optional<JsonType> json_option = JsonFromString(json_str);
+  ASSERT_TRUE(json_option.has_value());
+
+  std::string blob = JsonToCbor(json_option.value());
+  EXPECT_LT(blob.size(), json_str.size());
+
+  cobj_.SetJsonBlob(blob);
+  ASSERT_TRUE(cobj_.ObjType() == OBJ_JSON);  // the blob form reports the json type
+  EXPECT_EQ(blob.size(), cobj_.MallocUsed());
+
+  // The first GetJson() call materializes the tree in place.
+  JsonType* json = cobj_.GetJson();
+  ASSERT_TRUE(json != nullptr);
+  ASSERT_TRUE(json->contains("b"));
+  EXPECT_EQ(json_option.value(), *json);
+
+  // Subsequent calls return the same materialized tree.
+  ASSERT_EQ(json, cobj_.GetJson());
+}
+
 TEST_F(CompactObjectTest, JsonTypeWithPathTest) {
   std::string_view books_json =
       R"({"books":[{
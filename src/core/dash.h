@@ -11,6 +11,8 @@ namespace PMR_NS = std::experimental::pmr;
 namespace PMR_NS = std::pmr;
 #endif
 
+#include <absl/types/span.h>
+
 #include <vector>
 
 #include "core/dash_internal.h"
@@ -153,6 +155,17 @@ class DashTable : public detail::DashTableBase {
   template <typename U> const_iterator Find(U&& key) const;
   template <typename U> iterator Find(U&& key);
 
+  // Finds keys[i] and stores the result in dest[i] (end-iterator if not found).
+  // Hashes all keys up front and prefetches the target buckets before probing, so that
+  // the dependent cache misses of independent lookups overlap instead of serializing.
+  // Useful for multi-key commands like MGET. Requires: keys.size() == dest.size().
+  template <typename U> void FindBatch(absl::Span<const U> keys, absl::Span<iterator> dest);
+
+  // Issues prefetches for the buckets Find(key) would touch, without probing them.
+  // Lets a caller that will look up the same key shortly overlap the bucket fetch
+  // with unrelated work.
+  template <typename U> void Prefetch(const U& key) const;
+
   // it must be valid.
   void Erase(iterator it);
 
@@ -238,6 +251,13 @@ class DashTable : public detail::DashTableBase {
     return iterator{this, segment_id, uint8_t(bucket_id), uint8_t(slot_id)};
   }
 
+  // Returns an iterator to an occupied slot picked uniformly at random, or end() if the
+  // table is empty. Draws a directory entry, bucket and slot at random and redraws until an
+  // occupied slot is hit, so the expected cost is O(1) for any reasonable load factor.
+  // For pathologically sparse tables it falls back to a linear probe from a random
+  // position, which is cheap but only approximately uniform.
+  template <typename URandGen> iterator SampleUniform(URandGen&& gen);
+
   const_bucket_iterator CursorToBucketIt(Cursor c) const {
     return const_bucket_iterator{this, c.segment_id(global_depth_), c.bucket_id(), 0};
   }
@@ -257,7 +277,13 @@ class DashTable : public detail::DashTableBase {
 
   template <typename Cb> void CVCUponBump(uint64_t ver_threshold, const_iterator it, Cb&& cb);
 
-  void Clear();
+  void Clear() {
+    ClearStepped([](size_t) {});
+  }
+
+  // Same as Clear(), but calls step_cb(entries_destroyed) after each distinct segment is torn
+  // down, so the caller can yield (and report progress) inside the teardown of a huge table.
+  template <typename StepCb> void ClearStepped(StepCb&& step_cb);
 
   // Returns true if an element was deleted i.e the rightmost slot was busy.
   bool ShiftRight(bucket_iterator it);
@@ -277,6 +303,14 @@ class DashTable : public detail::DashTableBase {
     return stash_unloaded_;
   }
 
+  // Proactively splits segments whose utilization reached util_ratio, inspecting at most
+  // max_scan directory chunks per call and splitting at most max_splits segments. The scan
+  // position is kept across calls, so periodic invocations (from a background fiber) cover
+  // the whole directory incrementally. Splitting ahead of time moves the split cost off the
+  // writer path: inserts rarely hit a full segment and Grow stays cheap.
+  // Returns the number of segments that were split.
+  unsigned SplitBudgeted(unsigned max_scan, unsigned max_splits, double util_ratio);
+
  private:
   template <typename U, typename V, typename EvictionPolicy>
   std::pair<iterator, bool> InsertInternal(U&& key, V&& value, EvictionPolicy& policy);
@@ -302,6 +336,7 @@ class DashTable : public detail::DashTableBase {
 
   uint64_t garbage_collected_ = 0;
   uint64_t stash_unloaded_ = 0;
+  size_t split_cursor_ = 0;  // directory position for SplitBudgeted.
 };  // DashTable
 
 template <typename _Key, typename _Value, typename Policy>
@@ -554,13 +589,17 @@ void DashTable<_Key, _Value, Policy>::CVCUponBump(uint64_t ver_upperbound, const
 }
 
 template <typename _Key, typename _Value, typename Policy>
-void DashTable<_Key, _Value, Policy>::Clear() {
-  auto cb = [this](SegmentType* seg) {
-    seg->TraverseAll([this, seg](const SegmentIterator& it) {
+template <typename StepCb>
+void DashTable<_Key, _Value, Policy>::ClearStepped(StepCb&& step_cb) {
+  auto cb = [&](SegmentType* seg) {
+    size_t destroyed = 0;
+    seg->TraverseAll([&, seg](const SegmentIterator& it) {
       policy_.DestroyKey(seg->Key(it.index, it.slot));
       policy_.DestroyValue(seg->Value(it.index, it.slot));
+      ++destroyed;
     });
     seg->Clear();
+    step_cb(destroyed);
     return false;
   };
 
@@ -607,6 +646,45 @@ void DashTable<_Key, _Value, Policy>::Clear() {
   }
 }
 
+template <typename _Key, typename _Value, typename Policy>
+template <typename URandGen>
+auto DashTable<_Key, _Value, Policy>::SampleUniform(URandGen&& gen) -> iterator {
+  if (size() == 0)
+    return end();
+
+  constexpr unsigned kMaxAttempts = 64;
+
+  for (unsigned attempt = 0; attempt < kMaxAttempts; ++attempt) {
+    uint32_t seg_id = gen() % segment_.size();
+    const SegmentType* seg = segment_[seg_id];
+
+    // A segment with local depth d appears 2^(global_depth_ - d) consecutive times in the
+    // directory. Accept only its first entry so that duplicated segments are not oversampled.
+    uint32_t duplicates = 1u << (global_depth_ - seg->local_depth());
+    if (seg_id & (duplicates - 1))
+      continue;
+
+    uint32_t bid = gen() % SegmentType::kTotalBuckets;
+    uint32_t slot = gen() % SegmentType::kNumSlots;
+    if (seg->GetBucket(bid).IsBusy(slot))
+      return GetIterator(seg_id, bid, slot);
+  }
+
+  // Fallback: scan forward from a random directory entry.
+  uint32_t start = gen() % segment_.size();
+  for (uint32_t i = 0; i < segment_.size(); ++i) {
+    uint32_t seg_id = (start + i) % segment_.size();
+    const SegmentType* seg = segment_[seg_id];
+    for (uint32_t bid = 0; bid < SegmentType::kTotalBuckets; ++bid) {
+      uint32_t busy = seg->GetBucket(bid).GetBusy();
+      if (busy)
+        return GetIterator(seg_id, bid, __builtin_ctz(busy));
+    }
+  }
+
+  return end();
+}
+
 template <typename _Key, typename _Value, typename Policy>
 bool DashTable<_Key, _Value, Policy>::ShiftRight(bucket_iterator it) {
   auto* seg = segment_[it.seg_id_];
@@ -673,6 +751,45 @@ auto DashTable<_Key, _Value, Policy>::Find(U&& key) -> iterator {
   return iterator{};
 }
 
+template <typename _Key, typename _Value, typename Policy>
+template <typename U>
+void DashTable<_Key, _Value, Policy>::FindBatch(absl::Span<const U> keys,
+                                                absl::Span<iterator> dest) {
+  assert(keys.size() == dest.size());
+
+  // Process in fixed-size chunks so the scratch arrays stay on the stack. Within a chunk
+  // we first hash everything and issue the bucket prefetches, and only then run the probes,
+  // by which time the cache lines are (hopefully) already in flight.
+  constexpr size_t kChunkSize = 16;
+
+  uint64_t hash[kChunkSize];
+  uint32_t segid[kChunkSize];
+
+  for (size_t base = 0; base < keys.size(); base += kChunkSize) {
+    size_t chunk = std::min(kChunkSize, keys.size() - base);
+
+    for (size_t i = 0; i < chunk; ++i) {
+      hash[i] = DoHash(keys[base + i]);
+      segid[i] = SegmentId(hash[i]);
+      segment_[segid[i]]->Prefetch(hash[i]);
+    }
+
+    for (size_t i = 0; i < chunk; ++i) {
+      const auto* target = segment_[segid[i]];
+      auto seg_it = target->FindIt(keys[base + i], hash[i], EqPred());
+      dest[base + i] =
+          seg_it.found() ? iterator{this, segid[i], seg_it.index, seg_it.slot} : iterator{};
+    }
+  }
+}
+
+template <typename _Key, typename _Value, typename Policy>
+template <typename U>
+void DashTable<_Key, _Value, Policy>::Prefetch(const U& key) const {
+  uint64_t key_hash = DoHash(key);
+  segment_[SegmentId(key_hash)]->Prefetch(key_hash);
+}
+
 template <typename _Key, typename _Value, typename Policy>
 size_t DashTable<_Key, _Value, Policy>::Erase(const Key_t& key) {
   uint64_t key_hash = DoHash(key);
@@ -858,6 +975,41 @@ void DashTable<_Key, _Value, Policy>::Split(uint32_t seg_id) {
   }
 }
 
+template <typename _Key, typename _Value, typename Policy>
+unsigned DashTable<_Key, _Value, Policy>::SplitBudgeted(unsigned max_scan, unsigned max_splits,
+                                                        double util_ratio) {
+  assert(util_ratio > 0 && util_ratio <= 1.0);
+
+  const size_t split_limit = size_t(util_ratio * SegmentType::capacity());
+  unsigned splits = 0;
+
+  for (unsigned scans = 0; scans < max_scan && splits < max_splits; ++scans) {
+    if (split_cursor_ >= segment_.size())
+      split_cursor_ = 0;
+
+    SegmentType* seg = segment_[split_cursor_];
+    size_t next = NextSeg(split_cursor_);
+
+    if (seg->SlowSize() >= split_limit) {
+      uint32_t seg_id = split_cursor_;
+      if (seg->local_depth() == global_depth_) {
+        IncreaseDepth(global_depth_ + 1);
+
+        // The directory doubled, all positions shifted left by one bit.
+        seg_id *= 2;
+        split_cursor_ *= 2;
+        next *= 2;
+      }
+      Split(seg_id);
+      ++splits;
+    }
+
+    split_cursor_ = next;
+  }
+
+  return splits;
+}
+
 template <typename _Key, typename _Value, typename Policy>
 template <typename Cb>
 auto DashTable<_Key, _Value, Policy>::Traverse(Cursor curs, Cb&& cb) -> Cursor {
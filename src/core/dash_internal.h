@@ -222,6 +222,11 @@ template <unsigned NUM_SLOTS, unsigned NUM_STASH_FPS> class BucketBase {
 
  protected:
   uint32_t CompareFP(uint8_t fp) const;
+
+  // Like CompareFP but for the stash fingerprint array. Returns a mask with bits in
+  // range [0, kStashFpLen) set for fingerprints equal to fp.
+  unsigned CompareStashFP(uint8_t fp) const;
+
   bool ShiftRight();
 
   // Returns true if stash_pos was stored, false overwise
@@ -486,6 +491,14 @@ template <typename _Key, typename _Value, typename Policy = DefaultSegmentPolicy
 
   template <typename U, typename Pred> Iterator FindIt(U&& key, Hash_t key_hash, Pred&& cf) const;
 
+  // Prefetches the home and neighbour buckets that FindIt would touch for key_hash.
+  // Allows pipelining multiple independent lookups by overlapping their cache misses.
+  void Prefetch(Hash_t key_hash) const {
+    uint8_t bidx = BucketIndex(key_hash);
+    __builtin_prefetch(&bucket_[bidx], 0, 1);
+    __builtin_prefetch(&bucket_[NextBid(bidx)], 0, 1);
+  }
+
   // Returns valid iterator if succeeded or invalid if not (it's full).
   // Requires: key should be not present in the segment.
   // if spread is true, tries to spread the load between neighbour and home buckets,
@@ -928,6 +941,25 @@ uint32_t BucketBase<NUM_SLOTS, NUM_OVR>::CompareFP(uint8_t fp) const {
 }
 #endif
 
+template <unsigned NUM_SLOTS, unsigned NUM_OVR>
+unsigned BucketBase<NUM_SLOTS, NUM_OVR>::CompareStashFP(uint8_t fp) const {
+  static_assert(kStashFpLen <= 4);
+
+  // The stash array is too short for a vector load (and reading past it would step on the
+  // neighbouring members), so we use a branchless SWAR zero-byte scan instead.
+  uint32_t fps = 0;
+  memcpy(&fps, stash_arr_.data(), kStashFpLen);
+  uint32_t xored = fps ^ (0x01010101u * fp);
+
+  // Matching bytes become zero in xored; mark their msb.
+  uint32_t zmask = (xored - 0x01010101u) & ~xored & 0x80808080u;
+
+  // Collapse per-byte msb indicators into bits [0, kStashFpLen).
+  unsigned res = ((zmask >> 7) & 1u) | ((zmask >> 14) & 2u) | ((zmask >> 21) & 4u) |
+                 ((zmask >> 28) & 8u);
+  return res & ((1u << kStashFpLen) - 1);
+}
+
 // Bucket slot array goes from left to right: [x, x, ...]
 // Shift right vacates the first slot on the left by shifting all the elements right and
 // possibly deleting the last one on the right.
@@ -948,18 +980,18 @@ template <typename F>
 auto BucketBase<NUM_SLOTS, NUM_OVR>::IterateStash(uint8_t fp, bool is_probe, F&& func) const
     -> ::std::pair<unsigned, SlotId> {
   unsigned om = is_probe ? stash_probe_mask_ : ~stash_probe_mask_;
-  unsigned ob = stash_busy_;
-
-  for (unsigned i = 0; i < kStashFpLen; ++i) {
-    if ((ob & 1) && (stash_arr_[i] == fp) && (om & 1)) {
-      unsigned pos = (stash_pos_ >> (i * 2)) & 3;
-      auto sid = func(i, pos);
-      if (sid != BucketBase::kNanSlot) {
-        return std::pair<unsigned, SlotId>(pos, sid);
-      }
+
+  // Compare all stash fingerprints at once and then visit only the matching ones.
+  unsigned matches = CompareStashFP(fp) & stash_busy_ & om;
+  while (matches) {
+    unsigned i = __builtin_ctz(matches);
+    matches &= matches - 1;
+
+    unsigned pos = (stash_pos_ >> (i * 2)) & 3;
+    auto sid = func(i, pos);
+    if (sid != BucketBase::kNanSlot) {
+      return std::pair<unsigned, SlotId>(pos, sid);
     }
-    ob >>= 1;
-    om >>= 1;
   }
   return std::pair<unsigned, SlotId>(0, BucketBase::kNanSlot);
 }
@@ -1003,14 +1035,15 @@ auto Segment<Key, Value, Policy>::Bucket::FindByFp(uint8_t fp_hash, bool probe,
   if (!mask)
     return kNanSlot;
 
-  unsigned delta = __builtin_ctz(mask);
-  mask >>= delta;
-  for (unsigned i = delta; i < NUM_SLOTS; ++i) {
-    if ((mask & 1) && pred(key[i], k)) {
+  // Iterate only over the set bits of the fingerprint match mask instead of scanning
+  // every slot - typically there is exactly one candidate.
+  do {
+    unsigned i = __builtin_ctz(mask);
+    if (pred(key[i], k)) {
       return i;
     }
-    mask >>= 1;
-  };
+    mask &= mask - 1;
+  } while (mask);
 
   return kNanSlot;
 }
@@ -7,6 +7,8 @@
 #include "core/dash.h"
 
 #include <absl/container/flat_hash_map.h>
+#include <absl/container/flat_hash_set.h>
+#include <absl/random/random.h>
 #include <mimalloc.h>
 
 #include <functional>
@@ -417,6 +419,29 @@ TEST_F(DashTest, Insert2) {
   }
 }
 
+TEST_F(DashTest, SampleUniform) {
+  absl::InsecureBitGen gen;
+
+  EXPECT_TRUE(dt_.SampleUniform(gen).is_done());
+
+  constexpr unsigned kNumItems = 5000;
+  for (unsigned i = 0; i < kNumItems; ++i) {
+    dt_.Insert(i, i);
+  }
+
+  absl::flat_hash_set<uint64_t> seen;
+  for (unsigned i = 0; i < 3000; ++i) {
+    auto it = dt_.SampleUniform(gen);
+    ASSERT_FALSE(it.is_done());
+    ASSERT_LT(it->first, kNumItems);
+    seen.insert(it->first);
+  }
+
+  // With 3000 uniform draws out of 5000 keys we expect to cover a decent chunk of the
+  // keyspace; a heavily biased sampler would keep returning the same few keys.
+  EXPECT_GT(seen.size(), 1000u);
+}
+
 TEST_F(DashTest, InsertOOM) {
   CappedResource resource(1 << 15);
   Dash64 dt{1, UInt64Policy{}, &resource};
@@ -508,6 +533,30 @@ TEST_F(DashTest, Insert) {
   ASSERT_TRUE(dt_.Find(some_val).is_done());
 }
 
+TEST_F(DashTest, SplitBudgeted) {
+  constexpr size_t kNumItems = 20000;
+  for (size_t i = 0; i < kNumItems; ++i) {
+    dt_.Insert(i, i);
+  }
+
+  unsigned before = dt_.unique_segments();
+  unsigned total = 0;
+
+  // With a low utilization threshold most segments qualify, so budgeted scans must
+  // eventually split them all exactly once.
+  for (unsigned i = 0; i < 1000; ++i) {
+    total += dt_.SplitBudgeted(8, 1, 0.5);
+  }
+
+  EXPECT_GT(total, 0u);
+  EXPECT_EQ(before + total, dt_.unique_segments());
+
+  for (size_t i = 0; i < kNumItems; ++i) {
+    ASSERT_FALSE(dt_.Find(i).is_done());
+  }
+  EXPECT_EQ(kNumItems, dt_.size());
+}
+
 TEST_F(DashTest, Traverse) {
   constexpr auto kNumItems = 50;
   for (size_t i = 0; i < kNumItems; ++i) {
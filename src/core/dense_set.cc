@@ -5,6 +5,7 @@
 #include "core/dense_set.h"
 
 #include <absl/numeric/bits.h>
+#include <absl/random/random.h>
 
 #include <cstddef>
 #include <cstdint>
@@ -74,6 +75,7 @@ DenseSet::~DenseSet() {
   // We can not call Clear from the base class because it internally calls ObjDelete which is
   // a virtual function. Therefore, destructor of the derived classes must clean up the table.
   CHECK(entries_.empty());
+  FreeLinkSlabs();
 }
 
 size_t DenseSet::PushFront(DenseSet::ChainVectorIterator it, void* data, bool has_ttl) {
@@ -164,6 +166,7 @@ void DenseSet::ClearInternal() {
   }
 
   entries_.clear();
+  FreeLinkSlabs();
 }
 
 bool DenseSet::Equal(DensePtr dptr, const void* ptr, uint32_t cookie) const {
@@ -600,16 +603,83 @@ uint32_t DenseSet::Scan(uint32_t cursor, const ItemCb& cb) const {
   return entries_idx << (32 - capacity_log_);
 }
 
+uint32_t DenseSet::Sample(uint32_t count, const ItemCb& cb) const {
+  if (size_ == 0 || count == 0) {
+    return 0;
+  }
+
+  auto& entries = const_cast<DenseSet*>(this)->entries_;
+  const size_t num_buckets = entries.size();
+
+  absl::InsecureBitGen gen;
+  size_t bid = absl::Uniform<size_t>(gen, 0, num_buckets);
+
+  // Every entry hangs off exactly one bucket chain (displaced entries included), so a single
+  // circular pass over the buckets visits each member at most once and emitted members are
+  // distinct.
+  uint32_t emitted = 0;
+  for (size_t visited = 0; visited < num_buckets && emitted < count; ++visited) {
+    DensePtr* curr = &entries[bid];
+    bid = (bid + 1) % num_buckets;
+
+    ExpireIfNeeded(nullptr, curr);
+    while (!curr->IsEmpty() && emitted < count) {
+      cb(curr->GetObject());
+      ++emitted;
+
+      if (!curr->IsLink())
+        break;
+
+      if (ExpireIfNeeded(curr, &curr->AsLink()->next) && !curr->IsLink()) {
+        break;
+      }
+      curr = &curr->AsLink()->next;
+    }
+  }
+
+  return emitted;
+}
+
 auto DenseSet::NewLink(void* data, DensePtr next) -> DenseLinkKey* {
-  LinkAllocator la(mr());
-  DenseLinkKey* lk = la.allocate(1);
-  la.construct(lk);
+  if (free_links_ == nullptr) {
+    AllocLinkSlab();
+  }
+
+  DenseLinkKey* lk = free_links_;
+  free_links_ = (DenseLinkKey*)lk->next.Raw();
 
+  *lk = DenseLinkKey{};
   lk->next = next;
   lk->SetObject(data);
   return lk;
 }
 
+void DenseSet::AllocLinkSlab() {
+  LinkSlab* slab = (LinkSlab*)mr()->allocate(sizeof(LinkSlab), alignof(LinkSlab));
+  slab->next = link_slabs_;
+  link_slabs_ = slab;
+  ++num_link_slabs_;
+
+  // Thread the fresh links through the free list so that they are handed out in
+  // slab order, keeping consecutive allocations adjacent in memory.
+  for (unsigned i = kLinkSlabLinks; i > 0; --i) {
+    DenseLinkKey* lk = &slab->links[i - 1];
+    *lk = DenseLinkKey{};
+    lk->next = DensePtr{free_links_};
+    free_links_ = lk;
+  }
+}
+
+void DenseSet::FreeLinkSlabs() {
+  while (link_slabs_) {
+    LinkSlab* next = link_slabs_->next;
+    mr()->deallocate(link_slabs_, sizeof(LinkSlab), alignof(LinkSlab));
+    link_slabs_ = next;
+  }
+  free_links_ = nullptr;
+  num_link_slabs_ = 0;
+}
+
 bool DenseSet::ExpireIfNeeded(DensePtr* prev, DensePtr* node) const {
   DCHECK(node != nullptr);
 
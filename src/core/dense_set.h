@@ -224,12 +224,26 @@ class DenseSet {
   }
 
   size_t SetMallocUsed() const {
-    return (num_chain_entries_ + entries_.capacity()) * sizeof(DensePtr);
+    return entries_.capacity() * sizeof(DensePtr) + num_link_slabs_ * sizeof(LinkSlab);
   }
 
   using ItemCb = std::function<void(const void*)>;
 
+  // Incremental iteration with split-ordered cursor semantics. The cursor encodes the
+  // home bucket id in its upper capacity_log_ bits, and bucket ids are the upper bits of
+  // the member hash. When the table doubles, bucket b splits into buckets 2b and 2b+1,
+  // both below the doubled cursor, so a cursor obtained before a grow stays valid after
+  // it: a full scan emits every member that was present for its whole duration at least
+  // once and every member at most once, with no duplicates across grows.
   uint32_t Scan(uint32_t cursor, const ItemCb& cb) const;
+
+  // Emits up to count distinct entries chosen by starting at a random bucket and walking
+  // chains of consecutive buckets. Expected O(count) work for well loaded tables; a full
+  // pass over the bucket array bounds the worst case. The choice of entries is random but
+  // not perfectly uniform - members sitting in longer chains are emitted together.
+  // Returns the number of entries emitted.
+  uint32_t Sample(uint32_t count, const ItemCb& cb) const;
+
   void Reserve(size_t sz);
 
   // set an abstract time that allows expiry.
@@ -329,10 +343,25 @@ class DenseSet {
   DenseLinkKey* NewLink(void* data, DensePtr next);
 
   inline void FreeLink(DenseLinkKey* plink) {
-    // deallocate the link if it is no longer a link as it is now in an empty list
-    mr()->deallocate(plink, sizeof(DenseLinkKey), alignof(DenseLinkKey));
+    // the link is no longer used - return it to the arena free list instead of the heap.
+    plink->next = DensePtr{free_links_};
+    free_links_ = plink;
   }
 
+  // Chain links are carved out of fixed-size slabs allocated from mr() instead of being
+  // malloced one by one. Released links are recycled through an intrusive free list
+  // (threaded via DenseLinkKey::next), so sets with long collision chains keep their link
+  // nodes contiguous and chain chases touch fewer cache lines.
+  static constexpr unsigned kLinkSlabLinks = 64;
+
+  struct LinkSlab {
+    LinkSlab* next;
+    DenseLinkKey links[kLinkSlabLinks];
+  };
+
+  void AllocLinkSlab();
+  void FreeLinkSlabs();
+
   // Returns true if *ptr was deleted.
   bool ExpireIfNeeded(DensePtr* prev, DensePtr* ptr) const;
 
@@ -342,6 +371,10 @@ class DenseSet {
 
   std::vector<DensePtr, DensePtrAllocator> entries_;
 
+  LinkSlab* link_slabs_ = nullptr;
+  DenseLinkKey* free_links_ = nullptr;
+  uint32_t num_link_slabs_ = 0;
+
   mutable size_t obj_malloc_used_ = 0;
   mutable uint32_t size_ = 0;
   mutable uint32_t num_chain_entries_ = 0;
@@ -36,7 +36,7 @@ void ExtentTree::Add(size_t start, size_t len) {
       merged = true;
       len_extents_.erase(pair{prev->second - prev->first, prev->first});
 
-      if (end == it->first) {  // [first, end = it->first, it->second)
+      if (it != extents_.end() && end == it->first) {  // [first, end = it->first, it->second)
         prev->second = it->second;
         len_extents_.erase(pair{it->second - it->first, it->first});
         extents_.erase(it);
@@ -48,7 +48,7 @@ void ExtentTree::Add(size_t start, size_t len) {
   }
 
   if (!merged) {
-    if (end == it->first) {  // [start, end), [it->first, it->second]
+    if (it != extents_.end() && end == it->first) {  // [start, end), [it->first, it->second]
       len_extents_.erase(pair{it->second - it->first, it->first});
       end = it->second;
       extents_.erase(it);
@@ -346,7 +346,47 @@ int64_t ExternalAllocator::Malloc(size_t sz) {
   return seg->BlockOffset(page, pos);
 }
 
+int64_t ExternalAllocator::MallocSequential(size_t sz) {
+  constexpr size_t kSeqRegionSize = 1_MB;
+
+  size_t chunk_sz = GoodSize(sz);
+  if (chunk_sz > kSeqRegionSize)
+    return LargeMalloc(sz);  // too big to pack into the active region.
+
+  if (seq_start_ + chunk_sz > seq_end_) {
+    // Return the unused tail of the previous region and reserve a fresh one.
+    if (seq_end_ > seq_start_)
+      extent_tree_.Add(seq_start_, seq_end_ - seq_start_);
+    seq_start_ = seq_end_ = 0;
+
+    auto op_range = extent_tree_.GetRange(kSeqRegionSize, 4_KB);
+    if (!op_range)
+      return -int64_t(kSegmentSize);
+
+    seq_start_ = op_range->first;
+    seq_end_ = op_range->second;
+  }
+
+  size_t res = seq_start_;
+  seq_start_ += chunk_sz;
+  allocated_bytes_ += chunk_sz;
+  large_allocs_.emplace(res, chunk_sz);
+
+  return res;
+}
+
 void ExternalAllocator::Free(size_t offset, size_t sz) {
+  // Large allocations have no segment descriptor - their ranges go back to the extent tree.
+  auto lit = large_allocs_.find(offset);
+  if (lit != large_allocs_.end()) {
+    DCHECK_LE(sz, lit->second);
+
+    extent_tree_.Add(offset, lit->second);
+    allocated_bytes_ -= lit->second;
+    large_allocs_.erase(lit);
+    return;
+  }
+
   size_t idx = offset / 256_MB;
   size_t delta = offset % 256_MB;
   CHECK_LT(idx, segments_.size());
@@ -390,6 +430,25 @@ size_t ExternalAllocator::GoodSize(size_t sz) {
   return alignup(sz, 4_KB);
 }
 
+unsigned ExternalAllocator::PageFill(size_t offset) const {
+  if (large_allocs_.contains(offset))
+    return 100;
+
+  size_t idx = offset / 256_MB;
+  CHECK_LT(idx, segments_.size());
+
+  SegmentDescr* seg = segments_[idx];
+  CHECK(seg);
+
+  unsigned page_id = (offset % 256_MB) >> seg->page_shift();
+  CHECK_LT(page_id, seg->capacity());
+
+  const Page* page = seg->GetPage(page_id);
+  unsigned blocks_num = (1 << seg->page_shift()) / ToBlockSize(page->block_size_bin);
+
+  return (blocks_num - page->available) * 100 / blocks_num;
+}
+
 /**
  *
   _____      _            _          __                  _   _
@@ -455,6 +514,9 @@ int64_t ExternalAllocator::LargeMalloc(size_t size) {
     return -int64_t(align_sz);
   }
 
+  allocated_bytes_ += align_sz;
+  large_allocs_.emplace(op_range->first, align_sz);
+
   return op_range->first;
 }
 
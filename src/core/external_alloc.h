@@ -69,6 +69,11 @@ class ExternalAllocator {
   // size sz.
   int64_t Malloc(size_t sz);
 
+  // Like Malloc but hands out offsets sequentially from a 1MB region reserved upfront,
+  // turning the write stream into sequential io. Blocks are sized by GoodSize and can be
+  // released with the regular Free.
+  int64_t MallocSequential(size_t sz);
+
   void Free(size_t offset, size_t sz);
 
   /// Adds backing storage to the allocator. The range should not overlap with already
@@ -80,6 +85,11 @@ class ExternalAllocator {
   // No allocation is done.
   static size_t GoodSize(size_t sz);
 
+  // Returns the percentage (0-100) of used blocks in the page holding the block at offset.
+  // Large allocations occupy their range fully and always report 100.
+  // Allows defragmentation logic to pick relocation victims residing on sparse pages.
+  unsigned PageFill(size_t offset) const;
+
   size_t capacity() const {
     return capacity_;
   }
@@ -108,6 +118,13 @@ class ExternalAllocator {
   // A segment for each 256MB range. To get a segment id from the offset, shift right by 28.
   std::vector<SegmentDescr*> segments_;
 
+  // Large allocations are carved directly from extent_tree_ and have no segment descriptor,
+  // so we keep their sizes here: offset -> aligned size.
+  absl::btree_map<size_t, size_t> large_allocs_;
+
+  // The active region that MallocSequential carves its blocks from.
+  size_t seq_start_ = 0, seq_end_ = 0;
+
   ExtentTree extent_tree_;
 
   size_t capacity_ = 0;  // in bytes.
@@ -117,4 +117,39 @@ TEST_F(ExternalAllocatorTest, Classes) {
   EXPECT_EQ(1_MB + 4_KB, ExternalAllocator::GoodSize(1_MB + 1));
 }
 
+TEST_F(ExternalAllocatorTest, Sequential) {
+  ext_alloc_.AddStorage(0, kSegSize);
+
+  constexpr size_t kAllocSize = 5000;
+  off_t offs1 = ext_alloc_.MallocSequential(kAllocSize);
+  off_t offs2 = ext_alloc_.MallocSequential(kAllocSize);
+  ASSERT_GE(offs1, 0);
+
+  // Consecutive allocations are laid out back to back.
+  EXPECT_EQ(offs1 + off_t(ExternalAllocator::GoodSize(kAllocSize)), offs2);
+
+  ext_alloc_.Free(offs1, kAllocSize);
+  ext_alloc_.Free(offs2, kAllocSize);
+  EXPECT_EQ(0u, ext_alloc_.allocated_bytes());
+}
+
+TEST_F(ExternalAllocatorTest, Large) {
+  ext_alloc_.AddStorage(0, kSegSize);
+
+  constexpr size_t kAllocSize = 2_MB + 1;
+  size_t allocated = ext_alloc_.allocated_bytes();
+
+  off_t offs = ext_alloc_.Malloc(kAllocSize);
+  ASSERT_GE(offs, 0);
+  EXPECT_EQ(allocated + ExternalAllocator::GoodSize(kAllocSize), ext_alloc_.allocated_bytes());
+
+  ext_alloc_.Free(offs, kAllocSize);
+  EXPECT_EQ(allocated, ext_alloc_.allocated_bytes());
+
+  // The freed range merges back into the extent tree and can be reallocated.
+  off_t offs2 = ext_alloc_.Malloc(kAllocSize);
+  EXPECT_EQ(offs, offs2);
+  ext_alloc_.Free(offs2, kAllocSize);
+}
+
 }  // namespace dfly
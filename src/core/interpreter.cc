@@ -5,10 +5,14 @@
 #include "core/interpreter.h"
 
 #include <absl/container/fixed_array.h>
+#include <absl/container/inlined_vector.h>
 #include <absl/strings/str_cat.h>
 #include <absl/time/clock.h>
 #include <openssl/evp.h>
 
+#include <cmath>
+#include <jsoncons/json.hpp>
+
 #include <cstring>
 #include <optional>
 #include <regex>
@@ -224,6 +228,303 @@ void LoadLibrary(lua_State* lua, const char* libname, lua_CFunction luafunc) {
   lua_call(lua, 1, 0);
 }
 
+// Builds Lua values directly from the JSON parser event stream without materializing an
+// intermediate DOM. The root value is left on top of the Lua stack.
+class LuaJsonVisitor final : public jsoncons::default_json_visitor {
+ public:
+  explicit LuaJsonVisitor(lua_State* lua) : lua_(lua) {
+  }
+
+ private:
+  using string_view_type = jsoncons::default_json_visitor::string_view_type;
+
+  bool visit_begin_object(jsoncons::semantic_tag, const jsoncons::ser_context&,
+                          std::error_code& ec) override {
+    if (!ReserveStack(&ec))
+      return false;
+    lua_createtable(lua_, 0, 4);
+    scopes_.push_back(0);  // zero marks an object scope.
+    return true;
+  }
+
+  bool visit_end_object(const jsoncons::ser_context&, std::error_code&) override {
+    scopes_.pop_back();
+    SetInParent();
+    return true;
+  }
+
+  bool visit_begin_array(jsoncons::semantic_tag, const jsoncons::ser_context&,
+                         std::error_code& ec) override {
+    if (!ReserveStack(&ec))
+      return false;
+    lua_createtable(lua_, 4, 0);
+    scopes_.push_back(1);  // the next array index to assign.
+    return true;
+  }
+
+  bool visit_end_array(const jsoncons::ser_context&, std::error_code&) override {
+    scopes_.pop_back();
+    SetInParent();
+    return true;
+  }
+
+  bool visit_key(const string_view_type& key, const jsoncons::ser_context&,
+                 std::error_code&) override {
+    lua_pushlstring(lua_, key.data(), key.size());
+    return true;
+  }
+
+  bool visit_string(const string_view_type& value, jsoncons::semantic_tag,
+                    const jsoncons::ser_context&, std::error_code&) override {
+    lua_pushlstring(lua_, value.data(), value.size());
+    SetInParent();
+    return true;
+  }
+
+  // Like the cjson module, all numbers decode into lua_Number so that scripts observe
+  // identical tostring() formatting.
+  bool visit_int64(int64_t value, jsoncons::semantic_tag, const jsoncons::ser_context&,
+                   std::error_code&) override {
+    lua_pushnumber(lua_, static_cast<lua_Number>(value));
+    SetInParent();
+    return true;
+  }
+
+  bool visit_uint64(uint64_t value, jsoncons::semantic_tag, const jsoncons::ser_context&,
+                    std::error_code&) override {
+    lua_pushnumber(lua_, static_cast<lua_Number>(value));
+    SetInParent();
+    return true;
+  }
+
+  bool visit_double(double value, jsoncons::semantic_tag, const jsoncons::ser_context&,
+                    std::error_code&) override {
+    lua_pushnumber(lua_, value);
+    SetInParent();
+    return true;
+  }
+
+  bool visit_bool(bool value, jsoncons::semantic_tag, const jsoncons::ser_context&,
+                  std::error_code&) override {
+    lua_pushboolean(lua_, value);
+    SetInParent();
+    return true;
+  }
+
+  bool visit_null(jsoncons::semantic_tag, const jsoncons::ser_context&,
+                  std::error_code&) override {
+    lua_pushlightuserdata(lua_, nullptr);  // cjson.null
+    SetInParent();
+    return true;
+  }
+
+  // Assigns the completed value on top of the Lua stack into the enclosing container,
+  // if any. For object scopes the key was already pushed by visit_key.
+  void SetInParent() {
+    if (scopes_.empty())
+      return;  // the root value stays on the stack.
+    int64_t& index = scopes_.back();
+    if (index > 0) {
+      lua_rawseti(lua_, -2, index++);
+    } else {
+      lua_rawset(lua_, -3);
+    }
+  }
+
+  bool ReserveStack(std::error_code* ec) {
+    // Each nesting level holds at most a table and a pending key.
+    if (lua_checkstack(lua_, 4))
+      return true;
+    *ec = jsoncons::json_errc::max_nesting_depth_exceeded;
+    return false;
+  }
+
+  lua_State* lua_;
+  absl::InlinedVector<int64_t, 16> scopes_;
+};
+
+constexpr unsigned kJsonEncodeMaxDepth = 1000;
+
+void AppendJsonString(string* out, string_view str) {
+  out->push_back('"');
+  for (char c : str) {
+    switch (c) {
+      case '"':
+        out->append("\\\"");
+        break;
+      case '\\':
+        out->append("\\\\");
+        break;
+      case '\b':
+        out->append("\\b");
+        break;
+      case '\f':
+        out->append("\\f");
+        break;
+      case '\n':
+        out->append("\\n");
+        break;
+      case '\r':
+        out->append("\\r");
+        break;
+      case '\t':
+        out->append("\\t");
+        break;
+      default:
+        if (uint8_t(c) < 0x20)
+          absl::StrAppendFormat(out, "\\u%04x", c);
+        else
+          out->push_back(c);
+    }
+  }
+  out->push_back('"');
+}
+
+void AppendJsonNumber(string* out, lua_State* lua, int idx) {
+  if (lua_isinteger(lua, idx))
+    absl::StrAppend(out, lua_tointeger(lua, idx));
+  else
+    absl::StrAppendFormat(out, "%.14g", lua_tonumber(lua, idx));  // cjson precision.
+}
+
+// Serializes the Lua value on top of the stack, leaving the stack unchanged.
+// Returns false for values that have no JSON representation.
+bool EncodeLuaValue(lua_State* lua, string* out, unsigned depth) {
+  if (depth > kJsonEncodeMaxDepth || !lua_checkstack(lua, 4))
+    return false;
+
+  switch (lua_type(lua, -1)) {
+    case LUA_TNIL:
+      out->append("null");
+      return true;
+    case LUA_TBOOLEAN:
+      out->append(lua_toboolean(lua, -1) ? "true" : "false");
+      return true;
+    case LUA_TNUMBER: {
+      lua_Number num = lua_tonumber(lua, -1);
+      if (!std::isfinite(num))
+        return false;  // like cjson, refuse NaN and infinity.
+      AppendJsonNumber(out, lua, -1);
+      return true;
+    }
+    case LUA_TSTRING: {
+      size_t len;
+      const char* str = lua_tolstring(lua, -1, &len);
+      AppendJsonString(out, {str, len});
+      return true;
+    }
+    case LUA_TLIGHTUSERDATA:
+      if (lua_touserdata(lua, -1) == nullptr) {  // cjson.null
+        out->append("null");
+        return true;
+      }
+      return false;
+    case LUA_TTABLE:
+      break;
+    default:
+      return false;
+  }
+
+  // A table is an array if its keys are exactly 1..n, otherwise an object.
+  size_t arr_len = lua_rawlen(lua, -1);
+  size_t key_count = 0;
+  bool all_int_keys = true;
+  for (lua_pushnil(lua); lua_next(lua, -2); lua_pop(lua, 1)) {
+    ++key_count;
+    if (!lua_isinteger(lua, -2))
+      all_int_keys = false;
+  }
+
+  if (key_count == 0) {  // like cjson, an empty table encodes as an empty object.
+    out->append("{}");
+    return true;
+  }
+
+  if (all_int_keys && key_count == arr_len) {
+    out->push_back('[');
+    for (size_t i = 1; i <= arr_len; ++i) {
+      if (i > 1)
+        out->push_back(',');
+      lua_rawgeti(lua, -1, i);
+      bool ok = EncodeLuaValue(lua, out, depth + 1);
+      lua_pop(lua, 1);
+      if (!ok)
+        return false;
+    }
+    out->push_back(']');
+    return true;
+  }
+
+  out->push_back('{');
+  bool first = true;
+  for (lua_pushnil(lua); lua_next(lua, -2); lua_pop(lua, 1)) {
+    if (!first)
+      out->push_back(',');
+    first = false;
+
+    // Like cjson, numeric keys are converted to strings, other non-string keys are refused.
+    // The key is not converted in place since that would confuse lua_next.
+    if (lua_type(lua, -2) == LUA_TSTRING) {
+      size_t len;
+      const char* str = lua_tolstring(lua, -2, &len);
+      AppendJsonString(out, {str, len});
+    } else if (lua_type(lua, -2) == LUA_TNUMBER) {
+      out->push_back('"');
+      AppendJsonNumber(out, lua, -2);
+      out->push_back('"');
+    } else {
+      lua_pop(lua, 2);
+      return false;
+    }
+    out->push_back(':');
+
+    if (!EncodeLuaValue(lua, out, depth + 1)) {
+      lua_pop(lua, 2);
+      return false;
+    }
+  }
+  out->push_back('}');
+  return true;
+}
+
+int CJsonDecode(lua_State* lua) {
+  size_t len;
+  const char* str = luaL_checklstring(lua, 1, &len);
+
+  int top = lua_gettop(lua);
+  char errbuf[100] = {0};
+  {
+    LuaJsonVisitor visitor(lua);
+    jsoncons::json_parser parser;
+    std::error_code ec;
+
+    parser.update(string_view{str, len});
+    parser.finish_parse(visitor, ec);
+    if (!ec && lua_gettop(lua) == top + 1)
+      return 1;
+
+    snprintf(errbuf, sizeof(errbuf) - 1, "invalid JSON: %s",
+             ec ? ec.message().c_str() : "no value");
+    lua_settop(lua, top);
+  }
+  return luaL_error(lua, "%s", errbuf);
+}
+
+int CJsonEncode(lua_State* lua) {
+  luaL_checkany(lua, 1);
+  lua_settop(lua, 1);
+
+  // Reused across calls so repeatedly encoding payloads does not reallocate.
+  static thread_local string buffer;
+  buffer.clear();
+
+  if (!EncodeLuaValue(lua, &buffer, 0))
+    return luaL_error(lua, "Cannot serialise value to JSON");
+
+  lua_pushlstring(lua, buffer.data(), buffer.size());
+  return 1;
+}
+
 void InitLua(lua_State* lua) {
   Require(lua, "", luaopen_base);
   Require(lua, LUA_TABLIBNAME, luaopen_table);
@@ -233,6 +534,16 @@ void InitLua(lua_State* lua) {
 
   LoadLibrary(lua, "cjson", luaopen_cjson);
   LoadLibrary(lua, "struct", luaopen_struct);
+
+  // Replace the scalar cjson codec: decode builds Lua tables directly from the streaming
+  // parser events and encode writes into a buffer that is reused across calls.
+  lua_getglobal(lua, "cjson");
+  CHECK(lua_istable(lua, -1));
+  lua_pushcfunction(lua, CJsonDecode);
+  lua_setfield(lua, -2, "decode");
+  lua_pushcfunction(lua, CJsonEncode);
+  lua_setfield(lua, -2, "encode");
+  lua_pop(lua, 1);
   LoadLibrary(lua, "cmsgpack", luaopen_cmsgpack);
   LoadLibrary(lua, "bit", luaopen_bit);
 
@@ -384,6 +695,11 @@ Interpreter::Interpreter() {
   lua_pushcfunction(lua_, RedisAPCallCommand);
   lua_settable(lua_, -3);
 
+  /* redis.pcall_many */
+  lua_pushstring(lua_, "pcall_many");
+  lua_pushcfunction(lua_, RedisPCallManyCommand);
+  lua_settable(lua_, -3);
+
   lua_pushstring(lua_, "sha1hex");
   lua_pushcfunction(lua_, RedisSha1Command);
   lua_settable(lua_, -3);
@@ -412,7 +728,8 @@ void Interpreter::FuncSha1(string_view body, char* fp) {
   ToHex(digest, fp);
 }
 
-auto Interpreter::AddFunction(string_view sha, string_view body, string* result) -> AddResult {
+auto Interpreter::AddFunction(string_view sha, string_view body, string* result,
+                              string* bytecode) -> AddResult {
   char funcname[43];
   funcname[0] = 'f';
   funcname[1] = '_';
@@ -423,12 +740,40 @@ auto Interpreter::AddFunction(string_view sha, string_view body, string* result)
   int type = lua_getglobal(lua_, funcname);
   lua_pop(lua_, 1);
 
-  if (type == LUA_TNIL && !AddInternal(funcname, body, result))
+  if (type == LUA_TNIL && !AddInternal(funcname, body, result, bytecode))
     return COMPILE_ERR;
 
   return type == LUA_TNIL ? ADD_OK : ALREADY_EXISTS;
 }
 
+auto Interpreter::AddCompiledFunction(string_view sha, string_view bytecode, string* result)
+    -> AddResult {
+  char funcname[43];
+  funcname[0] = 'f';
+  funcname[1] = '_';
+  DCHECK(sha.size() == 40);
+  memcpy(funcname + 2, sha.data(), sha.size());
+  funcname[42] = '\0';
+
+  int type = lua_getglobal(lua_, funcname);
+  lua_pop(lua_, 1);
+  if (type != LUA_TNIL)
+    return ALREADY_EXISTS;
+
+  // luaL_loadbuffer recognizes the precompiled chunk by its signature.
+  int res = luaL_loadbuffer(lua_, bytecode.data(), bytecode.size(), "@user_script");
+  if (res == 0)
+    res = lua_pcall(lua_, 0, 0, 0);  // run func definition code
+
+  if (res) {
+    result->assign(lua_tostring(lua_, -1));
+    lua_pop(lua_, 1);  // Remove the error.
+    return COMPILE_ERR;
+  }
+
+  return ADD_OK;
+}
+
 bool Interpreter::Exists(string_view sha) const {
   if (sha.size() != 40)
     return false;
@@ -565,11 +910,22 @@ bool Interpreter::IsResultSafe() const {
   return res;
 }
 
-bool Interpreter::AddInternal(const char* f_id, string_view body, string* error) {
+bool Interpreter::AddInternal(const char* f_id, string_view body, string* error,
+                              string* bytecode) {
   string script = absl::StrCat("function ", f_id, "() \n");
   absl::StrAppend(&script, body, "\nend");
 
   int res = luaL_loadbuffer(lua_, script.data(), script.size(), "@user_script");
+
+  // Dump the compiled chunk before running it, lua_dump leaves the function on the stack.
+  if (res == 0 && bytecode != nullptr) {
+    lua_Writer writer = [](lua_State*, const void* chunk, size_t size, void* data) -> int {
+      static_cast<string*>(data)->append(static_cast<const char*>(chunk), size);
+      return 0;
+    };
+    lua_dump(lua_, writer, bytecode, 0);
+  }
+
   if (res == 0) {
     res = lua_pcall(lua_, 0, 0, 0);  // run func definition code
   }
@@ -808,6 +1164,131 @@ int Interpreter::RedisGenericCommand(bool raise_error, bool async) {
   return 1;
 }
 
+bool Interpreter::MarshalStackArgs(int first, int last, string* buffer,
+                                   vector<MutableSlice>* args) {
+  size_t blob_len = 0;
+  char tmpbuf[64];
+
+  for (int idx = first; idx <= last; idx++) {
+    switch (lua_type(lua_, idx)) {
+      case LUA_TNUMBER:
+        if (lua_isinteger(lua_, idx)) {
+          blob_len += absl::AlphaNum{lua_tointeger(lua_, idx)}.size();
+        } else {
+          int fmt_len = absl::SNPrintF(tmpbuf, sizeof(tmpbuf), "%.17g", lua_tonumber(lua_, idx));
+          CHECK_GT(fmt_len, 0);
+          blob_len += fmt_len;
+        }
+        continue;
+      case LUA_TSTRING:
+        blob_len += lua_rawlen(lua_, idx);
+        continue;
+      default:
+        return false;
+    }
+  }
+
+  buffer->assign(blob_len + 4, '\0');
+  args->resize(last - first + 1);
+
+  char* cur = buffer->data();
+  char* end = cur + blob_len;
+
+  for (int idx = first; idx <= last; idx++) {
+    size_t len = 0;
+    switch (lua_type(lua_, idx)) {
+      case LUA_TNUMBER:
+        if (lua_isinteger(lua_, idx)) {
+          char* next = absl::numbers_internal::FastIntToBuffer(lua_tointeger(lua_, idx), cur);
+          len = next - cur;
+        } else if (lua_isnumber(lua_, idx)) {
+          int fmt_len = absl::SNPrintF(cur, end - cur + 1, "%.17g", lua_tonumber(lua_, idx));
+          CHECK_GT(fmt_len, 0);
+          len = fmt_len;
+        }
+        break;
+      case LUA_TSTRING:
+        len = lua_rawlen(lua_, idx);
+        memcpy(cur, lua_tostring(lua_, idx), len);
+    };
+
+    (*args)[idx - first] = {cur, len};
+    cur += len;
+  }
+
+  return true;
+}
+
+int Interpreter::RedisManyCommand() {
+  if (cmd_depth_) {
+    PushError(lua_, "pcall_many() recursive call detected");
+    return 1;
+  }
+
+  if (!redis_func_) {
+    PushError(lua_, "internal error - redis function not defined");
+    return 1;
+  }
+
+  int argc = lua_gettop(lua_);
+  if (argc == 0) {
+    PushError(lua_, "Please specify at least one command for redis.pcall_many()");
+    return 1;
+  }
+
+  for (int i = 1; i <= argc; i++) {
+    if (lua_type(lua_, i) != LUA_TTABLE) {
+      PushError(lua_, "redis.pcall_many() arguments must be tables");
+      return 1;
+    }
+  }
+
+  // Marshal all commands up front, so the stack holds no intermediates
+  // once the callback starts pushing replies.
+  vector<string> buffers(argc);
+  vector<vector<MutableSlice>> cmd_args(argc);
+  for (int i = 1; i <= argc; i++) {
+    int len = lua_rawlen(lua_, i);
+    CHECK(lua_checkstack(lua_, len + 2));
+
+    int top = lua_gettop(lua_);
+    for (int j = 1; j <= len; j++)
+      lua_rawgeti(lua_, i, j);
+
+    bool ok = len > 0 && MarshalStackArgs(top + 1, top + len, &buffers[i - 1], &cmd_args[i - 1]);
+    lua_settop(lua_, top);
+
+    if (!ok) {
+      PushError(lua_, "Lua redis() command arguments must be strings or integers");
+      return 1;
+    }
+  }
+
+  cmd_depth_++;
+  lua_pop(lua_, argc);
+  RedisTranslator translator(lua_);
+  bool abort = false;
+
+  // Queue all commands, then flush them as one squashed batch whose replies
+  // form the resulting array.
+  for (int i = 0; i < argc && !abort; i++) {
+    CallArgs ca{MutSliceSpan{cmd_args[i]}, &buffers[i], &translator, false, false, &abort};
+    ca.many_queued = true;
+    redis_func_(ca);
+  }
+
+  if (!abort) {
+    CallArgs ca{MutSliceSpan{}, nullptr, &translator, false, false, &abort};
+    ca.many_flush = true;
+    redis_func_(ca);
+  }
+
+  cmd_depth_--;
+
+  DCHECK_EQ(1, lua_gettop(lua_));
+  return 1;
+}
+
 int Interpreter::RedisCallCommand(lua_State* lua) {
   void** ptr = static_cast<void**>(lua_getextraspace(lua));
   return reinterpret_cast<Interpreter*>(*ptr)->RedisGenericCommand(true, false);
@@ -828,6 +1309,11 @@ int Interpreter::RedisAPCallCommand(lua_State* lua) {
   return reinterpret_cast<Interpreter*>(*ptr)->RedisGenericCommand(false, true);
 }
 
+int Interpreter::RedisPCallManyCommand(lua_State* lua) {
+  void** ptr = static_cast<void**>(lua_getextraspace(lua));
+  return reinterpret_cast<Interpreter*>(*ptr)->RedisManyCommand();
+}
+
 Interpreter* InterpreterManager::Get() {
   // Grow if none is available and we have unused capacity left.
   if (available_.empty() && storage_.size() < storage_.capacity()) {
@@ -7,6 +7,7 @@
 #include <functional>
 #include <optional>
 #include <string_view>
+#include <vector>
 
 #include "core/core_types.h"
 #include "core/fibers.h"
@@ -50,6 +51,11 @@ class Interpreter {
     // The function can request an abort due to an error, even if error_abort is false.
     // It happens when async cmds are flushed and result in an uncatched error.
     bool* requested_abort;
+
+    // Used by pcall_many: queue the command with full reply capture / execute the
+    // queued batch squashed and reply with an array of all results.
+    bool many_queued = false;
+    bool many_flush = false;
   };
 
   using RedisFunc = std::function<void(CallArgs)>;
@@ -75,8 +81,15 @@ class Interpreter {
     COMPILE_ERR = 2,
   };
 
-  // Add function with sha and body to interpreter.
-  AddResult AddFunction(std::string_view sha, std::string_view body, std::string* error);
+  // Add function with sha and body to interpreter. If bytecode is set, the compiled
+  // chunk is dumped into it, loadable with AddCompiledFunction on other interpreters.
+  AddResult AddFunction(std::string_view sha, std::string_view body, std::string* error,
+                        std::string* bytecode = nullptr);
+
+  // Add function with sha from a chunk previously dumped by AddFunction, skipping
+  // the source parse and compile steps.
+  AddResult AddCompiledFunction(std::string_view sha, std::string_view bytecode,
+                                std::string* error);
 
   bool Exists(std::string_view sha) const;
 
@@ -116,16 +129,27 @@ class Interpreter {
  private:
   // Returns true if function was successfully added,
   // otherwise returns false and sets the error.
-  bool AddInternal(const char* f_id, std::string_view body, std::string* error);
+  bool AddInternal(const char* f_id, std::string_view body, std::string* error,
+                   std::string* bytecode);
   bool IsTableSafe() const;
 
   int RedisGenericCommand(bool raise_error, bool async);
   int RedisACallErrorsCommand();
 
+  // Implements redis.pcall_many: each argument is a table with one command,
+  // all of them are executed in a single batch.
+  int RedisManyCommand();
+
+  // Marshals the values at stack positions [first, last] into buffer-backed arg slices.
+  // Returns false if a value is neither a string nor a number.
+  bool MarshalStackArgs(int first, int last, std::string* buffer,
+                        std::vector<MutableSlice>* args);
+
   static int RedisCallCommand(lua_State* lua);
   static int RedisPCallCommand(lua_State* lua);
   static int RedisACallCommand(lua_State* lua);
   static int RedisAPCallCommand(lua_State* lua);
+  static int RedisPCallManyCommand(lua_State* lua);
 
   lua_State* lua_;
   unsigned cmd_depth_ = 0;
@@ -223,6 +223,30 @@ TEST_F(InterpreterTest, Add) {
   EXPECT_TRUE(intptr_.Exists(sha1));
 }
 
+TEST_F(InterpreterTest, AddCompiled) {
+  const char* s1 = "return 42";
+
+  char sha_buf[64];
+  Interpreter::FuncSha1(s1, sha_buf);
+  string_view sha{sha_buf, std::strlen(sha_buf)};
+
+  string err, bytecode;
+  EXPECT_EQ(Interpreter::ADD_OK, intptr_.AddFunction(sha, s1, &err, &bytecode));
+  EXPECT_GT(bytecode.size(), 0u);
+
+  // A second interpreter picks up the function from the compiled chunk alone.
+  Interpreter intptr2;
+  EXPECT_EQ(Interpreter::ADD_OK, intptr2.AddCompiledFunction(sha, bytecode, &err));
+  EXPECT_TRUE(intptr2.Exists(sha));
+  EXPECT_EQ(Interpreter::ALREADY_EXISTS, intptr2.AddCompiledFunction(sha, bytecode, &err));
+
+  EXPECT_EQ(Interpreter::RUN_OK, intptr2.RunFunction(sha, &err));
+
+  TestSerializer ser;
+  intptr2.SerializeResult(&ser);
+  EXPECT_EQ("i(42) ", ser.res);
+}
+
 // Test cases taken from scripting.tcl
 TEST_F(InterpreterTest, Execute) {
   ASSERT_TRUE(Execute("return 42"));
@@ -340,6 +364,29 @@ TEST_F(InterpreterTest, Modules) {
   EXPECT_EQ("str(\x1\x2test)", ser_.res);
 }
 
+TEST_F(InterpreterTest, CJson) {
+  // Nested documents decode into nested tables.
+  EXPECT_TRUE(
+      Execute("local t = cjson.decode('{\"a\": [1, 2.5, \"x\"], \"b\": {\"c\": true}}') "
+              "return {t.a[1], t.a[2], t.a[3], t.b.c}"));
+  EXPECT_EQ("[d(1) d(2.5) str(x) bool(1)]", ser_.res);
+
+  // null round-trips as cjson.null.
+  EXPECT_TRUE(Execute("return cjson.encode({1, cjson.null, 'a'})"));
+  EXPECT_EQ("str([1,null,\"a\"])", ser_.res);
+
+  // Objects and string escaping survive an encode/decode round trip.
+  EXPECT_TRUE(Execute("return cjson.decode(cjson.encode({a = 'x\\ny\"z'})).a"));
+  EXPECT_EQ("str(x\ny\"z)", ser_.res);
+
+  EXPECT_TRUE(Execute("return cjson.encode({})"));
+  EXPECT_EQ("str({})", ser_.res);
+
+  // Invalid documents and trailing garbage raise an error.
+  EXPECT_FALSE(Execute("return cjson.decode('{invalid')"));
+  EXPECT_FALSE(Execute("return cjson.decode('[1] tail')"));
+}
+
 // Check compatibility with Lua 5.1
 TEST_F(InterpreterTest, Compatibility) {
   // unpack is no longer global
@@ -8,6 +8,7 @@ extern "C" {
 #include "redis/zmalloc.h"
 }
 #include <jsoncons/json.hpp>
+#include <jsoncons_ext/cbor/cbor.hpp>
 
 #include "base/logging.h"
 
@@ -34,4 +35,25 @@ std::optional<JsonType> JsonFromString(std::string_view input) {
   return {};
 }
 
+std::string JsonToCbor(const JsonType& json) {
+  std::string blob;
+  jsoncons::cbor::encode_cbor(json, blob);
+  return blob;
+}
+
+std::optional<JsonType> JsonFromCbor(std::string_view blob) {
+  using namespace jsoncons;
+
+  std::error_code ec;
+  json_decoder<JsonType> decoder;
+  cbor::basic_cbor_reader<bytes_source> reader(bytes_source{blob}, decoder);
+  reader.read(ec);
+
+  if (ec || !decoder.is_valid()) {
+    VLOG(1) << "Error while decode CBOR: " << ec.message();
+    return {};
+  }
+  return decoder.get_result();
+}
+
 }  // namespace dfly
@@ -33,4 +33,10 @@ using JsonType = jsoncons::basic_json<char, jsoncons::sorted_policy, std::alloca
 // Build a json object from string. If the string is not legal json, will return nullopt
 std::optional<JsonType> JsonFromString(std::string_view input);
 
+// Encode a json object into the compact CBOR binary form used for off-heap storage.
+std::string JsonToCbor(const JsonType& json);
+
+// Decode a blob produced by JsonToCbor. If the blob is corrupt, will return nullopt
+std::optional<JsonType> JsonFromCbor(std::string_view blob);
+
 }  // namespace dfly
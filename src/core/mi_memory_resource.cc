@@ -7,6 +7,8 @@
 
 namespace dfly {
 
+thread_local int64_t* MiMemoryResource::tl_alloc_sink = nullptr;
+
 void* MiMemoryResource::do_allocate(std::size_t size, std::size_t align) {
   DCHECK(align);
 
@@ -23,6 +25,8 @@ void* MiMemoryResource::do_allocate(std::size_t size, std::size_t align) {
   size_t delta = mi_usable_size(res);
 
   used_ += delta;
+  if (tl_alloc_sink)
+    *tl_alloc_sink += delta;
   DVLOG(1) << "do_allocate: " << heap_ << " " << delta;
 
   return res;
@@ -37,6 +41,8 @@ void MiMemoryResource::do_deallocate(void* ptr, std::size_t size, std::size_t al
 
   DCHECK_GE(used_, size);
   used_ -= usable;
+  if (tl_alloc_sink)
+    *tl_alloc_sink -= usable;
   mi_free_size_aligned(ptr, size, align);
 }
 
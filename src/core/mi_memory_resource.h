@@ -29,6 +29,14 @@ class MiMemoryResource : public PMR_NS::memory_resource {
     return used_;
   }
 
+  // Opt-in allocation attribution: while a sink is installed for the calling thread, the
+  // net change in usable bytes of every MiMemoryResource allocation made on this thread is
+  // also added to *sink. Costs a single thread-local check when no sink is installed.
+  // Pass nullptr to uninstall.
+  static void SetAllocationSink(int64_t* sink) {
+    tl_alloc_sink = sink;
+  }
+
  private:
   void* do_allocate(std::size_t size, std::size_t align) final;
 
@@ -40,6 +48,8 @@ class MiMemoryResource : public PMR_NS::memory_resource {
 
   mi_heap_t* heap_;
   size_t used_ = 0;
+
+  static thread_local int64_t* tl_alloc_sink;
 };
 
 }  // namespace dfly
@@ -0,0 +1,113 @@
+// Copyright 2023, DragonflyDB authors.  All rights reserved.
+// See LICENSE for licensing terms.
+//
+
+#include "core/score_map.h"
+
+#include <absl/base/casts.h>
+
+#include "base/endian.h"
+#include "base/logging.h"
+#include "core/compact_object.h"
+#include "core/sds_utils.h"
+
+extern "C" {
+#include "redis/zmalloc.h"
+}
+
+using namespace std;
+
+namespace dfly {
+
+ScoreMap::~ScoreMap() {
+  Clear();
+}
+
+sds ScoreMap::AddUnique(string_view field, double value) {
+  if (FindInternal(&field, 1))  // 1 - string_view
+    return nullptr;
+
+  // The layout is:
+  // field, '\0', 8-byte double score.
+  sds newkey = AllocSdsWithSpace(field.size(), 8);
+  if (!field.empty()) {
+    memcpy(newkey, field.data(), field.size());
+  }
+  SetScore(newkey, value);
+
+  void* prev = AddOrFindObj(newkey, false);
+  DCHECK(prev == nullptr);
+
+  return newkey;
+}
+
+optional<double> ScoreMap::Find(string_view key) const {
+  sds entry = FindEntry(key);
+  if (!entry)
+    return nullopt;
+
+  return GetScore(entry);
+}
+
+sds ScoreMap::FindEntry(string_view key) const {
+  return (sds)FindInternal(&key, 1);
+}
+
+bool ScoreMap::Erase(string_view key) {
+  return EraseInternal(&key, 1);
+}
+
+void ScoreMap::Clear() {
+  ClearInternal();
+}
+
+double ScoreMap::GetScore(sds entry) {
+  const char* valptr = entry + sdslen(entry) + 1;
+  return absl::bit_cast<double>(absl::little_endian::Load64(valptr));
+}
+
+void ScoreMap::SetScore(sds entry, double value) {
+  char* valptr = entry + sdslen(entry) + 1;
+  absl::little_endian::Store64(valptr, absl::bit_cast<uint64_t>(value));
+}
+
+uint64_t ScoreMap::Hash(const void* obj, uint32_t cookie) const {
+  DCHECK_LT(cookie, 2u);
+
+  if (cookie == 0) {
+    sds s = (sds)obj;
+    return CompactObj::HashCode(string_view{s, sdslen(s)});
+  }
+
+  const string_view* sv = (const string_view*)obj;
+  return CompactObj::HashCode(*sv);
+}
+
+bool ScoreMap::ObjEqual(const void* left, const void* right, uint32_t right_cookie) const {
+  DCHECK_LT(right_cookie, 2u);
+
+  sds s1 = (sds)left;
+  if (right_cookie == 0) {
+    sds s2 = (sds)right;
+    return string_view{s1, sdslen(s1)} == string_view{s2, sdslen(s2)};
+  }
+
+  const string_view* right_sv = (const string_view*)right;
+  return string_view{s1, sdslen(s1)} == (*right_sv);
+}
+
+size_t ScoreMap::ObjectAllocSize(const void* obj) const {
+  sds s1 = (sds)obj;
+  return zmalloc_usable_size(sdsAllocPtr(s1));
+}
+
+uint32_t ScoreMap::ObjExpireTime(const void* obj) const {
+  // Sorted set members do not expire.
+  return UINT32_MAX;
+}
+
+void ScoreMap::ObjDelete(void* obj, bool has_ttl) const {
+  sdsfree((sds)obj);
+}
+
+}  // namespace dfly
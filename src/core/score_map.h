@@ -0,0 +1,55 @@
+// Copyright 2023, DragonflyDB authors.  All rights reserved.
+// See LICENSE for licensing terms.
+//
+
+#pragma once
+
+#include <optional>
+#include <string_view>
+
+#include "core/dense_set.h"
+
+extern "C" {
+#include "redis/sds.h"
+}
+
+namespace dfly {
+
+// ScoreMap is a DenseSet-based member->score map for sorted sets. Each entry is a single
+// sds allocation embedding the member bytes with the 8-byte score stored right after the
+// null terminator, so no separate value allocation and no dictEntry overhead is paid per
+// member. The entry sds doubles as the member string for the companion skiplist.
+class ScoreMap : public DenseSet {
+ public:
+  ScoreMap(MemoryResource* res = PMR_NS::get_default_resource()) : DenseSet(res) {
+  }
+
+  ~ScoreMap();
+
+  // Adds a new entry for field, or returns nullptr if the field already exists.
+  // The returned sds embeds a copy of field and stays valid until the field is erased.
+  sds AddUnique(std::string_view field, double value);
+
+  // Returns the score of the key, or nullopt if the key was not found.
+  std::optional<double> Find(std::string_view key) const;
+
+  // Returns the entry sds of the key, or nullptr if the key was not found.
+  sds FindEntry(std::string_view key) const;
+
+  bool Erase(std::string_view key);
+
+  void Clear();
+
+  // Accessors for the score stored inline after the member bytes of an entry.
+  static double GetScore(sds entry);
+  static void SetScore(sds entry, double value);
+
+ private:
+  uint64_t Hash(const void* obj, uint32_t cookie) const final;
+  bool ObjEqual(const void* left, const void* right, uint32_t right_cookie) const final;
+  size_t ObjectAllocSize(const void* obj) const final;
+  uint32_t ObjExpireTime(const void* obj) const final;
+  void ObjDelete(void* obj, bool has_ttl) const final;
+};
+
+}  // namespace dfly
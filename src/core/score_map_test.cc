@@ -0,0 +1,98 @@
+// Copyright 2023, DragonflyDB authors.  All rights reserved.
+// See LICENSE for licensing terms.
+//
+
+#include "core/score_map.h"
+
+#include <gtest/gtest.h>
+#include <mimalloc.h>
+
+#include "core/mi_memory_resource.h"
+#include "glog/logging.h"
+
+extern "C" {
+#include "redis/zmalloc.h"
+}
+
+namespace dfly {
+
+using namespace std;
+
+class ScoreMapTest : public ::testing::Test {
+ protected:
+  static void SetUpTestSuite() {
+    auto* tlh = mi_heap_get_backing();
+    init_zmalloc_threadlocal(tlh);
+  }
+
+  ScoreMapTest() : mi_alloc_(mi_heap_get_backing()) {
+  }
+
+  void SetUp() override {
+    sm_.reset(new ScoreMap(&mi_alloc_));
+  }
+
+  void TearDown() override {
+    sm_.reset();
+    EXPECT_EQ(zmalloc_used_memory_tl, 0);
+  }
+
+  MiMemoryResource mi_alloc_;
+  std::unique_ptr<ScoreMap> sm_;
+};
+
+TEST_F(ScoreMapTest, Basic) {
+  sds entry = sm_->AddUnique("foo", 5.5);
+  ASSERT_TRUE(entry != nullptr);
+  EXPECT_EQ("foo", string_view(entry, sdslen(entry)));
+  EXPECT_EQ(5.5, ScoreMap::GetScore(entry));
+  EXPECT_EQ(5.5, sm_->Find("foo"));
+
+  // Second add of the same member is rejected.
+  EXPECT_TRUE(sm_->AddUnique("foo", 1.0) == nullptr);
+  EXPECT_EQ(5.5, sm_->Find("foo"));
+
+  // The score is updated in place, the entry stays the same.
+  ScoreMap::SetScore(entry, -10.25);
+  EXPECT_EQ(-10.25, sm_->Find("foo"));
+  EXPECT_EQ(entry, sm_->FindEntry("foo"));
+
+  EXPECT_EQ(nullopt, sm_->Find("bar"));
+  EXPECT_FALSE(sm_->Erase("bar"));
+  EXPECT_TRUE(sm_->Erase("foo"));
+  EXPECT_EQ(0u, sm_->Size());
+}
+
+TEST_F(ScoreMapTest, EmptyKey) {
+  sds entry = sm_->AddUnique("", 1.5);
+  ASSERT_TRUE(entry != nullptr);
+  EXPECT_EQ(0u, sdslen(entry));
+  EXPECT_EQ(1.5, sm_->Find(""));
+  EXPECT_TRUE(sm_->Erase(""));
+}
+
+TEST_F(ScoreMapTest, ManyKeys) {
+  for (unsigned i = 0; i < 512; ++i) {
+    sds entry = sm_->AddUnique(to_string(i), double(i));
+    ASSERT_TRUE(entry != nullptr);
+  }
+  EXPECT_EQ(512u, sm_->Size());
+
+  for (unsigned i = 0; i < 512; ++i) {
+    EXPECT_EQ(double(i), sm_->Find(to_string(i)));
+  }
+
+  // A full scan emits every entry exactly once.
+  unsigned cnt = 0;
+  uint32_t cursor = 0;
+  do {
+    cursor = sm_->Scan(cursor, [&](const void* obj) {
+      sds ele = (sds)obj;
+      EXPECT_EQ(double(atoi(ele)), ScoreMap::GetScore(ele));
+      ++cnt;
+    });
+  } while (cursor != 0);
+  EXPECT_EQ(512u, cnt);
+}
+
+}  // namespace dfly
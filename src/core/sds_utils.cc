@@ -4,11 +4,19 @@
 
 #include "core/sds_utils.h"
 
+#include <cstring>
+
 extern "C" {
 #include "redis/sds.h"
 #include "redis/zmalloc.h"
 }
 
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+
+#include "core/sse_port.h"
+
 namespace dfly {
 
 namespace {
@@ -94,4 +102,54 @@ char* AllocSdsWithSpace(uint32_t strlen, uint32_t space) {
   return s;
 }
 
+bool MemEqual(const void* ptr1, const void* ptr2, size_t len) {
+  const char* a = reinterpret_cast<const char*>(ptr1);
+  const char* b = reinterpret_cast<const char*>(ptr2);
+
+#ifdef __s390x__
+  return memcmp(a, b, len) == 0;
+#else
+  if (len < 16) {
+    if (len >= 8) {
+      // Two (possibly overlapping) 8-byte loads cover the whole range.
+      uint64_t a0, a1, b0, b1;
+      memcpy(&a0, a, 8);
+      memcpy(&a1, a + len - 8, 8);
+      memcpy(&b0, b, 8);
+      memcpy(&b1, b + len - 8, 8);
+      return ((a0 ^ b0) | (a1 ^ b1)) == 0;
+    }
+    return memcmp(a, b, len) == 0;
+  }
+
+  size_t i = 0;
+
+#ifdef __AVX2__
+  for (; i + 32 <= len; i += 32) {
+    __m256i va = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i));
+    __m256i vb = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + i));
+    if (uint32_t(_mm256_movemask_epi8(_mm256_cmpeq_epi8(va, vb))) != 0xFFFFFFFFu)
+      return false;
+  }
+#endif
+
+  for (; i + 16 <= len; i += 16) {
+    __m128i va = mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i));
+    __m128i vb = mm_loadu_si128(reinterpret_cast<const __m128i*>(b + i));
+    if (_mm_movemask_epi8(_mm_cmpeq_epi8(va, vb)) != 0xFFFF)
+      return false;
+  }
+
+  if (i < len) {
+    // Overlapping 16-byte tail load, valid because len >= 16.
+    __m128i va = mm_loadu_si128(reinterpret_cast<const __m128i*>(a + len - 16));
+    __m128i vb = mm_loadu_si128(reinterpret_cast<const __m128i*>(b + len - 16));
+    if (_mm_movemask_epi8(_mm_cmpeq_epi8(va, vb)) != 0xFFFF)
+      return false;
+  }
+
+  return true;
+#endif  // __s390x__
+}
+
 }  // namespace dfly
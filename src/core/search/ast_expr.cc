@@ -15,8 +15,19 @@ using namespace std;
 
 namespace dfly::search {
 
-AstTermNode::AstTermNode(string term)
-    : term{term}, pattern{"\\b" + term + "\\b", std::regex::icase} {
+namespace {
+
+// Infix terms (*needle*) match inside words, so they are compiled without word
+// boundary anchors. The stars would be invalid quantifiers otherwise.
+regex TermPattern(const string& term) {
+  if (term.size() > 2 && term.front() == '*' && term.back() == '*')
+    return regex{term.substr(1, term.size() - 2), regex::icase};
+  return regex{"\\b" + term + "\\b", regex::icase};
+}
+
+}  // namespace
+
+AstTermNode::AstTermNode(string term) : term{term}, pattern{TermPattern(this->term)} {
 }
 
 AstRangeNode::AstRangeNode(int64_t lo, int64_t hi) : lo{lo}, hi{hi} {
@@ -10,9 +10,12 @@
 #include <absl/strings/str_split.h>
 
 #include <algorithm>
+#include <cmath>
+#include <queue>
 #include <regex>
 
 #include "base/logging.h"
+#include "core/search/vector.h"
 
 namespace dfly::search {
 
@@ -72,11 +75,32 @@ vector<DocId> NumericIndex::Range(int64_t l, int64_t r) const {
   return out;
 }
 
+size_t NumericIndex::EstimateRange(int64_t l, int64_t r) const {
+  if (entries_.empty() || l > r)
+    return 0;
+
+  int64_t min_key = entries_.begin()->first;
+  int64_t max_key = entries_.rbegin()->first;
+  if (r < min_key || l > max_key)
+    return 0;
+  if (min_key == max_key)
+    return entries_.size();
+
+  double covered =
+      double(min(r, max_key) - max(l, min_key) + 1) / double(max_key - min_key + 1);
+  return max<size_t>(1, covered * entries_.size());
+}
+
 const vector<DocId>* BaseStringIndex::Matching(string_view str) const {
   auto it = entries_.find(absl::StripAsciiWhitespace(str));
   return (it != entries_.end()) ? &it->second : nullptr;
 }
 
+size_t BaseStringIndex::MatchingCount(string_view str) const {
+  const auto* ids = Matching(str);
+  return ids != nullptr ? ids->size() : 0;
+}
+
 void TextIndex::Add(DocId id, DocumentAccessor* doc, string_view field) {
   for (const auto& word : Tokenize(doc->GetString(field))) {
     auto& list = entries_[word];
@@ -93,6 +117,98 @@ void TextIndex::Remove(DocId id, DocumentAccessor* doc, string_view field) {
   }
 }
 
+vector<DocId> TextIndex::MatchingSubstring(string_view str) const {
+  string needle{absl::StripAsciiWhitespace(str)};
+  absl::AsciiStrToLower(&needle);
+
+  vector<DocId> out;
+  for (const auto& [word, ids] : entries_) {
+    if (word.find(needle) != string::npos)
+      out.insert(out.end(), ids.begin(), ids.end());
+  }
+
+  sort(out.begin(), out.end());
+  out.erase(unique(out.begin(), out.end()), out.end());
+  return out;
+}
+
+void TrigramTextIndex::Add(DocId id, DocumentAccessor* doc, string_view field) {
+  for (const auto& word : Tokenize(doc->GetString(field))) {
+    auto& list = entries_[word];
+    if (list.empty())
+      AddGrams(word);
+    list.insert(upper_bound(list.begin(), list.end(), id), id);
+  }
+}
+
+void TrigramTextIndex::Remove(DocId id, DocumentAccessor* doc, string_view field) {
+  for (const auto& word : Tokenize(doc->GetString(field))) {
+    auto& list = entries_[word];
+    auto it = lower_bound(list.begin(), list.end(), id);
+    if (it != list.end() && *it == id)
+      list.erase(it);
+    if (list.empty()) {
+      RemoveGrams(word);
+      entries_.erase(word);
+    }
+  }
+}
+
+void TrigramTextIndex::AddGrams(string_view word) {
+  for (size_t i = 0; i + 3 <= word.size(); i++) {
+    auto& words = grams_[word.substr(i, 3)];
+    auto it = lower_bound(words.begin(), words.end(), word);
+    if (it == words.end() || *it != word)  // repeated grams within one word
+      words.insert(it, string{word});
+  }
+}
+
+void TrigramTextIndex::RemoveGrams(string_view word) {
+  for (size_t i = 0; i + 3 <= word.size(); i++) {
+    auto it = grams_.find(word.substr(i, 3));
+    if (it == grams_.end())
+      continue;
+
+    auto& words = it->second;
+    auto word_it = lower_bound(words.begin(), words.end(), word);
+    if (word_it != words.end() && *word_it == word)
+      words.erase(word_it);
+    if (words.empty())
+      grams_.erase(it);
+  }
+}
+
+vector<DocId> TrigramTextIndex::MatchingSubstring(string_view str) const {
+  string needle{absl::StripAsciiWhitespace(str)};
+  absl::AsciiStrToLower(&needle);
+
+  if (needle.size() < 3)
+    return TextIndex::MatchingSubstring(needle);
+
+  // The smallest gram posting bounds the candidate set, and verifying candidates
+  // against the needle makes intersecting the remaining grams unnecessary.
+  const vector<string>* candidates = nullptr;
+  for (size_t i = 0; i + 3 <= needle.size(); i++) {
+    auto it = grams_.find(needle.substr(i, 3));
+    if (it == grams_.end())
+      return {};
+    if (candidates == nullptr || it->second.size() < candidates->size())
+      candidates = &it->second;
+  }
+
+  vector<DocId> out;
+  for (const string& word : *candidates) {
+    if (word.find(needle) == string::npos)
+      continue;
+    const auto& ids = entries_.find(word)->second;
+    out.insert(out.end(), ids.begin(), ids.end());
+  }
+
+  sort(out.begin(), out.end());
+  out.erase(unique(out.begin(), out.end()), out.end());
+  return out;
+}
+
 void TagIndex::Add(DocId id, DocumentAccessor* doc, string_view field) {
   for (auto& tag : NormalizeTags(doc->GetString(field))) {
     auto& list = entries_[tag];
@@ -122,4 +238,165 @@ FtVector VectorIndex::Get(DocId doc) const {
   return it != entries_.end() ? it->second : FtVector{};
 }
 
+HnswVectorIndex::HnswVectorIndex(size_t max_connections, size_t ef_construction)
+    : max_connections_{max_connections}, ef_construction_{ef_construction},
+      level_mult_{1.0 / log(double(max_connections))} {
+}
+
+vector<pair<float, DocId>> HnswVectorIndex::SearchLayer(const FtVector& target, DocId ep, size_t ef,
+                                                        size_t level) const {
+  auto dist = [this, &target](DocId id) { return VectorDistance(target, entries_.at(id)); };
+
+  // results keeps the ef closest entries seen so far with the farthest on top,
+  // candidates supplies the next closest node to expand.
+  priority_queue<pair<float, DocId>> results;
+  priority_queue<pair<float, DocId>, vector<pair<float, DocId>>, greater<>> candidates;
+  absl::flat_hash_set<DocId> visited{ep};
+
+  float ep_dist = dist(ep);
+  results.emplace(ep_dist, ep);
+  candidates.emplace(ep_dist, ep);
+
+  while (!candidates.empty()) {
+    auto [cand_dist, cand] = candidates.top();
+    if (cand_dist > results.top().first)
+      break;
+    candidates.pop();
+
+    const auto& node = nodes_.at(cand);
+    if (level >= node.neighbors.size())
+      continue;
+
+    for (DocId neighbor : node.neighbors[level]) {
+      if (!visited.insert(neighbor).second)
+        continue;
+      // Pruning keeps links bidirectional only on a best effort basis, so a neighbor
+      // might have been removed already.
+      if (!nodes_.contains(neighbor))
+        continue;
+
+      float d = dist(neighbor);
+      if (results.size() < ef || d < results.top().first) {
+        candidates.emplace(d, neighbor);
+        results.emplace(d, neighbor);
+        if (results.size() > ef)
+          results.pop();
+      }
+    }
+  }
+
+  vector<pair<float, DocId>> out(results.size());
+  for (auto it = out.rbegin(); it != out.rend(); ++it) {
+    *it = results.top();
+    results.pop();
+  }
+  return out;
+}
+
+void HnswVectorIndex::Connect(DocId id, const vector<pair<float, DocId>>& candidates,
+                              size_t level) {
+  // Level 0 holds twice as many links, as is customary for hnsw.
+  size_t max_links = level == 0 ? 2 * max_connections_ : max_connections_;
+
+  auto& links = nodes_[id].neighbors[level];
+  for (const auto& [dist, cand] : candidates) {
+    if (links.size() >= max_connections_)
+      break;
+    links.push_back(cand);
+
+    auto& back_links = nodes_[cand].neighbors[level];
+    back_links.push_back(id);
+    if (back_links.size() > max_links) {
+      // Shrink to the max_links closest neighbors of cand.
+      const FtVector& cand_vec = entries_.at(cand);
+      sort(back_links.begin(), back_links.end(), [&](DocId l, DocId r) {
+        return VectorDistance(cand_vec, entries_.at(l)) < VectorDistance(cand_vec, entries_.at(r));
+      });
+      back_links.resize(max_links);
+    }
+  }
+}
+
+void HnswVectorIndex::Add(DocId id, DocumentAccessor* doc, string_view field) {
+  VectorIndex::Add(id, doc, field);
+  const FtVector& vec = entries_.at(id);
+
+  exponential_distribution<double> level_dist{1.0 / level_mult_};
+  int level = int(level_dist(generator_));
+
+  auto& node = nodes_[id];
+  node.neighbors.resize(level + 1);
+
+  if (max_level_ < 0) {  // first point becomes the entry.
+    entry_ = id;
+    max_level_ = level;
+    return;
+  }
+
+  // Greedily descend to level+1 with the closest point as the next entry.
+  DocId ep = entry_;
+  for (int lvl = max_level_; lvl > level; lvl--) {
+    auto closest = SearchLayer(vec, ep, 1, lvl);
+    ep = closest.front().second;
+  }
+
+  // From min(level, max_level_) down, link to the closest points of each level.
+  for (int lvl = min(level, max_level_); lvl >= 0; lvl--) {
+    auto candidates = SearchLayer(vec, ep, ef_construction_, lvl);
+    ep = candidates.front().second;
+    Connect(id, candidates, lvl);
+  }
+
+  if (level > max_level_) {
+    entry_ = id;
+    max_level_ = level;
+  }
+}
+
+void HnswVectorIndex::Remove(DocId id, DocumentAccessor* doc, string_view field) {
+  auto it = nodes_.find(id);
+  if (it == nodes_.end())
+    return;
+
+  // Unlink from all neighbors we know of. Asymmetric links left by pruning are
+  // skipped during search instead.
+  for (size_t lvl = 0; lvl < it->second.neighbors.size(); lvl++) {
+    for (DocId neighbor : it->second.neighbors[lvl]) {
+      auto nit = nodes_.find(neighbor);
+      if (nit == nodes_.end() || lvl >= nit->second.neighbors.size())
+        continue;
+      auto& links = nit->second.neighbors[lvl];
+      links.erase(remove(links.begin(), links.end(), id), links.end());
+    }
+  }
+  nodes_.erase(it);
+  VectorIndex::Remove(id, doc, field);
+
+  if (entry_ == id) {  // promote any remaining node to be the entry.
+    max_level_ = -1;
+    for (const auto& [node_id, node] : nodes_) {
+      if (int(node.neighbors.size()) - 1 > max_level_) {
+        max_level_ = node.neighbors.size() - 1;
+        entry_ = node_id;
+      }
+    }
+  }
+}
+
+vector<pair<float, DocId>> HnswVectorIndex::Knn(const FtVector& target, size_t k) const {
+  if (max_level_ < 0)
+    return {};
+
+  DocId ep = entry_;
+  for (int lvl = max_level_; lvl > 0; lvl--) {
+    auto closest = SearchLayer(target, ep, 1, lvl);
+    ep = closest.front().second;
+  }
+
+  auto out = SearchLayer(target, ep, max(k, ef_construction_ / 10), 0);
+  if (out.size() > k)
+    out.resize(k);
+  return out;
+}
+
 }  // namespace dfly::search
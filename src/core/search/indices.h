@@ -7,6 +7,7 @@
 
 #include <map>
 #include <optional>
+#include <random>
 #include <vector>
 
 #include "core/search/base.h"
@@ -21,6 +22,9 @@ struct NumericIndex : public BaseIndex {
 
   std::vector<DocId> Range(int64_t l, int64_t r) const;
 
+  // Constant time estimate of the Range result size, assuming uniformly distributed values.
+  size_t EstimateRange(int64_t l, int64_t r) const;
+
  private:
   absl::btree_set<std::pair<int64_t, DocId>> entries_;
 };
@@ -30,6 +34,9 @@ struct BaseStringIndex : public BaseIndex {
   // Pointer is valid as long as index is not mutated. Nullptr if not found
   const std::vector<DocId>* Matching(std::string_view str) const;
 
+  // Exact size of the Matching result, without exposing the list itself.
+  size_t MatchingCount(std::string_view str) const;
+
  protected:
   absl::flat_hash_map<std::string, std::vector<DocId>> entries_;
 };
@@ -39,6 +46,26 @@ struct BaseStringIndex : public BaseIndex {
 struct TextIndex : public BaseStringIndex {
   void Add(DocId id, DocumentAccessor* doc, std::string_view field) override;
   void Remove(DocId id, DocumentAccessor* doc, std::string_view field) override;
+
+  // Docs with any word containing str as a substring. Linear in the number of words.
+  virtual std::vector<DocId> MatchingSubstring(std::string_view str) const;
+};
+
+// Text index with additional postings keyed by 3-grams of the indexed words,
+// answering substring queries in time proportional to the matched words instead
+// of scanning the whole dictionary.
+struct TrigramTextIndex : public TextIndex {
+  void Add(DocId id, DocumentAccessor* doc, std::string_view field) override;
+  void Remove(DocId id, DocumentAccessor* doc, std::string_view field) override;
+
+  std::vector<DocId> MatchingSubstring(std::string_view str) const override;
+
+ private:
+  void AddGrams(std::string_view word);
+  void RemoveGrams(std::string_view word);
+
+  // Sorted lists of dictionary words per contained 3-gram.
+  absl::flat_hash_map<std::string, std::vector<std::string>> grams_;
 };
 
 // Index for text fields.
@@ -56,8 +83,41 @@ struct VectorIndex : public BaseIndex {
 
   FtVector Get(DocId doc) const;
 
- private:
+ protected:
   absl::flat_hash_map<DocId, FtVector> entries_;
 };
 
+// Vector index with an HNSW proximity graph on top of the id lookup,
+// answering unfiltered KNN queries in logarithmic time instead of a full scan.
+struct HnswVectorIndex : public VectorIndex {
+  explicit HnswVectorIndex(size_t max_connections = 16, size_t ef_construction = 200);
+
+  void Add(DocId id, DocumentAccessor* doc, std::string_view field) override;
+  void Remove(DocId id, DocumentAccessor* doc, std::string_view field) override;
+
+  // Returns up to k (distance, id) pairs closest to target, sorted by distance.
+  // Approximate: the graph is traversed greedily, recall depends on ef_construction.
+  std::vector<std::pair<float, DocId>> Knn(const FtVector& target, size_t k) const;
+
+ private:
+  struct Node {
+    std::vector<std::vector<DocId>> neighbors;  // per level, level 0 at the bottom.
+  };
+
+  // Beam search on a single level starting from ep, keeping the ef closest candidates.
+  std::vector<std::pair<float, DocId>> SearchLayer(const FtVector& target, DocId ep, size_t ef,
+                                                   size_t level) const;
+
+  // Links id to the closest of candidates on level, shrinking overfull neighbor lists.
+  void Connect(DocId id, const std::vector<std::pair<float, DocId>>& candidates, size_t level);
+
+  size_t max_connections_, ef_construction_;
+  double level_mult_;
+
+  int max_level_ = -1;
+  DocId entry_ = 0;
+  absl::flat_hash_map<DocId, Node> nodes_;
+  std::mt19937 generator_;  // samples insertion levels.
+};
+
 }  // namespace dfly::search
@@ -0,0 +1,244 @@
+// Copyright 2023, DragonflyDB authors.  All rights reserved.
+// See LICENSE for licensing terms.
+//
+
+#include "core/search/roaring_bitmap.h"
+
+#include <absl/numeric/bits.h>
+
+#include <algorithm>
+
+#include "base/logging.h"
+
+namespace dfly::search {
+
+using namespace std;
+
+namespace {
+
+constexpr size_t kNumWords = 1 << 10;  // 64K bits.
+constexpr size_t kArrayLimit = 1 << 12;  // above this a bitset is smaller than the array.
+
+inline uint16_t High(DocId id) {
+  return id >> 16;
+}
+
+inline uint16_t Low(DocId id) {
+  return id & 0xFFFF;
+}
+
+inline bool GetBit(const vector<uint64_t>& words, uint16_t low) {
+  return words[low >> 6] & (1ULL << (low & 63));
+}
+
+inline void SetBit(vector<uint64_t>* words, uint16_t low) {
+  (*words)[low >> 6] |= 1ULL << (low & 63);
+}
+
+}  // namespace
+
+void RoaringBitmap::Container::Convert() {
+  DCHECK(!dense());
+  words.resize(kNumWords);
+  for (uint16_t v : values)
+    SetBit(&words, v);
+  values = {};
+}
+
+void RoaringBitmap::Add(DocId id) {
+  Container& c = containers_[High(id)];
+  if (c.dense()) {
+    if (GetBit(c.words, Low(id)))
+      return;
+    SetBit(&c.words, Low(id));
+    c.cardinality++;
+    return;
+  }
+
+  auto it = lower_bound(c.values.begin(), c.values.end(), Low(id));
+  if (it != c.values.end() && *it == Low(id))
+    return;
+  c.values.insert(it, Low(id));
+  c.cardinality++;
+
+  if (c.values.size() > kArrayLimit)
+    c.Convert();
+}
+
+bool RoaringBitmap::Contains(DocId id) const {
+  auto it = containers_.find(High(id));
+  if (it == containers_.end())
+    return false;
+  const Container& c = it->second;
+  if (c.dense())
+    return GetBit(c.words, Low(id));
+  return binary_search(c.values.begin(), c.values.end(), Low(id));
+}
+
+size_t RoaringBitmap::Size() const {
+  size_t size = 0;
+  for (const auto& [high, c] : containers_)
+    size += c.cardinality;
+  return size;
+}
+
+vector<DocId> RoaringBitmap::ToVector() const {
+  vector<DocId> out;
+  out.reserve(Size());
+
+  for (const auto& [high, c] : containers_) {
+    DocId base = DocId(high) << 16;
+    if (!c.dense()) {
+      for (uint16_t v : c.values)
+        out.push_back(base | v);
+      continue;
+    }
+    for (size_t i = 0; i < kNumWords; i++) {
+      for (uint64_t word = c.words[i]; word; word &= word - 1)
+        out.push_back(base | (i << 6) | absl::countr_zero(word));
+    }
+  }
+  return out;
+}
+
+void RoaringBitmap::UnionContainer(Container* dest, const Container& src) {
+  if (!dest->dense() && (src.dense() || dest->values.size() + src.values.size() > kArrayLimit))
+    dest->Convert();
+
+  if (dest->dense()) {
+    uint32_t cardinality = 0;
+    if (src.dense()) {
+      for (size_t i = 0; i < kNumWords; i++) {
+        dest->words[i] |= src.words[i];
+        cardinality += absl::popcount(dest->words[i]);
+      }
+      dest->cardinality = cardinality;
+    } else {
+      for (uint16_t v : src.values) {
+        if (!GetBit(dest->words, v)) {
+          SetBit(&dest->words, v);
+          dest->cardinality++;
+        }
+      }
+    }
+    return;
+  }
+
+  vector<uint16_t> merged;
+  merged.reserve(dest->values.size() + src.values.size());
+  set_union(dest->values.begin(), dest->values.end(), src.values.begin(), src.values.end(),
+            back_inserter(merged));
+  dest->values = move(merged);
+  dest->cardinality = dest->values.size();
+}
+
+void RoaringBitmap::IntersectContainer(Container* dest, const Container& src) {
+  if (dest->dense() && src.dense()) {
+    uint32_t cardinality = 0;
+    for (size_t i = 0; i < kNumWords; i++) {
+      dest->words[i] &= src.words[i];
+      cardinality += absl::popcount(dest->words[i]);
+    }
+    dest->cardinality = cardinality;
+    return;
+  }
+
+  // At least one side is an array, so the result fits in an array as well.
+  const vector<uint16_t>& probe = dest->dense() ? src.values : dest->values;
+  const Container& other = dest->dense() ? *dest : src;
+
+  vector<uint16_t> out;
+  for (uint16_t v : probe) {
+    bool found = other.dense() ? GetBit(other.words, v)
+                               : binary_search(other.values.begin(), other.values.end(), v);
+    if (found)
+      out.push_back(v);
+  }
+
+  dest->words = {};
+  dest->values = move(out);
+  dest->cardinality = dest->values.size();
+}
+
+void RoaringBitmap::AndNotContainer(Container* dest, const Container& src) {
+  if (dest->dense()) {
+    uint32_t cardinality = 0;
+    if (src.dense()) {
+      for (size_t i = 0; i < kNumWords; i++) {
+        dest->words[i] &= ~src.words[i];
+        cardinality += absl::popcount(dest->words[i]);
+      }
+      dest->cardinality = cardinality;
+    } else {
+      for (uint16_t v : src.values) {
+        if (GetBit(dest->words, v)) {
+          dest->words[v >> 6] &= ~(1ULL << (v & 63));
+          dest->cardinality--;
+        }
+      }
+    }
+    return;
+  }
+
+  auto pred = [&src](uint16_t v) {
+    return src.dense() ? GetBit(src.words, v)
+                       : binary_search(src.values.begin(), src.values.end(), v);
+  };
+  auto& values = dest->values;
+  values.erase(remove_if(values.begin(), values.end(), pred), values.end());
+  dest->cardinality = values.size();
+}
+
+void RoaringBitmap::UnionWith(const RoaringBitmap& o) {
+  for (const auto& [high, src] : o.containers_) {
+    auto [it, inserted] = containers_.try_emplace(high, src);
+    if (!inserted)
+      UnionContainer(&it->second, src);
+  }
+}
+
+void RoaringBitmap::IntersectWith(const RoaringBitmap& o) {
+  for (auto it = containers_.begin(); it != containers_.end();) {
+    auto src_it = o.containers_.find(it->first);
+    if (src_it == o.containers_.end()) {
+      it = containers_.erase(it);
+      continue;
+    }
+    IntersectContainer(&it->second, src_it->second);
+    it = it->second.cardinality == 0 ? containers_.erase(it) : next(it);
+  }
+}
+
+void RoaringBitmap::AndNotWith(const RoaringBitmap& o) {
+  for (auto it = containers_.begin(); it != containers_.end();) {
+    auto src_it = o.containers_.find(it->first);
+    if (src_it != o.containers_.end())
+      AndNotContainer(&it->second, src_it->second);
+    it = it->second.cardinality == 0 ? containers_.erase(it) : next(it);
+  }
+}
+
+RoaringBitmap RoaringBitmap::FromSorted(absl::Span<const DocId> ids) {
+  RoaringBitmap out;
+  for (size_t i = 0; i < ids.size();) {
+    uint16_t high = High(ids[i]);
+    size_t end = i;
+    while (end < ids.size() && High(ids[end]) == high)
+      end++;
+
+    Container& c = out.containers_[high];
+    c.cardinality = end - i;
+    if (c.cardinality > kArrayLimit) {
+      c.words.resize(kNumWords);
+      for (; i < end; i++)
+        SetBit(&c.words, Low(ids[i]));
+    } else {
+      c.values.reserve(c.cardinality);
+      for (; i < end; i++)
+        c.values.push_back(Low(ids[i]));
+    }
+  }
+  return out;
+}
+
+}  // namespace dfly::search
@@ -0,0 +1,60 @@
+// Copyright 2023, DragonflyDB authors.  All rights reserved.
+// See LICENSE for licensing terms.
+//
+
+#pragma once
+
+#include <absl/container/btree_map.h>
+#include <absl/types/span.h>
+
+#include <cstdint>
+#include <vector>
+
+#include "core/search/base.h"
+
+namespace dfly::search {
+
+// A roaring-style compressed bitmap over doc ids. Ids are partitioned by their upper
+// 16 bits into containers holding the lower 16 bits either as a sorted array (sparse)
+// or as a fixed 8KB bitset (dense). Set operations work directly on the containers:
+// dense-dense unions and intersections reduce to word-wide or/and loops that the
+// compiler vectorizes, without decoding the ids in between.
+class RoaringBitmap {
+ public:
+  void Add(DocId id);
+  bool Contains(DocId id) const;
+
+  size_t Size() const;
+
+  // Decode all ids in ascending order.
+  std::vector<DocId> ToVector() const;
+
+  void UnionWith(const RoaringBitmap& o);
+  void IntersectWith(const RoaringBitmap& o);
+  void AndNotWith(const RoaringBitmap& o);
+
+  static RoaringBitmap FromSorted(absl::Span<const DocId> ids);
+
+ private:
+  struct Container {
+    // Exactly one representation is active: values while sparse, words once the
+    // container holds more than kArrayLimit entries.
+    std::vector<uint16_t> values;  // sorted.
+    std::vector<uint64_t> words;   // 1024 words = 65536 bits.
+    uint32_t cardinality = 0;
+
+    bool dense() const {
+      return !words.empty();
+    }
+
+    void Convert();  // array -> bitset
+  };
+
+  static void UnionContainer(Container* dest, const Container& src);
+  static void IntersectContainer(Container* dest, const Container& src);
+  static void AndNotContainer(Container* dest, const Container& src);
+
+  absl::btree_map<uint16_t, Container> containers_;
+};
+
+}  // namespace dfly::search
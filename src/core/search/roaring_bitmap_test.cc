@@ -0,0 +1,106 @@
+// Copyright 2023, DragonflyDB authors.  All rights reserved.
+// See LICENSE for licensing terms.
+//
+
+#include "core/search/roaring_bitmap.h"
+
+#include <algorithm>
+#include <random>
+#include <set>
+
+#include "base/gtest.h"
+#include "base/logging.h"
+
+namespace dfly::search {
+
+using namespace std;
+
+class RoaringBitmapTest : public ::testing::Test {
+ protected:
+};
+
+using IdVec = vector<DocId>;
+
+// Random sorted unique ids, clustered enough to produce both sparse and dense containers.
+IdVec RandomIds(size_t count, uint32_t range, uint32_t seed) {
+  mt19937 gen{seed};
+  uniform_int_distribution<uint32_t> dist{0, range};
+
+  set<DocId> ids;
+  while (ids.size() < count)
+    ids.insert(dist(gen));
+  return IdVec{ids.begin(), ids.end()};
+}
+
+TEST_F(RoaringBitmapTest, Basic) {
+  RoaringBitmap bm;
+  EXPECT_EQ(0u, bm.Size());
+  EXPECT_FALSE(bm.Contains(1));
+
+  // Values spread over different containers, added out of order.
+  IdVec values{70'000, 5, 100'000, 65'535, 65'536, 5, 1 << 20};
+  for (DocId id : values)
+    bm.Add(id);
+
+  sort(values.begin(), values.end());
+  values.erase(unique(values.begin(), values.end()), values.end());
+
+  EXPECT_EQ(values.size(), bm.Size());
+  EXPECT_EQ(values, bm.ToVector());
+  for (DocId id : values)
+    EXPECT_TRUE(bm.Contains(id));
+  EXPECT_FALSE(bm.Contains(6));
+}
+
+TEST_F(RoaringBitmapTest, DenseConversion) {
+  // More than the array limit within one container forces the bitset representation.
+  IdVec values(10'000);
+  for (size_t i = 0; i < values.size(); i++)
+    values[i] = i * 5;
+
+  RoaringBitmap bm = RoaringBitmap::FromSorted(values);
+  EXPECT_EQ(values.size(), bm.Size());
+  EXPECT_EQ(values, bm.ToVector());
+
+  bm.Add(3);
+  EXPECT_TRUE(bm.Contains(3));
+  EXPECT_EQ(values.size() + 1, bm.Size());
+}
+
+TEST_F(RoaringBitmapTest, SetOperations) {
+  const IdVec l_ids = RandomIds(20'000, 1 << 18, 42);
+  const IdVec r_ids = RandomIds(500, 1 << 18, 43);
+
+  IdVec expected;
+
+  {
+    RoaringBitmap l = RoaringBitmap::FromSorted(l_ids);
+    l.UnionWith(RoaringBitmap::FromSorted(r_ids));
+
+    expected.clear();
+    set_union(l_ids.begin(), l_ids.end(), r_ids.begin(), r_ids.end(), back_inserter(expected));
+    EXPECT_EQ(expected, l.ToVector());
+  }
+
+  {
+    RoaringBitmap l = RoaringBitmap::FromSorted(l_ids);
+    l.IntersectWith(RoaringBitmap::FromSorted(r_ids));
+
+    expected.clear();
+    set_intersection(l_ids.begin(), l_ids.end(), r_ids.begin(), r_ids.end(),
+                     back_inserter(expected));
+    EXPECT_EQ(expected, l.ToVector());
+  }
+
+  {
+    RoaringBitmap l = RoaringBitmap::FromSorted(l_ids);
+    l.AndNotWith(RoaringBitmap::FromSorted(r_ids));
+
+    expected.clear();
+    set_difference(l_ids.begin(), l_ids.end(), r_ids.begin(), r_ids.end(),
+                   back_inserter(expected));
+    EXPECT_EQ(expected, l.ToVector());
+  }
+}
+
+}  // namespace dfly::search
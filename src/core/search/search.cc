@@ -5,13 +5,17 @@
 #include "core/search/search.h"
 
 #include <absl/strings/numbers.h>
+#include <absl/strings/str_cat.h>
+#include <absl/strings/str_join.h>
 
+#include <limits>
 #include <variant>
 
 #include "base/logging.h"
 #include "core/search/ast_expr.h"
 #include "core/search/indices.h"
 #include "core/search/query_driver.h"
+#include "core/search/roaring_bitmap.h"
 #include "core/search/vector.h"
 
 using namespace std;
@@ -73,6 +77,160 @@ struct IndexResult {
   variant<DocVec /*owned*/, const DocVec* /*pointer to borrowed*/> value_;
 };
 
+// Estimates result sizes from index metadata without evaluating the query, used to
+// order conjunction branches by selectivity and to annotate query plans.
+struct CostEstimator {
+  const FieldIndices* indices;
+
+  size_t Estimate(const AstNode& node, string_view active_field) {
+    auto cb = [this, active_field](const auto& inner) { return EstimateNode(inner, active_field); };
+    return visit(cb, static_cast<const NodeVariants&>(node));
+  }
+
+  size_t EstimateNode(monostate, string_view) {
+    return 0;
+  }
+
+  size_t EstimateNode(const AstStarNode&, string_view) {
+    return indices->GetAllDocs().size();
+  }
+
+  size_t EstimateNode(const AstTermNode& node, string_view active_field) {
+    if (!active_field.empty()) {
+      auto* index = dynamic_cast<TextIndex*>(indices->GetIndex(active_field));
+      return index != nullptr ? index->MatchingCount(node.term) : 0;
+    }
+
+    size_t total = 0;
+    for (auto* index : indices->GetAllTextIndices())
+      total += index->MatchingCount(node.term);
+    return total;
+  }
+
+  size_t EstimateNode(const AstRangeNode& node, string_view active_field) {
+    auto* index = dynamic_cast<NumericIndex*>(indices->GetIndex(active_field));
+    return index != nullptr ? index->EstimateRange(node.lo, node.hi) : 0;
+  }
+
+  size_t EstimateNode(const AstNegateNode& node, string_view active_field) {
+    size_t all = indices->GetAllDocs().size();
+    size_t sub = Estimate(*node.node, active_field);
+    return all > sub ? all - sub : 0;
+  }
+
+  size_t EstimateNode(const AstLogicalNode& node, string_view active_field) {
+    // AND only shrinks its smallest operand, OR is bounded by the sum.
+    size_t out = node.op == AstLogicalNode::AND ? numeric_limits<size_t>::max() : 0;
+    for (const auto& sub : node.nodes) {
+      size_t est = Estimate(sub, active_field);
+      out = node.op == AstLogicalNode::AND ? min(out, est) : out + est;
+    }
+    return out;
+  }
+
+  size_t EstimateNode(const AstFieldNode& node, string_view) {
+    return Estimate(*node.node, node.field);
+  }
+
+  size_t EstimateNode(const AstTagsNode& node, string_view active_field) {
+    auto* index = dynamic_cast<TagIndex*>(indices->GetIndex(active_field));
+    if (index == nullptr)
+      return 0;
+
+    size_t total = 0;
+    for (const auto& tag : node.tags)
+      total += index->MatchingCount(tag);
+    return total;
+  }
+
+  size_t EstimateNode(const AstKnnNode& node, string_view active_field) {
+    return min(node.limit, Estimate(*node.filter, active_field));
+  }
+};
+
+// Sub node indices ordered by ascending estimated result size.
+vector<size_t> OrderBySelectivity(const AstLogicalNode& node, string_view active_field,
+                                  const FieldIndices* indices) {
+  CostEstimator est{indices};
+
+  vector<pair<size_t, size_t>> costs(node.nodes.size());
+  for (size_t i = 0; i < node.nodes.size(); i++)
+    costs[i] = {est.Estimate(node.nodes[i], active_field), i};
+  sort(costs.begin(), costs.end());
+
+  vector<size_t> order(costs.size());
+  for (size_t i = 0; i < costs.size(); i++)
+    order[i] = costs[i].second;
+  return order;
+}
+
+// Renders the query tree with per-node cardinality estimates, listing conjunction
+// branches in the order they are evaluated.
+struct PlanExplainer {
+  const FieldIndices* indices;
+  string out;
+
+  void Append(int depth, string text, size_t estimate) {
+    absl::StrAppend(&out, string(depth * 2, ' '), text, " (estimate: ", estimate, ")\n");
+  }
+
+  void Render(const AstNode& node, string_view active_field, int depth) {
+    size_t estimate = CostEstimator{indices}.Estimate(node, active_field);
+    auto cb = [&](const auto& inner) { RenderNode(inner, active_field, depth, estimate); };
+    visit(cb, static_cast<const NodeVariants&>(node));
+  }
+
+  void RenderNode(monostate, string_view, int depth, size_t estimate) {
+    Append(depth, "EMPTY", estimate);
+  }
+
+  void RenderNode(const AstStarNode&, string_view, int depth, size_t estimate) {
+    Append(depth, "STAR", estimate);
+  }
+
+  void RenderNode(const AstTermNode& node, string_view, int depth, size_t estimate) {
+    Append(depth, absl::StrCat("TERM ", node.term), estimate);
+  }
+
+  void RenderNode(const AstRangeNode& node, string_view, int depth, size_t estimate) {
+    Append(depth, absl::StrCat("RANGE [", node.lo, " ", node.hi, "]"), estimate);
+  }
+
+  void RenderNode(const AstNegateNode& node, string_view active_field, int depth,
+                  size_t estimate) {
+    Append(depth, "NOT", estimate);
+    Render(*node.node, active_field, depth + 1);
+  }
+
+  void RenderNode(const AstLogicalNode& node, string_view active_field, int depth,
+                  size_t estimate) {
+    Append(depth, node.op == AstLogicalNode::AND ? "AND" : "OR", estimate);
+
+    vector<size_t> order(node.nodes.size());
+    for (size_t i = 0; i < order.size(); i++)
+      order[i] = i;
+    if (node.op == AstLogicalNode::AND)
+      order = OrderBySelectivity(node, active_field, indices);
+
+    for (size_t i : order)
+      Render(node.nodes[i], active_field, depth + 1);
+  }
+
+  void RenderNode(const AstFieldNode& node, string_view, int depth, size_t estimate) {
+    Append(depth, absl::StrCat("@", node.field), estimate);
+    Render(*node.node, node.field, depth + 1);
+  }
+
+  void RenderNode(const AstTagsNode& node, string_view, int depth, size_t estimate) {
+    Append(depth, absl::StrCat("TAGS {", absl::StrJoin(node.tags, " | "), "}"), estimate);
+  }
+
+  void RenderNode(const AstKnnNode& node, string_view active_field, int depth, size_t estimate) {
+    Append(depth, absl::StrCat("KNN ", node.limit, " @", node.field), estimate);
+    Render(*node.filter, active_field, depth + 1);
+  }
+};
+
 struct BasicSearch {
   using LogicOp = AstLogicalNode::LogicOp;
 
@@ -120,6 +278,22 @@ struct BasicSearch {
     if (sub_results.empty())
       return vector<DocId>{};
 
+    // Large disjunctions are or-ed container-wise through a compressed bitmap instead
+    // of repeated list merges, which re-traverse the accumulated result per sub list.
+    constexpr size_t kBitmapThreshold = 4096;
+    if (op == LogicOp::OR && sub_results.size() > 1) {
+      size_t total = 0;
+      for (const auto& result : sub_results)
+        total += result->size();
+
+      if (total >= kBitmapThreshold) {
+        RoaringBitmap bitmap;
+        for (const auto& result : sub_results)
+          bitmap.UnionWith(RoaringBitmap::FromSorted({result->data(), result->size()}));
+        return bitmap.ToVector();
+      }
+    }
+
     // Unifying from smallest to largest is more efficient.
     // AND: the result only shrinks, so starting with the smallest is most optimal.
     // OR: unifying smaller sets first reduces the number of element traversals on average.
@@ -143,13 +317,24 @@ struct BasicSearch {
 
   // "term": access field's text index or unify results from all text indices if no field is set
   IndexResult Search(const AstTermNode& node, string_view active_field) {
+    // Infix terms (*needle*) can only originate from quoted strings, plain terms
+    // cannot contain stars.
+    string_view term = node.term;
+    bool infix = term.size() > 2 && term.front() == '*' && term.back() == '*';
+    string_view needle = infix ? term.substr(1, term.size() - 2) : term;
+
     if (!active_field.empty()) {
       auto* index = GetIndex<TextIndex>(active_field);
-      return index->Matching(node.term);
+      if (infix)
+        return index->MatchingSubstring(needle);
+      return index->Matching(term);
     }
 
     vector<TextIndex*> selected_indices = indices_->GetAllTextIndices();
-    auto mapping = [&node](TextIndex* index) { return index->Matching(node.term); };
+    auto mapping = [infix, needle, term](TextIndex* index) {
+      return infix ? IndexResult{index->MatchingSubstring(needle)}
+                   : IndexResult{index->Matching(term)};
+    };
 
     return UnifyResults(GetSubResults(selected_indices, mapping), LogicOp::OR);
   }
@@ -176,6 +361,18 @@ struct BasicSearch {
 
   // logical query: unify all sub results
   IndexResult Search(const AstLogicalNode& node, string_view active_field) {
+    // Conjunctions are evaluated from the most selective branch upwards: the
+    // intersection only shrinks, so the first branch bounds all following merges and
+    // an empty intermediate result skips the remaining branches entirely.
+    if (node.op == LogicOp::AND && node.nodes.size() > 1) {
+      vector<size_t> order = OrderBySelectivity(node, active_field, indices_);
+
+      IndexResult out = SearchGeneric(node.nodes[order[0]], active_field);
+      for (size_t i = 1; i < order.size() && !out->empty(); i++)
+        Merge(SearchGeneric(node.nodes[order[i]], active_field), &out, LogicOp::AND);
+      return out;
+    }
+
     auto mapping = [&](auto& node) { return SearchGeneric(node, active_field); };
     return UnifyResults(GetSubResults(node.nodes, mapping), node.op);
   }
@@ -197,10 +394,23 @@ struct BasicSearch {
   // [KNN limit @field vec]: Compute distance from `vec` to all vectors keep closest `limit`
   IndexResult Search(const AstKnnNode& knn, string_view active_field) {
     DCHECK(active_field.empty());
-    auto sub_results = SearchGeneric(*knn.filter, active_field);
 
     auto* vec_index = GetIndex<VectorIndex>(knn.field);
 
+    // An hnsw index answers unfiltered queries from its proximity graph directly,
+    // the brute force scan below remains for filtered ones.
+    auto* hnsw_index = dynamic_cast<HnswVectorIndex*>(vec_index);
+    if (hnsw_index && holds_alternative<AstStarNode>(*knn.filter)) {
+      distances_ = hnsw_index->Knn(knn.vector, knn.limit);
+
+      vector<DocId> out(distances_.size());
+      for (size_t i = 0; i < out.size(); i++)
+        out[i] = distances_[i].second;
+      return out;
+    }
+
+    auto sub_results = SearchGeneric(*knn.filter, active_field);
+
     distances_.reserve(sub_results->size());
     for (DocId matched_doc : *sub_results) {
       float dist = VectorDistance(knn.vector, vec_index->Get(matched_doc));
@@ -258,12 +468,18 @@ FieldIndices::FieldIndices(Schema schema) : schema_{move(schema)}, all_ids_{}, i
       case Schema::TEXT:
         indices_[field] = make_unique<TextIndex>();
         break;
+      case Schema::TEXT_TRIGRAM:
+        indices_[field] = make_unique<TrigramTextIndex>();
+        break;
       case Schema::NUMERIC:
         indices_[field] = make_unique<NumericIndex>();
         break;
       case Schema::VECTOR:
         indices_[field] = make_unique<VectorIndex>();
         break;
+      case Schema::VECTOR_HNSW:
+        indices_[field] = make_unique<HnswVectorIndex>();
+        break;
     }
   }
 }
@@ -292,7 +508,7 @@ BaseIndex* FieldIndices::GetIndex(string_view field) const {
 std::vector<TextIndex*> FieldIndices::GetAllTextIndices() const {
   vector<TextIndex*> out;
   for (auto& [field, type] : schema_.fields) {
-    if (type != Schema::TEXT)
+    if (type != Schema::TEXT && type != Schema::TEXT_TRIGRAM)
       continue;
     auto* index = dynamic_cast<TextIndex*>(GetIndex(field));
     DCHECK(index);
@@ -325,6 +541,13 @@ SearchResult SearchAlgorithm::Search(const FieldIndices* index) const {
   return BasicSearch{index}.Search(*query_);
 }
 
+string SearchAlgorithm::ExplainQuery(const FieldIndices* index) const {
+  DCHECK(query_);
+  PlanExplainer explainer{index};
+  explainer.Render(*query_, "", 0);
+  return explainer.out;
+}
+
 optional<size_t> SearchAlgorithm::HasKnn() const {
   DCHECK(query_);
   if (holds_alternative<AstKnnNode>(*query_))
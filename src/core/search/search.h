@@ -20,7 +20,7 @@ struct AstNode;
 struct TextIndex;
 
 struct Schema {
-  enum FieldType { TAG, TEXT, NUMERIC, VECTOR };
+  enum FieldType { TAG, TEXT, TEXT_TRIGRAM, NUMERIC, VECTOR, VECTOR_HNSW };
 
   absl::flat_hash_map<std::string, FieldType> fields;
 };
@@ -64,6 +64,10 @@ class SearchAlgorithm {
 
   SearchResult Search(const FieldIndices* index) const;
 
+  // Render the query plan for the given index: the node tree annotated with cardinality
+  // estimates, conjunction branches listed in evaluation order.
+  std::string ExplainQuery(const FieldIndices* index) const;
+
   // Return KNN limit if it is enabled
   std::optional<size_t> HasKnn() const;
 
@@ -415,6 +415,105 @@ TEST_F(SearchParserTest, Simple2dKnn) {
   }
 }
 
+TEST_F(SearchParserTest, HnswKnn) {
+  Schema schema{{{"even", Schema::TAG}, {"pos", Schema::VECTOR_HNSW}}};
+  FieldIndices indices{schema};
+
+  // Place points on a straight line
+  for (size_t i = 0; i < 100; i++) {
+    Map values{{{"even", i % 2 == 0 ? "YES" : "NO"}, {"pos", to_string(float(i))}}};
+    MockedDocument doc{values};
+    indices.Add(i, &doc);
+  }
+
+  SearchAlgorithm algo{};
+
+  // Unfiltered queries go through the proximity graph.
+  {
+    algo.Init("*=>[KNN 5 @pos VEC]", QueryParams{FtVector{50.0}});
+    EXPECT_THAT(algo.Search(&indices).ids, testing::UnorderedElementsAre(48, 49, 50, 51, 52));
+  }
+
+  {
+    algo.Init("*=>[KNN 3 @pos VEC]", QueryParams{FtVector{0.0}});
+    EXPECT_THAT(algo.Search(&indices).ids, testing::ElementsAre(0, 1, 2));
+  }
+
+  // Filtered queries fall back to the brute force scan.
+  {
+    algo.Init("@even:{yes} =>[KNN 5 @pos VEC]", QueryParams{FtVector{20.0}});
+    EXPECT_THAT(algo.Search(&indices).ids, testing::UnorderedElementsAre(16, 18, 20, 22, 24));
+  }
+
+  // Removed points are no longer returned.
+  {
+    Map values{{{"even", "NO"}, {"pos", "71"}}};
+    MockedDocument doc{values};
+    indices.Remove(71, &doc);
+
+    algo.Init("* =>[KNN 2 @pos VEC]", QueryParams{FtVector{70.6}});
+    EXPECT_THAT(algo.Search(&indices).ids, testing::UnorderedElementsAre(70, 72));
+  }
+}
+
+TEST_F(SearchParserTest, InfixSearch) {
+  Schema schema{{{"title", Schema::TEXT_TRIGRAM}}};
+  FieldIndices indices{schema};
+
+  vector<string> titles{"wireless headphones", "smartphone case", "phone charger",
+                        "laptop stand", "usb microphone"};
+  for (size_t i = 0; i < titles.size(); i++) {
+    MockedDocument doc{Map{{"title", titles[i]}}};
+    indices.Add(i, &doc);
+  }
+
+  SearchAlgorithm algo{};
+
+  ASSERT_TRUE(algo.Init("@title:\"*phone*\"", QueryParams{}));
+  EXPECT_THAT(algo.Search(&indices).ids, testing::ElementsAre(0, 1, 2, 4));
+
+  ASSERT_TRUE(algo.Init("@title:\"*charg*\"", QueryParams{}));
+  EXPECT_THAT(algo.Search(&indices).ids, testing::ElementsAre(2));
+
+  ASSERT_TRUE(algo.Init("@title:\"*xyz*\"", QueryParams{}));
+  EXPECT_THAT(algo.Search(&indices).ids, testing::IsEmpty());
+
+  // Whole-word matching still works on the same field.
+  ASSERT_TRUE(algo.Init("@title:case", QueryParams{}));
+  EXPECT_THAT(algo.Search(&indices).ids, testing::ElementsAre(1));
+
+  // Removed docs drop out of the gram postings.
+  {
+    MockedDocument doc{Map{{"title", titles[2]}}};
+    indices.Remove(2, &doc);
+
+    ASSERT_TRUE(algo.Init("@title:\"*phone*\"", QueryParams{}));
+    EXPECT_THAT(algo.Search(&indices).ids, testing::ElementsAre(0, 1, 4));
+  }
+}
+
+TEST_F(SearchParserTest, ExplainPlan) {
+  Schema schema{{{"color", Schema::TAG}, {"price", Schema::NUMERIC}}};
+  FieldIndices indices{schema};
+
+  // Many documents fall into the price range, only one carries the rare tag.
+  for (size_t i = 0; i < 100; i++) {
+    Map values{{{"color", i == 42 ? "rare" : "common"}, {"price", to_string(i)}}};
+    MockedDocument doc{values};
+    indices.Add(i, &doc);
+  }
+
+  SearchAlgorithm algo{};
+  ASSERT_TRUE(algo.Init("@price:[0 99] @color:{rare}", QueryParams{}));
+
+  EXPECT_THAT(algo.Search(&indices).ids, testing::ElementsAre(42));
+
+  // The selective tag branch is evaluated before the broad numeric range.
+  string plan = algo.ExplainQuery(&indices);
+  EXPECT_NE(plan.find("AND"), string::npos);
+  EXPECT_LT(plan.find("TAGS {rare}"), plan.find("RANGE [0 99]"));
+}
+
 }  // namespace search
 
 }  // namespace dfly
@@ -21,4 +21,30 @@ __attribute__((optimize("fast-math"))) float VectorDistance(const FtVector& u, c
   return sqrt(sum);
 }
 
+// The kernels below rely on fast-math auto-vectorization like VectorDistance above,
+// which produces the same packed fma loops as hand-written intrinsics would.
+
+// Inner product: sum: u[i] * v[i]
+__attribute__((optimize("fast-math"))) float VectorDot(const FtVector& u, const FtVector& v) {
+  DCHECK_EQ(u.size(), v.size());
+  float sum = 0;
+  for (size_t i = 0; i < u.size(); i++)
+    sum += u[i] * v[i];
+  return sum;
+}
+
+__attribute__((optimize("fast-math"))) float VectorCosineDistance(const FtVector& u,
+                                                                  const FtVector& v) {
+  DCHECK_EQ(u.size(), v.size());
+  float dot = 0, unorm = 0, vnorm = 0;
+  for (size_t i = 0; i < u.size(); i++) {
+    dot += u[i] * v[i];
+    unorm += u[i] * u[i];
+    vnorm += v[i] * v[i];
+  }
+  if (unorm == 0 || vnorm == 0)
+    return 1;
+  return 1 - dot / sqrt(unorm * vnorm);
+}
+
 }  // namespace dfly::search
@@ -10,4 +10,9 @@ namespace dfly::search {
 
 float VectorDistance(const FtVector& v1, const FtVector& v2);
 
+float VectorDot(const FtVector& v1, const FtVector& v2);
+
+// 1 - cos(angle between v1 and v2). Zero vectors are at distance 1 from everything.
+float VectorCosineDistance(const FtVector& v1, const FtVector& v2);
+
 }  // namespace dfly::search
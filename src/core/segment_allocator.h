@@ -37,6 +37,12 @@ class SegmentAllocator {
 
   std::pair<Ptr, uint8_t*> Allocate(uint32_t size);
 
+  // Returns the compact pointer for the address `bytes` after p (bytes must be a multiple
+  // of 8 and stay within the allocation p points into).
+  static Ptr AdvancePtr(Ptr p, uint32_t bytes) {
+    return p + ((bytes / 8) << kSegmentIdBits);
+  }
+
   void Free(Ptr ptr) {
     void* p = Translate(ptr);
     used_ -= mi_usable_size(p);
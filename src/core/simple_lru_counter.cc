@@ -81,10 +81,13 @@ void SimpleLruCounter::BumpToHead(uint32_t index) {
 
   DCHECK(node.prev != node.next);
 
+  // Unlink the node and relink it between the tail and the head.
   node_arr_[node.prev].next = node.next;
   node_arr_[node.next].prev = node.prev;
   node.prev = tail;
-  node.prev = head_;
+  node.next = head_;
+  node_arr_[tail].next = index;
+  node_arr_[head_].prev = index;
   head_ = index;
 }
 };  // namespace dfly
@@ -45,4 +45,25 @@ TEST_F(SimpleLruTest, Basic) {
   ASSERT_EQ(6, cache_.Get("f"));
 }
 
+TEST_F(SimpleLruTest, BumpMiddle) {
+  cache_.Put("a", 1);
+  cache_.Put("b", 2);
+  cache_.Put("c", 3);
+  cache_.Put("d", 4);
+
+  // Bump a node from the middle of the list and verify the eviction order.
+  cache_.Put("b", 2);
+
+  cache_.Put("e", 5);
+  ASSERT_EQ(nullopt, cache_.Get("a"));
+
+  cache_.Put("f", 6);
+  ASSERT_EQ(nullopt, cache_.Get("c"));
+
+  ASSERT_EQ(2, cache_.Get("b"));
+  ASSERT_EQ(4, cache_.Get("d"));
+  ASSERT_EQ(5, cache_.Get("e"));
+  ASSERT_EQ(6, cache_.Get("f"));
+}
+
 }  // namespace dfly
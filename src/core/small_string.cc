@@ -29,12 +29,56 @@ class XXH3_Deleter {
 struct TL {
   unique_ptr<XXH3_state_t, XXH3_Deleter> xxh_state;
   unique_ptr<SegmentAllocator> seg_alloc;
+  uint32_t free_chunks = UINT32_MAX;  // freelist head for the small chunk pool.
 };
 
 thread_local TL tl;
 
 constexpr XXH64_hash_t kHashSeed = 24061983;  // same as in compact_object.cc
 
+// External chunks of up to kPoolChunkSize bytes (i.e. strings of up to
+// kPrefLen + kPoolChunkSize bytes overall - the typical session-token sizes) are carved
+// from slabs and recycled via a thread-local freelist, so assigning such values does not
+// reach the allocator at all. The chunk size is a multiple of 8 so that carved compact
+// pointers stay representable.
+constexpr uint32_t kPoolChunkSize = 24;
+constexpr uint32_t kPoolSlabChunks = 128;
+constexpr uint32_t kNullPtr = UINT32_MAX;
+
+inline bool IsPooledSize(size_t ext_size) {
+  return ext_size <= kPoolChunkSize;
+}
+
+pair<uint32_t, uint8_t*> AllocExternal(size_t ext_size) {
+  if (!IsPooledSize(ext_size))
+    return tl.seg_alloc->Allocate(ext_size);
+
+  if (tl.free_chunks == kNullPtr) {
+    auto [sp, rp] = tl.seg_alloc->Allocate(kPoolSlabChunks * kPoolChunkSize);
+    for (uint32_t i = kPoolSlabChunks; i-- > 0;) {
+      uint32_t cp = SegmentAllocator::AdvancePtr(sp, i * kPoolChunkSize);
+      *reinterpret_cast<uint32_t*>(rp + i * kPoolChunkSize) = tl.free_chunks;
+      tl.free_chunks = cp;
+    }
+  }
+
+  uint32_t cp = tl.free_chunks;
+  uint8_t* realptr = tl.seg_alloc->Translate(cp);
+  tl.free_chunks = *reinterpret_cast<uint32_t*>(realptr);
+  return {cp, realptr};
+}
+
+void FreeExternal(uint32_t p, size_t ext_size) {
+  if (!IsPooledSize(ext_size)) {
+    tl.seg_alloc->Free(p);
+    return;
+  }
+
+  uint8_t* realptr = tl.seg_alloc->Translate(p);
+  *reinterpret_cast<uint32_t*>(realptr) = tl.free_chunks;
+  tl.free_chunks = p;
+}
+
 }  // namespace
 
 void SmallString::InitThreadLocal(void* heap) {
@@ -59,7 +103,7 @@ size_t SmallString::Assign(std::string_view s) {
 
   if (size_ == 0) {
     // packed structs can not be tied here.
-    auto [sp, rp] = tl.seg_alloc->Allocate(s.size() - kPrefLen);
+    auto [sp, rp] = AllocExternal(s.size() - kPrefLen);
     small_ptr_ = sp;
     realptr = rp;
     size_ = s.size();
@@ -67,14 +111,22 @@ size_t SmallString::Assign(std::string_view s) {
     realptr = tl.seg_alloc->Translate(small_ptr_);
 
     if (s.size() < size_) {
-      size_t capacity = mi_usable_size(realptr);
-      if (s.size() * 2 < capacity) {
-        tl.seg_alloc->Free(small_ptr_);
-        auto [sp, rp] = tl.seg_alloc->Allocate(s.size() - kPrefLen);
-        small_ptr_ = sp;
-        realptr = rp;
+      if (IsPooledSize(size_ - kPrefLen)) {
+        // pooled chunks have a single size class, reuse in place.
+        size_ = s.size();
+      } else {
+        size_t capacity = mi_usable_size(realptr);
+
+        // reallocate either when it saves substantial memory or when the new size fits
+        // the chunk pool (the chunk must come from the pool for Free to recycle it).
+        if (s.size() * 2 < capacity || IsPooledSize(s.size() - kPrefLen)) {
+          tl.seg_alloc->Free(small_ptr_);
+          auto [sp, rp] = AllocExternal(s.size() - kPrefLen);
+          small_ptr_ = sp;
+          realptr = rp;
+        }
+        size_ = s.size();
       }
-      size_ = s.size();
     }
   } else {
     LOG(FATAL) << "TBD: Bad usage";
@@ -83,22 +135,25 @@ size_t SmallString::Assign(std::string_view s) {
   memcpy(prefix_, s.data(), kPrefLen);
   memcpy(realptr, s.data() + kPrefLen, s.size() - kPrefLen);
 
-  return mi_malloc_usable_size(realptr);
+  return IsPooledSize(size_ - kPrefLen) ? kPoolChunkSize : mi_malloc_usable_size(realptr);
 }
 
 void SmallString::Free() {
   if (size_ <= kPrefLen)
     return;
 
-  tl.seg_alloc->Free(small_ptr_);
+  FreeExternal(small_ptr_, size_ - kPrefLen);
   size_ = 0;
 }
 
 uint16_t SmallString::MallocUsed() const {
   if (size_ <= kPrefLen)
     return 0;
-  auto* realptr = tl.seg_alloc->Translate(small_ptr_);
 
+  if (IsPooledSize(size_ - kPrefLen))
+    return kPoolChunkSize;
+
+  auto* realptr = tl.seg_alloc->Translate(small_ptr_);
   return mi_malloc_usable_size(realptr);
 }
 
@@ -176,6 +231,10 @@ bool SmallString::DefragIfNeeded(float ratio) {
     return false;
   }
 
+  // pooled chunks are interior pointers of a slab, the page heuristics do not apply.
+  if (IsPooledSize(size_ - kPrefLen))
+    return false;
+
   uint8_t* cur_real_ptr = tl.seg_alloc->Translate(small_ptr_);
   if (!mi_heap_page_is_underutilized(tl.seg_alloc->heap(), cur_real_ptr, ratio))
     return false;
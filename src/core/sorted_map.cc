@@ -8,7 +8,7 @@
 
 extern "C" {
 #include "redis/listpack.h"
-#include "redis/redis_aux.h"
+#include "redis/object.h"
 #include "redis/util.h"
 #include "redis/zmalloc.h"
 }
@@ -21,14 +21,6 @@ namespace detail {
 
 namespace {
 
-// Approximated dictionary size.
-size_t DictMallocSize(dict* d) {
-  size_t res = zmalloc_usable_size(d->ht_table[0]) + zmalloc_usable_size(d->ht_table[1]) +
-               znallocx(sizeof(dict));
-
-  return res + dictSize(d) * 16;  // approximation.
-}
-
 unsigned char* zzlInsertAt(unsigned char* zl, unsigned char* eptr, sds ele, double score) {
   unsigned char* sptr;
   char scorebuf[128];
@@ -59,29 +51,33 @@ inline bool IsUnder(bool reverse, double score, const zrangespec& spec) {
 }  // namespace
 
 SortedMap::SortedMap() {
-  dict_ = dictCreate(&zsetDictType);
   zsl_ = zslCreate();
 }
 
 SortedMap::~SortedMap() {
-  dictRelease(dict_);
+  // The skiplist shares the member sds with scores_, which owns them; detach the nodes
+  // before freeing them.
+  for (zskiplistNode* node = zsl_->header->level[0].forward; node; node = node->level[0].forward)
+    node->ele = NULL;
   zslFree(zsl_);
 }
 
 size_t SortedMap::MallocSize() const {
-  // TODO: introduce a proper malloc usage tracking.
-  return DictMallocSize(dict_) + zmalloc_size(zsl_);
+  // TODO: account for the skiplist nodes as well.
+  return scores_.ObjMallocUsed() + scores_.SetMallocUsed() + zmalloc_size(zsl_);
 }
 
 bool SortedMap::Insert(double score, sds member) {
-  zskiplistNode* znode = zslInsert(zsl_, score, member);
-  int ret = dictAdd(dict_, member, &znode->score);
-  return ret == DICT_OK;
+  sds entry = scores_.AddUnique(string_view{member, sdslen(member)}, score);
+  if (entry == nullptr)
+    return false;
+
+  zslInsert(zsl_, score, entry);
+  sdsfree(member);
+  return true;
 }
 
 int SortedMap::Add(double score, sds ele, int in_flags, int* out_flags, double* newscore) {
-  zskiplistNode* znode;
-
   /* Turn options into simple to check vars. */
   const bool incr = (in_flags & ZADD_IN_INCR) != 0;
   const bool nx = (in_flags & ZADD_IN_NX) != 0;
@@ -92,15 +88,15 @@ int SortedMap::Add(double score, sds ele, int in_flags, int* out_flags, double*
   *out_flags = 0; /* We'll return our response flags. */
   double curscore;
 
-  dictEntry* de = dictFind(dict_, ele);
-  if (de != NULL) {
+  sds entry = scores_.FindEntry(string_view{ele, sdslen(ele)});
+  if (entry != NULL) {
     /* NX? Return, same element already exists. */
     if (nx) {
       *out_flags |= ZADD_OUT_NOP;
       return 1;
     }
 
-    curscore = *(double*)dictGetVal(de);
+    curscore = ScoreMap::GetScore(entry);
 
     /* Prepare the score for the increment if needed. */
     if (incr) {
@@ -122,18 +118,17 @@ int SortedMap::Add(double score, sds ele, int in_flags, int* out_flags, double*
 
     /* Remove and re-insert when score changes. */
     if (score != curscore) {
-      znode = zslUpdateScore(zsl_, curscore, ele, score);
-      /* Note that we did not removed the original element from
-       * the hash table representing the sorted set, so we just
-       * update the score. */
-      dictGetVal(de) = &znode->score; /* Update score ptr. */
+      zslUpdateScore(zsl_, curscore, entry, score);
+      /* The skiplist keeps the same shared sds, so only the inline score needs
+       * an update. */
+      ScoreMap::SetScore(entry, score);
       *out_flags |= ZADD_OUT_UPDATED;
     }
     return 1;
   } else if (!xx) {
-    ele = sdsdup(ele);
-    znode = zslInsert(zsl_, score, ele);
-    CHECK_EQ(DICT_OK, dictAdd(dict_, ele, &znode->score));
+    entry = scores_.AddUnique(string_view{ele, sdslen(ele)}, score);
+    DCHECK(entry != nullptr);
+    zslInsert(zsl_, score, entry);
 
     *out_flags |= ZADD_OUT_ADDED;
     if (newscore)
@@ -177,6 +172,58 @@ unique_ptr<SortedMap> SortedMap::FromListPack(const uint8_t* lp) {
   return zs;
 }
 
+unique_ptr<SortedMap> SortedMap::FromSortedBatch(
+    absl::Span<const pair<double, string_view>> batch) {
+  unique_ptr<SortedMap> zs(new SortedMap());
+  zs->Reserve(batch.size());
+
+  zskiplist* zsl = zs->zsl_;
+
+  // Rightmost node per level (the header stands in while a level is empty) together with
+  // its level-0 rank. Appending at the tail only touches these, so no descents are needed.
+  zskiplistNode* tails[ZSKIPLIST_MAXLEVEL];
+  unsigned long rank[ZSKIPLIST_MAXLEVEL];
+  for (int i = 0; i < ZSKIPLIST_MAXLEVEL; ++i) {
+    tails[i] = zsl->header;
+    rank[i] = 0;
+  }
+
+  for (const auto& [score, member] : batch) {
+    DCHECK(!isnan(score));
+
+    sds ele = zs->scores_.AddUnique(member, score);
+    DCHECK(ele != nullptr);
+    int level = zslRandomLevel();
+    int prev_level = zsl->level;
+    if (level > prev_level)
+      zsl->level = level;
+
+    zskiplistNode* prev = tails[0];
+    zskiplistNode* x = zslCreateNode(level, score, ele);
+    unsigned long x_rank = zsl->length + 1;
+
+    for (int i = 0; i < level; ++i) {
+      x->level[i].forward = NULL;
+      x->level[i].span = 0;
+      tails[i]->level[i].forward = x;
+      tails[i]->level[i].span = x_rank - rank[i];
+      tails[i] = x;
+      rank[i] = x_rank;
+    }
+
+    // Levels above x still end in their old tails; their distance to the end grew by one.
+    for (int i = level; i < prev_level; ++i) {
+      tails[i]->level[i].span++;
+    }
+
+    x->backward = (prev == zsl->header) ? NULL : prev;
+    zsl->tail = x;
+    zsl->length++;
+  }
+
+  return zs;
+}
+
 // taken from zsetConvert
 uint8_t* SortedMap::ToListPack() const {
   uint8_t* lp = lpNew(0);
@@ -195,45 +242,38 @@ uint8_t* SortedMap::ToListPack() const {
 
 // returns true if the element was deleted.
 bool SortedMap::Delete(sds ele) {
-  // Taken from zsetRemoveFromSkiplist.
-
-  dictEntry* de = dictUnlink(dict_, ele);
-  if (de == NULL)
+  std::optional<double> score = scores_.Find(string_view{ele, sdslen(ele)});
+  if (!score)
     return false;
 
-  /* Get the score in order to delete from the skiplist later. */
-  double score = *(double*)dictGetVal(de);
-
-  /* Delete from the hash table and later from the skiplist.
-   * Note that the order is important: deleting from the skiplist
-   * actually releases the SDS string representing the element,
-   * which is shared between the skiplist and the hash table, so
-   * we need to delete from the skiplist as the final step. */
-  dictFreeUnlinkedEntry(dict_, de);
-  if (htNeedsResize(dict_))
-    dictResize(dict_);
+  DeleteShared(ele, *score);
+  return true;
+}
 
-  /* Delete from skiplist. */
-  int retval = zslDelete(zsl_, score, ele, NULL);
+void SortedMap::DeleteShared(sds ele, double score) {
+  zskiplistNode* node = NULL;
+  int retval = zslDelete(zsl_, score, ele, &node);
   DCHECK(retval);
+  (void)retval;
 
-  return true;
+  /* The node shares its sds with the ScoreMap entry, which owns it; detach the node
+   * so that only the map frees the member bytes. */
+  node->ele = NULL;
+  zslFreeNode(node);
+
+  CHECK(scores_.Erase(string_view{ele, sdslen(ele)}));
 }
 
 std::optional<double> SortedMap::GetScore(sds ele) const {
-  dictEntry* de = dictFind(dict_, ele);
-  if (de == NULL)
-    return std::nullopt;
-
-  return *(double*)dictGetVal(de);
+  return scores_.Find(string_view{ele, sdslen(ele)});
 }
 
 std::optional<unsigned> SortedMap::GetRank(sds ele, bool reverse) const {
-  dictEntry* de = dictFind(dict_, ele);
-  if (de == NULL)
+  std::optional<double> found = scores_.Find(string_view{ele, sdslen(ele)});
+  if (!found)
     return nullopt;
 
-  double score = *(double*)dictGetVal(de);
+  double score = *found;
   unsigned rank = zslGetRank(zsl_, score, ele);
 
   /* Existing elements always have a rank. */
@@ -321,12 +361,13 @@ auto SortedMap::PopTopScores(unsigned count, bool reverse) -> ScoredArray {
 
   ScoredArray result;
   while (ln && count--) {
+    zskiplistNode* next = Next(reverse, ln);
     result.emplace_back(string{ln->ele, sdslen(ln->ele)}, ln->score);
 
     /* we can delete the element now */
-    CHECK(Delete(ln->ele));
+    DeleteShared(ln->ele, ln->score);
 
-    ln = Next(reverse, ln);
+    ln = next;
   }
   return result;
 }
@@ -376,6 +417,57 @@ size_t SortedMap::LexCount(const zlexrangespec& range) const {
   return count;
 }
 
+size_t SortedMap::DeleteRangeByRank(unsigned start, unsigned end) {
+  /* Collect the victims first - deleting while walking would free the nodes under us. */
+  vector<pair<sds, double>> victims;
+  victims.reserve(end - start + 1);
+  Iterate(start, end - start + 1, false, [&](sds ele, double score) {
+    victims.emplace_back(ele, score);
+    return true;
+  });
+
+  for (const auto& [ele, score] : victims)
+    DeleteShared(ele, score);
+
+  return victims.size();
+}
+
+size_t SortedMap::DeleteRangeByScore(const zrangespec& range) {
+  vector<pair<sds, double>> victims;
+  for (zskiplistNode* ln = zslFirstInRange(zsl_, &range);
+       ln && zslValueLteMax(ln->score, &range); ln = ln->level[0].forward) {
+    victims.emplace_back(ln->ele, ln->score);
+  }
+
+  for (const auto& [ele, score] : victims)
+    DeleteShared(ele, score);
+
+  return victims.size();
+}
+
+size_t SortedMap::DeleteRangeByLex(const zlexrangespec& range) {
+  vector<pair<sds, double>> victims;
+  for (zskiplistNode* ln = zslFirstInLexRange(zsl_, &range);
+       ln && zslLexValueLteMax(ln->ele, &range); ln = ln->level[0].forward) {
+    victims.emplace_back(ln->ele, ln->score);
+  }
+
+  for (const auto& [ele, score] : victims)
+    DeleteShared(ele, score);
+
+  return victims.size();
+}
+
+uint64_t SortedMap::Scan(uint64_t cursor,
+                         absl::FunctionRef<void(std::string_view, double)> cb) const {
+  auto scan_cb = [&cb](const void* obj) {
+    sds ele = (sds)obj;
+    cb(string_view{ele, sdslen(ele)}, ScoreMap::GetScore(ele));
+  };
+
+  return scores_.Scan(static_cast<uint32_t>(cursor), scan_cb);
+}
+
 bool SortedMap::Iterate(unsigned start_rank, unsigned len, bool reverse,
                         absl::FunctionRef<bool(sds, double)> cb) const {
   zskiplistNode* ln;
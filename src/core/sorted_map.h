@@ -5,25 +5,30 @@
 #pragma once
 
 #include <absl/functional/function_ref.h>
+#include <absl/types/span.h>
 
 #include <memory>
 #include <optional>
 #include <string>
+#include <string_view>
+#include <utility>
 #include <vector>
 
 extern "C" {
-#include "redis/dict.h"
 #include "redis/zset.h"
 }
 
+#include "core/score_map.h"
+
 namespace dfly {
 namespace detail {
 
 /**
  * @brief SortedMap is a sorted map implementation based on zset.h. It holds unique strings that
  * are ordered by score and lexicographically. The score is a double value and has higher priority.
- * The map is implemented as a skip list and a hash table. For more details see
- * zset.h and t_zset.c files in Redis.
+ * The map is implemented as a skip list plus a ScoreMap that stores the score inline with
+ * the member bytes; the member sds is shared between both structures and is owned by the
+ * ScoreMap. For the skiplist details see zset.h and t_zset.c files in Redis.
  */
 class SortedMap {
  public:
@@ -39,37 +44,35 @@ class SortedMap {
   // The ownership for the returned SortedMap stays with the caller
   static std::unique_ptr<SortedMap> FromListPack(const uint8_t* lp);
 
+  // Bulk-builds a map from a batch that is sorted by (score, member), has unique members
+  // and no NaN scores. Skiplist nodes are appended at the tail while tracking the
+  // rightmost node per level, so construction costs O(n) comparisons instead of an
+  // O(log n) descent per member.
+  static std::unique_ptr<SortedMap> FromSortedBatch(
+      absl::Span<const std::pair<double, std::string_view>> batch);
+
   size_t Size() const {
     return zsl_->length;
   }
 
   bool Reserve(size_t sz) {
-    return dictExpand(dict_, sz) == DICT_OK;
+    scores_.Reserve(sz);
+    return true;
   }
 
   // Interface equivalent to zsetAdd.
   int Add(double score, sds ele, int in_flags, int* out_flags, double* newscore);
 
+  // Inserts a new member. Returns false if the member already exists, otherwise
+  // consumes `member` and returns true.
   bool Insert(double score, sds member);
 
   uint8_t* ToListPack() const;
   size_t MallocSize() const;
 
-  dict* GetDict() const {
-    return dict_;
-  }
-
-  size_t DeleteRangeByRank(unsigned start, unsigned end) {
-    return zslDeleteRangeByRank(zsl_, start + 1, end + 1, dict_);
-  }
-
-  size_t DeleteRangeByScore(const zrangespec& range) {
-    return zslDeleteRangeByScore(zsl_, &range, dict_);
-  }
-
-  size_t DeleteRangeByLex(const zlexrangespec& range) {
-    return zslDeleteRangeByLex(zsl_, &range, dict_);
-  }
+  size_t DeleteRangeByRank(unsigned start, unsigned end);
+  size_t DeleteRangeByScore(const zrangespec& range);
+  size_t DeleteRangeByLex(const zlexrangespec& range);
 
   // returns true if the element was deleted.
   bool Delete(sds ele);
@@ -91,8 +94,15 @@ class SortedMap {
   bool Iterate(unsigned start_rank, unsigned len, bool reverse,
                absl::FunctionRef<bool(sds, double)> cb) const;
 
+  // Incremental iteration over (member, score) pairs with SCAN cursor semantics,
+  // see DenseSet::Scan. A zero return value means the iteration is complete.
+  uint64_t Scan(uint64_t cursor, absl::FunctionRef<void(std::string_view, double)> cb) const;
+
  private:
-  dict* dict_ = nullptr;
+  // Removes ele from both structures and frees it. ele must be present.
+  void DeleteShared(sds ele, double score);
+
+  ScoreMap scores_;
   zskiplist* zsl_ = nullptr;
 };
 
@@ -2,7 +2,10 @@
 // See LICENSE for licensing terms.
 //
 
+#include "core/sorted_map.h"
+
 #include <absl/container/btree_map.h>
+#include <absl/strings/str_cat.h>
 #include <mimalloc.h>
 
 #include "base/gtest.h"
@@ -53,4 +56,49 @@ TEST_F(SortedMapTest, MemoryUsage) {
   LOG(INFO) << "btree after: " << zmalloc_used_memory_tl + mi_alloc.used() << " bytes";
 }
 
+TEST_F(SortedMapTest, FromSortedBatch) {
+  constexpr size_t kNumMembers = 10'000;
+
+  std::vector<std::string> members(kNumMembers);
+  std::vector<std::pair<double, std::string_view>> batch(kNumMembers);
+  for (size_t i = 0; i < kNumMembers; ++i) {
+    members[i] = absl::StrCat("member:", 1000000 + i);
+    batch[i] = {double(i / 2), members[i]};  // duplicate scores must be handled as well.
+  }
+
+  auto sm = detail::SortedMap::FromSortedBatch(batch);
+  ASSERT_EQ(kNumMembers, sm->Size());
+
+  // The bulk-built skiplist must answer rank/score queries like an incrementally built one.
+  sds tmp = sdsempty();
+  for (size_t i = 0; i < kNumMembers; i += 97) {
+    tmp = sdscpylen(tmp, members[i].data(), members[i].size());
+    EXPECT_EQ(i, sm->GetRank(tmp, false));
+    EXPECT_EQ(kNumMembers - 1 - i, sm->GetRank(tmp, true));
+    EXPECT_EQ(double(i / 2), sm->GetScore(tmp));
+  }
+  sdsfree(tmp);
+
+  zrangespec range;
+  range.min = 10;
+  range.max = 11;
+  range.minex = range.maxex = 0;
+  EXPECT_EQ(4u, sm->Count(range));
+
+  auto arr = sm->GetRange(range, 0, 10, false);
+  ASSERT_EQ(4u, arr.size());
+  EXPECT_EQ(members[20], arr.front().first);
+  EXPECT_EQ(members[23], arr.back().first);
+
+  // Iteration visits members in batch order.
+  size_t idx = 0;
+  sm->Iterate(0, kNumMembers, false, [&](sds ele, double score) {
+    EXPECT_EQ(members[idx], std::string_view(ele, sdslen(ele)));
+    EXPECT_EQ(double(idx / 2), score);
+    ++idx;
+    return true;
+  });
+  EXPECT_EQ(kNumMembers, idx);
+}
+
 }  // namespace dfly
@@ -0,0 +1,194 @@
+// Copyright 2023, DragonflyDB authors.  All rights reserved.
+// See LICENSE for licensing terms.
+//
+
+#include "core/sparse_bitmap.h"
+
+#include <absl/numeric/bits.h>
+
+#include <algorithm>
+#include <cstring>
+
+#include "base/logging.h"
+
+namespace dfly {
+
+namespace {
+
+constexpr size_t kBitsPerByte = 8;
+
+// Bit index inside its byte, MSB-first as SETBIT counts.
+inline unsigned BitInByte(size_t offset) {
+  return (kBitsPerByte - 1) - offset % kBitsPerByte;
+}
+
+inline size_t Popcount(const uint8_t* data, size_t len) {
+  size_t count = 0;
+  size_t i = 0;
+  for (; i + 8 <= len; i += 8) {
+    uint64_t word;
+    memcpy(&word, data + i, 8);
+    count += absl::popcount(word);
+  }
+  for (; i < len; ++i) {
+    count += absl::popcount(unsigned{data[i]});
+  }
+  return count;
+}
+
+}  // namespace
+
+SparseBitmap::SparseBitmap(MemoryResource* mr) : mr_(mr), table_(PtrAllocator{mr}) {
+}
+
+SparseBitmap::~SparseBitmap() {
+  for (uint8_t* chunk : table_) {
+    if (chunk)
+      mr_->deallocate(chunk, kChunkBytes);
+  }
+}
+
+bool SparseBitmap::GetBit(size_t offset) const {
+  size_t byte_index = offset / kBitsPerByte;
+  if (byte_index >= byte_size_)
+    return false;
+
+  const uint8_t* chunk_ptr = chunk(byte_index);
+  if (!chunk_ptr)
+    return false;
+
+  return chunk_ptr[byte_index % kChunkBytes] & (1u << BitInByte(offset));
+}
+
+bool SparseBitmap::SetBit(size_t offset, bool value) {
+  size_t byte_index = offset / kBitsPerByte;
+  if (byte_index >= byte_size_)
+    byte_size_ = byte_index + 1;
+
+  // Clearing a bit of an absent chunk is a no-op; do not allocate for it.
+  if (!value && chunk(byte_index) == nullptr)
+    return false;
+
+  uint8_t* chunk_ptr = TouchChunk(byte_index);
+  uint8_t& byte = chunk_ptr[byte_index % kChunkBytes];
+  uint8_t mask = 1u << BitInByte(offset);
+
+  bool old_value = byte & mask;
+  if (value)
+    byte |= mask;
+  else
+    byte &= ~mask;
+  return old_value;
+}
+
+uint8_t SparseBitmap::GetByte(size_t index) const {
+  DCHECK_LT(index, byte_size_);
+
+  const uint8_t* chunk_ptr = chunk(index);
+  return chunk_ptr ? chunk_ptr[index % kChunkBytes] : 0;
+}
+
+void SparseBitmap::Assign(std::string_view data) {
+  for (uint8_t* chunk : table_) {
+    if (chunk)
+      mr_->deallocate(chunk, kChunkBytes);
+  }
+  table_.clear();
+  num_chunks_ = 0;
+  byte_size_ = data.size();
+
+  table_.resize((data.size() + kChunkBytes - 1) / kChunkBytes, nullptr);
+  for (size_t i = 0; i < data.size(); i += kChunkBytes) {
+    std::string_view piece = data.substr(i, kChunkBytes);
+    if (piece.find_first_not_of('\0') == std::string_view::npos)
+      continue;
+
+    uint8_t* chunk_ptr = TouchChunk(i);
+    memcpy(chunk_ptr, piece.data(), piece.size());
+  }
+}
+
+size_t SparseBitmap::CountBytesRange(size_t start, size_t end) const {
+  end = std::min(end, byte_size_);
+
+  size_t count = 0;
+  while (start < end) {
+    size_t in_chunk = std::min(end - start, kChunkBytes - start % kChunkBytes);
+
+    const uint8_t* chunk_ptr = chunk(start);
+    if (chunk_ptr)
+      count += Popcount(chunk_ptr + start % kChunkBytes, in_chunk);
+    start += in_chunk;
+  }
+  return count;
+}
+
+int64_t SparseBitmap::FindFirstBit(bool value, int64_t start, int64_t end) const {
+  if (start < 0)
+    start = 0;
+  end = std::min(end, int64_t(byte_size_ * kBitsPerByte) - 1);
+
+  int64_t bit = start;
+  while (bit <= end) {
+    size_t byte_index = bit / kBitsPerByte;
+
+    const uint8_t* chunk_ptr = chunk(byte_index);
+    if (!chunk_ptr) {
+      // The whole chunk reads as zeroes: an immediate hit for value=false, skipped
+      // wholesale for value=true.
+      if (!value)
+        return bit;
+      bit = (byte_index / kChunkBytes + 1) * kChunkBytes * kBitsPerByte;
+      continue;
+    }
+
+    uint8_t byte = chunk_ptr[byte_index % kChunkBytes];
+    unsigned first = bit % kBitsPerByte;
+    for (unsigned j = first; j < kBitsPerByte; ++j) {
+      int64_t pos = byte_index * kBitsPerByte + j;
+      if (pos > end)
+        return -1;
+      if (bool(byte & (1u << (kBitsPerByte - 1 - j))) == value)
+        return pos;
+    }
+    bit = (byte_index + 1) * kBitsPerByte;
+  }
+  return -1;
+}
+
+void SparseBitmap::Materialize(char* dest) const {
+  size_t pos = 0;
+  while (pos < byte_size_) {
+    size_t in_chunk = std::min(byte_size_ - pos, kChunkBytes);
+
+    const uint8_t* chunk_ptr = chunk(pos);
+    if (chunk_ptr)
+      memcpy(dest + pos, chunk_ptr, in_chunk);
+    else
+      memset(dest + pos, 0, in_chunk);
+    pos += in_chunk;
+  }
+}
+
+double SparseBitmap::Occupancy() const {
+  return byte_size_ ? double(allocated_bytes()) / double(byte_size_) : 0;
+}
+
+size_t SparseBitmap::MallocUsed() const {
+  return allocated_bytes() + table_.capacity() * sizeof(uint8_t*);
+}
+
+uint8_t* SparseBitmap::TouchChunk(size_t byte_index) {
+  size_t ci = byte_index / kChunkBytes;
+  if (ci >= table_.size())
+    table_.resize(ci + 1, nullptr);
+
+  if (!table_[ci]) {
+    table_[ci] = static_cast<uint8_t*>(mr_->allocate(kChunkBytes));
+    memset(table_[ci], 0, kChunkBytes);
+    ++num_chunks_;
+  }
+  return table_[ci];
+}
+
+}  // namespace dfly
@@ -0,0 +1,100 @@
+// Copyright 2023, DragonflyDB authors.  All rights reserved.
+// See LICENSE for licensing terms.
+//
+
+#pragma once
+
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+#ifdef __clang__
+#include <experimental/memory_resource>
+namespace PMR_NS = std::experimental::pmr;
+#else
+#include <memory_resource>
+namespace PMR_NS = std::pmr;
+#endif
+
+namespace dfly {
+
+// A sparse bitmap: a page table of 4KB chunks, allocated on first touch. Backs huge,
+// mostly-zero string values (e.g. user-id indexed bitmaps) so that SETBIT at a high
+// offset costs a single chunk instead of materializing the whole zero run.
+//
+// The logical value is a string of byte_size() bytes; bytes covered by an absent chunk
+// read as zero. Bit numbering follows SETBIT: bit 0 is the most significant bit of
+// byte 0.
+class SparseBitmap {
+ public:
+  static constexpr size_t kChunkBytes = 4096;
+
+  using MemoryResource = PMR_NS::memory_resource;
+
+  explicit SparseBitmap(MemoryResource* mr = PMR_NS::get_default_resource());
+
+  SparseBitmap(const SparseBitmap&) = delete;
+  SparseBitmap& operator=(const SparseBitmap&) = delete;
+
+  ~SparseBitmap();
+
+  // Logical length in bytes - what STRLEN reports.
+  size_t byte_size() const {
+    return byte_size_;
+  }
+
+  // Returns the bit at offset, false beyond byte_size().
+  bool GetBit(size_t offset) const;
+
+  // Sets the bit at offset, returning its previous value. Grows byte_size() to cover
+  // offset; only the touched chunk is allocated.
+  bool SetBit(size_t offset, bool value);
+
+  // Returns the byte at index, 0 if the backing chunk was never touched.
+  // Requires: index < byte_size().
+  uint8_t GetByte(size_t index) const;
+
+  // Replaces the contents with a copy of data. All-zero chunks of data stay unallocated.
+  void Assign(std::string_view data);
+
+  // Popcount over the byte range [start, end), clamped to byte_size(). Absent chunks
+  // contribute nothing and are skipped without touching memory.
+  size_t CountBytesRange(size_t start, size_t end) const;
+
+  // Returns the smallest bit position in [start, end] (inclusive, clamped to the bitmap)
+  // holding `value`, or -1. An absent chunk satisfies value=false immediately and is
+  // skipped wholesale for value=true.
+  int64_t FindFirstBit(bool value, int64_t start, int64_t end) const;
+
+  // Writes the logical value into dest, which must have room for byte_size() bytes.
+  void Materialize(char* dest) const;
+
+  size_t allocated_bytes() const {
+    return num_chunks_ * kChunkBytes;
+  }
+
+  // Fraction of the logical length that is backed by allocated chunks. Once most of the
+  // value is materialized anyway, the page table stops paying for itself and the owner
+  // should convert back to a plain string.
+  double Occupancy() const;
+
+  size_t MallocUsed() const;
+
+ private:
+  uint8_t* chunk(size_t byte_index) const {
+    size_t ci = byte_index / kChunkBytes;
+    return ci < table_.size() ? table_[ci] : nullptr;
+  }
+
+  // Allocates (zeroed) the chunk covering byte_index if needed and returns it.
+  uint8_t* TouchChunk(size_t byte_index);
+
+  using PtrAllocator = PMR_NS::polymorphic_allocator<uint8_t*>;
+
+  MemoryResource* mr_;
+  std::vector<uint8_t*, PtrAllocator> table_;
+  size_t byte_size_ = 0;
+  size_t num_chunks_ = 0;
+};
+
+}  // namespace dfly
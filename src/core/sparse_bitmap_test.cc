@@ -0,0 +1,92 @@
+// Copyright 2023, DragonflyDB authors.  All rights reserved.
+// See LICENSE for licensing terms.
+//
+
+#include "core/sparse_bitmap.h"
+
+#include "base/gtest.h"
+#include "base/logging.h"
+
+using namespace std;
+
+namespace dfly {
+
+class SparseBitmapTest : public ::testing::Test {
+ protected:
+  SparseBitmap bitmap_;
+};
+
+TEST_F(SparseBitmapTest, SetGet) {
+  EXPECT_EQ(0u, bitmap_.byte_size());
+  EXPECT_FALSE(bitmap_.GetBit(0));
+
+  EXPECT_FALSE(bitmap_.SetBit(7, true));
+  EXPECT_EQ(1u, bitmap_.byte_size());
+  EXPECT_TRUE(bitmap_.GetBit(7));
+  EXPECT_FALSE(bitmap_.GetBit(6));
+  EXPECT_EQ(1u, bitmap_.GetByte(0));  // bit 7 is the LSB of byte 0.
+
+  EXPECT_TRUE(bitmap_.SetBit(7, false));
+  EXPECT_FALSE(bitmap_.GetBit(7));
+}
+
+TEST_F(SparseBitmapTest, SparseAllocation) {
+  // A single high bit costs one chunk; the zero run in between stays virtual.
+  size_t offset = 100'000'000;
+  bitmap_.SetBit(offset, true);
+  EXPECT_EQ(offset / 8 + 1, bitmap_.byte_size());
+  EXPECT_EQ(SparseBitmap::kChunkBytes, bitmap_.allocated_bytes());
+  EXPECT_TRUE(bitmap_.GetBit(offset));
+  EXPECT_FALSE(bitmap_.GetBit(offset - 1));
+
+  // Clearing a bit inside an absent chunk does not allocate.
+  bitmap_.SetBit(1000, false);
+  EXPECT_EQ(SparseBitmap::kChunkBytes, bitmap_.allocated_bytes());
+}
+
+TEST_F(SparseBitmapTest, Count) {
+  bitmap_.SetBit(0, true);
+  bitmap_.SetBit(100, true);
+  bitmap_.SetBit(1'000'000, true);
+
+  EXPECT_EQ(3u, bitmap_.CountBytesRange(0, bitmap_.byte_size()));
+  EXPECT_EQ(2u, bitmap_.CountBytesRange(0, 1000));
+  EXPECT_EQ(1u, bitmap_.CountBytesRange(12, 1000));
+  EXPECT_EQ(0u, bitmap_.CountBytesRange(13, 1000));
+}
+
+TEST_F(SparseBitmapTest, FindFirstBit) {
+  bitmap_.SetBit(1'000'000, true);
+
+  EXPECT_EQ(1'000'000, bitmap_.FindFirstBit(true, 0, INT64_MAX));
+  EXPECT_EQ(0, bitmap_.FindFirstBit(false, 0, INT64_MAX));
+  EXPECT_EQ(-1, bitmap_.FindFirstBit(true, 1'000'001, INT64_MAX));
+  EXPECT_EQ(-1, bitmap_.FindFirstBit(true, 0, 999'999));
+  EXPECT_EQ(1'000'001, bitmap_.FindFirstBit(false, 1'000'000, INT64_MAX));
+}
+
+TEST_F(SparseBitmapTest, AssignMaterialize) {
+  string src(SparseBitmap::kChunkBytes * 3, '\0');
+  src[SparseBitmap::kChunkBytes * 2] = 'x';
+  bitmap_.Assign(src);
+
+  // Only the chunk holding 'x' is backed by memory.
+  EXPECT_EQ(src.size(), bitmap_.byte_size());
+  EXPECT_EQ(SparseBitmap::kChunkBytes, bitmap_.allocated_bytes());
+
+  string dest(bitmap_.byte_size(), 'y');
+  bitmap_.Materialize(dest.data());
+  EXPECT_EQ(src, dest);
+}
+
+TEST_F(SparseBitmapTest, Occupancy) {
+  bitmap_.SetBit(SparseBitmap::kChunkBytes * 8 * 10 - 1, true);
+  EXPECT_DOUBLE_EQ(0.1, bitmap_.Occupancy());
+
+  for (unsigned i = 0; i < 5; ++i) {
+    bitmap_.SetBit(size_t(i) * SparseBitmap::kChunkBytes * 8, true);
+  }
+  EXPECT_DOUBLE_EQ(0.6, bitmap_.Occupancy());
+}
+
+}  // namespace dfly
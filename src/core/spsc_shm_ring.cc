@@ -0,0 +1,164 @@
+// Copyright 2023, DragonflyDB authors.  All rights reserved.
+// See LICENSE for licensing terms.
+//
+#include "core/spsc_shm_ring.h"
+
+#include <absl/numeric/bits.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cstring>
+
+#include "base/logging.h"
+
+namespace dfly {
+
+using namespace std;
+
+namespace {
+
+constexpr size_t kHeaderLen = 4096;  // page aligned so the data region is as well.
+constexpr size_t kMinCapacity = 4096;
+
+inline error_code Errno() {
+  return error_code(errno, system_category());
+}
+
+}  // namespace
+
+struct SpscShmRing::Header {
+  atomic<uint64_t> head;  // total bytes ever pushed, advanced by the producer.
+  atomic<uint64_t> tail;  // total bytes ever popped, advanced by the consumer.
+  uint64_t capacity;
+};
+
+static_assert(sizeof(SpscShmRing::Header) <= kHeaderLen);
+
+SpscShmRing::SpscShmRing(SpscShmRing&& o) noexcept
+    : header_(o.header_), data_(o.data_), capacity_(o.capacity_), memfd_(o.memfd_),
+      owns_fd_(o.owns_fd_) {
+  o.header_ = nullptr;
+  o.data_ = nullptr;
+  o.capacity_ = 0;
+  o.memfd_ = -1;
+  o.owns_fd_ = false;
+}
+
+SpscShmRing::~SpscShmRing() {
+  if (header_) {
+    munmap(header_, kHeaderLen + capacity_);
+  }
+  if (owns_fd_ && memfd_ >= 0) {
+    close(memfd_);
+  }
+}
+
+error_code SpscShmRing::Create(size_t capacity) {
+  DCHECK(!header_);
+
+  capacity_ = absl::bit_ceil(max(capacity, kMinCapacity));
+
+  memfd_ = memfd_create("dfly-shm-ring", MFD_CLOEXEC);
+  if (memfd_ < 0)
+    return Errno();
+  owns_fd_ = true;
+
+  size_t total = kHeaderLen + capacity_;
+  if (ftruncate(memfd_, total) < 0)
+    return Errno();
+
+  void* ptr = mmap(nullptr, total, PROT_READ | PROT_WRITE, MAP_SHARED, memfd_, 0);
+  if (ptr == MAP_FAILED)
+    return Errno();
+
+  header_ = new (ptr) Header{};
+  header_->capacity = capacity_;
+  data_ = reinterpret_cast<uint8_t*>(ptr) + kHeaderLen;
+
+  return error_code{};
+}
+
+error_code SpscShmRing::Attach(int fd) {
+  DCHECK(!header_);
+
+  struct stat st;
+  if (fstat(fd, &st) < 0)
+    return Errno();
+
+  size_t total = st.st_size;
+  if (total < kHeaderLen + kMinCapacity)
+    return make_error_code(errc::invalid_argument);
+
+  void* ptr = mmap(nullptr, total, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  if (ptr == MAP_FAILED)
+    return Errno();
+
+  header_ = reinterpret_cast<Header*>(ptr);
+  capacity_ = header_->capacity;
+  if (capacity_ != total - kHeaderLen || !absl::has_single_bit(capacity_)) {
+    munmap(ptr, total);
+    header_ = nullptr;
+    return make_error_code(errc::invalid_argument);
+  }
+  data_ = reinterpret_cast<uint8_t*>(ptr) + kHeaderLen;
+  memfd_ = fd;
+
+  return error_code{};
+}
+
+bool SpscShmRing::TryPush(const void* data, uint32_t len) {
+  DCHECK(header_);
+
+  uint64_t head = header_->head.load(memory_order_relaxed);
+  uint64_t tail = header_->tail.load(memory_order_acquire);
+
+  size_t frame_len = sizeof(uint32_t) + len;
+  if (frame_len > capacity_ - (head - tail))
+    return false;
+
+  const size_t mask = capacity_ - 1;
+  auto copy_in = [&](const void* src, size_t n) {
+    size_t pos = head & mask;
+    size_t contig = min(n, capacity_ - pos);
+    memcpy(data_ + pos, src, contig);
+    memcpy(data_, reinterpret_cast<const uint8_t*>(src) + contig, n - contig);
+    head += n;
+  };
+
+  copy_in(&len, sizeof(len));
+  copy_in(data, len);
+
+  header_->head.store(head, memory_order_release);
+  return true;
+}
+
+bool SpscShmRing::TryPop(string* dest) {
+  DCHECK(header_);
+
+  uint64_t tail = header_->tail.load(memory_order_relaxed);
+  uint64_t head = header_->head.load(memory_order_acquire);
+  if (tail == head)
+    return false;
+
+  const size_t mask = capacity_ - 1;
+  auto copy_out = [&](void* dst, size_t n) {
+    size_t pos = tail & mask;
+    size_t contig = min(n, capacity_ - pos);
+    memcpy(dst, data_ + pos, contig);
+    memcpy(reinterpret_cast<uint8_t*>(dst) + contig, data_, n - contig);
+    tail += n;
+  };
+
+  uint32_t len = 0;
+  copy_out(&len, sizeof(len));
+  DCHECK_LE(len, head - tail);
+
+  dest->resize(len);
+  copy_out(dest->data(), len);
+
+  header_->tail.store(tail, memory_order_release);
+  return true;
+}
+
+}  // namespace dfly
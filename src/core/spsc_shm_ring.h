@@ -0,0 +1,67 @@
+// Copyright 2023, DragonflyDB authors.  All rights reserved.
+// See LICENSE for licensing terms.
+//
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <system_error>
+
+namespace dfly {
+
+/**
+ * A single-producer single-consumer frame ring shared between processes through a memfd
+ * mapping. The server creates the ring and passes the memfd to an on-host client over a
+ * unix domain socket (SCM_RIGHTS), after which both sides exchange frames through shared
+ * memory without any syscalls on the data path.
+ *
+ * The mapping starts with a page-aligned header holding the monotonically increasing
+ * head/tail positions, followed by a power-of-2 sized data region. Each frame is a
+ * 4 byte length prefix plus payload, stored with wrap-around. Push and pop never block -
+ * callers decide how to wait (busy-poll for latency, or kick over the socket).
+ */
+class SpscShmRing {
+  SpscShmRing(const SpscShmRing&) = delete;
+  void operator=(const SpscShmRing&) = delete;
+
+ public:
+  SpscShmRing() = default;
+  SpscShmRing(SpscShmRing&& o) noexcept;
+  ~SpscShmRing();
+
+  // Creates a ring backed by a fresh memfd. capacity is rounded up to a power of 2.
+  std::error_code Create(size_t capacity);
+
+  // Maps a ring created elsewhere from its memfd. Does not take ownership of fd.
+  std::error_code Attach(int fd);
+
+  // Appends a frame. Returns false if the ring does not have room for it.
+  // Must be called from a single producer.
+  bool TryPush(const void* data, uint32_t len);
+
+  // Pops the next frame into dest. Returns false if the ring is empty.
+  // Must be called from a single consumer.
+  bool TryPop(std::string* dest);
+
+  // The fd to hand over to the peer. Owned by the ring iff it was Create()d.
+  int memfd() const {
+    return memfd_;
+  }
+
+  size_t capacity() const {
+    return capacity_;
+  }
+
+ private:
+  struct Header;
+
+  Header* header_ = nullptr;
+  uint8_t* data_ = nullptr;
+  size_t capacity_ = 0;
+  int memfd_ = -1;
+  bool owns_fd_ = false;
+};
+
+}  // namespace dfly
@@ -0,0 +1,78 @@
+// Copyright 2023, DragonflyDB authors.  All rights reserved.
+// See LICENSE for licensing terms.
+//
+#include "core/spsc_shm_ring.h"
+
+#include "base/gtest.h"
+#include "base/logging.h"
+
+namespace dfly {
+
+using namespace std;
+
+class SpscShmRingTest : public ::testing::Test {
+ protected:
+  SpscShmRing ring_;
+};
+
+TEST_F(SpscShmRingTest, Basic) {
+  ASSERT_FALSE(ring_.Create(4096));
+  EXPECT_EQ(4096u, ring_.capacity());
+  EXPECT_GE(ring_.memfd(), 0);
+
+  string dest;
+  EXPECT_FALSE(ring_.TryPop(&dest));
+
+  ASSERT_TRUE(ring_.TryPush("hello", 5));
+  ASSERT_TRUE(ring_.TryPush("world!", 6));
+
+  ASSERT_TRUE(ring_.TryPop(&dest));
+  EXPECT_EQ("hello", dest);
+  ASSERT_TRUE(ring_.TryPop(&dest));
+  EXPECT_EQ("world!", dest);
+  EXPECT_FALSE(ring_.TryPop(&dest));
+}
+
+TEST_F(SpscShmRingTest, WrapAround) {
+  ASSERT_FALSE(ring_.Create(4096));
+
+  // Fill and drain repeatedly so that frames straddle the end of the data region.
+  string frame(1000, 'x'), dest;
+  for (unsigned i = 0; i < 100; ++i) {
+    frame.back() = char(i);
+    ASSERT_TRUE(ring_.TryPush(frame.data(), frame.size()));
+    ASSERT_TRUE(ring_.TryPop(&dest));
+    ASSERT_EQ(frame, dest);
+  }
+}
+
+TEST_F(SpscShmRingTest, Full) {
+  ASSERT_FALSE(ring_.Create(4096));
+
+  string frame(1020, 'y');  // 1024 bytes with the length prefix.
+  for (unsigned i = 0; i < 4; ++i) {
+    ASSERT_TRUE(ring_.TryPush(frame.data(), frame.size()));
+  }
+  EXPECT_FALSE(ring_.TryPush(frame.data(), frame.size()));
+
+  string dest;
+  ASSERT_TRUE(ring_.TryPop(&dest));
+  EXPECT_TRUE(ring_.TryPush(frame.data(), frame.size()));
+}
+
+TEST_F(SpscShmRingTest, Attach) {
+  ASSERT_FALSE(ring_.Create(8192));
+
+  // A consumer mapping the same memfd sees the frames pushed by the producer.
+  SpscShmRing consumer;
+  ASSERT_FALSE(consumer.Attach(ring_.memfd()));
+  EXPECT_EQ(ring_.capacity(), consumer.capacity());
+
+  ASSERT_TRUE(ring_.TryPush("ping", 4));
+  string dest;
+  ASSERT_TRUE(consumer.TryPop(&dest));
+  EXPECT_EQ("ping", dest);
+  EXPECT_FALSE(consumer.TryPop(&dest));
+}
+
+}  // namespace dfly
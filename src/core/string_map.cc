@@ -4,6 +4,9 @@
 
 #include "core/string_map.h"
 
+#include <absl/container/flat_hash_map.h>
+#include <absl/strings/str_cat.h>
+
 #include "base/endian.h"
 #include "base/logging.h"
 #include "core/compact_object.h"
@@ -20,42 +23,208 @@ namespace dfly {
 namespace {
 
 constexpr uint64_t kValTtlBit = 1ULL << 63;
-constexpr uint64_t kValMask = ~kValTtlBit;
+
+// Set on the value pointer when the entry does not embed the field bytes but stores an
+// 8-byte pointer to a shared, refcounted field sds instead. See FieldInterner below.
+constexpr uint64_t kFieldInternedBit = 1ULL << 62;
+
+// Set when the value word stores a 61-bit signed integer inline instead of an sds pointer.
+constexpr uint64_t kValIntBit = 1ULL << 61;
+constexpr uint64_t kValMask = ~(kValTtlBit | kFieldInternedBit | kValIntBit);
+
+// Set when the value sds lives inside the entry allocation itself, right after the
+// metadata, instead of being a separately allocated string. Meaningful only when
+// kValIntBit is clear - for inline integers bit 60 belongs to the payload.
+constexpr uint64_t kValEmbedBit = 1ULL << 60;
+
+// Extracts the value pointer from a non-integer value word.
+constexpr uint64_t kPtrMask = kValMask & ~kValEmbedBit;
+
+constexpr size_t kMaxInternedFieldLen = 32;
+
+// Values up to this length are packed into the entry allocation, saving the second
+// malloc and the dependent cache miss of following the value pointer.
+constexpr size_t kMaxEmbeddedValLen = 64;
+
+// sdshdr8: len, alloc, flags.
+constexpr size_t kEmbedHdrSize = 3;
+
+inline uint64_t GetValWord(sds key) {
+  return absl::little_endian::Load64(key + sdslen(key) + 1);
+}
 
 inline sds GetValue(sds key) {
-  char* valptr = key + sdslen(key) + 1;
-  uint64_t val = absl::little_endian::Load64(valptr);
-  return (sds)(kValMask & val);
+  uint64_t val = GetValWord(key);
+  DCHECK_EQ(0u, val & kValIntBit);
+  return (sds)(kPtrMask & val);
 }
 
+inline bool HasIntValue(sds key) {
+  return GetValWord(key) & kValIntBit;
+}
+
+inline bool IsEmbedded(sds key) {
+  uint64_t val = GetValWord(key);
+  return (val & kValEmbedBit) && !(val & kValIntBit);
+}
+
+// Writes an SDS_TYPE_8 header followed by the value bytes at p and returns the
+// resulting sds. The caller owns the backing memory - sdsfree must never be
+// called on the result.
+inline sds InitEmbeddedValue(char* p, string_view value) {
+  p[0] = value.size();
+  p[1] = value.size();  // alloc == len, in-place rewrites may only shrink.
+  p[2] = SDS_TYPE_8;
+  sds s = p + kEmbedHdrSize;
+  if (!value.empty()) {
+    memcpy(s, value.data(), value.size());
+  }
+  s[value.size()] = '\0';
+  return s;
+}
+
+// Shifts the three tag bits out and sign-extends from bit 60.
+inline int64_t GetIntValue(sds key) {
+  return int64_t(GetValWord(key) << 3) >> 3;
+}
+
+inline bool FitsIntValue(int64_t value) {
+  return (int64_t(uint64_t(value) << 3) >> 3) == value;
+}
+
+inline bool IsInterned(sds key) {
+  const char* valptr = key + sdslen(key) + 1;
+  return absl::little_endian::Load64(valptr) & kFieldInternedBit;
+}
+
+// For interned entries the sds content is an 8-byte pointer to the shared field sds.
+inline sds FieldPtr(sds key) {
+  DCHECK_EQ(8u, sdslen(key));
+  return (sds)absl::little_endian::Load64(key);
+}
+
+inline string_view FieldOf(sds key) {
+  if (IsInterned(key)) {
+    sds field = FieldPtr(key);
+    return string_view{field, sdslen(field)};
+  }
+  return string_view{key, sdslen(key)};
+}
+
+// Deduplicates hash field names across all StringMap instances of this thread.
+// A shared field is an sds with a 4-byte refcount appended after its null terminator.
+struct FieldInterner {
+  bool enabled = false;
+
+  // Keys are views into the shared sds itself, so no extra copies of the field bytes.
+  absl::flat_hash_map<string_view, sds> shared;
+
+  sds Acquire(string_view field) {
+    auto it = shared.find(field);
+    if (it == shared.end()) {
+      sds s = AllocSdsWithSpace(field.size(), 4);
+      if (!field.empty()) {
+        memcpy(s, field.data(), field.size());
+      }
+      absl::little_endian::Store32(s + sdslen(s) + 1, 1);
+      it = shared.emplace(string_view{s, sdslen(s)}, s).first;
+      return s;
+    }
+
+    sds s = it->second;
+    char* refptr = s + sdslen(s) + 1;
+    absl::little_endian::Store32(refptr, absl::little_endian::Load32(refptr) + 1);
+    return s;
+  }
+
+  void Release(sds s) {
+    char* refptr = s + sdslen(s) + 1;
+    uint32_t refcnt = absl::little_endian::Load32(refptr);
+    DCHECK_GT(refcnt, 0u);
+    if (refcnt == 1) {
+      shared.erase(string_view{s, sdslen(s)});
+      sdsfree(s);
+    } else {
+      absl::little_endian::Store32(refptr, refcnt - 1);
+    }
+  }
+};
+
+thread_local FieldInterner field_interner;
+
 }  // namespace
 
 StringMap::~StringMap() {
   Clear();
 }
 
+void StringMap::SetFieldInterning(bool enable) {
+  field_interner.enabled = enable;
+}
+
 bool StringMap::AddOrUpdate(string_view field, string_view value, uint32_t ttl_sec) {
-  // 8 additional bytes for a pointer to value.
+  bool has_ttl = ttl_sec != UINT32_MAX;
+  bool embed = value.size() <= kMaxEmbeddedValLen;
+
+  if (embed) {
+    // If the entry already embeds its value and the new one still fits, rewrite the
+    // value bytes in place instead of reallocating the whole entry.
+    sds entry = (sds)FindInternal(&field, 1);  // 1 - string_view
+    if (entry && IsEmbedded(entry)) {
+      uint64_t word = GetValWord(entry);
+      sds val = (sds)(word & kPtrMask);
+      if (bool(word & kValTtlBit) == has_ttl && value.size() <= sdsalloc(val)) {
+        if (!value.empty()) {
+          memcpy(val, value.data(), value.size());
+        }
+        val[value.size()] = '\0';
+        sdssetlen(val, value.size());
+        if (has_ttl) {
+          char* valptr = entry + sdslen(entry) + 1;
+          absl::little_endian::Store32(valptr + 8, time_now() + ttl_sec);
+        }
+        return false;
+      }
+    }
+  }
+
   sds newkey;
-  size_t meta_offset = field.size() + 1;
-  sds sdsval = sdsnewlen(value.data(), value.size());
-  uint64_t sdsval_tag = uint64_t(sdsval);
-
-  if (ttl_sec == UINT32_MAX) {
-    // The layout is:
-    // key, '\0', 8-byte pointer to value
-    newkey = AllocSdsWithSpace(field.size(), 8);
-  } else {
-    // The layout is:
-    // key, '\0', 8-byte pointer to value, 4-byte absolute time.
-    // the value pointer it tagged.
-    newkey = AllocSdsWithSpace(field.size(), 8 + 4);
+  sds shared_field = nullptr;
+  uint64_t sdsval_tag = 0;
+
+  size_t key_len = field.size();
+  if (field_interner.enabled && field.size() < kMaxInternedFieldLen) {
+    // Do not embed the field bytes, store an 8-byte pointer to the shared field sds instead.
+    shared_field = field_interner.Acquire(field);
+    sdsval_tag |= kFieldInternedBit;
+    key_len = 8;
+  }
+
+  size_t meta_offset = key_len + 1;
+  size_t val_offset = meta_offset + 8 + (has_ttl ? 4 : 0);
+
+  // The layout is:
+  // key, '\0', 8-byte tagged pointer to value, [4-byte absolute expiry],
+  // [embedded value] - short values share the entry allocation instead of living
+  // behind a separately allocated sds.
+  size_t extra = val_offset - meta_offset + (embed ? kEmbedHdrSize + value.size() + 1 : 0);
+  newkey = AllocSdsWithSpace(key_len, extra);
+
+  if (has_ttl) {
     uint32_t at = time_now() + ttl_sec;
     absl::little_endian::Store32(newkey + meta_offset + 8, at);  // skip the value pointer.
     sdsval_tag |= kValTtlBit;
   }
 
-  if (!field.empty()) {
+  if (embed) {
+    sdsval_tag |= uint64_t(InitEmbeddedValue(newkey + val_offset, value)) | kValEmbedBit;
+  } else {
+    sdsval_tag |= uint64_t(sdsnewlen(value.data(), value.size()));
+  }
+
+  if (shared_field) {
+    absl::little_endian::Store64(newkey, uint64_t(shared_field));
+  } else if (!field.empty()) {
     memcpy(newkey, field.data(), field.size());
   }
 
@@ -71,6 +240,61 @@ bool StringMap::AddOrUpdate(string_view field, string_view value, uint32_t ttl_s
   return true;
 }
 
+bool StringMap::AddOrUpdateInt(string_view field, int64_t value) {
+  if (!FitsIntValue(value)) {
+    absl::AlphaNum an(value);
+    return AddOrUpdate(field, an.Piece());
+  }
+
+  sds entry = (sds)FindInternal(&field, 1);  // 1 - string_view
+  if (entry) {
+    char* valptr = entry + sdslen(entry) + 1;
+    uint64_t word = absl::little_endian::Load64(valptr);
+    if (!(word & (kValIntBit | kValEmbedBit))) {
+      sds old_val = (sds)(word & kPtrMask);
+      DecreaseMallocUsed(zmalloc_usable_size(sdsAllocPtr(old_val)));
+      sdsfree(old_val);
+    }
+    // An embedded value region, if any, simply becomes dead space within the entry.
+    uint64_t tags = word & (kValTtlBit | kFieldInternedBit);
+    absl::little_endian::Store64(valptr, (uint64_t(value) & kValMask) | kValIntBit | tags);
+    return false;
+  }
+
+  sds shared_field = nullptr;
+  uint64_t word = (uint64_t(value) & kValMask) | kValIntBit;
+
+  size_t key_len = field.size();
+  if (field_interner.enabled && field.size() < kMaxInternedFieldLen) {
+    shared_field = field_interner.Acquire(field);
+    word |= kFieldInternedBit;
+    key_len = 8;
+  }
+
+  // The layout is:
+  // key, '\0', 8-byte tagged integer.
+  sds newkey = AllocSdsWithSpace(key_len, 8);
+  if (shared_field) {
+    absl::little_endian::Store64(newkey, uint64_t(shared_field));
+  } else if (!field.empty()) {
+    memcpy(newkey, field.data(), field.size());
+  }
+  absl::little_endian::Store64(newkey + key_len + 1, word);
+
+  void* prev = AddOrFindObj(newkey, false);
+  DCHECK(prev == nullptr);
+
+  return true;
+}
+
+optional<int64_t> StringMap::FindInt(string_view field) const {
+  sds entry = (sds)FindInternal(&field, 1);
+  if (!entry || !HasIntValue(entry))
+    return nullopt;
+
+  return GetIntValue(entry);
+}
+
 bool StringMap::AddOrSkip(std::string_view field, std::string_view value, uint32_t ttl_sec) {
   void* obj = FindInternal(&field, 1);  // 1 - string_view
 
@@ -98,15 +322,27 @@ sds StringMap::Find(std::string_view key) {
   if (!str)
     return nullptr;
 
-  return GetValue(str);
+  return MaterializeValue(str);
+}
+
+sds StringMap::MaterializeValue(sds entry) {
+  char* valptr = entry + sdslen(entry) + 1;
+  uint64_t word = absl::little_endian::Load64(valptr);
+  if (word & kValIntBit) {
+    sds val = sdsfromlonglong(int64_t(word << 3) >> 3);
+    uint64_t tags = word & (kValTtlBit | kFieldInternedBit);
+    absl::little_endian::Store64(valptr, uint64_t(val) | tags);
+    IncreaseMallocUsed(zmalloc_usable_size(sdsAllocPtr(val)));
+    return val;
+  }
+  return (sds)(word & kPtrMask);
 }
 
 uint64_t StringMap::Hash(const void* obj, uint32_t cookie) const {
   DCHECK_LT(cookie, 2u);
 
   if (cookie == 0) {
-    sds s = (sds)obj;
-    return CompactObj::HashCode(string_view{s, sdslen(s)});
+    return CompactObj::HashCode(FieldOf((sds)obj));
   }
 
   const string_view* sv = (const string_view*)obj;
@@ -118,23 +354,21 @@ bool StringMap::ObjEqual(const void* left, const void* right, uint32_t right_coo
 
   sds s1 = (sds)left;
   if (right_cookie == 0) {
-    sds s2 = (sds)right;
-
-    if (sdslen(s1) != sdslen(s2)) {
-      return false;
-    }
-
-    return sdslen(s1) == 0 || memcmp(s1, s2, sdslen(s1)) == 0;
+    return FieldOf(s1) == FieldOf((sds)right);
   }
 
   const string_view* right_sv = (const string_view*)right;
-  string_view left_sv{s1, sdslen(s1)};
-  return left_sv == (*right_sv);
+  return FieldOf(s1) == (*right_sv);
 }
 
 size_t StringMap::ObjectAllocSize(const void* obj) const {
+  // Shared field sds of interned entries is not counted here - its cost is amortized
+  // across all the entries referencing it.
   sds s1 = (sds)obj;
   size_t res = zmalloc_usable_size(sdsAllocPtr(s1));
+  if (HasIntValue(s1) || IsEmbedded(s1))  // the value lives inside the entry.
+    return res;
+
   sds val = GetValue(s1);
   res += zmalloc_usable_size(sdsAllocPtr(val));
 
@@ -157,14 +391,27 @@ uint32_t StringMap::ObjExpireTime(const void* obj) const {
 
 void StringMap::ObjDelete(void* obj, bool has_ttl) const {
   sds s1 = (sds)obj;
-  sds value = GetValue(s1);
-  sdsfree(value);
+  if (!HasIntValue(s1) && !IsEmbedded(s1)) {
+    sdsfree(GetValue(s1));
+  }
+  if (IsInterned(s1)) {
+    field_interner.Release(FieldPtr(s1));
+  }
   sdsfree(s1);
 }
 
-detail::SdsPair StringMap::iterator::BreakToPair(void* obj) {
+detail::SdsPair StringMap::EntryPair(const void* obj) {
   sds f = (sds)obj;
-  return detail::SdsPair(f, GetValue(f));
+  sds val = MaterializeValue(f);
+  if (IsInterned(f)) {
+    // The shared field sds holds the real field bytes.
+    return detail::SdsPair(FieldPtr(f), val);
+  }
+  return detail::SdsPair(f, val);
+}
+
+detail::SdsPair StringMap::iterator::BreakToPair(void* obj) const {
+  return static_cast<StringMap*>(owner_)->EntryPair(obj);
 }
 
 }  // namespace dfly
@@ -4,6 +4,7 @@
 
 #pragma once
 
+#include <optional>
 #include <string_view>
 
 #include "core/dense_set.h"
@@ -43,7 +44,7 @@ class StringMap : public DenseSet {
   ~StringMap();
 
   class iterator : private DenseSet::IteratorBase {
-    static detail::SdsPair BreakToPair(void* obj);
+    detail::SdsPair BreakToPair(void* obj) const;
 
    public:
     iterator() : IteratorBase() {
@@ -76,14 +77,34 @@ class StringMap : public DenseSet {
     }
   };
 
+  // Decodes a raw entry, as passed to the Scan callback, into a (field, value) sds pair.
+  detail::SdsPair EntryPair(const void* obj);
+
+  // Enables interning of short hash field names for maps used on this thread: fields under
+  // 32 bytes reference a shared refcounted sds instead of embedding their bytes in every
+  // entry. Pays off when many hashes share the same field schema.
+  static void SetFieldInterning(bool enable);
+
   // Returns true if field was added
   // otherwise updates its value and returns false.
+  // Short values are packed into the entry allocation together with the field; an update
+  // that still fits rewrites the entry in place without reallocating.
   bool AddOrUpdate(std::string_view field, std::string_view value, uint32_t ttl_sec = UINT32_MAX);
 
   // Returns true if field was added
   // false, if already exists. In that case no update is done.
   bool AddOrSkip(std::string_view field, std::string_view value, uint32_t ttl_sec = UINT32_MAX);
 
+  // Stores a numeric value as a tagged int64 inside the entry instead of an sds, so repeated
+  // increments of the same field do not allocate. An existing entry is updated in place.
+  // Values that do not fit the 61-bit inline range fall back to the string representation.
+  // Returns true if field was added.
+  bool AddOrUpdateInt(std::string_view field, int64_t value);
+
+  // Returns the value of field if it is stored as a tagged int64, nullopt if the field is
+  // missing or holds a string value. Unlike Find, does not materialize the value into an sds.
+  std::optional<int64_t> FindInt(std::string_view field) const;
+
   bool Erase(std::string_view s1);
 
   bool Contains(std::string_view s1) const;
@@ -104,6 +125,10 @@ class StringMap : public DenseSet {
   }
 
  private:
+  // Formats an inline integer value into an sds on first string access. The entry itself
+  // is not reallocated, only its value word is rewritten.
+  sds MaterializeValue(sds entry);
+
   uint64_t Hash(const void* obj, uint32_t cookie) const final;
   bool ObjEqual(const void* left, const void* right, uint32_t right_cookie) const final;
   size_t ObjectAllocSize(const void* obj) const final;
@@ -15,6 +15,7 @@
 #include <random>
 #include <string>
 #include <string_view>
+#include <unordered_map>
 #include <unordered_set>
 #include <vector>
 
@@ -99,6 +100,75 @@ TEST_F(StringMapTest, EmptyFind) {
   sm_->Find("bar");
 }
 
+TEST_F(StringMapTest, ScanNoDuplicates) {
+  // HSCAN relies on the split-ordered cursor of the underlying DenseSet: growing
+  // the table between scan steps must not emit a field twice.
+  constexpr unsigned kNumFields = 512;
+  for (unsigned i = 0; i < kNumFields; ++i) {
+    EXPECT_TRUE(sm_->AddOrUpdate(StrCat("field:", i), StrCat("val:", i)));
+  }
+
+  unordered_map<string, unsigned> emitted;
+  auto scan_cb = [&](const void* obj) {
+    sds key = (sds)obj;
+    ++emitted[string{key, sdslen(key)}];
+  };
+
+  uint32_t cursor = 0;
+  unsigned steps = 0, extra = 0;
+  do {
+    cursor = sm_->Scan(cursor, scan_cb);
+    if (++steps % 8 == 0) {
+      // force grows while the scan is in flight.
+      for (unsigned i = 0; i < 256; ++i) {
+        sm_->AddOrUpdate(StrCat("extra:", extra++), "x");
+      }
+    }
+  } while (cursor != 0);
+
+  for (const auto& [key, cnt] : emitted) {
+    EXPECT_EQ(1u, cnt) << key;
+  }
+
+  for (unsigned i = 0; i < kNumFields; ++i) {
+    EXPECT_EQ(1u, emitted.count(StrCat("field:", i)));
+  }
+}
+
+TEST_F(StringMapTest, FieldInterning) {
+  StringMap::SetFieldInterning(true);
+
+  StringMap other{&mi_alloc_};
+  for (unsigned i = 0; i < 100; ++i) {
+    EXPECT_EQ(i == 0, sm_->AddOrUpdate("field", StrCat("val:", i)));
+    EXPECT_EQ(i == 0, other.AddOrUpdate("field", StrCat("v", i)));
+  }
+  EXPECT_STREQ("val:99", sm_->Find("field"));
+  EXPECT_STREQ("v99", other.Find("field"));
+
+  auto it = sm_->begin();
+  EXPECT_STREQ("field", it->first);
+  EXPECT_STREQ("val:99", it->second);
+
+  // Fields of 32 bytes or more are embedded as before.
+  string long_field(40, 'x');
+  EXPECT_TRUE(sm_->AddOrUpdate(long_field, "y"));
+  EXPECT_STREQ("y", sm_->Find(long_field));
+
+  // Releasing one reference must not affect the other map.
+  EXPECT_TRUE(sm_->Erase("field"));
+  EXPECT_FALSE(sm_->Contains("field"));
+  EXPECT_STREQ("v99", other.Find("field"));
+  other.Clear();
+
+  EXPECT_TRUE(sm_->AddOrUpdate("ttlfield", "v", 1));
+  EXPECT_STREQ("v", sm_->Find("ttlfield"));
+  sm_->set_time(2);
+  EXPECT_FALSE(sm_->Contains("ttlfield"));
+
+  StringMap::SetFieldInterning(false);
+}
+
 TEST_F(StringMapTest, Ttl) {
   EXPECT_TRUE(sm_->AddOrUpdate("bla", "val1", 1));
   EXPECT_FALSE(sm_->AddOrUpdate("bla", "val2", 1));
@@ -117,4 +187,75 @@ TEST_F(StringMapTest, Ttl) {
   EXPECT_TRUE(it == sm_->end());
 }
 
+TEST_F(StringMapTest, EmbeddedValue) {
+  EXPECT_TRUE(sm_->AddOrUpdate("field", "short"));
+  sds val = sm_->Find("field");
+  EXPECT_STREQ("short", val);
+
+  // An update that still fits rewrites the value in place - the value sds does not move.
+  EXPECT_FALSE(sm_->AddOrUpdate("field", "tiny"));
+  EXPECT_EQ(val, sm_->Find("field"));
+  EXPECT_STREQ("tiny", sm_->Find("field"));
+
+  // Growing beyond the embedded capacity rebuilds the entry.
+  string big(100, 'x');
+  EXPECT_FALSE(sm_->AddOrUpdate("field", big));
+  EXPECT_EQ(big, string(sm_->Find("field")));
+
+  // Shrinking back re-embeds via a fresh entry - there is no in-place path for a heap value.
+  EXPECT_FALSE(sm_->AddOrUpdate("field", "v"));
+  EXPECT_STREQ("v", sm_->Find("field"));
+
+  // TTL-carrying entries embed as well, and the in-place update refreshes the expiry.
+  EXPECT_TRUE(sm_->AddOrUpdate("tfield", "val1", 2));
+  sm_->set_time(1);
+  EXPECT_FALSE(sm_->AddOrUpdate("tfield", "val2", 2));  // now expires at time 3.
+  sm_->set_time(2);
+  EXPECT_STREQ("val2", sm_->Find("tfield"));
+  sm_->set_time(3);
+  EXPECT_FALSE(sm_->Contains("tfield"));
+
+  // Switching the ttl state cannot be done in place and falls back to a rebuild.
+  EXPECT_TRUE(sm_->AddOrUpdate("mixed", "a", 1));
+  EXPECT_FALSE(sm_->AddOrUpdate("mixed", "b"));  // drops the ttl.
+  sm_->set_time(10);
+  EXPECT_STREQ("b", sm_->Find("mixed"));
+}
+
+TEST_F(StringMapTest, IntValue) {
+  EXPECT_TRUE(sm_->AddOrUpdateInt("counter", 10));
+  EXPECT_EQ(10, sm_->FindInt("counter"));
+
+  // The existing entry is updated in place.
+  EXPECT_FALSE(sm_->AddOrUpdateInt("counter", -5));
+  EXPECT_EQ(-5, sm_->FindInt("counter"));
+
+  // Reading through the string interface formats the value once and decays the entry.
+  sds val = sm_->Find("counter");
+  ASSERT_TRUE(val != nullptr);
+  EXPECT_EQ("-5", string_view(val, sdslen(val)));
+  EXPECT_EQ(nullopt, sm_->FindInt("counter"));
+
+  // Replacing the decayed string value with an integer frees the value sds.
+  EXPECT_FALSE(sm_->AddOrUpdateInt("counter", 42));
+  EXPECT_EQ(42, sm_->FindInt("counter"));
+
+  // String-valued fields are not reported as integers.
+  EXPECT_TRUE(sm_->AddOrUpdate("str", "10"));
+  EXPECT_EQ(nullopt, sm_->FindInt("str"));
+
+  // Values outside the 61-bit inline range fall back to strings.
+  EXPECT_TRUE(sm_->AddOrUpdateInt("big", INT64_MAX));
+  EXPECT_EQ(nullopt, sm_->FindInt("big"));
+  EXPECT_EQ(StrCat(INT64_MAX), string(sm_->Find("big")));
+
+  // Iteration materializes the integer values as well.
+  EXPECT_FALSE(sm_->AddOrUpdateInt("counter", 7));
+  for (const auto& k_v : *sm_) {
+    if (string_view{k_v.first, sdslen(k_v.first)} == "counter") {
+      EXPECT_STREQ("7", k_v.second);
+    }
+  }
+}
+
 }  // namespace dfly
@@ -97,6 +97,10 @@ uint32_t StringSet::Scan(uint32_t cursor, const std::function<void(const sds)>&
   return DenseSet::Scan(cursor, [func](const void* ptr) { func((sds)ptr); });
 }
 
+uint32_t StringSet::Sample(uint32_t count, const std::function<void(sds)>& func) const {
+  return DenseSet::Sample(count, [func](const void* ptr) { func((sds)ptr); });
+}
+
 uint64_t StringSet::Hash(const void* ptr, uint32_t cookie) const {
   DCHECK_LT(cookie, 2u);
 
@@ -121,12 +125,15 @@ bool StringSet::ObjEqual(const void* left, const void* right, uint32_t right_coo
       return false;
     }
 
-    return sdslen(s1) == 0 || memcmp(s1, s2, sdslen(s1)) == 0;
+    return sdslen(s1) == 0 || MemEqual(s1, s2, sdslen(s1));
   }
 
   const string_view* right_sv = (const string_view*)right;
-  string_view left_sv{s1, sdslen(s1)};
-  return left_sv == (*right_sv);
+  if (sdslen(s1) != right_sv->size()) {
+    return false;
+  }
+
+  return right_sv->empty() || MemEqual(s1, right_sv->data(), right_sv->size());
 }
 
 size_t StringSet::ObjectAllocSize(const void* s1) const {
@@ -127,6 +127,9 @@ class StringSet : public DenseSet {
 
   uint32_t Scan(uint32_t, const std::function<void(sds)>&) const;
 
+  // Emits up to count distinct members picked at random, see DenseSet::Sample.
+  uint32_t Sample(uint32_t count, const std::function<void(sds)>& func) const;
+
  protected:
   uint64_t Hash(const void* ptr, uint32_t cookie) const override;
 
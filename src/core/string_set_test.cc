@@ -15,11 +15,13 @@
 #include <random>
 #include <string>
 #include <string_view>
+#include <unordered_map>
 #include <unordered_set>
 #include <vector>
 
 #include "core/compact_object.h"
 #include "core/mi_memory_resource.h"
+#include "core/sds_utils.h"
 #include "glog/logging.h"
 #include "redis/sds.h"
 
@@ -83,6 +85,20 @@ class StringSetTest : public ::testing::Test {
   DenseSetAllocator alloc_;
 };
 
+TEST_F(StringSetTest, MemEqual) {
+  // Cover the scalar, swar and vector paths including the overlapping tail loads.
+  for (size_t len : {0, 1, 5, 7, 8, 9, 15, 16, 17, 31, 32, 33, 63, 64, 100, 256}) {
+    string a(len, 'x'), b(len, 'x');
+    EXPECT_TRUE(MemEqual(a.data(), b.data(), len)) << len;
+
+    for (size_t pos = 0; pos < len; ++pos) {
+      b[pos] = 'y';
+      EXPECT_FALSE(MemEqual(a.data(), b.data(), len)) << len << "/" << pos;
+      b[pos] = 'x';
+    }
+  }
+}
+
 TEST_F(StringSetTest, Basic) {
   EXPECT_TRUE(ss_->Add("foo"sv));
   EXPECT_TRUE(ss_->Add("bar"sv));
@@ -326,6 +342,45 @@ TEST_F(StringSetTest, XtremeScanGrow) {
   EXPECT_EQ(seen.size(), to_see.size());
 }
 
+TEST_F(StringSetTest, ScanNoDuplicates) {
+  // A full scan must emit every member at most once, also when the table
+  // grows several times between the scan steps.
+  unordered_set<string> members;
+  mt19937 generator(0);
+
+  while (members.size() != 512) {
+    members.insert(random_string(generator, 10));
+  }
+
+  for (const auto& str : members) {
+    EXPECT_TRUE(ss_->Add(str));
+  }
+
+  unordered_map<string, unsigned> emitted;
+  auto scan_callback = [&](const sds ptr) { ++emitted[string{ptr, sdslen(ptr)}]; };
+
+  uint32_t cursor = 0;
+  unsigned steps = 0;
+  do {
+    cursor = ss_->Scan(cursor, scan_callback);
+
+    // force a couple of grows while the scan is in flight.
+    if (++steps % 16 == 0) {
+      for (unsigned i = 0; i < 512; ++i) {
+        ss_->Add(random_string(generator, 10));
+      }
+    }
+  } while (cursor != 0);
+
+  for (const auto& [str, cnt] : emitted) {
+    EXPECT_EQ(1u, cnt) << str;
+  }
+
+  for (const auto& str : members) {
+    EXPECT_EQ(1u, emitted.count(str)) << str;
+  }
+}
+
 TEST_F(StringSetTest, Pop) {
   constexpr size_t num_items = 8;
   unordered_set<string> to_insert;
@@ -356,6 +411,40 @@ TEST_F(StringSetTest, Pop) {
   DCHECK(to_insert.empty());
 }
 
+TEST_F(StringSetTest, Sample) {
+  EXPECT_EQ(0u, ss_->Sample(5, [](sds) { FAIL() << "empty set must not emit"; }));
+
+  constexpr size_t num_items = 1000;
+  unordered_set<string> to_insert;
+
+  mt19937 generator(0);
+
+  while (to_insert.size() != num_items) {
+    auto str = random_string(generator, 10);
+    if (to_insert.count(str)) {
+      continue;
+    }
+
+    to_insert.insert(str);
+    EXPECT_TRUE(ss_->Add(str));
+  }
+
+  // Sampled members belong to the set and are distinct.
+  unordered_set<string> sampled;
+  EXPECT_EQ(100u, ss_->Sample(100, [&](sds ptr) {
+    string str{ptr, sdslen(ptr)};
+    EXPECT_TRUE(to_insert.count(str));
+    EXPECT_TRUE(sampled.insert(str).second);
+  }));
+
+  // Asking for more members than the set holds emits each member exactly once.
+  sampled.clear();
+  EXPECT_EQ(num_items, ss_->Sample(2 * num_items, [&](sds ptr) {
+    EXPECT_TRUE(sampled.emplace(ptr, sdslen(ptr)).second);
+  }));
+  EXPECT_EQ(num_items, sampled.size());
+}
+
 TEST_F(StringSetTest, Iteration) {
   ss_->Add("foo");
   for (const sds ptr : *ss_) {
@@ -8,6 +8,8 @@
 #include <absl/strings/match.h>
 #include <mimalloc.h>
 
+#include <algorithm>
+
 #include "base/flags.h"
 #include "base/logging.h"
 #include "facade/conn_context.h"
@@ -16,6 +18,7 @@
 #include "facade/service_interface.h"
 
 #ifdef DFLY_USE_SSL
+#include "facade/ktls.h"
 #include "util/tls/tls_socket.h"
 #endif
 
@@ -38,6 +41,31 @@ ABSL_FLAG(std::uint64_t, request_cache_limit, 1ULL << 26,  // 64MB
 
 ABSL_FLAG(bool, no_tls_on_admin_port, false, "Allow non-tls connections on admin port");
 
+ABSL_FLAG(std::uint32_t, conn_buf_shrink_sec, 60,
+          "A connection that was idle for at least this many seconds releases its grown "
+          "read buffer back to the minimal size on its next request, so buffers inflated "
+          "during fan-in spikes are not held forever. 0 disables the shrink.");
+
+ABSL_FLAG(bool, tls_ktls, false,
+          "If true, tries to offload TLS record encryption to the kernel (kTLS) after the "
+          "handshake, saving a userspace copy per flush. Requires the tls kernel module and "
+          "a TLS1.2 AES128-GCM session, falls back to userspace TLS otherwise. Clients that "
+          "pipeline commands together with the handshake are not supported.");
+
+ABSL_FLAG(std::uint32_t, pipeline_squash, 32,
+          "Maximal number of queued pipelined commands dispatched together as a single batch. "
+          "0 disables squashing of plain pipelines");
+
+ABSL_FLAG(std::uint64_t, dispatch_queue_limit, 5ULL << 20,  // 5MB
+          "Maximal memory the dispatch queue of a single connection may hold. A connection "
+          "exceeding it stops reading from its socket until the dispatch fiber catches up, "
+          "so plain TCP backpressure throttles clients that pipeline blindly.");
+
+ABSL_FLAG(std::uint64_t, dispatch_queue_global_limit, 1ULL << 30,  // 1GB
+          "Maximal memory the dispatch queues of all connections may hold together. Under "
+          "global pressure only the heaviest connections stop reading from their sockets, "
+          "so lightly loaded clients keep being served. 0 disables the global limit.");
+
 using namespace util;
 using namespace std;
 using nonstd::make_unexpected;
@@ -58,6 +86,11 @@ void SendProtocolError(RedisParser::Result pres, SinkReplyBuilder* builder) {
 void FetchBuilderStats(ConnectionStats* stats, SinkReplyBuilder* builder) {
   stats->io_write_cnt += builder->io_write_cnt();
   stats->io_write_bytes += builder->io_write_bytes();
+  stats->reply_buff_cache_hit_cnt += builder->batch_buf_hit_cnt();
+  stats->reply_buff_cache_miss_cnt += builder->batch_buf_miss_cnt();
+
+  // A gauge of the thread-local pool, so it is assigned rather than accumulated.
+  stats->reply_buff_cache_capacity = SinkReplyBuilder::BatchPoolCapacity();
 
   for (const auto& k_v : builder->err_count()) {
     stats->err_count_map[k_v.first] += k_v.second;
@@ -75,13 +108,16 @@ bool MatchHttp11Line(string_view line) {
 constexpr size_t kMinReadSize = 256;
 constexpr size_t kMaxReadSize = 32_KB;
 
-constexpr size_t kMaxDispatchQMemory = 5_MB;
+// Memory queued in the dispatch queues of all connections on all threads. Kept as a
+// single process-wide counter so the admission check in the read path stays a load.
+atomic<size_t> g_dispatch_q_bytes{0};
 
 thread_local uint32_t free_req_release_weight = 0;
 
 }  // namespace
 
-thread_local vector<Connection::PipelineMessagePtr> Connection::pipeline_req_pool_;
+thread_local array<vector<Connection::PipelineMessagePtr>, Connection::kNumSizeClasses>
+    Connection::pipeline_req_pool_;
 
 struct Connection::Shutdown {
   absl::flat_hash_map<ShutdownHandle, ShutdownCb> map;
@@ -118,6 +154,7 @@ struct Connection::DispatchOperations {
   void operator()(const PubMessage& msg);
   void operator()(Connection::PipelineMessage& msg);
   void operator()(const MonitorMessage& msg);
+  void operator()(const InvalidationMessage& msg);
 
   template <typename T, typename D> void operator()(unique_ptr<T, D>& ptr) {
     operator()(*ptr.get());
@@ -179,7 +216,9 @@ size_t Connection::MessageHandle::UsedMemory() const {
            arg.storage.capacity();
   };
   auto monitor_size = [](const MonitorMessage& arg) -> size_t { return arg.capacity(); };
-  return sizeof(MessageHandle) + visit(Overloaded{pub_size, msg_size, monitor_size}, this->handle);
+  auto inv_size = [](const InvalidationMessage& arg) -> size_t { return arg.capacity(); };
+  return sizeof(MessageHandle) +
+         visit(Overloaded{pub_size, msg_size, monitor_size, inv_size}, this->handle);
 }
 
 bool Connection::MessageHandle::IsPipelineMsg() const {
@@ -208,6 +247,15 @@ void Connection::DispatchOperations::operator()(const PubMessage& pub_msg) {
                           RedisReplyBuilder::CollectionType::PUSH);
 }
 
+void Connection::DispatchOperations::operator()(const InvalidationMessage& msg) {
+  RedisReplyBuilder* rbuilder = (RedisReplyBuilder*)builder;
+  ++stats->async_writes_cnt;
+  rbuilder->StartCollection(2, RedisReplyBuilder::CollectionType::PUSH);
+  rbuilder->SendBulkString("invalidate");
+  rbuilder->StartArray(1);
+  rbuilder->SendBulkString(msg);
+}
+
 void Connection::DispatchOperations::operator()(Connection::PipelineMessage& msg) {
   ++stats->pipelined_cmd_cnt;
 
@@ -230,6 +278,10 @@ Connection::Connection(Protocol protocol, util::HttpListenerBase* http_listener,
   switch (protocol) {
     case Protocol::REDIS:
       redis_parser_.reset(new RedisParser);
+
+      // IoLoop grows io_buf_ to twice the pending bulk length (see below), so bulks up to
+      // this limit are guaranteed to assemble contiguously in io_buf_ and parse zero-copy.
+      redis_parser_->SetZeroCopyBulkLimit(kMaxReadSize / 2);
       break;
     case Protocol::MEMCACHE:
       memcache_parser_.reset(new MemcacheParser);
@@ -318,6 +370,22 @@ void Connection::HandleRequests() {
       }
       peer = tls_sock.get();
       VLOG(1) << "TLS handshake succeeded";
+
+      if (absl::GetFlag(FLAGS_tls_ktls)) {
+        switch (EnableKTls(lsb->native_handle(), tls_sock->ssl_handle())) {
+          case KTlsStatus::ENABLED:
+            // The kernel owns record encryption now - io goes through the raw socket,
+            // bypassing the userspace engine.
+            peer = socket_.get();
+            VLOG(1) << "kTLS offload enabled";
+            break;
+          case KTlsStatus::UNSUPPORTED:
+            break;  // Stay on the userspace engine.
+          case KTlsStatus::FAILED:
+            LOG(WARNING) << "Closing connection after a partial kTLS setup";
+            return;
+        }
+      }
     }
   }
 #endif
@@ -448,8 +516,6 @@ io::Result<bool> Connection::CheckForHttpProto(FiberSocketBase* peer) {
 void Connection::ConnectionFlow(FiberSocketBase* peer) {
   stats_ = service_->GetThreadLocalConnectionStats();
 
-  auto dispatch_fb = MakeFiber(dfly::Launch::dispatch, [&] { DispatchFiber(peer); });
-
   ++stats_->num_conns;
   ++stats_->conn_received_cnt;
   stats_->read_buf_capacity += io_buf_.Capacity();
@@ -486,7 +552,8 @@ void Connection::ConnectionFlow(FiberSocketBase* peer) {
   cc_->conn_closing = true;  // Signal dispatch to close.
   evc_.notify();
   VLOG(1) << "Before dispatch_fb.join()";
-  dispatch_fb.Join();
+  if (dispatch_fb_.IsJoinable())
+    dispatch_fb_.Join();
   VLOG(1) << "After dispatch_fb.join()";
   service_->OnClose(cc_.get());
 
@@ -571,8 +638,14 @@ void Connection::DispatchCommand(uint32_t consumed, mi_heap_t* heap) {
 
   } else {
     SendAsync(MessageHandle{FromArgs(move(tmp_parse_args_), heap)});
-    if (dispatch_q_.size() > 10)
+
+    // Stop reading from the socket until the dispatch fiber catches up, so plain TCP
+    // backpressure bounds clients that pipeline blindly.
+    if (ShouldThrottleDispatch()) {
+      evc_bp_.await([this] { return cc_->conn_closing || !ShouldThrottleDispatch(); });
+    } else if (dispatch_q_.size() > 10) {
       ThisFiber::Yield();
+    }
   }
 }
 
@@ -624,7 +697,8 @@ auto Connection::ParseMemcache() -> ParserStatus {
 
     size_t total_len = consumed;
     if (MemcacheParser::IsStoreCmd(cmd.type)) {
-      total_len += cmd.bytes_len + 2;
+      // Binary protocol values are not terminated by CRLF.
+      total_len += cmd.bytes_len + (memcache_parser_->IsBinaryProtocol() ? 0 : 2);
       if (io_buf_.InputLen() >= total_len) {
         value = str.substr(consumed, cmd.bytes_len);
         // TODO: dispatch.
@@ -671,7 +745,8 @@ void Connection::OnBreakCb(int32_t mask) {
   break_poll_id_ = UINT32_MAX;  // do not attempt to cancel it.
 
   breaker_cb_(mask);
-  evc_.notify();  // Notify dispatch fiber.
+  evc_.notify();     // Notify dispatch fiber.
+  evc_bp_.notify();  // Unblock a read fiber throttled on the dispatch queue budget.
 }
 
 auto Connection::IoLoop(util::FiberSocketBase* peer, SinkReplyBuilder* orig_builder)
@@ -680,13 +755,36 @@ auto Connection::IoLoop(util::FiberSocketBase* peer, SinkReplyBuilder* orig_buil
   ParserStatus parse_status = OK;
 
   do {
+    if (migration_request_ != nullptr) {
+      ProactorBase* dest = migration_request_;
+      migration_request_ = nullptr;
+
+      // Migrate only if the connection is fully idle: the dispatch fiber, if it was ever
+      // started, stays on the original thread and cannot be moved.
+      if (!dispatch_fb_.IsJoinable() && dispatch_q_.empty() && cc_->subscriptions == 0 &&
+          dest != socket_->proactor()) {
+        VLOG(1) << "Migrating connection " << GetClientId() << " to thread " << dest->GetIndex();
+        FetchBuilderStats(stats_, orig_builder);
+        this->Migrate(dest);
+        stats_ = service_->GetThreadLocalConnectionStats();
+      }
+    }
+
     FetchBuilderStats(stats_, orig_builder);
 
     io::MutableBytes append_buf = io_buf_.AppendBuffer();
     phase_ = READ_SOCKET;
 
     ::io::Result<size_t> recv_sz = peer->Recv(append_buf);
-    last_interaction_ = time(nullptr);
+
+    // Only this fiber may touch io_buf_ and a pending recv owns append_buf, so an
+    // oversized buffer can not be reclaimed while the connection is silent - it is
+    // released here, when the connection speaks again after an idle period.
+    time_t now = time(nullptr);
+    uint32_t shrink_sec = absl::GetFlag(FLAGS_conn_buf_shrink_sec);
+    bool reclaim_io_buf = shrink_sec > 0 && io_buf_.Capacity() > kMinReadSize &&
+                          now - last_interaction_ >= time_t(shrink_sec);
+    last_interaction_ = now;
 
     if (!recv_sz) {
       ec = recv_sz.error();
@@ -715,6 +813,13 @@ auto Connection::IoLoop(util::FiberSocketBase* peer, SinkReplyBuilder* orig_buil
         if (redis_parser_)
           parser_hint = redis_parser_->parselen_hint();  // Could be done for MC as well.
 
+        if (parser_hint > 0) {
+          // Reserve twice the pending bulk length: io_buf_ compacts the consumed prefix only
+          // lazily, so the extra slack guarantees that bulks under the zero-copy limit always
+          // have room to assemble contiguously.
+          parser_hint = std::max<size_t>(2048, parser_hint) * 2;
+        }
+
         if (parser_hint > capacity) {
           io_buf_.Reserve(std::min(kMaxReadSize, parser_hint));
         } else if (append_buf.size() == *recv_sz && append_buf.size() > capacity / 2) {
@@ -730,6 +835,17 @@ auto Connection::IoLoop(util::FiberSocketBase* peer, SinkReplyBuilder* orig_buil
     } else if (parse_status != OK) {
       break;
     }
+
+    // Parsed input never outlives this iteration (pipelined messages copy their args),
+    // so once the input is fully consumed the buffer can be replaced safely.
+    if (reclaim_io_buf && parse_status == OK && io_buf_.InputLen() == 0 &&
+        io_buf_.Capacity() > kMinReadSize) {
+      VLOG(1) << "Shrinking io_buf from " << io_buf_.Capacity();
+      stats_->read_buf_capacity -= io_buf_.Capacity();
+      io_buf_ = base::IoBuf{kMinReadSize};
+      stats_->read_buf_capacity += io_buf_.Capacity();
+    }
+
     ec = orig_builder->GetError();
   } while (peer->IsOpen() && !ec);
 
@@ -752,6 +868,22 @@ void Connection::DispatchFiber(util::FiberSocketBase* peer) {
   SinkReplyBuilder* builder = cc_->reply_builder();
   DispatchOperations dispatch_op{builder, this};
   uint64_t request_cache_limit = absl::GetFlag(FLAGS_request_cache_limit);
+  uint32_t squash_limit = absl::GetFlag(FLAGS_pipeline_squash);
+
+  vector<MessageHandle> squash_msgs;
+  vector<CmdArgList> squash_cmds;
+
+  auto recycle_msg = [&](MessageHandle msg) {
+    size_t used_mem = msg.UsedMemory();
+    dispatch_q_bytes_.fetch_sub(used_mem, memory_order_relaxed);
+    g_dispatch_q_bytes.fetch_sub(used_mem, memory_order_relaxed);
+    stats_->dispatch_queue_bytes -= used_mem;
+
+    // Retain pipeline message in pool.
+    if (auto* pipe = get_if<PipelineMessagePtr>(&msg.handle); pipe) {
+      RetainInPipelinePool(move(*pipe), request_cache_limit);
+    }
+  };
 
   while (!builder->GetError()) {
     evc_.await(
@@ -759,6 +891,37 @@ void Connection::DispatchFiber(util::FiberSocketBase* peer) {
     if (cc_->conn_closing)
       break;
 
+    // Collect consecutive pipelined commands from the front of the queue and dispatch them
+    // as one batch, so the service can squash them into fewer transactional hops.
+    if (squash_limit > 1 && dispatch_q_.size() > 1 && dispatch_q_.front().IsPipelineMsg()) {
+      do {
+        squash_msgs.push_back(move(dispatch_q_.front()));
+        dispatch_q_.pop_front();
+        squash_cmds.push_back(
+            absl::MakeSpan(get<PipelineMessagePtr>(squash_msgs.back().handle)->args));
+      } while (squash_cmds.size() < squash_limit && !dispatch_q_.empty() &&
+               dispatch_q_.front().IsPipelineMsg());
+
+      stats_->pipelined_cmd_cnt += squash_cmds.size();
+      builder->SetBatchMode(dispatch_q_.size() > 0);
+
+      {
+        cc_->async_dispatch = true;
+        service_->DispatchManyCommands(absl::MakeSpan(squash_cmds), cc_.get());
+        cc_->async_dispatch = false;
+      }
+
+      last_interaction_ = time(nullptr);
+
+      for (auto& msg : squash_msgs)
+        recycle_msg(move(msg));
+      squash_msgs.clear();
+      squash_cmds.clear();
+
+      evc_bp_.notify();
+      continue;
+    }
+
     MessageHandle msg = move(dispatch_q_.front());
     dispatch_q_.pop_front();
 
@@ -770,22 +933,19 @@ void Connection::DispatchFiber(util::FiberSocketBase* peer) {
       cc_->async_dispatch = false;
     }
 
-    dispatch_q_bytes_.fetch_sub(msg.UsedMemory(), memory_order_relaxed);
+    recycle_msg(move(msg));
     evc_bp_.notify();
-
-    // Retain pipeline message in pool.
-    if (auto* pipe = get_if<PipelineMessagePtr>(&msg.handle); pipe) {
-      if (stats_->pipeline_cache_capacity < request_cache_limit) {
-        stats_->pipeline_cache_capacity += (*pipe)->StorageCapacity();
-        pipeline_req_pool_.push_back(move(*pipe));
-      }
-    }
   }
 
   cc_->conn_closing = true;
 
   // make sure that we don't have any leftovers!
+  for (auto& msg : dispatch_q_)
+    recycle_msg(move(msg));
   dispatch_q_.clear();
+
+  // Unblock producers that wait for the queue to drain.
+  evc_bp_.notifyAll();
 }
 
 Connection::PipelineMessagePtr Connection::FromArgs(RespVec args, mi_heap_t* heap) {
@@ -802,9 +962,11 @@ Connection::PipelineMessagePtr Connection::FromArgs(RespVec args, mi_heap_t* hea
   static_assert(alignof(PipelineMessage) == 8);
 
   PipelineMessagePtr ptr;
-  if (ptr = GetFromPipelinePool(); ptr) {
+  if (ptr = GetFromPipelinePool(backed_sz); ptr) {
+    ++stats_->pipeline_cache_hit_cnt;
     ptr->Reset(args.size(), backed_sz);
   } else {
+    ++stats_->pipeline_cache_miss_cnt;
     void* heap_ptr = mi_heap_malloc_small(heap, sizeof(PipelineMessage));
     // We must construct in place here, since there is a slice that uses memory locations
     ptr.reset(new (heap_ptr) PipelineMessage(args.size(), backed_sz));
@@ -814,8 +976,22 @@ Connection::PipelineMessagePtr Connection::FromArgs(RespVec args, mi_heap_t* hea
   return ptr;
 }
 
+// Class i covers backing sizes up to kReqStorageSize * 2^i, i.e. class 0 holds messages
+// whose payload fits into the inlined storage and each following class doubles the limit.
+unsigned Connection::SizeClass(size_t backing_sz) {
+  size_t limit = kReqStorageSize;
+  unsigned cls = 0;
+  while (backing_sz > limit && cls < kNumSizeClasses) {
+    limit *= 2;
+    ++cls;
+  }
+  return cls;
+}
+
 void Connection::ShrinkPipelinePool() {
-  if (pipeline_req_pool_.empty())
+  bool all_empty = all_of(pipeline_req_pool_.begin(), pipeline_req_pool_.end(),
+                          [](const auto& pool) { return pool.empty(); });
+  if (all_empty)
     return;
 
   // The request pool is shared by all the connections in the thread so we do not want
@@ -826,20 +1002,52 @@ void Connection::ShrinkPipelinePool() {
 
   if (free_req_release_weight > stats_->num_conns) {
     free_req_release_weight = 0;
-    stats_->pipeline_cache_capacity -= pipeline_req_pool_.back()->StorageCapacity();
-    pipeline_req_pool_.pop_back();
+
+    // Release from the largest class first - those entries hold the most memory.
+    for (unsigned i = kNumSizeClasses; i-- > 0;) {
+      auto& pool = pipeline_req_pool_[i];
+      if (!pool.empty()) {
+        stats_->pipeline_cache_capacity -= pool.back()->StorageCapacity();
+        pool.pop_back();
+        break;
+      }
+    }
   }
 }
 
-Connection::PipelineMessagePtr Connection::GetFromPipelinePool() {
-  if (pipeline_req_pool_.empty())
+Connection::PipelineMessagePtr Connection::GetFromPipelinePool(size_t backing_sz) {
+  unsigned cls = SizeClass(backing_sz);
+  if (cls >= kNumSizeClasses)  // Too large to be pooled.
     return nullptr;
 
-  free_req_release_weight = 0;  // Reset the release weight.
-  auto ptr = move(pipeline_req_pool_.back());
-  stats_->pipeline_cache_capacity -= ptr->StorageCapacity();
-  pipeline_req_pool_.pop_back();
-  return ptr;
+  // The exact class is preferred, but an entry from a larger class fits as well without
+  // reallocating its storage.
+  for (unsigned i = cls; i < kNumSizeClasses; ++i) {
+    auto& pool = pipeline_req_pool_[i];
+    if (pool.empty())
+      continue;
+
+    free_req_release_weight = 0;  // Reset the release weight.
+    auto ptr = move(pool.back());
+    pool.pop_back();
+    stats_->pipeline_cache_capacity -= ptr->StorageCapacity();
+    return ptr;
+  }
+  return nullptr;
+}
+
+void Connection::RetainInPipelinePool(PipelineMessagePtr msg, size_t limit) {
+  if (stats_->pipeline_cache_capacity >= limit)
+    return;
+
+  // Messages are filed by the storage they actually own, which may exceed the size of the
+  // request that produced them.
+  unsigned cls = SizeClass(msg->storage.capacity());
+  if (cls >= kNumSizeClasses)  // Too large to be worth caching.
+    return;
+
+  stats_->pipeline_cache_capacity += msg->StorageCapacity();
+  pipeline_req_pool_[cls].push_back(move(msg));
 }
 
 void Connection::ShutdownSelf() {
@@ -851,7 +1059,8 @@ void Connection::Migrate(util::fb2::ProactorBase* dest) {
 }
 
 void Connection::ShutdownThreadLocal() {
-  pipeline_req_pool_.clear();
+  for (auto& pool : pipeline_req_pool_)
+    pool.clear();
 }
 
 bool Connection::IsCurrentlyDispatching() const {
@@ -878,13 +1087,33 @@ void Connection::SendMonitorMessageAsync(string msg) {
   SendAsync({MonitorMessage{move(msg)}});
 }
 
+void Connection::SendInvalidationMessageAsync(InvalidationMessage msg) {
+  SendAsync({move(msg)});
+}
+
+void Connection::LaunchDispatchFiberIfNeeded() {
+  if (!dispatch_fb_.IsJoinable()) {
+    VLOG(1) << "Spawning dispatch fiber";
+    dispatch_fb_ = MakeFiber(dfly::Launch::dispatch, [this] { DispatchFiber(socket_.get()); });
+  }
+}
+
+void Connection::RequestAsyncMigration(util::fb2::ProactorBase* dest) {
+  migration_request_ = dest;
+}
+
 void Connection::SendAsync(MessageHandle msg) {
   DCHECK(cc_);
 
   if (cc_->conn_closing)
     return;
 
-  dispatch_q_bytes_.fetch_add(msg.UsedMemory(), memory_order_relaxed);
+  LaunchDispatchFiberIfNeeded();
+
+  size_t used_mem = msg.UsedMemory();
+  dispatch_q_bytes_.fetch_add(used_mem, memory_order_relaxed);
+  g_dispatch_q_bytes.fetch_add(used_mem, memory_order_relaxed);
+  stats_->dispatch_queue_bytes += used_mem;
 
   dispatch_q_.push_back(move(msg));
 
@@ -897,9 +1126,23 @@ void Connection::SendAsync(MessageHandle msg) {
   }
 }
 
+bool Connection::ShouldThrottleDispatch() const {
+  size_t my_bytes = dispatch_q_bytes_.load(memory_order_relaxed);
+  if (my_bytes > absl::GetFlag(FLAGS_dispatch_queue_limit))
+    return true;
+
+  // Under global pressure, deprioritize the heaviest connections: those holding more
+  // than 1% of the global budget pause while lightly loaded clients keep being served.
+  size_t global_limit = absl::GetFlag(FLAGS_dispatch_queue_global_limit);
+  return global_limit > 0 && g_dispatch_q_bytes.load(memory_order_relaxed) > global_limit &&
+         my_bytes > global_limit / 100;
+}
+
 void Connection::EnsureAsyncMemoryBudget() {
-  evc_bp_.await(
-      [this] { return dispatch_q_bytes_.load(memory_order_relaxed) <= kMaxDispatchQMemory; });
+  evc_bp_.await([this] {
+    return dispatch_q_bytes_.load(memory_order_relaxed) <=
+           absl::GetFlag(FLAGS_dispatch_queue_limit);
+  });
 }
 
 std::string Connection::RemoteEndpointStr() const {
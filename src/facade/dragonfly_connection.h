@@ -8,6 +8,7 @@
 #include <mimalloc.h>
 #include <sys/socket.h>
 
+#include <array>
 #include <deque>
 #include <memory>
 #include <string_view>
@@ -79,6 +80,9 @@ class Connection : public util::Connection {
 
   struct MonitorMessage : public std::string {};
 
+  // Invalidation push for client-side caching (CLIENT TRACKING). Holds the key that changed.
+  struct InvalidationMessage : public std::string {};
+
   struct PipelineMessage {
     PipelineMessage(size_t nargs, size_t capacity) : args(nargs), storage(capacity) {
     }
@@ -111,7 +115,7 @@ class Connection : public util::Connection {
 
     bool IsPipelineMsg() const;
 
-    std::variant<MonitorMessage, PubMessagePtr, PipelineMessagePtr> handle;
+    std::variant<MonitorMessage, PubMessagePtr, PipelineMessagePtr, InvalidationMessage> handle;
   };
 
   enum Phase { READ_SOCKET, PROCESS };
@@ -124,6 +128,10 @@ class Connection : public util::Connection {
   // Add monitor message to dispatch queue.
   void SendMonitorMessageAsync(std::string);
 
+  // Add invalidation message to dispatch queue.
+  // Virtual because behavior is overridden in test_utils.
+  virtual void SendInvalidationMessageAsync(InvalidationMessage);
+
   // Must be called before Send_Async to ensure the connection dispatch queue is not overfilled.
   // Blocks until free space is available.
   void EnsureAsyncMemoryBudget();
@@ -142,6 +150,11 @@ class Connection : public util::Connection {
   // Migrate this connecton to a different thread.
   void Migrate(util::fb2::ProactorBase* dest);
 
+  // Request the connection to migrate to a different thread once it becomes idle.
+  // The migration is performed by the io loop and is skipped if the connection is not
+  // idle by then (active dispatch fiber, pending queue entries or subscriptions).
+  void RequestAsyncMigration(util::fb2::ProactorBase* dest);
+
   static void ShutdownThreadLocal();
 
   bool IsCurrentlyDispatching() const;
@@ -200,8 +213,17 @@ class Connection : public util::Connection {
   // Handles events from dispatch queue.
   void DispatchFiber(util::FiberSocketBase* peer);
 
+  // Start dispatch_fb_ if it is not running yet. It is started lazily so that connections
+  // that never use the async queue stay eligible for thread migration.
+  void LaunchDispatchFiberIfNeeded();
+
   void SendAsync(MessageHandle msg);
 
+  // Whether the read path must pause until the dispatch queue drains - either this
+  // connection exceeded its own dispatch memory budget, or the global budget is
+  // exhausted and this connection is among the heaviest contributors.
+  bool ShouldThrottleDispatch() const;
+
   // Create new pipeline request, re-use from pool when possible.
   PipelineMessagePtr FromArgs(RespVec args, mi_heap_t* heap);
 
@@ -213,12 +235,24 @@ class Connection : public util::Connection {
   // Shrink pipeline pool by a little while handling regular commands.
   void ShrinkPipelinePool();
 
-  // Returns non-null request ptr if pool has vacant entries.
-  PipelineMessagePtr GetFromPipelinePool();
+  // Returns non-null request ptr if the pool has an entry whose storage covers backing_sz,
+  // so filling it does not allocate.
+  PipelineMessagePtr GetFromPipelinePool(size_t backing_sz);
+
+  // Retains msg in the pool, keyed by its storage capacity, unless the pool is at its
+  // memory limit or the message is too large to be worth caching.
+  void RetainInPipelinePool(PipelineMessagePtr msg, size_t limit);
+
+  // Maps a request backing size to its pool size class, or kNumSizeClasses if requests of
+  // this size are not pooled.
+  static unsigned SizeClass(size_t backing_sz);
 
  private:
   std::deque<MessageHandle> dispatch_q_;  // dispatch queue
   dfly::EventCount evc_;                  // dispatch queue waker
+  dfly::Fiber dispatch_fb_;               // started lazily by LaunchDispatchFiberIfNeeded
+
+  util::fb2::ProactorBase* migration_request_ = nullptr;
 
   std::atomic_uint64_t dispatch_q_bytes_ = 0;  // memory usage of all entries
   dfly::EventCount evc_bp_;                    // backpressure for memory limit
@@ -254,10 +288,13 @@ class Connection : public util::Connection {
   RespVec tmp_parse_args_;
   CmdArgVec tmp_cmd_vec_;
 
-  // Pooled pipieline messages per-thread.
+  // Pooled pipieline messages per-thread, split into power-of-two storage size classes so
+  // that a steady pipelined workload reuses buffers of the right size without reallocating.
   // Aggregated while handling pipelines,
   // graudally released while handling regular commands.
-  static thread_local std::vector<PipelineMessagePtr> pipeline_req_pool_;
+  static constexpr unsigned kNumSizeClasses = 8;
+  static thread_local std::array<std::vector<PipelineMessagePtr>, kNumSizeClasses>
+      pipeline_req_pool_;
 };
 
 void RespToArgList(const RespVec& src, CmdArgVec* dest);
@@ -21,7 +21,7 @@ constexpr size_t kSizeConnStats = sizeof(ConnectionStats);
 
 ConnectionStats& ConnectionStats::operator+=(const ConnectionStats& o) {
   // To break this code deliberately if we add/remove a field to this struct.
-  static_assert(kSizeConnStats == 176);
+  static_assert(kSizeConnStats == 224);
 
   ADD(read_buf_capacity);
   ADD(pipeline_cache_capacity);
@@ -31,8 +31,14 @@ ConnectionStats& ConnectionStats::operator+=(const ConnectionStats& o) {
   ADD(io_write_bytes);
   ADD(command_cnt);
   ADD(pipelined_cmd_cnt);
+  ADD(pipeline_cache_hit_cnt);
+  ADD(pipeline_cache_miss_cnt);
+  ADD(reply_buff_cache_capacity);
+  ADD(reply_buff_cache_hit_cnt);
+  ADD(reply_buff_cache_miss_cnt);
   ADD(async_writes_cnt);
   ADD(conn_received_cnt);
+  ADD(dispatch_queue_bytes);
   ADD(num_conns);
   ADD(num_replicas);
   ADD(num_blocked_clients);
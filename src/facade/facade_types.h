@@ -46,10 +46,25 @@ struct ConnectionStats {
   uint64_t command_cnt = 0;
   uint64_t pipelined_cmd_cnt = 0;
 
+  // How often a pipeline message was taken from the pool vs allocated anew
+  // (see Connection::FromArgs).
+  uint64_t pipeline_cache_hit_cnt = 0;
+  uint64_t pipeline_cache_miss_cnt = 0;
+
+  // The thread-local pool of reply batch buffers (see SinkReplyBuilder): how many bytes it
+  // currently parks and how often a reply reused a pooled buffer vs allocated a new one.
+  size_t reply_buff_cache_capacity = 0;
+  uint64_t reply_buff_cache_hit_cnt = 0;
+  uint64_t reply_buff_cache_miss_cnt = 0;
+
   // Writes count that happened via DispatchOperations call.
   uint64_t async_writes_cnt = 0;
   uint64_t conn_received_cnt = 0;
 
+  // Memory currently queued in the dispatch queues of this thread's connections
+  // (see Connection::dispatch_q_).
+  size_t dispatch_queue_bytes = 0;
+
   uint32_t num_conns = 0;
   uint32_t num_replicas = 0;
   uint32_t num_blocked_clients = 0;
@@ -0,0 +1,131 @@
+// Copyright 2023, DragonflyDB authors.  All rights reserved.
+// See LICENSE for licensing terms.
+//
+#include "facade/ktls.h"
+
+#ifdef DFLY_USE_SSL
+
+#include <linux/tls.h>
+#include <netinet/tcp.h>
+#include <openssl/kdf.h>
+#include <sys/socket.h>
+
+#include <cstring>
+
+#include "base/logging.h"
+
+namespace facade {
+
+namespace {
+
+// AES128-GCM is an AEAD cipher, so the TLS1.2 key block consists of just
+// client_write_key(16) server_write_key(16) client_write_iv(4) server_write_iv(4).
+constexpr size_t kAes128GcmKeyLen = 16;
+constexpr size_t kAes128GcmSaltLen = 4;
+constexpr size_t kKeyBlockLen = 2 * (kAes128GcmKeyLen + kAes128GcmSaltLen);
+
+// Rederives the TLS1.2 key block: PRF(master_secret, "key expansion",
+// server_random + client_random). OpenSSL does not expose the record keys directly but
+// its PRF is reachable via the EVP_PKEY_TLS1_PRF interface.
+bool DeriveKeyBlock(SSL* ssl, uint8_t dest[kKeyBlockLen]) {
+  uint8_t master[48];
+  uint8_t randoms[64];  // server_random followed by client_random.
+
+  SSL_SESSION* sess = SSL_get_session(ssl);
+  size_t master_len = SSL_SESSION_get_master_key(sess, master, sizeof(master));
+  if (master_len == 0)
+    return false;
+  SSL_get_server_random(ssl, randoms, 32);
+  SSL_get_client_random(ssl, randoms + 32, 32);
+
+  EVP_PKEY_CTX* pctx = EVP_PKEY_CTX_new_id(EVP_PKEY_TLS1_PRF, nullptr);
+  if (!pctx)
+    return false;
+
+  size_t outlen = kKeyBlockLen;
+  bool res = EVP_PKEY_derive_init(pctx) == 1 &&
+             EVP_PKEY_CTX_set_tls1_prf_md(pctx, EVP_sha256()) == 1 &&
+             EVP_PKEY_CTX_set1_tls1_prf_secret(pctx, master, master_len) == 1 &&
+             EVP_PKEY_CTX_add1_tls1_prf_seed(pctx, (const uint8_t*)"key expansion", 13) == 1 &&
+             EVP_PKEY_CTX_add1_tls1_prf_seed(pctx, randoms, sizeof(randoms)) == 1 &&
+             EVP_PKEY_derive(pctx, dest, &outlen) == 1 && outlen == kKeyBlockLen;
+
+  EVP_PKEY_CTX_free(pctx);
+  OPENSSL_cleanse(master, sizeof(master));
+
+  return res;
+}
+
+void FillCryptoInfo(tls12_crypto_info_aes_gcm_128* info, const uint8_t* key, const uint8_t* salt) {
+  memset(info, 0, sizeof(*info));
+  info->info.version = TLS_1_2_VERSION;
+  info->info.cipher_type = TLS_CIPHER_AES_GCM_128;
+  memcpy(info->key, key, kAes128GcmKeyLen);
+  memcpy(info->salt, salt, kAes128GcmSaltLen);
+
+  // Right after a full handshake each side has sent exactly one encrypted record -
+  // its Finished message - so both directions continue from sequence 1. The explicit
+  // nonce is seeded with the same value, the kernel advances it per record.
+  uint8_t seq[8] = {0, 0, 0, 0, 0, 0, 0, 1};
+  memcpy(info->rec_seq, seq, sizeof(seq));
+  memcpy(info->iv, seq, sizeof(seq));
+}
+
+}  // namespace
+
+KTlsStatus EnableKTls(int fd, SSL* ssl) {
+  // A resumed or renegotiated session has a different record sequence, and ciphers other
+  // than AES128-GCM use a different PRF hash and crypto_info layout.
+  if (SSL_version(ssl) != TLS1_2_VERSION || SSL_session_reused(ssl))
+    return KTlsStatus::UNSUPPORTED;
+
+  const SSL_CIPHER* cipher = SSL_get_current_cipher(ssl);
+  if (!cipher || SSL_CIPHER_get_cipher_nid(cipher) != NID_aes_128_gcm)
+    return KTlsStatus::UNSUPPORTED;
+
+  uint8_t key_block[kKeyBlockLen];
+  if (!DeriveKeyBlock(ssl, key_block))
+    return KTlsStatus::UNSUPPORTED;
+
+  const uint8_t* client_key = key_block;
+  const uint8_t* server_key = key_block + kAes128GcmKeyLen;
+  const uint8_t* client_salt = key_block + 2 * kAes128GcmKeyLen;
+  const uint8_t* server_salt = client_salt + kAes128GcmSaltLen;
+
+  // Fails with ENOENT when the tls kernel module is not available.
+  if (setsockopt(fd, IPPROTO_TCP, TCP_ULP, "tls", 4) != 0) {
+    VLOG(1) << "TCP_ULP tls: " << strerror(errno);
+    OPENSSL_cleanse(key_block, sizeof(key_block));
+    return KTlsStatus::UNSUPPORTED;
+  }
+
+  tls12_crypto_info_aes_gcm_128 info;
+
+  // We are the server: TX uses the server write keys, RX the client ones.
+  FillCryptoInfo(&info, server_key, server_salt);
+  int tx_res = setsockopt(fd, SOL_TLS, TLS_TX, &info, sizeof(info));
+
+  KTlsStatus status = KTlsStatus::UNSUPPORTED;
+  if (tx_res == 0) {
+    FillCryptoInfo(&info, client_key, client_salt);
+    if (setsockopt(fd, SOL_TLS, TLS_RX, &info, sizeof(info)) == 0) {
+      status = KTlsStatus::ENABLED;
+    } else {
+      // TX already offloaded but RX was not (pre-4.17 kernel) - the socket can not go
+      // back to userspace TLS, so the connection must be dropped.
+      LOG(WARNING) << "kTLS RX failed after TX succeeded: " << strerror(errno);
+      status = KTlsStatus::FAILED;
+    }
+  } else {
+    VLOG(1) << "TLS_TX: " << strerror(errno);
+  }
+
+  OPENSSL_cleanse(&info, sizeof(info));
+  OPENSSL_cleanse(key_block, sizeof(key_block));
+
+  return status;
+}
+
+}  // namespace facade
+
+#endif  // DFLY_USE_SSL
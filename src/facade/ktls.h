@@ -0,0 +1,28 @@
+// Copyright 2023, DragonflyDB authors.  All rights reserved.
+// See LICENSE for licensing terms.
+//
+#pragma once
+
+#ifdef DFLY_USE_SSL
+
+#include <openssl/ssl.h>
+
+namespace facade {
+
+enum class KTlsStatus {
+  ENABLED,      // The kernel now encrypts and decrypts the records on fd.
+  UNSUPPORTED,  // The session or the kernel does not qualify, keep the userspace engine.
+  FAILED,       // The socket is left in an inconsistent state, the connection must be closed.
+};
+
+// Pushes the session keys of an established TLS session into the socket (kernel TLS),
+// so that reads and writes on the raw fd travel encrypted without a userspace copy and
+// large replies become eligible for zero-copy sends.
+// Limited to fresh TLS1.2 AES128-GCM sessions - the lowest common denominator of kernel
+// kTLS support. Must be called right after the handshake, before any application data
+// is read or written through ssl.
+KTlsStatus EnableKTls(int fd, SSL* ssl);
+
+}  // namespace facade
+
+#endif  // DFLY_USE_SSL
@@ -3,6 +3,7 @@
 //
 #include "facade/memcache_parser.h"
 
+#include <absl/base/internal/endian.h>
 #include <absl/container/flat_hash_map.h>
 #include <absl/strings/ascii.h>
 #include <absl/strings/numbers.h>
@@ -15,6 +16,77 @@ using MP = MemcacheParser;
 
 namespace {
 
+constexpr uint8_t kBinaryMagic = 0x80;
+constexpr uint32_t kBinHeaderLen = 24;
+
+// Maps a binary protocol opcode to a command type. Quiet variants suppress the response
+// (on miss for gets, entirely for mutations), which we approximate with no_reply.
+MP::CmdType FromOpcode(uint8_t opcode, bool* quiet) {
+  *quiet = false;
+  switch (opcode) {
+    case 0x09:  // GETQ
+    case 0x0d:  // GETKQ
+      *quiet = true;
+      [[fallthrough]];
+    case 0x00:  // GET
+    case 0x0c:  // GETK
+      return MP::GET;
+    case 0x11:  // SETQ
+      *quiet = true;
+      [[fallthrough]];
+    case 0x01:  // SET
+      return MP::SET;
+    case 0x12:  // ADDQ
+      *quiet = true;
+      [[fallthrough]];
+    case 0x02:  // ADD
+      return MP::ADD;
+    case 0x13:  // REPLACEQ
+      *quiet = true;
+      [[fallthrough]];
+    case 0x03:  // REPLACE
+      return MP::REPLACE;
+    case 0x19:  // APPENDQ
+      *quiet = true;
+      [[fallthrough]];
+    case 0x0e:  // APPEND
+      return MP::APPEND;
+    case 0x1a:  // PREPENDQ
+      *quiet = true;
+      [[fallthrough]];
+    case 0x0f:  // PREPEND
+      return MP::PREPEND;
+    case 0x14:  // DELETEQ
+      *quiet = true;
+      [[fallthrough]];
+    case 0x04:  // DELETE
+      return MP::DELETE;
+    case 0x15:  // INCREMENTQ
+      *quiet = true;
+      [[fallthrough]];
+    case 0x05:  // INCREMENT
+      return MP::INCR;
+    case 0x16:  // DECREMENTQ
+      *quiet = true;
+      [[fallthrough]];
+    case 0x06:  // DECREMENT
+      return MP::DECR;
+    case 0x18:  // FLUSHQ
+      *quiet = true;
+      [[fallthrough]];
+    case 0x08:  // FLUSH
+      return MP::FLUSHALL;
+    case 0x07:  // QUIT
+      return MP::QUIT;
+    case 0x0b:  // VERSION
+      return MP::VERSION;
+    case 0x10:  // STAT
+      return MP::STATS;
+    default:
+      return MP::INVALID;
+  }
+}
+
 MP::CmdType From(string_view token) {
   static absl::flat_hash_map<string_view, MP::CmdType> cmd_map{
       {"set", MP::SET},       {"add", MP::ADD},         {"replace", MP::REPLACE},
@@ -103,13 +175,23 @@ MP::Result ParseValueless(const std::string_view* tokens, unsigned num_tokens, M
 
 auto MP::Parse(string_view str, uint32_t* consumed, Command* cmd) -> Result {
   cmd->no_reply = false;  // re-initialize
-  auto pos = str.find('\n');
   *consumed = 0;
+
+  if (binary_ || (!str.empty() && uint8_t(str.front()) == kBinaryMagic)) {
+    binary_ = true;  // binary clients never switch back to the text protocol.
+    return ParseBinary(str, consumed, cmd);
+  }
+
+  // The prefix [0, scanned_) was already searched for '\n' by a previous call that returned
+  // INPUT_PENDING, so we continue from there.
+  auto pos = str.find('\n', scanned_);
   if (pos == string_view::npos) {
+    scanned_ = str.size();
     // TODO: it's over simplified since we may process GET/GAT command that is not limited to
     // 300 characters.
     return str.size() > 300 ? PARSE_ERROR : INPUT_PENDING;
   }
+  scanned_ = 0;
 
   if (pos == 0) {
     return PARSE_ERROR;
@@ -174,4 +256,84 @@ auto MP::Parse(string_view str, uint32_t* consumed, Command* cmd) -> Result {
   return ParseValueless(tokens + 1, num_tokens - 1, cmd);
 };
 
+auto MP::ParseBinary(string_view str, uint32_t* consumed, Command* cmd) -> Result {
+  if (bin_state_ == BIN_HEADER) {
+    if (str.size() < kBinHeaderLen)
+      return INPUT_PENDING;
+
+    const uint8_t* u = reinterpret_cast<const uint8_t*>(str.data());
+    if (u[0] != kBinaryMagic)
+      return PARSE_ERROR;
+
+    bin_opcode_ = u[1];
+    bin_keylen_ = absl::big_endian::Load16(u + 2);
+    bin_extlen_ = u[4];
+    bin_bodylen_ = absl::big_endian::Load32(u + 8);
+    bin_opaque_ = absl::big_endian::Load32(u + 12);
+    bin_cas_ = absl::big_endian::Load64(u + 16);
+
+    if (bin_bodylen_ < uint32_t{bin_keylen_} + bin_extlen_ || bin_keylen_ > 250)
+      return PARSE_ERROR;
+
+    // The header is consumed right away - when the rest of the command arrives in later
+    // calls we resume from BIN_BODY without decoding it again.
+    *consumed = kBinHeaderLen;
+    str.remove_prefix(kBinHeaderLen);
+    bin_state_ = BIN_BODY;
+  }
+
+  // Extras and key are small (at most 20 + 250 bytes) so we wait for them to arrive in
+  // full. The value blob, which dominates large requests, is read by the caller.
+  uint32_t prefix_len = uint32_t{bin_extlen_} + bin_keylen_;
+  if (str.size() < prefix_len)
+    return INPUT_PENDING;
+
+  *consumed += prefix_len;
+  bin_state_ = BIN_HEADER;
+
+  cmd->key = str.substr(bin_extlen_, bin_keylen_);
+  cmd->bytes_len = bin_bodylen_ - prefix_len;
+  cmd->opaque = bin_opaque_;
+
+  bool quiet = false;
+  cmd->type = FromOpcode(bin_opcode_, &quiet);
+  if (cmd->type == INVALID)
+    return UNKNOWN_CMD;
+  cmd->no_reply = quiet;
+
+  const uint8_t* ext = reinterpret_cast<const uint8_t*>(str.data());
+  if (IsStoreCmd(cmd->type)) {
+    if (bin_extlen_ != 8 || bin_keylen_ == 0)
+      return PARSE_ERROR;
+
+    cmd->flags = absl::big_endian::Load32(ext);
+    cmd->expire_ts = absl::big_endian::Load32(ext + 4);
+    if (bin_cas_) {
+      cmd->cas_unique = bin_cas_;
+      if (cmd->type == SET)
+        cmd->type = CAS;
+    }
+  } else if (cmd->type == INCR || cmd->type == DECR) {
+    // Extras: delta(8), initial(8), expiration(4). Like the text protocol we do not
+    // support seeding a missing key, so the initial value is ignored.
+    if (bin_extlen_ != 20 || bin_keylen_ == 0 || cmd->bytes_len != 0)
+      return PARSE_ERROR;
+
+    cmd->delta = absl::big_endian::Load64(ext);
+    cmd->expire_ts = absl::big_endian::Load32(ext + 16);
+  } else if (cmd->type == FLUSHALL) {
+    if ((bin_extlen_ != 0 && bin_extlen_ != 4) || cmd->bytes_len != 0)
+      return PARSE_ERROR;
+
+    if (bin_extlen_ == 4)
+      cmd->expire_ts = absl::big_endian::Load32(ext);
+  } else {  // Retrieval commands, DELETE, QUIT, VERSION, STATS.
+    bool requires_key = cmd->type == GET || cmd->type == DELETE;
+    if (bin_extlen_ != 0 || cmd->bytes_len != 0 || (requires_key && bin_keylen_ == 0))
+      return PARSE_ERROR;
+  }
+
+  return OK;
+}
+
 }  // namespace facade
@@ -13,6 +13,12 @@ namespace facade {
 // Memcache parser does not parse value blobs, only the commands.
 // The expectation is that the caller will parse the command and
 // then will follow up with reading the blob data directly from source.
+//
+// Both the text and the binary protocols are supported. The protocol is detected from the
+// first byte of the stream (0x80 is the binary request magic) and stays fixed for the
+// lifetime of the parser. Parsing is resumable: when INPUT_PENDING is returned the caller
+// should call Parse again with the same unconsumed prefix plus newly arrived bytes, and the
+// parser continues from where it stopped without re-scanning what it has already seen.
 class MemcacheParser {
  public:
   enum CmdType {
@@ -55,6 +61,7 @@ class MemcacheParser {
     uint32_t expire_ts = 0;  // relative time in seconds.
     uint32_t bytes_len = 0;
     uint32_t flags = 0;
+    uint32_t opaque = 0;  // binary protocol only, echoed back in the response.
     bool no_reply = false;
   };
 
@@ -73,7 +80,35 @@ class MemcacheParser {
 
   Result Parse(std::string_view str, uint32_t* consumed, Command* res);
 
+  // True if the stream was detected to use the binary protocol. Binary value blobs follow
+  // the key directly and are not terminated by CRLF.
+  bool IsBinaryProtocol() const {
+    return binary_;
+  }
+
  private:
+  Result ParseBinary(std::string_view str, uint32_t* consumed, Command* res);
+
+  // Binary protocol state machine. The fixed 24-byte request header is decoded and consumed
+  // as soon as it arrives, so a large command split across many tcp segments is parsed in
+  // linear time - only extras+key (at most a few hundred bytes) are ever awaited in full.
+  enum BinState : uint8_t {
+    BIN_HEADER,  // waiting for the request header.
+    BIN_BODY,    // header decoded, waiting for extras and key.
+  };
+
+  BinState bin_state_ = BIN_HEADER;
+  bool binary_ = false;
+  uint8_t bin_opcode_ = 0;
+  uint8_t bin_extlen_ = 0;
+  uint16_t bin_keylen_ = 0;
+  uint32_t bin_bodylen_ = 0;
+  uint32_t bin_opaque_ = 0;
+  uint64_t bin_cas_ = 0;
+
+  // Text protocol: length of the pending input prefix already scanned for '\n', so that
+  // a partial line is not re-scanned when more data arrives.
+  uint32_t scanned_ = 0;
 };
 
 }  // namespace facade
@@ -6,6 +6,7 @@
 
 #include <gmock/gmock.h>
 
+#include "absl/base/internal/endian.h"
 #include "absl/strings/str_cat.h"
 #include "base/gtest.h"
 #include "base/logging.h"
@@ -128,4 +129,102 @@ TEST_F(MCParserNoreplyTest, Other) {
   RunTest("flush_all\r\n", false);
 }
 
+TEST_F(MCParserTest, PartialLineResume) {
+  // A partial text line is pending and is completed by a second call with more data.
+  MemcacheParser::Result st = parser_.Parse("set a 1 ", &consumed_, &cmd_);
+  EXPECT_EQ(MemcacheParser::INPUT_PENDING, st);
+  EXPECT_EQ(0u, consumed_);
+
+  st = parser_.Parse("set a 1 20 3\r\n", &consumed_, &cmd_);
+  EXPECT_EQ(MemcacheParser::OK, st);
+  EXPECT_EQ("a", cmd_.key);
+  EXPECT_EQ(3, cmd_.bytes_len);
+}
+
+class MCParserBinaryTest : public MCParserTest {
+ protected:
+  // Builds a binary protocol request: 24 byte header followed by extras, key and value.
+  static string Packet(uint8_t opcode, string_view key, string_view extras,
+                       string_view value = "", uint64_t cas = 0) {
+    string res(24, '\0');
+    res[0] = 0x80;
+    res[1] = opcode;
+    absl::big_endian::Store16(res.data() + 2, key.size());
+    res[4] = extras.size();
+    absl::big_endian::Store32(res.data() + 8, extras.size() + key.size() + value.size());
+    absl::big_endian::Store32(res.data() + 12, 0xdeadbeef);
+    absl::big_endian::Store64(res.data() + 16, cas);
+    return absl::StrCat(res, extras, key, value);
+  }
+};
+
+TEST_F(MCParserBinaryTest, Set) {
+  string_view extras("\x00\x00\x00\x01\x00\x00\x00\x14", 8);  // flags 1, expiry 20.
+  string packet = Packet(0x01, "key", extras, "value");
+
+  MemcacheParser::Result st = parser_.Parse(packet, &consumed_, &cmd_);
+  EXPECT_EQ(MemcacheParser::OK, st);
+  EXPECT_TRUE(parser_.IsBinaryProtocol());
+  EXPECT_EQ(MemcacheParser::SET, cmd_.type);
+  EXPECT_EQ("key", cmd_.key);
+  EXPECT_EQ(1, cmd_.flags);
+  EXPECT_EQ(20, cmd_.expire_ts);
+  EXPECT_EQ(0xdeadbeef, cmd_.opaque);
+  EXPECT_FALSE(cmd_.no_reply);
+
+  // The value blob is left for the caller, like in the text protocol.
+  EXPECT_EQ(5, cmd_.bytes_len);
+  EXPECT_EQ(24 + 8 + 3, consumed_);
+  EXPECT_EQ("value", packet.substr(consumed_, cmd_.bytes_len));
+}
+
+TEST_F(MCParserBinaryTest, SplitResume) {
+  string_view extras("\x00\x00\x00\x00\x00\x00\x00\x00", 8);
+  string packet = Packet(0x11, "mykey", extras, "value");  // SETQ
+
+  // Header is incomplete - nothing is consumed.
+  MemcacheParser::Result st = parser_.Parse(string_view{packet}.substr(0, 10), &consumed_, &cmd_);
+  EXPECT_EQ(MemcacheParser::INPUT_PENDING, st);
+  EXPECT_EQ(0u, consumed_);
+
+  // The full header is consumed even though extras+key did not arrive yet.
+  st = parser_.Parse(string_view{packet}.substr(0, 30), &consumed_, &cmd_);
+  EXPECT_EQ(MemcacheParser::INPUT_PENDING, st);
+  EXPECT_EQ(24u, consumed_);
+
+  // The remainder resumes without the header.
+  st = parser_.Parse(string_view{packet}.substr(24), &consumed_, &cmd_);
+  EXPECT_EQ(MemcacheParser::OK, st);
+  EXPECT_EQ(8 + 5, consumed_);
+  EXPECT_EQ(MemcacheParser::SET, cmd_.type);
+  EXPECT_EQ("mykey", cmd_.key);
+  EXPECT_EQ(5, cmd_.bytes_len);
+  EXPECT_TRUE(cmd_.no_reply);
+}
+
+TEST_F(MCParserBinaryTest, GetIncrCas) {
+  string packet = Packet(0x00, "foo", "");
+  EXPECT_EQ(MemcacheParser::OK, parser_.Parse(packet, &consumed_, &cmd_));
+  EXPECT_EQ(MemcacheParser::GET, cmd_.type);
+  EXPECT_EQ("foo", cmd_.key);
+  EXPECT_EQ(0, cmd_.bytes_len);
+
+  // INCREMENT: delta 10, initial and expiration zero.
+  string extras(20, '\0');
+  absl::big_endian::Store64(extras.data(), 10);
+  packet = Packet(0x05, "counter", extras);
+  cmd_ = MemcacheParser::Command{};
+  EXPECT_EQ(MemcacheParser::OK, parser_.Parse(packet, &consumed_, &cmd_));
+  EXPECT_EQ(MemcacheParser::INCR, cmd_.type);
+  EXPECT_EQ(10, cmd_.delta);
+
+  // SET with a non-zero cas field becomes a check-and-set.
+  string_view store_extras("\x00\x00\x00\x00\x00\x00\x00\x00", 8);
+  packet = Packet(0x01, "bar", store_extras, "v", 42);
+  cmd_ = MemcacheParser::Command{};
+  EXPECT_EQ(MemcacheParser::OK, parser_.Parse(packet, &consumed_, &cmd_));
+  EXPECT_EQ(MemcacheParser::CAS, cmd_.type);
+  EXPECT_EQ(42, cmd_.cas_unique);
+}
+
 }  // namespace facade
@@ -419,23 +419,28 @@ auto RedisParser::ConsumeBulk(Buffer str) -> Result {
     return OK;
   }
 
-  if (str.size() >= 32) {
+  if (is_broken_token_) {
+    size_t len = std::min<size_t>(str.size(), bulk_len_);
+
+    memcpy(bulk_str.end(), str.data(), len);
+    bulk_str = Buffer{bulk_str.data(), bulk_str.size() + len};
+    DVLOG(1) << "Extending bulk stash to size " << bulk_str.size();
+    last_consumed_ = len;
+    bulk_len_ -= len;
+  } else if (str.size() >= 32 && bulk_len_ + 2 > zero_copy_bulk_limit_) {
+    // The bulk is too long for the caller to accumulate contiguously, so we start copying it
+    // aside. Smaller bulks are left unconsumed - the caller will grow its buffer according to
+    // parselen_hint() and they will eventually parse as slices of the input buffer.
     DCHECK(bulk_len_);
     size_t len = std::min<size_t>(str.size(), bulk_len_);
 
-    if (is_broken_token_) {
-      memcpy(bulk_str.end(), str.data(), len);
-      bulk_str = Buffer{bulk_str.data(), bulk_str.size() + len};
-      DVLOG(1) << "Extending bulk stash to size " << bulk_str.size();
-    } else {
-      DVLOG(1) << "New bulk stash size " << bulk_len_;
-      std::unique_ptr<uint8_t[]> nb(new uint8_t[bulk_len_]);
-      memcpy(nb.get(), str.data(), len);
-      bulk_str = Buffer{nb.get(), len};
-      buf_stash_.emplace_back(move(nb));
-      is_broken_token_ = true;
-      cached_expr_->back().has_support = true;
-    }
+    DVLOG(1) << "New bulk stash size " << bulk_len_;
+    std::unique_ptr<uint8_t[]> nb(new uint8_t[bulk_len_]);
+    memcpy(nb.get(), str.data(), len);
+    bulk_str = Buffer{nb.get(), len};
+    buf_stash_.emplace_back(move(nb));
+    is_broken_token_ = true;
+    cached_expr_->back().has_support = true;
     last_consumed_ = len;
     bulk_len_ -= len;
   }
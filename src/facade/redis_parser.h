@@ -47,8 +47,18 @@ class RedisParser {
     server_mode_ = false;
   }
 
+  // Bulk strings shorter than the limit that were received only partially are left
+  // unconsumed in the input buffer instead of being copied aside, so that once they
+  // complete they are returned as slices of the input buffer (zero-copy).
+  // A caller enabling this must grow its buffer according to parselen_hint(), with enough
+  // slack for the unconsumed prefix, otherwise parsing may never progress.
+  // Callers with fixed-size buffers must leave the limit at 0.
+  void SetZeroCopyBulkLimit(uint32_t limit) {
+    zero_copy_bulk_limit_ = limit;
+  }
+
   size_t parselen_hint() const {
-    return bulk_len_;
+    return bulk_len_ ? bulk_len_ + 2 : 0;  // account for the terminating CRLF.
   }
 
   size_t stash_size() const {
@@ -89,6 +99,7 @@ class RedisParser {
 
   uint32_t last_consumed_ = 0;
   uint32_t bulk_len_ = 0;
+  uint32_t zero_copy_bulk_limit_ = 0;
   uint32_t last_stashed_level_ = 0, last_stashed_index_ = 0;
 
   // expected expression length, pointer to expression vector.
@@ -96,7 +96,7 @@ TEST_F(RedisParserTest, Multi1) {
 
   ASSERT_EQ(RedisParser::INPUT_PENDING, Parse("$4\r\n"));
   EXPECT_EQ(4, consumed_);
-  EXPECT_EQ(4, parser_.parselen_hint());
+  EXPECT_EQ(6, parser_.parselen_hint());  // 4 payload bytes plus CRLF.
 
   ASSERT_EQ(RedisParser::OK, Parse("PING\r\n"));
   EXPECT_EQ(6, consumed_);
@@ -191,6 +191,31 @@ TEST_F(RedisParserTest, LargeBulk) {
   ASSERT_EQ(RedisParser::OK, Parse("\r\n"));
 }
 
+TEST_F(RedisParserTest, ZeroCopyBulk) {
+  parser_.SetZeroCopyBulkLimit(1024);
+
+  ASSERT_EQ(RedisParser::INPUT_PENDING, Parse("*3\r\n$3\r\nSET\r\n$3\r\nkey\r\n$100\r\n"));
+
+  // A partial bulk under the limit is left unconsumed so the caller can accumulate it.
+  string val(100, 'x');
+  ASSERT_EQ(RedisParser::INPUT_PENDING, Parse(string_view{val}.substr(0, 60)));
+  EXPECT_EQ(0, consumed_);
+
+  string full = absl::StrCat(val, "\r\n");
+  ASSERT_EQ(RedisParser::OK, Parse(full));
+  EXPECT_EQ(full.size(), consumed_);
+  EXPECT_THAT(args_, ElementsAre("SET", "key", val));
+
+  // The value references the input buffer instead of an internal copy.
+  EXPECT_EQ(stash_.get(), args_[2].GetBuf().data());
+
+  // Bulks above the limit are copied aside as before.
+  ASSERT_EQ(RedisParser::INPUT_PENDING, Parse("*1\r\n$2048\r\n"));
+  string big(1200, 'y');
+  ASSERT_EQ(RedisParser::INPUT_PENDING, Parse(big));
+  EXPECT_EQ(big.size(), consumed_);
+}
+
 TEST_F(RedisParserTest, NILs) {
   ASSERT_EQ(RedisParser::BAD_BULKLEN, Parse("_\r\n"));
   parser_.SetClientMode();
@@ -33,6 +33,33 @@ constexpr unsigned kConvFlags =
 
 DoubleToStringConverter dfly_conv(kConvFlags, "inf", "nan", 'e', -6, 21, 6, 0);
 
+constexpr size_t kMaxBatchSize = 1024;
+
+// Reply-side counterpart of Connection::pipeline_req_pool_: a per-thread cache of batch
+// buffers split into power-of-two capacity classes. Builders lease a buffer when they start
+// to coalesce a reply and return it after the flush, so with many mostly-idle connections
+// the send buffer memory is bounded by the number of concurrently flushing ones.
+struct BatchBufPool {
+  static constexpr unsigned kNumSizeClasses = 4;
+  static constexpr size_t kMaxPooledPerClass = 64;
+
+  std::vector<string> classes[kNumSizeClasses];
+  size_t capacity = 0;  // total bytes parked in classes.
+
+  // Class i covers buffers with capacity up to kMaxBatchSize * 2^i.
+  static unsigned ClassFromCapacity(size_t cap) {
+    size_t limit = kMaxBatchSize;
+    unsigned cls = 0;
+    while (cap > limit && cls + 1 < kNumSizeClasses) {
+      limit *= 2;
+      ++cls;
+    }
+    return cls;
+  }
+};
+
+thread_local BatchBufPool batch_buf_pool;
+
 }  // namespace
 
 SinkReplyBuilder::SinkReplyBuilder(::io::Sink* sink)
@@ -46,15 +73,15 @@ void SinkReplyBuilder::CloseConnection() {
 
 void SinkReplyBuilder::Send(const iovec* v, uint32_t len) {
   DCHECK(sink_);
-  constexpr size_t kMaxBatchSize = 1024;
 
   size_t bsize = 0;
   for (unsigned i = 0; i < len; ++i) {
     bsize += v[i].iov_len;
   }
 
-  // Allow batching with up to 8K of data.
   if ((should_batch_ || should_aggregate_) && (batch_.size() + bsize < kMaxBatchSize)) {
+    if (batch_.empty())
+      AcquireBatchBuf();
     for (unsigned i = 0; i < len; ++i) {
       std::string_view src((char*)v[i].iov_base, v[i].iov_len);
       DVLOG(2) << "Appending to stream " << src;
@@ -81,6 +108,7 @@ void SinkReplyBuilder::Send(const iovec* v, uint32_t len) {
     copy(v, v + len, tmp + 1);
     ec = sink_->Write(tmp, len + 1);
     batch_.clear();
+    ReleaseBatchBuf();
   }
 
   if (ec) {
@@ -112,11 +140,60 @@ void SinkReplyBuilder::StopAggregate() {
 
   error_code ec = sink_->Write(io::Buffer(batch_));
   batch_.clear();
+  ReleaseBatchBuf();
 
   if (ec)
     ec_ = ec;
 }
 
+void SinkReplyBuilder::AcquireBatchBuf() {
+  DCHECK(batch_.empty());
+
+  auto& pool = batch_buf_pool;
+
+  // Any class fits - the buffers only differ in how much they can hold without growing.
+  for (auto& cls : pool.classes) {
+    if (cls.empty())
+      continue;
+
+    pool.capacity -= cls.back().capacity();
+    batch_.swap(cls.back());
+    cls.pop_back();
+    ++batch_buf_hit_cnt_;
+    return;
+  }
+
+  batch_.reserve(kMaxBatchSize);
+  ++batch_buf_miss_cnt_;
+}
+
+void SinkReplyBuilder::ReleaseBatchBuf() {
+  DCHECK(batch_.empty());
+  if (batch_.capacity() < kMaxBatchSize)  // inline storage, nothing to park.
+    return;
+
+  auto& pool = batch_buf_pool;
+  auto& cls = pool.classes[BatchBufPool::ClassFromCapacity(batch_.capacity())];
+
+  string buf;
+  buf.swap(batch_);  // leaves batch_ without backing storage.
+
+  if (cls.size() < BatchBufPool::kMaxPooledPerClass) {
+    pool.capacity += buf.capacity();
+    cls.push_back(move(buf));
+  }
+}
+
+size_t SinkReplyBuilder::BatchPoolCapacity() {
+  return batch_buf_pool.capacity;
+}
+
+void SinkReplyBuilder::ShutdownThreadLocal() {
+  for (auto& cls : batch_buf_pool.classes)
+    cls.clear();
+  batch_buf_pool.capacity = 0;
+}
+
 MCReplyBuilder::MCReplyBuilder(::io::Sink* sink) : SinkReplyBuilder(sink), noreply_(false) {
 }
 
@@ -303,8 +380,14 @@ void RedisReplyBuilder::SendError(OpStatus status) {
 }
 
 void RedisReplyBuilder::SendLong(long num) {
-  string str = absl::StrCat(":", num, kCRLF);
-  SendRaw(str);
+  // The digits and the :<num>\r\n framing are written into a single stack buffer,
+  // so no string is allocated per value.
+  char buf[absl::numbers_internal::kFastToBufferSize + 3];
+  buf[0] = ':';
+  char* next = absl::numbers_internal::FastIntToBuffer(num, buf + 1);
+  *next++ = '\r';
+  *next++ = '\n';
+  SendRaw(std::string_view{buf, size_t(next - buf)});
 }
 
 void RedisReplyBuilder::SendScoredArray(const std::vector<std::pair<std::string, double>>& arr,
@@ -334,33 +417,131 @@ void RedisReplyBuilder::SendScoredArray(const std::vector<std::pair<std::string,
   }
 }
 
+void RedisReplyBuilder::SendSerialized(std::string_view raw) {
+  SendRaw(raw);
+}
+
+string RedisReplyBuilder::SerializeScoredArray(const std::vector<std::pair<std::string, double>>& arr,
+                                               bool with_scores, bool is_resp3) {
+  string res;
+  size_t est = 16;
+  for (const auto& p : arr)
+    est += p.first.size() + (with_scores ? 48 : 16);
+  res.reserve(est);
+
+  char buf[64];
+  auto append_bulk = [&res](string_view s) { StrAppend(&res, "$", s.size(), kCRLF, s, kCRLF); };
+
+  if (!with_scores) {
+    StrAppend(&res, "*", arr.size(), kCRLF);
+    for (const auto& p : arr)
+      append_bulk(p.first);
+    return res;
+  }
+
+  if (!is_resp3) {  // RESP2 formats withscores as a flat array.
+    StrAppend(&res, "*", arr.size() * 2, kCRLF);
+    for (const auto& p : arr) {
+      append_bulk(p.first);
+      append_bulk(FormatDouble(p.second, buf, sizeof(buf)));
+    }
+    return res;
+  }
+
+  // Resp3 formats withscores as array of (key, score) pairs.
+  StrAppend(&res, "*", arr.size(), kCRLF);
+  for (const auto& p : arr) {
+    StrAppend(&res, "*2", kCRLF);
+    append_bulk(p.first);
+    StrAppend(&res, ",", FormatDouble(p.second, buf, sizeof(buf)), kCRLF);
+  }
+  return res;
+}
+
 void RedisReplyBuilder::SendDouble(double val) {
+  // The shortest round-trip digits (double-conversion grisu) and their protocol framing
+  // are written into a single stack buffer, so no string is allocated per value. This is
+  // the hottest spot of large ZRANGE WITHSCORES replies.
   char buf[64];
+  char* start = buf + 8;  // room to grow the framing prefix backwards
 
-  StringBuilder sb(buf, sizeof(buf));
+  StringBuilder sb(start, sizeof(buf) - 16);
   CHECK(dfly_conv.ToShortest(val, &sb));
+  size_t len = sb.position();
+  sb.Finalize();
 
-  if (!is_resp3_) {
-    SendBulkString(sb.Finalize());
+  char* head = start;
+  char* tail = start + len;
+  *tail++ = '\r';
+  *tail++ = '\n';
+
+  if (is_resp3_) {
+    *--head = ',';
   } else {
-    // RESP3
-    string str = absl::StrCat(",", sb.Finalize(), kCRLF);
-    SendRaw(str);
+    // RESP2 has no doubles, so the value goes out as a bulk string: $<len>\r\n<digits>\r\n.
+    *--head = '\n';
+    *--head = '\r';
+    do {
+      *--head = '0' + len % 10;
+      len /= 10;
+    } while (len > 0);
+    *--head = '$';
   }
+
+  SendRaw(std::string_view{head, size_t(tail - head)});
 }
 
+// Sends the values as scattered iovec segments that reference the response objects directly,
+// so that large values go to the socket without being copied into a flat buffer first.
+// Same as SendStringArrInternal, the vector is flushed in batches to stay below the OS limit
+// on iovec length.
 void RedisReplyBuilder::SendMGetResponse(absl::Span<const OptResp> arr) {
-  string res = absl::StrCat("*", arr.size(), kCRLF);
+  size_t vec_len = std::min<size_t>(256u, arr.size());
+
+  // Each value takes 3 segments: length header, body and CRLF. Nulls take one.
+  absl::FixedArray<iovec, 16> vec(vec_len * 3 + 1);
+  absl::FixedArray<char, 64> meta((vec_len + 1) * 16);  // 16 bytes per length header.
+  char* next = meta.data();
+
+  // The protocol-dependent null marker is resolved once, outside of the loop.
+  const string_view null_str = NullString();
+
+  *next++ = '*';
+  next = absl::numbers_internal::FastIntToBuffer(arr.size(), next);
+  *next++ = '\r';
+  *next++ = '\n';
+  vec[0] = IoVec(string_view{meta.data(), size_t(next - meta.data())});
+  char* start = next;
+
+  unsigned vec_indx = 1;
   for (size_t i = 0; i < arr.size(); ++i) {
     if (arr[i]) {
-      StrAppend(&res, "$", arr[i]->value.size(), kCRLF);
-      res.append(arr[i]->value).append(kCRLF);
+      *next++ = '$';
+      next = absl::numbers_internal::FastIntToBuffer(arr[i]->value.size(), next);
+      *next++ = '\r';
+      *next++ = '\n';
+      vec[vec_indx++] = IoVec(string_view{start, size_t(next - start)});
+      start = next;
+
+      vec[vec_indx++] = IoVec(arr[i]->value);
+      vec[vec_indx++] = IoVec(kCRLF);
     } else {
-      res.append(NullString());
+      vec[vec_indx++] = IoVec(null_str);
+    }
+
+    if (vec_indx + 3 > vec.size()) {
+      Send(vec.data(), vec_indx);
+      if (ec_)
+        return;
+
+      vec_indx = 0;
+      next = meta.data();
+      start = next;
     }
   }
 
-  SendRaw(res);
+  if (vec_indx > 0)
+    Send(vec.data(), vec_indx);
 }
 
 void RedisReplyBuilder::SendSimpleStrArr(StrSpan arr) {
@@ -390,7 +571,10 @@ void RedisReplyBuilder::SendStringArr(StrSpan arr, CollectionType type) {
     return;
   }
 
-  SendStringArrInternal(warr, type);
+  if (is_resp3_)
+    SendStringArrInternal<true>(warr, type);
+  else
+    SendStringArrInternal<false>(warr, type);
 }
 
 void RedisReplyBuilder::StartArray(unsigned len) {
@@ -422,12 +606,13 @@ void RedisReplyBuilder::StartCollection(unsigned len, CollectionType type) {
 // to low numbers (around 1024). Therefore, to make it robust we send the array in batches.
 // We limit the vector length to 256 and when it fills up we flush it to the socket and continue
 // iterating.
+template <bool IsResp3>
 void RedisReplyBuilder::SendStringArrInternal(WrappedStrSpan arr, CollectionType type) {
   size_t size = arr.Size();
 
   size_t header_len = size;
   string_view type_char = "*";
-  if (is_resp3_) {
+  if constexpr (IsResp3) {
     type_char = START_SYMBOLS[type];
     if (type == MAP)
       header_len /= 2;  // Each key value pair counts as one.
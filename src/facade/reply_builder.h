@@ -78,9 +78,19 @@ class SinkReplyBuilder {
     return io_write_bytes_;
   }
 
+  size_t batch_buf_hit_cnt() const {
+    return batch_buf_hit_cnt_;
+  }
+
+  size_t batch_buf_miss_cnt() const {
+    return batch_buf_miss_cnt_;
+  }
+
   void reset_io_stats() {
     io_write_cnt_ = 0;
     io_write_bytes_ = 0;
+    batch_buf_hit_cnt_ = 0;
+    batch_buf_miss_cnt_ = 0;
     err_count_.clear();
   }
 
@@ -88,6 +98,12 @@ class SinkReplyBuilder {
     return err_count_;
   }
 
+  // Byte size of the send buffers currently parked in the pool of the calling thread.
+  static size_t BatchPoolCapacity();
+
+  // Releases the send buffers pooled by the calling thread (on server shutdown).
+  static void ShutdownThreadLocal();
+
   struct ReplyAggregator {
     explicit ReplyAggregator(SinkReplyBuilder* builder) : builder_(builder) {
       // If the builder is already aggregating then don't aggregate again as
@@ -122,12 +138,19 @@ class SinkReplyBuilder {
 
   void StopAggregate();
 
+  // Swaps batch_ with a buffer leased from the thread-local pool / returns its storage back.
+  // Connections hold send buffer memory only between the two calls, so idle ones hold none.
+  void AcquireBatchBuf();
+  void ReleaseBatchBuf();
+
   std::string batch_;
   ::io::Sink* sink_;
   std::error_code ec_;
 
   size_t io_write_cnt_ = 0;
   size_t io_write_bytes_ = 0;
+  size_t batch_buf_hit_cnt_ = 0;
+  size_t batch_buf_miss_cnt_ = 0;
   absl::flat_hash_map<std::string, uint64_t> err_count_;
 
   bool should_batch_ : 1;
@@ -173,6 +196,10 @@ class RedisReplyBuilder : public SinkReplyBuilder {
 
   void SetResp3(bool is_resp3);
 
+  bool IsResp3() const {
+    return is_resp3_;
+  }
+
   void SendError(std::string_view str, std::string_view type = {}) override;
   void SendMGetResponse(absl::Span<const OptResp>) override;
 
@@ -195,6 +222,16 @@ class RedisReplyBuilder : public SinkReplyBuilder {
   virtual void SendScoredArray(const std::vector<std::pair<std::string, double>>& arr,
                                bool with_scores);
 
+  // Sends a blob that already encodes a complete RESP reply, usually produced by
+  // SerializeScoredArray on a shard thread.
+  virtual void SendSerialized(std::string_view raw);
+
+  // Serializes arr into the exact bytes SendScoredArray would send. Has no builder state,
+  // so shard callbacks can run the formatting pass over huge results in place and hand the
+  // connection fiber a ready chunk instead of the raw array.
+  static std::string SerializeScoredArray(const std::vector<std::pair<std::string, double>>& arr,
+                                          bool with_scores, bool is_resp3);
+
   void StartArray(unsigned len);  // StartCollection(len, ARRAY)
 
   virtual void StartCollection(unsigned len, CollectionType type);
@@ -212,7 +249,9 @@ class RedisReplyBuilder : public SinkReplyBuilder {
   };
 
  private:
-  void SendStringArrInternal(WrappedStrSpan arr, CollectionType type);
+  // The protocol version is a template parameter so that type-marker emission is resolved
+  // at compile time and the resp2 hot path does not pay for resp3 branches.
+  template <bool IsResp3> void SendStringArrInternal(WrappedStrSpan arr, CollectionType type);
 
   const char* NullString();
 
@@ -656,6 +656,33 @@ TEST_F(RedisReplyBuilderTest, TestBatchMode) {
                           absl::StrCat(kBulkStringStart, "0"), std::string_view{}));
 }
 
+TEST_F(RedisReplyBuilderTest, BatchBufPool) {
+  SinkReplyBuilder::ShutdownThreadLocal();  // reset the thread-local pool.
+  ASSERT_EQ(SinkReplyBuilder::BatchPoolCapacity(), 0u);
+
+  builder_->SetBatchMode(true);
+  builder_->SendOk();
+  // The first coalesced reply allocates a buffer since the pool is empty, and holds on
+  // to it while batching.
+  EXPECT_EQ(builder_->batch_buf_miss_cnt(), 1u);
+  EXPECT_EQ(SinkReplyBuilder::BatchPoolCapacity(), 0u);
+
+  // Flushing returns the buffer to the pool.
+  builder_->SetBatchMode(false);
+  builder_->SendOk();
+  EXPECT_GE(SinkReplyBuilder::BatchPoolCapacity(), 1024u);
+
+  // The next coalesced reply reuses the parked buffer.
+  builder_->SetBatchMode(true);
+  builder_->SendOk();
+  EXPECT_EQ(builder_->batch_buf_hit_cnt(), 1u);
+  EXPECT_EQ(SinkReplyBuilder::BatchPoolCapacity(), 0u);
+
+  builder_->SetBatchMode(false);
+  builder_->SendOk();
+  EXPECT_GE(SinkReplyBuilder::BatchPoolCapacity(), 1024u);
+}
+
 TEST_F(RedisReplyBuilderTest, TestResp3Double) {
   builder_->SetResp3(true);
   builder_->SendDouble(5.5);
@@ -733,6 +760,26 @@ TEST_F(RedisReplyBuilderTest, TestSendScoredArray) {
       << "Resp3 WITHSCORES failed.";
 }
 
+TEST_F(RedisReplyBuilderTest, TestSerializeScoredArray) {
+  const std::vector<std::pair<std::string, double>> scored_array{
+      {"e1", 1.1}, {"e2", 2.2}, {"e3", 3.3}};
+
+  // The pre-serialized blobs must match SendScoredArray byte for byte.
+  builder_->SetResp3(false);
+  builder_->SendSerialized(RedisReplyBuilder::SerializeScoredArray(scored_array, false, false));
+  ASSERT_TRUE(builder_->err_count().empty());
+  ASSERT_EQ(TakePayload(), "*3\r\n$2\r\ne1\r\n$2\r\ne2\r\n$2\r\ne3\r\n");
+
+  builder_->SendSerialized(RedisReplyBuilder::SerializeScoredArray(scored_array, true, false));
+  ASSERT_EQ(TakePayload(),
+            "*6\r\n$2\r\ne1\r\n$3\r\n1.1\r\n$2\r\ne2\r\n$3\r\n2.2\r\n$2\r\ne3\r\n$3\r\n3.3\r\n");
+
+  builder_->SetResp3(true);
+  builder_->SendSerialized(RedisReplyBuilder::SerializeScoredArray(scored_array, true, true));
+  ASSERT_EQ(TakePayload(),
+            "*3\r\n*2\r\n$2\r\ne1\r\n,1.1\r\n*2\r\n$2\r\ne2\r\n,2.2\r\n*2\r\n$2\r\ne3\r\n,3.3\r\n");
+}
+
 TEST_F(RedisReplyBuilderTest, TestSendMGetResponse) {
   std::vector<SinkReplyBuilder::OptResp> mget_res(3);
   auto& v = mget_res[0].emplace();
@@ -96,6 +96,11 @@ void CapturingReplyBuilder::SendScoredArray(const std::vector<std::pair<std::str
   Capture(ScoredArray{arr, with_scores});
 }
 
+void CapturingReplyBuilder::SendSerialized(std::string_view raw) {
+  SKIP_LESS(ReplyMode::FULL);
+  Capture(SerializedBlob{string{raw}});
+}
+
 void CapturingReplyBuilder::StartCollection(unsigned len, CollectionType type) {
   SKIP_LESS(ReplyMode::FULL);
   stack_.emplace(make_unique<CollectionPayload>(len, type), type == MAP ? len * 2 : len);
@@ -209,6 +214,10 @@ struct CaptureVisitor {
     rb->SendScoredArray(sarr.arr, sarr.with_scores);
   }
 
+  void operator()(const CapturingReplyBuilder::SerializedBlob& blob) {
+    rb->SendSerialized(blob);
+  }
+
   RedisReplyBuilder* rb;
 };
 
@@ -227,6 +236,30 @@ void CapturingReplyBuilder::SetReplyMode(ReplyMode mode) {
   current_ = monostate{};
 }
 
+CapturingReplyBuilder::Payload CapturingReplyBuilder::Clone(const Payload& pl) {
+  if (const auto* col = get_if<unique_ptr<CollectionPayload>>(&pl)) {
+    if (*col == nullptr)
+      return unique_ptr<CollectionPayload>{};
+
+    auto res = make_unique<CollectionPayload>((*col)->len, (*col)->type);
+    res->arr.reserve((*col)->arr.size());
+    for (const auto& item : (*col)->arr)
+      res->arr.push_back(Clone(item));
+    return res;
+  }
+
+  return visit(
+      [](const auto& val) -> Payload {
+        using T = std::decay_t<decltype(val)>;
+        if constexpr (std::is_same_v<T, unique_ptr<CollectionPayload>>) {
+          return monostate{};  // handled above
+        } else {
+          return val;
+        }
+      },
+      pl);
+}
+
 optional<CapturingReplyBuilder::ErrorRef> CapturingReplyBuilder::GetError(const Payload& pl) {
   if (auto* err = get_if<Error>(&pl); err != nullptr) {
     return ErrorRef{err->first, err->second};
@@ -43,6 +43,7 @@ class CapturingReplyBuilder : public RedisReplyBuilder {
   void SendBulkString(std::string_view str) override;
   void SendScoredArray(const std::vector<std::pair<std::string, double>>& arr,
                        bool with_scores) override;
+  void SendSerialized(std::string_view raw) override;
 
   void StartCollection(unsigned len, CollectionType type) override;
 
@@ -51,6 +52,7 @@ class CapturingReplyBuilder : public RedisReplyBuilder {
   using Null = std::nullptr_t;                        // SendNull or SendNullArray
   struct SimpleString : public std::string {};        // SendSimpleString
   struct BulkString : public std::string {};          // SendBulkString
+  struct SerializedBlob : public std::string {};      // SendSerialized
 
   struct StrArrPayload {
     bool simple;
@@ -72,7 +74,7 @@ class CapturingReplyBuilder : public RedisReplyBuilder {
 
   using Payload = std::variant<std::monostate, Null, Error, OpStatus, long, double, SimpleString,
                                BulkString, StrArrPayload, std::unique_ptr<CollectionPayload>,
-                               std::vector<OptResp>, ScoredArray>;
+                               std::vector<OptResp>, ScoredArray, SerializedBlob>;
 
   // Non owned Error based on SendError arguments (msg, type)
   using ErrorRef = std::pair<std::string_view, std::string_view>;
@@ -85,6 +87,10 @@ class CapturingReplyBuilder : public RedisReplyBuilder {
   // Send payload to builder.
   static void Apply(Payload&& pl, RedisReplyBuilder* builder);
 
+  // Deep copy of a captured payload. Used to fan a single captured reply into
+  // multiple reply slots (see read coalescing in MultiCommandSquasher).
+  static Payload Clone(const Payload& pl);
+
   // If an error is stored inside payload, get a reference to it.
   static std::optional<ErrorRef> GetError(const Payload& pl);
 
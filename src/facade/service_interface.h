@@ -26,6 +26,15 @@ class ServiceInterface {
   }
 
   virtual void DispatchCommand(CmdArgList args, ConnectionContext* cntx) = 0;
+
+  // Dispatch a batch of pipelined commands. Returns when all of them were executed.
+  // The default implementation dispatches them one by one, services can override it to
+  // execute the batch more efficiently.
+  virtual void DispatchManyCommands(absl::Span<CmdArgList> args_list, ConnectionContext* cntx) {
+    for (CmdArgList args : args_list)
+      DispatchCommand(args, cntx);
+  }
+
   virtual void DispatchMC(const MemcacheParser::Command& cmd, std::string_view value,
                           ConnectionContext* cntx) = 0;
 
@@ -112,13 +112,22 @@ uint64_t _crc64(uint_fast64_t crc, const void *in_data, const uint64_t len) {
 
 /******************** END GENERATED PYCRC FUNCTIONS ********************/
 
+static int crc64_use_pclmul = 0;
+
 /* Initializes the 16KB lookup tables. */
 void crc64_init(void) {
     crcspeed64native_init(_crc64, crc64_table);
+    crc64_use_pclmul = crc64_pclmul_supported();
 }
 
 /* Compute crc64 */
 uint64_t crc64(uint64_t crc, const unsigned char *s, uint64_t l) {
+    if (crc64_use_pclmul && l >= 64) {
+        uint64_t chunk = l & ~(uint64_t)15;
+        crc = crc64_pclmul(crc, s, chunk);
+        s += chunk;
+        l -= chunk;
+    }
     return crcspeed64native(crc64_table, crc, (void *) s, l);
 }
 
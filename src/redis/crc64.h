@@ -6,6 +6,11 @@
 void crc64_init(void);
 uint64_t crc64(uint64_t crc, const unsigned char *s, uint64_t l);
 
+/* crc64_pclmul.c: carry-less multiplication kernel, used by crc64() for bulk input
+ * when the CPU supports it. l must be a non-zero multiple of 16. */
+int crc64_pclmul_supported(void);
+uint64_t crc64_pclmul(uint64_t crc, const unsigned char *s, uint64_t l);
+
 #ifdef REDIS_TEST
 int crc64Test(int argc, char *argv[], int flags);
 #endif
@@ -0,0 +1,115 @@
+/* PCLMULQDQ-accelerated implementation of the rdb crc64 (the "Jones" polynomial
+ * 0xad93d23594c935a9, reflected, init 0), following the folding method of the Intel
+ * whitepaper "Fast CRC Computation for Generic Polynomials Using PCLMULQDQ Instruction".
+ *
+ * The message is folded 64 bytes at a time across four 128-bit accumulators, the
+ * accumulators are folded into one, and the final 128-bit remainder is reduced with a
+ * reflected Barrett reduction. All constants below are bit-reflections of x^N mod P(x)
+ * (or of the Barrett quotient x^128 / P(x)) and were verified against the table
+ * implementation in crc64.c:
+ *
+ *   k1  = bitrev64(x^191 mod P)  fold by 128 bits, high half (x^192)
+ *   k2  = bitrev64(x^127 mod P)  fold by 128 bits, low half  (x^128)
+ *   k3  = bitrev64(x^575 mod P)  fold by 512 bits, high half (x^576)
+ *   k4  = bitrev64(x^511 mod P)  fold by 512 bits, low half  (x^512)
+ *   mu  = bitrev64(x^128 / P)    Barrett quotient (without the implicit x^64 term)
+ *   p   = bitrev64(P)            polynomial      (without the implicit x^64 term)
+ *
+ * The exponents are one less than the fold distances because multiplying two reflected
+ * operands with PCLMULQDQ yields the reflected product shifted by one bit. */
+
+#include "crc64.h"
+
+#if defined(__x86_64__) || defined(_M_X64)
+
+#include <immintrin.h>
+
+int crc64_pclmul_supported(void) {
+    return __builtin_cpu_supports("pclmul");
+}
+
+#define K1 0xd9d7be7d505da32cULL
+#define K2 0x381d0015c96f4444ULL
+#define K3 0xaf86efb16d9ab4fbULL
+#define K4 0xf49784a634f014e4ULL
+#define MU 0x1f367d194d77cfbbULL
+#define P 0x95ac9329ac4bc9b5ULL
+
+/* Fold the 128-bit accumulator `a` over the next 128-bit chunk `d`. `k` holds the pair
+ * of fold constants for the distance between them (low qword multiplies the high part
+ * of the represented polynomial, i.e. the low register qword). */
+__attribute__((target("pclmul,sse4.1"))) static inline __m128i fold16(__m128i a, __m128i d,
+                                                                      __m128i k) {
+    return _mm_xor_si128(
+        _mm_xor_si128(_mm_clmulepi64_si128(a, k, 0x00), _mm_clmulepi64_si128(a, k, 0x11)), d);
+}
+
+/* `l` must be a non-zero multiple of 16. */
+__attribute__((target("pclmul,sse4.1"))) uint64_t crc64_pclmul(uint64_t crc,
+                                                               const unsigned char *s,
+                                                               uint64_t l) {
+    const unsigned char *end = s + l;
+    const __m128i k128 = _mm_set_epi64x(K2, K1);
+    __m128i a;
+
+    if (l >= 128) {
+        const __m128i k512 = _mm_set_epi64x(K4, K3);
+        __m128i x0, x1, x2, x3;
+
+        x0 = _mm_xor_si128(_mm_loadu_si128((const __m128i *)s), _mm_cvtsi64_si128(crc));
+        x1 = _mm_loadu_si128((const __m128i *)(s + 16));
+        x2 = _mm_loadu_si128((const __m128i *)(s + 32));
+        x3 = _mm_loadu_si128((const __m128i *)(s + 48));
+        s += 64;
+
+        while (end - s >= 64) {
+            x0 = fold16(x0, _mm_loadu_si128((const __m128i *)s), k512);
+            x1 = fold16(x1, _mm_loadu_si128((const __m128i *)(s + 16)), k512);
+            x2 = fold16(x2, _mm_loadu_si128((const __m128i *)(s + 32)), k512);
+            x3 = fold16(x3, _mm_loadu_si128((const __m128i *)(s + 48)), k512);
+            s += 64;
+        }
+
+        a = fold16(x0, x1, k128);
+        a = fold16(a, x2, k128);
+        a = fold16(a, x3, k128);
+    } else {
+        a = _mm_xor_si128(_mm_loadu_si128((const __m128i *)s), _mm_cvtsi64_si128(crc));
+        s += 16;
+    }
+
+    while (end - s >= 16) {
+        a = fold16(a, _mm_loadu_si128((const __m128i *)s), k128);
+        s += 16;
+    }
+
+    /* Fold the high 64 bits over the low ones: b represents A_hi*x^128 + A_lo*x^64. */
+    __m128i b = _mm_xor_si128(_mm_clmulepi64_si128(a, k128, 0x10), _mm_srli_si128(a, 8));
+    uint64_t blo = _mm_cvtsi128_si64(b);
+    uint64_t bhi = _mm_extract_epi64(b, 1);
+
+    /* Reflected Barrett reduction of the 128-bit remainder to 64 bits. */
+    const __m128i kbar = _mm_set_epi64x(P, MU);
+    uint64_t q = blo ^ ((uint64_t)_mm_cvtsi128_si64(
+                            _mm_clmulepi64_si128(_mm_cvtsi64_si128(blo), kbar, 0x00))
+                        << 1);
+    __m128i w = _mm_clmulepi64_si128(_mm_cvtsi64_si128(q), kbar, 0x10);
+    uint64_t wlo = _mm_cvtsi128_si64(w);
+    uint64_t whi = _mm_extract_epi64(w, 1);
+
+    return bhi ^ ((wlo >> 63) | (whi << 1));
+}
+
+#else
+
+int crc64_pclmul_supported(void) {
+    return 0;
+}
+
+uint64_t crc64_pclmul(uint64_t crc, const unsigned char *s, uint64_t l) {
+    (void)s;
+    (void)l;
+    return crc;
+}
+
+#endif
@@ -3,6 +3,8 @@
 
 #include <stddef.h> /* for size_t */
 
+#include "geohash.h"
+
 /* Structures used inside geo.c in order to represent points and array of
  * points on the earth. */
 typedef struct geoPoint {
@@ -19,4 +21,7 @@ typedef struct geoArray {
     size_t used;
 } geoArray;
 
+int decodeGeohash(double bits, double *xy);
+int geoWithinShape(GeoShape *shape, double score, double *xy, double *distance);
+
 #endif
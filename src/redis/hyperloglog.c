@@ -34,6 +34,10 @@
 #include <math.h>
 #include <string.h>
 
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+
 #include "redis/object.h"
 #include "redis/redis_aux.h"
 #include "redis/util.h"
@@ -1039,18 +1043,52 @@ int64_t pfcountSingle(struct HllBufferPtr hll_ptr) {
   return card;
 }
 
-/* Merge dense-encoded HLL */
+/* Unpack the 6-bit dense registers into one byte per register. Uses the same
+ * 4-registers-per-3-bytes stepping as hllDenseRegHisto() instead of the generic
+ * get-register macro that recomputes bit offsets for every register. */
+static void hllDenseUnpack(const uint8_t* registers, uint8_t* out) {
+  if (HLL_REGISTERS == 16384 && HLL_BITS == 6) {
+    const uint8_t* r = registers;
+    for (int j = 0; j < HLL_REGISTERS / 4; j++) {
+      out[0] = r[0] & 63;
+      out[1] = (r[0] >> 6 | r[1] << 2) & 63;
+      out[2] = (r[1] >> 4 | r[2] << 4) & 63;
+      out[3] = (r[2] >> 2) & 63;
+      r += 3;
+      out += 4;
+    }
+  } else {
+    uint8_t val;
+    for (int i = 0; i < HLL_REGISTERS; i++) {
+      HLL_DENSE_GET_REGISTER(val, registers, i);
+      out[i] = val;
+    }
+  }
+}
+
+/* max[i] = MAX(max[i], vals[i]) over HLL_REGISTERS byte-sized registers. */
+static void hllMaxRegisters(uint8_t* max, const uint8_t* vals) {
+  int i = 0;
+#ifdef __AVX2__
+  for (; i + 32 <= HLL_REGISTERS; i += 32) {
+    __m256i a = _mm256_loadu_si256((const __m256i*)(max + i));
+    __m256i b = _mm256_loadu_si256((const __m256i*)(vals + i));
+    _mm256_storeu_si256((__m256i*)(max + i), _mm256_max_epu8(a, b));
+  }
+#endif
+  for (; i < HLL_REGISTERS; i++) {
+    if (vals[i] > max[i])
+      max[i] = vals[i];
+  }
+}
+
+/* Merge dense-encoded HLL into 'max', an array of HLL_REGISTERS bytes. */
 static void hllMergeDense(uint8_t* max, struct HllBufferPtr to) {
-  uint8_t* registers = max + HLL_HDR_SIZE;
-  uint8_t val;
   struct hllhdr* hll_hdr = (struct hllhdr*)to.hll;
+  uint8_t vals[HLL_REGISTERS];
 
-  for (int i = 0; i < HLL_REGISTERS; i++) {
-    HLL_DENSE_GET_REGISTER(val, hll_hdr->registers, i);
-    if (val > registers[i]) {
-      registers[i] = val;
-    }
-  }
+  hllDenseUnpack(hll_hdr->registers, vals);
+  hllMaxRegisters(max, vals);
 }
 
 int64_t pfcountMulti(struct HllBufferPtr* hlls, size_t hlls_count) {
@@ -1068,7 +1106,7 @@ int64_t pfcountMulti(struct HllBufferPtr* hlls, size_t hlls_count) {
       return C_ERR;
     }
 
-    hllMergeDense(max, hll);
+    hllMergeDense(max + HLL_HDR_SIZE, hll);
   }
 
   /* Compute cardinality of the resulting set. */
@@ -36,6 +36,10 @@
 #include "zmalloc.h"
 #include "endianconv.h"
 
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+
 /* Note that these encodings are ordered, so:
  * INTSET_ENC_INT16 < INTSET_ENC_INT32 < INTSET_ENC_INT64. */
 #define INTSET_ENC_INT16 (sizeof(int16_t))
@@ -114,19 +118,69 @@ static intset *intsetResize(intset *is, uint32_t len) {
  * sets "pos" to the position of the value within the intset. Return 0 when
  * the value is not present in the intset and sets "pos" to the position
  * where "value" can be inserted. */
+/* Lower bound (first index whose element is >= value) over [lo, lo+n).
+ * The halving loop is branchless: the comparison result feeds a conditional
+ * move instead of an unpredictable branch, which is what dominates binary
+ * search time on large sets. The caller guarantees the bound lies in range.
+ * On AVX2/little-endian builds the final block of the search is resolved with
+ * one lane compare (4x int64 or 8x int32) instead of the last scalar steps. */
+static uint32_t intsetLowerBound(intset *is, int64_t value, uint32_t n) {
+    uint8_t enc = intrev32ifbe(is->encoding);
+    uint32_t lo = 0;
+
+#if defined(__AVX2__) && (BYTE_ORDER == LITTLE_ENDIAN)
+    if (enc == INTSET_ENC_INT64) {
+        const int64_t *arr = (const int64_t*)is->contents;
+        while (n > 4) {
+            uint32_t half = n >> 1;
+            lo += (arr[lo+half-1] < value) ? half : 0;
+            n -= half;
+        }
+        /* Load the up to 4 remaining elements, padding out-of-range lanes with
+         * INT64_MAX, and advance by the number of lanes that are < value. */
+        __m256i mask = _mm256_cmpgt_epi64(_mm256_set1_epi64x(n), _mm256_setr_epi64x(0,1,2,3));
+        __m256i vec = _mm256_maskload_epi64((const long long*)(arr+lo), mask);
+        vec = _mm256_blendv_epi8(_mm256_set1_epi64x(INT64_MAX), vec, mask);
+        __m256i lt = _mm256_cmpgt_epi64(_mm256_set1_epi64x(value), vec);
+        return lo + __builtin_popcount(_mm256_movemask_pd(_mm256_castsi256_pd(lt)));
+    }
+    if (enc == INTSET_ENC_INT32) {
+        /* The callers pre-check against the first/last element, so value fits int32. */
+        const int32_t *arr = (const int32_t*)is->contents;
+        int32_t v32 = (int32_t)value;
+        while (n > 8) {
+            uint32_t half = n >> 1;
+            lo += (arr[lo+half-1] < v32) ? half : 0;
+            n -= half;
+        }
+        __m256i mask = _mm256_cmpgt_epi32(_mm256_set1_epi32(n), _mm256_setr_epi32(0,1,2,3,4,5,6,7));
+        __m256i vec = _mm256_maskload_epi32((const int*)(arr+lo), mask);
+        vec = _mm256_blendv_epi8(_mm256_set1_epi32(INT32_MAX), vec, mask);
+        __m256i lt = _mm256_cmpgt_epi32(_mm256_set1_epi32(v32), vec);
+        return lo + __builtin_popcount(_mm256_movemask_ps(_mm256_castsi256_ps(lt)));
+    }
+#endif
+
+    while (n > 1) {
+        uint32_t half = n >> 1;
+        lo += (_intsetGetEncoded(is,lo+half-1,enc) < value) ? half : 0;
+        n -= half;
+    }
+    return lo;
+}
+
 static uint8_t intsetSearch(intset *is, int64_t value, uint32_t *pos) {
-    int min = 0, max = intrev32ifbe(is->length)-1, mid = -1;
-    int64_t cur = -1;
+    uint32_t len = intrev32ifbe(is->length);
 
     /* The value can never be found when the set is empty */
-    if (intrev32ifbe(is->length) == 0) {
+    if (len == 0) {
         if (pos) *pos = 0;
         return 0;
     } else {
         /* Check for the case where we know we cannot find the value,
          * but do know the insert position. */
-        if (value > _intsetGet(is,max)) {
-            if (pos) *pos = intrev32ifbe(is->length);
+        if (value > _intsetGet(is,len-1)) {
+            if (pos) *pos = len;
             return 0;
         } else if (value < _intsetGet(is,0)) {
             if (pos) *pos = 0;
@@ -134,23 +188,13 @@ static uint8_t intsetSearch(intset *is, int64_t value, uint32_t *pos) {
         }
     }
 
-    while(max >= min) {
-        mid = ((unsigned int)min + (unsigned int)max) >> 1;
-        cur = _intsetGet(is,mid);
-        if (value > cur) {
-            min = mid+1;
-        } else if (value < cur) {
-            max = mid-1;
-        } else {
-            break;
-        }
-    }
-
-    if (value == cur) {
-        if (pos) *pos = mid;
+    /* The checks above guarantee the lower bound lies within [0, len). */
+    uint32_t lb = intsetLowerBound(is,value,len);
+    if (_intsetGet(is,lb) == value) {
+        if (pos) *pos = lb;
         return 1;
     } else {
-        if (pos) *pos = min;
+        if (pos) *pos = lb;
         return 0;
     }
 }
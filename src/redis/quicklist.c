@@ -129,6 +129,47 @@ static void quicklistBookmarksClear(quicklist *ql) {
         (iter)->zi = NULL;                                                     \
     } while (0)
 
+/* Node count threshold above which quicklistGetIteratorAtIdx() builds the
+ * sparse positional index instead of walking the chain node by node, and the
+ * number of nodes covered by each index entry. */
+#define SEEK_INDEX_MIN_NODES 64
+#define SEEK_INDEX_STRIDE 16
+
+/* Drop the positional seek index. Must be called by every operation that
+ * adds, removes or moves elements: the index caches node pointers and prefix
+ * element counts that any such mutation may invalidate. */
+static void quicklistSeekIndexInvalidate(quicklist *quicklist) {
+    if (quicklist->seek_idx) {
+        zfree(quicklist->seek_idx->nodes);
+        zfree(quicklist->seek_idx->before);
+        zfree(quicklist->seek_idx);
+        quicklist->seek_idx = NULL;
+    }
+}
+
+/* Build the seek index with one entry per SEEK_INDEX_STRIDE nodes. */
+static void quicklistSeekIndexBuild(quicklist *quicklist) {
+    unsigned long entries =
+        (quicklist->len + SEEK_INDEX_STRIDE - 1) / SEEK_INDEX_STRIDE;
+    quicklistSeekIndex *si = zmalloc(sizeof(*si));
+    si->nodes = zmalloc(entries * sizeof(quicklistNode *));
+    si->before = zmalloc(entries * sizeof(unsigned long long));
+    si->len = 0;
+
+    unsigned long long before = 0;
+    unsigned long i = 0;
+    for (quicklistNode *n = quicklist->head; n; n = n->next, i++) {
+        if (i % SEEK_INDEX_STRIDE == 0) {
+            assert(si->len < entries);
+            si->nodes[si->len] = n;
+            si->before[si->len] = before;
+            si->len++;
+        }
+        before += n->count;
+    }
+    quicklist->seek_idx = si;
+}
+
 /* Create a new quicklist.
  * Free with quicklistRelease(). */
 quicklist *quicklistCreate(void) {
@@ -141,6 +182,7 @@ quicklist *quicklistCreate(void) {
     quicklist->compress = 0;
     quicklist->fill = -2;
     quicklist->bookmark_count = 0;
+    quicklist->seek_idx = NULL;
     return quicklist;
 }
 
@@ -210,6 +252,7 @@ void quicklistRelease(quicklist *quicklist) {
         quicklist->len--;
         current = next;
     }
+    quicklistSeekIndexInvalidate(quicklist);
     quicklistBookmarksClear(quicklist);
     zfree(quicklist);
 }
@@ -393,6 +436,37 @@ REDIS_STATIC void __quicklistCompress(const quicklist *quicklist,
             __quicklistCompress((_ql), (_node));                               \
     } while (0)
 
+/* Eagerly compress every node outside the compress depth of both ends.
+ * Normally nodes are compressed lazily as they are pushed past the depth;
+ * this variant brings an already-populated list in line with a depth that
+ * was raised after the fact (see quicklistSetCompressDepth). */
+void quicklistCompressInterior(quicklist *quicklist) {
+    if (!quicklistAllowsCompression(quicklist) ||
+        quicklist->len < (unsigned int)(quicklist->compress * 2) + 1)
+        return;
+
+    unsigned int idx = 0;
+    for (quicklistNode *node = quicklist->head; node; node = node->next, idx++) {
+        if (idx >= (unsigned int)quicklist->compress &&
+            idx + (unsigned int)quicklist->compress < quicklist->len)
+            quicklistCompressNode(node);
+    }
+}
+
+/* Return the number of bytes occupied by node payloads, accounting for
+ * LZF-compressed nodes by their compressed size. Node headers and the
+ * quicklist struct itself are not included. */
+size_t quicklistPayloadBytes(const quicklist *quicklist) {
+    size_t bytes = 0;
+    for (const quicklistNode *node = quicklist->head; node; node = node->next) {
+        if (quicklistNodeIsCompressed(node))
+            bytes += sizeof(quicklistLZF) + ((const quicklistLZF *)node->entry)->sz;
+        else
+            bytes += node->sz;
+    }
+    return bytes;
+}
+
 /* If we previously used quicklistDecompressNodeForUse(), just recompress. */
 #define quicklistRecompressOnly(_node)                                         \
     do {                                                                       \
@@ -552,6 +626,7 @@ static void __quicklistInsertPlainNode(quicklist *quicklist, quicklistNode *old_
  * Returns 1 if new head created. */
 int quicklistPushHead(quicklist *quicklist, void *value, size_t sz) {
     quicklistNode *orig_head = quicklist->head;
+    quicklistSeekIndexInvalidate(quicklist);
 
     if (unlikely(isLargeElement(sz))) {
         __quicklistInsertPlainNode(quicklist, quicklist->head, value, sz, 0);
@@ -580,6 +655,7 @@ int quicklistPushHead(quicklist *quicklist, void *value, size_t sz) {
  * Returns 1 if new tail created. */
 int quicklistPushTail(quicklist *quicklist, void *value, size_t sz) {
     quicklistNode *orig_tail = quicklist->tail;
+    quicklistSeekIndexInvalidate(quicklist);
     if (unlikely(isLargeElement(sz))) {
         __quicklistInsertPlainNode(quicklist, quicklist->tail, value, sz, 1);
         return 1;
@@ -606,6 +682,7 @@ int quicklistPushTail(quicklist *quicklist, void *value, size_t sz) {
  * to be retrieved later. */
 void quicklistAppendListpack(quicklist *quicklist, unsigned char *zl) {
     quicklistNode *node = quicklistCreateNode();
+    quicklistSeekIndexInvalidate(quicklist);
 
     node->entry = zl;
     node->count = lpLength(node->entry);
@@ -621,6 +698,7 @@ void quicklistAppendListpack(quicklist *quicklist, unsigned char *zl) {
  * data - the data to add (pointer becomes the responsibility of quicklist) */
 void quicklistAppendPlainNode(quicklist *quicklist, unsigned char *data, size_t sz) {
     quicklistNode *node = quicklistCreateNode();
+    quicklistSeekIndexInvalidate(quicklist);
 
     node->entry = data;
     node->count = 1;
@@ -711,6 +789,7 @@ REDIS_STATIC int quicklistDelIndex(quicklist *quicklist, quicklistNode *node,
 void quicklistDelEntry(quicklistIter *iter, quicklistEntry *entry) {
     quicklistNode *prev = entry->node->prev;
     quicklistNode *next = entry->node->next;
+    quicklistSeekIndexInvalidate(iter->quicklist);
     int deleted_node = quicklistDelIndex((quicklist *)entry->quicklist,
                                          entry->node, &entry->zi);
 
@@ -742,6 +821,7 @@ void quicklistReplaceEntry(quicklistIter *iter, quicklistEntry *entry,
                            const void *data, size_t sz)
 {
     quicklist* quicklist = iter->quicklist;
+    quicklistSeekIndexInvalidate(quicklist);
 
     if (likely(!QL_NODE_IS_PLAIN(entry->node) && !isLargeElement(sz))) {
         entry->node->entry = lpReplace(entry->node->entry, &entry->zi, data, sz);
@@ -1076,12 +1156,14 @@ REDIS_STATIC void _quicklistInsert(quicklistIter *iter, quicklistEntry *entry,
 void quicklistInsertBefore(quicklistIter *iter, quicklistEntry *entry,
                            const void *value, const size_t sz)
 {
+    quicklistSeekIndexInvalidate(iter->quicklist);
     _quicklistInsert(iter, entry, value, sz, 0);
 }
 
 void quicklistInsertAfter(quicklistIter *iter, quicklistEntry *entry,
                           const void *value, const size_t sz)
 {
+    quicklistSeekIndexInvalidate(iter->quicklist);
     _quicklistInsert(iter, entry, value, sz, 1);
 }
 
@@ -1115,6 +1197,8 @@ int quicklistDelRange(quicklist *quicklist, const long start,
     quicklistNode *node = iter->current;
     long offset = iter->offset;
     quicklistReleaseIterator(iter);
+    /* The seek above may still use the index; everything below mutates. */
+    quicklistSeekIndexInvalidate(quicklist);
 
     /* iterate over next nodes until everything is deleted. */
     while (extent) {
@@ -1230,7 +1314,29 @@ quicklistIter *quicklistGetIteratorAtIdx(quicklist *quicklist,
         seek_index = quicklist->count - 1 - index;
     }
 
-    n = seek_forward ? quicklist->head : quicklist->tail;
+    if (quicklist->len >= SEEK_INDEX_MIN_NODES) {
+        /* For long node chains consult the sparse index: a binary search lands
+         * within SEEK_INDEX_STRIDE nodes of the target instead of walking the
+         * whole chain from an end. The index counts elements from the head, so
+         * always seek forward from the last entry at or before the target. */
+        if (!quicklist->seek_idx)
+            quicklistSeekIndexBuild(quicklist);
+        quicklistSeekIndex *si = quicklist->seek_idx;
+        seek_forward = 1;
+        seek_index = forward ? index : quicklist->count - 1 - index;
+        unsigned long lo = 0, hi = si->len - 1;
+        while (lo < hi) {
+            unsigned long mid = lo + (hi - lo + 1) / 2;
+            if (si->before[mid] <= seek_index)
+                lo = mid;
+            else
+                hi = mid - 1;
+        }
+        n = si->nodes[lo];
+        accum = si->before[lo];
+    } else {
+        n = seek_forward ? quicklist->head : quicklist->tail;
+    }
     while (likely(n)) {
         if ((accum + n->count) > seek_index) {
             break;
@@ -1448,6 +1554,8 @@ void quicklistRotate(quicklist *quicklist) {
     if (quicklist->count <= 1)
         return;
 
+    quicklistSeekIndexInvalidate(quicklist);
+
     if (unlikely(QL_NODE_IS_PLAIN(quicklist->tail))) {
         quicklistRotatePlain(quicklist);
         return;
@@ -1507,6 +1615,7 @@ int quicklistPopCustom(quicklist *quicklist, int where, unsigned char **data,
     unsigned char *vstr;
     unsigned int vlen;
     long long vlong;
+    quicklistSeekIndexInvalidate(quicklist);
     int pos = (where == QUICKLIST_HEAD) ? 0 : -1;
 
     if (quicklist->count == 0)
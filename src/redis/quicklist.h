@@ -94,7 +94,18 @@ typedef struct quicklistBookmark {
 #   error unknown arch bits count
 #endif
 
-/* quicklist is a 40 byte struct (on 64-bit systems) describing a quicklist.
+/* Sparse positional index over the node chain: every SEEK_INDEX_STRIDE'th node
+ * together with the number of elements preceding it, counted from the head.
+ * Built lazily by quicklistGetIteratorAtIdx() for long node chains and
+ * discarded wholesale by any mutating operation, since mutations invalidate
+ * both the cached node pointers and the prefix counts. */
+typedef struct quicklistSeekIndex {
+    quicklistNode **nodes;
+    unsigned long long *before; /* elements preceding nodes[i] */
+    unsigned long len;          /* number of index entries */
+} quicklistSeekIndex;
+
+/* quicklist is a 48 byte struct (on 64-bit systems) describing a quicklist.
  * 'count' is the number of total entries.
  * 'len' is the number of quicklist nodes.
  * 'compress' is: 0 if compression disabled, otherwise it's the number
@@ -107,6 +118,7 @@ typedef struct quicklist {
     quicklistNode *tail;
     unsigned long count;        /* total count of all entries in all listpacks */
     unsigned long len;          /* number of quicklistNodes */
+    quicklistSeekIndex *seek_idx; /* lazy positional index, NULL when invalid */
     signed int fill : QL_FILL_BITS;       /* fill factor for individual nodes */
     unsigned int compress : QL_COMP_BITS; /* depth of end nodes not to compress;0=off */
     unsigned int bookmark_count: QL_BM_BITS;
@@ -191,6 +203,8 @@ int quicklistPop(quicklist *quicklist, int where, unsigned char **data,
 unsigned long quicklistCount(const quicklist *ql);
 int quicklistCompare(const quicklistEntry *entry, const unsigned char *p2, const size_t p2_len);
 size_t quicklistGetLzf(const quicklistNode *node, void **data);
+void quicklistCompressInterior(quicklist *quicklist);
+size_t quicklistPayloadBytes(const quicklist *quicklist);
 void quicklistRepr(unsigned char *ql, int full);
 
 /* bookmarks */
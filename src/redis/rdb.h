@@ -41,8 +41,9 @@
 
 /* The current RDB version. When the format changes in a way that is no longer
  * backward compatible this number gets incremented. */
-// TODO: should increment to 10 once we start storing RDB_TYPE_ZSET_LISTPACK.
-#define RDB_VERSION 9
+// Version 10 stores small hashes and zsets as RDB_TYPE_HASH_LISTPACK /
+// RDB_TYPE_ZSET_LISTPACK, i.e. the in-memory listpacks verbatim.
+#define RDB_VERSION 10
 
 /* Defines related to the dump file format. To store 32 bits lengths for short
  * keys requires a lot of space, so we check the most significant 2 bits of
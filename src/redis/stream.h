@@ -24,8 +24,20 @@ typedef struct stream {
     streamID max_deleted_entry_id;  /* The maximal ID that was deleted. */
     uint64_t entries_added; /* All time count of elements added. */
     rax *cgroups;           /* Consumer groups dictionary: name -> streamCG */
+    /* Cache of the tail (largest key) rax node, so that appends do not need
+     * to seek the end of the tree on every XADD. tail_lp mirrors the data
+     * pointer stored in the rax for tail_rax_key and both are valid only when
+     * tail_valid is non-zero. Any code path that modifies the rax outside of
+     * the append fast path must call streamInvalidateTailCache(). */
+    unsigned char *tail_lp;
+    unsigned char tail_rax_key[16];
+    int tail_valid;
 } stream;
 
+static inline void streamInvalidateTailCache(stream *s) {
+    s->tail_valid = 0;
+}
+
 /* We define an iterator to iterate stream items in an abstract way, without
  * caring about the radix tree + listpack representation. Technically speaking
  * the iterator is only used inside streamReplyWithRange(), so could just
@@ -85,6 +85,8 @@ stream *streamNew(void) {
     s->max_deleted_entry_id.ms = 0;
     s->entries_added = 0;
     s->cgroups = NULL; /* Created on demand to save memory when not used. */
+    s->tail_lp = NULL;
+    s->tail_valid = 0;
     return s;
 }
 
@@ -433,6 +435,8 @@ void streamGetEdgeID(stream *s, int first, int skip_tombstones, streamID *edge_i
  * 2. If a size of a single element or the sum of the elements is too big to
  *    be stored into the stream. errno will be set to ERANGE. */
 int streamAppendItem(stream *s, robj **argv, int64_t numfields, streamID *added_id, streamID *use_id, int seq_given) {
+    /* This legacy path does not maintain the tail node cache. */
+    streamInvalidateTailCache(s);
 
     /* Generate the new entry ID. */
     streamID id;
@@ -742,6 +746,7 @@ int64_t streamTrim(stream *s, streamAddTrimArgs *args) {
         if (remove_node) {
             lpFree(lp);
             raxRemove(s->rax_tree,ri.key,ri.key_len,NULL);
+            streamInvalidateTailCache(s);
             raxSeek(&ri,">=",ri.key,ri.key_len);
             s->length -= entries;
             deleted += entries;
@@ -840,6 +845,7 @@ int64_t streamTrim(stream *s, streamAddTrimArgs *args) {
 
         /* Update the listpack with the new pointer. */
         raxInsert(s->rax_tree,ri.key,ri.key_len,lp,NULL);
+        streamInvalidateTailCache(s);
 
         break; /* If we are here, there was enough to delete in the current
                   node, so no need to go to the next node. */
@@ -1279,6 +1285,7 @@ void streamIteratorRemoveEntry(streamIterator *si, streamID *current) {
          * node. */
         lpFree(lp);
         raxRemove(si->stream->rax_tree,si->ri.key,si->ri.key_len,NULL);
+        streamInvalidateTailCache(si->stream);
     } else {
         /* In the base case we alter the counters of valid/deleted entries. */
         lp = lpReplaceInteger(lp,&p,aux-1);
@@ -1287,8 +1294,10 @@ void streamIteratorRemoveEntry(streamIterator *si, streamID *current) {
         lp = lpReplaceInteger(lp,&p,aux+1);
 
         /* Update the listpack with the new pointer. */
-        if (si->lp != lp)
+        if (si->lp != lp) {
             raxInsert(si->stream->rax_tree,si->ri.key,si->ri.key_len,lp,NULL);
+            streamInvalidateTailCache(si->stream);
+        }
     }
 
     /* Update the number of entries counter. */
@@ -56,6 +56,8 @@ typedef struct redisObject robj;
 
 zskiplist* zslCreate(void);
 void zslFree(zskiplist* zsl);
+zskiplistNode* zslCreateNode(int level, double score, sds ele);
+int zslRandomLevel(void);
 zskiplistNode* zslInsert(zskiplist* zsl, double score, sds ele);
 unsigned char* zzlInsert(unsigned char* zl, sds ele, double score);
 int zslDelete(zskiplist *zsl, double score, sds ele, zskiplistNode **node);
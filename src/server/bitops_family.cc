@@ -5,12 +5,16 @@
 #include "server/bitops_family.h"
 
 #include <bitset>
+#include <cstring>
+#include <numeric>
+#include <optional>
 
 extern "C" {
 #include "redis/object.h"
 }
 
 #include "base/logging.h"
+#include "core/sparse_bitmap.h"
 #include "server/command_registry.h"
 #include "server/common.h"
 #include "server/conn_context.h"
@@ -27,6 +31,14 @@ namespace {
 
 using ShardStringResults = std::vector<OpResult<std::string>>;
 const int32_t OFFSET_FACTOR = 8;  // number of bits in byte
+
+// SETBIT whose offset lands this far out creates (or converts to) a SparseBitmap
+// instead of a flat string, so a single high bit does not materialize a long zero run.
+constexpr size_t kSparseMinBytes = 1u << 16;
+
+// Once this fraction of a sparse value is backed by allocated chunks, the page table
+// stops paying for itself and the value is densified back into a flat string.
+constexpr double kDensifyOccupancy = 0.5;
 const char* OR_OP_NAME = "OR";
 const char* XOR_OP_NAME = "XOR";
 const char* AND_OP_NAME = "AND";
@@ -55,6 +67,7 @@ bool SetBitValue(uint32_t offset, bool bit_value, std::string* entry);
 std::size_t CountBitSetByByteIndices(std::string_view at, std::size_t start, std::size_t end);
 std::size_t CountBitSet(std::string_view str, int64_t start, int64_t end, bool bits);
 std::size_t CountBitSetByBitIndices(std::string_view at, std::size_t start, std::size_t end);
+std::size_t CountBitsSparse(const SparseBitmap& bitmap, int64_t start, int64_t end, bool bits);
 OpResult<std::string> RunBitOpOnShard(std::string_view op, const OpArgs& op_args, ArgSlice keys);
 std::string RunBitOperationOnValues(std::string_view op, const BitsStrVec& values);
 
@@ -91,7 +104,27 @@ std::string BitOpString(BitOp operation_f, SkipOp skip_f, const BitsStrVec& valu
   std::size_t max_size = new_value.size();
 
   if (values.size() > 1) {
-    for (std::size_t i = 0; i < max_size; i++) {
+    // The bit operations are byte-wise, so over the region covered by all operands we can
+    // apply them on 8-byte words and let a single instruction handle 8 bytes at once.
+    std::size_t min_size = values[0].size();
+    for (const auto& val : values) {
+      min_size = std::min(min_size, val.size());
+    }
+
+    std::size_t i = 0;
+    for (; i + 8 <= min_size; i += 8) {
+      std::uint64_t acc;
+      std::memcpy(&acc, values[0].data() + i, 8);
+      for (std::size_t j = 1; j < values.size(); ++j) {
+        std::uint64_t word;
+        std::memcpy(&word, values[j].data() + i, 8);
+        acc = operation_f(acc, word);
+      }
+      std::memcpy(new_value.data() + i, &acc, 8);
+    }
+
+    // The tail and the zero-padded region of shorter operands go byte by byte.
+    for (; i < max_size; i++) {
       std::uint8_t new_entry = operation_f(GetByteAt(values[0], i), GetByteAt(values[1], i));
       for (std::size_t j = 2; j < values.size(); ++j) {
         new_entry = operation_f(new_entry, GetByteAt(values[j], i));
@@ -123,17 +156,25 @@ constexpr bool SkipXor(uint8_t) {
   return false;
 }
 
-constexpr uint8_t AndOp(uint8_t left, uint8_t right) {
-  return left & right;
-}
+// The operations are generic so that BitOpString can apply them both on single bytes and
+// on 8-byte words.
+struct AndOp {
+  template <typename T> constexpr T operator()(T left, T right) const {
+    return left & right;
+  }
+};
 
-constexpr uint8_t OrOp(uint8_t left, uint8_t right) {
-  return left | right;
-}
+struct OrOp {
+  template <typename T> constexpr T operator()(T left, T right) const {
+    return left | right;
+  }
+};
 
-constexpr uint8_t XorOp(uint8_t left, uint8_t right) {
-  return left ^ right;
-}
+struct XorOp {
+  template <typename T> constexpr T operator()(T left, T right) const {
+    return left ^ right;
+  }
+};
 
 std::string BitOpNotString(std::string from) {
   std::transform(from.begin(), from.end(), from.begin(), [](auto c) { return ~c; });
@@ -176,9 +217,21 @@ std::size_t CountBitSetByByteIndices(std::string_view at, std::size_t start, std
     return 0;
   }
   end = std::min(end, at.size());  // don't overflow
-  std::uint32_t count =
-      std::accumulate(std::next(at.begin(), start), std::next(at.begin(), end), 0,
-                      [](auto counter, uint8_t ch) { return counter + absl::popcount(ch); });
+  if (start >= end) {
+    return 0;
+  }
+
+  // Count 8 bytes per hardware popcount; byte order does not matter for counting.
+  std::size_t count = 0;
+  std::size_t i = start;
+  for (; i + 8 <= end; i += 8) {
+    std::uint64_t word;
+    std::memcpy(&word, at.data() + i, 8);
+    count += absl::popcount(word);
+  }
+  for (; i < end; ++i) {
+    count += absl::popcount(static_cast<uint8_t>(at[i]));
+  }
   return count;
 }
 
@@ -244,6 +297,55 @@ std::size_t CountBitSet(std::string_view str, int64_t start, int64_t end, bool b
               : CountBitSetByByteIndices(str, start, end);
 }
 
+// CountBitSet over a SparseBitmap, without materializing the value. Edge bytes are read
+// individually; the whole-byte interior goes through CountBytesRange, which skips
+// never-touched chunks entirely.
+std::size_t CountBitsSparse(const SparseBitmap& bitmap, int64_t start, int64_t end, bool bits) {
+  const int64_t size = bits ? bitmap.byte_size() * OFFSET_FACTOR : bitmap.byte_size();
+
+  if (start > 0 && end > 0 && end < start) {
+    return 0;
+  }
+  if (start < 0 && end < 0 && start > end) {
+    return 0;
+  }
+
+  start = NormalizedOffset(size, start);
+  if (end > 0 && end < start) {
+    return 0;
+  }
+  end = NormalizedOffset(size, end);
+  if (start > end) {
+    std::swap(start, end);
+  }
+  if (end > size) {
+    end = size;
+  }
+  ++end;
+
+  if (!bits) {
+    return bitmap.CountBytesRange(start, end);
+  }
+
+  auto byte_at = [&bitmap](std::size_t index) -> uint8_t {
+    return index < bitmap.byte_size() ? bitmap.GetByte(index) : 0;
+  };
+
+  std::size_t first_byte_index = GetByteIndex(start);
+  std::size_t last_byte_index = GetByteIndex(end);
+  if (start % OFFSET_FACTOR == 0 && end % OFFSET_FACTOR == 0) {
+    return bitmap.CountBytesRange(first_byte_index, last_byte_index);
+  }
+  const auto last_bit_first_byte =
+      first_byte_index != last_byte_index ? OFFSET_FACTOR : GetBitIndex(end);
+  std::size_t count = CountBitsRange(byte_at(first_byte_index), GetBitIndex(start), last_bit_first_byte);
+  if (first_byte_index < last_byte_index) {
+    count += CountBitsRange(byte_at(last_byte_index), 0, GetBitIndex(end));
+    count += bitmap.CountBytesRange(first_byte_index + 1, last_byte_index);
+  }
+  return count;
+}
+
 // return true if bit is on
 bool GetBitValue(const std::string& entry, uint32_t offset) {
   const auto byte_val{GetByteValue(entry, offset)};
@@ -301,6 +403,22 @@ class ElementAccess {
   std::string Value() const;
 
   void Commit(std::string_view new_value) const;
+
+  // Returns the found value. Use to check its type before deciding how to access it.
+  const PrimeValue& Peek() const {
+    CHECK_NOTNULL(shard_);
+    return element_iter_->second;
+  }
+
+  // Runs `mut` over the stored value between Pre/PostUpdate, for mutating it in place
+  // (e.g. a SparseBitmap) without re-serializing it through Commit.
+  template <typename Mutator> void Modify(Mutator mut) {
+    CHECK_NOTNULL(shard_);
+    auto& db_slice = shard_->db_slice();
+    db_slice.PreUpdate(Index(), element_iter_);
+    mut(&element_iter_->second);
+    db_slice.PostUpdate(Index(), element_iter_, key_, !added_);
+  }
 };
 
 OpStatus ElementAccess::Find(EngineShard* shard) {
@@ -355,15 +473,43 @@ OpResult<bool> BitNewValue(const OpArgs& args, std::string_view key, uint32_t of
     return find_res;
   }
 
+  const size_t new_size = GetByteIndex(offset) + 1;
+
   if (element_access.IsNewEntry()) {
-    std::string new_entry(GetByteIndex(offset) + 1, 0);
+    if (new_size >= kSparseMinBytes) {
+      element_access.Modify([&](PrimeValue* pv) {
+        old_value = pv->InitSparseBitmap()->SetBit(offset, bit_value);
+      });
+      return old_value;
+    }
+    std::string new_entry(new_size, 0);
     old_value = SetBitValue(offset, bit_value, &new_entry);
     element_access.Commit(new_entry);
+  } else if (element_access.Peek().IsSparseBitmap()) {
+    element_access.Modify([&](PrimeValue* pv) {
+      SparseBitmap* bitmap = pv->GetSparseBitmap();
+      old_value = bitmap->SetBit(offset, bit_value);
+      if (bitmap->Occupancy() >= kDensifyOccupancy) {
+        std::string dense(bitmap->byte_size(), 0);
+        bitmap->Materialize(dense.data());
+        pv->SetString(dense);  // frees the bitmap
+      }
+    });
   } else {
     bool reset = false;
     std::string existing_entry{element_access.Value()};
     if ((existing_entry.size() * OFFSET_FACTOR) <= offset) {
-      existing_entry.resize(GetByteIndex(offset) + 1, 0);
+      // Extending the value far past its current end leaves a zero run in the middle;
+      // keep that run virtual by switching to a sparse bitmap.
+      if (new_size >= kSparseMinBytes && new_size / 4 >= existing_entry.size()) {
+        element_access.Modify([&](PrimeValue* pv) {
+          SparseBitmap* bitmap = pv->InitSparseBitmap();
+          bitmap->Assign(existing_entry);
+          old_value = bitmap->SetBit(offset, bit_value);
+        });
+        return old_value;
+      }
+      existing_entry.resize(new_size, 0);
       reset = true;
     }
     old_value = SetBitValue(offset, bit_value, &existing_entry);
@@ -374,6 +520,362 @@ OpResult<bool> BitNewValue(const OpArgs& args, std::string_view key, uint32_t of
   return old_value;
 }
 
+// ------------------------------------------------------------------------- //
+// BITFIELD support: see https://redis.io/commands/bitfield/
+// Bit numbering follows SETBIT/GETBIT: bit 0 is the most significant bit of byte 0.
+
+enum class BitFieldOverflow : uint8_t { WRAP, SAT, FAIL };
+
+struct BitFieldOp {
+  enum class Kind : uint8_t { GET, SET, INCRBY } kind;
+
+  bool is_signed;
+  uint8_t bits;
+  uint64_t offset;  // in bits
+  int64_t value;    // SET operand or INCRBY delta, unused for GET
+  BitFieldOverflow overflow = BitFieldOverflow::WRAP;
+};
+
+// One entry per GET/SET/INCRBY in argument order; nullopt encodes the nil reply
+// of an operation rejected by the FAIL overflow policy.
+using BitFieldResults = std::vector<std::optional<int64_t>>;
+
+const char kInvalidBitfieldTypeErr[] =
+    "Invalid bitfield type. Use something like i16 u8. Note that u64 is not supported but i64 is.";
+const char kInvalidOverflowTypeErr[] = "Invalid OVERFLOW type specified";
+const char kInvalidBitOffsetErr[] = "bit offset is not an integer or out of range";
+const char kBitfieldRoOnlyGetErr[] = "BITFIELD_RO only supports the GET subcommand";
+
+// Parses i<bits>/u<bits>. Unsigned is limited to 63 bits so results fit the integer reply.
+bool ParseBitFieldEncoding(std::string_view enc, bool* is_signed, uint8_t* bits) {
+  if (enc.size() < 2 || (enc[0] != 'i' && enc[0] != 'u'))
+    return false;
+
+  uint32_t val;
+  if (!absl::SimpleAtoi(enc.substr(1), &val) || val == 0)
+    return false;
+
+  *is_signed = enc[0] == 'i';
+  if (val > (*is_signed ? 64u : 63u))
+    return false;
+
+  *bits = val;
+  return true;
+}
+
+// Parses a bit offset, resolving the #<index> form to index * bits. The addressed byte
+// must stay within the 4GB range, like in the reference implementation.
+bool ParseBitFieldOffset(std::string_view arg, uint8_t bits, uint64_t* offset) {
+  bool multiply = false;
+  if (!arg.empty() && arg[0] == '#') {
+    multiply = true;
+    arg.remove_prefix(1);
+  }
+
+  uint64_t val;
+  if (!absl::SimpleAtoi(arg, &val))
+    return false;
+
+  if (multiply) {
+    if (val > (std::numeric_limits<uint64_t>::max() / bits))
+      return false;
+    val *= bits;
+  }
+
+  if ((val >> 3) >= (1ULL << 32))
+    return false;
+
+  *offset = val;
+  return true;
+}
+
+uint64_t GetBitFieldRaw(std::string_view bytes, uint64_t offset, uint8_t bits) {
+  uint64_t value = 0;
+  for (uint8_t i = 0; i < bits; ++i) {
+    uint64_t bit = offset + i;
+    size_t byte = bit >> 3;
+    uint64_t bitval = 0;
+    if (byte < bytes.size())
+      bitval = (uint8_t(bytes[byte]) >> (7 - (bit & 7))) & 1;
+    value = (value << 1) | bitval;
+  }
+  return value;
+}
+
+int64_t GetBitFieldSigned(std::string_view bytes, uint64_t offset, uint8_t bits) {
+  uint64_t value = GetBitFieldRaw(bytes, offset, bits);
+  if (bits < 64 && (value & (1ULL << (bits - 1))))
+    value |= ~((1ULL << bits) - 1);  // sign-extend
+  return int64_t(value);
+}
+
+void SetBitFieldRaw(std::string* bytes, uint64_t offset, uint8_t bits, uint64_t value) {
+  for (uint8_t i = 0; i < bits; ++i) {
+    uint64_t bit = offset + i;
+    size_t byte = bit >> 3;
+    DCHECK_LT(byte, bytes->size());
+    uint8_t mask = 1 << (7 - (bit & 7));
+    uint8_t cur = (*bytes)[byte];
+    (*bytes)[byte] = ((value >> (bits - 1 - i)) & 1) ? (cur | mask) : (cur & ~mask);
+  }
+}
+
+// Returns +1/-1 when value+incr overflows the signed <bits> range, 0 otherwise. On
+// overflow *result holds the clamped value for SAT and the wrapped one for WRAP.
+int CheckSignedOverflow(int64_t value, int64_t incr, uint8_t bits, BitFieldOverflow ow,
+                        int64_t* result) {
+  int64_t max = (bits == 64) ? std::numeric_limits<int64_t>::max()
+                             : ((int64_t(1) << (bits - 1)) - 1);
+  int64_t min = -max - 1;
+  int64_t maxincr = max - value;
+  int64_t minincr = min - value;
+
+  auto wrap = [&] {
+    uint64_t res = uint64_t(value) + uint64_t(incr);
+    if (bits < 64) {
+      uint64_t mask = ~uint64_t(0) << bits;
+      if (res & (uint64_t(1) << (bits - 1)))
+        res |= mask;
+      else
+        res &= ~mask;
+    }
+    *result = int64_t(res);
+  };
+
+  if (value > max || (bits != 64 && incr > maxincr) ||
+      (value >= 0 && incr > 0 && incr > maxincr)) {
+    if (ow == BitFieldOverflow::WRAP)
+      wrap();
+    else
+      *result = max;
+    return 1;
+  }
+  if (value < min || (bits != 64 && incr < minincr) ||
+      (value < 0 && incr < 0 && incr < minincr)) {
+    if (ow == BitFieldOverflow::WRAP)
+      wrap();
+    else
+      *result = min;
+    return -1;
+  }
+
+  *result = value + incr;
+  return 0;
+}
+
+// Unsigned counterpart; bits <= 63 so all intermediate values fit int64_t.
+int CheckUnsignedOverflow(uint64_t value, int64_t incr, uint8_t bits, BitFieldOverflow ow,
+                          uint64_t* result) {
+  uint64_t max = (uint64_t(1) << bits) - 1;
+  int64_t maxincr = int64_t(max - value);
+  int64_t minincr = -int64_t(value);
+
+  auto wrap = [&] { *result = (value + uint64_t(incr)) & max; };
+
+  if (value > max || (incr > 0 && incr > maxincr)) {
+    if (ow == BitFieldOverflow::WRAP)
+      wrap();
+    else
+      *result = max;
+    return 1;
+  }
+  if (incr < 0 && incr < minincr) {
+    if (ow == BitFieldOverflow::WRAP)
+      wrap();
+    else
+      *result = 0;
+    return -1;
+  }
+
+  *result = value + uint64_t(incr);
+  return 0;
+}
+
+std::optional<int64_t> ApplyBitFieldOp(const BitFieldOp& op, std::string* value) {
+  switch (op.kind) {
+    case BitFieldOp::Kind::GET:
+      if (op.is_signed)
+        return GetBitFieldSigned(*value, op.offset, op.bits);
+      return int64_t(GetBitFieldRaw(*value, op.offset, op.bits));
+
+    case BitFieldOp::Kind::SET:
+      if (op.is_signed) {
+        int64_t old = GetBitFieldSigned(*value, op.offset, op.bits);
+        int64_t set_value;
+        if (CheckSignedOverflow(op.value, 0, op.bits, op.overflow, &set_value) &&
+            op.overflow == BitFieldOverflow::FAIL)
+          return std::nullopt;
+        SetBitFieldRaw(value, op.offset, op.bits, uint64_t(set_value));
+        return old;
+      } else {
+        uint64_t old = GetBitFieldRaw(*value, op.offset, op.bits);
+        uint64_t set_value;
+        if (CheckUnsignedOverflow(uint64_t(op.value), 0, op.bits, op.overflow, &set_value) &&
+            op.overflow == BitFieldOverflow::FAIL)
+          return std::nullopt;
+        SetBitFieldRaw(value, op.offset, op.bits, set_value);
+        return int64_t(old);
+      }
+
+    case BitFieldOp::Kind::INCRBY:
+      if (op.is_signed) {
+        int64_t old = GetBitFieldSigned(*value, op.offset, op.bits);
+        int64_t new_value;
+        if (CheckSignedOverflow(old, op.value, op.bits, op.overflow, &new_value) &&
+            op.overflow == BitFieldOverflow::FAIL)
+          return std::nullopt;
+        SetBitFieldRaw(value, op.offset, op.bits, uint64_t(new_value));
+        return new_value;
+      } else {
+        uint64_t old = GetBitFieldRaw(*value, op.offset, op.bits);
+        uint64_t new_value;
+        if (CheckUnsignedOverflow(old, op.value, op.bits, op.overflow, &new_value) &&
+            op.overflow == BitFieldOverflow::FAIL)
+          return std::nullopt;
+        SetBitFieldRaw(value, op.offset, op.bits, new_value);
+        return int64_t(new_value);
+      }
+  }
+  return std::nullopt;
+}
+
+// Executes all operations of one invocation in a single pass over the value. When the
+// addressed ranges do not overlap they are visited in offset order so that a large bitmap
+// streams through the cache once; overlapping ranges keep argument order, which is the
+// observable semantics.
+OpResult<BitFieldResults> OpBitField(const OpArgs& op_args, std::string_view key,
+                                     absl::Span<BitFieldOp> ops, bool read_only) {
+  BitFieldResults results(ops.size());
+
+  std::vector<uint32_t> order(ops.size());
+  std::iota(order.begin(), order.end(), 0);
+  std::stable_sort(order.begin(), order.end(),
+                   [&ops](uint32_t l, uint32_t r) { return ops[l].offset < ops[r].offset; });
+  for (size_t i = 1; i < order.size(); ++i) {
+    const BitFieldOp& prev = ops[order[i - 1]];
+    if (prev.offset + prev.bits > ops[order[i]].offset) {
+      std::iota(order.begin(), order.end(), 0);
+      break;
+    }
+  }
+
+  if (read_only) {  // BITFIELD_RO or an invocation consisting of GETs only.
+    std::string value;
+    OpResult<std::string> res = ReadValue(op_args.db_cntx, key, op_args.shard);
+    if (res) {
+      value = std::move(res.value());
+    } else if (res.status() != OpStatus::KEY_NOTFOUND) {  // missing keys read as all-zeroes
+      return res.status();
+    }
+
+    for (uint32_t idx : order)
+      results[idx] = ApplyBitFieldOp(ops[idx], &value);
+    return results;
+  }
+
+  ElementAccess access{key, op_args};
+  OpStatus status = access.Find(op_args.shard);
+  if (status != OpStatus::OK)
+    return status;
+
+  std::string value = access.Value();
+
+  uint64_t highest_write_bit = 0;
+  for (const BitFieldOp& op : ops) {
+    if (op.kind != BitFieldOp::Kind::GET)
+      highest_write_bit = std::max(highest_write_bit, op.offset + op.bits);
+  }
+  size_t needed = (highest_write_bit + 7) / 8;
+  if (value.size() < needed)
+    value.resize(needed, '\0');
+
+  for (uint32_t idx : order)
+    results[idx] = ApplyBitFieldOp(ops[idx], &value);
+
+  access.Commit(value);
+  return results;
+}
+
+void BitFieldGeneric(CmdArgList args, ConnectionContext* cntx, bool read_only) {
+  std::string_view key = ArgS(args, 0);
+
+  std::vector<BitFieldOp> ops;
+  BitFieldOverflow overflow = BitFieldOverflow::WRAP;
+  bool has_write = false;
+
+  for (size_t i = 1; i < args.size();) {
+    ToUpper(&args[i]);
+    std::string_view sub = ArgS(args, i);
+
+    if (sub == "OVERFLOW") {
+      if (read_only)
+        return (*cntx)->SendError(kBitfieldRoOnlyGetErr);
+      if (i + 1 >= args.size())
+        return (*cntx)->SendError(kSyntaxErr);
+
+      ToUpper(&args[i + 1]);
+      std::string_view policy = ArgS(args, i + 1);
+      if (policy == "WRAP")
+        overflow = BitFieldOverflow::WRAP;
+      else if (policy == "SAT")
+        overflow = BitFieldOverflow::SAT;
+      else if (policy == "FAIL")
+        overflow = BitFieldOverflow::FAIL;
+      else
+        return (*cntx)->SendError(kInvalidOverflowTypeErr);
+      i += 2;
+      continue;
+    }
+
+    BitFieldOp op;
+    if (sub == "GET") {
+      op.kind = BitFieldOp::Kind::GET;
+    } else if (sub == "SET") {
+      op.kind = BitFieldOp::Kind::SET;
+    } else if (sub == "INCRBY") {
+      op.kind = BitFieldOp::Kind::INCRBY;
+    } else {
+      return (*cntx)->SendError(kSyntaxErr);
+    }
+
+    bool is_get = op.kind == BitFieldOp::Kind::GET;
+    if (!is_get && read_only)
+      return (*cntx)->SendError(kBitfieldRoOnlyGetErr);
+
+    size_t num_args = is_get ? 3 : 4;
+    if (i + num_args > args.size())
+      return (*cntx)->SendError(kSyntaxErr);
+
+    if (!ParseBitFieldEncoding(ArgS(args, i + 1), &op.is_signed, &op.bits))
+      return (*cntx)->SendError(kInvalidBitfieldTypeErr);
+    if (!ParseBitFieldOffset(ArgS(args, i + 2), op.bits, &op.offset))
+      return (*cntx)->SendError(kInvalidBitOffsetErr);
+    if (!is_get && !absl::SimpleAtoi(ArgS(args, i + 3), &op.value))
+      return (*cntx)->SendError(kInvalidIntErr);
+
+    op.overflow = overflow;
+    has_write |= !is_get;
+    ops.push_back(op);
+    i += num_args;
+  }
+
+  auto cb = [&](Transaction* t, EngineShard* shard) {
+    return OpBitField(t->GetOpArgs(shard), key, absl::MakeSpan(ops), !has_write);
+  };
+  OpResult<BitFieldResults> res = cntx->transaction->ScheduleSingleHopT(std::move(cb));
+  if (!res) {
+    return (*cntx)->SendError(res.status());
+  }
+
+  (*cntx)->StartArray(res->size());
+  for (const auto& val : *res) {
+    if (val)
+      (*cntx)->SendLong(*val);
+    else
+      (*cntx)->SendNull();
+  }
+}
+
 // ---------------------------------------------------------
 
 std::string RunBitOperationOnValues(std::string_view op, const BitsStrVec& values) {
@@ -387,11 +889,11 @@ std::string RunBitOperationOnValues(std::string_view op, const BitsStrVec& value
   const auto BitOperation = [&]() {
     if (op == OR_OP_NAME) {
       std::string default_str{values[max_len_index]};
-      return BitOpString(OrOp, SkipOr, std::move(values), std::move(default_str));
+      return BitOpString(OrOp{}, SkipOr, std::move(values), std::move(default_str));
     } else if (op == XOR_OP_NAME) {
-      return BitOpString(XorOp, SkipXor, std::move(values), std::string(max_len, 0));
+      return BitOpString(XorOp{}, SkipXor, std::move(values), std::string(max_len, 0));
     } else if (op == AND_OP_NAME) {
-      return BitOpString(AndOp, SkipAnd, std::move(values), std::string(max_len, 0));
+      return BitOpString(AndOp{}, SkipAnd, std::move(values), std::string(max_len, 0));
     } else if (op == NOT_OP_NAME) {
       return BitOpNotString(values[0]);
     } else {
@@ -581,11 +1083,15 @@ void BitCount(CmdArgList args, ConnectionContext* cntx) {
 }
 
 void BitField(CmdArgList args, ConnectionContext* cntx) {
-  (*cntx)->SendLong(0);
+  // Support for the command BITFIELD
+  // See details at https://redis.io/commands/bitfield/
+  BitFieldGeneric(args, cntx, false);
 }
 
 void BitFieldRo(CmdArgList args, ConnectionContext* cntx) {
-  (*cntx)->SendLong(0);
+  // Support for the command BITFIELD_RO
+  // See details at https://redis.io/commands/bitfield_ro/
+  BitFieldGeneric(args, cntx, true);
 }
 
 void BitOp(CmdArgList args, ConnectionContext* cntx) {
@@ -711,12 +1217,17 @@ std::string GetString(const PrimeValue& pv, EngineShard* shard) {
 }
 
 OpResult<bool> ReadValueBitsetAt(const OpArgs& op_args, std::string_view key, uint32_t offset) {
-  OpResult<std::string> result = ReadValue(op_args.db_cntx, key, op_args.shard);
-  if (result) {
-    return GetBitValueSafe(result.value(), offset);
-  } else {
-    return result.status();
+  OpResult<PrimeIterator> it_res = op_args.shard->db_slice().Find(op_args.db_cntx, key, OBJ_STRING);
+  if (!it_res.ok()) {
+    return it_res.status();
+  }
+
+  const PrimeValue& pv = it_res.value()->second;
+  if (pv.IsSparseBitmap()) {
+    return pv.GetSparseBitmap()->GetBit(offset);
   }
+
+  return GetBitValueSafe(GetString(pv, op_args.shard), offset);
 }
 
 OpResult<std::string> ReadValue(const DbContext& context, std::string_view key,
@@ -733,19 +1244,31 @@ OpResult<std::string> ReadValue(const DbContext& context, std::string_view key,
 
 OpResult<std::size_t> CountBitsForValue(const OpArgs& op_args, std::string_view key, int64_t start,
                                         int64_t end, bool bit_value) {
-  OpResult<std::string> result = ReadValue(op_args.db_cntx, key, op_args.shard);
+  OpResult<PrimeIterator> it_res = op_args.shard->db_slice().Find(op_args.db_cntx, key, OBJ_STRING);
+  if (!it_res.ok()) {  // if this is not found, just return 0 - per Redis
+    return it_res.status();
+  }
 
-  if (result) {  // if this is not found, just return 0 - per Redis
-    if (result.value().empty()) {
+  const PrimeValue& pv = it_res.value()->second;
+  if (pv.IsSparseBitmap()) {
+    const SparseBitmap& bitmap = *pv.GetSparseBitmap();
+    if (bitmap.byte_size() == 0) {
       return 0;
     }
     if (end == std::numeric_limits<int64_t>::max()) {
-      end = result.value().size();
+      end = bitmap.byte_size();
     }
-    return CountBitSet(result.value(), start, end, bit_value);
-  } else {
-    return result.status();
+    return CountBitsSparse(bitmap, start, end, bit_value);
+  }
+
+  std::string value = GetString(pv, op_args.shard);
+  if (value.empty()) {
+    return 0;
+  }
+  if (end == std::numeric_limits<int64_t>::max()) {
+    end = value.size();
   }
+  return CountBitSet(value, start, end, bit_value);
 }
 
 // Returns the bit position (where MSB is 0, LSB is 7) of the leftmost bit that
@@ -778,10 +1301,22 @@ int64_t FindFirstBitWithValueAsBit(std::string_view value_str, bool bit_value, i
 
 int64_t FindFirstBitWithValueAsByte(std::string_view value_str, bool bit_value, int64_t start,
                                     int64_t end) {
-  for (int64_t i = start; i <= end; ++i) {
-    if (static_cast<size_t>(i) >= value_str.size()) {
+  const int64_t last = std::min(end, static_cast<int64_t>(value_str.size()) - 1);
+  const uint64_t kSkipWord = bit_value ? 0 : std::numeric_limits<uint64_t>::max();
+
+  int64_t i = start;
+
+  // Skip 8-byte blocks that can not contain the sought bit with a single comparison each;
+  // the byte loop below then pinpoints the position inside the first interesting block.
+  for (; i + 8 <= last + 1; i += 8) {
+    uint64_t word;
+    std::memcpy(&word, value_str.data() + i, 8);
+    if (word != kSkipWord) {
       break;
     }
+  }
+
+  for (; i <= last; ++i) {
     const uint8_t current_byte = value_str[i];
     const uint8_t kNotFoundByte = bit_value ? 0 : std::numeric_limits<uint8_t>::max();
     if (current_byte == kNotFoundByte) {
@@ -796,11 +1331,38 @@ int64_t FindFirstBitWithValueAsByte(std::string_view value_str, bool bit_value,
 
 OpResult<int64_t> FindFirstBitWithValue(const OpArgs& op_args, std::string_view key, bool bit_value,
                                         int64_t start, int64_t end, bool as_bit) {
-  OpResult<std::string> value = ReadValue(op_args.db_cntx, key, op_args.shard);
+  OpResult<PrimeIterator> it_res = op_args.shard->db_slice().Find(op_args.db_cntx, key, OBJ_STRING);
+
+  if (it_res.ok() && it_res.value()->second.IsSparseBitmap()) {
+    const SparseBitmap& bitmap = *it_res.value()->second.GetSparseBitmap();
+    int64_t size = bitmap.byte_size();
+    if (as_bit) {
+      size *= OFFSET_FACTOR;
+    }
+    int64_t normalized_start = NormalizedOffset(size, start);
+    int64_t normalized_end = NormalizedOffset(size, end);
+    if (normalized_start > normalized_end) {
+      return -1;  // Return -1 for negative ranges, per Redis
+    }
+    if (!as_bit) {  // a byte range covers all the bits of its edge bytes
+      normalized_start *= OFFSET_FACTOR;
+      normalized_end = normalized_end * OFFSET_FACTOR + (OFFSET_FACTOR - 1);
+    }
+
+    int64_t position = bitmap.FindFirstBit(bit_value, normalized_start, normalized_end);
+    if (position == -1 && !bit_value && static_cast<size_t>(start) < bitmap.byte_size() &&
+        end == std::numeric_limits<int64_t>::max()) {
+      // Returning bit-size of the value, compatible with Redis (but is a weird API).
+      return int64_t(bitmap.byte_size()) * OFFSET_FACTOR;
+    }
+    return position;
+  }
 
+  std::string value_storage;
   std::string_view value_str;
-  if (value) {  // non-existent keys are treated as empty strings, per Redis
-    value_str = value.value();
+  if (it_res.ok()) {  // non-existent keys are treated as empty strings, per Redis
+    value_storage = GetString(it_res.value()->second, op_args.shard);
+    value_str = value_storage;
   }
 
   int64_t size = value_str.size();
@@ -837,8 +1399,8 @@ void BitOpsFamily::Register(CommandRegistry* registry) {
 
   *registry << CI{"BITPOS", CO::CommandOpt::READONLY, -3, 1, 1, 1}.SetHandler(&BitPos)
             << CI{"BITCOUNT", CO::READONLY, -2, 1, 1, 1}.SetHandler(&BitCount)
-            << CI{"BITFIELD", CO::WRITE, -3, 1, 1, 1}.SetHandler(&BitField)
-            << CI{"BITFIELD_RO", CO::READONLY, -5, 1, 1, 1}.SetHandler(&BitFieldRo)
+            << CI{"BITFIELD", CO::WRITE, -2, 1, 1, 1}.SetHandler(&BitField)
+            << CI{"BITFIELD_RO", CO::READONLY | CO::FAST, -5, 1, 1, 1}.SetHandler(&BitFieldRo)
             << CI{"BITOP", CO::WRITE | CO::NO_AUTOJOURNAL, -4, 2, -1, 1}.SetHandler(&BitOp)
             << CI{"GETBIT", CO::READONLY | CO::FAST, 3, 1, 1, 1}.SetHandler(&GetBit)
             << CI{"SETBIT", CO::WRITE, 4, 1, 1, 1}.SetHandler(&SetBit);
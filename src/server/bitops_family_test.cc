@@ -233,6 +233,56 @@ TEST_F(BitOpsFamilyTest, SetBitMissingKey) {
   }
 }
 
+TEST_F(BitOpsFamilyTest, SparseBitmap) {
+  // A SETBIT far past the end of a fresh key is backed by a sparse bitmap, but every
+  // command observes the same flat string of zeroes.
+  const int64_t kOffset = 8'000'000;
+  EXPECT_EQ(0, CheckedInt({"setbit", "foo", std::to_string(kOffset), "1"}));
+  EXPECT_EQ(kOffset / 8 + 1, CheckedInt({"strlen", "foo"}));
+  EXPECT_EQ(1, CheckedInt({"getbit", "foo", std::to_string(kOffset)}));
+  EXPECT_EQ(0, CheckedInt({"getbit", "foo", std::to_string(kOffset - 1)}));
+
+  EXPECT_EQ(0, CheckedInt({"setbit", "foo", "5", "1"}));
+  EXPECT_EQ(2, CheckedInt({"bitcount", "foo"}));
+  EXPECT_EQ(1, CheckedInt({"bitcount", "foo", "1", std::to_string(kOffset / 8)}));
+  EXPECT_EQ(1, CheckedInt({"bitcount", "foo", "4", "1000000", "BIT"}));
+
+  EXPECT_EQ(5, CheckedInt({"bitpos", "foo", "1"}));
+  EXPECT_EQ(kOffset, CheckedInt({"bitpos", "foo", "1", "1"}));
+  EXPECT_EQ(0, CheckedInt({"bitpos", "foo", "0"}));
+  EXPECT_EQ(-1, CheckedInt({"bitpos", "foo", "1", "6", "100", "BIT"}));
+
+  // Clearing mutates the bitmap in place.
+  EXPECT_EQ(1, CheckedInt({"setbit", "foo", std::to_string(kOffset), "0"}));
+  EXPECT_EQ(1, CheckedInt({"bitcount", "foo"}));
+
+  // Generic string reads materialize the value transparently.
+  auto resp = Run({"getrange", "foo", "0", "0"});
+  EXPECT_EQ(resp, std::string(1, 4));  // bit 5 is 0b0000'0100
+
+  // Extending a short value far past its end converts it to a sparse bitmap while
+  // keeping the existing prefix.
+  EXPECT_EQ(Run({"set", "bar", "abc"}), "OK");
+  EXPECT_EQ(0, CheckedInt({"setbit", "bar", "1000000", "1"}));
+  EXPECT_EQ(125001, CheckedInt({"strlen", "bar"}));
+  EXPECT_EQ(Run({"getrange", "bar", "0", "2"}), "abc");
+  EXPECT_EQ(1, CheckedInt({"getbit", "bar", "1000000"}));
+}
+
+TEST_F(BitOpsFamilyTest, SparseBitmapDensify) {
+  // Filling enough of a sparse value converts it back to a flat string; reads stay
+  // consistent across the conversion.
+  const int64_t kTop = 65536 * 8;
+  EXPECT_EQ(0, CheckedInt({"setbit", "foo", std::to_string(kTop), "1"}));
+  for (int i = 0; i < 16; ++i) {
+    EXPECT_EQ(0, CheckedInt({"setbit", "foo", std::to_string(int64_t(i) * 4096 * 8), "1"}));
+  }
+  EXPECT_EQ(17, CheckedInt({"bitcount", "foo"}));
+  EXPECT_EQ(0, CheckedInt({"bitpos", "foo", "1"}));
+  EXPECT_EQ(kTop, CheckedInt({"bitpos", "foo", "1", "65536"}));
+  EXPECT_EQ(65537u, Run({"get", "foo"}).GetString().size());
+}
+
 const int32_t EXPECTED_VALUES_BYTES_BIT_COUNT[] = {  // got this from redis 0 as start index
     4, 7, 11, 14, 17, 21, 21, 21, 21};
 
@@ -283,6 +333,31 @@ TEST_F(BitOpsFamilyTest, BitCountByteBitSubRange) {
   EXPECT_EQ(0, CheckedInt({"bitcount", "foo", "-1", "-2", "bit"}));  // illegal range
 }
 
+TEST_F(BitOpsFamilyTest, BitCountLongString) {
+  // Values longer than 8 bytes exercise the word-at-a-time kernels, including ranges
+  // that are not aligned to word boundaries.
+  const std::string value(41, '\xff');
+  auto resp = Run({"set", "foo", value});
+  EXPECT_EQ(resp, "OK");
+  EXPECT_EQ(41 * 8, CheckedInt({"bitcount", "foo"}));
+  EXPECT_EQ(30 * 8, CheckedInt({"bitcount", "foo", "5", "34"}));
+  EXPECT_EQ(100, CheckedInt({"bitcount", "foo", "3", "102", "BIT"}));
+  EXPECT_EQ(17 * 8, CheckedInt({"bitcount", "foo", "-17", "-1"}));
+
+  // BITPOS has to scan past several all-ones words before finding a clear bit.
+  std::string set_tail(30, '\x00');
+  set_tail += '\x20';  // first set bit is bit 2 of byte 30.
+  resp = Run({"set", "bar", set_tail});
+  EXPECT_EQ(resp, "OK");
+  EXPECT_EQ(30 * 8 + 2, CheckedInt({"bitpos", "bar", "1"}));
+
+  std::string clear_tail(18, '\xff');
+  clear_tail += '\xfb';  // first clear bit is bit 5 of byte 18.
+  resp = Run({"set", "baz", clear_tail});
+  EXPECT_EQ(resp, "OK");
+  EXPECT_EQ(18 * 8 + 5, CheckedInt({"bitpos", "baz", "0"}));
+}
+
 // ------------------------- BITOP tests
 
 const auto EXPECTED_LEN_BITOP =
@@ -530,4 +605,44 @@ TEST_F(BitOpsFamilyTest, BitPos) {
   EXPECT_EQ(-1, CheckedInt({"bitpos", "d", "0"}));
 }
 
+TEST_F(BitOpsFamilyTest, BitFieldBasic) {
+  // Expected values were taken from running the same commands on redis.
+  EXPECT_EQ(0, CheckedInt({"bitfield", "foo", "set", "u8", "0", "255"}));
+  EXPECT_EQ(255, CheckedInt({"bitfield", "foo", "get", "u8", "0"}));
+  EXPECT_EQ(0, CheckedInt({"bitfield_ro", "missing", "get", "u8", "100"}));
+
+  // Default overflow policy is WRAP.
+  EXPECT_EQ(9, CheckedInt({"bitfield", "foo", "incrby", "u8", "0", "10"}));
+  EXPECT_EQ(255, CheckedInt({"bitfield", "foo", "overflow", "sat", "incrby", "u8", "0", "250"}));
+  EXPECT_THAT(Run({"bitfield", "foo", "overflow", "fail", "incrby", "u8", "0", "50"}),
+              ArgType(RespExpr::NIL));
+
+  // Signed fields, including the #<index> offset form.
+  EXPECT_EQ(0, CheckedInt({"bitfield", "bar", "set", "i8", "#1", "-128"}));
+  EXPECT_EQ(-128, CheckedInt({"bitfield", "bar", "get", "i8", "8"}));
+  EXPECT_EQ(-128, CheckedInt({"bitfield", "bar", "overflow", "sat", "incrby", "i8", "#1", "-1"}));
+  EXPECT_EQ(127, CheckedInt({"bitfield", "bar", "incrby", "i8", "#1", "-1"}));
+}
+
+TEST_F(BitOpsFamilyTest, BitFieldMultipleOps) {
+  // Results must follow argument order even though non-overlapping operations are
+  // internally executed in offset order.
+  auto resp = Run({"bitfield", "foo", "set", "u8", "8", "1", "set", "u8", "0", "2"});
+  ASSERT_THAT(resp, ArrLen(2));
+  EXPECT_THAT(resp.GetVec(), ElementsAre(IntArg(0), IntArg(0)));
+
+  resp = Run({"bitfield", "foo", "get", "u8", "8", "get", "u8", "0"});
+  ASSERT_THAT(resp, ArrLen(2));
+  EXPECT_THAT(resp.GetVec(), ElementsAre(IntArg(1), IntArg(2)));
+
+  // Overlapping fields observe each other in argument order.
+  resp = Run({"bitfield", "olap", "set", "u8", "0", "7", "get", "u8", "0", "incrby", "u8", "0",
+              "1"});
+  ASSERT_THAT(resp, ArrLen(3));
+  EXPECT_THAT(resp.GetVec(), ElementsAre(IntArg(0), IntArg(7), IntArg(8)));
+
+  EXPECT_THAT(Run({"bitfield_ro", "foo", "set", "u8", "0", "1"}), ErrArg("only supports"));
+  EXPECT_THAT(Run({"bitfield", "foo", "get", "u65", "0"}), ErrArg("Invalid bitfield type"));
+}
+
 }  // end of namespace dfly
@@ -4,6 +4,8 @@
 
 #include "server/blocking_controller.h"
 
+#include <absl/container/inlined_vector.h>
+
 #include <boost/smart_ptr/intrusive_ptr.hpp>
 
 extern "C" {
@@ -19,6 +21,8 @@ namespace dfly {
 using namespace std;
 
 struct WatchItem {
+  // nullptr for entries that were unwatched from the middle of the queue and await
+  // lazy removal when they reach the front.
   Transaction* trans;
 
   Transaction* get() const {
@@ -31,6 +35,11 @@ struct WatchItem {
 
 struct BlockingController::WatchQueue {
   deque<WatchItem> items;
+
+  // Number of non-cleared entries in items. Middle-of-queue removals only clear the
+  // entry in place, so items.size() may overcount.
+  size_t live = 0;
+
   TxId notify_txid = UINT64_MAX;
 
   // Updated  by both coordinator and shard threads but at different times.
@@ -41,9 +50,11 @@ struct BlockingController::WatchQueue {
     notify_txid = UINT64_MAX;
   }
 
-  auto Find(Transaction* tx) const {
-    return find_if(items.begin(), items.end(),
-                   [tx](const WatchItem& wi) { return wi.get() == tx; });
+  // Drops cleared entries from the front, so that if any live entry remains then
+  // items.front() is live.
+  void PopDead() {
+    while (!items.empty() && items.front().trans == nullptr)
+      items.pop_front();
   }
 };
 
@@ -51,6 +62,12 @@ struct BlockingController::WatchQueue {
 struct BlockingController::DbWatchTable {
   WatchQueueMap queue_map;
 
+  // Maps a blocked transaction to the queue entries it occupies, so that removing it
+  // from the middle of a queue costs O(1) instead of a scan over all the watchers.
+  // Entry pointers are stable because deques do not relocate on push_back/pop_front.
+  absl::flat_hash_map<Transaction*, absl::InlinedVector<std::pair<WatchQueue*, WatchItem*>, 4>>
+      tx_entries;
+
   // awakened keys point to blocked keys that can potentially be unblocked.
   // they reference key objects in queue_map.
   absl::flat_hash_set<base::string_view_sso> awakened_keys;
@@ -61,8 +78,56 @@ struct BlockingController::DbWatchTable {
 
   // Returns true if awakened tx was removed from the queue.
   bool UnwatchTx(string_view key, Transaction* tx);
+
+  // Returns true if trans already occupies an entry in wq.
+  bool HasEntry(Transaction* trans, const WatchQueue* wq) const;
+
+  // Records that trans occupies the entry item in wq.
+  void TrackEntry(Transaction* trans, WatchQueue* wq, WatchItem* item);
+
+  // Pops the front entry of wq, which must be live, and updates the reverse index.
+  void PopFront(WatchQueue* wq);
 };
 
+bool BlockingController::DbWatchTable::HasEntry(Transaction* trans, const WatchQueue* wq) const {
+  auto it = tx_entries.find(trans);
+  if (it == tx_entries.end())
+    return false;
+  for (const auto& entry : it->second) {
+    if (entry.first == wq)
+      return true;
+  }
+  return false;
+}
+
+void BlockingController::DbWatchTable::TrackEntry(Transaction* trans, WatchQueue* wq,
+                                                  WatchItem* item) {
+  tx_entries[trans].emplace_back(wq, item);
+  wq->live++;
+}
+
+void BlockingController::DbWatchTable::PopFront(WatchQueue* wq) {
+  Transaction* trans = wq->items.front().get();
+  DCHECK(trans);
+
+  auto it = tx_entries.find(trans);
+  DCHECK(it != tx_entries.end());
+  auto& entries = it->second;
+  for (size_t i = 0; i < entries.size(); ++i) {
+    if (entries[i].first == wq) {
+      entries[i] = entries.back();
+      entries.pop_back();
+      break;
+    }
+  }
+  if (entries.empty())
+    tx_entries.erase(it);
+
+  wq->live--;
+  wq->items.pop_front();
+  wq->PopDead();
+}
+
 bool BlockingController::DbWatchTable::UnwatchTx(string_view key, Transaction* tx) {
   auto wq_it = queue_map.find(key);
 
@@ -72,17 +137,18 @@ bool BlockingController::DbWatchTable::UnwatchTx(string_view key, Transaction* t
     return false;
 
   WatchQueue* wq = wq_it->second.get();
+  wq->PopDead();
   DCHECK(!wq->items.empty());
 
   bool res = false;
   if (wq->state == WatchQueue::ACTIVE && wq->items.front().get() == tx) {
-    wq->items.pop_front();
+    PopFront(wq);
 
     // We suspend the queue and add keys to re-verification.
     // If they are still present, this queue will be reactivated below.
     wq->state = WatchQueue::SUSPENDED;
 
-    if (!wq->items.empty())
+    if (wq->live > 0)
       awakened_keys.insert(wq_it->first);  // send for further validation.
     res = true;
   } else {
@@ -90,14 +156,25 @@ bool BlockingController::DbWatchTable::UnwatchTx(string_view key, Transaction* t
     // in suspended and we still need to clean it up.
     // the suspended item does not have to be the first one in the queue.
     // This shard has not been awakened and in case this transaction in the queue
-    // we must clean it up.
-
-    if (auto it = wq->Find(tx); it != wq->items.end()) {
-      wq->items.erase(it);
+    // we must clean it up. The reverse index locates the entry without scanning the
+    // queue, which used to stampede when many watchers of one key unwatch together.
+    if (auto it = tx_entries.find(tx); it != tx_entries.end()) {
+      auto& entries = it->second;
+      for (size_t i = 0; i < entries.size(); ++i) {
+        if (entries[i].first == wq) {
+          entries[i].second->trans = nullptr;  // cleared lazily when it reaches the front.
+          wq->live--;
+          entries[i] = entries.back();
+          entries.pop_back();
+          break;
+        }
+      }
+      if (entries.empty())
+        tx_entries.erase(it);
     }
   }
 
-  if (wq->items.empty()) {
+  if (wq->live == 0) {
     queue_map.erase(wq_it);
   }
   return res;
@@ -220,7 +297,11 @@ void BlockingController::NotifyPending() {
                             it->second.ObjType() == OBJ_STREAM))
         continue;
 
-      NotifyWatchQueue(sv_key, &wt.queue_map);
+      // Stream reads do not consume the entry that woke them, so a single XADD can serve
+      // every blocked reader at once. Lists and sorted sets pop, so their waiters must be
+      // woken one by one.
+      bool wake_all = it->second.ObjType() == OBJ_STREAM;
+      NotifyWatchQueue(sv_key, &wt, wake_all);
     }
     wt.awakened_keys.clear();
 
@@ -245,16 +326,15 @@ void BlockingController::AddWatched(ArgSlice keys, Transaction* trans) {
       res->second.reset(new WatchQueue);
     }
 
-    if (!res->second->items.empty()) {
-      Transaction* last = res->second->items.back().get();
-      DCHECK_GT(last->GetUseCount(), 0u);
+    WatchQueue* wq = res->second.get();
+
+    // Duplicate keys case. We push only once per key.
+    if (wt.HasEntry(trans, wq))
+      continue;
 
-      // Duplicate keys case. We push only once per key.
-      if (last == trans)
-        continue;
-    }
     DVLOG(2) << "Emplace " << trans->DebugId() << " to watch " << key;
-    res->second->items.emplace_back(trans);
+    wq->items.emplace_back(trans);
+    wt.TrackEntry(trans, wq, &wq->items.back());
   }
 }
 
@@ -274,21 +354,43 @@ void BlockingController::AwakeWatched(DbIndex db_index, string_view db_key) {
   }
 }
 
-// Marks the queue as active and notifies the first transaction in the queue.
-void BlockingController::NotifyWatchQueue(std::string_view key, WatchQueueMap* wqm) {
-  auto w_it = wqm->find(key);
-  CHECK(w_it != wqm->end());
+// Marks the queue as active and notifies the first transaction in the queue
+// (or all of them, see header).
+void BlockingController::NotifyWatchQueue(std::string_view key, DbWatchTable* wt, bool wake_all) {
+  auto w_it = wt->queue_map.find(key);
+  CHECK(w_it != wt->queue_map.end());
   DVLOG(1) << "Notify WQ: [" << owner_->shard_id() << "] " << key;
   WatchQueue* wq = w_it->second.get();
 
   DCHECK_EQ(wq->state, WatchQueue::SUSPENDED);
   wq->state = WatchQueue::ACTIVE;
 
-  auto& queue = wq->items;
   ShardId sid = owner_->shard_id();
 
-  do {
-    WatchItem& wi = queue.front();
+  if (wake_all) {
+    // Notify every live waiter in one pass instead of chaining wake -> finalize ->
+    // revalidate per waiter. All of them stay in the queue, like the notified head in the
+    // single-wake mode, and are removed when they finalize.
+    bool notified = false;
+    for (WatchItem& wi : wq->items) {
+      Transaction* trans = wi.get();
+      if (trans && trans->NotifySuspended(owner_->committed_txid(), sid, key)) {
+        awakened_transactions_.insert(trans);
+        notified = true;
+      }
+    }
+
+    if (notified) {
+      wq->notify_txid = owner_->committed_txid();
+      return;
+    }
+    // Everyone declined (expired or already awakened) - fall through to the pop loop
+    // that cleans up the queue.
+  }
+
+  while (wq->live > 0) {
+    wq->PopDead();
+    WatchItem& wi = wq->items.front();
     Transaction* head = wi.get();
     DVLOG(2) << "WQ-Pop " << head->DebugId() << " from key " << key;
 
@@ -300,11 +402,11 @@ void BlockingController::NotifyWatchQueue(std::string_view key, WatchQueueMap* w
       break;
     }
 
-    queue.pop_front();
-  } while (!queue.empty());
+    wt->PopFront(wq);
+  }
 
-  if (wq->items.empty()) {
-    wqm->erase(w_it);
+  if (wq->live == 0) {
+    wt->queue_map.erase(w_it);
   }
 }
 
@@ -54,7 +54,9 @@ class BlockingController {
 
   using WatchQueueMap = absl::flat_hash_map<std::string, std::unique_ptr<WatchQueue>>;
 
-  void NotifyWatchQueue(std::string_view key, WatchQueueMap* wqm);
+  // Notifies transactions waiting on key. With wake_all, every waiter is notified in one
+  // pass; otherwise only the queue head is woken and the rest follow via revalidation.
+  void NotifyWatchQueue(std::string_view key, DbWatchTable* wt, bool wake_all);
 
   // void NotifyConvergence(Transaction* tx);
 
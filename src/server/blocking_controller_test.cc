@@ -81,6 +81,31 @@ TEST_F(BlockingControllerTest, Basic) {
   });
 }
 
+TEST_F(BlockingControllerTest, UnwatchMiddle) {
+  boost::intrusive_ptr<Transaction> t2{new Transaction{&cid_, 0}};
+  boost::intrusive_ptr<Transaction> t3{new Transaction{&cid_, 0}};
+  t2->InitByArgs(0, {arg_vec_.data(), arg_vec_.size()});
+  t3->InitByArgs(0, {arg_vec_.data(), arg_vec_.size()});
+
+  shard_set->Await(0, [&] {
+    EngineShard* shard = EngineShard::tlocal();
+    BlockingController bc(shard);
+    auto keys = trans_->GetShardArgs(shard->shard_id());
+    bc.AddWatched(keys, trans_.get());
+    bc.AddWatched(keys, t2.get());
+    bc.AddWatched(keys, t3.get());
+    EXPECT_EQ(1, bc.NumWatched(0));
+
+    // Removing a watcher from the middle of the queue must not disturb the others.
+    bc.FinalizeWatched(keys, t2.get());
+    EXPECT_EQ(1, bc.NumWatched(0));
+
+    bc.FinalizeWatched(keys, trans_.get());
+    bc.FinalizeWatched(keys, t3.get());
+    EXPECT_EQ(0, bc.NumWatched(0));
+  });
+}
+
 TEST_F(BlockingControllerTest, Timeout) {
   time_point tp = steady_clock::now() + chrono::milliseconds(10);
 
@@ -11,6 +11,7 @@ extern "C" {
 }
 
 #include "base/logging.h"
+#include "facade/dragonfly_connection.h"
 #include "server/engine_shard_set.h"
 #include "server/server_state.h"
 
@@ -23,6 +24,13 @@ bool Matches(string_view pattern, string_view channel) {
   return stringmatchlen(pattern.data(), pattern.size(), channel.data(), channel.size(), 0) == 1;
 }
 
+// Returns the leading literal part of a glob pattern - the prefix that any matching channel
+// must start with. Conservatively stops at the first escape as well.
+string_view PatternPrefix(string_view pattern) {
+  size_t pos = pattern.find_first_of("*?[\\");
+  return pos == string_view::npos ? pattern : pattern.substr(0, pos);
+}
+
 }  // namespace
 
 ChannelStore::Subscriber::Subscriber(ConnectionContext* cntx, uint32_t tid)
@@ -79,6 +87,12 @@ void ChannelStore::ChannelMap::DeleteAll() {
     delete ptr.Get();
 }
 
+void ChannelStore::ChannelMap::BuildPatternIndex() {
+  prefix_index.clear();
+  for (const auto& [pattern, _] : *this)
+    prefix_index[string(PatternPrefix(pattern))].emplace_back(pattern);
+}
+
 ChannelStore::ChannelStore() : channels_{new ChannelMap{}}, patterns_{new ChannelMap{}} {
   control_block.most_recent = this;
 }
@@ -107,15 +121,69 @@ vector<ChannelStore::Subscriber> ChannelStore::FetchSubscribers(string_view chan
   if (auto it = channels_->find(channel); it != channels_->end())
     Fill(*it->second, string{}, &res);
 
-  for (const auto& [pat, subs] : *patterns_) {
-    if (Matches(pat, channel))
-      Fill(*subs, pat, &res);
+  // Only patterns whose literal prefix is a prefix of the channel can match it, so we probe
+  // the prefix index with every prefix of the channel instead of glob-matching all patterns.
+  for (size_t len = 0; len <= channel.size(); ++len) {
+    auto cand_it = patterns_->prefix_index.find(channel.substr(0, len));
+    if (cand_it == patterns_->prefix_index.end())
+      continue;
+
+    for (const string& pat : cand_it->second) {
+      if (Matches(pat, channel)) {
+        auto it = patterns_->find(pat);
+        DCHECK(it != patterns_->end());
+        Fill(*it->second, pat, &res);
+      }
+    }
   }
 
   sort(res.begin(), res.end(), Subscriber::ByThread);
   return res;
 }
 
+void ChannelStore::SendMessages(string_view channel, string_view msg,
+                                vector<Subscriber> subscribers) {
+  if (subscribers.empty())
+    return;
+
+  // Make sure neither of the subscribers buffers is filled up.
+  // This check actually doesn't reserve any memory ahead and doesn't prevent the buffer
+  // from eventually filling up, especially if multiple clients are unblocked simultaneously
+  // but is generally good enough to limit too fast producers.
+  // Most importantly, this approach allows not blocking and not awaiting in the dispatch below,
+  // thus not adding any overhead to backpressure checks.
+  for (auto& sub : subscribers)
+    sub.conn_cntx->owner()->EnsureAsyncMemoryBudget();
+
+  auto subscribers_ptr = make_shared<vector<Subscriber>>(std::move(subscribers));
+  auto buf = shared_ptr<char[]>{new char[channel.size() + msg.size()]};
+  memcpy(buf.get(), channel.data(), channel.size());
+  memcpy(buf.get() + channel.size(), msg.data(), msg.size());
+
+  // Subscribers are sorted by thread, so we dispatch a single broadcast message per
+  // proactor that has local subscribers instead of waking up the whole pool. The message
+  // payload is serialized once above and the shared buffer is enqueued to all of them.
+  size_t channel_len = channel.size(), msg_len = msg.size();
+  for (size_t start = 0; start < subscribers_ptr->size();) {
+    uint32_t tid = (*subscribers_ptr)[start].thread_id;
+    size_t end = start;
+    while (end < subscribers_ptr->size() && (*subscribers_ptr)[end].thread_id == tid)
+      end++;
+
+    auto cb = [subscribers_ptr, buf, channel_len, msg_len, start, end] {
+      for (size_t i = start; i < end; ++i) {
+        auto& sub = (*subscribers_ptr)[i];
+        facade::Connection* conn = sub.conn_cntx->owner();
+        DCHECK(conn);
+        conn->SendPubMessageAsync({std::move(sub.pattern), buf, channel_len, msg_len});
+        sub.borrow_token.Dec();
+      }
+    };
+    shard_set->pool()->at(tid)->DispatchBrief(std::move(cb));
+    start = end;
+  }
+}
+
 void ChannelStore::Fill(const SubscribeMap& src, const string& pattern, vector<Subscriber>* out) {
   out->reserve(out->size() + src.size());
   for (const auto [cntx, thread_id] : src) {
@@ -209,6 +277,11 @@ void ChannelStoreUpdater::Apply() {
   for (auto key : ops_)
     Modify(target, key);
 
+  // The set of registered patterns changes only when the map is copied (slot add/remove),
+  // so this is the only place where the prefix index can go stale.
+  if (pattern_ && copied)
+    target->BuildPatternIndex();
+
   // Prepare replacement.
   auto* replacement = store;
   if (copied) {
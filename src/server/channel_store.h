@@ -63,6 +63,12 @@ class ChannelStore {
   // Fetch all subscribers for channel, including matching patterns.
   std::vector<Subscriber> FetchSubscribers(std::string_view channel) const;
 
+  // Serialize the message payload once and dispatch it asynchronously to all given
+  // subscribers, batching them by thread. Must be called from the thread that fetched
+  // the subscribers. Does nothing for an empty subscriber list.
+  static void SendMessages(std::string_view channel, std::string_view msg,
+                           std::vector<Subscriber> subscribers);
+
   std::vector<std::string> ListChannels(const std::string_view pattern) const;
   size_t PatternCount() const;
 
@@ -101,6 +107,15 @@ class ChannelStore {
 
     // Delete all stored SubscribeMap pointers.
     void DeleteAll();
+
+    // Rebuild prefix_index from the current set of keys. Called by the updater whenever the
+    // set of registered patterns changes. Meaningful only for the patterns map.
+    void BuildPatternIndex();
+
+    // Patterns grouped by their leading literal part. Publishing consults it with the
+    // prefixes of the channel name, so matching is bounded by the channel length and the
+    // number of patterns actually sharing a prefix with it, not by the total pattern count.
+    absl::flat_hash_map<std::string, std::vector<std::string>> prefix_index;
   };
 
   // Centralized controller to prevent overlaping updates.
@@ -2,6 +2,7 @@
 
 extern "C" {
 #include "redis/crc16.h"
+#include "redis/crcspeed.h"
 }
 
 #include <jsoncons/json.hpp>
@@ -17,6 +18,28 @@ namespace dfly {
 
 bool ClusterConfig::cluster_enabled = false;
 
+namespace {
+
+// Byte-at-a-time reference used only to derive the slice-by-8 lookup tables.
+uint16_t Crc16Byte(uint16_t crc, const void* buf, uint64_t len) {
+  DCHECK_EQ(crc, 0);  // crc16 always starts from a zero seed.
+  return crc16(reinterpret_cast<const char*>(buf), len);
+}
+
+// Table-parallel crc16 that processes 8 bytes per step, cutting the per-key
+// hashing cost for pipelined multi-key commands where every key is slotted.
+uint16_t Crc16Fast(string_view data) {
+  static uint16_t tables[8][256];
+  static const int init = [] {
+    crcspeed16native_init(&Crc16Byte, tables);
+    return 0;
+  }();
+  (void)init;
+  return crcspeed16native(tables, 0, const_cast<char*>(data.data()), data.length());
+}
+
+}  // namespace
+
 string_view ClusterConfig::KeyTag(string_view key) {
   size_t start = key.find('{');
   if (start == key.npos) {
@@ -31,7 +54,7 @@ string_view ClusterConfig::KeyTag(string_view key) {
 
 SlotId ClusterConfig::KeySlot(string_view key) {
   string_view tag = KeyTag(key);
-  return crc16(tag.data(), tag.length()) & kMaxSlotNum;
+  return Crc16Fast(tag) & kMaxSlotNum;
 }
 
 namespace {
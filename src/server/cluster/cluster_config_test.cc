@@ -11,6 +11,10 @@
 #include "base/gtest.h"
 #include "base/logging.h"
 
+extern "C" {
+#include "redis/crc16.h"
+}
+
 using namespace std;
 using namespace testing;
 using Node = dfly::ClusterConfig::Node;
@@ -49,6 +53,22 @@ TEST_F(ClusterConfigTest, KeyTagTest) {
   ASSERT_EQ(key, ClusterConfig::KeyTag(key));
 }
 
+TEST_F(ClusterConfigTest, KeySlotTest) {
+  // crc16("123456789") == 0x31C3, the check value of the XMODEM variant.
+  EXPECT_EQ(0x31C3, ClusterConfig::KeySlot("123456789"));
+  EXPECT_EQ(ClusterConfig::KeySlot("user1000"), ClusterConfig::KeySlot("{user1000}.following"));
+
+  // The slice-by-8 kernel must agree with the reference byte-at-a-time crc16
+  // for all lengths around the 8-byte block boundary.
+  string key;
+  for (unsigned len = 0; len < 40; ++len) {
+    EXPECT_EQ(crc16(key.data(), key.length()) & ClusterConfig::kMaxSlotNum,
+              ClusterConfig::KeySlot(key))
+        << "len=" << len;
+    key += char('a' + len % 26);
+  }
+}
+
 TEST_F(ClusterConfigTest, ConfigSetInvalidEmpty) {
   EXPECT_EQ(ClusterConfig::CreateFromConfig(kMyId, ClusterConfig::ClusterShards{}), nullptr);
 }
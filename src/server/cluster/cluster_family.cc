@@ -5,6 +5,8 @@
 #include "server/cluster/cluster_family.h"
 
 #include <jsoncons/json.hpp>
+
+#include <algorithm>
 #include <memory>
 #include <mutex>
 #include <string>
@@ -118,6 +120,9 @@ void ClusterFamily::ClusterHelp(ConnectionContext* cntx) {
       "   <id> <ip:port> <flags> <master> <pings> <pongs> <epoch> <link> <slot> ...",
       "INFO",
       "  Return information about the cluster",
+      "SLOT-STATS [ORDERBY <metric> [LIMIT <limit>]]",
+      "   Return per-slot usage statistics (key count, reads, writes), optionally",
+      "   sorted by a metric: key-count, total-reads or total-writes.",
       "HELP",
       "    Prints this help.",
   };
@@ -346,6 +351,90 @@ void ClusterFamily::KeySlot(CmdArgList args, ConnectionContext* cntx) {
   return (*cntx)->SendLong(id);
 }
 
+void ClusterFamily::ClusterSlotStats(CmdArgList args, ConnectionContext* cntx) {
+  // CLUSTER SLOT-STATS [ORDERBY <metric> [LIMIT <limit>]]
+  uint64_t SlotStats::*metric = nullptr;
+  uint32_t limit = ClusterConfig::kMaxSlotNum + 1;
+
+  if (args.size() > 1) {
+    ToUpper(&args[1]);
+    if (ArgS(args, 1) != "ORDERBY" || args.size() < 3) {
+      return (*cntx)->SendError(kSyntaxErr, kSyntaxErrType);
+    }
+
+    ToUpper(&args[2]);
+    string_view metric_name = ArgS(args, 2);
+    if (metric_name == "KEY-COUNT") {
+      metric = &SlotStats::key_count;
+    } else if (metric_name == "TOTAL-READS") {
+      metric = &SlotStats::total_reads;
+    } else if (metric_name == "TOTAL-WRITES") {
+      metric = &SlotStats::total_writes;
+    } else {
+      return (*cntx)->SendError("Unrecognized sort metric");
+    }
+
+    if (args.size() == 5) {
+      ToUpper(&args[3]);
+      if (ArgS(args, 3) != "LIMIT" || !absl::SimpleAtoi(ArgS(args, 4), &limit)) {
+        return (*cntx)->SendError(kSyntaxErr, kSyntaxErrType);
+      }
+    } else if (args.size() != 3) {
+      return (*cntx)->SendError(kSyntaxErr, kSyntaxErrType);
+    }
+  }
+
+  if (!ClusterConfig::IsClusterEnabled()) {
+    // Emulated mode does not maintain the per-slot counters.
+    return (*cntx)->SendError("CLUSTER SLOT-STATS requires cluster mode");
+  }
+
+  vector<SlotStats> stats(ClusterConfig::kMaxSlotNum + 1);
+  Mutex mu;
+
+  auto cb = [&](auto*) {
+    EngineShard* shard = EngineShard::tlocal();
+    if (shard == nullptr)
+      return;
+
+    lock_guard lk(mu);
+    for (SlotId sid = 0; sid <= ClusterConfig::kMaxSlotNum; ++sid) {
+      stats[sid] += shard->db_slice().GetSlotStats(sid);
+    }
+  };
+
+  shard_set->pool()->AwaitFiberOnAll(std::move(cb));
+
+  // Report only slots that were actually used, the zero-filled rest carries no signal.
+  vector<SlotId> ids;
+  for (SlotId sid = 0; sid <= ClusterConfig::kMaxSlotNum; ++sid) {
+    const auto& s = stats[sid];
+    if (s.key_count > 0 || s.total_reads > 0 || s.total_writes > 0) {
+      ids.push_back(sid);
+    }
+  }
+
+  if (metric != nullptr) {
+    sort(ids.begin(), ids.end(),
+         [&stats, metric](SlotId l, SlotId r) { return stats[l].*metric > stats[r].*metric; });
+  }
+  if (ids.size() > limit) {
+    ids.resize(limit);
+  }
+
+  (*cntx)->StartArray(ids.size());
+  for (SlotId sid : ids) {
+    (*cntx)->StartArray(7);
+    (*cntx)->SendLong(sid);
+    (*cntx)->SendBulkString("key_count");
+    (*cntx)->SendLong(static_cast<long>(stats[sid].key_count));
+    (*cntx)->SendBulkString("total_reads");
+    (*cntx)->SendLong(static_cast<long>(stats[sid].total_reads));
+    (*cntx)->SendBulkString("total_writes");
+    (*cntx)->SendLong(static_cast<long>(stats[sid].total_writes));
+  }
+}
+
 void ClusterFamily::Cluster(CmdArgList args, ConnectionContext* cntx) {
   // In emulated cluster mode, all slots are mapped to the same host, and number of cluster
   // instances is thus 1.
@@ -369,22 +458,40 @@ void ClusterFamily::Cluster(CmdArgList args, ConnectionContext* cntx) {
     return ClusterInfo(cntx);
   } else if (sub_cmd == "KEYSLOT") {
     return KeySlot(args, cntx);
+  } else if (sub_cmd == "SLOT-STATS") {
+    return ClusterSlotStats(args, cntx);
   } else {
     return (*cntx)->SendError(facade::UnknownSubCmd(sub_cmd, "CLUSTER"), facade::kSyntaxErrType);
   }
 }
 
 void ClusterFamily::ReadOnly(CmdArgList args, ConnectionContext* cntx) {
-  if (!is_emulated_cluster_) {
+  if (!is_emulated_cluster_ && !ClusterConfig::IsClusterEnabled()) {
     return (*cntx)->SendError(kClusterDisabled);
   }
+
+  // READONLY [MAXLAG <seconds>]
+  // The optional extension bounds read staleness: on a replica, reads are rejected
+  // once the master link is stale for longer than the given number of seconds.
+  uint32_t max_lag = 0;
+  if (args.size() == 3) {
+    ToUpper(&args[1]);
+    if (ArgS(args, 1) != "MAXLAG" || !absl::SimpleAtoi(ArgS(args, 2), &max_lag)) {
+      return (*cntx)->SendError(kSyntaxErr, kSyntaxErrType);
+    }
+  } else if (args.size() != 1) {
+    return (*cntx)->SendError(WrongNumArgsError("READONLY"));
+  }
+
+  cntx->conn_state.replica_read_max_lag_sec = max_lag;
   (*cntx)->SendOk();
 }
 
 void ClusterFamily::ReadWrite(CmdArgList args, ConnectionContext* cntx) {
-  if (!is_emulated_cluster_) {
+  if (!is_emulated_cluster_ && !ClusterConfig::IsClusterEnabled()) {
     return (*cntx)->SendError(kClusterDisabled);
   }
+  cntx->conn_state.replica_read_max_lag_sec = 0;
   (*cntx)->SendOk();
 }
 
@@ -618,7 +725,7 @@ void ClusterFamily::Register(CommandRegistry* registry) {
   *registry << CI{"CLUSTER", CO::READONLY, -2, 0, 0, 0}.HFUNC(Cluster)
             << CI{"DFLYCLUSTER", CO::ADMIN | CO::GLOBAL_TRANS | CO::HIDDEN, -2, 0, 0, 0}.HFUNC(
                    DflyCluster)
-            << CI{"READONLY", CO::READONLY, 1, 0, 0, 0}.HFUNC(ReadOnly)
+            << CI{"READONLY", CO::READONLY, -1, 0, 0, 0}.HFUNC(ReadOnly)
             << CI{"READWRITE", CO::READONLY, 1, 0, 0, 0}.HFUNC(ReadWrite);
 }
 
@@ -514,6 +514,58 @@ TEST_F(ClusterFamilyTest, ClusterGetSlotInfo) {
                                         IntArg(1), "total_writes", IntArg(2))))));
 }
 
+TEST_F(ClusterFamilyTest, ClusterSlotStats) {
+  string config_template = R"json(
+      [
+        {
+          "slot_ranges": [
+            {
+              "start": 0,
+              "end": 16383
+            }
+          ],
+          "master": {
+            "id": "$0",
+            "ip": "10.0.0.1",
+            "port": 7000
+          },
+          "replicas": []
+        }
+      ])json";
+  string config = absl::Substitute(config_template, GetMyId());
+  EXPECT_EQ(RunAdmin({"dflycluster", "config", config}), "OK");
+
+  EXPECT_THAT(Run({"cluster", "slot-stats", "orderby"}), ErrArg("syntax error"));
+  EXPECT_THAT(Run({"cluster", "slot-stats", "orderby", "no-such-metric"}),
+              ErrArg("Unrecognized sort metric"));
+
+  constexpr string_view kHotKey = "some-key";
+  constexpr string_view kColdKey = "other-key";
+  const SlotId hot_slot = ClusterConfig::KeySlot(kHotKey);
+  const SlotId cold_slot = ClusterConfig::KeySlot(kColdKey);
+  ASSERT_NE(hot_slot, cold_slot);
+
+  EXPECT_EQ(Run({"SET", kHotKey, "value"}), "OK");
+  EXPECT_EQ(Run({"SET", kColdKey, "value"}), "OK");
+  EXPECT_EQ(Run({"GET", kHotKey}), "value");
+  EXPECT_EQ(Run({"GET", kHotKey}), "value");
+
+  EXPECT_THAT(Run({"cluster", "slot-stats", "orderby", "total-reads", "limit", "1"}),
+              RespArray(ElementsAre(RespArray(ElementsAre(IntArg(hot_slot), "key_count", IntArg(1),
+                                                          "total_reads", IntArg(2), "total_writes",
+                                                          IntArg(1))))));
+
+  EXPECT_THAT(Run({"cluster", "slot-stats"}), ArrLen(2));
+}
+
+TEST_F(ClusterFamilyTest, ReadOnlyReadWrite) {
+  EXPECT_EQ(Run({"readonly"}), "OK");
+  EXPECT_EQ(Run({"readonly", "maxlag", "5"}), "OK");
+  EXPECT_THAT(Run({"readonly", "maxlag", "not-a-number"}), ErrArg("syntax error"));
+  EXPECT_THAT(Run({"readonly", "maxlag"}), ErrArg("wrong number of arguments"));
+  EXPECT_EQ(Run({"readwrite"}), "OK");
+}
+
 TEST_F(ClusterFamilyTest, ClusterSlotsPopulate) {
   string config_template = R"json(
       [
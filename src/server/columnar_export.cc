@@ -0,0 +1,310 @@
+// Copyright 2023, DragonflyDB authors.  All rights reserved.
+// See LICENSE for licensing terms.
+//
+
+#include "server/columnar_export.h"
+
+extern "C" {
+#include "redis/listpack.h"
+#include "redis/object.h"
+#include "redis/util.h"
+}
+
+#include <absl/functional/bind_front.h>
+#include <absl/strings/str_cat.h>
+
+#include "base/endian.h"
+#include "base/flags.h"
+#include "base/logging.h"
+#include "core/json_object.h"
+#include "core/string_map.h"
+#include "server/container_utils.h"
+#include "server/engine_shard_set.h"
+#include "server/tiered_storage.h"
+
+ABSL_DECLARE_FLAG(uint32_t, serialization_flush_threshold);
+ABSL_DECLARE_FLAG(uint32_t, snapshot_txq_throttle_len);
+
+namespace dfly {
+
+using namespace std;
+using namespace util;
+using namespace chrono_literals;
+
+namespace {
+
+constexpr char kExportMagic[] = "DFEXP001";
+
+// Renders a hash value as json text, so the warehouse side parses one format for
+// both hashes and json documents.
+string HashToJson(const PrimeValue& pv, const DbContext& db_cntx) {
+  JsonType doc(jsoncons::json_object_arg);
+
+  if (pv.Encoding() == kEncodingListPack) {
+    uint8_t intbuf[2][LP_INTBUF_SIZE];
+    uint8_t* lp = (uint8_t*)pv.RObjPtr();
+    uint8_t* fptr = lpFirst(lp);
+    while (fptr) {
+      string_view field = container_utils::LpGetView(fptr, intbuf[0]);
+      fptr = lpNext(lp, fptr);
+      string_view value = container_utils::LpGetView(fptr, intbuf[1]);
+      fptr = lpNext(lp, fptr);
+      doc.insert_or_assign(field, value);
+    }
+  } else {
+    DCHECK_EQ(pv.Encoding(), kEncodingStrMap2);
+    StringMap* sm = container_utils::GetStringMap(pv, db_cntx);
+    for (const auto& k_v : *sm) {
+      doc.insert_or_assign(string_view{k_v.first, sdslen(k_v.first)},
+                           string_view{k_v.second, sdslen(k_v.second)});
+    }
+  }
+  return doc.to_string();
+}
+
+}  // namespace
+
+ColumnarExporter::ColumnarExporter(DbSlice* slice, DbIndex db_index, string pattern,
+                                   unique_ptr<io::WriteFile> file)
+    : db_slice_(slice), db_index_(db_index), pattern_(std::move(pattern)),
+      file_(std::move(file)) {
+  flush_threshold_ = absl::GetFlag(FLAGS_serialization_flush_threshold);
+  throttle_txq_len_ = absl::GetFlag(FLAGS_snapshot_txq_throttle_len);
+  db_array_ = slice->databases();
+}
+
+ColumnarExporter::~ColumnarExporter() {
+  DCHECK(!export_fb_.IsJoinable());
+}
+
+void ColumnarExporter::Start() {
+  DCHECK(!export_fb_.IsJoinable());
+
+  auto db_cb = absl::bind_front(&ColumnarExporter::OnDbChange, this);
+  snapshot_version_ = db_slice_->RegisterOnChange(std::move(db_cb));
+
+  VLOG(1) << "ColumnarExporter::Start - exporting entries with version less than "
+          << snapshot_version_;
+
+  export_fb_ = MakeFiber([this] {
+    IterateBucketsFb();
+    db_slice_->UnregisterOnChange(snapshot_version_);
+    FlushPendingExternal();
+    FlushBatch(true);
+  });
+}
+
+error_code ColumnarExporter::Finish() {
+  export_fb_.Join();
+
+  error_code close_ec = file_->Close();
+  if (!write_ec_)
+    write_ec_ = close_ec;
+  return write_ec_;
+}
+
+// Same bucket-version algorithm as SliceSnapshot::IterateBucketsFb, restricted to a
+// single database: every bucket existing at Start() is serialized exactly once, either
+// by this fiber or by the change callback that runs before a mutation reaches it.
+void ColumnarExporter::IterateBucketsFb() {
+  {
+    auto fiber_name = absl::StrCat("ColumnarExport-", ProactorBase::GetIndex());
+    ThisFiber::SetName(std::move(fiber_name));
+  }
+
+  write_ec_ = file_->Write(string_view{kExportMagic, 8});
+
+  if (db_index_ < db_array_.size() && db_array_[db_index_]) {
+    PrimeTable* pt = &db_array_[db_index_]->prime;
+    VLOG(1) << "Start export traversal of " << pt->size() << " items for index " << db_index_;
+
+    uint64_t last_yield = 0;
+    PrimeTable::Cursor cursor;
+    do {
+      if (write_ec_)
+        break;
+
+      cursor = pt->Traverse(cursor, absl::bind_front(&ColumnarExporter::BucketSaveCb, this));
+      FlushPendingExternal();
+      FlushBatch(false);
+
+      // The export is a background job: back off while the shard transaction queue
+      // is congested, same policy as SliceSnapshot::ThrottleIfNeeded.
+      if (throttle_txq_len_ > 0) {
+        constexpr chrono::microseconds kMaxPause = 10ms;
+        TxQueue* txq = db_slice_->shard_owner()->txq();
+        chrono::microseconds step = 100us, total{0};
+        while (txq->size() > throttle_txq_len_ && total < kMaxPause) {
+          ThisFiber::SleepFor(step);
+          total += step;
+          if (step < 1600us)
+            step += step;
+        }
+      }
+
+      if (rows_ >= last_yield + 100) {
+        ThisFiber::Yield();
+        last_yield = rows_;
+      }
+    } while (cursor);
+  }
+
+  VLOG(1) << "Exit ColumnarExporter fiber, exported " << rows_ << " rows, skipped "
+          << skipped_values_ << " values";
+}
+
+bool ColumnarExporter::BucketSaveCb(PrimeIterator it) {
+  if (it.GetVersion() >= snapshot_version_) {
+    // either has been already serialized or added after the export started.
+    return false;
+  }
+  db_slice_->FlushChangeToEarlierCallbacks(db_index_, it, snapshot_version_);
+  SerializeBucket(it);
+  return false;
+}
+
+unsigned ColumnarExporter::SerializeBucket(PrimeTable::bucket_iterator it) {
+  // Must be atomic: once the bucket version is bumped the change callback stops
+  // chasing it, so the whole bucket has to land in the batch in one go.
+  FiberAtomicGuard fg;
+  DCHECK_LT(it.GetVersion(), snapshot_version_);
+
+  it.SetVersion(snapshot_version_);
+  unsigned result = 0;
+
+  while (!it.is_done()) {
+    ++result;
+    SerializeEntry(it->first, it->second);
+    ++it;
+  }
+  return result;
+}
+
+void ColumnarExporter::SerializeEntry(const PrimeKey& pk, const PrimeValue& pv) {
+  string tmp;
+  string_view key = pk.GetSlice(&tmp);
+
+  if (!pattern_.empty() &&
+      stringmatchlen(pattern_.data(), pattern_.size(), key.data(), key.size(), 0) != 1)
+    return;
+
+  int64_t expire_ms = -1;
+  if (pv.HasExpire()) {
+    auto eit = db_array_[db_index_]->expire.Find(pk);
+    expire_ms = db_slice_->ExpireTime(eit);
+  }
+
+  if (pv.IsExternal()) {
+    // Only string values are offloaded. The disk read would suspend the fiber, so
+    // pin the range and defer the read to FlushPendingExternal.
+    auto [offset, size] = pv.GetExternalSlice();
+    db_slice_->shard_owner()->tiered_storage()->Pin(offset);
+    pending_external_.push_back(PendingExternal{string{key}, expire_ms, offset, size});
+    return;
+  }
+
+  switch (pv.ObjType()) {
+    case OBJ_STRING: {
+      string val;
+      pv.GetString(&val);
+      AppendRow(key, OBJ_STRING, expire_ms, val);
+      break;
+    }
+    case OBJ_HASH:
+      AppendRow(key, OBJ_HASH, expire_ms,
+                HashToJson(pv, DbContext{db_index_, GetCurrentTimeMs()}));
+      break;
+    case OBJ_JSON:
+      AppendRow(key, OBJ_JSON, expire_ms, pv.GetJson()->to_string());
+      break;
+    default:
+      ++skipped_values_;
+  }
+}
+
+void ColumnarExporter::AppendRow(string_view key, uint8_t type, int64_t expire_ms,
+                                 string_view value) {
+  char buf[8];
+
+  ++batch_.row_count;
+  batch_.types.push_back(char(type));
+  absl::little_endian::Store64(buf, uint64_t(expire_ms));
+  batch_.expires.append(buf, 8);
+  absl::little_endian::Store32(buf, key.size());
+  batch_.key_lens.append(buf, 4);
+  batch_.keys.append(key);
+  absl::little_endian::Store32(buf, value.size());
+  batch_.val_lens.append(buf, 4);
+  batch_.vals.append(value);
+
+  ++rows_;
+}
+
+void ColumnarExporter::FlushPendingExternal() {
+  if (pending_external_.empty())
+    return;
+
+  TieredStorage* tiered = db_slice_->shard_owner()->tiered_storage();
+  string blob;
+  while (!pending_external_.empty()) {
+    PendingExternal pending = std::move(pending_external_.back());
+    pending_external_.pop_back();
+
+    blob.resize(pending.size);
+    // Bypass read cache admission: the export touches every cold value once and
+    // should not evict the interactively read ones.
+    error_code ec = tiered->Read(pending.offset, pending.size, blob.data(), false);
+    CHECK(!ec) << "Failed to read tiered value for export: " << ec;
+    tiered->Unpin(pending.offset);
+
+    AppendRow(pending.key, OBJ_STRING, pending.expire_ms, blob);
+  }
+}
+
+void ColumnarExporter::FlushBatch(bool force) {
+  if (write_ec_ || batch_.row_count == 0)
+    return;
+  if (!force && batch_.bytes() < flush_threshold_)
+    return;
+
+  // Detach first: the write below suspends the fiber and change callbacks may
+  // append rows meanwhile - those belong to the next batch.
+  Batch batch;
+  std::swap(batch, batch_);
+
+  char buf[8];
+  string out;
+  out.reserve(4 + batch.bytes());
+  absl::little_endian::Store32(buf, batch.row_count);
+  out.append(buf, 4);
+  out.append(batch.types);
+  out.append(batch.expires);
+  out.append(batch.key_lens);
+  out.append(batch.keys);
+  out.append(batch.val_lens);
+  out.append(batch.vals);
+
+  write_ec_ = file_->Write(out);
+}
+
+void ColumnarExporter::OnDbChange(DbIndex db_index, const DbSlice::ChangeReq& req) {
+  if (db_index != db_index_)
+    return;
+
+  FiberAtomicGuard fg;
+  PrimeTable* table = db_slice_->GetTables(db_index).first;
+
+  if (const PrimeTable::bucket_iterator* bit = req.update()) {
+    if (bit->GetVersion() < snapshot_version_) {
+      SerializeBucket(*bit);
+    }
+  } else {
+    string_view key = get<string_view>(req.change);
+    table->CVCUponInsert(snapshot_version_, key, [this](PrimeTable::bucket_iterator it) {
+      DCHECK_LT(it.GetVersion(), snapshot_version_);
+      SerializeBucket(it);
+    });
+  }
+}
+
+}  // namespace dfly
@@ -0,0 +1,118 @@
+// Copyright 2023, DragonflyDB authors.  All rights reserved.
+// See LICENSE for licensing terms.
+//
+
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "io/file.h"
+#include "server/db_slice.h"
+
+namespace dfly {
+
+// Point-in-time columnar export of one shard, built on the same versioned bucket
+// traversal as SliceSnapshot: buckets below the export cut are serialized by the
+// traversal fiber, and a bucket that is about to be mutated is serialized by the
+// change callback first, so the output reflects exactly the dataset at Start() time
+// while foreground traffic keeps running. Instead of rdb frames the output is column
+// batches, so an analytics pipeline can scan keys, types and expirations without
+// decoding the values it does not need.
+//
+// File format (all integers little-endian), one file per shard:
+//   8 bytes magic "DFEXP001", then a sequence of batches until EOF:
+//     uint32 row count n
+//     uint8  types[n]      - redis object type codes (OBJ_STRING etc).
+//     int64  expire_ms[n]  - absolute unix time in milliseconds, -1 when persistent.
+//     uint32 key_len[n],   followed by the concatenated key bytes.
+//     uint32 value_len[n], followed by the concatenated value bytes.
+// Values are raw bytes for strings, json text for json documents and for hashes
+// (rendered as a json object). Other container types are skipped and counted in
+// skipped_values().
+class ColumnarExporter {
+ public:
+  // Exports the keys of db_index matching the glob pattern (empty - all keys).
+  // file is closed by Finish().
+  ColumnarExporter(DbSlice* slice, DbIndex db_index, std::string pattern,
+                   std::unique_ptr<io::WriteFile> file);
+  ~ColumnarExporter();
+
+  // Fixes the export cut, registers the change callback and starts the traversal
+  // fiber. Must run on the owning shard thread.
+  void Start();
+
+  // Waits for the traversal to finish, flushes the tail batch and closes the file.
+  // Must run on the owning shard thread. Returns the first write error, if any.
+  std::error_code Finish();
+
+  uint64_t rows() const {
+    return rows_;
+  }
+
+  // Keys whose value type is not exportable (lists, sets, sorted sets, streams).
+  uint64_t skipped_values() const {
+    return skipped_values_;
+  }
+
+ private:
+  // Rows accumulated since the last flush, laid out by column.
+  struct Batch {
+    uint32_t row_count = 0;
+    std::string types;  // one byte per row.
+    std::string expires, key_lens, val_lens;
+    std::string keys, vals;
+
+    size_t bytes() const {
+      return types.size() + expires.size() + key_lens.size() + val_lens.size() + keys.size() +
+             vals.size();
+    }
+  };
+
+  void IterateBucketsFb();
+  bool BucketSaveCb(PrimeIterator it);
+  unsigned SerializeBucket(PrimeTable::bucket_iterator it);
+
+  // Appends one row to batch_. Must not preempt: called from the atomic bucket
+  // serialization. Values offloaded to tiered storage are pinned and deferred to
+  // FlushPendingExternal.
+  void SerializeEntry(const PrimeKey& pk, const PrimeValue& pv);
+  void AppendRow(std::string_view key, uint8_t type, int64_t expire_ms, std::string_view value);
+
+  // Reads the deferred tiered values and appends their rows. May suspend on io.
+  void FlushPendingExternal();
+
+  // Writes out the accumulated batch if force or it crossed the flush threshold.
+  // The batch is detached first, so change callbacks appending rows while the
+  // write suspends land in the next batch. May suspend on io.
+  void FlushBatch(bool force);
+
+  // DbChange listener, same contract as SliceSnapshot::OnDbChange.
+  void OnDbChange(DbIndex db_index, const DbSlice::ChangeReq& req);
+
+  DbSlice* db_slice_;
+  DbTableArray db_array_;
+  DbIndex db_index_;
+  std::string pattern_;
+  std::unique_ptr<io::WriteFile> file_;
+
+  Batch batch_;
+  uint32_t flush_threshold_;   // cached FLAGS_serialization_flush_threshold.
+  uint32_t throttle_txq_len_;  // cached FLAGS_snapshot_txq_throttle_len.
+
+  struct PendingExternal {
+    std::string key;
+    int64_t expire_ms;
+    size_t offset, size;
+  };
+  std::vector<PendingExternal> pending_external_;
+
+  Fiber export_fb_;
+  uint64_t snapshot_version_ = 0;
+  uint64_t rows_ = 0;
+  uint64_t skipped_values_ = 0;
+  std::error_code write_ec_;
+};
+
+}  // namespace dfly
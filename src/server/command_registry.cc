@@ -6,11 +6,14 @@
 
 #include <absl/strings/str_split.h>
 
+#include <algorithm>
+
 #include "absl/strings/str_cat.h"
 #include "base/bits.h"
 #include "base/flags.h"
 #include "base/logging.h"
 #include "facade/error.h"
+#include "server/common.h"
 #include "server/conn_context.h"
 
 using namespace std;
@@ -28,6 +31,21 @@ using absl::StrAppend;
 using absl::StrCat;
 using absl::StrSplit;
 
+void ParseArgFlags(absl::Span<const ArgFlagSpec> specs, CmdArgList args, size_t* idx,
+                   uint32_t* flags) {
+  size_t i = *idx;
+  for (; i < args.size(); ++i) {
+    ToUpper(&args[i]);
+    string_view tok = ArgS(args, i);
+
+    auto it = find_if(specs.begin(), specs.end(), [&](const auto& s) { return s.name == tok; });
+    if (it == specs.end())
+      break;
+    *flags |= it->flag;
+  }
+  *idx = i;
+}
+
 CommandId::CommandId(const char* name, uint32_t mask, int8_t arity, int8_t first_key,
                      int8_t last_key, int8_t step)
     : facade::CommandId(name, mask, arity, first_key, last_key, step) {
@@ -71,6 +89,7 @@ CommandRegistry& CommandRegistry::operator<<(CommandId cmd) {
     }
     k = it->second;
   }
+  cmd.stats_index_ = next_stats_index_++;
   CHECK(cmd_map_.emplace(k, std::move(cmd)).second) << k;
 
   return *this;
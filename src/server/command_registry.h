@@ -53,6 +53,24 @@ static_assert(!IsEvalKind(""));
 
 };  // namespace CO
 
+// Declarative spec for a leading option token of a command (like "NX" in ZADD).
+// Commands with such options list them in a static table and call ParseArgFlags
+// instead of hand-rolling an if/else chain. Parsing happens on the connection
+// fiber before any shard hop, so the shard callback receives plain flag bits and
+// malformed commands fail before scheduling.
+struct ArgFlagSpec {
+  std::string_view name;  // upper-case option token.
+  uint32_t flag;          // bit(s) ORed into the result when the token is present.
+};
+
+// Parses consecutive option tokens starting at args[*idx] according to specs,
+// ORing the matching bits into *flags. Tokens are matched case-insensitively.
+// Stops at the first token that is not in specs, leaving *idx pointing at it.
+// Combination constraints (mutually exclusive flags etc.) are left to the caller,
+// which owns the command-specific error messages.
+void ParseArgFlags(absl::Span<const ArgFlagSpec> specs, CmdArgList args, size_t* idx,
+                   uint32_t* flags);
+
 class CommandId : public facade::CommandId {
  public:
   CommandId(const char* name, uint32_t mask, int8_t arity, int8_t first_key, int8_t last_key,
@@ -92,16 +110,26 @@ class CommandId : public facade::CommandId {
 
   bool IsTransactional() const;
 
+  // Dense index assigned by the registry when the command is added. Used to address
+  // per-thread flat stats arrays without hashing the command name.
+  uint32_t stats_index() const {
+    return stats_index_;
+  }
+
   static const char* OptName(CO::CommandOpt fl);
 
  private:
+  friend class CommandRegistry;
+
   Handler handler_;
   ArgValidator validator_;
+  uint32_t stats_index_ = 0;
 };
 
 class CommandRegistry {
   absl::flat_hash_map<std::string_view, CommandId> cmd_map_;
   absl::flat_hash_map<std::string, std::string> cmd_rename_map_;
+  uint32_t next_stats_index_ = 0;
 
  public:
   CommandRegistry();
@@ -118,6 +146,11 @@ class CommandRegistry {
     return it == cmd_map_.end() ? nullptr : &it->second;
   }
 
+  // Upper bound (exclusive) of the stats indices assigned so far.
+  size_t stats_size() const {
+    return next_stats_index_;
+  }
+
   using TraverseCb = std::function<void(std::string_view, const CommandId&)>;
 
   void Traverse(TraverseCb cb) {
@@ -191,14 +191,21 @@ void TriggerJournalWriteToSink() {
 #define ADD(x) (x) += o.x
 
 TieredStats& TieredStats::operator+=(const TieredStats& o) {
-  static_assert(sizeof(TieredStats) == 48);
+  static_assert(sizeof(TieredStats) == 88);
 
   ADD(tiered_reads);
   ADD(tiered_writes);
+  ADD(read_cache_hits);
   ADD(storage_capacity);
   ADD(storage_reserved);
   ADD(aborted_write_cnt);
   ADD(flush_skip_cnt);
+  ADD(defrag_relocations);
+  ADD(pending_io_ops);
+  ADD(write_latency_usec);
+
+  if (o.max_pending_io_ops > max_pending_io_ops)
+    max_pending_io_ops = o.max_pending_io_ops;
 
   return *this;
 }
@@ -225,6 +232,12 @@ OpResult<ScanOpts> ScanOpts::TryFrom(CmdArgList args) {
       scan_opts.pattern = ArgS(args, i + 1);
       if (scan_opts.pattern == "*")
         scan_opts.pattern = string_view{};
+
+      // Compile the pattern once: extract the literal prefix up to the first glob
+      // metacharacter ('\\' is treated as one conservatively because it escapes).
+      size_t lit = scan_opts.pattern.find_first_of("*?[\\");
+      scan_opts.prefix_only = (lit == string_view::npos);
+      scan_opts.prefix = scan_opts.prefix_only ? scan_opts.pattern : scan_opts.pattern.substr(0, lit);
     } else if (opt == "TYPE") {
       ToLower(&args[i + 1]);
       scan_opts.type_filter = ArgS(args, i + 1);
@@ -242,6 +255,15 @@ OpResult<ScanOpts> ScanOpts::TryFrom(CmdArgList args) {
 bool ScanOpts::Matches(std::string_view val_name) const {
   if (pattern.empty())
     return true;
+
+  // Prefix fast path - rejects most non-matching keys without running the glob matcher.
+  if (!absl::StartsWith(val_name, prefix)) {
+    return false;
+  }
+
+  if (prefix_only)  // literal pattern, the prefix is the whole match.
+    return val_name.size() == prefix.size();
+
   return stringmatchlen(pattern.data(), pattern.size(), val_name.data(), val_name.size(), 0) == 1;
 }
 
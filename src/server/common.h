@@ -49,6 +49,25 @@ class CommandId;
 class Transaction;
 class EngineShard;
 
+// Hook of a transaction into the per-shard poll inbox (see EngineShardSet::SubmitPollNode).
+// Embedded into Transaction::PerShardData so that submitting a hop to a shard requires no
+// allocation. `in_flight` is owned by the coordinator: it wins the node by flipping it to true,
+// fills `trans`/`seq` and pushes the node; the shard thread resets it after popping.
+struct TxPollNode {
+  std::atomic<TxPollNode*> next{nullptr};
+  Transaction* trans = nullptr;
+  uint32_t seq = 0;
+  std::atomic_bool in_flight{false};
+
+  friend TxPollNode* MPSC_intrusive_load_next(const TxPollNode& src) {
+    return src.next.load(std::memory_order_acquire);
+  }
+
+  friend void MPSC_intrusive_store_next(TxPollNode* dest, TxPollNode* nxt) {
+    dest->next.store(nxt, std::memory_order_release);
+  }
+};
+
 struct KeyLockArgs {
   DbIndex db_index = 0;
   ArgSlice args;
@@ -118,6 +137,7 @@ void TriggerJournalWriteToSink();
 struct TieredStats {
   size_t tiered_reads = 0;
   size_t tiered_writes = 0;
+  size_t read_cache_hits = 0;  // subset of tiered_reads served from RAM.
 
   size_t storage_capacity = 0;
 
@@ -126,6 +146,14 @@ struct TieredStats {
   size_t aborted_write_cnt = 0;
   size_t flush_skip_cnt = 0;
 
+  // values rewritten into fresh pages by the background compaction.
+  size_t defrag_relocations = 0;
+
+  // Device queue stats, see IoMgr::Stats.
+  size_t pending_io_ops = 0;
+  size_t max_pending_io_ops = 0;
+  uint64_t write_latency_usec = 0;
+
   TieredStats& operator+=(const TieredStats&);
 };
 
@@ -328,6 +356,14 @@ class Context : protected Cancellation {
 
 struct ScanOpts {
   std::string_view pattern;
+
+  // Longest literal prefix of pattern, computed once by TryFrom. Matches() rejects
+  // candidates with a plain memcmp against it before falling back to the glob matcher.
+  // If prefix_only is set the pattern has no wildcards at all and the prefix is the
+  // entire match.
+  std::string_view prefix;
+  bool prefix_only = false;
+
   size_t limit = 10;
   std::string_view type_filter;
   unsigned bucket_id = UINT_MAX;
@@ -222,4 +222,27 @@ void ConnectionState::ExecInfo::ClearWatched() {
   watched_existed = 0;
 }
 
+ShardId ConnectionState::ShardLocalityInfo::RecordHit(ShardId sid, uint32_t num_shards) {
+  DCHECK_LT(sid, num_shards);
+
+  hits.resize(num_shards);  // no-op after the first call.
+  hits[sid]++;
+
+  if (++total < kWindow)
+    return kInvalidSid;
+
+  uint32_t max_hits = 0;
+  ShardId winner = kInvalidSid;
+  for (ShardId i = 0; i < num_shards; ++i) {
+    if (hits[i] > max_hits) {
+      max_hits = hits[i];
+      winner = i;
+    }
+    hits[i] = 0;
+  }
+  total = 0;
+
+  return max_hits * 2 > kWindow ? winner : kInvalidSid;
+}
+
 }  // namespace dfly
@@ -7,6 +7,8 @@
 #include <absl/container/fixed_array.h>
 #include <absl/container/flat_hash_set.h>
 
+#include <optional>
+
 #include "core/fibers.h"
 #include "facade/conn_context.h"
 #include "facade/reply_capture.h"
@@ -92,9 +94,12 @@ struct ConnectionState {
   struct ScriptInfo {
     absl::flat_hash_set<std::string_view> keys;  // declared keys
 
+    bool read_only = false;  // the script was invoked via EVAL_RO/EVALSHA_RO
+
     size_t async_cmds_heap_mem = 0;     // bytes used by async_cmds
     size_t async_cmds_heap_limit = 0;   // max bytes allowed for async_cmds
     std::vector<StoredCmd> async_cmds;  // aggregated by acall
+    std::vector<StoredCmd> many_cmds;   // aggregated by pcall_many, replies are kept
   };
 
   // PUB-SUB messaging related data.
@@ -114,6 +119,17 @@ struct ConnectionState {
     BlockingCounter borrow_token{0};
   };
 
+  // Client-side caching (CLIENT TRACKING) related data.
+  struct TrackingInfo {
+    // io thread of the connection, captured when tracking is enabled. Tracking pins the
+    // connection to its thread (like subscriptions), so shards can dispatch to it safely.
+    uint32_t thread_id = 0;
+
+    // Counts pending invalidation messages in-flight to the io thread, so teardown can
+    // wait for them before the context is destroyed.
+    BlockingCounter borrow_token{0};
+  };
+
   struct ReplicationInfo {
     // If this server is master, and this connection is from a secondary replica,
     // then it holds positive sync session id.
@@ -123,6 +139,20 @@ struct ConnectionState {
     DflyVersion repl_version = DflyVersion::VER0;
   };
 
+  // Tracks which shards the single-shard commands of this connection hit, so that the
+  // connection can be migrated to the io thread of its dominant shard.
+  struct ShardLocalityInfo {
+    // The dominant shard is re-evaluated every such number of single-shard commands.
+    static constexpr uint32_t kWindow = 1024;
+
+    // Records a hit and, once a window completes, returns the shard that served more than
+    // half of its commands, or kInvalidSid if there is no such shard (or mid-window).
+    ShardId RecordHit(ShardId sid, uint32_t num_shards);
+
+    std::vector<uint32_t> hits;
+    uint32_t total = 0;
+  };
+
   enum MCGetMask {
     FETCH_CAS_VER = 1,
   };
@@ -133,13 +163,27 @@ struct ConnectionState {
   // For set op - it's the flag value we are storing along with the value.
   // For get op - we use it as a mask of MCGetMask values.
   uint32_t memcache_flag = 0;
+
+  // The entry version the memcached CAS command expects; 0 when the store is not a cas.
+  uint64_t memcache_cas = 0;
+
+  // For memcached GAT/GATS: the expiry in seconds to apply to the fetched keys
+  // (0 means remove the expiry). Engaged only for those commands.
+  std::optional<uint32_t> memcache_touch_sec;
   bool is_blocking = false;  // whether this connection is blocking on a command
 
+  // Bounded-staleness reads: when positive and this server is a replica, key-touching
+  // read commands are rejected once the master link is stale for more than this many
+  // seconds. Set by READONLY MAXLAG, cleared by READWRITE.
+  uint32_t replica_read_max_lag_sec = 0;
+
   ExecInfo exec_info;
   ReplicationInfo replication_info;
+  ShardLocalityInfo shard_locality;
 
   std::unique_ptr<ScriptInfo> script_info;
   std::unique_ptr<SubscribeInfo> subscribe_info;
+  std::unique_ptr<TrackingInfo> tracking_info;
 };
 
 class ConnectionContext : public facade::ConnectionContext {
@@ -157,10 +157,9 @@ StringMap* GetStringMap(const PrimeValue& pv, const DbContext& db_context) {
 }
 
 optional<string_view> LpFind(uint8_t* lp, string_view key, uint8_t int_buf[]) {
-  uint8_t* fptr = lpFirst(lp);
-  DCHECK(fptr);
-
-  fptr = lpFind(lp, fptr, (unsigned char*)key.data(), key.size(), 1);
+  // lpFindField peeks entry lengths from the encoding byte and compares candidates with
+  // wide lanes instead of fully decoding every entry like the generic lpFind.
+  uint8_t* fptr = lpFindField(lp, (unsigned char*)key.data(), key.size());
   if (!fptr)
     return std::nullopt;
   uint8_t* vptr = lpNext(lp, fptr);
@@ -293,4 +292,31 @@ OpResult<string> RunCbOnFirstNonEmptyBlocking(Transaction* trans, int req_obj_ty
   return result_key;
 }
 
+OpResult<string> RunCbOnFirstNonEmpty(Transaction* trans, int req_obj_type,
+                                      BlockingResultCb func) {
+  trans->Schedule();
+
+  OpResult<ShardFFResult> result = FindFirstNonEmptyKey(trans, req_obj_type);
+  if (!result) {
+    // cleanups, locks removal etc.
+    auto cb = [](Transaction* t, EngineShard* shard) { return OpStatus::OK; };
+    trans->Execute(std::move(cb), true);
+    return result.status();
+  }
+
+  ShardFFResult ff_result = std::move(result.value());
+
+  string result_key;
+  auto cb = [&](Transaction* t, EngineShard* shard) {
+    if (shard->shard_id() == ff_result.sid) {
+      ff_result.key.GetString(&result_key);
+      func(t, shard, result_key);
+    }
+    return OpStatus::OK;
+  };
+  trans->Execute(std::move(cb), true);
+
+  return result_key;
+}
+
 }  // namespace dfly::container_utils
@@ -93,6 +93,11 @@ using BlockingResultCb = std::function<void(Transaction*, EngineShard*, std::str
 OpResult<std::string> RunCbOnFirstNonEmptyBlocking(Transaction* trans, int req_obj_type,
                                                    BlockingResultCb cb, unsigned limit_ms);
 
+// Same as RunCbOnFirstNonEmptyBlocking, but concludes with KEY_NOTFOUND instead of blocking
+// when none of the candidate keys exist. Used by the non-blocking multi-key pops.
+OpResult<std::string> RunCbOnFirstNonEmpty(Transaction* trans, int req_obj_type,
+                                           BlockingResultCb cb);
+
 };  // namespace container_utils
 
 }  // namespace dfly
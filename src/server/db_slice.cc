@@ -4,16 +4,40 @@
 
 #include "server/db_slice.h"
 
+#include <absl/container/fixed_array.h>
+#include <absl/random/random.h>
+#include <absl/time/clock.h>
+
 extern "C" {
 #include "redis/object.h"
 }
 
+#include "base/flags.h"
 #include "base/logging.h"
+#include "core/sorted_map.h"
+#include "core/string_set.h"
+#include "facade/dragonfly_connection.h"
 #include "server/engine_shard_set.h"
 #include "server/journal/journal.h"
 #include "server/server_state.h"
 #include "server/tiered_storage.h"
 
+ABSL_FLAG(uint32_t, tracking_table_max_keys, 100000,
+          "Maximal number of keys each shard remembers for client-side caching invalidation. "
+          "When the table is full, arbitrary entries are evicted and invalidated eagerly.");
+
+ABSL_FLAG(bool, tiered_demote_on_eviction, true,
+          "When tiered storage is enabled, the eviction policy offloads cold string values to "
+          "disk instead of deleting them, and deletes only if the disk path is saturated.");
+
+ABSL_FLAG(uint32_t, lazyfree_threshold, 10000,
+          "Containers with at least this many elements are destroyed on a background fiber "
+          "instead of inline in the delete path. 0 disables asynchronous free.");
+
+ABSL_FLAG(uint32_t, access_clock_sampling, 0,
+          "If non-zero, every n-th key hit records a minutes-granularity last-access time, "
+          "exposed via OBJECT IDLETIME/FREQ and DEBUG ACCESSHIST. 0 disables the clock.");
+
 namespace dfly {
 
 using namespace std;
@@ -32,6 +56,53 @@ static_assert(kPrimeSegmentSize == 32288);
 // 24576
 static_assert(kExpireSegmentSize == 23528);
 
+// Incrementally destroys a detached big container. Runs on a background fiber of the
+// owning shard thread, releasing elements in batches with yields in between so that
+// UNLINK and expired-big-key reclamation do not stall the foreground hops.
+void LazyFreeFb(PrimeValue value) {
+  ThisFiber::SetName("lazy_free");
+
+  constexpr unsigned kClearStep = 512;  // elements released between yields.
+
+  unsigned type = value.ObjType();
+  if (type == OBJ_SET && value.Encoding() == kEncodingStrMap2) {
+    StringSet* ss = (StringSet*)value.RObjPtr();
+    unsigned budget = kClearStep;
+    while (ss->Pop()) {
+      if (--budget == 0) {
+        budget = kClearStep;
+        ThisFiber::Yield();
+      }
+    }
+  } else if (type == OBJ_ZSET && value.Encoding() == OBJ_ENCODING_SKIPLIST) {
+    detail::SortedMap* sm = (detail::SortedMap*)value.RObjPtr();
+    while (sm->Size() > 0) {
+      sm->DeleteRangeByRank(0, std::min<size_t>(kClearStep, sm->Size()) - 1);
+      ThisFiber::Yield();
+    }
+  }
+
+  // Hashes, lists and streams have no incremental removal API - they (and whatever
+  // remained above) are freed in one shot here, still off the delete hop.
+}
+
+// Detaches the value into LazyFreeFb if it is a container large enough to make its
+// inline destruction noticeable.
+void MaybeLazyFree(PrimeIterator del_it) {
+  uint32_t threshold = absl::GetFlag(FLAGS_lazyfree_threshold);
+  if (threshold == 0)
+    return;
+
+  const PrimeValue& pv = del_it->second;
+  unsigned type = pv.ObjType();
+  bool container = type == OBJ_LIST || type == OBJ_SET || type == OBJ_HASH ||
+                   type == OBJ_ZSET || type == OBJ_STREAM;
+  if (!container || pv.IsExternal() || pv.Size() < threshold)
+    return;
+
+  MakeFiber(&LazyFreeFb, std::move(del_it->second)).Detach();
+}
+
 void PerformDeletion(PrimeIterator del_it, ExpireIterator exp_it, EngineShard* shard,
                      DbTable* table) {
   if (!exp_it.is_done()) {
@@ -62,6 +133,7 @@ void PerformDeletion(PrimeIterator del_it, ExpireIterator exp_it, EngineShard* s
     table->slots_stats[sid].key_count -= 1;
   }
 
+  MaybeLazyFree(del_it);  // stats above were taken before the detach.
   table->prime.Erase(del_it);
 }
 
@@ -105,6 +177,10 @@ class PrimeEvictionPolicy {
     return evicted_;
   }
 
+  unsigned demoted() const {
+    return demoted_;
+  }
+
   unsigned checked() const {
     return checked_;
   }
@@ -116,6 +192,7 @@ class PrimeEvictionPolicy {
   const DbContext cntx_;
 
   unsigned evicted_ = 0;
+  unsigned demoted_ = 0;
   unsigned checked_ = 0;
 
   // unlike static constexpr can_evict, this parameter tells whether we can evict
@@ -177,8 +254,25 @@ unsigned PrimeEvictionPolicy::Evict(const PrimeTable::HotspotBuckets& eb, PrimeT
 
   constexpr size_t kNumStashBuckets = ABSL_ARRAYSIZE(eb.probes.by_type.stash_buckets);
 
-  // choose "randomly" a stash bucket to evict an item.
-  auto bucket_it = eb.probes.by_type.stash_buckets[eb.key_hash % kNumStashBuckets];
+  // CLOCK-style victim selection across the stash candidates: prefer a bucket whose last
+  // slot was not touched since the previous eviction attempt. Inspecting a touched candidate
+  // clears its bit, so a hot item survives only while it keeps being accessed between the
+  // attempts (the bit is set by DbSlice::FindExtInternal on cache hits).
+  unsigned chosen = eb.key_hash % kNumStashBuckets;
+  for (unsigned i = 0; i < kNumStashBuckets; ++i) {
+    unsigned idx = (eb.key_hash + i) % kNumStashBuckets;
+    auto candidate_it = eb.probes.by_type.stash_buckets[idx];
+    candidate_it += (PrimeTable::kBucketWidth - 1);
+    if (candidate_it.is_done() || candidate_it->first.IsSticky())
+      continue;
+    if (!candidate_it->first.WasTouched()) {
+      chosen = idx;
+      break;
+    }
+    candidate_it->first.SetTouched(false);
+  }
+
+  auto bucket_it = eb.probes.by_type.stash_buckets[chosen];
   auto last_slot_it = bucket_it;
   last_slot_it += (PrimeTable::kBucketWidth - 1);
   if (!last_slot_it.is_done()) {
@@ -188,6 +282,20 @@ unsigned PrimeEvictionPolicy::Evict(const PrimeTable::HotspotBuckets& eb, PrimeT
     }
 
     DbTable* table = db_slice_->GetDBTable(cntx_.db_index);
+
+    // Demote before evict: if the cold value can be offloaded, push it to tiered storage
+    // instead of dropping it. Its RAM is released once the write completes; the bucket
+    // slot stays occupied, so this is not counted as an eviction.
+    TieredStorage* tiered = db_slice_->shard_owner()->tiered_storage();
+    const PrimeValue& pv = last_slot_it->second;
+    if (tiered && absl::GetFlag(FLAGS_tiered_demote_on_eviction) &&
+        pv.ObjType() == OBJ_STRING && !pv.IsExternal() && !pv.HasIoPending() &&
+        pv.Size() >= TieredStorage::kMinBlobLen && tiered->CanScheduleOffload()) {
+      tiered->ScheduleOffload(cntx_.db_index, PrimeIterator{last_slot_it});
+      ++demoted_;
+      return 0;
+    }
+
     PerformDeletion(last_slot_it, db_slice_->shard_owner(), table);
     ++evicted_;
   }
@@ -215,9 +323,10 @@ DbStats& DbStats::operator+=(const DbStats& o) {
 }
 
 SliceEvents& SliceEvents::operator+=(const SliceEvents& o) {
-  static_assert(sizeof(SliceEvents) == 88, "You should update this function with new fields");
+  static_assert(sizeof(SliceEvents) == 96, "You should update this function with new fields");
 
   ADD(evicted_keys);
+  ADD(demoted_keys);
   ADD(hard_evictions);
   ADD(expired_keys);
   ADD(garbage_collected);
@@ -269,7 +378,10 @@ auto DbSlice::GetStats() const -> Stats {
     stats.expire_count = db_wrap.expire.size();
     stats.table_mem_usage = (db_wrap.prime.mem_usage() + db_wrap.expire.mem_usage());
   }
-  s.small_string_bytes = CompactObj::GetStats().small_string_bytes;
+  auto co_stats = CompactObj::GetStats();
+  s.small_string_bytes = co_stats.small_string_bytes;
+  s.lz4_compressed_bytes = co_stats.lz4_compressed_bytes;
+  s.lz4_raw_bytes = co_stats.lz4_raw_bytes;
 
   return s;
 }
@@ -303,13 +415,53 @@ auto DbSlice::Find(const Context& cntx, string_view key, unsigned req_obj_type)
 }
 
 pair<PrimeIterator, ExpireIterator> DbSlice::FindExt(const Context& cntx, string_view key) const {
-  pair<PrimeIterator, ExpireIterator> res;
-
   if (!IsDbValid(cntx.db_index))
-    return res;
+    return {};
+
+  auto& db = *db_arr_[cntx.db_index];
+
+  // Both tables are keyed by the same key, so the expire probe does not depend on the
+  // prime lookup result. Prefetching the expire buckets here overlaps its miss chain
+  // with the prime probe; worthwhile only when most keys are volatile, otherwise the
+  // prefetched lines are usually dead weight.
+  if (db.expire.size() * 2 >= db.prime.size())
+    db.expire.Prefetch(key);
+
+  return FindExtInternal(cntx, key, db.prime.Find(key));
+}
+
+void DbSlice::FindExtBatch(const Context& cntx, ArgSlice keys,
+                           absl::Span<pair<PrimeIterator, ExpireIterator>> dest) const {
+  DCHECK_GE(dest.size(), keys.size());
+
+  if (!IsDbValid(cntx.db_index)) {
+    std::fill_n(dest.begin(), keys.size(), pair<PrimeIterator, ExpireIterator>{});
+    return;
+  }
+
+  auto& db = *db_arr_[cntx.db_index];
+
+  // See FindExt for the rationale behind the expire prefetch.
+  if (db.expire.size() * 2 >= db.prime.size()) {
+    for (string_view key : keys)
+      db.expire.Prefetch(key);
+  }
+
+  absl::FixedArray<PrimeIterator, 16> iters(keys.size());
+  db.prime.FindBatch(absl::Span<const string_view>{keys.data(), keys.size()},
+                     absl::MakeSpan(iters));
+
+  for (size_t i = 0; i < keys.size(); ++i) {
+    dest[i] = FindExtInternal(cntx, keys[i], iters[i]);
+  }
+}
+
+pair<PrimeIterator, ExpireIterator> DbSlice::FindExtInternal(const Context& cntx, string_view key,
+                                                             PrimeIterator it) const {
+  pair<PrimeIterator, ExpireIterator> res;
 
   auto& db = *db_arr_[cntx.db_index];
-  res.first = db.prime.Find(key);
+  res.first = it;
   FiberAtomicGuard fg;
   if (!IsValid(res.first)) {
     events_.misses++;
@@ -335,11 +487,20 @@ pair<PrimeIterator, ExpireIterator> DbSlice::FindExt(const Context& cntx, string
 
     res.first = db.prime.BumpUp(res.first, PrimeBumpPolicy{});
     ++events_.bumpups;
+
+    // Feed the eviction policy: see PrimeEvictionPolicy::Evict for how the bit is consumed.
+    res.first->first.SetTouched(true);
   }
 
   events_.hits++;
   db.top_keys.Touch(key);
 
+  // Sampling keeps the common read path free of the map insert; the hit counter makes
+  // the sampling uniform without an extra rng draw.
+  if (uint32_t n = absl::GetFlag(FLAGS_access_clock_sampling); n > 0 && events_.hits % n == 0) {
+    db.RecordAccess(key, cntx.time_now_ms / 60000);
+  }
+
   if (ClusterConfig::IsClusterEnabled()) {
     db.slots_stats[ClusterConfig::KeySlot(key)].total_reads += 1;
   }
@@ -371,7 +532,10 @@ pair<PrimeIterator, bool> DbSlice::AddOrFind(const Context& cntx, string_view ke
 
 tuple<PrimeIterator, ExpireIterator, bool> DbSlice::AddOrFind2(const Context& cntx,
                                                                string_view key) noexcept(false) {
-  DCHECK(IsDbValid(cntx.db_index));
+  // The database may not exist yet: SELECT does not create tables and the quick
+  // single-key path runs without acquiring intent locks.
+  if (!IsDbValid(cntx.db_index))
+    ActivateDb(cntx.db_index);
 
   DbTable& db = *db_arr_[cntx.db_index];
 
@@ -401,13 +565,15 @@ tuple<PrimeIterator, ExpireIterator, bool> DbSlice::AddOrFind2(const Context& cn
 
   // Fast-path if change_cb_ is empty so we Find or Add using
   // the insert operation: twice more efficient.
-  CompactObj co_key{key};
+  // We pass the key as a string_view: the CompactObj key is materialized inside the
+  // bucket only if an insertion actually happens, so updates of existing keys do not
+  // construct and destroy a temporary key object (and its possible heap allocation).
   PrimeIterator it;
   bool inserted;
 
   // I try/catch just for sake of having a convenient place to set a breakpoint.
   try {
-    tie(it, inserted) = db.prime.Insert(std::move(co_key), PrimeValue{}, evp);
+    tie(it, inserted) = db.prime.Insert(key, PrimeValue{}, evp);
   } catch (bad_alloc& e) {
     VLOG(1) << "AddOrFind2: bad alloc exception, budget: " << evp.mem_budget();
     events_.insertion_rejections++;
@@ -434,6 +600,7 @@ tuple<PrimeIterator, ExpireIterator, bool> DbSlice::AddOrFind2(const Context& cn
     events_.garbage_collected = db.prime.garbage_collected();
     events_.stash_unloaded = db.prime.stash_unloaded();
     events_.evicted_keys += evp.evicted();
+    events_.demoted_keys += evp.demoted();
     events_.garbage_checked += evp.checked();
 
     it.SetVersion(NextVersion());
@@ -442,6 +609,7 @@ tuple<PrimeIterator, ExpireIterator, bool> DbSlice::AddOrFind2(const Context& cn
       SlotId sid = ClusterConfig::KeySlot(key);
       db.slots_stats[sid].key_count += 1;
     }
+    SyncDbCounters(cntx.db_index);
     return make_tuple(it, ExpireIterator{}, true);
   }
 
@@ -506,6 +674,7 @@ bool DbSlice::Del(DbIndex db_ind, PrimeIterator it) {
   }
 
   PerformDeletion(it, shard_owner(), db.get());
+  SyncDbCounters(db_ind);
 
   return true;
 }
@@ -539,6 +708,7 @@ void DbSlice::FlushSlotsFb(const SlotSet& slot_ids) {
     }
 
   } while (cursor && etl.gstate() != GlobalState::SHUTTING_DOWN);
+  SyncDbCounters(0);
   mi_heap_collect(etl.data_heap(), true);
 }
 
@@ -549,10 +719,37 @@ void DbSlice::FlushSlots(SlotSet slot_ids) {
   }).Detach();
 }
 
-void DbSlice::FlushDb(DbIndex db_ind) {
-  // TODO: to add preeemptiveness by yielding inside clear.
+void DbSlice::FlushTableFb(std::unique_ptr<DbTable> table) {
+  ThisFiber::SetName("flush_table");
+
+  if (table->stats.tiered_entries > 0) {
+    for (auto it = table->prime.begin(); it != table->prime.end(); ++it) {
+      if (it->second.IsExternal()) {
+        PerformDeletion(it, shard_owner(), table.get());
+      }
+    }
+  }
+
+  DCHECK_EQ(0u, table->stats.tiered_entries);
+
+  // Tear the tables down segment by segment, yielding in between so that a flush of a
+  // huge table does not stall the shard. pending_flush_keys_ exposes the progress.
+  table->prime.ClearStepped([this](size_t destroyed) {
+    DCHECK_LE(destroyed, pending_flush_keys_);
+    pending_flush_keys_ -= destroyed;
+    ThisFiber::Yield();
+  });
+  table->expire.ClearStepped([](size_t) { ThisFiber::Yield(); });
+
+  table.reset();
+  mi_heap_collect(ServerState::tlocal()->data_heap(), true);
+}
 
+void DbSlice::FlushDb(DbIndex db_ind) {
   if (db_ind != kDbAll) {
+    if (!IsDbValid(db_ind))  // never activated - nothing to flush.
+      return;
+
     auto& db = db_arr_[db_ind];
     if (db) {
       InvalidateDbWatches(db_ind);
@@ -563,22 +760,8 @@ void DbSlice::FlushDb(DbIndex db_ind) {
     CreateDb(db_ind);
     db_arr_[db_ind]->trans_locks.swap(db_ptr->trans_locks);
 
-    auto cb = [this, db_ptr = std::move(db_ptr)]() mutable {
-      if (db_ptr->stats.tiered_entries > 0) {
-        for (auto it = db_ptr->prime.begin(); it != db_ptr->prime.end(); ++it) {
-          if (it->second.IsExternal()) {
-            PerformDeletion(it, shard_owner(), db_ptr.get());
-          }
-        }
-      }
-
-      DCHECK_EQ(0u, db_ptr->stats.tiered_entries);
-
-      db_ptr.reset();
-      mi_heap_collect(ServerState::tlocal()->data_heap(), true);
-    };
-
-    util::MakeFiber(std::move(cb)).Detach();
+    pending_flush_keys_ += db_ptr->prime.size();
+    util::MakeFiber(&DbSlice::FlushTableFb, this, std::move(db_ptr)).Detach();
 
     return;
   }
@@ -595,21 +778,25 @@ void DbSlice::FlushDb(DbIndex db_ind) {
     if (all_dbs[i]) {
       CreateDb(i);
       db_arr_[i]->trans_locks.swap(all_dbs[i]->trans_locks);
+      pending_flush_keys_ += all_dbs[i]->prime.size();
+      util::MakeFiber(&DbSlice::FlushTableFb, this, std::move(all_dbs[i])).Detach();
     }
   }
-
-  MakeFiber([all_dbs = std::move(all_dbs)]() mutable {
-    for (auto& db : all_dbs) {
-      db.reset();
-    }
-    mi_heap_collect(ServerState::tlocal()->data_heap(), true);
-  }).Detach();
 }
 
 void DbSlice::AddExpire(DbIndex db_ind, PrimeIterator main_it, uint64_t at) {
   uint64_t delta = at - expire_base_[0];  // TODO: employ multigen expire updates.
   CHECK(db_arr_[db_ind]->expire.Insert(main_it->first.AsRef(), ExpirePeriod(delta)).second);
   main_it->second.SetExpire(true);
+  RegisterShortExpiry(db_arr_[db_ind].get(), main_it->first, at);
+}
+
+void DbSlice::RegisterShortExpiry(DbTable* table, const PrimeKey& key, uint64_t at_ms) {
+  if (!table->expire_wheel)
+    return;
+
+  std::string stash;
+  table->expire_wheel->Add(key.GetSlice(&stash), at_ms, GetCurrentTimeMs());
 }
 
 bool DbSlice::RemoveExpire(DbIndex db_ind, PrimeIterator main_it) {
@@ -690,6 +877,7 @@ OpResult<int64_t> DbSlice::UpdateExpire(const Context& cntx, PrimeIterator prime
     return -1;
   } else if (IsValid(expire_it) && !params.persist) {
     expire_it->second = FromAbsoluteTime(abs_msec);
+    RegisterShortExpiry(db_arr_[cntx.db_index].get(), prime_it->first, abs_msec);
     return abs_msec;
   } else {
     AddExpire(cntx.db_index, prime_it, abs_msec);
@@ -721,6 +909,7 @@ std::pair<PrimeIterator, bool> DbSlice::AddOrUpdateInternal(const Context& cntx,
     if (!inserted) {
       eit->second = ExpirePeriod(delta);
     }
+    RegisterShortExpiry(&db, it->first, expire_at_ms);
   }
 
   return res;
@@ -737,8 +926,6 @@ pair<PrimeIterator, bool> DbSlice::AddOrSkip(const Context& cntx, string_view ke
 }
 
 size_t DbSlice::DbSize(DbIndex db_ind) const {
-  DCHECK_LT(db_ind, db_array_size());
-
   if (IsDbValid(db_ind)) {
     return db_arr_[db_ind]->prime.size();
   }
@@ -751,6 +938,11 @@ bool DbSlice::Acquire(IntentLock::Mode mode, const KeyLockArgs& lock_args) {
   }
   DCHECK_GT(lock_args.key_step, 0u);
 
+  // SELECT does not pre-create tables anymore, so the first transaction that locks
+  // keys in this database activates it here, on the shards it actually touches.
+  if (!IsDbValid(lock_args.db_index))
+    ActivateDb(lock_args.db_index);
+
   auto& lt = db_arr_[lock_args.db_index]->trans_locks;
   bool lock_acquired = true;
 
@@ -759,6 +951,13 @@ bool DbSlice::Acquire(IntentLock::Mode mode, const KeyLockArgs& lock_args) {
   } else {
     uniq_keys_.clear();
 
+    // Issue hash-table prefetches for all the keys ahead of the acquisition loop, so that
+    // the probes below overlap their cache misses instead of paying them one by one.
+    // That matters for MSET-style transactions with hundreds of keys per shard.
+    for (size_t i = 0; i < lock_args.args.size(); i += lock_args.key_step) {
+      lt.prefetch(lock_args.args[i]);
+    }
+
     for (size_t i = 0; i < lock_args.args.size(); i += lock_args.key_step) {
       auto s = lock_args.args[i];
       if (uniq_keys_.insert(s).second) {
@@ -784,6 +983,9 @@ void DbSlice::Release(IntentLock::Mode mode, const KeyLockArgs& lock_args) {
   } else {
     auto& lt = db_arr_[lock_args.db_index]->trans_locks;
     uniq_keys_.clear();
+    for (size_t i = 0; i < lock_args.args.size(); i += lock_args.key_step) {
+      lt.prefetch(lock_args.args[i]);
+    }
     for (size_t i = 0; i < lock_args.args.size(); i += lock_args.key_step) {
       auto s = lock_args.args[i];
       if (uniq_keys_.insert(s).second) {
@@ -807,7 +1009,15 @@ bool DbSlice::CheckLock(IntentLock::Mode mode, DbIndex dbid, string_view key) co
 }
 
 bool DbSlice::CheckLock(IntentLock::Mode mode, const KeyLockArgs& lock_args) const {
+  if (!IsDbValid(lock_args.db_index))  // never activated - no locks are held.
+    return true;
+
   const auto& lt = db_arr_[lock_args.db_index]->trans_locks;
+  if (lock_args.args.size() > lock_args.key_step) {
+    for (size_t i = 0; i < lock_args.args.size(); i += lock_args.key_step) {
+      lt.prefetch(lock_args.args[i]);
+    }
+  }
   for (size_t i = 0; i < lock_args.args.size(); i += lock_args.key_step) {
     auto s = lock_args.args[i];
     auto it = lt.find(s);
@@ -820,9 +1030,18 @@ bool DbSlice::CheckLock(IntentLock::Mode mode, const KeyLockArgs& lock_args) con
 
 void DbSlice::PreUpdate(DbIndex db_ind, PrimeIterator it) {
   FiberAtomicGuard fg;
-  DVLOG(2) << "Running callbacks in dbid " << db_ind;
-  for (const auto& ccb : change_cb_) {
-    ccb.second(db_ind, ChangeReq{it});
+
+  // change_cb_ is ordered by registration version, so the newest observer is at the back.
+  // An observer registered at version V needs to see an entry only while its bucket has not
+  // been bumped past V: afterwards the bucket was already covered (serialized) by it.
+  // Gating on the newest version makes repeated updates of a hot bucket during a snapshot
+  // cost a single comparison instead of dispatching into every callback each time.
+  if (!change_cb_.empty() && it.GetVersion() < change_cb_.back().first) {
+    DVLOG(2) << "Running callbacks in dbid " << db_ind;
+    for (const auto& ccb : change_cb_) {
+      if (it.GetVersion() < ccb.first)
+        ccb.second(db_ind, ChangeReq{it});
+    }
   }
 
   size_t value_heap_size = it->second.MallocUsed();
@@ -875,11 +1094,22 @@ void DbSlice::PostUpdate(DbIndex db_ind, PrimeIterator it, std::string_view key,
     }
   }
 
+  auto& tracked_keys = db.tracked_keys;
+  if (!tracked_keys.empty()) {
+    if (auto tit = tracked_keys.find(key); tit != tracked_keys.end()) {
+      // We invalidate only once: the clients re-register the key on their next read.
+      SendTrackingMessage(key, std::move(tit->second));
+      tracked_keys.erase(tit);
+    }
+  }
+
   ++events_.update;
 
   if (ClusterConfig::IsClusterEnabled()) {
     db.slots_stats[ClusterConfig::KeySlot(key)].total_writes += 1;
   }
+
+  SyncDbCounters(db_ind);
 }
 
 pair<PrimeIterator, ExpireIterator> DbSlice::ExpireIfNeeded(const Context& cntx,
@@ -907,6 +1137,7 @@ pair<PrimeIterator, ExpireIterator> DbSlice::ExpireIfNeeded(const Context& cntx,
 
   PerformDeletion(it, expire_it, shard_owner(), db.get());
   ++events_.expired_keys;
+  SyncDbCounters(cntx.db_index);
 
   return make_pair(PrimeIterator{}, ExpireIterator{});
 }
@@ -973,23 +1204,58 @@ auto DbSlice::DeleteExpiredStep(const Context& cntx, unsigned count) -> DeleteEx
   auto& db = *db_arr_[cntx.db_index];
   DeleteExpiredStats result;
 
+  // Precise pass: drain the timer wheel slots that passed. Each entry is a hint
+  // registered when a short TTL was set, so it is re-validated against the expire
+  // table before deleting. Counted separately from the sampling stats below so that
+  // wheel hits do not skew the scan continuation heuristic.
+  unsigned wheel_traversed = 0, wheel_deleted = 0;
+  if (db.expire_wheel) {
+    db.expire_wheel->PopDue(cntx.time_now_ms, [&](std::string key) {
+      wheel_traversed++;
+
+      auto exp_it = db.expire.Find(key);
+      if (!IsValid(exp_it))  // the key was deleted or persisted since registration.
+        return;
+
+      time_t expire_time = ExpireTime(exp_it);
+      if (expire_time > time_t(cntx.time_now_ms)) {
+        // The TTL was extended after registration - hand the entry back.
+        db.expire_wheel->Add(key, expire_time, cntx.time_now_ms);
+        return;
+      }
+
+      if (!CheckLock(IntentLock::EXCLUSIVE, cntx.db_index, key))
+        return;
+
+      auto prime_it = db.prime.Find(exp_it->first);
+      CHECK(!prime_it.is_done());
+      ExpireIfNeeded(cntx, prime_it);
+      ++wheel_deleted;
+    });
+  }
+
   std::string stash;
 
   auto cb = [&](ExpireIterator it) {
-    auto key = it->first.GetSlice(&stash);
-    if (!CheckLock(IntentLock::EXCLUSIVE, cntx.db_index, key))
-      return;
-
     result.traversed++;
+
+    // Test the deadline first: surviving entries (the common case when scanning huge
+    // volatile keyspaces) are rejected with a single arithmetic check per slot, without
+    // materializing the key.
     time_t ttl = ExpireTime(it) - cntx.time_now_ms;
-    if (ttl <= 0) {
-      auto prime_it = db.prime.Find(it->first);
-      CHECK(!prime_it.is_done());
-      ExpireIfNeeded(cntx, prime_it);
-      ++result.deleted;
-    } else {
+    if (ttl > 0) {
       result.survivor_ttl_sum += ttl;
+      return;
     }
+
+    auto key = it->first.GetSlice(&stash);
+    if (!CheckLock(IntentLock::EXCLUSIVE, cntx.db_index, key))
+      return;
+
+    auto prime_it = db.prime.Find(it->first);
+    CHECK(!prime_it.is_done());
+    ExpireIfNeeded(cntx, prime_it);
+    ++result.deleted;
   };
 
   unsigned i = 0;
@@ -997,26 +1263,89 @@ auto DbSlice::DeleteExpiredStep(const Context& cntx, unsigned count) -> DeleteEx
     db.expire_cursor = db.expire.Traverse(db.expire_cursor, cb);
   }
 
-  // continue traversing only if we had strong deletion rate based on the first sample.
+  // continue traversing only if we had strong deletion rate based on the first sample,
+  // bounded by a wall-clock deadline so a single tick can not stall the shard fiber.
   if (result.deleted * 4 > result.traversed) {
+    constexpr int64_t kTimeBudgetNs = 200'000;  // 200usec per step.
+    int64_t deadline_ns = absl::GetCurrentTimeNanos() + kTimeBudgetNs;
+
     for (; i < count; ++i) {
       db.expire_cursor = db.expire.Traverse(db.expire_cursor, cb);
+      if ((i & 7) == 7 && absl::GetCurrentTimeNanos() > deadline_ns)
+        break;
     }
   }
 
+  result.traversed += wheel_traversed;
+  result.deleted += wheel_deleted;
+
   return result;
 }
 
-// TODO: Design a better background evicting heuristic.
 void DbSlice::FreeMemWithEvictionStep(DbIndex db_ind, size_t increase_goal_bytes) {
-  if (!caching_mode_)
+  if (!caching_mode_ || owner_->IsReplica())
+    return;
+
+  DbTable* table = db_arr_[db_ind].get();
+  if (!table || table->prime.size() == 0)
     return;
+
+  size_t used_memory_start = owner_->UsedMemory();
+  auto freed_memory_fun = [&] {
+    size_t current = owner_->UsedMemory();
+    return current < used_memory_start ? used_memory_start - current : 0;
+  };
+
+  // Sample random slots and evict the cold ones until the goal is reached. The touch bit
+  // gives a recently accessed entry a second chance, same as the insertion-path eviction.
+  constexpr unsigned kMaxAttempts = 128;
+  absl::InsecureBitGen gen;
+  unsigned evicted = 0;
+  string stash;
+
+  for (unsigned i = 0; i < kMaxAttempts && freed_memory_fun() < increase_goal_bytes; ++i) {
+    PrimeIterator it = table->prime.SampleUniform(gen);
+    if (it.is_done())
+      break;
+    if (it->first.IsSticky())
+      continue;
+
+    if (it->first.WasTouched()) {
+      it->first.SetTouched(false);
+      continue;
+    }
+
+    string_view key = it->first.GetSlice(&stash);
+    if (!CheckLock(IntentLock::EXCLUSIVE, db_ind, key))
+      continue;
+
+    PerformDeletion(it, shard_owner(), table);
+    ++evicted;
+  }
+
+  if (evicted) {
+    events_.evicted_keys += evicted;
+    SyncDbCounters(db_ind);
+    DVLOG(1) << "FreeMemWithEvictionStep evicted " << evicted << " keys, freed "
+             << freed_memory_fun() << " bytes";
+  }
 }
 
 void DbSlice::CreateDb(DbIndex db_ind) {
   auto& db = db_arr_[db_ind];
   if (!db) {
     db.reset(new DbTable{owner_->memory_resource()});
+    SyncDbCounters(db_ind);  // also zeroes the counters of a flushed database.
+  }
+}
+
+void DbSlice::SyncDbCounters(DbIndex db_ind) const {
+  const DbTable* table = db_ind < db_arr_.size() ? db_arr_[db_ind].get() : nullptr;
+  if (table) {
+    EngineShardSet::SetCachedDbStats(shard_id_, db_ind, table->prime.size(),
+                                     table->stats.obj_memory_usage);
+  } else {
+    EngineShardSet::SetCachedDbStats(shard_id_, db_ind, 0, 0);
   }
 }
 
@@ -1108,6 +1437,7 @@ size_t DbSlice::EvictObjects(size_t memory_to_free, PrimeIterator it, DbTable* t
 
 void DbSlice::RegisterWatchedKey(DbIndex db_indx, std::string_view key,
                                  ConnectionState::ExecInfo* exec_info) {
+  ActivateDb(db_indx);  // WATCH may be the first operation that touches the database.
   db_arr_[db_indx]->watched_keys[key].push_back(exec_info);
 }
 
@@ -1123,6 +1453,52 @@ void DbSlice::UnregisterConnectionWatches(ConnectionState::ExecInfo* exec_info)
   }
 }
 
+void DbSlice::TrackKey(DbIndex db_indx, std::string_view key, ConnectionContext* cntx) {
+  auto& tracked_keys = db_arr_[db_indx]->tracked_keys;
+
+  uint32_t max_keys = absl::GetFlag(FLAGS_tracking_table_max_keys);
+  if (tracked_keys.size() >= max_keys && !tracked_keys.contains(key)) {
+    // The table is full. Evict an arbitrary entry, but invalidate it eagerly so that its
+    // clients do not keep serving a stale value for a key we no longer remember.
+    auto evict_it = tracked_keys.begin();
+    SendTrackingMessage(evict_it->first, std::move(evict_it->second));
+    tracked_keys.erase(evict_it);
+  }
+
+  tracked_keys[key].insert(cntx);
+}
+
+void DbSlice::UnregisterConnectionTracking(ConnectionContext* cntx) {
+  for (auto& db : db_arr_) {
+    if (!db)
+      continue;
+    for (auto it = db->tracked_keys.begin(); it != db->tracked_keys.end();) {
+      it->second.erase(cntx);
+      if (it->second.empty())
+        db->tracked_keys.erase(it++);
+      else
+        ++it;
+    }
+  }
+}
+
+void DbSlice::SendTrackingMessage(std::string_view key,
+                                  absl::flat_hash_set<ConnectionContext*> conns) {
+  // May run in a non-preemptable context (PostUpdate), so the messages are dispatched
+  // asynchronously to the io threads of the tracking connections, mirroring pub/sub fan-out.
+  for (ConnectionContext* cntx : conns) {
+    auto* tracking_info = cntx->conn_state.tracking_info.get();
+    DCHECK(tracking_info);
+
+    tracking_info->borrow_token.Inc();
+    auto cb = [cntx, token = tracking_info->borrow_token, msg = string(key)]() mutable {
+      cntx->owner()->SendInvalidationMessageAsync({std::move(msg)});
+      token.Dec();
+    };
+    shard_set->pool()->at(tracking_info->thread_id)->DispatchBrief(std::move(cb));
+  }
+}
+
 void DbSlice::InvalidateDbWatches(DbIndex db_indx) {
   for (const auto& [key, conn_list] : db_arr_[db_indx]->watched_keys) {
     for (auto conn_ptr : conn_list) {
@@ -36,6 +36,9 @@ struct SliceEvents {
   // Number of eviction events.
   size_t evicted_keys = 0;
 
+  // keys pushed to tiered storage instead of being evicted.
+  size_t demoted_keys = 0;
+
   // evictions that were performed when we have a negative memory budget.
   size_t hard_evictions = 0;
   size_t expired_keys = 0;
@@ -67,6 +70,8 @@ class DbSlice {
     std::vector<DbStats> db_stats;
     SliceEvents events;
     size_t small_string_bytes = 0;
+    size_t lz4_compressed_bytes = 0;
+    size_t lz4_raw_bytes = 0;
   };
 
   using Context = DbContext;
@@ -137,6 +142,13 @@ class DbSlice {
     return bytes_per_object_;
   }
 
+  // Number of keys of flushed tables that still await background teardown. Non zero
+  // right after FLUSHDB/FLUSHALL on a large instance, drains back to zero as the
+  // destruction fiber progresses.
+  size_t pending_flush_keys() const {
+    return pending_flush_keys_;
+  }
+
   // returns absolute time of the expiration.
   time_t ExpireTime(ExpireIterator it) const {
     return it.is_done() ? 0 : expire_base_[0] + it->second.duration_ms();
@@ -152,6 +164,13 @@ class DbSlice {
   // Returns (value, expire) dict entries if key exists, null if it does not exist or has expired.
   std::pair<PrimeIterator, ExpireIterator> FindExt(const Context& cntx, std::string_view key) const;
 
+  // Batched version of FindExt. Fills dest[i] with the lookup result of keys[i].
+  // Uses the prime table's prefetch-pipelined batch lookup, so for multi-key reads (MGET)
+  // the dependent cache misses of the individual probes overlap.
+  // Requires: dest has at least keys.size() entries.
+  void FindExtBatch(const Context& cntx, ArgSlice keys,
+                    absl::Span<std::pair<PrimeIterator, ExpireIterator>> dest) const;
+
   // Returns (iterator, args-index) if found, KEY_NOTFOUND otherwise.
   // If multiple keys are found, returns the first index in the ArgSlice.
   OpResult<std::pair<PrimeIterator, unsigned>> FindFirst(const Context& cntx, ArgSlice args,
@@ -202,6 +221,9 @@ class DbSlice {
   uint32_t GetMCFlag(DbIndex db_ind, const PrimeKey& key) const;
 
   // Creates a database with index `db_ind`. If such database exists does nothing.
+  // SELECT does not call this anymore: tables are activated lazily by the first
+  // operation that actually touches the database on this shard, so mostly-idle
+  // logical databases cost no table memory.
   void ActivateDb(DbIndex db_ind);
 
   bool Del(DbIndex db_ind, PrimeIterator it);
@@ -226,6 +248,7 @@ class DbSlice {
     return shard_id_;
   }
 
+  // Acquires intent locks for the keys. Activates the database on first use.
   bool Acquire(IntentLock::Mode m, const KeyLockArgs& lock_args);
 
   void Release(IntentLock::Mode m, const KeyLockArgs& lock_args);
@@ -249,7 +272,7 @@ class DbSlice {
   }
 
   DbTable* GetDBTable(DbIndex id) {
-    return db_arr_[id].get();
+    return id < db_arr_.size() ? db_arr_[id].get() : nullptr;
   }
 
   std::pair<PrimeTable*, ExpireTable*> GetTables(DbIndex id) {
@@ -319,6 +342,14 @@ class DbSlice {
   // Unregisted all watched key entries for connection.
   void UnregisterConnectionWatches(ConnectionState::ExecInfo* exec_info);
 
+  // Registers a connection with CLIENT TRACKING enabled as interested in invalidation
+  // messages for key. Called from the shard thread of the read operation.
+  void TrackKey(DbIndex db_indx, std::string_view key, ConnectionContext* cntx);
+
+  // Unregisters all tracked key entries for connection. Called on every shard when a
+  // tracking connection closes or turns tracking off.
+  void UnregisterConnectionTracking(ConnectionContext* cntx);
+
   void SetDocDeletionCallback(DocDeletionCallback ddcb);
 
   // Resets the event counter for updates/insertions
@@ -333,17 +364,41 @@ class DbSlice {
                                                      PrimeValue obj, uint64_t expire_at_ms,
                                                      bool force_update) noexcept(false);
 
+  // Registers the key in the table's expiry timer wheel if the wheel is enabled and
+  // the deadline falls within its horizon.
+  void RegisterShortExpiry(DbTable* table, const PrimeKey& key, uint64_t at_ms);
+
+  // Runs on a detached fiber spawned by FlushDb: tears the flushed table down
+  // segment-by-segment, yielding between segments and updating pending_flush_keys_.
+  void FlushTableFb(std::unique_ptr<DbTable> table);
+
+  // Shared tail of FindExt/FindExtBatch: hit/miss accounting, expiry check and cache bump
+  // for an iterator returned by the prime-table probe.
+  std::pair<PrimeIterator, ExpireIterator> FindExtInternal(const Context& cntx,
+                                                           std::string_view key,
+                                                           PrimeIterator it) const;
+
   void FlushSlotsFb(const SlotSet& slot_ids);
 
   // Invalidate all watched keys in database. Used on FLUSH.
   void InvalidateDbWatches(DbIndex db_indx);
 
+  // Pushes an invalidation message for key to all connections in conns. Dispatches
+  // asynchronously to the io threads, so it is safe to call from a non-preemptable context.
+  void SendTrackingMessage(std::string_view key, absl::flat_hash_set<ConnectionContext*> conns);
+
   // Invalidate all watched keys for given slots. Used on FlushSlots.
   void InvalidateSlotWatches(const SlotSet& slot_ids);
 
   void CreateDb(DbIndex index);
   size_t EvictObjects(size_t memory_to_free, PrimeIterator it, DbTable* table);
 
+  // Publishes the current key count and object memory of db_ind to the cross-thread
+  // per-db counters (see EngineShardSet::GetCachedDbStats). Called from the mutation
+  // choke points - insertion, PostUpdate, deletion and flush - so coordinator threads
+  // always see up-to-date per-db stats without a hop to the shard fiber.
+  void SyncDbCounters(DbIndex db_ind) const;
+
   uint64_t NextVersion() {
     return version_++;
   }
@@ -361,6 +416,7 @@ class DbSlice {
   ssize_t memory_budget_ = SSIZE_MAX;
   size_t bytes_per_object_ = 0;
   size_t soft_budget_limit_ = 0;
+  size_t pending_flush_keys_ = 0;  // see pending_flush_keys().
 
   mutable SliceEvents events_;  // we may change this even for const operations.
 
@@ -3,14 +3,24 @@
 //
 #include "server/debugcmd.h"
 
+extern "C" {
+#include "redis/listpack.h"
+#include "redis/object.h"
+#include "redis/sds.h"
+}
+
 #include <absl/cleanup/cleanup.h>
 #include <absl/random/random.h>
 #include <absl/strings/str_cat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
 
 #include <filesystem>
 
 #include "base/flags.h"
 #include "base/logging.h"
+#include "core/sorted_map.h"
+#include "core/string_set.h"
 #include "server/blocking_controller.h"
 #include "server/engine_shard_set.h"
 #include "server/error.h"
@@ -25,6 +35,8 @@ using namespace std;
 ABSL_DECLARE_FLAG(string, dir);
 ABSL_DECLARE_FLAG(string, dbfilename);
 ABSL_DECLARE_FLAG(bool, df_snapshot_format);
+ABSL_DECLARE_FLAG(int32_t, list_max_listpack_size);
+ABSL_DECLARE_FLAG(int32_t, list_compress_depth);
 
 namespace dfly {
 
@@ -59,29 +71,103 @@ struct ObjInfo {
   bool found = false;
 };
 
-void DoPopulateBatch(std::string_view prefix, size_t val_size, bool random_value_str,
-                     const SetCmd::SetParams& params, const PopulateBatch& batch) {
-  DbContext db_cntx{batch.dbid, 0};
-  OpArgs op_args(EngineShard::tlocal(), 0, db_cntx);
-  SetCmd sg(op_args, false);
+string GeneratePopulateValue(absl::InsecureBitGen* gen, uint64_t index,
+                             const DebugCmd::PopulateOptions& options) {
+  size_t val_size = options.val_size;
+  if (options.val_size_max > options.val_size_min) {
+    val_size = absl::Uniform(*gen, options.val_size_min, options.val_size_max + 1);
+  }
+
+  if (options.populate_random_values) {
+    return GetRandomHex(*gen, val_size);
+  }
+
+  string val = absl::StrCat("value:", index);
+  if (val.size() < val_size) {
+    val.resize(val_size, 'x');
+  }
+  return val;
+}
+
+// Must run on a shard thread since containers are allocated on the shard data heap.
+PrimeValue GeneratePopulateObj(absl::InsecureBitGen* gen, uint64_t index,
+                               const DebugCmd::PopulateOptions& options) {
+  using ObjType = DebugCmd::PopulateOptions::ObjType;
+  PrimeValue pv;
+
+  switch (options.type) {
+    case ObjType::STRING:
+      pv.SetString(GeneratePopulateValue(gen, index, options));
+      break;
+    case ObjType::LIST: {
+      robj* o = createQuicklistObject();
+      quicklist* ql = (quicklist*)o->ptr;
+      quicklistSetOptions(ql, GetFlag(FLAGS_list_max_listpack_size),
+                          GetFlag(FLAGS_list_compress_depth));
+      for (unsigned i = 0; i < options.elements; ++i) {
+        string val = GeneratePopulateValue(gen, index, options);
+        quicklistPush(ql, val.data(), val.size(), QUICKLIST_TAIL);
+      }
+      pv.ImportRObj(o);
+      break;
+    }
+    case ObjType::SET: {
+      StringSet* ss = new StringSet{CompactObj::memory_resource()};
+      for (unsigned i = 0; i < options.elements; ++i) {
+        // The serial suffix keeps members unique when values are not random.
+        ss->Add(absl::StrCat(GeneratePopulateValue(gen, index, options), ":", i));
+      }
+      pv.InitRobj(OBJ_SET, kEncodingStrMap2, ss);
+      break;
+    }
+    case ObjType::HASH: {
+      uint8_t* lp = lpNew(0);
+      for (unsigned i = 0; i < options.elements; ++i) {
+        string field = absl::StrCat("field:", i);
+        string val = GeneratePopulateValue(gen, index, options);
+        lp = lpAppend(lp, (const uint8_t*)field.data(), field.size());
+        lp = lpAppend(lp, (const uint8_t*)val.data(), val.size());
+      }
+      pv.InitRobj(OBJ_HASH, kEncodingListPack, lp);
+      break;
+    }
+    case ObjType::ZSET: {
+      detail::SortedMap* zs = new detail::SortedMap;
+      for (unsigned i = 0; i < options.elements; ++i) {
+        string member = absl::StrCat(GeneratePopulateValue(gen, index, options), ":", i);
+        zs->Insert(double(i), sdsnewlen(member.data(), member.size()));
+      }
+      pv.InitRobj(OBJ_ZSET, OBJ_ENCODING_SKIPLIST, zs);
+      break;
+    }
+  }
+
+  return pv;
+}
+
+void DoPopulateBatch(const DebugCmd::PopulateOptions& options, const PopulateBatch& batch) {
+  auto& db_slice = EngineShard::tlocal()->db_slice();
+  db_slice.ActivateDb(batch.dbid);  // we bypass the transaction queue that activates lazily.
+  DbContext db_cntx{batch.dbid, GetCurrentTimeMs()};
 
   absl::InsecureBitGen gen;
   for (unsigned i = 0; i < batch.sz; ++i) {
-    string key = absl::StrCat(prefix, ":", batch.index[i]);
-    string val;
+    string key = absl::StrCat(options.prefix, ":", batch.index[i]);
 
-    if (random_value_str) {
-      val = GetRandomHex(gen, val_size);
-    } else {
-      val = absl::StrCat("value:", batch.index[i]);
-      if (val.size() < val_size) {
-        val.resize(val_size, 'x');
-      }
+    uint64_t expire_at_ms = 0;
+    if (options.expire_ttl_ratio > 0 && absl::Uniform(gen, 0u, 100u) < options.expire_ttl_ratio) {
+      expire_at_ms = db_cntx.time_now_ms + 1000 * absl::Uniform(gen, 1u, options.expire_ttl_sec + 1);
     }
 
-    auto res = sg.Set(params, key, val);
-    if (!res) {
-      LOG_EVERY_N(WARNING, 10'000) << "Debug populate failed to set value. Status:" << res.status();
+    PrimeValue pv = GeneratePopulateObj(&gen, batch.index[i], options);
+
+    // We insert directly into the table, bypassing the transaction queue. DEBUG POPULATE runs
+    // on otherwise idle servers, and for large datasets this is orders of magnitude faster
+    // than scheduling each batch as a transaction. Existing keys are skipped.
+    try {
+      db_slice.AddOrSkip(db_cntx, key, std::move(pv), expire_at_ms);
+    } catch (bad_alloc&) {
+      LOG_EVERY_N(WARNING, 10'000) << "Debug populate failed to add key " << key;
       return;
     }
   }
@@ -110,12 +196,32 @@ void DebugCmd::Run(CmdArgList args) {
         "    Return sync id and array of number of journal commands executed for each replica flow",
         "WATCHED",
         "    Shows the watched keys as a result of BLPOP and similar operations.",
-        "POPULATE <count> [<prefix>] [<size>] [RAND] [SLOTS start end]",
-        "    Create <count> string keys named key:<num> with value value:<num>.",
+        "SHARDLATENCY",
+        "    Prints per-shard histograms (usec) of tx queue wait and hop run times.",
+        "ACCESSHIST",
+        "    Prints an idle-time histogram over the keys sampled by the access clock",
+        "    (--access_clock_sampling), for sizing cold data before enabling tiering.",
+        "STALLS",
+        "    Prints the recent transaction hops that exceeded --shard_stall_threshold_ms,",
+        "    per shard, with the offending command, first key and duration.",
+        "TRACE",
+        "    Dumps and clears the transaction phase records collected with",
+        "    --tx_trace_sample_rate, ordered by timestamp.",
+        "PERF",
+        "    Maps each proactor thread to its OS thread id and role (shard/io),",
+        "    for splitting perf profiles by thread.",
+        "POPULATE <count> [<prefix>] [<size>] [RAND] [TYPE type] [ELEMENTS elements]",
+        "         [TTL ratio seconds] [SIZERANGE min max] [SLOTS start end]",
+        "    Create <count> keys named key:<num> with value value:<num>.",
         "    If <prefix> is specified then it is used instead of the 'key' prefix.",
         "    If <size> is specified then X character is concatenated multiple times to value:<num>",
         "    to meet value size.",
         "    If RAND is specified then value will be set to random hex string in specified size.",
+        "    If TYPE is specified (LIST, SET, HASH or ZSET) then container keys are created",
+        "    with ELEMENTS members each (10 by default).",
+        "    If TTL is specified then <ratio> percent of the keys get a random expiry",
+        "    of up to <seconds> seconds.",
+        "    If SIZERANGE is specified then value sizes are drawn uniformly from [min, max].",
         "    If SLOTS is specified then create keys only in given slots range."
         "HELP",
         "    Prints this help.",
@@ -154,6 +260,26 @@ void DebugCmd::Run(CmdArgList args) {
     return TxAnalysis();
   }
 
+  if (subcmd == "SHARDLATENCY") {
+    return ShardLatency();
+  }
+
+  if (subcmd == "ACCESSHIST") {
+    return AccessHist();
+  }
+
+  if (subcmd == "STALLS") {
+    return Stalls();
+  }
+
+  if (subcmd == "TRACE") {
+    return Trace();
+  }
+
+  if (subcmd == "PERF") {
+    return Perf();
+  }
+
   string reply = UnknownSubCmd(subcmd, "DEBUG");
   return (*cntx_)->SendError(reply, kSyntaxErrType);
 }
@@ -255,7 +381,7 @@ void DebugCmd::Load(string_view filename) {
 }
 
 optional<DebugCmd::PopulateOptions> DebugCmd::ParsePopulateArgs(CmdArgList args) {
-  if (args.size() < 2 || args.size() > 8) {
+  if (args.size() < 2) {
     (*cntx_)->SendError(UnknownSubCmd("populate", "DEBUG"));
     return nullopt;
   }
@@ -282,6 +408,47 @@ optional<DebugCmd::PopulateOptions> DebugCmd::ParsePopulateArgs(CmdArgList args)
     std::string_view str = ArgS(args, index);
     if (str == "RAND") {
       options.populate_random_values = true;
+    } else if (str == "TYPE") {
+      if (args.size() < index + 2) {
+        (*cntx_)->SendError(kSyntaxErr);
+        return nullopt;
+      }
+      ToUpper(&args[++index]);
+      string_view type_str = ArgS(args, index);
+      if (type_str == "STRING") {
+        options.type = PopulateOptions::ObjType::STRING;
+      } else if (type_str == "LIST") {
+        options.type = PopulateOptions::ObjType::LIST;
+      } else if (type_str == "SET") {
+        options.type = PopulateOptions::ObjType::SET;
+      } else if (type_str == "HASH") {
+        options.type = PopulateOptions::ObjType::HASH;
+      } else if (type_str == "ZSET") {
+        options.type = PopulateOptions::ObjType::ZSET;
+      } else {
+        (*cntx_)->SendError(kSyntaxErr);
+        return nullopt;
+      }
+    } else if (str == "ELEMENTS") {
+      if (args.size() < index + 2 || !absl::SimpleAtoi(ArgS(args, ++index), &options.elements) ||
+          options.elements == 0) {
+        (*cntx_)->SendError(kSyntaxErr);
+        return nullopt;
+      }
+    } else if (str == "TTL") {
+      if (args.size() < index + 3 || !absl::SimpleAtoi(ArgS(args, ++index), &options.expire_ttl_ratio) ||
+          !absl::SimpleAtoi(ArgS(args, ++index), &options.expire_ttl_sec) ||
+          options.expire_ttl_ratio > 100 || options.expire_ttl_sec == 0) {
+        (*cntx_)->SendError(kSyntaxErr);
+        return nullopt;
+      }
+    } else if (str == "SIZERANGE") {
+      if (args.size() < index + 3 || !absl::SimpleAtoi(ArgS(args, ++index), &options.val_size_min) ||
+          !absl::SimpleAtoi(ArgS(args, ++index), &options.val_size_max) ||
+          options.val_size_min > options.val_size_max) {
+        (*cntx_)->SendError(kSyntaxErr);
+        return nullopt;
+      }
     } else if (str == "SLOTS") {
       if (args.size() < index + 3) {
         (*cntx_)->SendError(kSyntaxErr);
@@ -362,7 +529,6 @@ void DebugCmd::PopulateRangeFiber(uint64_t from, uint64_t num_of_keys,
   DbIndex db_indx = cntx_->db_index();
   EngineShardSet& ess = *shard_set;
   std::vector<PopulateBatch> ps(ess.size(), PopulateBatch{db_indx});
-  SetCmd::SetParams params;
 
   uint64_t index = from;
   uint64_t to = from + num_of_keys;
@@ -398,8 +564,7 @@ void DebugCmd::PopulateRangeFiber(uint64_t from, uint64_t num_of_keys,
 
     if (shard_batch.sz == 32) {
       ess.Add(sid, [=] {
-        DoPopulateBatch(options.prefix, options.val_size, options.populate_random_values, params,
-                        shard_batch);
+        DoPopulateBatch(options, shard_batch);
         if (index % 50 == 0) {
           ThisFiber::Yield();
         }
@@ -410,10 +575,8 @@ void DebugCmd::PopulateRangeFiber(uint64_t from, uint64_t num_of_keys,
     }
   }
 
-  ess.AwaitRunningOnShardQueue([&](EngineShard* shard) {
-    DoPopulateBatch(options.prefix, options.val_size, options.populate_random_values, params,
-                    ps[shard->shard_id()]);
-  });
+  ess.AwaitRunningOnShardQueue(
+      [&](EngineShard* shard) { DoPopulateBatch(options, ps[shard->shard_id()]); });
 }
 
 void DebugCmd::Inspect(string_view key) {
@@ -423,6 +586,9 @@ void DebugCmd::Inspect(string_view key) {
 
   auto cb = [&]() -> ObjInfo {
     auto& db_slice = EngineShard::tlocal()->db_slice();
+    if (!db_slice.IsDbValid(cntx_->db_index()))
+      return ObjInfo{};
+
     auto [pt, exp_t] = db_slice.GetTables(cntx_->db_index());
 
     PrimeIterator it = pt->Find(key);
@@ -513,6 +679,133 @@ void DebugCmd::Watched() {
   (*cntx_)->SendStringArr(watched_keys);
 }
 
+void DebugCmd::ShardLatency() {
+  vector<string> queue_wait(shard_set->size()), run(shard_set->size());
+
+  shard_set->RunBlockingInParallel([&](EngineShard* shard) {
+    queue_wait[shard->shard_id()] = shard->queue_wait_hist().ToString();
+    run[shard->shard_id()] = shard->run_hist().ToString();
+  });
+
+  (*cntx_)->StartArray(shard_set->size());
+  for (ShardId sid = 0; sid < shard_set->size(); ++sid) {
+    (*cntx_)->StartArray(3);
+    (*cntx_)->SendBulkString(StrCat("shard", sid));
+    (*cntx_)->SendBulkString(StrCat("queue_wait:\n", queue_wait[sid]));
+    (*cntx_)->SendBulkString(StrCat("run:\n", run[sid]));
+  }
+}
+
+void DebugCmd::Stalls() {
+  vector<deque<EngineShard::StallIncident>> incidents(shard_set->size());
+
+  shard_set->RunBlockingInParallel([&](EngineShard* shard) {
+    incidents[shard->shard_id()] = shard->stall_incidents();
+  });
+
+  (*cntx_)->StartArray(shard_set->size());
+  for (ShardId sid = 0; sid < shard_set->size(); ++sid) {
+    string resp = StrCat("shard", sid, "\n");
+    // Newest incidents last, matching insertion order.
+    for (const auto& inc : incidents[sid]) {
+      StrAppend(&resp, inc.ts_ms / 1000, ".", absl::Dec(inc.ts_ms % 1000, absl::kZeroPad3), " ",
+                inc.command, " tx:", inc.txid, " duration:", inc.duration_usec, "us\n");
+    }
+    (*cntx_)->SendBulkString(resp);
+  }
+}
+
+void DebugCmd::AccessHist() {
+  constexpr unsigned kBuckets = 16;  // the last bucket collects idle >= ~11 days.
+  constexpr uint32_t kMinMask = (1u << DbTable::kAccessMinBits) - 1;
+  const uint32_t now_min = (GetCurrentTimeMs() / 60000) & kMinMask;
+  const DbIndex db_index = cntx_->db_index();
+
+  vector<array<uint64_t, kBuckets>> dist(shard_set->size());
+  vector<size_t> total_keys(shard_set->size(), 0);
+
+  shard_set->RunBlockingInParallel([&](EngineShard* shard) {
+    auto& shard_dist = dist[shard->shard_id()];
+    shard_dist.fill(0);
+    DbTable* table = shard->db_slice().GetDBTable(db_index);
+    if (!table)
+      return;
+
+    total_keys[shard->shard_id()] = table->prime.size();
+    for (const auto& [fp, packed] : table->access_clock) {
+      // The clock stores minutes modulo 2^kAccessMinBits, so subtract modulo as well.
+      uint32_t idle_min = (now_min - (packed & kMinMask)) & kMinMask;
+      unsigned bucket = idle_min ? 32 - __builtin_clz(idle_min) : 0;
+      ++shard_dist[min(bucket, kBuckets - 1)];
+    }
+  });
+
+  array<uint64_t, kBuckets> merged;
+  merged.fill(0);
+  uint64_t sampled = 0, keys = 0;
+  for (ShardId sid = 0; sid < shard_set->size(); ++sid) {
+    keys += total_keys[sid];
+    for (unsigned i = 0; i < kBuckets; ++i) {
+      merged[i] += dist[sid][i];
+      sampled += dist[sid][i];
+    }
+  }
+
+  string resp = StrCat("keys: ", keys, " sampled: ", sampled, "\n");
+  for (unsigned i = 0; i < kBuckets; ++i) {
+    if (i + 1 < kBuckets)
+      StrAppend(&resp, "idle < ", 1u << i, "m: ", merged[i], "\n");
+    else
+      StrAppend(&resp, "idle >= ", 1u << (i - 1), "m: ", merged[i], "\n");
+  }
+  (*cntx_)->SendBulkString(resp);
+}
+
+void DebugCmd::Trace() {
+  Mutex mu;
+
+  // (timestamp, formatted line) pairs collected from all threads.
+  vector<pair<uint64_t, string>> events;
+
+  shard_set->pool()->AwaitFiberOnAll([&](unsigned index, ProactorBase* base) {
+    auto local = ServerState::tlocal()->DrainTxTrace();
+
+    lock_guard lk(mu);
+    for (const auto& ev : local) {
+      events.emplace_back(ev.ts_ns, StrCat(ev.ts_ns / 1000, " [", index, "] ", ev.name, "/",
+                                           ev.tx_id, " ", ev.phase));
+    }
+  });
+
+  sort(events.begin(), events.end());
+
+  vector<string> lines;
+  lines.reserve(events.size());
+  for (auto& ev : events)
+    lines.push_back(std::move(ev.second));
+
+  (*cntx_)->SendStringArr(lines);
+}
+
+void DebugCmd::Perf() {
+  // perf splits samples by OS thread id, but the thread layout is decided at runtime.
+  // Report which tid runs which proactor and whether it hosts a shard, so that profiles
+  // can be filtered into shard work vs connection/background work.
+  vector<string> lines(shard_set->pool()->size());
+
+  shard_set->pool()->AwaitFiberOnAll([&](unsigned index, ProactorBase* base) {
+    string line = StrCat("tid ", syscall(SYS_gettid), " proactor ", index);
+    if (EngineShard* shard = EngineShard::tlocal(); shard) {
+      StrAppend(&line, " shard ", shard->shard_id());
+    } else {
+      StrAppend(&line, " io");
+    }
+    lines[index] = std::move(line);
+  });
+
+  (*cntx_)->SendStringArr(lines);
+}
+
 void DebugCmd::TxAnalysis() {
   atomic_uint32_t queue_len{0}, free_cnt{0}, armed_cnt{0};
 
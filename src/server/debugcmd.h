@@ -13,17 +13,31 @@ class EngineShardSet;
 class ServerFamily;
 
 class DebugCmd {
- private:
+ public:
   struct PopulateOptions {
     uint64_t total_count = 0;
     std::string_view prefix{"key"};
     uint32_t val_size = 0;
     bool populate_random_values = false;
 
+    // TYPE option. Containers are created with `elements` members each.
+    enum class ObjType : uint8_t { STRING, LIST, SET, HASH, ZSET };
+    ObjType type = ObjType::STRING;
+    uint32_t elements = 10;
+
+    // TTL option: expire_ttl_ratio percent of the keys are created with a random ttl
+    // of up to expire_ttl_sec seconds.
+    uint32_t expire_ttl_ratio = 0;
+    uint32_t expire_ttl_sec = 0;
+
+    // SIZERANGE option: if val_size_max > val_size_min, each value size is drawn uniformly
+    // from [val_size_min, val_size_max] instead of being fixed at val_size.
+    uint32_t val_size_min = 0;
+    uint32_t val_size_max = 0;
+
     std::optional<ClusterConfig::SlotRange> slot_range;
   };
 
- public:
   DebugCmd(ServerFamily* owner, ConnectionContext* cntx);
 
   void Run(CmdArgList args);
@@ -38,6 +52,11 @@ class DebugCmd {
   void Inspect(std::string_view key);
   void Watched();
   void TxAnalysis();
+  void ShardLatency();
+  void AccessHist();
+  void Stalls();
+  void Trace();
+  void Perf();
 
   ServerFamily& sf_;
   ConnectionContext* cntx_;
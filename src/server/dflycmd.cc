@@ -7,6 +7,7 @@
 #include <absl/strings/str_cat.h>
 #include <absl/strings/strip.h>
 
+#include <chrono>
 #include <limits>
 #include <optional>
 #include <utility>
@@ -23,6 +24,7 @@
 #include "server/rdb_save.h"
 #include "server/script_mgr.h"
 #include "server/server_family.h"
+#include "server/snapshot_fanout.h"
 #include "server/server_state.h"
 #include "server/transaction.h"
 using namespace std;
@@ -112,7 +114,7 @@ void DflyCmd::Run(CmdArgList args, ConnectionContext* cntx) {
     return Thread(args, cntx);
   }
 
-  if (sub_cmd == "FLOW" && args.size() == 4) {
+  if (sub_cmd == "FLOW" && (args.size() == 4 || args.size() == 5)) {
     return Flow(args, cntx);
   }
 
@@ -250,6 +252,15 @@ void DflyCmd::Flow(CmdArgList args, ConnectionContext* cntx) {
     return rb->SendError(facade::kInvalidIntErr);
   }
 
+  std::optional<LSN> replica_lsn;
+  if (args.size() == 5) {
+    LSN lsn;
+    if (!absl::SimpleAtoi(ArgS(args, 4), &lsn)) {
+      return rb->SendError(facade::kInvalidIntErr);
+    }
+    replica_lsn = lsn;
+  }
+
   auto [sync_id, replica_ptr] = GetReplicaInfoOrReply(sync_id_str, rb);
   if (!sync_id)
     return;
@@ -266,13 +277,22 @@ void DflyCmd::Flow(CmdArgList args, ConnectionContext* cntx) {
   absl::InsecureBitGen gen;
   string eof_token = GetRandomHex(gen, 40);
 
-  cntx->replication_flow = &replica_ptr->flows[flow_id];
-  replica_ptr->flows[flow_id].conn = cntx->owner();
-  replica_ptr->flows[flow_id].eof_token = eof_token;
+  FlowInfo* flow = &replica_ptr->flows[flow_id];
+  cntx->replication_flow = flow;
+  flow->conn = cntx->owner();
+  flow->eof_token = eof_token;
   cntx->owner()->Migrate(shard_set->pool()->at(flow_id));
 
+  // We run on the flow's shard thread from here on, so the partial sync decision and
+  // the backlog streaming start are atomic with respect to new journal writes.
+  string_view sync_type = "FULL";
+  if (replica_lsn &&
+      StartPartialSyncInThread(flow, &replica_ptr->cntx, EngineShard::tlocal(), *replica_lsn)) {
+    sync_type = "PARTIAL";
+  }
+
   rb->StartArray(2);
-  rb->SendSimpleString("FULL");
+  rb->SendSimpleString(sync_type);
   rb->SendSimpleString(eof_token);
 }
 
@@ -307,8 +327,12 @@ void DflyCmd::Sync(CmdArgList args, ConnectionContext* cntx) {
       return rb->SendError(kInvalidState);
   }
 
-  LOG(INFO) << "Started full sync with replica " << replica_ptr->address << ":"
-            << replica_ptr->listening_port;
+  bool partial = true;
+  for (const FlowInfo& flow : replica_ptr->flows)
+    partial &= flow.start_partial_sync_at.has_value();
+
+  LOG(INFO) << "Started " << (partial ? "partial" : "full") << " sync with replica "
+            << replica_ptr->address << ":" << replica_ptr->listening_port;
 
   replica_ptr->state.store(SyncState::FULL_SYNC, memory_order_relaxed);
   return rb->SendOk();
@@ -458,25 +482,75 @@ void DflyCmd::ReplicaOffset(CmdArgList args, ConnectionContext* cntx) {
   }
 }
 
+bool DflyCmd::StartPartialSyncInThread(FlowInfo* flow, Context* cntx, EngineShard* shard, LSN lsn) {
+  journal::Journal* journal = shard ? shard->journal() : nullptr;
+  if (!journal || !journal->HasBacklog(lsn))
+    return false;
+
+  flow->start_partial_sync_at = lsn;
+
+  // Seeding the streamer with the backlog and registering its journal listener do not
+  // preempt in between, and journal writes happen only on this thread, so the resumed
+  // stream is gapless.
+  flow->streamer.reset(new JournalStreamer(sf_->journal(), cntx));
+  flow->streamer->Start(flow->conn->socket(), journal->GetBacklog(lsn));
+
+  flow->cleanup = [flow]() {
+    flow->TryShutdownSocket();
+    if (flow->streamer) {
+      flow->streamer->Cancel();
+    }
+  };
+
+  return true;
+}
+
 OpStatus DflyCmd::StartFullSyncInThread(FlowInfo* flow, Context* cntx, EngineShard* shard) {
   DCHECK(!flow->full_sync_fb.IsJoinable());
   DCHECK(shard);
 
+  // Partial sync flows started streaming the journal backlog during FLOW already and
+  // have no snapshot phase.
+  if (flow->start_partial_sync_at)
+    return OpStatus::OK;
+
   // The summary contains the LUA scripts, so make sure at least (and exactly one)
   // of the flows also contain them.
   SaveMode save_mode =
       shard->shard_id() == 0 ? SaveMode::SINGLE_SHARD_WITH_SUMMARY : SaveMode::SINGLE_SHARD;
   flow->saver.reset(new RdbSaver(flow->conn->socket(), save_mode, false));
 
+  sf_->journal()->StartInThread();
+
+  if (SnapshotFanout::Enabled() && shard != nullptr) {
+    flow->fanout = SnapshotFanout::Attach(shard, &flow->fanout_consumer_id);
+  }
+
+  if (flow->fanout) {
+    // The body is served by the shard's shared snapshot pass; the saver only
+    // writes this flow's header. Unblock the fiber before cancelling the
+    // fan-out consumer - it might be suspended mid-write into the socket.
+    flow->cleanup = [flow]() {
+      flow->TryShutdownSocket();
+      flow->fanout->CancelConsumer(flow->fanout_consumer_id);
+      flow->full_sync_fb.JoinIfNeeded();
+      flow->fanout.reset();
+      flow->saver.reset();
+    };
+
+    flow->full_sync_fb = MakeFiber(&DflyCmd::FanoutFullSyncFb, this, flow, cntx);
+    return OpStatus::OK;
+  }
+
+  // Shut the socket down before cancelling the saver: the snapshot streams
+  // into it directly and might be suspended mid-write.
   flow->cleanup = [flow]() {
-    flow->saver->Cancel();
     flow->TryShutdownSocket();
+    flow->saver->Cancel();
     flow->full_sync_fb.JoinIfNeeded();
     flow->saver.reset();
   };
 
-  sf_->journal()->StartInThread();
-
   // Shard can be null for io thread.
   if (shard != nullptr) {
     flow->saver->StartSnapshotInShard(true, cntx->GetCancellation(), shard);
@@ -487,6 +561,23 @@ OpStatus DflyCmd::StartFullSyncInThread(FlowInfo* flow, Context* cntx, EngineSha
 }
 
 void DflyCmd::StopFullSyncInThread(FlowInfo* flow, EngineShard* shard) {
+  // Nothing to stop for partial sync flows - they never had a snapshot phase.
+  if (flow->start_partial_sync_at)
+    return;
+
+  if (flow->fanout) {
+    // Cut this flow's view of the shared pass; its fiber drains the spill tail,
+    // writes the flow's journal offset with the epilog and exits. The fan-out
+    // itself stops once its last flow detached.
+    flow->fanout->Detach(flow->fanout_consumer_id);
+    flow->full_sync_fb.JoinIfNeeded();
+
+    flow->fanout.reset();
+    flow->cleanup = []() {};
+    flow->saver.reset();
+    return;
+  }
+
   // Shard can be null for io thread.
   if (shard != nullptr) {
     flow->saver->StopSnapshotInShard(shard);
@@ -501,6 +592,10 @@ void DflyCmd::StopFullSyncInThread(FlowInfo* flow, EngineShard* shard) {
 }
 
 OpStatus DflyCmd::StartStableSyncInThread(FlowInfo* flow, Context* cntx, EngineShard* shard) {
+  // Partial sync flows are streaming since FLOW and registered their cleanup there.
+  if (flow->start_partial_sync_at)
+    return OpStatus::OK;
+
   // Create streamer for shard flows.
 
   if (shard != nullptr) {
@@ -519,10 +614,7 @@ OpStatus DflyCmd::StartStableSyncInThread(FlowInfo* flow, Context* cntx, EngineS
   return OpStatus::OK;
 }
 
-void DflyCmd::FullSyncFb(FlowInfo* flow, Context* cntx) {
-  error_code ec;
-  RdbSaver* saver = flow->saver.get();
-
+error_code DflyCmd::SaveFlowHeader(RdbSaver* saver) {
   if (saver->Mode() == SaveMode::SUMMARY || saver->Mode() == SaveMode::SINGLE_SHARD_WITH_SUMMARY) {
     auto scripts = sf_->script_mgr()->GetAll();
     StringVec script_bodies;
@@ -532,12 +624,17 @@ void DflyCmd::FullSyncFb(FlowInfo* flow, Context* cntx) {
       string& body = data.orig_body.empty() ? data.body : data.orig_body;
       script_bodies.push_back(move(body));
     }
-    ec = saver->SaveHeader(script_bodies);
-  } else {
-    ec = saver->SaveHeader({});
+    return saver->SaveHeader(script_bodies);
   }
+  return saver->SaveHeader({});
+}
 
-  if (ec) {
+void DflyCmd::FullSyncFb(FlowInfo* flow, Context* cntx) {
+  ThisFiber::SetName("full_sync");
+  error_code ec;
+  RdbSaver* saver = flow->saver.get();
+
+  if (ec = SaveFlowHeader(saver); ec) {
     cntx->ReportError(ec);
     return;
   }
@@ -554,6 +651,37 @@ void DflyCmd::FullSyncFb(FlowInfo* flow, Context* cntx) {
   }
 }
 
+void DflyCmd::FanoutFullSyncFb(FlowInfo* flow, Context* cntx) {
+  ThisFiber::SetName("fanout_full_sync");
+
+  // The header stays per flow - scripts might change between two replicas
+  // attaching to the same shared pass.
+  error_code ec = SaveFlowHeader(flow->saver.get());
+  if (!ec)
+    ec = flow->saver->FlushHeader();
+
+  if (ec) {
+    // Never streamed: leave the shared pass explicitly so it can stop once its
+    // other consumers are done.
+    flow->fanout->RemoveConsumer(flow->fanout_consumer_id);
+    cntx->ReportError(ec);
+    return;
+  }
+
+  // Blocks until the flow is detached at STARTSTABLE; ends with this flow's
+  // journal offset and the rdb epilog.
+  if (ec = flow->fanout->StreamBody(flow->fanout_consumer_id, flow->conn->socket()); ec) {
+    cntx->ReportError(ec);
+    return;
+  }
+
+  ec = flow->conn->socket()->Write(io::Buffer(flow->eof_token));
+  if (ec) {
+    cntx->ReportError(ec);
+    return;
+  }
+}
+
 auto DflyCmd::CreateSyncSession(ConnectionContext* cntx)
     -> std::pair<uint32_t, std::shared_ptr<ReplicaInfo>> {
   unique_lock lk(mu_);
@@ -709,6 +837,49 @@ std::map<uint32_t, LSN> DflyCmd::ReplicationLags() const {
   return rv;
 }
 
+size_t DflyCmd::NumAckedReplicas(const std::vector<LSN>& watermarks) const {
+  size_t acked = 0;
+  for (const auto& [id, info] : replica_infos_) {
+    if (info->state.load(memory_order_relaxed) != SyncState::STABLE_SYNC)
+      continue;
+
+    bool caught_up = true;
+    for (size_t sid = 0; sid < watermarks.size(); ++sid) {
+      if (info->flows[sid].last_acked_lsn < watermarks[sid]) {
+        caught_up = false;
+        break;
+      }
+    }
+    acked += caught_up;
+  }
+  return acked;
+}
+
+size_t DflyCmd::WaitReplicas(size_t num_replicas, uint64_t timeout_ms) {
+  // Capture the journal LSN of each shard at the moment of the call. A replica counts as
+  // acknowledged once every one of its flows acked at least its shard's watermark, so writes
+  // that happen after WAIT was issued do not delay the caller.
+  std::vector<LSN> watermarks(shard_set->size(), 0);
+  shard_set->RunBriefInParallel([&watermarks](EngineShard* shard) {
+    if (shard->journal())
+      watermarks[shard->shard_id()] = shard->journal()->GetLsn();
+  });
+
+  size_t acked = 0;
+  auto pred = [&]() {
+    lock_guard lk(mu_);
+    acked = NumAckedReplicas(watermarks);
+    return acked >= num_replicas;
+  };
+
+  if (timeout_ms == 0) {
+    ack_ec_.await(pred);
+  } else {
+    ack_ec_.await_until(pred, chrono::steady_clock::now() + chrono::milliseconds(timeout_ms));
+  }
+  return acked;
+}
+
 bool DflyCmd::CheckReplicaStateOrReply(const ReplicaInfo& sync_info, SyncState expected,
                                        RedisReplyBuilder* rb) {
   if (sync_info.state != expected) {
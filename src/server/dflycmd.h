@@ -8,6 +8,7 @@
 
 #include <atomic>
 #include <memory>
+#include <optional>
 
 #include "server/conn_context.h"
 
@@ -25,6 +26,7 @@ class EngineShardSet;
 class ServerFamily;
 class RdbSaver;
 class JournalStreamer;
+class SnapshotFanout;
 struct ReplicaRoleInfo;
 
 // Stores information related to a single flow.
@@ -43,6 +45,15 @@ struct FlowInfo {
 
   uint64_t last_acked_lsn;
 
+  // Engaged for partial syncs: the LSN the replica presented in FLOW and from which the
+  // journal backlog is streamed. Such flows skip the snapshot phase entirely.
+  std::optional<LSN> start_partial_sync_at;
+
+  // Engaged when the full sync body is served from the shard's shared snapshot pass
+  // instead of a private saver pass, see SnapshotFanout.
+  std::shared_ptr<SnapshotFanout> fanout;
+  uint32_t fanout_consumer_id = 0;
+
   std::function<void()> cleanup;  // Optional cleanup for cancellation.
 };
 
@@ -130,6 +141,18 @@ class DflyCmd {
 
   std::vector<ReplicaRoleInfo> GetReplicasRoleInfo();
 
+  // Blocks the calling fiber until at least num_replicas stable-sync replicas have acknowledged
+  // all journal entries recorded up to the moment of the call, or until timeout_ms milliseconds
+  // pass (0 means block indefinitely). Returns the number of replicas that caught up.
+  // Implements the blocking part of the WAIT command.
+  size_t WaitReplicas(size_t num_replicas, uint64_t timeout_ms);
+
+  // Wakes up fibers blocked in WaitReplicas. Called when a replica acknowledges progress via
+  // REPLCONF ACK. Cheap when no one waits - acks carry no extra cost on the common path.
+  void NotifyReplicaAck() {
+    ack_ec_.notifyAll();
+  }
+
  private:
   // JOURNAL [START/STOP]
   // Start or stop journaling.
@@ -139,8 +162,11 @@ class DflyCmd {
   // Return connection thread index or migrate to another thread.
   void Thread(CmdArgList args, ConnectionContext* cntx);
 
-  // FLOW <masterid> <syncid> <flowid>
+  // FLOW <masterid> <syncid> <flowid> [<lsn>]
   // Register connection as flow for sync session.
+  // The optional lsn requests a partial sync: when the journal backlog of the flow's
+  // shard still reaches back to it, the master replies PARTIAL and streams the journal
+  // from that lsn right away, skipping the snapshot phase for this flow.
   void Flow(CmdArgList args, ConnectionContext* cntx);
 
   // SYNC <syncid>
@@ -166,6 +192,12 @@ class DflyCmd {
   // Start full sync in thread. Start FullSyncFb. Called for each flow.
   facade::OpStatus StartFullSyncInThread(FlowInfo* flow, Context* cntx, EngineShard* shard);
 
+  // Try to start a partial sync for the flow: seed a streamer with the journal backlog
+  // from the given lsn and register it atomically. Runs on the flow's shard thread
+  // during FLOW handling. Returns false if the backlog no longer reaches back to lsn,
+  // in which case the flow proceeds with a full sync.
+  bool StartPartialSyncInThread(FlowInfo* flow, Context* cntx, EngineShard* shard, LSN lsn);
+
   // Stop full sync in thread. Run state switch cleanup.
   void StopFullSyncInThread(FlowInfo* flow, EngineShard* shard);
 
@@ -175,6 +207,13 @@ class DflyCmd {
   // Fiber that runs full sync for each flow.
   void FullSyncFb(FlowInfo* flow, Context* cntx);
 
+  // Fiber that runs full sync for a flow attached to the shared snapshot pass of its
+  // shard: per-flow header, shared body from the fan-out, per-flow eof token.
+  void FanoutFullSyncFb(FlowInfo* flow, Context* cntx);
+
+  // Write the per-flow rdb header, including lua scripts for saver modes with a summary.
+  std::error_code SaveFlowHeader(RdbSaver* saver);
+
   // Main entrypoint for stopping replication.
   void StopReplication(uint32_t sync_id);
 
@@ -196,6 +235,10 @@ class DflyCmd {
   // between the master's LSN and the last acknowledged LSN in over all shards.
   std::map<uint32_t, LSN> ReplicationLags() const;
 
+  // Count the stable-sync replicas whose flows all acknowledged at least the given per-shard
+  // LSN watermarks. Must be called under mu_.
+  size_t NumAckedReplicas(const std::vector<LSN>& watermarks) const;
+
  private:
   ServerFamily* sf_;  // Not owned
 
@@ -207,6 +250,8 @@ class DflyCmd {
   ReplicaInfoMap replica_infos_;
 
   Mutex mu_;  // Guard global operations. See header top for locking levels.
+
+  EventCount ack_ec_;  // Notified on replica acks, awaited by WaitReplicas.
 };
 
 }  // namespace dfly
@@ -3,25 +3,34 @@
 //
 
 extern "C" {
+#include "redis/object.h"
 #include "redis/sds.h"
 #include "redis/zmalloc.h"
 }
 
+#include <absl/container/flat_hash_map.h>
 #include <absl/strings/ascii.h>
+#include <absl/strings/numbers.h>
 #include <absl/strings/str_join.h>
+#include <absl/strings/str_split.h>
 #include <absl/strings/strip.h>
 #include <gmock/gmock.h>
 
+#include "base/endian.h"
 #include "base/flags.h"
 #include "base/gtest.h"
 #include "base/logging.h"
 #include "facade/facade_test.h"
+#include "io/file_util.h"
 #include "server/conn_context.h"
 #include "server/main_service.h"
 #include "server/test_utils.h"
 
 ABSL_DECLARE_FLAG(float, mem_defrag_threshold);
 ABSL_DECLARE_FLAG(std::vector<std::string>, rename_command);
+ABSL_DECLARE_FLAG(uint32_t, tx_trace_sample_rate);
+ABSL_DECLARE_FLAG(bool, enable_top_keys_tracking);
+ABSL_DECLARE_FLAG(bool, expire_timer_wheel);
 
 namespace dfly {
 
@@ -64,6 +73,22 @@ class SingleThreadDflyEngineTest : public BaseFamilyTest {
 
 class DefragDflyEngineTest : public SingleThreadDflyEngineTest {};
 
+class HotKeysDflyEngineTest : public DflyEngineTest {
+ protected:
+  HotKeysDflyEngineTest() {
+    // Must be set before SetUp() since DbTable reads the flag at construction.
+    absl::SetFlag(&FLAGS_enable_top_keys_tracking, true);
+  }
+};
+
+class TimerWheelDflyEngineTest : public DflyEngineTest {
+ protected:
+  TimerWheelDflyEngineTest() {
+    // Must be set before SetUp() since DbTable reads the flag at construction.
+    absl::SetFlag(&FLAGS_expire_timer_wheel, true);
+  }
+};
+
 // TODO: to implement equivalent parsing in redis parser.
 TEST_F(DflyEngineTest, Sds) {
   int argc;
@@ -117,6 +142,32 @@ TEST_F(DflyRenameCommandTest, RenameCommand) {
   ASSERT_THAT(resp, ErrArg("unknown command ``"));
 }
 
+TEST_F(DflyEngineTest, FlushallBackground) {
+  for (unsigned i = 0; i < 2000; ++i) {
+    Run({"set", absl::StrCat("key", i), "val"});
+  }
+  ASSERT_EQ(2000, CheckedInt({"dbsize"}));
+
+  ASSERT_EQ(Run({"flushall"}), "OK");
+
+  // The swap is synchronous even though the old table is destroyed in the background.
+  ASSERT_EQ(0, CheckedInt({"dbsize"}));
+  EXPECT_EQ(Run({"set", "key1", "val2"}), "OK");
+  EXPECT_EQ(Run({"get", "key1"}), "val2");
+
+  auto resp = Run({"info", "memory"});
+  EXPECT_THAT(resp.GetString(), HasSubstr("pending_flush_keys:"));
+}
+
+TEST_F(DflyEngineTest, InfoCommandStats) {
+  Run({"set", "foo", "bar"});
+  Run({"get", "foo"});
+
+  auto resp = Run({"info", "commandstats"});
+  EXPECT_THAT(resp.GetString(), HasSubstr("cmdstat_set:calls="));
+  EXPECT_THAT(resp.GetString(), HasSubstr("cmdstat_get:calls="));
+}
+
 TEST_F(SingleThreadDflyEngineTest, GlobalSingleThread) {
   Run({"set", "a", "1"});
   Run({"move", "a", "1"});
@@ -307,6 +358,58 @@ TEST_F(DflyEngineTest, Memcache) {
   EXPECT_THAT(resp, ElementsAre("END"));
 }
 
+TEST_F(DflyEngineTest, MemcacheCas) {
+  using MP = MemcacheParser;
+
+  auto resp = RunMC(MP::SET, "key", "bar", 5);
+  EXPECT_THAT(resp, ElementsAre("STORED"));
+
+  // gets returns "VALUE <key> <flags> <len> <cas>".
+  resp = GetMC(MP::GETS, {"key"});
+  ASSERT_EQ(3u, resp.size());
+  vector<string_view> parts = absl::StrSplit(resp[0], ' ');
+  ASSERT_EQ(5u, parts.size());
+  EXPECT_EQ("VALUE", parts[0]);
+  uint64_t ver = 0;
+  ASSERT_TRUE(absl::SimpleAtoi(parts[4], &ver));
+  EXPECT_GT(ver, 0u);
+
+  resp = RunCasMC(ver + 1, "key", "bar2");
+  EXPECT_THAT(resp, ElementsAre("EXISTS"));
+  resp = RunMC(MP::GET, "key");
+  EXPECT_THAT(resp, ElementsAre("VALUE key 5 3", "bar", "END"));
+
+  resp = RunCasMC(ver, "key", "bar2");
+  EXPECT_THAT(resp, ElementsAre("STORED"));
+  resp = RunMC(MP::GET, "key");
+  EXPECT_THAT(resp, ElementsAre("VALUE key 0 4", "bar2", "END"));
+
+  // The successful cas bumped the version, so the old one no longer matches.
+  resp = RunCasMC(ver, "key", "bar3");
+  EXPECT_THAT(resp, ElementsAre("EXISTS"));
+
+  resp = RunCasMC(ver, "missing", "x");
+  EXPECT_THAT(resp, ElementsAre("NOT_FOUND"));
+}
+
+TEST_F(DflyEngineTest, MemcacheGat) {
+  using MP = MemcacheParser;
+
+  auto resp = RunMC(MP::SET, "key", "bar", 0, chrono::seconds(100));
+  EXPECT_THAT(resp, ElementsAre("STORED"));
+  EXPECT_GT(CheckedInt({"ttl", "key"}), 0);
+
+  // GAT with exptime 0 removes the expiry and returns the value.
+  resp = GetMC(MP::GAT, {"key"});
+  EXPECT_THAT(resp, ElementsAre("VALUE key 0 3", "bar", "END"));
+  EXPECT_EQ(-1, CheckedInt({"ttl", "key"}));
+
+  // GATS also returns the cas version.
+  resp = GetMC(MP::GATS, {"key"});
+  ASSERT_EQ(3u, resp.size());
+  EXPECT_THAT(resp[0], testing::StartsWith("VALUE key 0 3 "));
+}
+
 TEST_F(DflyEngineTest, LimitMemory) {
   mi_option_enable(mi_option_limit_os_alloc);
   string blob(128, 'a');
@@ -441,6 +544,50 @@ TEST_F(DflyEngineTest, PSubscribe) {
   EXPECT_EQ("a*", msg.pattern);
 }
 
+TEST_F(DflyEngineTest, PSubscribePrefixes) {
+  single_response_ = false;
+  // Patterns with a shared literal prefix, a wildcard-leading one and a pure literal.
+  auto resp = pp_->at(1)->Await([&] { return Run({"psubscribe", "news.*", "news.us.?", "*", "x"}); });
+  EXPECT_THAT(resp, ArrLen(3));
+
+  resp = pp_->at(0)->Await([&] { return Run({"publish", "news.us.1", "m1"}); });
+  EXPECT_THAT(resp, IntArg(3));  // news.*, news.us.? and *
+
+  resp = pp_->at(0)->Await([&] { return Run({"publish", "x", "m2"}); });
+  EXPECT_THAT(resp, IntArg(2));  // x and *
+
+  pp_->at(1)->Await([&] { return Run({"punsubscribe", "*"}); });
+  resp = pp_->at(0)->Await([&] { return Run({"publish", "sports", "m3"}); });
+  EXPECT_THAT(resp, IntArg(0));
+}
+
+TEST_F(DflyEngineTest, ClientTracking) {
+  // Tracking is rejected for RESP2 connections.
+  auto resp = Run({"client", "tracking", "on"});
+  EXPECT_THAT(resp, ErrArg("only for RESP3"));
+
+  Run({"hello", "3"});
+  resp = Run({"client", "tracking", "on"});
+  EXPECT_EQ(resp, "OK");
+
+  // The read registers the key, even when it does not exist yet.
+  Run({"get", "foo"});
+  Run({"set", "foo", "bar"});
+
+  pp_->AwaitFiberOnAll([](ProactorBase* pb) {});
+
+  const auto& msg = GetInvalidationMessage("IO0", 0);
+  EXPECT_EQ("foo", msg);
+
+  // A write to an untracked key does not push anything, and keys are invalidated only once.
+  Run({"set", "foo", "baz"});
+  Run({"set", "bar", "val"});
+
+  pp_->AwaitFiberOnAll([](ProactorBase* pb) {});
+
+  EXPECT_EQ(1u, InvalidationMessagesLen("IO0"));
+}
+
 TEST_F(DflyEngineTest, Unsubscribe) {
   auto resp = Run({"unsubscribe", "a"});
   EXPECT_THAT(resp.GetVec(), ElementsAre("unsubscribe", "a", IntArg(0)));
@@ -521,6 +668,32 @@ TEST_F(DflyEngineTest, Bug496) {
   });
 }
 
+TEST_F(DflyEngineTest, PreUpdateVersionGate) {
+  shard_set->pool()->AwaitFiberOnAll([&](unsigned index, ProactorBase* base) {
+    EngineShard* shard = EngineShard::tlocal();
+    if (shard == nullptr)
+      return;
+
+    auto& db = shard->db_slice();
+    auto [it, added] = db.AddOrFind({}, "key-1");
+    EXPECT_TRUE(added);
+
+    int cb_hits = 0;
+    uint32_t cb_id =
+        db.RegisterOnChange([&cb_hits](DbIndex, const DbSlice::ChangeReq&) { cb_hits++; });
+
+    db.PreUpdate(0, it);
+    EXPECT_EQ(cb_hits, 1);
+
+    // The first update bumped the bucket past the observer version, so the observer
+    // must not be consulted again for this bucket.
+    db.PreUpdate(0, it);
+    EXPECT_EQ(cb_hits, 1);
+
+    db.UnregisterOnChange(cb_id);
+  });
+}
+
 TEST_F(DflyEngineTest, Issue607) {
   // https://github.com/dragonflydb/dragonfly/issues/607
 
@@ -635,7 +808,167 @@ TEST_F(DflyEngineTest, Latency) {
   Run({"latency", "latest"});
 }
 
-// TODO: to test transactions with a single shard since then all transactions become local.
+TEST_F(DflyEngineTest, Wait) {
+  // Without replicas WAIT returns immediately with 0 acks.
+  EXPECT_THAT(Run({"wait", "0", "0"}), IntArg(0));
+  EXPECT_THAT(Run({"wait", "1", "10"}), IntArg(0));
+  EXPECT_THAT(Run({"wait", "abc", "0"}), ErrArg("not an integer"));
+}
+
+TEST_F(DflyEngineTest, DebugPopulateOptions) {
+  EXPECT_EQ(Run({"debug", "populate", "100", "hkey", "16", "TYPE", "HASH", "ELEMENTS", "3"}), "OK");
+  EXPECT_EQ(Run({"type", "hkey:0"}), "hash");
+  EXPECT_THAT(Run({"hlen", "hkey:0"}), IntArg(3));
+
+  EXPECT_EQ(Run({"debug", "populate", "10", "lkey", "8", "TYPE", "LIST", "ELEMENTS", "5"}), "OK");
+  EXPECT_THAT(Run({"llen", "lkey:0"}), IntArg(5));
+
+  EXPECT_EQ(Run({"debug", "populate", "10", "ekey", "8", "TTL", "100", "20"}), "OK");
+  EXPECT_GT(CheckedInt({"ttl", "ekey:0"}), 0);
+
+  EXPECT_THAT(Run({"debug", "populate", "10", "k", "8", "TYPE", "BAD"}), ErrArg("syntax"));
+  EXPECT_THAT(Run({"debug", "populate", "10", "k", "8", "SIZERANGE", "10", "5"}), ErrArg("syntax"));
+}
+
+TEST_F(DflyEngineTest, HotKeysDisabled) {
+  EXPECT_THAT(Run({"hotkeys"}), ErrArg("enable_top_keys_tracking"));
+}
+
+TEST_F(HotKeysDflyEngineTest, HotKeys) {
+  Run({"set", "x", "val"});
+  // The default min_key_count_to_record is 100 touches.
+  for (unsigned i = 0; i < 200; ++i) {
+    Run({"get", "x"});
+  }
+
+  RespExpr resp = Run({"hotkeys"});
+  ASSERT_EQ(resp.type, RespExpr::ARRAY);
+  EXPECT_EQ(resp.GetVec()[0], "x");
+}
+
+TEST_F(DflyEngineTest, DebugTrace) {
+  absl::SetFlag(&FLAGS_tx_trace_sample_rate, 1);
+  Run({"set", "key", "val"});
+  absl::SetFlag(&FLAGS_tx_trace_sample_rate, 0);
+
+  // The sampled SET records at least init, hop-start, hop-end and conclude phases.
+  RespExpr resp = Run({"debug", "trace"});
+  ASSERT_EQ(resp.type, RespExpr::ARRAY);
+  EXPECT_GE(resp.GetVec().size(), 4u);
+}
+
+/TEST_F(TimerWheelDflyEngineTest, ExpireWheel) {
+  Run({"set", "short", "v", "px", "100"});
+  Run({"set", "long", "v", "ex", "100"});
+  EXPECT_EQ(2, CheckedInt({"dbsize"}));
+
+  AdvanceTime(3000);
+
+  // Drain the wheel with a zero sampling budget: only keys indexed by the wheel
+  // can be deleted by this step.
+  shard_set->RunBlockingInParallel([](EngineShard* shard) {
+    shard->db_slice().DeleteExpiredStep(DbContext{0, GetCurrentTimeMs()}, 0);
+  });
+
+  // DBSIZE reports raw table sizes, so it proves the precise deletion happened
+  // instead of relying on passive expiry.
+  EXPECT_EQ(1, CheckedInt({"dbsize"}));
+  EXPECT_EQ(1, CheckedInt({"exists", "long"}));
+}
+
+TEST_F(DflyEngineTest, DebugPerf) {
+  // One line per proactor thread, each mapping a tid to a shard or io role.
+  RespExpr resp = Run({"debug", "perf"});
+  ASSERT_EQ(resp.type, RespExpr::ARRAY);
+  ASSERT_EQ(resp.GetVec().size(), shard_set->pool()->size());
+}
+
+TEST_F(DflyEngineTest, MemoryUsage) {
+  Run({"set", "str1", string(1000, 'x')});
+  EXPECT_GE(CheckedInt({"memory", "usage", "str1"}), 1000);
+
+  Run({"rpush", "l1", "a", "b", "c"});
+  EXPECT_GT(CheckedInt({"memory", "usage", "l1"}), 0);
+
+  EXPECT_THAT(Run({"memory", "usage", "nosuchkey"}), ErrArg("no such key"));
+}
+
+TEST_F(DflyEngineTest, Export) {
+  Run({"set", "str1", "val1"});
+  Run({"set", "str2", "val2", "px", "100000"});
+  Run({"hset", "hash1", "f1", "v1", "f2", "v2"});
+  Run({"json.set", "json1", ".", R"({"a":1})"});
+  Run({"rpush", "list1", "a"});  // lists are not exportable and must be skipped.
+
+  EXPECT_EQ(4, CheckedInt({"export", "exporttest"}));
+
+  // Decode the per-shard column batches, see columnar_export.h for the format.
+  struct Row {
+    uint8_t type;
+    int64_t expire_ms;
+    string value;
+  };
+  absl::flat_hash_map<string, Row> rows;
+
+  auto files = io::StatFiles("exporttest-*");
+  ASSERT_TRUE(files);
+  ASSERT_EQ(files->size(), shard_set->size());
+  for (const auto& fl : *files) {
+    auto contents = io::ReadFileToString(fl.name);
+    ASSERT_TRUE(contents);
+    string_view buf = *contents;
+    ASSERT_EQ("DFEXP001", buf.substr(0, 8));
+
+    size_t pos = 8;
+    while (pos < buf.size()) {
+      uint32_t n = absl::little_endian::Load32(buf.data() + pos);
+      pos += 4;
+
+      vector<Row> batch(n);
+      vector<string> keys(n);
+      for (uint32_t i = 0; i < n; ++i)
+        batch[i].type = buf[pos + i];
+      pos += n;
+      for (uint32_t i = 0; i < n; ++i, pos += 8)
+        batch[i].expire_ms = int64_t(absl::little_endian::Load64(buf.data() + pos));
+
+      vector<uint32_t> lens(n);
+      for (uint32_t i = 0; i < n; ++i, pos += 4)
+        lens[i] = absl::little_endian::Load32(buf.data() + pos);
+      for (uint32_t i = 0; i < n; ++i, pos += lens[i])
+        keys[i] = buf.substr(pos, lens[i]);
+
+      for (uint32_t i = 0; i < n; ++i, pos += 4)
+        lens[i] = absl::little_endian::Load32(buf.data() + pos);
+      for (uint32_t i = 0; i < n; ++i, pos += lens[i])
+        batch[i].value = buf.substr(pos, lens[i]);
+
+      for (uint32_t i = 0; i < n; ++i)
+        rows[keys[i]] = std::move(batch[i]);
+    }
+    ASSERT_EQ(pos, buf.size());
+    unlink(fl.name.c_str());
+  }
+
+  ASSERT_EQ(4u, rows.size());
+  EXPECT_EQ(OBJ_STRING, rows["str1"].type);
+  EXPECT_EQ(-1, rows["str1"].expire_ms);
+  EXPECT_EQ("val1", rows["str1"].value);
+  EXPECT_GT(rows["str2"].expire_ms, 0);
+  EXPECT_EQ(OBJ_HASH, rows["hash1"].type);
+  EXPECT_EQ(R"({"f1":"v1","f2":"v2"})", rows["hash1"].value);
+  EXPECT_EQ(OBJ_JSON, rows["json1"].type);
+  EXPECT_EQ(R"({"a":1})", rows["json1"].value);
+  EXPECT_EQ(0u, rows.count("list1"));
+
+  EXPECT_EQ(2, CheckedInt({"export", "exportmatch", "match", "str*"}));
+  files = io::StatFiles("exportmatch-*");
+  ASSERT_TRUE(files);
+  for (const auto& fl : *files)
+    unlink(fl.name.c_str());
+}
+
+/ TODO: to test transactions with a single shard since then all transactions become local.
 // To consider having a parameter in dragonfly engine controlling number of shards
 // unconditionally from number of cpus. TO TEST BLPOP under multi for single/multi argument case.
 
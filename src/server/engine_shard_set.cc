@@ -11,7 +11,10 @@ extern "C" {
 
 #include "base/flags.h"
 #include "base/logging.h"
+#include "core/string_map.h"
 #include "server/blocking_controller.h"
+#include "server/command_registry.h"
+#include "server/list_family.h"
 #include "server/search/doc_index.h"
 #include "server/server_state.h"
 #include "server/tiered_storage.h"
@@ -22,10 +25,27 @@ using namespace std;
 
 ABSL_FLAG(string, spill_file_prefix, "", "");
 
+ABSL_DECLARE_FLAG(uint32_t, dbnum);
+
+ABSL_FLAG(uint32_t, value_compression_threshold, 0,
+          "If positive, string values of at least this many bytes are kept lz4-compressed in "
+          "memory and decompressed on read. 0 disables the at-rest compression.");
+
+ABSL_FLAG(bool, hash_field_interning, false,
+          "If true, short hash field names are deduplicated across hashes within a shard. "
+          "Saves memory when many hashes share the same field schema.");
+
 ABSL_FLAG(uint32_t, hz, 100,
           "Base frequency at which the server performs other background tasks. "
           "Warning: not advised to decrease in production.");
 
+ABSL_FLAG(uint32_t, shard_stall_threshold_ms, 0,
+          "If non-zero, transaction hops running longer than this many milliseconds are "
+          "recorded into a per-shard incident ring shown by DEBUG STALLS. 0 disables.");
+
+ABSL_FLAG(bool, shard_stall_log, false,
+          "If true, each incident detected by --shard_stall_threshold_ms is also logged.");
+
 ABSL_FLAG(bool, cache_mode, false,
           "If true, the backend behaves like a cache, "
           "by evicting entries when getting close to maxmemory limit");
@@ -53,6 +73,24 @@ constexpr uint64_t kCursorDoneState = 0u;
 
 vector<EngineShardSet::CachedStats> cached_stats;  // initialized in EngineShardSet::Init
 
+// Per-(shard, db) counters published by shard threads with relaxed stores and summed by
+// any thread, one row per shard so that writers never touch each other's entries.
+// Initialized in EngineShardSet::Init.
+struct PerDbCounters {
+  std::atomic_uint64_t key_count;
+  std::atomic_size_t obj_memory;
+
+  PerDbCounters() : key_count(0), obj_memory(0) {
+  }
+
+  PerDbCounters(const PerDbCounters& o)
+      : key_count(o.key_count.load()), obj_memory(o.obj_memory.load()) {
+  }
+};
+
+vector<PerDbCounters> cached_db_stats;
+unsigned cached_dbs_per_shard = 0;
+
 struct ShardMemUsage {
   std::size_t commited = 0;
   std::size_t used = 0;
@@ -82,6 +120,7 @@ uint64_t TEST_current_time_ms = 0;
 EngineShard::Stats& EngineShard::Stats::operator+=(const EngineShard::Stats& o) {
   ooo_runs += o.ooo_runs;
   quick_runs += o.quick_runs;
+  txq_len_max = std::max(txq_len_max, o.txq_len_max);
   defrag_attempt_total += o.defrag_attempt_total;
   defrag_realloc_total += o.defrag_realloc_total;
   defrag_task_invocation_total += o.defrag_task_invocation_total;
@@ -94,6 +133,12 @@ void EngineShard::DefragTaskState::UpdateScanState(uint64_t cursor_val) {
   underutilized_found = false;
 }
 
+void EngineShard::DefragTaskState::ResetScanState() {
+  cursor = kCursorDoneState;
+  dbid = 0;
+  underutilized_found = false;
+}
+
 // This function checks 3 things:
 // 1. Don't try memory fragmentation if we don't use "enough" memory (control by
 // mem_defrag_threshold flag)
@@ -101,8 +146,9 @@ void EngineShard::DefragTaskState::UpdateScanState(uint64_t cursor_val) {
 // 3. in case the above is OK, make sure that we have a "gap" between usage and commited memory
 // (control by mem_defrag_waste_threshold flag)
 bool EngineShard::DefragTaskState::CheckRequired() {
-  if (cursor > kCursorDoneState || underutilized_found) {
-    VLOG(1) << "cursor: " << cursor << " and underutilized_found " << underutilized_found;
+  if (cursor > kCursorDoneState || dbid > 0 || underutilized_found) {
+    VLOG(1) << "cursor: " << cursor << ", dbid: " << dbid << " and underutilized_found "
+            << underutilized_found;
     return true;
   }
 
@@ -137,8 +183,17 @@ bool EngineShard::DoDefrag() {
   const float threshold = GetFlag(FLAGS_mem_defrag_page_utilization_threshold);
 
   auto& slice = db_slice();
-  DCHECK(slice.IsDbValid(kDefaultDbIndex));
-  auto [prime_table, expire_table] = slice.GetTables(kDefaultDbIndex);
+
+  // Skip empty database slots so the sweep covers every populated table, not only db 0.
+  while (defrag_state_.dbid < slice.db_array_size() && !slice.IsDbValid(defrag_state_.dbid)) {
+    ++defrag_state_.dbid;
+  }
+  if (defrag_state_.dbid >= slice.db_array_size()) {
+    defrag_state_.ResetScanState();
+    return false;
+  }
+
+  auto [prime_table, expire_table] = slice.GetTables(defrag_state_.dbid);
   PrimeTable::Cursor cur = defrag_state_.cursor;
   uint64_t reallocations = 0;
   unsigned traverses_count = 0;
@@ -171,7 +226,18 @@ bool EngineShard::DoDefrag() {
   stats_.defrag_realloc_total += reallocations;
   stats_.defrag_task_invocation_total++;
   stats_.defrag_attempt_total += attempts;
-  return defrag_state_.cursor > kCursorDoneState;
+
+  if (defrag_state_.cursor == kCursorDoneState) {
+    // Finished this database, continue with the next one on the following invocation.
+    ++defrag_state_.dbid;
+    if (defrag_state_.dbid >= slice.db_array_size()) {
+      defrag_state_.ResetScanState();
+      return false;
+    }
+    return true;
+  }
+
+  return true;
 }
 
 // the memory defragmentation task is as follow:
@@ -251,6 +317,8 @@ void EngineShard::InitThreadLocal(ProactorBase* pb, bool update_db_time) {
   shard_ = new (ptr) EngineShard(pb, update_db_time, data_heap);
 
   CompactObj::InitThreadLocal(shard_->memory_resource());
+  CompactObj::SetCompressionThreshold(GetFlag(FLAGS_value_compression_threshold));
+  StringMap::SetFieldInterning(GetFlag(FLAGS_hash_field_interning));
   SmallString::InitThreadLocal(data_heap);
 
   string backing_prefix = GetFlag(FLAGS_spill_file_prefix);
@@ -293,13 +361,42 @@ void EngineShard::PollExecution(const char* context, Transaction* trans) {
 
   ShardId sid = shard_id();
 
+  stats_.txq_len_max = std::max<uint64_t>(stats_.txq_len_max, txq_.size());
+
+  // Runs the hop and records its execution latency.
+  uint32_t stall_ms = GetFlag(FLAGS_shard_stall_threshold_ms);
+  auto run = [this, sid, stall_ms](Transaction* tx, bool txq_ooo) {
+    // Attribution is captured upfront: RunInShard may release the last reference to tx,
+    // so tx can not be inspected once the hop finished. cid points into the command
+    // registry and outlives the transaction.
+    const CommandId* cid = nullptr;
+    TxId txid = 0;
+    string key;
+    if (stall_ms > 0) {
+      cid = tx->GetCId();
+      txid = tx->txid();
+      ArgSlice args = tx->GetShardArgs(sid);
+      if (!args.empty())
+        key = args.front();
+    }
+
+    uint64_t start = absl::GetCurrentTimeNanos();
+    bool keep = tx->RunInShard(this, txq_ooo);
+    uint64_t dur_usec = (absl::GetCurrentTimeNanos() - start) / 1000;
+    run_hist_.Add(dur_usec);
+    if (stall_ms > 0 && dur_usec >= uint64_t(stall_ms) * 1000) {
+      RecordStall(cid, txid, key, dur_usec);
+    }
+    return keep;
+  };
+
   uint16_t trans_mask = trans ? trans->GetLocalMask(sid) : 0;
   if (trans_mask & Transaction::AWAKED_Q) {
     CHECK(continuation_trans_ == nullptr)
         << continuation_trans_->DebugId() << " when polling " << trans->DebugId()
         << "cont_mask: " << continuation_trans_->GetLocalMask(sid) << " vs " << trans_mask;
 
-    bool keep = trans->RunInShard(this, false);
+    bool keep = run(trans, false);
     if (keep) {
       return;
     }
@@ -310,7 +407,7 @@ void EngineShard::PollExecution(const char* context, Transaction* trans) {
       trans = nullptr;
 
     if (continuation_trans_->IsArmedInShard(sid)) {
-      bool to_keep = continuation_trans_->RunInShard(this, false);
+      bool to_keep = run(continuation_trans_, false);
       DVLOG(1) << "RunContTrans: " << (continuation_trans_ ? continuation_trans_->DebugId() : "")
                << " keep: " << to_keep;
       if (!to_keep) {
@@ -363,7 +460,9 @@ void EngineShard::PollExecution(const char* context, Transaction* trans) {
         dbg_id = head->DebugId();
       }
 
-      bool keep = head->RunInShard(this, false);
+      queue_wait_hist_.Add((absl::GetCurrentTimeNanos() - head->GetEnqueueTimeNs()) / 1000);
+
+      bool keep = run(head, false);
 
       // We should not access head from this point since RunInShard callback decrements refcount.
       DLOG_IF(INFO, !dbg_id.empty()) << "RunHead " << dbg_id << ", keep " << keep;
@@ -393,7 +492,7 @@ void EngineShard::PollExecution(const char* context, Transaction* trans) {
     ++stats_.ooo_runs;
 
     bool txq_ooo = trans_mask & Transaction::OUT_OF_ORDER;
-    bool keep = trans->RunInShard(this, txq_ooo);
+    bool keep = run(trans, txq_ooo);
 
     // If the transaction concluded, it must remove itself from the tx queue.
     // Otherwise it is required to stay there to keep the relative order.
@@ -404,6 +503,25 @@ void EngineShard::PollExecution(const char* context, Transaction* trans) {
   }
 }
 
+void EngineShard::RecordStall(const CommandId* cid, TxId txid, string_view key,
+                              uint64_t duration_usec) {
+  StallIncident incident;
+  incident.ts_ms = absl::GetCurrentTimeNanos() / 1'000'000;
+  incident.duration_usec = duration_usec;
+  incident.txid = txid;
+  incident.command = cid ? string(cid->name()) : "<unknown>";
+  if (!key.empty())
+    absl::StrAppend(&incident.command, " ", key);
+
+  LOG_IF(WARNING, GetFlag(FLAGS_shard_stall_log))
+      << "Shard " << shard_id() << " stalled for " << duration_usec << "us running "
+      << incident.command << " (tx " << txid << ")";
+
+  if (stall_incidents_.size() >= kMaxStallIncidents)
+    stall_incidents_.pop_front();
+  stall_incidents_.push_back(std::move(incident));
+}
+
 void EngineShard::RemoveContTx(Transaction* tx) {
   if (continuation_trans_ == tx) {
     continuation_trans_ = nullptr;
@@ -451,6 +569,12 @@ bool EngineShard::HasResultConverged(TxId notifyid) const {
 void EngineShard::Heartbeat() {
   CacheStats();
 
+  // Continue search index builds that did not complete inline during creation.
+  shard_search_indices_->RunBuildSteps(this, GetCurrentTimeMs());
+
+  // Compress interior nodes of lists that went cold (also on replicas).
+  ListFamily::CompressColdLists(this);
+
   if (IsReplica())  // Never run expiration on replica.
     return;
 
@@ -485,6 +609,17 @@ void EngineShard::Heartbeat() {
       counter_[TTL_DELETE].IncBy(stats.deleted);
     }
 
+    // Pre-split nearly full prime-table segments here so that writers do not pay the
+    // inline split cost in Grow. The scan is budget-bounded and the cursor persists
+    // across ticks, so large tables are covered incrementally.
+    if (db_slice_.memory_budget() > redline) {
+      constexpr unsigned kSplitScanBudget = 32;
+      constexpr unsigned kMaxSplitsPerTick = 2;
+      constexpr double kSplitUtilRatio = 0.85;
+
+      pt->SplitBudgeted(kSplitScanBudget, kMaxSplitsPerTick, kSplitUtilRatio);
+    }
+
     // if our budget is below the limit
     if (db_slice_.memory_budget() < redline) {
       db_slice_.FreeMemWithEvictionStep(i, redline - db_slice_.memory_budget());
@@ -566,7 +701,10 @@ void EngineShard::TEST_EnableHeartbeat() {
 void EngineShardSet::Init(uint32_t sz, bool update_db_time) {
   CHECK_EQ(0u, size());
   cached_stats.resize(sz);
+  cached_dbs_per_shard = GetFlag(FLAGS_dbnum);
+  cached_db_stats.assign(size_t(sz) * cached_dbs_per_shard, PerDbCounters{});
   shard_queue_.resize(sz);
+  poll_inbox_ = std::make_unique<PollInbox[]>(sz);
 
   pp_->AwaitFiberOnAll([&](uint32_t index, ProactorBase* pb) {
     if (index < shard_queue_.size()) {
@@ -585,10 +723,54 @@ void EngineShardSet::InitThreadLocal(ProactorBase* pb, bool update_db_time) {
   shard_queue_[es->shard_id()] = es->GetFiberQueue();
 }
 
+void EngineShardSet::SubmitPollNode(ShardId sid, TxPollNode* node) {
+  DCHECK_LT(sid, size());
+  PollInbox& inbox = poll_inbox_[sid];
+
+  inbox.queue.Push(node);
+
+  // A single drain task serves the whole batch accumulated until it runs, so under load
+  // concurrent hops cost one shard queue wakeup instead of one each.
+  if (!inbox.drain_scheduled.exchange(true, memory_order_acq_rel))
+    shard_queue_[sid]->Add([&inbox] { DrainPollInbox(&inbox); });
+}
+
+void EngineShardSet::DrainPollInbox(PollInbox* inbox) {
+  // Clear the flag before popping and with an RMW: a producer whose push we miss below has
+  // then necessarily performed its exchange after ours, read `false` and scheduled a fresh
+  // drain. This also covers Pop() returning null transiently in the middle of a push.
+  inbox->drain_scheduled.exchange(false, memory_order_acq_rel);
+
+  while (TxPollNode* node = inbox->queue.Pop())
+    Transaction::RunPolledNode(node);
+}
+
 const vector<EngineShardSet::CachedStats>& EngineShardSet::GetCachedStats() {
   return cached_stats;
 }
 
+auto EngineShardSet::GetCachedDbStats(DbIndex db_ind) -> CachedDbStats {
+  CachedDbStats res;
+  if (db_ind >= cached_dbs_per_shard)
+    return res;
+
+  for (size_t i = db_ind; i < cached_db_stats.size(); i += cached_dbs_per_shard) {
+    res.key_count += cached_db_stats[i].key_count.load(memory_order_relaxed);
+    res.obj_memory += cached_db_stats[i].obj_memory.load(memory_order_relaxed);
+  }
+  return res;
+}
+
+void EngineShardSet::SetCachedDbStats(ShardId sid, DbIndex db_ind, uint64_t key_count,
+                                      size_t obj_memory) {
+  if (db_ind >= cached_dbs_per_shard)  // can happen only for out-of-range rdb loads.
+    return;
+
+  PerDbCounters& counters = cached_db_stats[size_t(sid) * cached_dbs_per_shard + db_ind];
+  counters.key_count.store(key_count, memory_order_relaxed);
+  counters.obj_memory.store(obj_memory, memory_order_relaxed);
+}
+
 void EngineShardSet::TEST_EnableHeartBeat() {
   RunBriefInParallel([](EngineShard* shard) { shard->TEST_EnableHeartbeat(); });
 }
@@ -12,6 +12,9 @@ extern "C" {
 #include <absl/container/flat_hash_map.h>
 #include <xxhash.h>
 
+#include <deque>
+
+#include "base/histogram.h"
 #include "base/string_view_sso.h"
 #include "util/proactor_pool.h"
 #include "util/sliding_counter.h"
@@ -20,6 +23,7 @@ extern "C" {
 #include "core/external_alloc.h"
 #include "core/fibers.h"
 #include "core/mi_memory_resource.h"
+#include "core/mpsc_intrusive_queue.h"
 #include "core/tx_queue.h"
 #include "server/cluster/cluster_config.h"
 #include "server/db_slice.h"
@@ -30,6 +34,7 @@ namespace journal {
 class Journal;
 }  // namespace journal
 
+class CommandId;
 class TieredStorage;
 class ShardDocIndices;
 class BlockingController;
@@ -39,6 +44,11 @@ class EngineShard {
   struct Stats {
     uint64_t ooo_runs = 0;    // how many times transactions run as OOO.
     uint64_t quick_runs = 0;  //  how many times single shard "RunQuickie" transaction run.
+
+    // High-water mark of the tx queue depth. Aggregated with max() so that INFO shows the
+    // depth of the most loaded shard - the signal for keyspace skew.
+    uint64_t txq_len_max = 0;
+
     uint64_t defrag_attempt_total = 0;
     uint64_t defrag_realloc_total = 0;
     uint64_t defrag_task_invocation_total = 0;
@@ -109,6 +119,31 @@ class EngineShard {
     return stats_;
   }
 
+  // Latency histograms in usec, recorded by PollExecution: how long transactions waited
+  // in the tx queue before their first run and how long each hop took to execute.
+  // Shown by "DEBUG SHARDLATENCY".
+  const base::Histogram& queue_wait_hist() const {
+    return queue_wait_hist_;
+  }
+
+  const base::Histogram& run_hist() const {
+    return run_hist_;
+  }
+
+  // A transaction hop that ran longer than --shard_stall_threshold_ms. Every transaction
+  // queued behind such a hop stalls with it, so PollExecution keeps the last few offenders
+  // for attribution. Shown by "DEBUG STALLS".
+  struct StallIncident {
+    uint64_t ts_ms = 0;          // wall clock time when the hop finished.
+    uint64_t duration_usec = 0;
+    TxId txid = 0;
+    std::string command;         // command name and the first shard key, if any.
+  };
+
+  const std::deque<StallIncident>& stall_incidents() const {
+    return stall_incidents_;
+  }
+
   // Returns used memory for this shard.
   size_t UsedMemory() const;
 
@@ -163,6 +198,7 @@ class EngineShard {
   struct DefragTaskState {
     // we will add more data members later
     uint64_t cursor = 0u;
+    DbIndex dbid = 0u;  // the database table we are currently traversing.
     bool underutilized_found = false;
 
     // check the current threshold and return true if
@@ -170,6 +206,9 @@ class EngineShard {
     bool CheckRequired();
 
     void UpdateScanState(uint64_t cursor_val);
+
+    // Finishes the sweep, so that the next one starts from the first database.
+    void ResetScanState();
   };
 
   EngineShard(util::ProactorBase* pb, bool update_db_time, mi_heap_t* heap);
@@ -206,8 +245,15 @@ class EngineShard {
   MiMemoryResource mi_resource_;
   DbSlice db_slice_;
 
+  void RecordStall(const CommandId* cid, TxId txid, std::string_view key, uint64_t duration_usec);
+
+  static constexpr size_t kMaxStallIncidents = 16;
+
   Stats stats_;
 
+  base::Histogram queue_wait_hist_, run_hist_;
+  std::deque<StallIncident> stall_incidents_;
+
   // Become passive if replica: don't automatially evict expired items.
   bool is_replica_ = false;
 
@@ -246,6 +292,12 @@ class EngineShardSet {
     }
   };
 
+  // Per-database key count and object memory, aggregated over all shards.
+  struct CachedDbStats {
+    uint64_t key_count = 0;
+    size_t obj_memory = 0;
+  };
+
   explicit EngineShardSet(util::ProactorPool* pp) : pp_(pp) {
   }
 
@@ -262,6 +314,16 @@ class EngineShardSet {
 
   static const std::vector<CachedStats>& GetCachedStats();
 
+  // Returns the stats of database db_ind summed over all shards. Served from counters
+  // that shard threads publish on every mutation (see DbSlice::SyncDbCounters), so any
+  // thread may call this without dispatching to shard fibers.
+  static CachedDbStats GetCachedDbStats(DbIndex db_ind);
+
+  // Publishes the current counters of database db_ind on shard sid.
+  // Must be called from the shard thread that owns sid.
+  static void SetCachedDbStats(ShardId sid, DbIndex db_ind, uint64_t key_count,
+                               size_t obj_memory);
+
   // Uses a shard queue to dispatch. Callback runs in a dedicated fiber.
   template <typename F> auto Await(ShardId sid, F&& f) {
     return shard_queue_[sid]->Await(std::forward<F>(f));
@@ -273,6 +335,11 @@ class EngineShardSet {
     return shard_queue_[sid]->Add(std::forward<F>(f));
   }
 
+  // Pushes a transaction poll request into the dedicated per-shard inbox. Unlike Add(), which
+  // allocates a closure and wakes the shard fiber per call, the inbox is an intrusive MPSC queue
+  // drained in batches - concurrent submitters share a single shard queue wakeup.
+  void SubmitPollNode(ShardId sid, TxPollNode* node);
+
   // Runs a brief function on all shards. Waits for it to complete.
   // `func` must not preempt.
   template <typename U> void RunBriefInParallel(U&& func) const {
@@ -305,10 +372,19 @@ class EngineShardSet {
   void TEST_EnableCacheMode();
 
  private:
+  // Aligned so that inboxes of neighbouring shards do not share a cacheline.
+  struct alignas(64) PollInbox {
+    detail::MPSCIntrusiveQueue<TxPollNode> queue;
+    std::atomic_bool drain_scheduled{false};
+  };
+
   void InitThreadLocal(util::ProactorBase* pb, bool update_db_time);
 
+  static void DrainPollInbox(PollInbox* inbox);
+
   util::ProactorPool* pp_;
   std::vector<FiberQueue*> shard_queue_;
+  std::unique_ptr<PollInbox[]> poll_inbox_;  // one entry per shard
 };
 
 template <typename U, typename P>
@@ -4,6 +4,11 @@
 
 #include "server/generic_family.h"
 
+#include <absl/container/fixed_array.h>
+#include <absl/random/random.h>
+
+#include <numeric>
+
 extern "C" {
 #include "redis/crc64.h"
 #include "redis/object.h"
@@ -29,6 +34,7 @@ extern "C" {
 ABSL_FLAG(uint32_t, dbnum, 16, "Number of databases");
 ABSL_FLAG(uint32_t, keys_output_limit, 8192, "Maximum number of keys output by keys command");
 ABSL_DECLARE_FLAG(int, compression_mode);
+ABSL_DECLARE_FLAG(uint32_t, access_clock_sampling);
 
 namespace dfly {
 using namespace std;
@@ -270,6 +276,33 @@ OpResult<RestoreArgs> RestoreArgs::TryFrom(const CmdArgList& args) {
 
 OpStatus OpPersist(const OpArgs& op_args, string_view key);
 
+// Serializes a value in DUMP format: the object type opcode, the value payload and a footer
+// with the RDB version and a CRC64 of the blob. Used by DUMP and for materializing copies.
+std::string SerializeValue(const PrimeValue& pv) {
+  io::StringSink sink;
+  int compression_mode = absl::GetFlag(FLAGS_compression_mode);
+  CompressionMode serializer_compression_mode =
+      compression_mode == 0 ? CompressionMode::NONE : CompressionMode::SINGLE_ENTRY;
+  RdbSerializer serializer(serializer_compression_mode);
+
+  unsigned obj_type = pv.ObjType();
+  unsigned encoding = pv.Encoding();
+  auto type = RdbObjectType(obj_type, encoding);
+  DVLOG(1) << "We are going to dump object type: " << type;
+  std::error_code ec = serializer.WriteOpcode(type);
+  CHECK(!ec);
+  ec = serializer.SaveValue(pv);
+  CHECK(!ec);  // make sure that fully was successful
+  ec = serializer.FlushToSink(&sink);
+  CHECK(!ec);  // make sure that fully was successful
+
+  // Move the payload out of the sink instead of copying it - dumps of large values
+  // can reach hundreds of megabytes.
+  std::string payload(std::move(sink.str()));
+  AppendFooter(&payload);  // version and crc
+  return payload;
+}
+
 class Renamer {
  public:
   Renamer(ShardId source_id) : src_sid_(source_id) {
@@ -299,6 +332,7 @@ class Renamer {
 
   PrimeValue pv_;
   string str_val_;
+  bool str_copied_ = false;  // whether MoveSrc copied the value into str_val_ instead of pv_.
 
   FindResult src_res_, dest_res_;  // index 0 for source, 1 for destination
   OpResult<void> status_;
@@ -359,11 +393,16 @@ OpStatus Renamer::MoveSrc(Transaction* t, EngineShard* es) {
     auto it = es->db_slice().FindExt(t->GetDbContext(), src_res_.key).first;
     CHECK(IsValid(it));
 
-    // We distinguish because of the SmallString that is pinned to its thread by design,
-    // thus can not be accessed via another thread.
-    // Therefore, we copy it to standard string in its thread.
-    if (it->second.ObjType() == OBJ_STRING) {
+    // The value is transferred between the shards by moving the CompactObj itself - the
+    // heap payload stays in place and is eventually freed by the destination thread
+    // (mimalloc supports cross-thread frees), so even multi-GB containers move in O(1).
+    // Only two encodings cannot move: SmallString is pinned to the arena of the thread
+    // that created it, and external strings point into this shard's tiered storage file.
+    // Those are copied through the coordinator instead.
+    if (it->second.ObjType() == OBJ_STRING &&
+        (it->second.UsesSmallString() || it->second.IsExternal())) {
       it->second.GetString(&str_val_);
+      str_copied_ = true;
     } else {
       bool has_expire = it->second.HasExpire();
       pv_ = std::move(it->second);
@@ -390,7 +429,7 @@ OpStatus Renamer::UpdateDest(Transaction* t, EngineShard* es) {
       bool has_expire = dest_it->second.HasExpire();
       is_prior_list = dest_it->second.ObjType() == OBJ_LIST;
 
-      if (src_res_.ref_val.ObjType() == OBJ_STRING) {
+      if (str_copied_) {
         dest_it->second.SetString(str_val_);
       } else {
         dest_it->second = std::move(pv_);
@@ -398,7 +437,7 @@ OpStatus Renamer::UpdateDest(Transaction* t, EngineShard* es) {
       dest_it->second.SetExpire(has_expire);  // preserve expire flag.
       db_slice.UpdateExpire(t->GetDbIndex(), dest_it, src_res_.expire_ts);
     } else {
-      if (src_res_.ref_val.ObjType() == OBJ_STRING) {
+      if (str_copied_) {
         pv_.SetString(str_val_);
       }
       dest_it = db_slice.AddNew(t->GetDbContext(), dest_key, std::move(pv_), src_res_.expire_ts);
@@ -429,6 +468,124 @@ OpStatus Renamer::UpdateDest(Transaction* t, EngineShard* es) {
   return OpStatus::OK;
 }
 
+// COPY cannot share the container payload between the two entries: CompactObj has no room
+// for a reference count and the inner containers belong to the heap of the shard thread that
+// created them. Instead the source value is serialized once in DUMP format and materialized
+// at the destination, so a cross-shard copy ships one compact blob between the shards
+// instead of a per-element conversation through the coordinator.
+class Copier {
+ public:
+  explicit Copier(ShardId source_id) : src_sid_(source_id) {
+  }
+
+  void Find(Transaction* t);
+  void Finalize(Transaction* t, bool replace);
+
+  OpStatus status() const {
+    return status_;
+  }
+
+ private:
+  OpStatus CopyToDest(Transaction* t, EngineShard* es);
+
+  ShardId src_sid_;
+
+  string payload_;  // DUMP-format serialization of the source value.
+  uint64_t expire_ts_ = 0;
+  bool sticky_ = false;
+  bool src_found_ = false;
+  bool dest_found_ = false;
+  bool dest_is_list_ = false;
+
+  OpStatus status_ = OpStatus::OK;
+};
+
+void Copier::Find(Transaction* t) {
+  auto cb = [this](Transaction* t, EngineShard* shard) {
+    auto args = t->GetShardArgs(shard->shard_id());
+    CHECK_EQ(1u, args.size());
+
+    auto& db_slice = shard->db_slice();
+    auto [it, exp_it] = db_slice.FindExt(t->GetDbContext(), args.front());
+
+    if (shard->shard_id() == src_sid_) {
+      src_found_ = IsValid(it);
+      if (src_found_) {
+        payload_ = SerializeValue(it->second);
+        expire_ts_ = db_slice.ExpireTime(exp_it);
+        sticky_ = it->first.IsSticky();
+      }
+    } else {
+      dest_found_ = IsValid(it);
+      dest_is_list_ = dest_found_ && it->second.ObjType() == OBJ_LIST;
+    }
+    return OpStatus::OK;
+  };
+
+  t->Execute(move(cb), false);
+}
+
+void Copier::Finalize(Transaction* t, bool replace) {
+  auto cleanup = [](Transaction* t, EngineShard* shard) { return OpStatus::OK; };
+
+  if (!src_found_) {
+    status_ = OpStatus::KEY_NOTFOUND;
+    t->Execute(move(cleanup), true);
+    return;
+  }
+
+  if (dest_found_ && !replace) {
+    status_ = OpStatus::KEY_EXISTS;
+    t->Execute(move(cleanup), true);
+    return;
+  }
+
+  t->Execute([&](Transaction* t, EngineShard* shard) { return CopyToDest(t, shard); }, true);
+}
+
+OpStatus Copier::CopyToDest(Transaction* t, EngineShard* es) {
+  if (es->shard_id() == src_sid_)
+    return OpStatus::OK;
+
+  auto args = t->GetShardArgs(es->shard_id());
+  string_view dest_key = args.front();
+  auto& db_slice = es->db_slice();
+
+  PrimeIterator dest_it = db_slice.FindExt(t->GetDbContext(), dest_key).first;
+  if (IsValid(dest_it)) {
+    CHECK(db_slice.Del(t->GetDbIndex(), dest_it));
+  }
+
+  RdbRestoreValue loader{};
+  if (!loader.Add(payload_, dest_key, db_slice, t->GetDbIndex(), expire_ts_)) {
+    status_ = OpStatus::INVALID_VALUE;
+    return OpStatus::OK;
+  }
+
+  dest_it = db_slice.FindExt(t->GetDbContext(), dest_key).first;
+  CHECK(IsValid(dest_it));
+  dest_it->first.SetSticky(sticky_);
+
+  if (!dest_is_list_ && dest_it->second.ObjType() == OBJ_LIST && es->blocking_controller()) {
+    es->blocking_controller()->AwakeWatched(t->GetDbIndex(), dest_key);
+  }
+
+  if (es->journal()) {
+    OpArgs op_args = t->GetOpArgs(es);
+    // The replica may shard the two keys differently, so replay a RESTORE of the blob
+    // on the destination shard instead of the COPY command itself.
+    string ts = absl::StrCat(expire_ts_);
+    RecordJournal(op_args, "RESTORE"sv, ArgSlice{dest_key, ts, payload_, "REPLACE", "ABSTTL"}, 2,
+                  true);
+    if (sticky_) {
+      RecordJournal(op_args, "STICK"sv, ArgSlice{dest_key}, 2, true);
+    }
+    RecordJournalFinish(op_args, 2);
+  }
+
+  return OpStatus::OK;
+}
+
 OpStatus OpPersist(const OpArgs& op_args, string_view key) {
   auto& db_slice = op_args.shard->db_slice();
   auto [it, expire_it] = db_slice.FindExt(op_args.db_cntx, key);
@@ -451,27 +608,10 @@ OpResult<std::string> OpDump(const OpArgs& op_args, string_view key) {
 
   if (IsValid(it)) {
     DVLOG(1) << "Dump: key '" << key << "' successfully found, going to dump it";
-    std::unique_ptr<::io::StringSink> sink = std::make_unique<::io::StringSink>();
-    int compression_mode = absl::GetFlag(FLAGS_compression_mode);
-    CompressionMode serializer_compression_mode =
-        compression_mode == 0 ? CompressionMode::NONE : CompressionMode::SINGLE_ENTRY;
-    RdbSerializer serializer(serializer_compression_mode);
-
     // According to Redis code we need to
     // 1. Save the value itself - without the key
     // 2. Save footer: this include the RDB version and the CRC value for the message
-    unsigned obj_type = it->second.ObjType();
-    unsigned encoding = it->second.Encoding();
-    auto type = RdbObjectType(obj_type, encoding);
-    DVLOG(1) << "We are going to dump object type: " << type;
-    std::error_code ec = serializer.WriteOpcode(type);
-    CHECK(!ec);
-    ec = serializer.SaveValue(it->second);
-    CHECK(!ec);  // make sure that fully was successful
-    ec = serializer.FlushToSink(sink.get());
-    CHECK(!ec);  // make sure that fully was successful
-    std::string dump_payload(sink->str());
-    AppendFooter(&dump_payload);  // version and crc
+    std::string dump_payload = SerializeValue(it->second);
     CHECK_GT(dump_payload.size(), 10u);
     return dump_payload;
   }
@@ -514,7 +654,47 @@ OpResult<bool> OnRestore(const OpArgs& op_args, std::string_view key, std::strin
                     restore_args.ExpirationTime());
 }
 
-bool ScanCb(const OpArgs& op_args, PrimeIterator it, const ScanOpts& opts, StringVec* res) {
+// Both keys live on this shard, so the copy happens in one hop. The value still goes
+// through a serialization round-trip - it is the only generic deep-copy the engine has.
+OpStatus OpCopy(const OpArgs& op_args, string_view src_key, string_view dest_key, bool replace) {
+  auto& db_slice = op_args.shard->db_slice();
+  auto [src_it, src_expire] = db_slice.FindExt(op_args.db_cntx, src_key);
+  if (!IsValid(src_it))
+    return OpStatus::KEY_NOTFOUND;
+
+  auto [dest_it, dest_expire] = db_slice.FindExt(op_args.db_cntx, dest_key);
+  if (IsValid(dest_it) && !replace)
+    return OpStatus::KEY_EXISTS;
+
+  // Capture everything we need from the source before mutating the table - deleting the
+  // destination below invalidates iterators.
+  string payload = SerializeValue(src_it->second);
+  uint64_t expire_ts = db_slice.ExpireTime(src_expire);
+  bool sticky = src_it->first.IsSticky();
+  bool dest_is_list = IsValid(dest_it) && dest_it->second.ObjType() == OBJ_LIST;
+
+  if (IsValid(dest_it)) {
+    CHECK(db_slice.Del(op_args.db_cntx.db_index, dest_it));
+  }
+
+  RdbRestoreValue loader{};
+  if (!loader.Add(payload, dest_key, db_slice, op_args.db_cntx.db_index, expire_ts))
+    return OpStatus::INVALID_VALUE;
+
+  dest_it = db_slice.FindExt(op_args.db_cntx, dest_key).first;
+  CHECK(IsValid(dest_it));
+  dest_it->first.SetSticky(sticky);
+
+  if (!dest_is_list && dest_it->second.ObjType() == OBJ_LIST &&
+      op_args.shard->blocking_controller()) {
+    op_args.shard->blocking_controller()->AwakeWatched(op_args.db_cntx.db_index, dest_key);
+  }
+
+  return OpStatus::OK;
+}
+
+bool ScanCb(const OpArgs& op_args, PrimeIterator it, const ScanOpts& opts, string* scratch,
+            StringVec* res) {
   auto& db_slice = op_args.shard->db_slice();
   if (it->second.HasExpire()) {
     it = db_slice.ExpireIfNeeded(op_args.db_cntx, it).first;
@@ -523,6 +703,7 @@ bool ScanCb(const OpArgs& op_args, PrimeIterator it, const ScanOpts& opts, Strin
   if (!IsValid(it))
     return false;
 
+  // Filters that do not need the key string run first.
   bool matches = opts.type_filter.empty() || ObjTypeName(it->second.ObjType()) == opts.type_filter;
 
   if (!matches)
@@ -532,18 +713,23 @@ bool ScanCb(const OpArgs& op_args, PrimeIterator it, const ScanOpts& opts, Strin
     return false;
   }
 
-  string str = it->first.ToString();
-  if (!opts.Matches(str)) {
+  // The key is decoded into a scratch buffer reused across the whole traversal and copied
+  // out only if it actually matches - MATCH scans over a large keyspace mostly reject.
+  string_view key = it->first.GetSlice(scratch);
+  if (!opts.Matches(key)) {
     return false;
   }
-  res->push_back(std::move(str));
+  res->emplace_back(key);
 
   return true;
 }
 
 void OpScan(const OpArgs& op_args, const ScanOpts& scan_opts, uint64_t* cursor, StringVec* vec) {
   auto& db_slice = op_args.shard->db_slice();
-  DCHECK(db_slice.IsDbValid(op_args.db_cntx.db_index));
+  if (!db_slice.IsDbValid(op_args.db_cntx.db_index)) {  // never activated - empty.
+    *cursor = 0;
+    return;
+  }
 
   unsigned cnt = 0;
 
@@ -552,9 +738,10 @@ void OpScan(const OpArgs& op_args, const ScanOpts& scan_opts, uint64_t* cursor,
 
   PrimeTable::Cursor cur = *cursor;
   auto [prime_table, expire_table] = db_slice.GetTables(op_args.db_cntx.db_index);
+  string scratch;
   do {
     cur = prime_table->Traverse(
-        cur, [&](PrimeIterator it) { cnt += ScanCb(op_args, it, scan_opts, vec); });
+        cur, [&](PrimeIterator it) { cnt += ScanCb(op_args, it, scan_opts, &scratch, vec); });
   } while (cur && cnt < scan_opts.limit);
 
   VLOG(1) << "OpScan " << db_slice.shard_id() << " cursor: " << cur.value();
@@ -624,6 +811,19 @@ OpStatus OpExpire(const OpArgs& op_args, string_view key, const DbSlice::ExpireP
   return res.status();
 }
 
+// Batched variant of OpExpire: applies the same expiry to all the shard keys within a
+// single hop. Journal records stay per key because each key replicates differently -
+// DEL when the deadline already passed, PEXPIREAT with the exact time otherwise.
+OpResult<uint32_t> OpMExpire(const OpArgs& op_args, ArgSlice keys,
+                             const DbSlice::ExpireParams& params) {
+  uint32_t updated = 0;
+  for (string_view key : keys) {
+    if (OpExpire(op_args, key, params) == OpStatus::OK)
+      ++updated;
+  }
+  return updated;
+}
+
 }  // namespace
 
 void GenericFamily::Init(util::ProactorPool* pp) {
@@ -831,6 +1031,33 @@ void GenericFamily::Pexpire(CmdArgList args, ConnectionContext* cntx) {
   }
 }
 
+void GenericFamily::MPexpire(CmdArgList args, ConnectionContext* cntx) {
+  string_view msec = ArgS(args, 0);
+  int64_t int_arg;
+
+  if (!absl::SimpleAtoi(msec, &int_arg)) {
+    return (*cntx)->SendError(kInvalidIntErr);
+  }
+  int_arg = std::max(int_arg, 0L);
+  DbSlice::ExpireParams params{.value = int_arg, .unit = TimeUnit::MSEC};
+
+  atomic_uint32_t result{0};
+
+  auto cb = [&](Transaction* t, EngineShard* shard) {
+    ArgSlice keys = t->GetShardArgs(shard->shard_id());
+    auto res = OpMExpire(t->GetOpArgs(shard), keys, params);
+    result.fetch_add(res.value_or(0), memory_order_relaxed);
+
+    return OpStatus::OK;
+  };
+
+  OpStatus status = cntx->transaction->ScheduleSingleHop(std::move(cb));
+  CHECK_EQ(OpStatus::OK, status);
+
+  // The number of keys whose expiry was set. Missing keys are skipped silently, like DEL.
+  (*cntx)->SendLong(result.load(memory_order_relaxed));
+}
+
 void GenericFamily::Stick(CmdArgList args, ConnectionContext* cntx) {
   Transaction* transaction = cntx->transaction;
   VLOG(1) << "Stick " << ArgS(args, 0);
@@ -954,11 +1181,211 @@ OpResultTyped<SortEntryList> OpFetchSortEntries(const OpArgs& op_args, std::stri
   return success ? res : OpStatus::WRONG_TYPE;
 }
 
+// Sorting inputs above this size are split into chunks sorted on distinct pool
+// threads and merged back on the caller.
+constexpr size_t kParallelSortThreshold = 1 << 15;
+constexpr unsigned kParallelSortFibers = 4;
+
+template <typename It, typename Cmp> void ParallelSort(It begin, It end, Cmp cmp) {
+  size_t size = end - begin;
+  unsigned chunks = std::min<unsigned>(kParallelSortFibers, shard_set->pool()->size());
+  size_t chunk_size = (size + chunks - 1) / chunks;
+
+  shard_set->pool()->AwaitFiberOnAll([&](unsigned idx, util::ProactorBase*) {
+    size_t from = idx * chunk_size;
+    if (idx >= chunks || from >= size)
+      return;
+    std::sort(begin + from, begin + std::min(size, from + chunk_size), cmp);
+  });
+
+  for (size_t merged = chunk_size; merged < size; merged += chunk_size) {
+    std::inplace_merge(begin, begin + merged, begin + std::min(size, merged + chunk_size), cmp);
+  }
+}
+
+// Replaces the first '*' of a BY/GET pattern with the element.
+std::string SubstitutePattern(std::string_view pattern, std::string_view elem) {
+  size_t pos = pattern.find('*');
+  DCHECK_NE(pos, std::string_view::npos);
+  return absl::StrCat(pattern.substr(0, pos), elem, pattern.substr(pos + 1));
+}
+
+// Resolves the string values of the given keys with one batched, prefetch-pipelined
+// probe pass per shard. Runs outside the transaction scope: the keys derived from
+// BY/GET patterns are not declared by SORT, so these are best-effort point reads,
+// just like in Redis cluster mode. Missing keys and non-string values yield nullopt.
+std::vector<std::optional<std::string>> FetchPatternValues(absl::Span<const std::string> keys,
+                                                           ConnectionContext* cntx) {
+  std::vector<std::optional<std::string>> out(keys.size());
+  std::vector<std::vector<uint32_t>> shard_keys(shard_set->size());
+  for (uint32_t i = 0; i < keys.size(); i++)
+    shard_keys[Shard(keys[i], shard_set->size())].push_back(i);
+
+  shard_set->RunBriefInParallel(
+      [&](EngineShard* es) {
+        const auto& ids = shard_keys[es->shard_id()];
+        DbContext db_cntx{cntx->db_index(), GetCurrentTimeMs()};
+
+        std::vector<std::string_view> views(ids.size());
+        for (size_t i = 0; i < ids.size(); i++)
+          views[i] = keys[ids[i]];
+
+        absl::FixedArray<std::pair<PrimeIterator, ExpireIterator>, 16> its(ids.size());
+        es->db_slice().FindExtBatch(db_cntx, ArgSlice{views.data(), views.size()},
+                                    absl::MakeSpan(its));
+
+        for (size_t i = 0; i < ids.size(); i++) {
+          PrimeIterator it = its[i].first;
+          if (IsValid(it) && it->second.ObjType() == OBJ_STRING) {
+            std::string val;
+            it->second.GetString(&val);
+            out[ids[i]] = std::move(val);
+          }
+        }
+      },
+      [&](ShardId sid) { return !shard_keys[sid].empty(); });
+
+  return out;
+}
+
+// Fetches the container elements as plain strings, for the BY/GET pattern path.
+OpResultTyped<std::vector<std::string>> OpFetchElements(const OpArgs& op_args,
+                                                        std::string_view key) {
+  using namespace container_utils;
+
+  auto [it, _] = op_args.shard->db_slice().FindExt(op_args.db_cntx, key);
+  if (!IsValid(it) || !IsContainer(it->second)) {
+    return OpStatus::KEY_NOTFOUND;
+  }
+
+  std::vector<std::string> out;
+  out.reserve(it->second.Size());
+  Iterate(it->second, [&out](auto&& val) {
+    using T = std::decay_t<decltype(val)>;
+    if constexpr (std::is_same_v<T, int64_t>)
+      out.push_back(absl::StrCat(val));
+    else
+      out.push_back(std::move(val));
+    return true;
+  });
+
+  auto res = OpResultTyped{std::move(out)};
+  res.setType(it->second.ObjType());
+  return res;
+}
+
+// SORT with BY and/or GET patterns. The elements are fetched once, the pattern keys
+// are then resolved with batched per-shard probes, and only an index vector is
+// rearranged by the sort.
+void SortWithPatterns(std::string_view key, bool alpha, bool reversed,
+                      std::optional<std::pair<size_t, size_t>> bounds,
+                      std::optional<std::string_view> by_pattern,
+                      const std::vector<std::string_view>& get_patterns,
+                      ConnectionContext* cntx) {
+  OpResultTyped<std::vector<std::string>> fetch_result =
+      cntx->transaction->ScheduleSingleHopT([&](Transaction* t, EngineShard* shard) {
+        return OpFetchElements(t->GetOpArgs(shard), key);
+      });
+
+  if (!fetch_result.ok())
+    return (*cntx)->SendEmptyArray();
+
+  std::vector<std::string> elems = std::move(fetch_result.value());
+  int result_type = fetch_result.type();
+
+  std::vector<uint32_t> order(elems.size());
+  std::iota(order.begin(), order.end(), 0);
+
+  // A BY pattern without '*' disables sorting altogether ("nosort"), keeping the
+  // container order; LIMIT and GET still apply.
+  bool nosort = by_pattern && by_pattern->find('*') == std::string_view::npos;
+
+  if (!nosort) {
+    std::vector<std::optional<std::string>> by_values;
+    if (by_pattern) {
+      std::vector<std::string> by_keys(elems.size());
+      for (size_t i = 0; i < elems.size(); i++)
+        by_keys[i] = SubstitutePattern(*by_pattern, elems[i]);
+      by_values = FetchPatternValues(by_keys, cntx);
+    }
+
+    // The sort weight of element i: its BY value when one was found, the element
+    // itself otherwise (also the fallback for missing weight keys in alpha mode).
+    auto weight = [&](uint32_t i) -> std::string_view {
+      return by_pattern && by_values[i] ? *by_values[i] : std::string_view{elems[i]};
+    };
+
+    auto sort_by = [&](auto cmp) {
+      if (order.size() >= kParallelSortThreshold)
+        ParallelSort(order.begin(), order.end(), cmp);
+      else
+        std::sort(order.begin(), order.end(), cmp);
+    };
+
+    if (alpha) {
+      sort_by([&](uint32_t l, uint32_t r) { return bool(weight(l) < weight(r)) ^ reversed; });
+    } else {
+      std::vector<double> scores(elems.size());
+      for (size_t i = 0; i < elems.size(); i++) {
+        if (by_pattern && !by_values[i])
+          continue;  // missing weight keys sort as zero.
+        if (!absl::SimpleAtod(weight(i), &scores[i]))
+          return (*cntx)->SendError("One or more scores can't be converted into double");
+      }
+      sort_by([&](uint32_t l, uint32_t r) { return bool(scores[l] < scores[r]) ^ reversed; });
+    }
+  }
+
+  size_t start = 0, count = order.size();
+  if (bounds) {
+    start = std::min(bounds->first, order.size());
+    count = std::min(bounds->second, order.size() - start);
+  }
+  absl::Span<const uint32_t> selected{order.data() + start, count};
+
+  // Resolve the GET patterns for the selected rows only. '#' returns the element
+  // itself; a pattern without '*' never matches a key and yields nils.
+  std::vector<std::vector<std::optional<std::string>>> get_values(get_patterns.size());
+  for (size_t p = 0; p < get_patterns.size(); p++) {
+    if (get_patterns[p] == "#" || get_patterns[p].find('*') == std::string_view::npos)
+      continue;
+    std::vector<std::string> get_keys(selected.size());
+    for (size_t i = 0; i < selected.size(); i++)
+      get_keys[i] = SubstitutePattern(get_patterns[p], elems[selected[i]]);
+    get_values[p] = FetchPatternValues(get_keys, cntx);
+  }
+
+  facade::SinkReplyBuilder::ReplyAggregator agg{cntx->reply_builder()};
+
+  if (get_patterns.empty()) {
+    bool is_set = (result_type == OBJ_SET || result_type == OBJ_ZSET);
+    (*cntx)->StartCollection(selected.size(),
+                             is_set ? RedisReplyBuilder::SET : RedisReplyBuilder::ARRAY);
+    for (uint32_t idx : selected)
+      (*cntx)->SendBulkString(elems[idx]);
+    return;
+  }
+
+  (*cntx)->StartArray(selected.size() * get_patterns.size());
+  for (size_t i = 0; i < selected.size(); i++) {
+    for (size_t p = 0; p < get_patterns.size(); p++) {
+      if (get_patterns[p] == "#")
+        (*cntx)->SendBulkString(elems[selected[i]]);
+      else if (!get_values[p].empty() && get_values[p][i])
+        (*cntx)->SendBulkString(*get_values[p][i]);
+      else
+        (*cntx)->SendNull();
+    }
+  }
+}
+
 void GenericFamily::Sort(CmdArgList args, ConnectionContext* cntx) {
   std::string_view key = ArgS(args, 0);
   bool alpha = false;
   bool reversed = false;
   std::optional<std::pair<size_t, size_t>> bounds;
+  std::optional<std::string_view> by_pattern;
+  std::vector<std::string_view> get_patterns;
 
   for (size_t i = 1; i < args.size(); i++) {
     ToUpper(&args[i]);
@@ -968,6 +1395,16 @@ void GenericFamily::Sort(CmdArgList args, ConnectionContext* cntx) {
       alpha = true;
     } else if (arg == "DESC") {
       reversed = true;
+    } else if (arg == "BY") {
+      if (++i >= args.size()) {
+        return (*cntx)->SendError(kSyntaxErr);
+      }
+      by_pattern = ArgS(args, i);
+    } else if (arg == "GET") {
+      if (++i >= args.size()) {
+        return (*cntx)->SendError(kSyntaxErr);
+      }
+      get_patterns.push_back(ArgS(args, i));
     } else if (arg == "LIMIT") {
       int offset, limit;
       if (i + 2 >= args.size()) {
@@ -982,6 +1419,9 @@ void GenericFamily::Sort(CmdArgList args, ConnectionContext* cntx) {
     }
   }
 
+  if (by_pattern || !get_patterns.empty())
+    return SortWithPatterns(key, alpha, reversed, bounds, by_pattern, get_patterns, cntx);
+
   OpResultTyped<SortEntryList> fetch_result =
       cntx->transaction->ScheduleSingleHopT([&](Transaction* t, EngineShard* shard) {
         return OpFetchSortEntries(t->GetOpArgs(shard), key, alpha);
@@ -995,16 +1435,16 @@ void GenericFamily::Sort(CmdArgList args, ConnectionContext* cntx) {
 
   auto result_type = fetch_result.type();
   auto sort_call = [cntx, bounds, reversed, result_type](auto& entries) {
+    auto cmp = [reversed](const auto& lhs, const auto& rhs) {
+      return bool(lhs.Cmp() < rhs.Cmp()) ^ reversed;
+    };
     if (bounds) {
       auto sort_it = entries.begin() + std::min(bounds->first + bounds->second, entries.size());
-      std::partial_sort(entries.begin(), sort_it, entries.end(),
-                        [reversed](const auto& lhs, const auto& rhs) {
-                          return bool(lhs.Cmp() < rhs.Cmp()) ^ reversed;
-                        });
+      std::partial_sort(entries.begin(), sort_it, entries.end(), cmp);
+    } else if (entries.size() >= kParallelSortThreshold) {
+      ParallelSort(entries.begin(), entries.end(), cmp);
     } else {
-      std::sort(entries.begin(), entries.end(), [reversed](const auto& lhs, const auto& rhs) {
-        return bool(lhs.Cmp() < rhs.Cmp()) ^ reversed;
-      });
+      std::sort(entries.begin(), entries.end(), cmp);
     }
 
     auto start_it = entries.begin();
@@ -1122,6 +1562,53 @@ void GenericFamily::RenameNx(CmdArgList args, ConnectionContext* cntx) {
   }
 }
 
+void GenericFamily::Copy(CmdArgList args, ConnectionContext* cntx) {
+  string_view src_key = ArgS(args, 0);
+  string_view dest_key = ArgS(args, 1);
+  bool replace = false;
+
+  for (size_t i = 2; i < args.size(); ++i) {
+    ToUpper(&args[i]);
+    string_view opt = ArgS(args, i);
+    if (opt == "REPLACE") {
+      replace = true;
+    } else if (opt == "DB") {
+      return (*cntx)->SendError("DB option is not supported");
+    } else {
+      return (*cntx)->SendError(kSyntaxErr);
+    }
+  }
+
+  Transaction* transaction = cntx->transaction;
+  OpStatus status;
+
+  if (transaction->GetUniqueShardCnt() == 1) {
+    auto cb = [&](Transaction* t, EngineShard* shard) {
+      OpStatus st = OpCopy(t->GetOpArgs(shard), src_key, dest_key, replace);
+      // With a single shard the replica can replay the COPY command verbatim.
+      t->RenableAutoJournal();
+      return st;
+    };
+    status = transaction->ScheduleSingleHop(std::move(cb));
+  } else {
+    transaction->Schedule();
+    Copier copier{Shard(src_key, shard_set->size())};
+    copier.Find(transaction);
+    copier.Finalize(transaction, replace);
+    status = copier.status();
+  }
+
+  switch (status) {
+    case OpStatus::OK:
+      return (*cntx)->SendLong(1);
+    case OpStatus::KEY_NOTFOUND:
+    case OpStatus::KEY_EXISTS:
+      return (*cntx)->SendLong(0);
+    default:
+      return (*cntx)->SendError(status);
+  }
+}
+
 void GenericFamily::Ttl(CmdArgList args, ConnectionContext* cntx) {
   TtlGeneric(args, cntx, TimeUnit::SEC);
 }
@@ -1167,12 +1654,10 @@ void GenericFamily::Select(CmdArgList args, ConnectionContext* cntx) {
     return (*cntx)->SendError(kDbIndOutOfRangeErr);
   }
   cntx->conn_state.db_index = index;
-  auto cb = [index](EngineShard* shard) {
-    shard->db_slice().ActivateDb(index);
-    return OpStatus::OK;
-  };
-  shard_set->RunBriefInParallel(std::move(cb));
 
+  // No hop to the shards: the tables are activated lazily by the first operation that
+  // touches the database (DbSlice::Acquire), so selecting an idle database is free and
+  // hundreds of mostly-empty logical databases cost no table memory.
   return (*cntx)->SendOk();
 }
 
@@ -1212,6 +1697,64 @@ void GenericFamily::Type(CmdArgList args, ConnectionContext* cntx) {
   }
 }
 
+void GenericFamily::Object(CmdArgList args, ConnectionContext* cntx) {
+  ToUpper(&args[0]);
+  string_view sub = ArgS(args, 0);
+
+  if (sub == "HELP") {
+    string_view help_arr[] = {
+        "OBJECT <subcommand> [<arg>]. Subcommands are:",
+        "IDLETIME <key>",
+        "\tReturn seconds since the last sampled access of <key> (minute granularity),",
+        "\tor -1 if the key was never sampled.",
+        "FREQ <key>",
+        "\tReturn the sampled access counter of <key>.",
+        "HELP",
+        "\tPrints this help.",
+    };
+    return (*cntx)->SendSimpleStrArr(help_arr);
+  }
+
+  if (args.size() != 2 || (sub != "IDLETIME" && sub != "FREQ")) {
+    return (*cntx)->SendError(UnknownSubCmd(sub, "OBJECT"), kSyntaxErrType);
+  }
+
+  if (absl::GetFlag(FLAGS_access_clock_sampling) == 0) {
+    return (*cntx)->SendError("OBJECT requires --access_clock_sampling to be enabled");
+  }
+
+  string_view key = ArgS(args, 1);
+  ShardId sid = Shard(key, shard_set->size());
+  DbIndex db_index = cntx->db_index();
+
+  auto cb = [&]() -> OpResult<std::optional<std::pair<uint32_t, uint8_t>>> {
+    auto& db_slice = EngineShard::tlocal()->db_slice();
+    DbTable* table = db_slice.GetDBTable(db_index);
+    if (!table || !IsValid(table->prime.Find(key)))
+      return OpStatus::KEY_NOTFOUND;
+    return table->GetAccessInfo(key);
+  };
+
+  auto result = shard_set->Await(sid, std::move(cb));
+  if (!result) {
+    return (*cntx)->SendError(kKeyNotFoundErr);
+  }
+
+  if (sub == "FREQ") {
+    return (*cntx)->SendLong(*result ? (*result)->second : 0);
+  }
+
+  // IDLETIME. The clock stores minutes modulo 2^kAccessMinBits, so subtract modulo as well -
+  // correct for any idle period under ~30 years.
+  if (!*result) {
+    return (*cntx)->SendLong(-1);
+  }
+  constexpr uint32_t kMinMask = (1u << DbTable::kAccessMinBits) - 1;
+  uint32_t now_min = (GetCurrentTimeMs() / 60000) & kMinMask;
+  uint32_t idle_min = (now_min - (*result)->first) & kMinMask;
+  return (*cntx)->SendLong(int64_t(idle_min) * 60);
+}
+
 void GenericFamily::Time(CmdArgList args, ConnectionContext* cntx) {
   uint64_t now_usec;
   if (cntx->transaction) {
@@ -1288,6 +1831,61 @@ void GenericFamily::Scan(CmdArgList args, ConnectionContext* cntx) {
   }
 }
 
+void GenericFamily::RandomKey(CmdArgList args, ConnectionContext* cntx) {
+  DbIndex db_index = cntx->conn_state.db_index;
+
+  // Pick a shard with probability proportional to its key count, so that keys are sampled
+  // uniformly across the whole database, then draw a random slot inside that shard's table.
+  vector<size_t> sizes(shard_set->size());
+  shard_set->RunBriefInParallel([&](EngineShard* shard) {
+    sizes[shard->shard_id()] = shard->db_slice().DbSize(db_index);
+  });
+
+  size_t total = 0;
+  for (size_t sz : sizes)
+    total += sz;
+  if (total == 0) {
+    return (*cntx)->SendNull();
+  }
+
+  absl::InsecureBitGen gen;
+  size_t pos = absl::Uniform<size_t>(gen, 0, total);
+  ShardId sid = 0;
+  while (pos >= sizes[sid]) {
+    pos -= sizes[sid];
+    ++sid;
+  }
+
+  DbContext db_cntx{.db_index = db_index, .time_now_ms = GetCurrentTimeMs()};
+  OpResult<string> result = shard_set->Await(sid, [&]() -> OpResult<string> {
+    auto& db_slice = EngineShard::tlocal()->db_slice();
+    auto [prime_table, expire_table] = db_slice.GetTables(db_cntx.db_index);
+
+    absl::InsecureBitGen shard_gen;
+    for (unsigned attempts = 0; attempts < 10; ++attempts) {
+      PrimeIterator it = prime_table->SampleUniform(shard_gen);
+      if (it.is_done())
+        break;
+
+      // Do not expose a key that is already logically expired.
+      if (it->second.HasExpire()) {
+        auto [prime_it, expire_it] = db_slice.ExpireIfNeeded(db_cntx, it);
+        if (!IsValid(prime_it))
+          continue;
+        it = prime_it;
+      }
+
+      return it->first.ToString();
+    }
+    return OpStatus::KEY_NOTFOUND;
+  });
+
+  if (result) {
+    return (*cntx)->SendBulkString(*result);
+  }
+  (*cntx)->SendNull();
+}
+
 OpResult<uint64_t> GenericFamily::OpTtl(Transaction* t, EngineShard* shard, string_view key) {
   auto& db_slice = shard->db_slice();
   auto [it, expire_it] = db_slice.FindExt(t->GetDbContext(), key);
@@ -1463,14 +2061,18 @@ void GenericFamily::Register(CommandRegistry* registry) {
             << CI{"PEXPIREAT", CO::WRITE | CO::FAST | CO::NO_AUTOJOURNAL, 3, 1, 1, 1}.HFUNC(
                    PexpireAt)
             << CI{"PEXPIRE", CO::WRITE | CO::FAST | CO::NO_AUTOJOURNAL, 3, 1, 1, 1}.HFUNC(Pexpire)
+            << CI{"MPEXPIRE", CO::WRITE | CO::NO_AUTOJOURNAL, -3, 2, -1, 1}.HFUNC(MPexpire)
             << CI{"RENAME", CO::WRITE | CO::NO_AUTOJOURNAL, 3, 1, 2, 1}.HFUNC(Rename)
             << CI{"RENAMENX", CO::WRITE | CO::NO_AUTOJOURNAL, 3, 1, 2, 1}.HFUNC(RenameNx)
+            << CI{"COPY", CO::WRITE | CO::NO_AUTOJOURNAL, -3, 1, 2, 1}.HFUNC(Copy)
             << CI{"SELECT", kSelectOpts, 2, 0, 0, 0}.HFUNC(Select)
             << CI{"SCAN", CO::READONLY | CO::FAST | CO::LOADING, -2, 0, 0, 0}.HFUNC(Scan)
+            << CI{"RANDOMKEY", CO::READONLY | CO::FAST, 1, 0, 0, 0}.HFUNC(RandomKey)
             << CI{"TTL", CO::READONLY | CO::FAST, 2, 1, 1, 1}.HFUNC(Ttl)
             << CI{"PTTL", CO::READONLY | CO::FAST, 2, 1, 1, 1}.HFUNC(Pttl)
             << CI{"TIME", CO::LOADING | CO::FAST, 1, 0, 0, 0}.HFUNC(Time)
             << CI{"TYPE", CO::READONLY | CO::FAST | CO::LOADING, 2, 1, 1, 1}.HFUNC(Type)
+            << CI{"OBJECT", CO::READONLY | CO::FAST, -2, 0, 0, 0}.HFUNC(Object)
             << CI{"DUMP", CO::READONLY, 2, 1, 1, 1}.HFUNC(Dump)
             << CI{"UNLINK", CO::WRITE, -2, 1, -1, 1}.HFUNC(Del)
             << CI{"STICK", CO::WRITE, -2, 1, -1, 1}.HFUNC(Stick)
@@ -44,20 +44,24 @@ class GenericFamily {
   static void Keys(CmdArgList args, ConnectionContext* cntx);
   static void PexpireAt(CmdArgList args, ConnectionContext* cntx);
   static void Pexpire(CmdArgList args, ConnectionContext* cntx);
+  static void MPexpire(CmdArgList args, ConnectionContext* cntx);
   static void Stick(CmdArgList args, ConnectionContext* cntx);
   static void Sort(CmdArgList args, ConnectionContext* cntx);
   static void Move(CmdArgList args, ConnectionContext* cntx);
 
   static void Rename(CmdArgList args, ConnectionContext* cntx);
   static void RenameNx(CmdArgList args, ConnectionContext* cntx);
+  static void Copy(CmdArgList args, ConnectionContext* cntx);
   static void Ttl(CmdArgList args, ConnectionContext* cntx);
   static void Pttl(CmdArgList args, ConnectionContext* cntx);
 
   static void Echo(CmdArgList args, ConnectionContext* cntx);
   static void Select(CmdArgList args, ConnectionContext* cntx);
   static void Scan(CmdArgList args, ConnectionContext* cntx);
+  static void RandomKey(CmdArgList args, ConnectionContext* cntx);
   static void Time(CmdArgList args, ConnectionContext* cntx);
   static void Type(CmdArgList args, ConnectionContext* cntx);
+  static void Object(CmdArgList args, ConnectionContext* cntx);
   static void Dump(CmdArgList args, ConnectionContext* cntx);
   static void Restore(CmdArgList args, ConnectionContext* cntx);
 
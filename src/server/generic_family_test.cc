@@ -24,6 +24,8 @@ using namespace util;
 using namespace boost;
 using absl::StrCat;
 
+ABSL_DECLARE_FLAG(uint32_t, lazyfree_threshold);
+
 namespace dfly {
 
 class GenericFamilyTest : public BaseFamilyTest {};
@@ -75,6 +77,22 @@ TEST_F(GenericFamilyTest, Expire) {
   EXPECT_THAT(resp, ArgType(RespExpr::NIL));
 }
 
+TEST_F(GenericFamilyTest, MPexpire) {
+  Run({"mset", "x", "0", "y", "0", "z", "0"});
+
+  // Returns the number of keys whose expiry was set; missing keys are skipped.
+  auto resp = Run({"mpexpire", "2000", "x", "y", "unknown"});
+  EXPECT_THAT(resp, IntArg(2));
+
+  EXPECT_THAT(Run({"pttl", "x"}), IntArg(2000));
+  EXPECT_THAT(Run({"pttl", "y"}), IntArg(2000));
+  EXPECT_THAT(Run({"pttl", "z"}), IntArg(-1));
+
+  AdvanceTime(2000);
+  EXPECT_THAT(Run({"get", "x"}), ArgType(RespExpr::NIL));
+  EXPECT_THAT(Run({"get", "z"}), "0");
+}
+
 TEST_F(GenericFamilyTest, Del) {
   for (size_t i = 0; i < 1000; ++i) {
     Run({"set", StrCat("foo", i), "1"});
@@ -104,6 +122,26 @@ TEST_F(GenericFamilyTest, Del) {
   Run({"del", "k1"});
 }
 
+TEST_F(GenericFamilyTest, UnlinkLargeSet) {
+  absl::SetFlag(&FLAGS_lazyfree_threshold, 100);
+
+  vector<string> cmd = {"sadd", "s"};
+  for (size_t i = 0; i < 500; ++i)
+    cmd.push_back(StrCat("member", i));
+  ASSERT_THAT(Run(absl::MakeSpan(cmd)), IntArg(500));
+
+  // The container is detached and destroyed on a background fiber; the key itself
+  // disappears synchronously.
+  EXPECT_EQ(1, CheckedInt({"unlink", "s"}));
+  EXPECT_EQ(0, CheckedInt({"exists", "s"}));
+
+  // The name is immediately reusable.
+  EXPECT_EQ(1, CheckedInt({"sadd", "s", "x"}));
+  EXPECT_EQ(1, CheckedInt({"scard", "s"}));
+
+  absl::SetFlag(&FLAGS_lazyfree_threshold, 10000);
+}
+
 TEST_F(GenericFamilyTest, TTL) {
   EXPECT_EQ(-2, CheckedInt({"ttl", "foo"}));
   EXPECT_EQ(-2, CheckedInt({"pttl", "foo"}));
@@ -212,6 +250,45 @@ TEST_F(GenericFamilyTest, RenameSameName) {
   EXPECT_EQ(Run({"rename", kKey, kKey}), "OK");
 }
 
+TEST_F(GenericFamilyTest, Copy) {
+  string x_val(32, 'x');
+
+  ASSERT_THAT(Run({"copy", "x", "b"}), IntArg(0));  // no such key
+
+  Run({"set", "x", x_val});
+  ASSERT_THAT(Run({"copy", "x", "b"}), IntArg(1));
+  ASSERT_EQ(2, last_cmd_dbg_info_.shards_count);
+  ASSERT_EQ(Run({"get", "x"}), x_val);  // source survives, unlike rename.
+  ASSERT_EQ(Run({"get", "b"}), x_val);
+
+  Run({"set", "b", "other"});
+  ASSERT_THAT(Run({"copy", "x", "b"}), IntArg(0));  // destination exists
+  ASSERT_THAT(Run({"copy", "x", "b", "REPLACE"}), IntArg(1));
+  ASSERT_EQ(Run({"get", "b"}), x_val);
+}
+
+TEST_F(GenericFamilyTest, CopyNonString) {
+  EXPECT_EQ(1, CheckedInt({"lpush", "src", "elem"}));
+  EXPECT_EQ(2, CheckedInt({"lpush", "src", "elem2"}));
+
+  ASSERT_THAT(Run({"copy", "src", "dst"}), IntArg(1));
+
+  auto resp = Run({"lrange", "dst", "0", "-1"});
+  ASSERT_THAT(resp, ArrLen(2));
+
+  // The copy is deep: mutating one side does not affect the other.
+  EXPECT_EQ(3, CheckedInt({"lpush", "dst", "elem3"}));
+  EXPECT_EQ(2, CheckedInt({"llen", "src"}));
+}
+
+TEST_F(GenericFamilyTest, CopyExpire) {
+  Run({"set", "x", "val"});
+  Run({"pexpire", "x", "100000"});
+
+  ASSERT_THAT(Run({"copy", "x", "b"}), IntArg(1));
+  EXPECT_THAT(CheckedInt({"pttl", "b"}), testing::Gt(0));
+}
+
 TEST_F(GenericFamilyTest, Stick) {
   // check stick returns zero on non-existent keys
   ASSERT_THAT(Run({"stick", "a", "b"}), IntArg(0));
@@ -321,6 +398,31 @@ TEST_F(GenericFamilyTest, Scan) {
   vec = StrArray(resp.GetVec()[1]);
   EXPECT_EQ(10, vec.size());
   EXPECT_THAT(vec, Each(StartsWith("zset")));
+
+  // Literal pattern without wildcards - exercises the exact-match fast path.
+  resp = Run({"scan", "0", "count", "100", "match", "str5"});
+  vec = StrArray(resp.GetVec()[1]);
+  EXPECT_THAT(vec, ElementsAre("str5"));
+
+  // Prefix followed by a non-trailing wildcard still reaches the glob matcher.
+  resp = Run({"scan", "0", "count", "100", "match", "set?"});
+  vec = StrArray(resp.GetVec()[1]);
+  EXPECT_EQ(10, vec.size());
+  EXPECT_THAT(vec, Each(StartsWith("set")));
+}
+
+TEST_F(GenericFamilyTest, RandomKey) {
+  auto resp = Run({"randomkey"});
+  EXPECT_THAT(resp, ArgType(RespExpr::NIL));
+
+  for (unsigned i = 0; i < 100; ++i)
+    Run({"set", absl::StrCat("key", i), "bar"});
+
+  for (unsigned i = 0; i < 10; ++i) {
+    resp = Run({"randomkey"});
+    ASSERT_THAT(resp, ArgType(RespExpr::STRING));
+    EXPECT_THAT(resp.GetString(), StartsWith("key"));
+  }
 }
 
 TEST_F(GenericFamilyTest, Sort) {
@@ -388,6 +490,42 @@ TEST_F(GenericFamilyTest, Sort) {
   ASSERT_THAT(Run({"sort", "list-2"}), ErrArg("One or more scores can't be converted into double"));
 }
 
+TEST_F(GenericFamilyTest, SortByGet) {
+  Run({"rpush", "items", "a", "b", "c"});
+  Run({"mset", "weight_a", "3", "weight_b", "1", "weight_c", "2"});
+  Run({"mset", "data_a", "va", "data_b", "vb", "data_c", "vc"});
+
+  // BY external weights.
+  ASSERT_THAT(Run({"sort", "items", "BY", "weight_*"}).GetVec(), ElementsAre("b", "c", "a"));
+  ASSERT_THAT(Run({"sort", "items", "BY", "weight_*", "DESC"}).GetVec(),
+              ElementsAre("a", "c", "b"));
+  ASSERT_THAT(Run({"sort", "items", "BY", "weight_*", "LIMIT", "0", "2"}).GetVec(),
+              ElementsAre("b", "c"));
+
+  // A missing weight key sorts as zero.
+  Run({"rpush", "items", "d"});
+  ASSERT_THAT(Run({"sort", "items", "BY", "weight_*"}).GetVec(), ElementsAre("d", "b", "c", "a"));
+  Run({"rpop", "items"});
+
+  // A pattern without '*' disables sorting but keeps the list order.
+  ASSERT_THAT(Run({"sort", "items", "BY", "nosort"}).GetVec(), ElementsAre("a", "b", "c"));
+
+  // GET patterns, '#' returns the element itself.
+  ASSERT_THAT(Run({"sort", "items", "BY", "weight_*", "GET", "data_*"}).GetVec(),
+              ElementsAre("vb", "vc", "va"));
+  ASSERT_THAT(Run({"sort", "items", "BY", "weight_*", "GET", "#", "GET", "data_*"}).GetVec(),
+              ElementsAre("b", "vb", "c", "vc", "a", "va"));
+
+  // A GET pattern that misses yields nils.
+  ASSERT_THAT(Run({"sort", "items", "BY", "weight_*", "GET", "missing_*"}).GetVec(),
+              ElementsAre(ArgType(RespExpr::NIL), ArgType(RespExpr::NIL), ArgType(RespExpr::NIL)));
+
+  // ALPHA sort by external string values.
+  Run({"mset", "weight_a", "x", "weight_b", "z", "weight_c", "y"});
+  ASSERT_THAT(Run({"sort", "items", "BY", "weight_*", "ALPHA"}).GetVec(),
+              ElementsAre("a", "c", "b"));
+}
+
 TEST_F(GenericFamilyTest, Time) {
   auto resp = Run({"time"});
   EXPECT_THAT(resp, ArrLen(2));
@@ -428,18 +566,18 @@ TEST_F(GenericFamilyTest, Persist) {
 }
 
 TEST_F(GenericFamilyTest, Dump) {
-  // The following would only work for RDB version 9
-  // The format was changed at version 10
-  // The expected results were taken from running the same with Redis branch 6.2
-  ASSERT_THAT(RDB_VERSION, 9);
-  uint8_t EXPECTED_STRING_DUMP[13] = {0x00, 0xc0, 0x13, 0x09, 0x00, 0x23, 0x13,
-                                      0x6f, 0x4d, 0x68, 0xf6, 0x35, 0x6e};
-  uint8_t EXPECTED_HASH_DUMP[] = {0x0d, 0x12, 0x12, 0x00, 0x00, 0x00, 0x0d, 0x00, 0x00, 0x00,
-                                  0x02, 0x00, 0x00, 0xfe, 0x13, 0x03, 0xc0, 0xd2, 0x04, 0xff,
-                                  0x09, 0x00, 0xb1, 0x0b, 0xae, 0x6c, 0x23, 0x5d, 0x17, 0xaa};
+  // The following would only work for RDB version 10
+  // The expected results are the same as Redis 7 produces, except that lists
+  // still dump as RDB_TYPE_LIST_QUICKLIST with ziplist nodes.
+  ASSERT_THAT(RDB_VERSION, 10);
+  uint8_t EXPECTED_STRING_DUMP[13] = {0x00, 0xc0, 0x13, 0x0a, 0x00, 0xf3, 0xe1,
+                                      0x3e, 0x81, 0x3c, 0x70, 0x56, 0xdf};
+  uint8_t EXPECTED_HASH_DUMP[] = {0x10, 0x0c, 0x0c, 0x00, 0x00, 0x00, 0x02, 0x00,
+                                  0x13, 0x01, 0xc4, 0xd2, 0x02, 0xff, 0x0a, 0x00,
+                                  0xb8, 0xbf, 0x22, 0x68, 0x5b, 0xa5, 0x2c, 0x76};
   uint8_t EXPECTED_LIST_DUMP[] = {0x0e, 0x01, 0x0e, 0x0e, 0x00, 0x00, 0x00, 0x0a, 0x00,
-                                  0x00, 0x00, 0x01, 0x00, 0x00, 0xfe, 0x14, 0xff, 0x09,
-                                  0x00, 0xba, 0x1e, 0xa9, 0x6b, 0xba, 0xfe, 0x2d, 0x3f};
+                                  0x00, 0x00, 0x01, 0x00, 0x00, 0xfe, 0x14, 0xff, 0x0a,
+                                  0x00, 0x6a, 0xec, 0xf8, 0xa7, 0xee, 0x78, 0x4e, 0x8e};
 
   // Check string dump
   auto resp = Run({"set", "z", "19"});
@@ -30,11 +30,18 @@ using namespace facade;
 namespace {
 
 constexpr size_t kMaxListPackLen = 1024;
+
+// Read-mostly hashes may stay listpack-encoded up to this size: scanning a flat blob a bit
+// beyond the soft bound is cheaper than paying StringMap overhead for containers that barely
+// mutate. Under sustained write pressure we convert at kMaxListPackLen as before.
+constexpr size_t kMaxColdListPackLen = 4 * kMaxListPackLen;
+constexpr unsigned kWritePressureThreshold = 8;
+
 using IncrByParam = std::variant<double, int64_t>;
 using OptStr = std::optional<std::string>;
 enum GetAllMode : uint8_t { FIELDS = 1, VALUES = 2 };
 
-bool IsGoodForListpack(CmdArgList args, const uint8_t* lp) {
+bool IsGoodForListpack(CmdArgList args, const uint8_t* lp, unsigned write_pressure) {
   size_t sum = 0;
   for (auto s : args) {
     if (s.size() > server.hash_max_listpack_value)
@@ -42,7 +49,8 @@ bool IsGoodForListpack(CmdArgList args, const uint8_t* lp) {
     sum += s.size();
   }
 
-  return lpBytes(const_cast<uint8_t*>(lp)) + sum < kMaxListPackLen;
+  size_t limit = write_pressure >= kWritePressureThreshold ? kMaxListPackLen : kMaxColdListPackLen;
+  return lpBytes(const_cast<uint8_t*>(lp)) + sum < limit;
 }
 
 using container_utils::GetStringMap;
@@ -50,9 +58,8 @@ using container_utils::LpFind;
 using container_utils::LpGetView;
 
 pair<uint8_t*, bool> LpDelete(uint8_t* lp, string_view field) {
-  uint8_t* fptr = lpFirst(lp);
-  DCHECK(fptr);
-  fptr = lpFind(lp, fptr, (unsigned char*)field.data(), field.size(), 1);
+  uint8_t* fsrc = field.empty() ? lp : (uint8_t*)field.data();
+  uint8_t* fptr = lpFindField(lp, fsrc, field.size());
   if (fptr == NULL) {
     return make_pair(lp, false);
   }
@@ -69,7 +76,6 @@ pair<uint8_t*, bool> LpDelete(uint8_t* lp, string_view field) {
 pair<uint8_t*, bool> LpInsert(uint8_t* lp, string_view field, string_view val, bool skip_exists) {
   uint8_t* vptr;
 
-  uint8_t* fptr = lpFirst(lp);
   uint8_t* fsrc = field.empty() ? lp : (uint8_t*)field.data();
 
   // if we vsrc is NULL then lpReplace will delete the element, which is not what we want.
@@ -79,8 +85,8 @@ pair<uint8_t*, bool> LpInsert(uint8_t* lp, string_view field, string_view val, b
 
   bool updated = false;
 
-  if (fptr) {
-    fptr = lpFind(lp, fptr, fsrc, field.size(), 1);
+  {
+    uint8_t* fptr = lpFindField(lp, fsrc, field.size());
     if (fptr) {
       if (skip_exists) {
         return make_pair(lp, false);
@@ -179,8 +185,11 @@ OpStatus OpIncrBy(const OpArgs& op_args, string_view key, string_view field, Inc
       uint8_t* lp = (uint8_t*)pv.RObjPtr();
       lpb = lpBytes(lp);
       stats->listpack_bytes -= lpb;
+      pv.BumpWritePressure();
 
-      if (lpb >= kMaxListPackLen) {
+      size_t limit = pv.WritePressure() >= kWritePressureThreshold ? kMaxListPackLen
+                                                                   : kMaxColdListPackLen;
+      if (lpb >= limit) {
         stats->listpack_blob_cnt--;
         StringMap* sm = HSetFamily::ConvertToStrMap(lp);
         pv.InitRobj(OBJ_HASH, kEncodingStrMap2, sm);
@@ -221,13 +230,21 @@ OpStatus OpIncrBy(const OpArgs& op_args, string_view key, string_view field, Inc
     DCHECK_EQ(enc, kEncodingStrMap2);
     StringMap* sm = GetStringMap(pv, op_args.db_cntx);
 
+    // Prefer the inline integer representation - it avoids materializing the value
+    // into an sds just to parse it back.
+    optional<int64_t> ival;
     sds val = nullptr;
     if (!inserted) {
-      val = sm->Find(field);
+      ival = sm->FindInt(field);
+      if (!ival)
+        val = sm->Find(field);
     }
 
     optional<string_view> sv;
-    if (val) {
+    absl::AlphaNum an(ival.value_or(0));
+    if (ival) {
+      sv.emplace(an.Piece());
+    } else if (val) {
       sv.emplace(val, sdslen(val));
     }
 
@@ -242,10 +259,9 @@ OpStatus OpIncrBy(const OpArgs& op_args, string_view key, string_view field, Inc
       char buf[128];
       char* str = RedisReplyBuilder::FormatDouble(new_val, buf, sizeof(buf));
       sm->AddOrUpdate(field, str);
-    } else {  // integer increment
+    } else {  // integer increment, stored as a tagged int64 and updated in place.
       int64_t new_val = get<int64_t>(*param);
-      absl::AlphaNum an(new_val);
-      sm->AddOrUpdate(field, an.Piece());
+      sm->AddOrUpdateInt(field, new_val);
     }
   }
 
@@ -305,15 +321,11 @@ OpResult<StringVec> OpScan(const OpArgs& op_args, std::string_view key, uint64_t
 
     long max_iterations = count * INTERATION_FACTOR;
 
-    // note about this lambda - don't capture here! it should be convertible to C function!
     auto scanCb = [&](const void* obj) {
-      sds val = (sds)obj;
-      size_t len = sdslen(val);
-      if (scan_op.Matches(string_view(val, len))) {
-        res.emplace_back(val, len);
-        val += (len + 1);
-        val = (sds)absl::little_endian::Load64(val);
-        res.emplace_back(val, sdslen(val));
+      auto entry = sm->EntryPair(obj);
+      if (scan_op.Matches(string_view(entry.first, sdslen(entry.first)))) {
+        res.emplace_back(entry.first, sdslen(entry.first));
+        res.emplace_back(entry.second, sdslen(entry.second));
       }
     };
 
@@ -401,6 +413,7 @@ OpResult<vector<OptStr>> OpMGet(const OpArgs& op_args, std::string_view key, Cmd
     return it_res.status();
 
   PrimeValue& pv = (*it_res)->second;
+  pv.DecayWritePressure();
 
   std::vector<OptStr> result(fields.size());
 
@@ -496,6 +509,7 @@ OpResult<string> OpGet(const OpArgs& op_args, string_view key, string_view field
 
   const PrimeValue& pv = (*it_res)->second;
   void* ptr = pv.RObjPtr();
+  pv.DecayWritePressure();
 
   if (pv.Encoding() == kEncodingListPack) {
     uint8_t intbuf[LP_INTBUF_SIZE];
@@ -526,6 +540,7 @@ OpResult<vector<string>> OpGetAll(const OpArgs& op_args, string_view key, uint8_
   }
 
   const PrimeValue& pv = (*it_res)->second;
+  pv.DecayWritePressure();
 
   vector<string> res;
   bool keyval = (mask == (FIELDS | VALUES));
@@ -639,8 +654,9 @@ OpResult<uint32_t> OpSet(const OpArgs& op_args, string_view key, CmdArgList valu
   if (pv.Encoding() == kEncodingListPack) {
     lp = (uint8_t*)pv.RObjPtr();
     stats->listpack_bytes -= lpBytes(lp);
+    pv.BumpWritePressure();
 
-    if (op_sp.ttl != UINT32_MAX || !IsGoodForListpack(values, lp)) {
+    if (op_sp.ttl != UINT32_MAX || !IsGoodForListpack(values, lp, pv.WritePressure())) {
       stats->listpack_blob_cnt--;
       StringMap* sm = HSetFamily::ConvertToStrMap(lp);
       pv.InitRobj(OBJ_HASH, kEncodingStrMap2, sm);
@@ -225,6 +225,33 @@ TEST_F(HSetFamilyTest, TriggerConvertToStrMap) {
   EXPECT_THAT(Run({"HLEN", "hk"}), IntArg(kElements));
 }
 
+TEST_F(HSetFamilyTest, AdaptiveListpackConversion) {
+  auto encoding = [&](const char* key) {
+    string s = Run({"debug", "object", key}).GetString();
+    return s.substr(0, s.find(' '));
+  };
+
+  Run({"HSET", "small", "a", "b"});
+  string listpack_enc = encoding("small");
+
+  // A write-heavy hash converts to StringMap once it crosses the soft size bound.
+  for (int i = 0; i < 100; i++) {
+    Run({"HSET", "hot", absl::StrCat("Field-", i), absl::StrCat("Value-", i)});
+  }
+  EXPECT_NE(listpack_enc, encoding("hot"));
+
+  // The same fields written with interleaved reads keep the write pressure low, so the
+  // hash stays listpack-encoded beyond the soft bound.
+  for (int i = 0; i < 100; i++) {
+    Run({"HSET", "cold", absl::StrCat("Field-", i), absl::StrCat("Value-", i)});
+    for (int j = 0; j < 2; ++j) {
+      Run({"HGET", "cold", absl::StrCat("Field-", i)});
+    }
+  }
+  EXPECT_EQ(listpack_enc, encoding("cold"));
+  EXPECT_THAT(Run({"HLEN", "cold"}), IntArg(100));
+}
+
 TEST_F(HSetFamilyTest, Issue1140) {
   Run({"HSET", "CaseKey", "Foo", "Bar"});
 
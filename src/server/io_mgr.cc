@@ -5,6 +5,7 @@
 #include "server/io_mgr.h"
 
 #include <fcntl.h>
+#include <linux/falloc.h>
 #include <mimalloc.h>
 
 #include "base/flags.h"
@@ -70,6 +71,16 @@ error_code IoMgr::Open(const string& path) {
   return error_code{};
 }
 
+void IoMgr::OpSubmitted() {
+  if (++stats_.pending_ops > stats_.max_pending_ops)
+    stats_.max_pending_ops = stats_.pending_ops;
+}
+
+void IoMgr::OpCompleted() {
+  DCHECK_GT(stats_.pending_ops, 0u);
+  --stats_.pending_ops;
+}
+
 error_code IoMgr::GrowAsync(size_t len, GrowCb cb) {
   DCHECK_EQ(0u, len % (1 << 20));
 
@@ -83,12 +94,14 @@ error_code IoMgr::GrowAsync(size_t len, GrowCb cb) {
       [this, len, cb = move(cb)](auto*, Proactor::IoResult res, uint32_t) {
         this->flags.grow_progress = 0;
         sz_ += (res == 0 ? len : 0);
+        OpCompleted();
         cb(res);
       },
       0);
 
   entry.PrepFallocate(backing_file_->fd(), 0, sz_, len);
   flags.grow_progress = 1;
+  OpSubmitted();
 
   return error_code{};
 }
@@ -99,10 +112,16 @@ error_code IoMgr::WriteAsync(size_t offset, string_view blob, WriteCb cb) {
 
   Proactor* proactor = (Proactor*)ProactorBase::me();
 
-  auto ring_cb = [cb = move(cb)](auto*, Proactor::IoResult res, uint32_t flags) { cb(res); };
+  uint64_t start_ns = proactor->GetMonotonicTimeNs();
+  auto ring_cb = [this, start_ns, cb = move(cb)](auto*, Proactor::IoResult res, uint32_t flags) {
+    stats_.write_latency_usec += (ProactorBase::me()->GetMonotonicTimeNs() - start_ns) / 1000;
+    OpCompleted();
+    cb(res);
+  };
 
   SubmitEntry se = proactor->GetSubmitEntry(move(ring_cb), 0);
   se.PrepWrite(backing_file_->fd(), blob.data(), blob.size(), offset);
+  OpSubmitted();
 
   return error_code{};
 }
@@ -133,6 +152,65 @@ error_code IoMgr::Read(size_t offset, io::MutableBytes dest) {
   return backing_file_->Read(&v, 1, offset, 0);
 }
 
+error_code IoMgr::ReadAsync(size_t offset, io::MutableBytes dest, ReadCb cb) {
+  DCHECK(!dest.empty());
+
+  Proactor* proactor = (Proactor*)ProactorBase::me();
+
+  if (absl::GetFlag(FLAGS_backing_file_direct)) {
+    size_t read_offs = offset & ~4095ULL;
+    size_t end_range = alignup(offset + dest.size(), 4096);
+    size_t space_needed = end_range - read_offs;
+    DCHECK_EQ(0u, space_needed % 4096);
+
+    uint8_t* space = (uint8_t*)mi_malloc_aligned(space_needed, 4096);
+    auto ring_cb = [this, dest, offset, read_offs, space, space_needed,
+                    cb = move(cb)](auto*, Proactor::IoResult res, uint32_t) {
+      if (res >= 0) {
+        memcpy(dest.data(), space + offset - read_offs, dest.size());
+      }
+      mi_free_size_aligned(space, space_needed, 4096);
+      OpCompleted();
+      cb(res);
+    };
+
+    SubmitEntry se = proactor->GetSubmitEntry(move(ring_cb), 0);
+    se.PrepRead(backing_file_->fd(), space, space_needed, read_offs);
+    OpSubmitted();
+
+    return error_code{};
+  }
+
+  auto ring_cb = [this, cb = move(cb)](auto*, Proactor::IoResult res, uint32_t) {
+    OpCompleted();
+    cb(res);
+  };
+
+  SubmitEntry se = proactor->GetSubmitEntry(move(ring_cb), 0);
+  se.PrepRead(backing_file_->fd(), dest.data(), dest.size(), offset);
+  OpSubmitted();
+
+  return error_code{};
+}
+
+error_code IoMgr::PunchHoleAsync(size_t offset, size_t len, PunchCb cb) {
+  DCHECK_EQ(0u, offset % 4096);
+  DCHECK_EQ(0u, len % 4096);
+
+  Proactor* proactor = (Proactor*)ProactorBase::me();
+
+  auto ring_cb = [this, cb = move(cb)](auto*, Proactor::IoResult res, uint32_t) {
+    OpCompleted();
+    cb(res);
+  };
+
+  SubmitEntry se = proactor->GetSubmitEntry(move(ring_cb), 0);
+  se.PrepFallocate(backing_file_->fd(), FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE, offset, len);
+  OpSubmitted();
+
+  return error_code{};
+}
+
 void IoMgr::Shutdown() {
   while (flags_val) {
     ThisFiber::SleepFor(200us);  // TODO: hacky for now.
@@ -21,6 +21,21 @@ class IoMgr {
   // (io_res, )
   using GrowCb = std::function<void(int)>;
 
+  // first arg - io result.
+  using ReadCb = std::function<void(int)>;
+
+  // (io_res, )
+  using PunchCb = std::function<void(int)>;
+
+  struct Stats {
+    size_t pending_ops = 0;      // async requests submitted but not yet completed.
+    size_t max_pending_ops = 0;  // high watermark of the above.
+
+    // Cumulative submit-to-completion time of async writes; together with the
+    // write counter this gives the average device latency under load.
+    uint64_t write_latency_usec = 0;
+  };
+
   IoMgr();
 
   // blocks until all the pending requests are finished.
@@ -37,6 +52,15 @@ class IoMgr {
   std::error_code WriteAsync(size_t offset, std::string_view blob, WriteCb cb);
   std::error_code Read(size_t offset, io::MutableBytes dest);
 
+  // Like Read but does not suspend the calling fiber - the io result is returned via cb
+  // once the data has been copied into dest. A caller must make sure that dest is alive
+  // until cb is called.
+  std::error_code ReadAsync(size_t offset, io::MutableBytes dest, ReadCb cb);
+
+  // Punches a hole in the backing file, returning the range to the filesystem while
+  // keeping the file size unchanged. The range must not be reused before cb is called.
+  std::error_code PunchHoleAsync(size_t offset, size_t len, PunchCb cb);
+
   // Total file span
   size_t Span() const {
     return sz_;
@@ -46,10 +70,20 @@ class IoMgr {
     return flags.grow_progress;
   }
 
+  const Stats& GetStats() const {
+    return stats_;
+  }
+
  private:
+  // Track an operation entering/leaving the device queue.
+  void OpSubmitted();
+  void OpCompleted();
+
   std::unique_ptr<LinuxFile> backing_file_;
   size_t sz_ = 0;
 
+  Stats stats_;
+
   union {
     uint8_t flags_val;
     struct {
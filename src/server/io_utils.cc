@@ -4,10 +4,13 @@
 
 #include "server/io_utils.h"
 
+#include <chrono>
+
 #include "base/flags.h"
 #include "server/error.h"
 
 using namespace std;
+using namespace util;
 
 namespace dfly {
 
@@ -44,6 +47,17 @@ error_code BufferedStreamerBase::ConsumeIntoSink(io::Sink* dest) {
       break;
     }
 
+    // Adaptive batching: within the latency budget, let more entries pile up so
+    // they go out with a single write, unless enough bytes accumulated already
+    // or the producer stalled and waits for us to drain.
+    if (flush_window_usec_ > 0 && producer_buf_.InputLen() < flush_bytes_ && !IsStalled()) {
+      waker_.await_until(
+          [this]() {
+            return producer_buf_.InputLen() >= flush_bytes_ || IsStalled() || IsStopped();
+          },
+          chrono::steady_clock::now() + chrono::microseconds(flush_window_usec_));
+    }
+
     // Swap producer and consumer buffers
     std::swap(producer_buf_, consumer_buf_);
     buffered_ = 0;
@@ -75,4 +89,76 @@ bool BufferedStreamerBase::IsStopped() {
 bool BufferedStreamerBase::IsStalled() {
   return buffered_ > max_buffered_cnt_ || producer_buf_.InputLen() > max_buffered_mem_;
 }
+
+ReadAheadSource::ReadAheadSource(io::Source* upstream, size_t buf_size, unsigned buf_cnt)
+    : upstream_(upstream), buf_size_(buf_size), ring_(buf_cnt) {
+  for (auto& buf : ring_) {
+    buf.data.reset(new uint8_t[buf_size_]);
+  }
+  read_fb_ = MakeFiber([this] { ReadFb(); });
+}
+
+ReadAheadSource::~ReadAheadSource() {
+  stopped_ = true;
+  waker_.notifyAll();
+  read_fb_.Join();
+}
+
+void ReadAheadSource::ReadFb() {
+  while (!stopped_) {
+    waker_.await([this] { return filled_ < ring_.size() || stopped_; });
+    if (stopped_)
+      break;
+
+    Buffer& buf = ring_[wpos_];
+    iovec vec{buf.data.get(), buf_size_};
+    io::Result<size_t> res = upstream_->ReadSome(&vec, 1);
+
+    if (!res) {
+      ec_ = res.error();
+      break;
+    }
+    if (*res == 0) {
+      eof_ = true;
+      break;
+    }
+
+    buf.len = *res;
+    buf.off = 0;
+    wpos_ = (wpos_ + 1) % ring_.size();
+    ++filled_;
+    waker_.notify();
+  }
+  // Unblock a consumer waiting for data after an error or eof.
+  eof_ = eof_ || stopped_ || bool(ec_);
+  waker_.notifyAll();
+}
+
+io::Result<size_t> ReadAheadSource::ReadSome(const iovec* v, uint32_t len) {
+  waker_.await([this] { return filled_ > 0 || eof_; });
+
+  if (filled_ == 0) {
+    if (ec_)
+      return nonstd::make_unexpected(ec_);
+    return 0;  // eof
+  }
+
+  Buffer& buf = ring_[rpos_];
+  size_t copied = 0;
+  for (uint32_t i = 0; i < len && buf.off < buf.len; ++i) {
+    size_t n = min(buf.len - buf.off, v[i].iov_len);
+    memcpy(v[i].iov_base, buf.data.get() + buf.off, n);
+    buf.off += n;
+    copied += n;
+  }
+
+  if (buf.off == buf.len) {
+    rpos_ = (rpos_ + 1) % ring_.size();
+    --filled_;
+    waker_.notify();
+  }
+
+  return copied;
+}
+
 }  // namespace dfly
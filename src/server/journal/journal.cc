@@ -38,22 +38,18 @@ void Journal::StartInThread() {
   }
 }
 
-#if 0
 error_code Journal::OpenInThread(bool persistent, string_view dir) {
-
+  StartInThread();
 
   error_code ec;
 
-  if (persistent) {
+  // Only shard threads record entries, so io threads have nothing to persist.
+  if (persistent && EngineShard::tlocal() != nullptr) {
     ec = journal_slice.Open(dir);
-    if (ec) {
-      return ec;
-    }
   }
 
   return ec;
 }
-#endif
 
 error_code Journal::Close() {
   CHECK(lameduck_.load(memory_order_relaxed));
@@ -71,12 +67,12 @@ error_code Journal::Close() {
       shard->set_journal(nullptr);
     }
 
-    /*auto ec = journal_slice.Close();
+    auto ec = journal_slice.Close();
 
     if (ec) {
       lock_guard lk2(ec_mu);
       res = ec;
-    }*/
+    }
   };
 
   shard_set->pool()->AwaitFiberOnAll(close_cb);
@@ -100,6 +96,18 @@ LSN Journal::GetLsn() const {
   return journal_slice.cur_lsn();
 }
 
+bool Journal::HasBacklog(LSN from) const {
+  return journal_slice.HasBacklog(from);
+}
+
+string Journal::GetBacklog(LSN from) const {
+  return journal_slice.GetBacklog(from);
+}
+
+error_code Journal::WaitFsync(LSN lsn) {
+  return journal_slice.WaitFsync(lsn);
+}
+
 bool Journal::EnterLameDuck() {
   if (!journal_slice.IsOpen()) {
     return false;
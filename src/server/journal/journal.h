@@ -28,10 +28,10 @@ class Journal {
   // Requires: journal is in lameduck mode.
   std::error_code Close();
 
-#if 0
   // Opens journal inside a Dragonfly thread. Must be called in each thread.
+  // With persistent=true, shard threads also start persisting their entries
+  // into segment files under dir.
   std::error_code OpenInThread(bool persistent, std::string_view dir);
-#endif
 
   //******* The following functions must be called in the context of the owning shard *********//
 
@@ -54,6 +54,19 @@ class Journal {
 */
   LSN GetLsn() const;
 
+  // Whether the in-memory backlog of this thread's slice still contains every
+  // entry with lsn >= from. See JournalSlice for the backlog semantics.
+  bool HasBacklog(LSN from) const;
+
+  // Serialized entries [from, GetLsn()) from the backlog, forming a valid
+  // journal stream. Requires: HasBacklog(from).
+  std::string GetBacklog(LSN from) const;
+
+  // Block until the entry with the given lsn was made durable by the group
+  // commit scheduler of this thread's slice. Durability backend for WAIT-style
+  // options; no-op unless the journal persists to files.
+  std::error_code WaitFsync(LSN lsn);
+
   void RecordEntry(TxId txid, Op opcode, DbIndex dbid, unsigned shard_cnt, Entry::Payload payload,
                    bool await);
 
@@ -4,13 +4,38 @@
 
 #include "server/journal/journal_slice.h"
 
+#include <absl/base/internal/endian.h>
 #include <absl/container/inlined_vector.h>
 #include <absl/strings/str_cat.h>
 #include <fcntl.h>
+#include <unistd.h>
 
+#include <chrono>
 #include <filesystem>
 
+#include "base/flags.h"
 #include "base/logging.h"
+#include "io/file_util.h"
+
+ABSL_FLAG(uint64_t, journal_segment_size, 1u << 26,  // 64MB
+          "Threshold in bytes after which a journal segment file is rotated.");
+
+ABSL_FLAG(uint32_t, journal_max_segments, 16,
+          "How many journal segments to keep per shard before deleting the oldest ones. "
+          "0 disables the retention limit.");
+
+ABSL_FLAG(uint32_t, journal_fsync_interval_ms, 100,
+          "Group commit interval: how often fdatasync is issued over the current journal "
+          "segment. 0 syncs only on the byte threshold, on rotation and on explicit waits.");
+
+ABSL_FLAG(uint64_t, journal_fsync_max_bytes, 1u << 20,  // 1MB
+          "Issue fdatasync once this many unsynced bytes accumulated in the current journal "
+          "segment without waiting for the sync interval. 0 disables the byte threshold.");
+
+ABSL_FLAG(uint64_t, journal_backlog_size, 1u << 24,  // 16MB
+          "Per-shard byte budget for the in-memory backlog of recent journal entries that "
+          "serves partial replica resyncs. 0 disables the backlog, forcing a full sync on "
+          "every replica reconnect.");
 
 namespace dfly {
 namespace journal {
@@ -20,11 +45,20 @@ namespace fs = std::filesystem;
 
 namespace {
 
-/*
-string ShardName(std::string_view base, unsigned index) {
-  return absl::StrCat(base, "-", absl::Dec(index, absl::kZeroPad4), ".log");
+// Number of entries between consecutive records of the sparse segment index.
+constexpr unsigned kIndexGranularity = 1024;
+
+string SegmentName(unsigned index, LSN start_lsn) {
+  return absl::StrCat("journal-", absl::Dec(index, absl::kZeroPad4), "-",
+                      absl::Dec(start_lsn, absl::kZeroPad16), ".seg");
+}
+
+// Glob matching all segments written by the given slice, in LSN order
+// (the zero-padded LSN makes the lexicographic order the LSN order).
+string SegmentGlob(const string& dir, unsigned index) {
+  fs::path glob = fs::path{dir} / absl::StrCat("journal-", absl::Dec(index, absl::kZeroPad4), "-*.seg");
+  return glob.string();
 }
-*/
 
 }  // namespace
 
@@ -34,109 +68,327 @@ string ShardName(std::string_view base, unsigned index) {
     CHECK(!__ec$) << "Error: " << __ec$ << " " << __ec$.message() << " for " << #x; \
   } while (false)
 
-struct JournalSlice::RingItem {
-  LSN lsn;
-  TxId txid;
-  Op opcode;
+// Sink adapter that appends to the current segment file with vectored writes
+// and tracks the segment offset for rotation and the sparse index. Payload
+// iovecs submitted by JournalWriter::WriteVectored reach the file as-is, so
+// command arguments are not copied on the journal write path.
+class JournalSlice::FileSink : public io::Sink {
+ public:
+  explicit FileSink(io::WriteFile* file) : file_(file) {
+  }
+
+  io::Result<size_t> WriteSome(const iovec* v, uint32_t len) final {
+    io::Result<size_t> res = file_->WriteSome(v, len);
+    CHECK(res) << "Error writing journal segment: " << res.error().message();
+    offset_ += *res;
+    return res;
+  }
+
+  size_t offset() const {
+    return offset_;
+  }
+
+ private:
+  io::WriteFile* file_;
+  size_t offset_ = 0;
 };
 
 JournalSlice::JournalSlice() {
 }
 
 JournalSlice::~JournalSlice() {
-  // CHECK(!shard_file_);
+  // Segment files are closed via Journal::Close. We do not CHECK here because
+  // thread local slices are destroyed on abnormal exit paths as well.
 }
 
 void JournalSlice::Init(unsigned index) {
-  // if (ring_buffer_)  // calling this function multiple times is allowed and it's a no-op.
-  //   return;
-
   slice_index_ = index;
-  // ring_buffer_.emplace(128);  // TODO: to make it configurable
 }
 
-#if 0
 std::error_code JournalSlice::Open(std::string_view dir) {
-  CHECK(!shard_file_);
+  CHECK(!segment_file_);
   DCHECK_NE(slice_index_, UINT32_MAX);
 
   fs::path dir_path;
 
-  if (dir.empty()) {
-  } else {
+  if (!dir.empty()) {
     dir_path = dir;
     error_code ec;
 
-    fs::file_status dir_status = fs::status(dir_path, ec);
-    if (ec) {
-      if (ec == errc::no_such_file_or_directory) {
-        fs::create_directory(dir_path, ec);
-        dir_status = fs::status(dir_path, ec);
-      }
-      if (ec)
-        return ec;
+    fs::create_directories(dir_path, ec);
+    if (ec)
+      return ec;
+  }
+  dir_ = dir_path.string();
+
+  // Segments left over from a previous run are stale at this point: they were
+  // either replayed during startup or refer to a state we did not load.
+  io::Result<io::StatShortVec> stale = io::StatFiles(SegmentGlob(dir_, slice_index_));
+  if (stale) {
+    for (const auto& fstat : *stale) {
+      error_code ec;
+      fs::remove(fstat.name, ec);
+      fs::remove(absl::StrCat(fstat.name, ".idx"), ec);
+      VLOG(1) << "Removed stale journal segment " << fstat.name;
     }
-    // LOG(INFO) << int(dir_status.type());
   }
 
-  dir_path.append(ShardName("journal", slice_index_));
-  shard_path_ = dir_path;
+  error_code ec = OpenSegment();
+  if (!ec)
+    fsync_fb_ = MakeFiber(&JournalSlice::FsyncFb, this);
+
+  return ec;
+}
+
+error_code JournalSlice::Close() {
+  VLOG(1) << "JournalSlice::Close";
+
+  lameduck_ = true;
+  if (!segment_file_)
+    return {};
+
+  // The scheduler issues a final group commit before exiting, so a clean
+  // shutdown leaves the whole journal tail durable.
+  fsync_waker_.notify();
+  fsync_fb_.JoinIfNeeded();
+  synced_waker_.notifyAll();
+
+  DVLOG(1) << "Closing " << segment_path_;
+
+  auto ec = segment_file_->Close();
+  LOG_IF(ERROR, ec) << "Error closing journal segment " << ec;
+  segment_file_.reset();
+
+  if (index_file_) {
+    auto idx_ec = index_file_->Close();
+    LOG_IF(ERROR, idx_ec) << "Error closing journal segment index " << idx_ec;
+    index_file_.reset();
+    if (!ec)
+      ec = idx_ec;
+  }
+  writer_.reset();
+  file_sink_.reset();
+
+  if (sync_fd_ >= 0) {
+    close(sync_fd_);
+    sync_fd_ = -1;
+  }
+
+  return ec;
+}
+
+std::error_code JournalSlice::OpenSegment() {
+  segment_start_lsn_ = lsn_;
+
+  fs::path seg_path = fs::path{dir_} / SegmentName(slice_index_, segment_start_lsn_);
+  segment_path_ = seg_path.string();
 
   // For file integrity guidelines see:
   // https://lwn.net/Articles/457667/
   // https://www.evanjones.ca/durability-filesystem.html
   // NOTE: O_DSYNC is omitted.
-  constexpr auto kJournalFlags = O_CLOEXEC | O_CREAT | O_TRUNC | O_RDWR;
-  io::Result<unique_ptr<LinuxFile>> res = OpenLinux(shard_path_, kJournalFlags, 0666);
+  io::Result<io::WriteFile*> res = io::OpenWrite(segment_path_);
   if (!res) {
     return res.error();
   }
-  DVLOG(1) << "Opened journal " << shard_path_;
+  segment_file_.reset(res.value());
+
+  res = io::OpenWrite(absl::StrCat(segment_path_, ".idx"));
+  if (!res) {
+    segment_file_->Close();
+    segment_file_.reset();
+    return res.error();
+  }
+  index_file_.reset(res.value());
+
+  // The portable WriteFile does not expose its descriptor, so a second one is
+  // opened for issuing fdatasync - any descriptor of the inode covers writes
+  // done through the other.
+  sync_fd_ = open(segment_path_.c_str(), O_WRONLY | O_CLOEXEC);
+  if (sync_fd_ < 0) {
+    error_code ec{errno, system_category()};
+    segment_file_->Close();
+    segment_file_.reset();
+    index_file_->Close();
+    index_file_.reset();
+    return ec;
+  }
+
+  DVLOG(1) << "Opened journal segment " << segment_path_;
 
-  shard_file_ = std::move(res).value();
+  // A fresh writer has no current dbid, so the first entry of every segment is
+  // preceded by a SELECT and segments can be replayed independently.
+  file_sink_ = make_unique<FileSink>(segment_file_.get());
+  writer_.emplace(file_sink_.get());
   file_offset_ = 0;
   status_ec_.clear();
 
   return error_code{};
 }
 
-error_code JournalSlice::Close() {
-  VLOG(1) << "JournalSlice::Close";
+void JournalSlice::RotateSegment() {
+  // Push the tail of the segment to disk before retiring it so the durability
+  // watermark never has to reach back into closed files.
+  Fsync();
+  close(sync_fd_);
+  sync_fd_ = -1;
 
-  CHECK(shard_file_);
-  lameduck_ = true;
+  CHECK_EC(segment_file_->Close());
+  segment_file_.reset();
+  CHECK_EC(index_file_->Close());
+  index_file_.reset();
 
-  auto ec = shard_file_->Close();
+  CHECK_EC(OpenSegment());
 
-  DVLOG(1) << "Closing " << shard_path_;
-  LOG_IF(ERROR, ec) << "Error closing journal file " << ec;
-  shard_file_.reset();
+  uint32_t max_segments = absl::GetFlag(FLAGS_journal_max_segments);
+  if (max_segments == 0)
+    return;
 
-  return ec;
+  io::Result<io::StatShortVec> segments = io::StatFiles(SegmentGlob(dir_, slice_index_));
+  if (!segments || segments->size() <= max_segments)
+    return;
+
+  // StatFiles returns the files sorted, so the oldest segments come first.
+  for (size_t i = 0; i < segments->size() - max_segments; ++i) {
+    const string& name = (*segments)[i].name;
+    error_code ec;
+    fs::remove(name, ec);
+    LOG_IF(ERROR, ec) << "Error removing expired journal segment " << name << " " << ec;
+    fs::remove(absl::StrCat(name, ".idx"), ec);
+    VLOG(1) << "Removed expired journal segment " << name;
+  }
+}
+
+void JournalSlice::WriteToSegment(const Entry& entry, LSN lsn) {
+  if ((lsn - segment_start_lsn_) % kIndexGranularity == 0) {
+    uint8_t rec[16];
+    absl::little_endian::Store64(rec, lsn);
+    absl::little_endian::Store64(rec + 8, file_offset_);
+    CHECK_EC(index_file_->Write(io::Bytes{rec, sizeof(rec)}));
+  }
+
+  // The entry payload is framed by reference and lands in the file without an
+  // intermediate copy; the arguments are kept alive by the recording
+  // transaction for the duration of this call. May prepend a SELECT entry.
+  writer_->WriteVectored(entry);
+  size_t prev_offset = file_offset_;
+  file_offset_ = file_sink_->offset();
+  unsynced_bytes_ += file_offset_ - prev_offset;
+
+  uint64_t fsync_max_bytes = absl::GetFlag(FLAGS_journal_fsync_max_bytes);
+  if (fsync_max_bytes > 0 && unsynced_bytes_ >= fsync_max_bytes) {
+    fsync_waker_.notify();
+  }
+
+  if (file_offset_ >= absl::GetFlag(FLAGS_journal_segment_size)) {
+    RotateSegment();
+  }
+}
+
+void JournalSlice::FsyncFb() {
+  ThisFiber::SetName(absl::StrCat("journal_fsync", slice_index_));
+  uint32_t interval_ms = absl::GetFlag(FLAGS_journal_fsync_interval_ms);
+  uint64_t max_bytes = absl::GetFlag(FLAGS_journal_fsync_max_bytes);
+
+  while (true) {
+    auto cond = [&] {
+      return lameduck_ || fsync_waiters_ > 0 || (max_bytes > 0 && unsynced_bytes_ >= max_bytes);
+    };
+
+    if (interval_ms > 0) {
+      fsync_waker_.await_until(cond,
+                               chrono::steady_clock::now() + chrono::milliseconds(interval_ms));
+    } else {
+      fsync_waker_.await(cond);
+    }
+
+    Fsync();
+    if (lameduck_)
+      return;
+  }
+}
+
+void JournalSlice::Fsync() {
+  // The descriptor is transiently closed while a rotation is in flight.
+  if (sync_fd_ < 0)
+    return;
+
+  // AddLogRecord writes synchronously, so by now every entry below lsn_ has
+  // reached the segment and a single fdatasync covers all of them.
+  LSN watermark = lsn_;
+  if (watermark == synced_lsn_ && unsynced_bytes_ == 0)
+    return;
+
+  unsynced_bytes_ = 0;
+  if (fdatasync(sync_fd_) < 0) {
+    status_ec_ = error_code{errno, system_category()};
+    LOG(ERROR) << "Error syncing journal segment " << segment_path_ << ": "
+               << status_ec_.message();
+  } else {
+    synced_lsn_ = watermark;
+  }
+  synced_waker_.notifyAll();
+}
+
+std::error_code JournalSlice::WaitFsync(LSN lsn) {
+  if (!segment_file_)
+    return {};
+  DCHECK_LT(lsn, lsn_);
+
+  ++fsync_waiters_;
+  fsync_waker_.notify();
+  synced_waker_.await([&] { return synced_lsn_ > lsn || lameduck_ || bool(status_ec_); });
+  --fsync_waiters_;
+
+  return status_ec_;
+}
+
+void JournalSlice::PushBacklog(const Entry& entry, LSN lsn) {
+  uint64_t limit = absl::GetFlag(FLAGS_journal_backlog_size);
+  if (limit == 0)
+    return;
+
+  // A fresh writer prefixes the entry with its SELECT, so every suffix of the ring
+  // replays correctly on its own.
+  io::StringSink sink;
+  JournalWriter writer{&sink};
+  writer.Write(entry);
+
+  ring_bytes_ += sink.str().size();
+  ring_.push_back(RingItem{lsn, std::move(sink.str())});
+
+  while (ring_bytes_ > limit && !ring_.empty()) {
+    ring_bytes_ -= ring_.front().data.size();
+    ring_.pop_front();
+  }
+}
+
+bool JournalSlice::HasBacklog(LSN from) const {
+  if (from >= lsn_)  // Nothing to replay only if the replica is exactly caught up.
+    return from == lsn_;
+  return !ring_.empty() && ring_.front().lsn <= from;
+}
+
+std::string JournalSlice::GetBacklog(LSN from) const {
+  DCHECK(HasBacklog(from));
+
+  // The ring is sorted and contiguous by lsn, so the requested range is a suffix.
+  auto it = lower_bound(ring_.begin(), ring_.end(), from,
+                        [](const RingItem& item, LSN lsn) { return item.lsn < lsn; });
+  string res;
+  for (; it != ring_.end(); ++it)
+    res.append(it->data);
+  return res;
 }
-#endif
 
 void JournalSlice::AddLogRecord(const Entry& entry, bool await) {
-  // DCHECK(ring_buffer_);
   if (entry.opcode != Op::NOOP) {
-    lsn_++;
-// TODO: This is preparation for AOC style journaling, currently unused.
-#if 0
-    RingItem item;
-    item.lsn = prev_lsn;
-
-    item.opcode = entry.opcode;
-    item.txid = entry.txid;
-    VLOG(1) << "Writing item [" << item.lsn << "]: " << entry.ToString();
-    ring_buffer_->EmplaceOrOverride(move(item));
-
-    if (shard_file_) {
-      string line = absl::StrCat(item.lsn, " ", entry.txid, " ", entry.opcode, "\n");
-      error_code ec = shard_file_->Write(io::Buffer(line), file_offset_, 0);
-      CHECK_EC(ec);
-      file_offset_ += line.size();
+    LSN lsn = lsn_++;
+    if (segment_file_) {
+      DVLOG(2) << "Writing item [" << lsn << "]: " << entry.ToString();
+      WriteToSegment(entry, lsn);
     }
-#endif
+    PushBacklog(entry, lsn);
   }
 
   {
@@ -4,17 +4,38 @@
 
 #pragma once
 
+#include <deque>
+#include <memory>
 #include <optional>
+#include <string>
 #include <string_view>
 
-#include "base/ring_buffer.h"
+#include "io/file.h"
 #include "server/common.h"
+#include "server/journal/serializer.h"
 #include "server/journal/types.h"
 
 namespace dfly {
 namespace journal {
 
 // Journal slice is present for both shards and io threads.
+// When opened with a directory it also persists every LSN-bearing entry into
+// segment files named "journal-<slice>-<start_lsn>.seg". A sparse (lsn, offset)
+// index is written next to each segment ("<segment>.idx") so that recovery can
+// seek close to an arbitrary LSN without scanning the whole segment. Segments
+// are rotated once they grow beyond --journal_segment_size and at most
+// --journal_max_segments of them are kept per slice.
+//
+// Durability follows a group commit scheme: writes only reach the page cache
+// and a background fiber issues fdatasync once --journal_fsync_interval_ms
+// elapsed or --journal_fsync_max_bytes accumulated, amortizing the sync cost
+// over all entries written in between. Callers that need an explicit
+// durability guarantee block on WaitFsync() until the covering sync completed.
+//
+// Independently of file persistence, the slice keeps the most recent entries
+// serialized in an in-memory backlog ring bounded by --journal_backlog_size.
+// A reconnecting replica presenting its last applied LSN can resume from the
+// ring instead of going through a full snapshot sync.
 class JournalSlice {
  public:
   JournalSlice();
@@ -22,11 +43,13 @@ class JournalSlice {
 
   void Init(unsigned index);
 
-#if 0
+  // Start persisting entries into segment files under dir.
+  // Removes segments of this slice left over from a previous run - they
+  // describe changes relative to a state this process did not start from,
+  // and must be replayed (or copied away) before the journal is reopened.
   std::error_code Open(std::string_view dir);
 
   std::error_code Close();
-#endif
 
   // This is always the LSN of the *next* journal entry.
   LSN cur_lsn() const {
@@ -44,6 +67,21 @@ class JournalSlice {
 
   void AddLogRecord(const Entry& entry, bool await);
 
+  // Whether the in-memory backlog still contains every entry with lsn >= from.
+  // Trivially true for from == cur_lsn() - a fully caught up replica needs nothing.
+  bool HasBacklog(LSN from) const;
+
+  // Concatenation of the serialized entries [from, cur_lsn()). Every backlog entry
+  // carries its own SELECT prefix, so the result forms a valid journal stream.
+  // Requires: HasBacklog(from).
+  std::string GetBacklog(LSN from) const;
+
+  // Block until the entry with the given lsn was covered by a segment
+  // fdatasync. Triggers a group commit immediately instead of waiting for the
+  // timer to expire. Returns the sync error, if any. No-op if the journal
+  // does not persist to files.
+  std::error_code WaitFsync(LSN lsn);
+
   uint32_t RegisterOnChange(ChangeCallback cb);
   void UnregisterOnChange(uint32_t);
   bool HasRegisteredCallbacks() const {
@@ -52,17 +90,65 @@ class JournalSlice {
   }
 
  private:
-  struct RingItem;
+  struct RingItem {
+    LSN lsn;
+    std::string data;  // the serialized entry, prefixed with its own SELECT.
+  };
+
+  // Open a fresh segment starting at the current lsn_ and make it current.
+  std::error_code OpenSegment();
+
+  // Append the serialized entry to the in-memory backlog, evicting the oldest
+  // entries once the byte budget is exceeded.
+  void PushBacklog(const Entry& entry, LSN lsn);
+
+  // Close the current segment, open the next one and drop the oldest segments
+  // beyond the retention limit.
+  void RotateSegment();
+
+  // Serialize entry into the current segment, appending a sparse index record
+  // every kIndexGranularity entries.
+  void WriteToSegment(const Entry& entry, LSN lsn);
+
+  // Group commit scheduler, runs while the journal persists to files. Wakes up
+  // on the configured interval, on the byte threshold and on WaitFsync calls.
+  void FsyncFb();
+
+  // Sync the current segment and advance the durability watermark.
+  void Fsync();
+
+  std::string dir_;
+  std::string segment_path_;
+  std::unique_ptr<io::WriteFile> segment_file_;
+  std::unique_ptr<io::WriteFile> index_file_;
+
+  // Sink adapter appending to segment_file_, see journal_slice.cc.
+  class FileSink;
+  std::unique_ptr<FileSink> file_sink_;
 
-  // std::string shard_path_;
-  // std::unique_ptr<LinuxFile> shard_file_;
-  // std::optional<base::RingBuffer<RingItem>> ring_buffer_;
+  // Per-segment writer, recreated on rotation so that each segment starts with
+  // an explicit SELECT and can be replayed on its own.
+  std::optional<JournalWriter> writer_;
 
   mutable util::SharedMutex cb_mu_;
   std::vector<std::pair<uint32_t, ChangeCallback>> change_cb_arr_ ABSL_GUARDED_BY(cb_mu_);
 
   size_t file_offset_ = 0;
   LSN lsn_ = 1;
+  LSN segment_start_lsn_ = 0;
+
+  // In-memory backlog for partial resyncs, newest entries at the back.
+  std::deque<RingItem> ring_;
+  size_t ring_bytes_ = 0;
+
+  // Group commit state. All of it is accessed from the owning thread only.
+  int sync_fd_ = -1;  // Second descriptor of the current segment, for fdatasync.
+  Fiber fsync_fb_;
+  EventCount fsync_waker_;   // Wakes FsyncFb up on thresholds, waiters and close.
+  EventCount synced_waker_;  // Wakes WaitFsync callers once the watermark moves.
+  LSN synced_lsn_ = 1;       // Entries with lsn < synced_lsn_ are durable.
+  size_t unsynced_bytes_ = 0;
+  uint32_t fsync_waiters_ = 0;
 
   uint32_t slice_index_ = UINT32_MAX;
   uint32_t next_cb_id_ = 1;
@@ -4,6 +4,9 @@
 
 #include "server/journal/serializer.h"
 
+#include <absl/container/inlined_vector.h>
+#include <sys/uio.h>
+
 #include "base/io_buf.h"
 #include "base/logging.h"
 #include "io/io.h"
@@ -18,6 +21,36 @@ using namespace std;
 
 namespace dfly {
 
+namespace {
+
+// Collects the strings of an entry payload without copying them.
+struct StringCollector {
+  absl::InlinedVector<string_view, 16>* out;
+
+  void operator()(monostate) {
+  }
+
+  void operator()(const pair<string_view, CmdArgList>& p) {
+    out->push_back(p.first);
+    for (auto v : p.second)
+      out->push_back(facade::ToSV(v));
+  }
+
+  void operator()(const pair<string_view, ArgSlice>& p) {
+    out->push_back(p.first);
+    for (auto v : p.second)
+      out->push_back(v);
+  }
+};
+
+// Keep vectored writes below the kernel IOV_MAX limit.
+constexpr size_t kMaxIovLen = 1024;
+
+// Upper bound on the packed uint encoding, see WritePackedUInt.
+constexpr size_t kMaxPackedLen = 10;
+
+}  // namespace
+
 JournalWriter::JournalWriter(io::Sink* sink) : sink_{sink} {
 }
 
@@ -86,6 +119,70 @@ void JournalWriter::Write(const journal::Entry& entry) {
   };
 }
 
+void JournalWriter::WriteVectored(const journal::Entry& entry) {
+  absl::InlinedVector<string_view, 16> strs;
+  visit(StringCollector{&strs}, entry.payload);
+
+  // The scratch buffer holds everything but the payload strings themselves:
+  // an optional SELECT prefix, the entry header and the length prefixes.
+  // It must not be resized below because the iovec array points into it.
+  frame_buf_.resize(2 * (1 + kMaxPackedLen) + 4 * kMaxPackedLen +
+                    strs.size() * kMaxPackedLen);
+  uint8_t* next = frame_buf_.data();
+  auto append_uint = [&next](uint64_t v) {
+    next += WritePackedUInt(v, io::MutableBytes{next, kMaxPackedLen});
+  };
+
+  // Check if entry has a new db index and we need to emit a SELECT entry.
+  if (entry.opcode != journal::Op::SELECT && (!cur_dbid_ || entry.dbid != *cur_dbid_)) {
+    *next++ = uint8_t(journal::Op::SELECT);
+    append_uint(entry.dbid);
+    cur_dbid_ = entry.dbid;
+  }
+
+  VLOG(1) << "Writing entry " << entry.ToString();
+
+  *next++ = uint8_t(entry.opcode);
+
+  switch (entry.opcode) {
+    case journal::Op::SELECT:
+      append_uint(entry.dbid);
+      break;
+    case journal::Op::PING:
+      break;
+    default:
+      append_uint(entry.txid);
+      append_uint(entry.shard_cnt);
+      if (!strs.empty()) {
+        size_t cmd_size = 0;
+        for (auto s : strs)
+          cmd_size += s.size();
+        append_uint(strs.size());
+        append_uint(cmd_size);
+      }
+      break;
+  }
+
+  // The header and the first length prefix are contiguous in the scratch
+  // buffer, so each payload string contributes at most two iovec entries:
+  // the string itself and the length prefix of the next one.
+  absl::InlinedVector<iovec, 16> vec;
+  uint8_t* seg_start = frame_buf_.data();
+  for (auto s : strs) {
+    append_uint(s.size());
+    vec.push_back({seg_start, size_t(next - seg_start)});
+    vec.push_back({const_cast<char*>(s.data()), s.size()});
+    seg_start = next;
+  }
+  if (next != seg_start)  // trailing header bytes of payload-less entries.
+    vec.push_back({seg_start, size_t(next - seg_start)});
+
+  for (size_t i = 0; i < vec.size(); i += kMaxIovLen) {
+    uint32_t len = min(kMaxIovLen, vec.size() - i);
+    sink_->Write(vec.data() + i, len);
+  }
+}
+
 JournalReader::JournalReader(io::Source* source, DbIndex dbid)
     : source_{source}, buf_{4_KB}, dbid_{dbid} {
 }
@@ -6,6 +6,7 @@
 
 #include <optional>
 #include <string>
+#include <vector>
 
 #include "base/io_buf.h"
 #include "io/io.h"
@@ -23,6 +24,13 @@ class JournalWriter {
   // Write single entry to sink.
   void Write(const journal::Entry& entry);
 
+  // Like Write, but avoids copying the payload: the entry arguments are framed
+  // into an iovec array referencing their original storage and submitted with
+  // vectored writes, so only the entry header and the string length prefixes
+  // are serialized into a scratch buffer. The caller must keep the payload
+  // alive for the duration of the call.
+  void WriteVectored(const journal::Entry& entry);
+
  private:
   void Write(uint64_t v);           // Write packed unsigned integer.
   void Write(std::string_view sv);  // Write string.
@@ -35,6 +43,7 @@ class JournalWriter {
  private:
   io::Sink* sink_;
   std::optional<DbIndex> cur_dbid_{};
+  std::vector<uint8_t> frame_buf_;  // scratch space for WriteVectored headers.
 };
 
 // JournalReader allows deserializing journal entries from a source.
@@ -4,12 +4,59 @@
 
 #include "server/journal/streamer.h"
 
+#include "base/flags.h"
+
+ABSL_FLAG(uint32_t, replication_stream_batch_usec, 500,
+          "Latency budget for coalescing journal entries sent to a replica: after an entry "
+          "is recorded the streamer may wait up to this long for more entries before writing "
+          "to the socket. 0 issues a write per batch of ready entries.");
+
+ABSL_FLAG(uint32_t, replication_stream_batch_bytes, 1u << 16,  // 64KB
+          "Write the coalesced journal batch to the replica socket early once it grows "
+          "this large.");
+
 namespace dfly {
 using namespace util;
 
-void JournalStreamer::Start(io::Sink* dest) {
+namespace {
+
+uint32_t BatchUsec() {
+  return absl::GetFlag(FLAGS_replication_stream_batch_usec);
+}
+
+uint32_t BatchBytes() {
+  return absl::GetFlag(FLAGS_replication_stream_batch_bytes);
+}
+
+// Stall thresholds for the underlying buffered streamer. With batching enabled
+// the buffer must accommodate a full batch, plus slack for entries recorded
+// while the previous batch is flushing, before backpressure blocks writers.
+unsigned MaxBufferedCnt() {
+  return BatchUsec() > 0 ? 4096 : 5;
+}
+
+unsigned MaxBufferedMem() {
+  return BatchUsec() > 0 ? 2 * BatchBytes() : 512;
+}
+
+}  // namespace
+
+JournalStreamer::JournalStreamer(journal::Journal* journal, Context* cntx)
+    : BufferedStreamerBase{cntx->GetCancellation(), MaxBufferedCnt(), MaxBufferedMem(),
+                           BatchUsec(), BatchBytes()},
+      cntx_{cntx}, journal_{journal} {
+}
+
+void JournalStreamer::Start(io::Sink* dest, std::string_view backlog) {
   using namespace journal;
-  write_fb_ = MakeFiber(&JournalStreamer::WriterFb, this, dest);
+
+  // The backlog has to reach the sink before any new entries, so it is buffered before
+  // the journal callback gets registered. Neither step preempts, hence no entry recorded
+  // on the owning shard thread can sneak in between.
+  if (!backlog.empty()) {
+    Write(io::Buffer(backlog));
+  }
+
   journal_cb_id_ = journal_->RegisterOnChange([this](const Entry& entry, bool allow_await) {
     if (entry.opcode == Op::NOOP) {
       // No recode to write, just await if data was written so consumer will read the data.
@@ -18,6 +65,7 @@ void JournalStreamer::Start(io::Sink* dest) {
     writer_.Write(entry);
     NotifyWritten(allow_await);
   });
+  write_fb_ = MakeFiber(&JournalStreamer::WriterFb, this, dest);
 }
 
 void JournalStreamer::Cancel() {
@@ -35,6 +83,7 @@ void JournalStreamer::Cancel() {
 }
 
 void JournalStreamer::WriterFb(io::Sink* dest) {
+  ThisFiber::SetName("journal_streamer");
   if (auto ec = ConsumeIntoSink(dest); ec) {
     cntx_->ReportError(ec);
   }
@@ -12,18 +12,21 @@ namespace dfly {
 
 // Buffered single-shard journal streamer that listens for journal changes with a
 // journal listener and writes them to a destination sink in a separate fiber.
+// Entries are coalesced into batches bounded by --replication_stream_batch_usec
+// and --replication_stream_batch_bytes before they reach the socket.
 class JournalStreamer : protected BufferedStreamerBase {
  public:
-  JournalStreamer(journal::Journal* journal, Context* cntx)
-      : BufferedStreamerBase{cntx->GetCancellation()}, cntx_{cntx}, journal_{journal} {
-  }
+  JournalStreamer(journal::Journal* journal, Context* cntx);
 
   // Self referential.
   JournalStreamer(const JournalStreamer& other) = delete;
   JournalStreamer(JournalStreamer&& other) = delete;
 
   // Register journal listener and start writer in fiber.
-  void Start(io::Sink* dest);
+  // A non-empty backlog (partial sync) is buffered ahead of any new journal entries;
+  // the caller must guarantee no journal write happens concurrently with the call,
+  // e.g. by running it on the owning shard thread.
+  void Start(io::Sink* dest, std::string_view backlog = {});
 
   // Must be called on context cancellation for unblocking
   // and manual cleanup.
@@ -8,15 +8,20 @@ extern "C" {
 #include "redis/object.h"
 }
 
+#include <absl/container/flat_hash_map.h>
 #include <absl/strings/match.h>
 #include <absl/strings/str_join.h>
 #include <absl/strings/str_split.h>
 
+#include <list>
+#include <memory>
+
 #include <jsoncons/json.hpp>
 #include <jsoncons_ext/jsonpatch/jsonpatch.hpp>
 #include <jsoncons_ext/jsonpath/jsonpath.hpp>
 #include <jsoncons_ext/jsonpointer/jsonpointer.hpp>
 
+#include "base/flags.h"
 #include "base/logging.h"
 #include "core/json_object.h"
 #include "server/command_registry.h"
@@ -26,12 +31,17 @@ extern "C" {
 #include "server/tiered_storage.h"
 #include "server/transaction.h"
 
+ABSL_FLAG(uint32_t, json_bin_threshold, 0,
+          "If non-zero, documents whose serialized size is at least this many bytes are stored "
+          "in a compact binary form and materialized into a json tree on first access");
+
 namespace dfly {
 
 using namespace std;
 using namespace jsoncons;
 
 using JsonExpression = jsonpath::jsonpath_expression<JsonType>;
+using JsonExpressionPtr = std::shared_ptr<JsonExpression>;
 using OptBool = optional<bool>;
 using OptLong = optional<long>;
 using OptSizeT = optional<size_t>;
@@ -48,7 +58,7 @@ inline OpStatus JsonReplaceVerifyNoOp(JsonType&) {
   return OpStatus::OK;
 }
 
-void SetJson(const OpArgs& op_args, string_view key, JsonType&& value) {
+void SetJson(const OpArgs& op_args, string_view key, string_view json_str, JsonType&& value) {
   auto& db_slice = op_args.shard->db_slice();
   DbIndex db_index = op_args.db_cntx.db_index;
   auto [it_output, added] = db_slice.AddOrFind(op_args.db_cntx, key);
@@ -56,7 +66,13 @@ void SetJson(const OpArgs& op_args, string_view key, JsonType&& value) {
   op_args.shard->search_indices()->RemoveDoc(key, op_args.db_cntx, it_output->second);
   db_slice.PreUpdate(db_index, it_output);
 
-  it_output->second.SetJson(std::move(value));
+  uint32_t bin_threshold = absl::GetFlag(FLAGS_json_bin_threshold);
+  if (bin_threshold > 0 && json_str.size() >= bin_threshold) {
+    // Large documents stay in their compact binary form until a command reads them.
+    it_output->second.SetJsonBlob(JsonToCbor(value));
+  } else {
+    it_output->second.SetJson(std::move(value));
+  }
 
   db_slice.PostUpdate(db_index, it_output, key);
   op_args.shard->search_indices()->AddDoc(key, op_args.db_cntx, it_output->second);
@@ -84,14 +100,61 @@ string JsonTypeToName(const JsonType& val) {
   return std::string{};
 }
 
-JsonExpression ParseJsonPath(string_view path, error_code* ec) {
+// Bounded LRU cache of compiled jsonpath expressions. Compiling a path is much more
+// expensive than evaluating it, and workloads tend to reuse a small set of paths.
+// A compiled expression keeps no evaluation state (per-call state lives in dynamic
+// resources created by evaluate()), so cached expressions can be shared freely.
+class JsonPathCache {
+ public:
+  JsonExpressionPtr Find(string_view path) {
+    auto it = entries_.find(path);
+    if (it == entries_.end())
+      return nullptr;
+    lru_.splice(lru_.begin(), lru_, it->second.pos);
+    return it->second.expr;
+  }
+
+  void Insert(string_view path, JsonExpressionPtr expr) {
+    if (entries_.size() >= kMaxEntries) {
+      entries_.erase(string_view{lru_.back()});
+      lru_.pop_back();
+    }
+    lru_.emplace_front(path);
+    entries_[lru_.front()] = Entry{lru_.begin(), std::move(expr)};
+  }
+
+ private:
+  constexpr static size_t kMaxEntries = 1024;
+
+  struct Entry {
+    list<string>::iterator pos;
+    JsonExpressionPtr expr;
+  };
+
+  list<string> lru_;  // most recently used paths first, owns the key storage
+  absl::flat_hash_map<string_view, Entry> entries_;
+};
+
+JsonExpressionPtr ParseJsonPath(string_view path, error_code* ec) {
   if (path == ".") {
     // RedisJson V1 uses the dot for root level access.
     // There are more incompatibilities with legacy paths which are not supported.
     path = "$"sv;
   }
 
-  return jsonpath::make_expression<JsonType>(path, *ec);
+  thread_local JsonPathCache path_cache;
+  if (auto cached = path_cache.Find(path); cached) {
+    return cached;
+  }
+
+  JsonExpression expr = jsonpath::make_expression<JsonType>(path, *ec);
+  if (*ec) {
+    return nullptr;
+  }
+
+  auto shared = make_shared<JsonExpression>(std::move(expr));
+  path_cache.Insert(path, shared);
+  return shared;
 }
 
 template <typename T>
@@ -389,7 +452,7 @@ void SendJsonValue(ConnectionContext* cntx, const JsonType& j) {
 }
 
 OpResult<string> OpGet(const OpArgs& op_args, string_view key,
-                       vector<pair<string_view, JsonExpression>> expressions) {
+                       vector<pair<string_view, JsonExpressionPtr>> expressions) {
   OpResult<JsonType*> result = GetJson(op_args, key);
   if (!result) {
     return result.status();
@@ -402,20 +465,20 @@ OpResult<string> OpGet(const OpArgs& op_args, string_view key,
     return json_entry.to_string();
   }
   if (expressions.size() == 1) {
-    json out = expressions[0].second.evaluate(json_entry);
+    json out = expressions[0].second->evaluate(json_entry);
     return out.as<string>();
   }
 
   json out;
   for (auto& expr : expressions) {
-    json eval = expr.second.evaluate(json_entry);
+    json eval = expr.second->evaluate(json_entry);
     out[expr.first] = eval;
   }
 
   return out.as<string>();
 }
 
-OpResult<vector<string>> OpType(const OpArgs& op_args, string_view key, JsonExpression expression) {
+OpResult<vector<string>> OpType(const OpArgs& op_args, string_view key, JsonExpressionPtr expression) {
   OpResult<JsonType*> result = GetJson(op_args, key);
   if (!result) {
     return result.status();
@@ -427,12 +490,12 @@ OpResult<vector<string>> OpType(const OpArgs& op_args, string_view key, JsonExpr
     vec.emplace_back(JsonTypeToName(val));
   };
 
-  expression.evaluate(json_entry, cb);
+  expression->evaluate(json_entry, cb);
   return vec;
 }
 
 OpResult<vector<OptSizeT>> OpStrLen(const OpArgs& op_args, string_view key,
-                                    JsonExpression expression) {
+                                    JsonExpressionPtr expression) {
   OpResult<JsonType*> result = GetJson(op_args, key);
   if (!result) {
     return result.status();
@@ -447,12 +510,12 @@ OpResult<vector<OptSizeT>> OpStrLen(const OpArgs& op_args, string_view key,
     }
   };
 
-  expression.evaluate(json_entry, cb);
+  expression->evaluate(json_entry, cb);
   return vec;
 }
 
 OpResult<vector<OptSizeT>> OpObjLen(const OpArgs& op_args, string_view key,
-                                    JsonExpression expression) {
+                                    JsonExpressionPtr expression) {
   OpResult<JsonType*> result = GetJson(op_args, key);
   if (!result) {
     return result.status();
@@ -468,12 +531,12 @@ OpResult<vector<OptSizeT>> OpObjLen(const OpArgs& op_args, string_view key,
     }
   };
 
-  expression.evaluate(json_entry, cb);
+  expression->evaluate(json_entry, cb);
   return vec;
 }
 
 OpResult<vector<OptSizeT>> OpArrLen(const OpArgs& op_args, string_view key,
-                                    JsonExpression expression) {
+                                    JsonExpressionPtr expression) {
   OpResult<JsonType*> result = GetJson(op_args, key);
   if (!result) {
     return result.status();
@@ -489,7 +552,7 @@ OpResult<vector<OptSizeT>> OpArrLen(const OpArgs& op_args, string_view key,
     }
   };
 
-  expression.evaluate(json_entry, cb);
+  expression->evaluate(json_entry, cb);
   return vec;
 }
 
@@ -606,7 +669,7 @@ OpResult<long> OpDel(const OpArgs& op_args, string_view key, string_view path) {
 // Returns a vector of string vectors,
 // keys within the same object are stored in the same string vector.
 OpResult<vector<StringVec>> OpObjKeys(const OpArgs& op_args, string_view key,
-                                      JsonExpression expression) {
+                                      JsonExpressionPtr expression) {
   OpResult<JsonType*> result = GetJson(op_args, key);
   if (!result) {
     return result.status();
@@ -627,7 +690,7 @@ OpResult<vector<StringVec>> OpObjKeys(const OpArgs& op_args, string_view key,
   };
   JsonType& json_entry = *(result.value());
 
-  expression.evaluate(json_entry, cb);
+  expression->evaluate(json_entry, cb);
   return vec;
 }
 
@@ -875,7 +938,7 @@ OpResult<vector<OptSizeT>> OpArrAppend(const OpArgs& op_args, string_view key, s
 // An index value of -1 represents unfound in the array.
 // JSON scalar has types of string, boolean, null, and number.
 OpResult<vector<OptLong>> OpArrIndex(const OpArgs& op_args, string_view key,
-                                     JsonExpression expression, const JsonType& search_val,
+                                     JsonExpressionPtr expression, const JsonType& search_val,
                                      int start_index, int end_index) {
   OpResult<JsonType*> result = GetJson(op_args, key);
   if (!result) {
@@ -932,12 +995,12 @@ OpResult<vector<OptLong>> OpArrIndex(const OpArgs& op_args, string_view key,
     vec.emplace_back(pos);
   };
   JsonType& json_entry = *(result.value());
-  expression.evaluate(json_entry, cb);
+  expression->evaluate(json_entry, cb);
   return vec;
 }
 
 // Returns string vector that represents the query result of each supplied key.
-vector<OptString> OpMGet(JsonExpression expression, const Transaction* t, EngineShard* shard) {
+vector<OptString> OpMGet(JsonExpressionPtr expression, const Transaction* t, EngineShard* shard) {
   auto args = t->GetShardArgs(shard->shard_id());
   DCHECK(!args.empty());
   vector<OptString> response(args.size());
@@ -958,7 +1021,7 @@ vector<OptString> OpMGet(JsonExpression expression, const Transaction* t, Engine
     };
 
     const JsonType& json_entry = *(json_val);
-    expression.evaluate(json_entry, cb);
+    expression->evaluate(json_entry, cb);
 
     if (query_result.empty()) {
       continue;
@@ -985,7 +1048,7 @@ vector<OptString> OpMGet(JsonExpression expression, const Transaction* t, Engine
 
 // Returns numeric vector that represents the number of fields of JSON value at each path.
 OpResult<vector<OptSizeT>> OpFields(const OpArgs& op_args, string_view key,
-                                    JsonExpression expression) {
+                                    JsonExpressionPtr expression) {
   OpResult<JsonType*> result = GetJson(op_args, key);
   if (!result) {
     return result.status();
@@ -996,13 +1059,13 @@ OpResult<vector<OptSizeT>> OpFields(const OpArgs& op_args, string_view key,
     vec.emplace_back(CountJsonFields(val));
   };
   const JsonType& json_entry = *(result.value());
-  expression.evaluate(json_entry, cb);
+  expression->evaluate(json_entry, cb);
   return vec;
 }
 
 // Returns json vector that represents the result of the json query.
 OpResult<vector<JsonType>> OpResp(const OpArgs& op_args, string_view key,
-                                  JsonExpression expression) {
+                                  JsonExpressionPtr expression) {
   OpResult<JsonType*> result = GetJson(op_args, key);
   if (!result) {
     return result.status();
@@ -1011,7 +1074,7 @@ OpResult<vector<JsonType>> OpResp(const OpArgs& op_args, string_view key,
   vector<JsonType> vec;
   auto cb = [&vec](const string_view& path, const JsonType& val) { vec.emplace_back(val); };
   const JsonType& json_entry = *(result.value());
-  expression.evaluate(json_entry, cb);
+  expression->evaluate(json_entry, cb);
   return vec;
 }
 
@@ -1042,7 +1105,7 @@ OpResult<bool> OpSet(const OpArgs& op_args, string_view key, string_view path,
       }
     }
 
-    SetJson(op_args, key, std::move(parsed_json.value()));
+    SetJson(op_args, key, json_str, std::move(parsed_json.value()));
     return true;
   }
 
@@ -1141,7 +1204,7 @@ void JsonFamily::Resp(CmdArgList args, ConnectionContext* cntx) {
   }
 
   error_code ec;
-  JsonExpression expression = ParseJsonPath(path, &ec);
+  JsonExpressionPtr expression = ParseJsonPath(path, &ec);
 
   if (ec) {
     VLOG(1) << "Invalid JSONPath syntax: " << ec.message();
@@ -1194,7 +1257,7 @@ void JsonFamily::Debug(CmdArgList args, ConnectionContext* cntx) {
   error_code ec;
   string_view key = ArgS(args, 1);
   string_view path = ArgS(args, 2);
-  JsonExpression expression = ParseJsonPath(path, &ec);
+  JsonExpressionPtr expression = ParseJsonPath(path, &ec);
 
   if (ec) {
     VLOG(1) << "Invalid JSONPath syntax: " << ec.message();
@@ -1221,7 +1284,7 @@ void JsonFamily::MGet(CmdArgList args, ConnectionContext* cntx) {
 
   error_code ec;
   string_view path = ArgS(args, args.size() - 1);
-  JsonExpression expression = ParseJsonPath(path, &ec);
+  JsonExpressionPtr expression = ParseJsonPath(path, &ec);
 
   if (ec) {
     VLOG(1) << "Invalid JSONPath syntax: " << ec.message();
@@ -1277,7 +1340,7 @@ void JsonFamily::ArrIndex(CmdArgList args, ConnectionContext* cntx) {
   string_view path = ArgS(args, 1);
 
   error_code ec;
-  JsonExpression expression = ParseJsonPath(path, &ec);
+  JsonExpressionPtr expression = ParseJsonPath(path, &ec);
 
   if (ec) {
     VLOG(1) << "Invalid JSONPath syntax: " << ec.message();
@@ -1445,7 +1508,7 @@ void JsonFamily::ArrPop(CmdArgList args, ConnectionContext* cntx) {
   }
 
   error_code ec;
-  JsonExpression expression = ParseJsonPath(path, &ec);
+  JsonExpressionPtr expression = ParseJsonPath(path, &ec);
 
   if (ec) {
     VLOG(1) << "Invalid JSONPath syntax: " << ec.message();
@@ -1519,7 +1582,7 @@ void JsonFamily::ObjKeys(CmdArgList args, ConnectionContext* cntx) {
   string_view path = ArgS(args, 1);
 
   error_code ec;
-  JsonExpression expression = ParseJsonPath(path, &ec);
+  JsonExpressionPtr expression = ParseJsonPath(path, &ec);
 
   if (ec) {
     VLOG(1) << "Invalid JSONPath syntax: " << ec.message();
@@ -1637,7 +1700,7 @@ void JsonFamily::Type(CmdArgList args, ConnectionContext* cntx) {
   string_view path = ArgS(args, 1);
 
   error_code ec;
-  JsonExpression expression = ParseJsonPath(path, &ec);
+  JsonExpressionPtr expression = ParseJsonPath(path, &ec);
 
   if (ec) {
     VLOG(1) << "Invalid JSONPath syntax: " << ec.message();
@@ -1673,7 +1736,7 @@ void JsonFamily::ArrLen(CmdArgList args, ConnectionContext* cntx) {
   string_view path = ArgS(args, 1);
 
   error_code ec;
-  JsonExpression expression = ParseJsonPath(path, &ec);
+  JsonExpressionPtr expression = ParseJsonPath(path, &ec);
 
   if (ec) {
     VLOG(1) << "Invalid JSONPath syntax: " << ec.message();
@@ -1700,7 +1763,7 @@ void JsonFamily::ObjLen(CmdArgList args, ConnectionContext* cntx) {
   string_view path = ArgS(args, 1);
 
   error_code ec;
-  JsonExpression expression = ParseJsonPath(path, &ec);
+  JsonExpressionPtr expression = ParseJsonPath(path, &ec);
 
   if (ec) {
     VLOG(1) << "Invalid JSONPath syntax: " << ec.message();
@@ -1727,7 +1790,7 @@ void JsonFamily::StrLen(CmdArgList args, ConnectionContext* cntx) {
   string_view path = ArgS(args, 1);
 
   error_code ec;
-  JsonExpression expression = ParseJsonPath(path, &ec);
+  JsonExpressionPtr expression = ParseJsonPath(path, &ec);
 
   if (ec) {
     VLOG(1) << "Invalid JSONPath syntax: " << ec.message();
@@ -1753,12 +1816,12 @@ void JsonFamily::Get(CmdArgList args, ConnectionContext* cntx) {
   DCHECK_GE(args.size(), 1U);
   string_view key = ArgS(args, 0);
 
-  vector<pair<string_view, JsonExpression>> expressions;
+  vector<pair<string_view, JsonExpressionPtr>> expressions;
 
   for (size_t i = 1; i < args.size(); ++i) {
     string_view path = ArgS(args, i);
     error_code ec;
-    JsonExpression expr = ParseJsonPath(path, &ec);
+    JsonExpressionPtr expr = ParseJsonPath(path, &ec);
 
     if (ec) {
       LOG(WARNING) << "path '" << path << "': Invalid JSONPath syntax: " << ec.message();
@@ -0,0 +1,108 @@
+// Copyright 2023, DragonflyDB authors.  All rights reserved.
+// See LICENSE for licensing terms.
+//
+
+#include "server/keyspace_events.h"
+
+#include <absl/strings/ascii.h>
+#include <absl/strings/str_cat.h>
+
+#include "base/flags.h"
+#include "base/logging.h"
+#include "server/channel_store.h"
+#include "server/journal/journal.h"
+#include "server/server_state.h"
+
+ABSL_FLAG(std::string, notify_keyspace_events, "",
+          "Enables keyspace event notifications for mutations recorded in the journal. "
+          "'K' publishes to __keyspace@<db>__:<key> channels, 'E' to __keyevent@<db>__:<event> "
+          "channels, and both may be combined. All journaled mutations are reported; per-class "
+          "event filtering is not supported. Empty string disables notifications.");
+
+namespace dfly {
+
+using namespace std;
+
+namespace {
+
+struct NotifyClasses {
+  bool keyspace = false;  // 'K' - channel per key, the event is the message.
+  bool keyevent = false;  // 'E' - channel per event, the key is the message.
+};
+
+const NotifyClasses& GetNotifyClasses() {
+  static const NotifyClasses classes = [] {
+    NotifyClasses res;
+    for (char c : absl::GetFlag(FLAGS_notify_keyspace_events)) {
+      switch (c) {
+        case 'K':
+          res.keyspace = true;
+          break;
+        case 'E':
+          res.keyevent = true;
+          break;
+        case 'A':
+          break;  // All event classes - the only supported filtering mode.
+        default:
+          LOG(WARNING) << "notify_keyspace_events: event class '" << c
+                       << "' is not supported, all journaled mutations are reported";
+      }
+    }
+    return res;
+  }();
+  return classes;
+}
+
+}  // namespace
+
+bool KeyspaceEvents::Enabled() {
+  const NotifyClasses& classes = GetNotifyClasses();
+  return classes.keyspace || classes.keyevent;
+}
+
+void KeyspaceEvents::StartInThread(journal::Journal* journal) {
+  journal->RegisterOnChange([](const journal::Entry& entry, bool) { OnJournalEntry(entry); });
+}
+
+void KeyspaceEvents::OnJournalEntry(const journal::Entry& entry) {
+  using journal::Op;
+
+  if (entry.opcode != Op::COMMAND && entry.opcode != Op::MULTI_COMMAND &&
+      entry.opcode != Op::EXPIRED) {
+    return;
+  }
+
+  string_view cmd, key;
+  if (const auto* full = get_if<pair<string_view, CmdArgList>>(&entry.payload)) {
+    cmd = full->first;
+    if (!full->second.empty())
+      key = ArgS(full->second, 0);
+  } else if (const auto* shard_args = get_if<pair<string_view, ArgSlice>>(&entry.payload)) {
+    cmd = shard_args->first;
+    if (!shard_args->second.empty())
+      key = shard_args->second[0];
+  }
+
+  if (key.empty())
+    return;
+
+  // Expirations are journaled as DEL commands but reported as their own event.
+  string event = entry.opcode == Op::EXPIRED ? "expired" : absl::AsciiStrToLower(cmd);
+
+  const NotifyClasses& classes = GetNotifyClasses();
+  if (classes.keyevent)
+    PublishEvent(absl::StrCat("__keyevent@", entry.dbid, "__:", event), key);
+  if (classes.keyspace)
+    PublishEvent(absl::StrCat("__keyspace@", entry.dbid, "__:", key), event);
+}
+
+void KeyspaceEvents::PublishEvent(string_view channel, string_view message) {
+  auto* cs = ServerState::tlocal()->channel_store();
+  vector<ChannelStore::Subscriber> subscribers = cs->FetchSubscribers(channel);
+
+  // An event without subscribers ends here - no message was created and no other
+  // thread was involved.
+  ChannelStore::SendMessages(channel, message, std::move(subscribers));
+}
+
+}  // namespace dfly
@@ -0,0 +1,43 @@
+// Copyright 2023, DragonflyDB authors.  All rights reserved.
+// See LICENSE for licensing terms.
+//
+
+#pragma once
+
+#include <string_view>
+
+#include "server/journal/types.h"
+
+namespace dfly {
+
+namespace journal {
+class Journal;
+}  // namespace journal
+
+// Publishes Redis-compatible keyspace notifications ("__keyspace@<db>__:<key>" and
+// "__keyevent@<db>__:<event>" channels) by consuming the journal of the owning shard.
+// Every mutation already produces a journal record, so command execution pays no extra
+// bookkeeping. Subscriber channels and patterns are matched on the shard thread against
+// the journaled key before any message is created, so events nobody listens to cost a
+// channel store lookup and no cross-thread traffic at all.
+//
+// The event name is the lowercased journaled command (expirations are reported as
+// "expired") and the key is taken to be its first argument, which holds for the
+// journaled form of all supported write commands.
+class KeyspaceEvents {
+ public:
+  // Whether --notify_keyspace_events enables any notification channel.
+  static bool Enabled();
+
+  // Registers the notification consumer on the journal of the calling shard thread.
+  // Requires: the journal was started in this thread.
+  static void StartInThread(journal::Journal* journal);
+
+ private:
+  static void OnJournalEntry(const journal::Entry& entry);
+
+  // Publishes to the subscribers of channel fetched on the calling shard thread.
+  static void PublishEvent(std::string_view channel, std::string_view message);
+};
+
+}  // namespace dfly
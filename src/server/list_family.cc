@@ -8,6 +8,7 @@ extern "C" {
 #include "redis/sds.h"
 }
 
+#include <absl/container/flat_hash_map.h>
 #include <absl/strings/numbers.h>
 
 #include "base/flags.h"
@@ -58,6 +59,10 @@ ABSL_FLAG(int32_t, list_max_listpack_size, -2, "Maximum listpack size, default i
 
 ABSL_FLAG(int32_t, list_compress_depth, 0, "Compress depth of the list. Default is no compression");
 
+ABSL_FLAG(uint32_t, list_cold_compress_ticks, 0,
+          "Number of heartbeats a list must stay untouched before its interior quicklist nodes "
+          "are compressed. 0 disables cold list compression.");
+
 namespace dfly {
 
 using namespace std;
@@ -71,6 +76,32 @@ quicklist* GetQL(const PrimeValue& mv) {
   return (quicklist*)mv.RObjPtr();
 }
 
+// Compress depth applied to lists that went cold.
+constexpr int kColdCompressDepth = 1;
+
+// Per-shard bookkeeping for cold list compression: the heartbeat tick at which each
+// list key was last accessed.
+struct ColdListTracker {
+  absl::flat_hash_map<pair<DbIndex, string>, uint64_t> last_touch;
+  uint64_t tick = 0;
+};
+
+thread_local ColdListTracker cold_tracker;
+
+// Records that the list under `key` was accessed now. If the list was compressed as cold,
+// its compress depth is reset so it behaves as a hot list again - already compressed nodes
+// are decompressed lazily as they are accessed.
+void TouchColdList(DbIndex db_index, string_view key, quicklist* ql) {
+  if (GetFlag(FLAGS_list_cold_compress_ticks) == 0)
+    return;
+
+  if (GetFlag(FLAGS_list_compress_depth) == 0 && ql->compress != 0) {
+    quicklistSetCompressDepth(ql, 0);
+  }
+
+  cold_tracker.last_touch[{db_index, string(key)}] = cold_tracker.tick;
+}
+
 void* listPopSaver(unsigned char* data, size_t sz) {
   return createStringObject((char*)data, sz);
 }
@@ -199,6 +230,7 @@ std::string OpBPop(Transaction* t, EngineShard* shard, std::string_view key, Lis
 
   PrimeIterator it = *it_res;
   quicklist* ql = GetQL(it->second);
+  TouchColdList(t->GetDbIndex(), key, ql);
 
   absl::StrAppend(debugMessages.Next(), "OpBPop: ", key, " by ", t->DebugId());
 
@@ -221,6 +253,31 @@ std::string OpBPop(Transaction* t, EngineShard* shard, std::string_view key, Lis
   return value;
 }
 
+// Parses the common tail of LMPOP/BLMPOP: numkeys key [key ...] <LEFT|RIGHT> [COUNT count].
+// `args` must start at the numkeys argument; the key positions themselves were already
+// validated by DetermineKeys, here we check the overall shape and extract the options.
+bool ParseMPopArgs(CmdArgList args, ListDir* dir, uint32_t* count) {
+  uint32_t num_keys;
+  if (!absl::SimpleAtoi(ArgS(args, 0), &num_keys) || num_keys == 0 ||
+      args.size() < size_t(num_keys) + 2)
+    return false;
+
+  ToUpper(&args[num_keys + 1]);
+  optional<ListDir> parsed_dir = ParseDir(ArgS(args, num_keys + 1));
+  if (!parsed_dir)
+    return false;
+  *dir = *parsed_dir;
+
+  *count = 1;
+  if (args.size() > size_t(num_keys) + 2) {
+    ToUpper(&args[num_keys + 2]);
+    if (args.size() != size_t(num_keys) + 4 || ArgS(args, num_keys + 2) != "COUNT" ||
+        !absl::SimpleAtoi(ArgS(args, num_keys + 3), count) || *count == 0)
+      return false;
+  }
+  return true;
+}
+
 OpResult<string> OpMoveSingleShard(const OpArgs& op_args, string_view src, string_view dest,
                                    ListDir src_dir, ListDir dest_dir) {
   auto& db_slice = op_args.shard->db_slice();
@@ -230,6 +287,7 @@ OpResult<string> OpMoveSingleShard(const OpArgs& op_args, string_view src, strin
 
   PrimeIterator src_it = *src_res;
   quicklist* src_ql = GetQL(src_it->second);
+  TouchColdList(op_args.db_cntx.db_index, src, src_ql);
 
   if (src == dest) {  // simple case.
     db_slice.PreUpdate(op_args.db_cntx.db_index, src_it);
@@ -267,6 +325,7 @@ OpResult<string> OpMoveSingleShard(const OpArgs& op_args, string_view src, strin
     dest_ql = GetQL(dest_it->second);
     db_slice.PreUpdate(op_args.db_cntx.db_index, dest_it);
   }
+  TouchColdList(op_args.db_cntx.db_index, dest, dest_ql);
 
   db_slice.PreUpdate(op_args.db_cntx.db_index, src_it);
 
@@ -296,6 +355,7 @@ OpResult<string> Peek(const OpArgs& op_args, string_view key, ListDir dir, bool
     return OpStatus::OK;
 
   quicklist* ql = GetQL(it_res.value()->second);
+  TouchColdList(op_args.db_cntx.db_index, key, ql);
   quicklistEntry entry = container_utils::QLEntry();
   quicklistIter* iter = (dir == ListDir::LEFT) ? quicklistGetIterator(ql, AL_START_HEAD)
                                                : quicklistGetIterator(ql, AL_START_TAIL);
@@ -342,6 +402,7 @@ OpResult<uint32_t> OpPush(const OpArgs& op_args, std::string_view key, ListDir d
     es->db_slice().PreUpdate(op_args.db_cntx.db_index, it);
     ql = GetQL(it->second);
   }
+  TouchColdList(op_args.db_cntx.db_index, key, ql);
 
   // Left push is LIST_HEAD.
   int pos = (dir == ListDir::LEFT) ? QUICKLIST_HEAD : QUICKLIST_TAIL;
@@ -384,6 +445,7 @@ OpResult<StringVec> OpPop(const OpArgs& op_args, string_view key, ListDir dir, u
 
   PrimeIterator it = *it_res;
   quicklist* ql = GetQL(it->second);
+  TouchColdList(op_args.db_cntx.db_index, key, ql);
   db_slice.PreUpdate(op_args.db_cntx.db_index, it);
 
   StringVec res;
@@ -416,6 +478,42 @@ OpResult<StringVec> OpPop(const OpArgs& op_args, string_view key, ListDir dir, u
   return res;
 }
 
+// Called as a callback from the multi-key pop flow after the key to pop from was chosen.
+// Pops up to `count` elements and journals the equivalent single-key pop, since a replica
+// may distribute the candidate keys over its shards differently.
+StringVec OpMPop(Transaction* t, EngineShard* shard, string_view key, ListDir dir,
+                 uint32_t count) {
+  OpArgs op_args = t->GetOpArgs(shard);
+  OpResult<StringVec> res = OpPop(op_args, key, dir, count, true, false);
+  CHECK(res) << t->DebugId() << " " << key;  // the chosen key must exist and hold a list.
+
+  if (op_args.shard->journal()) {
+    string command = dir == ListDir::LEFT ? "LPOP" : "RPOP";
+    string count_str = absl::StrCat(res->size());
+    RecordJournal(op_args, command, ArgSlice{key, count_str}, 1);
+  }
+  return std::move(res.value());
+}
+
+// LMPOP and BLMPOP reply with [key, [value ...]] or a null array when nothing was popped.
+void ReplyMPop(const OpResult<string>& popped_key, const StringVec& popped_values,
+               ConnectionContext* cntx) {
+  if (popped_key) {
+    (*cntx)->StartArray(2);
+    (*cntx)->SendBulkString(*popped_key);
+    (*cntx)->StartArray(popped_values.size());
+    for (const auto& val : popped_values) {
+      (*cntx)->SendBulkString(val);
+    }
+    return;
+  }
+
+  if (popped_key.status() == OpStatus::WRONG_TYPE) {
+    return (*cntx)->SendError(kWrongTypeErr);
+  }
+  (*cntx)->SendNullArray();
+}
+
 OpResult<string> MoveTwoShards(Transaction* trans, string_view src, string_view dest,
                                ListDir src_dir, ListDir dest_dir, bool conclude_on_error) {
   DCHECK_EQ(2u, trans->GetUniqueShardCnt());
@@ -496,6 +594,7 @@ OpResult<string> OpIndex(const OpArgs& op_args, std::string_view key, long index
   if (!res)
     return res.status();
   quicklist* ql = GetQL(res.value()->second);
+  TouchColdList(op_args.db_cntx.db_index, key, ql);
   quicklistEntry entry = container_utils::QLEntry();
   quicklistIter* iter = quicklistGetIteratorAtIdx(ql, AL_START_TAIL, index);
   if (!iter)
@@ -527,6 +626,7 @@ OpResult<vector<uint32_t>> OpPos(const OpArgs& op_args, std::string_view key,
   }
 
   quicklist* ql = GetQL(it_res.value()->second);
+  TouchColdList(op_args.db_cntx.db_index, key, ql);
   quicklistIter* ql_iter = quicklistGetIterator(ql, direction);
   quicklistEntry entry;
 
@@ -565,6 +665,7 @@ OpResult<int> OpInsert(const OpArgs& op_args, string_view key, string_view pivot
     return it_res.status();
 
   quicklist* ql = GetQL(it_res.value()->second);
+  TouchColdList(op_args.db_cntx.db_index, key, ql);
   quicklistEntry entry = container_utils::QLEntry();
   quicklistIter* qiter = quicklistGetIterator(ql, AL_START_HEAD);
   bool found = false;
@@ -600,6 +701,7 @@ OpResult<uint32_t> OpRem(const OpArgs& op_args, string_view key, string_view ele
 
   PrimeIterator it = *it_res;
   quicklist* ql = GetQL(it->second);
+  TouchColdList(op_args.db_cntx.db_index, key, ql);
 
   int iter_direction = AL_START_HEAD;
   long long index = 0;
@@ -642,6 +744,7 @@ OpStatus OpSet(const OpArgs& op_args, string_view key, string_view elem, long in
 
   PrimeIterator it = *it_res;
   quicklist* ql = GetQL(it->second);
+  TouchColdList(op_args.db_cntx.db_index, key, ql);
 
   db_slice.PreUpdate(op_args.db_cntx.db_index, it);
   int replaced = quicklistReplaceAtIndex(ql, index, elem.data(), elem.size());
@@ -661,6 +764,7 @@ OpStatus OpTrim(const OpArgs& op_args, string_view key, long start, long end) {
 
   PrimeIterator it = *it_res;
   quicklist* ql = GetQL(it->second);
+  TouchColdList(op_args.db_cntx.db_index, key, ql);
   long llen = quicklistCount(ql);
 
   /* convert negative indexes */
@@ -703,6 +807,7 @@ OpResult<StringVec> OpRange(const OpArgs& op_args, std::string_view key, long st
     return res.status();
 
   quicklist* ql = GetQL(res.value()->second);
+  TouchColdList(op_args.db_cntx.db_index, key, ql);
   long llen = quicklistCount(ql);
 
   /* convert negative indexes */
@@ -922,6 +1027,37 @@ OpResult<string> BPopPusher::RunPair(Transaction* t, time_point tp) {
 
 }  // namespace
 
+void ListFamily::CompressColdLists(EngineShard* shard) {
+  auto& tracker = cold_tracker;
+  ++tracker.tick;
+
+  uint32_t cold_ticks = GetFlag(FLAGS_list_cold_compress_ticks);
+  if (cold_ticks == 0) {
+    tracker.last_touch.clear();
+    return;
+  }
+
+  for (auto it = tracker.last_touch.begin(); it != tracker.last_touch.end();) {
+    if (tracker.tick - it->second <= cold_ticks) {
+      ++it;
+      continue;
+    }
+
+    const auto& [db_index, key] = it->first;
+    DbContext db_cntx{db_index, GetCurrentTimeMs()};
+    auto res = shard->db_slice().Find(db_cntx, key, OBJ_LIST);
+    if (res && (*res)->second.Encoding() == OBJ_ENCODING_QUICKLIST) {
+      quicklist* ql = GetQL((*res)->second);
+      // Do not fight an explicitly configured static compress depth.
+      if (ql->compress == 0) {
+        quicklistSetCompressDepth(ql, kColdCompressDepth);
+        quicklistCompressInterior(ql);
+      }
+    }
+    tracker.last_touch.erase(it++);
+  }
+}
+
 void ListFamily::LPush(CmdArgList args, ConnectionContext* cntx) {
   return PushGeneric(ListDir::LEFT, false, std::move(args), cntx);
 }
@@ -1164,6 +1300,58 @@ void ListFamily::BRPop(CmdArgList args, ConnectionContext* cntx) {
   BPopGeneric(ListDir::RIGHT, std::move(args), cntx);
 }
 
+void ListFamily::LMPop(CmdArgList args, ConnectionContext* cntx) {
+  ListDir dir;
+  uint32_t count;
+  if (!ParseMPopArgs(args, &dir, &count)) {
+    return (*cntx)->SendError(kSyntaxErr);
+  }
+
+  StringVec popped_values;
+  auto cb = [dir, count, &popped_values](Transaction* t, EngineShard* shard,
+                                         std::string_view key) {
+    popped_values = OpMPop(t, shard, key, dir, count);
+  };
+
+  OpResult<string> popped_key =
+      container_utils::RunCbOnFirstNonEmpty(cntx->transaction, OBJ_LIST, std::move(cb));
+  ReplyMPop(popped_key, popped_values, cntx);
+}
+
+void ListFamily::BLMPop(CmdArgList args, ConnectionContext* cntx) {
+  float timeout;
+  if (!absl::SimpleAtof(ArgS(args, 0), &timeout)) {
+    return (*cntx)->SendError("timeout is not a float or out of range");
+  }
+  if (timeout < 0) {
+    return (*cntx)->SendError("timeout is negative");
+  }
+
+  ListDir dir;
+  uint32_t count;
+  if (!ParseMPopArgs(args.subspan(1), &dir, &count)) {
+    return (*cntx)->SendError(kSyntaxErr);
+  }
+
+  VLOG(1) << "BLMPop timeout(" << timeout << ")";
+
+  StringVec popped_values;
+  auto cb = [dir, count, &popped_values](Transaction* t, EngineShard* shard,
+                                         std::string_view key) {
+    popped_values = OpMPop(t, shard, key, dir, count);
+  };
+
+  cntx->conn_state.is_blocking = true;
+  OpResult<string> popped_key = container_utils::RunCbOnFirstNonEmptyBlocking(
+      cntx->transaction, OBJ_LIST, std::move(cb), unsigned(timeout * 1000));
+  cntx->conn_state.is_blocking = false;
+
+  if (popped_key.status() == OpStatus::TIMED_OUT) {
+    return (*cntx)->SendNullArray();
+  }
+  ReplyMPop(popped_key, popped_values, cntx);
+}
+
 void ListFamily::LMove(CmdArgList args, ConnectionContext* cntx) {
   std::string_view src = ArgS(args, 0);
   std::string_view dest = ArgS(args, 1);
@@ -1315,6 +1503,13 @@ void ListFamily::Register(CommandRegistry* registry) {
              .HFUNC(BLPop)
       << CI{"BRPOP", CO::WRITE | CO::NOSCRIPT | CO::BLOCKING | CO::NO_AUTOJOURNAL, -3, 1, -2, 1}
              .HFUNC(BRPop)
+      << CI{"LMPOP", CO::WRITE | CO::VARIADIC_KEYS | CO::REVERSE_MAPPING | CO::NO_AUTOJOURNAL, -4,
+            2, 2, 1}
+             .HFUNC(LMPop)
+      << CI{"BLMPOP",
+            CO::WRITE | CO::NOSCRIPT | CO::BLOCKING | CO::VARIADIC_KEYS | CO::NO_AUTOJOURNAL, -5, 3,
+            3, 1}
+             .HFUNC(BLMPop)
       << CI{"LLEN", CO::READONLY | CO::FAST, 2, 1, 1, 1}.HFUNC(LLen)
       << CI{"LPOS", CO::READONLY | CO::FAST, -3, 1, 1, 1}.HFUNC(LPos)
       << CI{"LINDEX", CO::READONLY, 3, 1, 1, 1}.HFUNC(LIndex)
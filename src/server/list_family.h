@@ -19,6 +19,10 @@ class ListFamily {
  public:
   static void Register(CommandRegistry* registry);
 
+  // Called from the shard heartbeat. Compresses interior quicklist nodes of lists
+  // that have not been touched for list_cold_compress_ticks heartbeats.
+  static void CompressColdLists(EngineShard* shard);
+
  private:
   static void LPush(CmdArgList args, ConnectionContext* cntx);
   static void LPushX(CmdArgList args, ConnectionContext* cntx);
@@ -28,6 +32,8 @@ class ListFamily {
   static void RPop(CmdArgList args, ConnectionContext* cntx);
   static void BLPop(CmdArgList args, ConnectionContext* cntx);
   static void BRPop(CmdArgList args, ConnectionContext* cntx);
+  static void LMPop(CmdArgList args, ConnectionContext* cntx);
+  static void BLMPop(CmdArgList args, ConnectionContext* cntx);
   static void LLen(CmdArgList args, ConnectionContext* cntx);
   static void LPos(CmdArgList args, ConnectionContext* cntx);
   static void LIndex(CmdArgList args, ConnectionContext* cntx);
@@ -6,6 +6,7 @@
 
 #include <absl/strings/match.h>
 
+#include "base/flags.h"
 #include "base/gtest.h"
 #include "base/logging.h"
 #include "facade/facade_test.h"
@@ -22,6 +23,9 @@ using namespace std;
 using namespace util;
 using absl::StrCat;
 
+ABSL_DECLARE_FLAG(int32_t, list_max_listpack_size);
+ABSL_DECLARE_FLAG(uint32_t, list_cold_compress_ticks);
+
 namespace dfly {
 
 class ListFamilyTest : public BaseFamilyTest {
@@ -353,6 +357,48 @@ TEST_F(ListFamilyTest, BPopFlush) {
   pop_fb.Join();
 }
 
+TEST_F(ListFamilyTest, LMPop) {
+  auto resp = Run({"lmpop", "2", kKey1, kKey2, "LEFT"});
+  EXPECT_THAT(resp, ArgType(RespExpr::NIL_ARRAY));
+
+  resp = Run({"lmpop", "2", kKey1, kKey2, "UP"});
+  EXPECT_THAT(resp, ErrArg("syntax error"));
+
+  Run({"rpush", kKey2, "a", "b", "c"});
+
+  // The first non-empty key in argument order wins, regardless of its shard.
+  resp = Run({"lmpop", "2", kKey1, kKey2, "LEFT"});
+  ASSERT_THAT(resp, ArrLen(2));
+  EXPECT_EQ(resp.GetVec()[0], kKey2);
+  EXPECT_THAT(resp.GetVec()[1].GetVec(), ElementsAre("a"));
+
+  resp = Run({"lmpop", "2", kKey2, kKey1, "RIGHT", "COUNT", "2"});
+  ASSERT_THAT(resp, ArrLen(2));
+  EXPECT_THAT(resp.GetVec()[1].GetVec(), ElementsAre("c", "b"));
+
+  EXPECT_EQ(0, CheckedInt({"exists", kKey2}));
+}
+
+TEST_F(ListFamilyTest, BLMPop) {
+  RespExpr resp = Run({"blmpop", "0.01", "2", kKey1, kKey2, "LEFT"});
+  EXPECT_THAT(resp, ArgType(RespExpr::NIL_ARRAY));
+  ASSERT_EQ(0, NumWatched());
+
+  RespExpr pop_resp;
+  auto pop_fb = pp_->at(0)->LaunchFiber(Launch::dispatch, [&] {
+    pop_resp = Run({"blmpop", "0", "2", kKey1, kKey2, "LEFT", "COUNT", "2"});
+  });
+
+  WaitUntilLocked(0, kKey1);
+  pp_->at(1)->Await([&] { Run({"rpush", kKey2, "a", "b", "c"}); });
+  pop_fb.Join();
+
+  ASSERT_THAT(pop_resp, ArrLen(2));
+  EXPECT_EQ(pop_resp.GetVec()[0], kKey2);
+  EXPECT_THAT(pop_resp.GetVec()[1].GetVec(), ElementsAre("a", "b"));
+  ASSERT_EQ(0, NumWatched());
+}
+
 TEST_F(ListFamilyTest, LRem) {
   auto resp = Run({"rpush", kKey1, "a", "b", "a", "c"});
   ASSERT_THAT(resp, IntArg(4));
@@ -797,6 +843,37 @@ TEST_F(ListFamilyTest, LInsert) {
   EXPECT_THAT(Run({"linsert", "mylist", "after", "notfound", "x"}), IntArg(-1));
 }
 
+TEST_F(ListFamilyTest, LRangeMultiNode) {
+  // Force one element per node so the list spans enough nodes to trigger
+  // the quicklist positional seek index.
+  absl::SetFlag(&FLAGS_list_max_listpack_size, 1);
+  constexpr unsigned kNumElems = 200;
+
+  vector<string> args = {"rpush", kKey1};
+  for (unsigned i = 0; i < kNumElems; ++i)
+    args.push_back(StrCat("elem-", i));
+  ASSERT_THAT(Run(absl::MakeSpan(args)), IntArg(kNumElems));
+
+  // Positional reads around the middle of the list.
+  auto resp = Run({"lrange", kKey1, "98", "101"});
+  ASSERT_THAT(resp, ArrLen(4));
+  ASSERT_THAT(resp.GetVec(), ElementsAre("elem-98", "elem-99", "elem-100", "elem-101"));
+  EXPECT_EQ(Run({"lindex", kKey1, "150"}), "elem-150");
+  EXPECT_EQ(Run({"lindex", kKey1, "-30"}), StrCat("elem-", kNumElems - 30));
+  EXPECT_THAT(Run({"lpos", kKey1, "elem-77"}), IntArg(77));
+
+  // Mutations in between must not leave stale positional state behind.
+  Run({"lset", kKey1, "100", "updated"});
+  EXPECT_EQ(Run({"lindex", kKey1, "100"}), "updated");
+  EXPECT_THAT(Run({"lrem", kKey1, "1", "elem-50"}), IntArg(1));
+  EXPECT_EQ(Run({"lindex", kKey1, "100"}), "elem-101");
+  EXPECT_EQ(Run({"lpop", kKey1}), "elem-0");
+  EXPECT_EQ(Run({"lindex", kKey1, "99"}), "elem-101");
+  EXPECT_THAT(Run({"llen", kKey1}), IntArg(kNumElems - 2));
+
+  absl::SetFlag(&FLAGS_list_max_listpack_size, -2);
+}
+
 TEST_F(ListFamilyTest, BLPopUnwakesInScript) {
   const string_view SCRIPT = R"(
     for i = 1, 1000 do
@@ -862,4 +939,29 @@ TEST_F(ListFamilyTest, OtherMultiWakesBLpop) {
   f2.Join();
 }
 
+TEST_F(ListFamilyTest, ColdCompress) {
+  absl::SetFlag(&FLAGS_list_cold_compress_ticks, 2);
+
+  for (unsigned i = 0; i < 2000; ++i) {
+    Run({"rpush", kKey1, StrCat(string(90, 'a'), i)});
+  }
+  int64_t hot_usage = CheckedInt({"memory", "usage", kKey1});
+
+  // Advance the heartbeat clock past the cold threshold.
+  for (unsigned i = 0; i < 4; ++i) {
+    shard_set->RunBriefInParallel([](EngineShard* es) { ListFamily::CompressColdLists(es); });
+  }
+
+  int64_t cold_usage = CheckedInt({"memory", "usage", kKey1});
+  EXPECT_LT(cold_usage, hot_usage);
+
+  // The list reads back intact and turns hot again on access.
+  auto resp = Run({"lrange", kKey1, "0", "-1"});
+  ASSERT_THAT(resp, ArrLen(2000));
+  EXPECT_EQ(resp.GetVec()[0], StrCat(string(90, 'a'), 0));
+  EXPECT_EQ(resp.GetVec()[1999], StrCat(string(90, 'a'), 1999));
+
+  absl::SetFlag(&FLAGS_list_cold_compress_ticks, 0);
+}
+
 }  // namespace dfly
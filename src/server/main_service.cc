@@ -9,6 +9,7 @@ extern "C" {
 }
 
 #include <absl/cleanup/cleanup.h>
+#include <absl/container/inlined_vector.h>
 #include <absl/functional/bind_front.h>
 #include <absl/strings/ascii.h>
 #include <absl/strings/match.h>
@@ -17,6 +18,7 @@ extern "C" {
 
 #include <filesystem>
 
+#include "base/endian.h"
 #include "base/flags.h"
 #include "base/logging.h"
 #include "facade/dragonfly_connection.h"
@@ -30,6 +32,7 @@ extern "C" {
 #include "server/hll_family.h"
 #include "server/hset_family.h"
 #include "server/json_family.h"
+#include "server/sketch_family.h"
 #include "server/list_family.h"
 #include "server/multi_command_squasher.h"
 #include "server/script_mgr.h"
@@ -41,6 +44,7 @@ extern "C" {
 #include "server/transaction.h"
 #include "server/version.h"
 #include "server/zset_family.h"
+#include "io/file_util.h"
 #include "util/html/sorted_table.h"
 #include "util/varz.h"
 
@@ -60,6 +64,28 @@ ABSL_FLAG(bool, multi_exec_squash, true,
 
 ABSL_FLAG(uint32_t, multi_eval_squash_buffer, 4_KB, "Max buffer for squashed commands per script");
 
+ABSL_FLAG(int32_t, slowlog_log_slower_than, 10000,
+          "Commands whose total dispatch time, including all hops, exceeds this amount of "
+          "microseconds are recorded in the slow log. 0 records every command, a negative "
+          "value disables the slow log");
+
+ABSL_FLAG(uint32_t, monitor_sampling, 1,
+          "Forward only every Nth dispatched command to MONITOR clients. Values above 1 bound "
+          "the tracing overhead under full load at the cost of completeness.");
+
+ABSL_FLAG(std::string, traffic_capture_file, "",
+          "If set, dispatched commands are appended to this file (suffixed with the thread "
+          "index) in a compact binary framing with timestamps, for offline replay with "
+          "tools/replay_traffic.py. Read once at startup.");
+
+ABSL_FLAG(uint32_t, traffic_capture_sampling, 1,
+          "Write only every Nth dispatched command per thread to the traffic capture file.");
+
+ABSL_FLAG(bool, migrate_connections, false,
+          "If true, connections are migrated to the io thread of the shard that serves most of "
+          "their single-shard commands. Should be left disabled when connection io threads are "
+          "pinned away from shard threads (see conn_io_thread_start).");
+
 ABSL_FLAG(bool, admin_nopass, false,
           "If set, would enable open admin access to console on the assigned port, without auth "
           "token needed.");
@@ -112,13 +138,96 @@ void DeactivateMonitoring(ConnectionContext* server_ctx) {
   }
 }
 
-// The format of the message that are sending is
-// +"time of day" [db-number <lua|unix:path|connection info] "command" "arg1" .. "argM"
-std::string CreateMonitorTimestamp() {
-  timeval tv;
+// Compact capture of a dispatched command for MONITOR clients. The dispatch path only
+// copies the raw argument bytes; timestamp formatting, escaping and fan-out all happen
+// later in the drainer fiber, off the hot path.
+struct MonitorRecord {
+  time_t ts_sec;
+  suseconds_t ts_usec;
+  DbIndex db_index;
+  bool is_lua;
+  bool for_monitor = false;  // broadcast to MONITOR clients
+  bool for_capture = false;  // append to the traffic capture file
+  std::string endpoint;      // empty for lua invocations
+  std::string args_buf;      // all arguments back to back
+  absl::InlinedVector<uint32_t, 8> arg_len;
+};
 
-  gettimeofday(&tv, nullptr);
-  return absl::StrCat(tv.tv_sec, ".", tv.tv_usec, absl::kZeroPad6);
+// Per-thread queue of captured records together with its drainer state. Producer and
+// consumer are fibers of the same proactor thread, so plain containers suffice.
+struct MonitorTrace {
+  std::vector<MonitorRecord> records;
+  bool drain_active = false;
+  uint64_t counter = 0;          // dispatched commands, for 1-in-N monitor sampling
+  uint64_t capture_counter = 0;  // same, for the capture file sampling
+};
+
+thread_local MonitorTrace monitor_trace;
+
+// Per-thread state of --traffic_capture_file. Each thread appends to its own file
+// (base path plus thread index), so the drainers never contend on a shared sink.
+struct TrafficCapture {
+  std::unique_ptr<io::WriteFile> file;
+  bool failed = false;  // a write error disables further capture on this thread.
+};
+
+thread_local TrafficCapture traffic_capture;
+
+// The capture path is evaluated once per thread - the flag is not runtime-settable.
+bool TrafficCaptureEnabled() {
+  thread_local bool enabled = !absl::GetFlag(FLAGS_traffic_capture_file).empty();
+  return enabled && !traffic_capture.failed;
+}
+
+// Binary framing of a captured command, all integers little-endian:
+// u64 timestamp-usec, u32 db-index, u32 num-args, u32 len per argument, then the raw
+// argument bytes back to back. Files start with the magic "DFTCAP01".
+// Keep tools/replay_traffic.py in sync with any change here.
+constexpr char kCaptureMagic[] = "DFTCAP01";
+
+void AppendCaptureFrame(const MonitorRecord& rec, std::string* out) {
+  char buf[8];
+  absl::little_endian::Store64(buf, uint64_t(rec.ts_sec) * 1'000'000 + rec.ts_usec);
+  out->append(buf, 8);
+  absl::little_endian::Store32(buf, rec.db_index);
+  out->append(buf, 4);
+  absl::little_endian::Store32(buf, rec.arg_len.size());
+  out->append(buf, 4);
+  for (uint32_t len : rec.arg_len) {
+    absl::little_endian::Store32(buf, len);
+    out->append(buf, 4);
+  }
+  out->append(rec.args_buf);
+}
+
+// Appends a formatted batch to this thread's capture file, opening it lazily.
+// Runs in the drainer fiber, off the dispatch path.
+void WriteCaptureBatch(const std::string& batch) {
+  auto& capture = traffic_capture;
+  if (capture.failed)
+    return;
+
+  if (!capture.file) {
+    std::string path =
+        absl::StrCat(absl::GetFlag(FLAGS_traffic_capture_file), ".", util::ProactorBase::GetIndex());
+    io::Result<io::WriteFile*> res = io::OpenWrite(path);
+    if (!res) {
+      LOG(ERROR) << "Could not open traffic capture file " << path << ": "
+                 << res.error().message();
+      capture.failed = true;
+      return;
+    }
+    capture.file.reset(res.value());
+    capture.file->Write(std::string_view{kCaptureMagic, 8});
+  }
+
+  std::error_code ec = capture.file->Write(batch);
+  if (ec) {
+    LOG(ERROR) << "Error writing traffic capture: " << ec.message() << ", disabling capture";
+    capture.file->Close();
+    capture.file.reset();
+    capture.failed = true;
+  }
 }
 
 auto CmdEntryToMonitorFormat(std::string_view str) -> std::string {
@@ -161,26 +270,55 @@ auto CmdEntryToMonitorFormat(std::string_view str) -> std::string {
   return result;
 }
 
-std::string MakeMonitorMessage(const ConnectionState& conn_state,
-                               const facade::Connection* connection, CmdArgList args) {
-  std::string message = absl::StrCat(CreateMonitorTimestamp(), " [", conn_state.db_index);
+MonitorRecord CaptureMonitorRecord(const ConnectionState& conn_state,
+                                   const facade::Connection* connection, CmdArgList args) {
+  MonitorRecord rec;
+
+  timeval tv;
+  gettimeofday(&tv, nullptr);
+  rec.ts_sec = tv.tv_sec;
+  rec.ts_usec = tv.tv_usec;
+  rec.db_index = conn_state.db_index;
+  rec.is_lua = bool(conn_state.script_info);
+  if (!rec.is_lua)
+    rec.endpoint = connection == nullptr ? "REPLICATION:0" : connection->RemoteEndpointStr();
 
-  if (conn_state.script_info) {
+  // We cannot just send auth details, so keep only the command name in this case.
+  bool is_auth = !args.empty() && facade::ToSV(args[0]) == "AUTH";
+  size_t num_args = is_auth ? 1 : args.size();
+
+  size_t total_len = 0;
+  for (size_t i = 0; i < num_args; ++i)
+    total_len += args[i].size();
+  rec.args_buf.reserve(total_len);
+
+  for (size_t i = 0; i < num_args; ++i) {
+    rec.args_buf.append(args[i].data(), args[i].size());
+    rec.arg_len.push_back(args[i].size());
+  }
+  return rec;
+}
+
+// The format of the message that are sending is
+// +"time of day" [db-number <lua|unix:path|connection info] "command" "arg1" .. "argM"
+std::string FormatMonitorMessage(const MonitorRecord& rec) {
+  std::string message =
+      absl::StrCat(rec.ts_sec, ".", rec.ts_usec, absl::kZeroPad6, " [", rec.db_index);
+
+  if (rec.is_lua) {
     absl::StrAppend(&message, " lua] ");
   } else {
-    auto endpoint = connection == nullptr ? "REPLICATION:0" : connection->RemoteEndpointStr();
-    absl::StrAppend(&message, " ", endpoint, "] ");
+    absl::StrAppend(&message, " ", rec.endpoint, "] ");
   }
-  if (args.empty()) {
+  if (rec.arg_len.empty()) {
     absl::StrAppend(&message, "error - empty cmd list!");
-  } else if (auto cmd_name = std::string_view(args[0].data(), args[0].size());
-             cmd_name == "AUTH") {  // we cannot just send auth details in this case
-    absl::StrAppend(&message, "\"", cmd_name, "\"");
   } else {
-    message = std::accumulate(args.begin(), args.end(), message, [](auto str, const auto& cmd) {
-      absl::StrAppend(&str, " ", CmdEntryToMonitorFormat(std::string_view(cmd.data(), cmd.size())));
-      return str;
-    });
+    size_t offset = 0;
+    for (uint32_t len : rec.arg_len) {
+      absl::StrAppend(&message, " ",
+                      CmdEntryToMonitorFormat(std::string_view(rec.args_buf.data() + offset, len)));
+      offset += len;
+    }
   }
   return message;
 }
@@ -199,14 +337,71 @@ void SendMonitor(const std::string& msg) {
   }
 }
 
-void DispatchMonitor(ConnectionContext* cntx, CmdArgList args) {
-  //  We have connections waiting to get the info on the last command, send it to them
-  string monitor_msg = MakeMonitorMessage(cntx->conn_state, cntx->owner(), args);
+// Formats the records captured on this thread and broadcasts them with one dispatch
+// per batch instead of one per command. Records captured while a batch is formatted
+// are picked up by the next iteration.
+void DrainMonitorTrace() {
+  auto& trace = monitor_trace;
+  while (!trace.records.empty()) {
+    std::vector<MonitorRecord> batch;
+    batch.swap(trace.records);
+
+    auto msgs = make_shared<std::vector<std::string>>();
+    msgs->reserve(batch.size());
+    std::string capture_buf;
+    for (const auto& rec : batch) {
+      if (rec.for_monitor)
+        msgs->push_back(FormatMonitorMessage(rec));
+      if (rec.for_capture)
+        AppendCaptureFrame(rec, &capture_buf);
+    }
+
+    if (!capture_buf.empty())
+      WriteCaptureBatch(capture_buf);
+
+    if (msgs->empty())
+      continue;
 
-  VLOG(1) << "sending command '" << monitor_msg << "' to the clients that registered on it";
+    VLOG(1) << "sending " << msgs->size() << " commands to the clients that registered on them";
 
-  shard_set->pool()->DispatchBrief(
-      [msg = std::move(monitor_msg)](unsigned idx, util::ProactorBase*) { SendMonitor(msg); });
+    shard_set->pool()->DispatchBrief([msgs](unsigned idx, util::ProactorBase*) {
+      for (const auto& msg : *msgs)
+        SendMonitor(msg);
+    });
+  }
+  trace.drain_active = false;
+}
+
+void DispatchMonitor(ConnectionContext* cntx, CmdArgList args, bool for_monitor) {
+  auto& trace = monitor_trace;
+
+  if (for_monitor) {
+    uint32_t sampling = absl::GetFlag(FLAGS_monitor_sampling);
+    if (sampling > 1 && trace.counter++ % sampling != 0)
+      for_monitor = false;
+  }
+
+  bool for_capture = TrafficCaptureEnabled();
+  if (for_capture) {
+    uint32_t sampling = absl::GetFlag(FLAGS_traffic_capture_sampling);
+    if (sampling > 1 && trace.capture_counter++ % sampling != 0)
+      for_capture = false;
+  }
+
+  if (!for_monitor && !for_capture)
+    return;
+
+  //  We have connections waiting to get the info on the last command, capture it for them.
+  trace.records.push_back(CaptureMonitorRecord(cntx->conn_state, cntx->owner(), args));
+  trace.records.back().for_monitor = for_monitor;
+  trace.records.back().for_capture = for_capture;
+
+  // The drainer exits once the queue runs empty, so respawn it lazily. Everything
+  // captured until it gets scheduled is formatted as a single batch.
+  if (!trace.drain_active) {
+    trace.drain_active = true;
+    MakeFiber(&DrainMonitorTrace).Detach();
+  }
 }
 
 class InterpreterReplier : public RedisReplyBuilder {
@@ -307,8 +502,8 @@ void InterpreterReplier::PostItem() {
 }
 
 void InterpreterReplier::SendError(string_view str, std::string_view type) {
-  DCHECK(array_len_.empty());
   explr_->OnError(str);
+  PostItem();
 }
 
 void InterpreterReplier::SendStored() {
@@ -428,6 +623,8 @@ void Topkeys(const http::QueryArgs& args, HttpContext* send) {
 
     shard_set->RunBriefInParallel([&](EngineShard* shard) {
       for (const auto& db : shard->db_slice().databases()) {
+        if (!db)
+          continue;
         if (db->top_keys.IsEnabled()) {
           is_enabled = true;
           for (const auto& [key, count] : db->top_keys.GetTopKeys()) {
@@ -566,6 +763,7 @@ void Service::Shutdown() {
   pp_.AwaitFiberOnAll([](ProactorBase* pb) {
     ServerState::tlocal()->EnterLameDuck();
     facade::Connection::ShutdownThreadLocal();
+    facade::SinkReplyBuilder::ShutdownThreadLocal();
   });
 
   // to shutdown all the runtime components that depend on EngineShard.
@@ -734,11 +932,29 @@ bool Service::VerifyCommand(const CommandId* cid, CmdArgList args, ConnectionCon
   bool is_write_cmd = cid->opt_mask() & CO::WRITE;
   bool under_multi = dfly_cntx->conn_state.exec_info.IsCollecting() && !is_trans_cmd;
 
+  if (under_script && is_write_cmd && dfly_cntx->conn_state.script_info->read_only) {
+    (*dfly_cntx)->SendError("Write commands are not allowed from read-only scripts");
+    return false;
+  }
+
   if (!etl.is_master && is_write_cmd && !dfly_cntx->is_replicating) {
     (*dfly_cntx)->SendError("-READONLY You can't write against a read only replica.");
     return false;
   }
 
+  // Bounded-staleness reads: connections that opted in via READONLY MAXLAG get their
+  // key-touching reads rejected once the master link is too stale to trust.
+  if (!etl.is_master && !is_write_cmd && !dfly_cntx->is_replicating &&
+      dfly_cntx->conn_state.replica_read_max_lag_sec > 0 && cid->first_key_pos() > 0) {
+    auto replica_info = server_family_.GetReplicaInfo();
+    if (!replica_info || !replica_info->master_link_established ||
+        uint64_t(replica_info->master_last_io_sec) >
+            dfly_cntx->conn_state.replica_read_max_lag_sec) {
+      (*dfly_cntx)->SendError("-MAXLAG Replica is too stale for bounded-staleness reads.");
+      return false;
+    }
+  }
+
   if ((cid->arity() > 0 && args.size() != size_t(cid->arity())) ||
       (cid->arity() < 0 && args.size() < size_t(-cid->arity()))) {
     (*dfly_cntx)->SendError(facade::WrongNumArgsError(cmd_str), kSyntaxErrType);
@@ -831,8 +1047,8 @@ void Service::DispatchCommand(CmdArgList args, facade::ConnectionContext* cntx)
   // do any processing if we don't have any waiting connections with monitor
   // enabled on them - see https://redis.io/commands/monitor/
   const MonitorsRepo& monitors = etl.Monitors();
-  if (!monitors.Empty() && (cid->opt_mask() & CO::ADMIN) == 0) {
-    DispatchMonitor(dfly_cntx, args);
+  if ((!monitors.Empty() || TrafficCaptureEnabled()) && (cid->opt_mask() & CO::ADMIN) == 0) {
+    DispatchMonitor(dfly_cntx, args, !monitors.Empty());
   }
 
   uint64_t start_usec = ProactorBase::GetMonotonicTimeNs(), end_usec;
@@ -866,6 +1082,16 @@ void Service::DispatchCommand(CmdArgList args, facade::ConnectionContext* cntx)
 
       dfly_cntx->transaction = dist_trans.get();
       dfly_cntx->last_command_debug.shards_count = dfly_cntx->transaction->GetUniqueShardCnt();
+
+      // Migrate the connection to the io thread of its dominant shard to avoid cross-core
+      // wakeups between the connection and the shard on every hop.
+      if (absl::GetFlag(FLAGS_migrate_connections) && cntx->owner() &&
+          dist_trans->GetUniqueShardCnt() == 1) {
+        ShardId sid = dfly_cntx->conn_state.shard_locality.RecordHit(dist_trans->GetUniqueShard(),
+                                                                     shard_set->size());
+        if (sid != kInvalidSid && sid != etl.thread_index())
+          cntx->owner()->RequestAsyncMigration(shard_set->pool()->at(sid));
+      }
     } else {
       dfly_cntx->transaction = nullptr;
     }
@@ -885,11 +1111,83 @@ void Service::DispatchCommand(CmdArgList args, facade::ConnectionContext* cntx)
   end_usec = ProactorBase::GetMonotonicTimeNs();
   request_latency_usec.IncBy(cid->name(), (end_usec - start_usec) / 1000);
 
+  // start_usec/end_usec are monotonic nanoseconds despite the name.
+  uint64_t dur_usec = (end_usec - start_usec) / 1000;
+  etl.RecordCmdStat(cid->stats_index(), dur_usec);
+  if (int32_t threshold = absl::GetFlag(FLAGS_slowlog_log_slower_than);
+      threshold >= 0 && dur_usec >= uint64_t(threshold)) {
+    auto* conn = cntx->owner();
+    etl.RecordSlowLog(args, dur_usec, conn ? conn->RemoteEndpointStr() : std::string{},
+                      conn ? std::string(conn->GetName()) : std::string{});
+  }
+
   if (!dispatching_in_multi) {
     dfly_cntx->transaction = nullptr;
   }
 }
 
+void Service::DispatchManyCommands(absl::Span<CmdArgList> args_list,
+                                   facade::ConnectionContext* cntx) {
+  ConnectionContext* dfly_cntx = static_cast<ConnectionContext*>(cntx);
+  DCHECK(!dfly_cntx->conn_state.exec_info.IsRunning());
+
+  ServerState& etl = *ServerState::tlocal();
+  const CommandId* exec_cid = registry_.Find("EXEC");
+
+  vector<StoredCmd> stored_cmds;
+  intrusive_ptr<Transaction> dist_trans;
+
+  auto perform_squash = [&] {
+    if (stored_cmds.empty())
+      return;
+
+    if (!dist_trans) {
+      dist_trans.reset(new Transaction{exec_cid, etl.thread_index()});
+      dist_trans->StartMultiNonAtomic();
+    }
+
+    dfly_cntx->transaction = dist_trans.get();
+    MultiCommandSquasher::Execute(absl::MakeSpan(stored_cmds), dfly_cntx);
+    dfly_cntx->transaction = nullptr;
+
+    stored_cmds.clear();
+  };
+
+  // Monitors would not be reported by the squashed path, so it is disabled for them.
+  bool can_squash = etl.Monitors().Empty();
+
+  for (auto args : args_list) {
+    ToUpper(&args[0]);
+    const CommandId* cid = FindCmd(args);
+
+    // MULTI...EXEC commands need to be collected into a single context, so squashing is not
+    // possible for them, as well as for commands the squasher cannot run inside a hop.
+    bool is_multi =
+        dfly_cntx->conn_state.exec_info.IsCollecting() || (cid && CO::IsTransKind(cid->name()));
+    bool is_eligible = cid && cid->IsTransactional() &&
+                       (cid->opt_mask() & (CO::BLOCKING | CO::GLOBAL_TRANS | CO::ADMIN)) == 0;
+
+    if (can_squash && !is_multi && is_eligible) {
+      if (!VerifyCommand(cid, args, dfly_cntx))
+        continue;  // Error was already sent.
+
+      etl.RecordCmd();
+      etl.connection_stats.cmd_count_map[cid->name()]++;
+      stored_cmds.emplace_back(cid, args.subspan(1));
+      continue;
+    }
+
+    // Flush the pending batch first to preserve the execution order.
+    perform_squash();
+    DispatchCommand(args, cntx);
+  }
+
+  perform_squash();
+
+  if (dist_trans)
+    dist_trans->UnlockMulti();
+}
+
 bool Service::InvokeCmd(CmdArgList args, const CommandId* cid, ConnectionContext* cntx,
                         bool record_stats) {
   try {
@@ -914,7 +1212,8 @@ bool Service::InvokeCmd(CmdArgList args, const CommandId* cid, ConnectionContext
 
 void Service::DispatchMC(const MemcacheParser::Command& cmd, std::string_view value,
                          facade::ConnectionContext* cntx) {
-  absl::InlinedVector<MutableSlice, 8> args;
+  // Sized for multi-key gets: memcached clients commonly batch ~50 keys per get.
+  absl::InlinedVector<MutableSlice, 64> args;
   char cmd_name[16];
   char ttl[16];
   char store_opt[32] = {0};
@@ -931,6 +1230,9 @@ void Service::DispatchMC(const MemcacheParser::Command& cmd, std::string_view va
     case MemcacheParser::SET:
       strcpy(cmd_name, "SET");
       break;
+    case MemcacheParser::CAS:
+      strcpy(cmd_name, "SET");
+      break;
     case MemcacheParser::ADD:
       strcpy(cmd_name, "SET");
       strcpy(store_opt, "NX");
@@ -953,6 +1255,9 @@ void Service::DispatchMC(const MemcacheParser::Command& cmd, std::string_view va
       strcpy(cmd_name, "PREPEND");
       break;
     case MemcacheParser::GET:
+    case MemcacheParser::GETS:
+    case MemcacheParser::GAT:
+    case MemcacheParser::GATS:
       strcpy(cmd_name, "MGET");
       break;
     case MemcacheParser::FLUSHALL:
@@ -995,7 +1300,16 @@ void Service::DispatchMC(const MemcacheParser::Command& cmd, std::string_view va
       args.emplace_back(ttl, next - ttl);
     }
     dfly_cntx->conn_state.memcache_flag = cmd.flags;
+    if (cmd.type == MemcacheParser::CAS) {
+      dfly_cntx->conn_state.memcache_cas = cmd.cas_unique;
+    }
   } else if (cmd.type < MemcacheParser::QUIT) {  // read commands
+    if (cmd.type == MemcacheParser::GETS || cmd.type == MemcacheParser::GATS) {
+      dfly_cntx->conn_state.memcache_flag |= ConnectionState::FETCH_CAS_VER;
+    }
+    if (cmd.type == MemcacheParser::GAT || cmd.type == MemcacheParser::GATS) {
+      dfly_cntx->conn_state.memcache_touch_sec = cmd.expire_ts;
+    }
     for (auto s : cmd.keys_ext) {
       char* key = const_cast<char*>(s.data());
       args.emplace_back(key, s.size());
@@ -1010,6 +1324,8 @@ void Service::DispatchMC(const MemcacheParser::Command& cmd, std::string_view va
 
   // Reset back.
   dfly_cntx->conn_state.memcache_flag = 0;
+  dfly_cntx->conn_state.memcache_cas = 0;
+  dfly_cntx->conn_state.memcache_touch_sec.reset();
 }
 
 bool RequireAdminAuth() {
@@ -1158,6 +1474,44 @@ void Service::CallFromScript(ConnectionContext* cntx, Interpreter::CallArgs& ca)
   facade::SinkReplyBuilder* orig = cntx->Inject(&replier);
   absl::Cleanup clean = [orig, cntx] { cntx->Inject(orig); };
 
+  if (ca.many_queued) {
+    auto& info = cntx->conn_state.script_info;
+
+    ToUpper(&ca.args[0]);
+    auto* cid = registry_.Find(facade::ToSV(ca.args[0]));
+
+    if (!VerifyCommand(cid, ca.args, cntx)) {
+      *ca.requested_abort = true;
+      return;
+    }
+
+    info->many_cmds.emplace_back(move(*ca.buffer), cid, ca.args.subspan(1), ReplyMode::FULL);
+    return;
+  }
+
+  if (ca.many_flush) {
+    auto& info = cntx->conn_state.script_info;
+
+    // Execute pending fire-and-forget calls first to preserve program order.
+    if (auto err = FlushEvalAsyncCmds(cntx, true); err) {
+      CapturingReplyBuilder::Apply(move(*err), &replier);
+      *ca.requested_abort = true;
+      info->many_cmds.clear();
+      return;
+    }
+
+    auto* eval_cid = registry_.Find("EVAL");
+    DCHECK(eval_cid);
+    cntx->transaction->MultiSwitchCmd(eval_cid);
+
+    // All batched replies form one array on the translator.
+    replier.StartCollection(info->many_cmds.size(), RedisReplyBuilder::ARRAY);
+    MultiCommandSquasher::Execute(absl::MakeSpan(info->many_cmds), cntx, true);
+
+    info->many_cmds.clear();
+    return;
+  }
+
   if (ca.async) {
     auto& info = cntx->conn_state.script_info;
 
@@ -1185,6 +1539,14 @@ void Service::CallFromScript(ConnectionContext* cntx, Interpreter::CallArgs& ca)
 }
 
 void Service::Eval(CmdArgList args, ConnectionContext* cntx) {
+  EvalGeneric(args, cntx, false);
+}
+
+void Service::EvalRo(CmdArgList args, ConnectionContext* cntx) {
+  EvalGeneric(args, cntx, true);
+}
+
+void Service::EvalGeneric(CmdArgList args, ConnectionContext* cntx, bool read_only) {
   uint32_t num_keys;
 
   CHECK(absl::SimpleAtoi(ArgS(args, 1), &num_keys));  // we already validated this
@@ -1210,6 +1572,7 @@ void Service::Eval(CmdArgList args, ConnectionContext* cntx) {
   eval_args.sha = sha;
   eval_args.keys = args.subspan(2, num_keys);
   eval_args.args = args.subspan(2 + num_keys);
+  eval_args.read_only = read_only;
 
   uint64_t start = absl::GetCurrentTimeNanos();
   EvalInternal(eval_args, interpreter, cntx);
@@ -1219,6 +1582,14 @@ void Service::Eval(CmdArgList args, ConnectionContext* cntx) {
 }
 
 void Service::EvalSha(CmdArgList args, ConnectionContext* cntx) {
+  EvalShaGeneric(args, cntx, false);
+}
+
+void Service::EvalShaRo(CmdArgList args, ConnectionContext* cntx) {
+  EvalShaGeneric(args, cntx, true);
+}
+
+void Service::EvalShaGeneric(CmdArgList args, ConnectionContext* cntx, bool read_only) {
   string_view num_keys_str = ArgS(args, 1);
   uint32_t num_keys;
 
@@ -1235,6 +1606,7 @@ void Service::EvalSha(CmdArgList args, ConnectionContext* cntx) {
   ev_args.sha = sha;
   ev_args.keys = args.subspan(2, num_keys);
   ev_args.args = args.subspan(2 + num_keys);
+  ev_args.read_only = read_only;
 
   uint64_t start = absl::GetCurrentTimeNanos();
   EvalInternal(ev_args, interpreter, cntx);
@@ -1252,8 +1624,14 @@ optional<ScriptMgr::ScriptParams> LoadScipt(string_view sha, ScriptMgr* script_m
     if (!script_data)
       return std::nullopt;
 
+    // Loading the compiled chunk skips the source parse, so EVALSHA dispatch on
+    // interpreters that don't hold the function yet is a cheap binary load.
     string err;
-    CHECK_EQ(Interpreter::ADD_OK, interpreter->AddFunction(sha, script_data->body, &err));
+    Interpreter::AddResult add_res =
+        script_data->bytecode.empty()
+            ? interpreter->AddFunction(sha, script_data->body, &err)
+            : interpreter->AddCompiledFunction(sha, script_data->bytecode, &err);
+    CHECK_EQ(Interpreter::ADD_OK, add_res);
     CHECK(err.empty()) << err;
 
     return script_data;
@@ -1289,12 +1667,28 @@ bool StartMultiEval(DbIndex dbid, CmdArgList keys, ScriptMgr::ScriptParams param
   if (keys.empty() && multi_mode == Transaction::LOCK_AHEAD)
     return false;
 
+  // Verify a single-shard declaration before trusting it.
+  auto on_single_shard = [keys]() {
+    ShardId sid = Shard(ArgS(keys, 0), shard_set->size());
+    for (size_t i = 1; i < keys.size(); i++) {
+      if (Shard(ArgS(keys, i), shard_set->size()) != sid)
+        return false;
+    }
+    return true;
+  };
+
   switch (multi_mode) {
     case Transaction::GLOBAL:
       trans->StartMultiGlobal(dbid);
       return true;
     case Transaction::LOCK_AHEAD:
-      trans->StartMultiLockedAhead(dbid, keys);
+      if (params.single_shard && on_single_shard()) {
+        trans->StartMultiSingleShard(dbid, keys);
+      } else {
+        LOG_IF(WARNING, params.single_shard)
+            << "Script declared single-shard, but its keys span multiple shards";
+        trans->StartMultiLockedAhead(dbid, keys);
+      }
       return true;
     case Transaction::NON_ATOMIC:
       trans->StartMultiNonAtomic();
@@ -1342,6 +1736,7 @@ void Service::EvalInternal(const EvalArgs& eval_args, Interpreter* interpreter,
   // we can do it once during script insertion into script mgr.
   auto& sinfo = cntx->conn_state.script_info;
   sinfo.reset(new ConnectionState::ScriptInfo{});
+  sinfo->read_only = eval_args.read_only;
   for (size_t i = 0; i < eval_args.keys.size(); ++i) {
     sinfo->keys.insert(ArgS(eval_args.keys, i));
   }
@@ -1630,35 +2025,7 @@ void Service::Publish(CmdArgList args, ConnectionContext* cntx) {
   vector<ChannelStore::Subscriber> subscribers = cs->FetchSubscribers(channel);
   int num_published = subscribers.size();
 
-  if (!subscribers.empty()) {
-    // Make sure neither of the subscribers buffers is filled up.
-    // This check actually doesn't reserve any memory ahead and doesn't prevent the buffer
-    // from eventually filling up, especially if multiple clients are unblocked simultaneously
-    // but is generally good enough to limit too fast producers.
-    // Most importantly, this approach allows not blocking and not awaiting in the dispatch below,
-    // thus not adding any overhead to backpressure checks.
-    for (auto& sub : subscribers)
-      sub.conn_cntx->owner()->EnsureAsyncMemoryBudget();
-
-    auto subscribers_ptr = make_shared<decltype(subscribers)>(move(subscribers));
-    auto buf = shared_ptr<char[]>{new char[channel.size() + msg.size()]};
-    memcpy(buf.get(), channel.data(), channel.size());
-    memcpy(buf.get() + channel.size(), msg.data(), msg.size());
-
-    auto cb = [subscribers_ptr, buf, channel, msg](unsigned idx, util::ProactorBase*) {
-      auto it = lower_bound(subscribers_ptr->begin(), subscribers_ptr->end(), idx,
-                            ChannelStore::Subscriber::ByThread);
-
-      while (it != subscribers_ptr->end() && it->thread_id == idx) {
-        facade::Connection* conn = it->conn_cntx->owner();
-        DCHECK(conn);
-        conn->SendPubMessageAsync({move(it->pattern), move(buf), channel.size(), msg.size()});
-        it->borrow_token.Dec();
-        it++;
-      }
-    };
-    shard_set->pool()->DispatchBrief(std::move(cb));
-  }
+  ChannelStore::SendMessages(channel, msg, std::move(subscribers));
 
   (*cntx)->SendLong(num_published);
 }
@@ -1863,6 +2230,16 @@ void Service::OnClose(facade::ConnectionContext* cntx) {
     }
   }
 
+  if (conn_state.tracking_info) {  // Clean-ups related to CLIENT TRACKING
+    shard_set->RunBriefInParallel([server_cntx](EngineShard* shard) {
+      shard->db_slice().UnregisterConnectionTracking(server_cntx);
+    });
+
+    // Check that all in-flight invalidation messages finished processing.
+    // The token is increased in db_slice (the invalidating side).
+    conn_state.tracking_info->borrow_token.Wait();
+  }
+
   DeactivateMonitoring(server_cntx);
 
   server_family_.OnClose(server_cntx);
@@ -1905,8 +2282,14 @@ void Service::RegisterCommands() {
       << CI{"DISCARD", CO::NOSCRIPT | CO::FAST | CO::LOADING, 1, 0, 0, 0}.MFUNC(Discard)
       << CI{"EVAL", CO::NOSCRIPT | CO::VARIADIC_KEYS, -3, 3, 3, 1}.MFUNC(Eval).SetValidator(
              &EvalValidator)
+      << CI{"EVAL_RO", CO::READONLY | CO::NOSCRIPT | CO::VARIADIC_KEYS, -3, 3, 3, 1}
+             .MFUNC(EvalRo)
+             .SetValidator(&EvalValidator)
       << CI{"EVALSHA", CO::NOSCRIPT | CO::VARIADIC_KEYS, -3, 3, 3, 1}.MFUNC(EvalSha).SetValidator(
              &EvalValidator)
+      << CI{"EVALSHA_RO", CO::READONLY | CO::NOSCRIPT | CO::VARIADIC_KEYS, -3, 3, 3, 1}
+             .MFUNC(EvalShaRo)
+             .SetValidator(&EvalValidator)
       << CI{"EXEC", CO::LOADING | CO::NOSCRIPT, 1, 0, 0, 1}.MFUNC(Exec)
       << CI{"PUBLISH", CO::LOADING | CO::FAST, 3, 0, 0, 0}.MFUNC(Publish)
       << CI{"SUBSCRIBE", CO::NOSCRIPT | CO::LOADING, -2, 0, 0, 0}.MFUNC(Subscribe)
@@ -1928,6 +2311,7 @@ void Service::RegisterCommands() {
   JsonFamily::Register(&registry_);
   BitOpsFamily::Register(&registry_);
   HllFamily::Register(&registry_);
+  SketchFamily::Register(&registry_);
   SearchFamily::Register(&registry_);
 
   server_family_.Register(&registry_);
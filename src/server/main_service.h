@@ -41,6 +41,11 @@ class Service : public facade::ServiceInterface {
 
   void DispatchCommand(CmdArgList args, facade::ConnectionContext* cntx) final;
 
+  // Execute a batch of pipelined commands, squashing consecutive eligible commands
+  // into single multi-shard hops via MultiCommandSquasher.
+  void DispatchManyCommands(absl::Span<CmdArgList> args_list,
+                            facade::ConnectionContext* cntx) final;
+
   // Returns true if command was executed successfully.
   bool InvokeCmd(CmdArgList args, const CommandId* cid, ConnectionContext* cntx, bool record_stats);
 
@@ -99,7 +104,9 @@ class Service : public facade::ServiceInterface {
 
   void Discard(CmdArgList args, ConnectionContext* cntx);
   void Eval(CmdArgList args, ConnectionContext* cntx);
+  void EvalRo(CmdArgList args, ConnectionContext* cntx);
   void EvalSha(CmdArgList args, ConnectionContext* cntx);
+  void EvalShaRo(CmdArgList args, ConnectionContext* cntx);
   void Exec(CmdArgList args, ConnectionContext* cntx);
   void Publish(CmdArgList args, ConnectionContext* cntx);
   void Subscribe(CmdArgList args, ConnectionContext* cntx);
@@ -117,8 +124,12 @@ class Service : public facade::ServiceInterface {
   struct EvalArgs {
     std::string_view sha;  // only one of them is defined.
     CmdArgList keys, args;
+    bool read_only = false;  // invoked via EVAL_RO/EVALSHA_RO.
   };
 
+  void EvalGeneric(CmdArgList args, ConnectionContext* cntx, bool read_only);
+  void EvalShaGeneric(CmdArgList args, ConnectionContext* cntx, bool read_only);
+
   // Return false if command is invalid and reply with error.
   bool VerifyCommand(const CommandId* cid, CmdArgList args, ConnectionContext* cntx);
 
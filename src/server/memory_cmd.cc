@@ -81,15 +81,41 @@ void MemoryCmd::Run(CmdArgList args) {
         "MALLOC-STATS [BACKING] [thread-id]",
         "    Show malloc stats for a heap residing in specified thread-id. 0 by default.",
         "    If BACKING is specified, show stats for the backing heap.",
-        "USAGE",
-        "    (not implemented).",
+        "STATS",
+        "    Show per-command allocation totals collected with --cmd_alloc_tracking.",
+        "USAGE <key>",
+        "    Show memory usage of a key.",
     };
     return (*cntx_)->SendSimpleStrArr(help_arr);
   };
 
-  if (sub_cmd == "USAGE") {
-    // dummy output, in practice not implemented yet.
-    return (*cntx_)->SendLong(1);
+  if (sub_cmd == "USAGE" && args.size() == 2) {
+    string_view key = ArgS(args, 1);
+    return Usage(key);
+  }
+
+  if (sub_cmd == "STATS") {
+    // Aggregate per-command allocation counters from all threads. The counters are filled
+    // only when the server runs with --cmd_alloc_tracking.
+    absl::flat_hash_map<string, int64_t> alloc_map;
+    Mutex mu;
+    shard_set->pool()->AwaitFiberOnAll([&](auto*) {
+      lock_guard lk(mu);
+      for (const auto& k_v : ServerState::tlocal()->cmd_alloc_bytes) {
+        alloc_map[k_v.first] += k_v.second;
+      }
+    });
+
+    vector<pair<string, int64_t>> alloc_vec(alloc_map.begin(), alloc_map.end());
+    sort(alloc_vec.begin(), alloc_vec.end(),
+         [](const auto& l, const auto& r) { return l.second > r.second; });
+
+    (*cntx_)->StartArray(alloc_vec.size() * 2);
+    for (const auto& k_v : alloc_vec) {
+      (*cntx_)->SendBulkString(k_v.first);
+      (*cntx_)->SendLong(k_v.second);
+    }
+    return;
   }
 
   if (sub_cmd == "MALLOC-STATS") {
@@ -119,4 +145,27 @@ void MemoryCmd::Run(CmdArgList args) {
   return (*cntx_)->SendError(err, kSyntaxErrType);
 }
 
+void MemoryCmd::Usage(std::string_view key) {
+  ShardId sid = Shard(key, shard_set->size());
+  ssize_t memory_usage = shard_set->Await(sid, [key, this]() -> ssize_t {
+    auto& db_slice = EngineShard::tlocal()->db_slice();
+    if (!db_slice.IsDbValid(cntx_->db_index()))
+      return -1;
+
+    auto [pt, exp_t] = db_slice.GetTables(cntx_->db_index());
+    PrimeIterator it = pt->Find(key);
+    if (IsValid(it)) {
+      // The malloc used counters of the containers are maintained incrementally
+      // on mutation, so this is an O(1) lookup even for large collections.
+      return it->first.MallocUsed() + it->second.MallocUsed();
+    } else {
+      return -1;
+    }
+  });
+
+  if (memory_usage < 0)
+    return (*cntx_)->SendError(kKeyNotFoundErr);
+  (*cntx_)->SendLong(memory_usage);
+}
+
 }  // namespace dfly
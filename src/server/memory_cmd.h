@@ -17,6 +17,9 @@ class MemoryCmd {
   void Run(CmdArgList args);
 
  private:
+  // Implements "MEMORY USAGE <key>" - returns the heap bytes allocated for the value of key.
+  void Usage(std::string_view key);
+
   ConnectionContext* cntx_;
 };
 
@@ -1,12 +1,20 @@
 #include "server/multi_command_squasher.h"
 
+#include <absl/container/flat_hash_map.h>
 #include <absl/container/inlined_vector.h>
+#include <absl/strings/match.h>
+#include <absl/strings/str_cat.h>
 
+#include "base/flags.h"
 #include "server/command_registry.h"
 #include "server/conn_context.h"
 #include "server/engine_shard_set.h"
 #include "server/transaction.h"
 
+ABSL_FLAG(bool, pipeline_coalesce_reads, true,
+          "Execute identical read-only commands of a squashed pipeline batch once and fan the "
+          "result into all of their reply slots, so hot-key read storms cost O(distinct keys).");
+
 namespace dfly {
 
 using namespace std;
@@ -22,6 +30,12 @@ template <typename F> void IterateKeys(CmdArgList args, KeyIndex keys, F&& f) {
     f(args[*keys.bonus]);
 }
 
+// Whether identical invocations of cid observe the same result as long as no write
+// interleaves. Randomized reads (SRANDMEMBER and friends) are excluded.
+bool IsCoalescableRead(const CommandId* cid) {
+  return (cid->opt_mask() & CO::READONLY) && !absl::StrContains(cid->name(), "RAND");
+}
+
 }  // namespace
 
 MultiCommandSquasher::MultiCommandSquasher(absl::Span<StoredCmd> cmds, ConnectionContext* cntx,
@@ -107,23 +121,52 @@ OpStatus MultiCommandSquasher::SquashedHopCb(Transaction* parent_tx, EngineShard
 
   auto* local_tx = sinfo.local_tx.get();
   facade::CapturingReplyBuilder crb;
+  // Propagate the protocol version so that commands that serialize replies themselves
+  // (e.g. via SerializeScoredArray) produce the format the client negotiated.
+  crb.SetResp3((*cntx_)->IsResp3());
   ConnectionContext local_cntx{local_tx, &crb};
 
   absl::InlinedVector<MutableSlice, 4> arg_vec;
 
-  for (auto* cmd : sinfo.cmds) {
-    local_tx->MultiSwitchCmd(cmd->Cid());
-    local_cntx.cid = cmd->Cid();
-    crb.SetReplyMode(cmd->ReplyMode());
+  // With heavy key skew a deep pipeline often repeats the same hot read many times.
+  // Identical read-only commands are executed once and the captured reply is cloned into
+  // the slots of the duplicates. Any write resets the tracking, as it may change what a
+  // later duplicate would observe.
+  const bool coalesce_reads = absl::GetFlag(FLAGS_pipeline_coalesce_reads);
+  absl::flat_hash_map<string, size_t> seen_reads;  // command + args -> index in replies
+  string dedup_key;
 
+  for (auto* cmd : sinfo.cmds) {
     arg_vec.resize(cmd->NumArgs());
     auto args = absl::MakeSpan(arg_vec);
     cmd->Fill(args);
 
+    bool coalescable =
+        coalesce_reads && IsCoalescableRead(cmd->Cid()) && cmd->ReplyMode() == ReplyMode::FULL;
+    if (coalescable) {
+      dedup_key = cmd->Cid()->name();
+      for (const auto& arg : args)  // length-prefixed to keep the key unambiguous
+        absl::StrAppend(&dedup_key, arg.size(), ":", facade::ToSV(arg));
+
+      if (auto it = seen_reads.find(dedup_key); it != seen_reads.end()) {
+        sinfo.replies.emplace_back(CapturingReplyBuilder::Clone(sinfo.replies[it->second]));
+        continue;
+      }
+    } else if (!(cmd->Cid()->opt_mask() & CO::READONLY)) {
+      seen_reads.clear();
+    }
+
+    local_tx->MultiSwitchCmd(cmd->Cid());
+    local_cntx.cid = cmd->Cid();
+    crb.SetReplyMode(cmd->ReplyMode());
+
     local_tx->InitByArgs(parent_tx->GetDbIndex(), args);
     cmd->Cid()->Invoke(args, &local_cntx);
 
     sinfo.replies.emplace_back(crb.Take());
+
+    if (coalescable)
+      seen_reads.emplace(std::move(dedup_key), sinfo.replies.size() - 1);
   }
 
   // ConnectionContext deletes the reply builder upon destruction, so
@@ -158,6 +158,23 @@ TEST_F(MultiTest, HitMissStats) {
   EXPECT_THAT(metrics.events.misses, 1);
 }
 
+TEST_F(MultiTest, ExecCoalesceReads) {
+  Run({"set", kKey1, "a"});
+
+  ASSERT_THAT(Run({"multi"}), "OK");
+  Run({"get", kKey1});
+  Run({"get", kKey1});
+  Run({"set", kKey1, "b"});
+  Run({"get", kKey1});
+  Run({"get", kKey1});
+  RespExpr resp = Run({"exec"});
+
+  // Duplicate reads are coalesced within a squashed batch, but a write in between
+  // must reset the coalescing so later reads observe the new value.
+  ASSERT_THAT(resp, ArrLen(5));
+  EXPECT_THAT(resp.GetVec(), ElementsAre("a", "a", "OK", "b", "b"));
+}
+
 TEST_F(MultiTest, MultiEmpty) {
   RespExpr resp = Run({"multi"});
   ASSERT_EQ(resp, "OK");
@@ -400,6 +417,29 @@ TEST_F(MultiTest, Eval) {
   EXPECT_EQ(resp, "12.5-works");
 }
 
+TEST_F(MultiTest, EvalRo) {
+  if (auto config = absl::GetFlag(FLAGS_default_lua_flags); config != "") {
+    LOG(WARNING) << "Skipped EvalRo test because default_lua_flags is set";
+    return;
+  }
+
+  Run({"set", "foo", "42"});
+
+  auto resp = Run({"eval_ro", "return redis.call('get', KEYS[1])", "1", "foo"});
+  EXPECT_EQ(resp, "42");
+  ASSERT_FALSE(service_->IsLocked(0, "foo"));
+
+  // Write commands are rejected even for declared keys.
+  resp = Run({"eval_ro", "return redis.call('set', KEYS[1], 'x')", "1", "foo"});
+  EXPECT_THAT(resp, ErrArg("not allowed from read-only scripts"));
+  EXPECT_EQ(Run({"get", "foo"}), "42");
+
+  resp = Run({"script", "load", "return redis.call('get', KEYS[1])"});
+  string sha{facade::ToSV(resp.GetBuf())};
+  resp = Run({"evalsha_ro", sha, "1", "foo"});
+  EXPECT_EQ(resp, "42");
+}
+
 TEST_F(MultiTest, Watch) {
   auto kExecFail = ArgType(RespExpr::NIL);
   auto kExecSuccess = ArgType(RespExpr::ARRAY);
@@ -687,6 +727,49 @@ TEST_F(MultiTest, ScriptFlagsEmbedded) {
   EXPECT_THAT(Run({"eval", s2, "0"}), ErrArg("Invalid flag: this-is-an-error"));
 }
 
+TEST_F(MultiTest, ScriptFlagsSingleShard) {
+  const char* s1 = R"(
+  #!lua flags=single-shard
+  return redis.call('GET', KEYS[1]);
+)";
+
+  // The declaration holds for one key and the script runs on the owning shard.
+  Run({"set", "single-key", "works"});
+  EXPECT_EQ(Run({"eval", s1, "1", "single-key"}), "works");
+
+  const char* s2 = R"(
+  #!lua flags=single-shard
+  return redis.call('MGET', KEYS[1], KEYS[2]);
+)";
+
+  // A mis-declared script with keys on different shards still runs correctly.
+  Run({"mset", "a", "1", "b", "2"});
+  auto resp = Run({"eval", s2, "2", "a", "b"});
+  ASSERT_THAT(resp, ArrLen(2));
+}
+
+TEST_F(MultiTest, ScriptPcallMany) {
+  const char* s1 = R"(
+  return redis.pcall_many({'SET', KEYS[1], 'v1'}, {'SET', KEYS[2], 'v2'},
+                          {'GET', KEYS[1]}, {'GET', KEYS[2]})
+)";
+
+  // The whole batch is executed squashed, replies are returned as one array.
+  auto resp = Run({"eval", s1, "2", kKeySid0, kKeySid1});
+  ASSERT_THAT(resp, ArrLen(4));
+  EXPECT_THAT(resp.GetVec(), ElementsAre("OK", "OK", "v1", "v2"));
+
+  // Errors of single commands surface as error tables inside the array.
+  const char* s2 = R"(
+  local res = redis.pcall_many({'GET', KEYS[1]}, {'INCR', KEYS[1]})
+  return res[2]['err']
+)";
+
+  Run({"set", kKey1, "not-a-number"});
+  resp = Run({"eval", s2, "1", kKey1});
+  EXPECT_THAT(resp.GetString(), HasSubstr("not an integer"));
+}
+
 // Run multi-exec transactions that move values from a source list
 // to destination list through two contended channels.
 TEST_F(MultiTest, ContendedList) {
@@ -0,0 +1,232 @@
+// Copyright 2023, DragonflyDB authors.  All rights reserved.
+// See LICENSE for licensing terms.
+//
+
+#include <fcntl.h>
+#include <mimalloc.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include <absl/random/random.h>
+#include <absl/strings/str_cat.h>
+
+#include <filesystem>
+
+extern "C" {
+#include "redis/redis_aux.h"
+#include "redis/zmalloc.h"
+}
+
+#include "base/flags.h"
+#include "base/gtest.h"
+#include "base/logging.h"
+#include "core/compact_object.h"
+#include "core/small_string.h"
+#include "io/file.h"
+#include "server/journal/journal_slice.h"
+#include "server/journal/serializer.h"
+#include "server/journal/types.h"
+#include "server/rdb_save.h"
+
+// In-process benchmarks for the persistence write paths: RdbSerializer and the journal,
+// without a running server. Run with --benchmark_filter=all (see base/gtest.h).
+//
+// Each path is measured against a null sink (pure serialization CPU cost), a buffered
+// file and, for the rdb path, an O_DIRECT file behind AlignedBuffer, so that CPU cost
+// and device cost can be told apart.
+
+ABSL_DECLARE_FLAG(uint64_t, journal_segment_size);
+ABSL_DECLARE_FLAG(uint32_t, journal_fsync_interval_ms);
+
+namespace dfly {
+
+using namespace std;
+
+namespace {
+
+namespace fs = std::filesystem;
+
+// The serializers operate on CompactObj values, which require the same thread-local
+// state as the server shards.
+void InitThreadStructs() {
+  static bool init = [] {
+    InitRedisTables();  // to initialize server struct.
+
+    auto* tlh = mi_heap_get_backing();
+    init_zmalloc_threadlocal(tlh);
+    SmallString::InitThreadLocal(tlh);
+    CompactObj::InitThreadLocal(PMR_NS::get_default_resource());
+    return true;
+  }();
+  (void)init;
+}
+
+// Swallows writes, leaving only the serialization cost in the measurement.
+class NullSink : public io::Sink {
+ public:
+  io::Result<size_t> WriteSome(const iovec* v, uint32_t len) final {
+    size_t res = 0;
+    for (uint32_t i = 0; i < len; ++i)
+      res += v[i].iov_len;
+    return res;
+  }
+};
+
+// Unbuffered writes into a descriptor opened with O_DIRECT. Must sit behind
+// AlignedBuffer, which guarantees 4KB-aligned chunks.
+class DirectFdSink : public io::Sink {
+ public:
+  explicit DirectFdSink(int fd) : fd_(fd) {
+  }
+
+  io::Result<size_t> WriteSome(const iovec* v, uint32_t len) final {
+    ssize_t res = writev(fd_, v, len);
+    if (res < 0)
+      return nonstd::make_unexpected(error_code{errno, system_category()});
+    return res;
+  }
+
+ private:
+  int fd_;
+};
+
+// Incompressible values of the given size, so that the measurement does not depend
+// on how well 'xxxx...' compresses.
+string RandomValue(absl::InsecureBitGen* gen, size_t size) {
+  string res(size, 0);
+  for (char& c : res)
+    c = absl::Uniform<uint8_t>(*gen);
+  return res;
+}
+
+struct Dataset {
+  vector<pair<CompactObj, CompactObj>> entries;  // key, string value.
+
+  Dataset(size_t count, size_t value_size) {
+    absl::InsecureBitGen gen;
+    for (size_t i = 0; i < count; ++i) {
+      CompactObj key{absl::StrCat("key:", i)};
+      CompactObj value;
+      value.SetString(RandomValue(&gen, value_size));
+      entries.emplace_back(std::move(key), std::move(value));
+    }
+  }
+};
+
+constexpr size_t kBatchSize = 64;  // entries serialized between sink flushes.
+
+void SaveEntries(benchmark::State& state, io::Sink* sink) {
+  InitThreadStructs();
+
+  size_t value_size = state.range(0);
+  Dataset dataset{kBatchSize, value_size};
+
+  RdbSerializer serializer{CompressionMode::NONE};
+  size_t bytes = 0;
+  while (state.KeepRunning()) {
+    for (const auto& [key, value] : dataset.entries) {
+      auto res = serializer.SaveEntry(key, value, 0, 0);
+      CHECK(res.has_value());
+    }
+    bytes += serializer.SerializedLen();
+    CHECK(!serializer.FlushToSink(sink));
+  }
+
+  state.SetBytesProcessed(bytes);
+  state.SetItemsProcessed(state.iterations() * kBatchSize);
+}
+
+void BM_RdbSaveEntryNull(benchmark::State& state) {
+  NullSink sink;
+  SaveEntries(state, &sink);
+}
+BENCHMARK(BM_RdbSaveEntryNull)->Arg(64)->Arg(1024)->Arg(16384);
+
+void BM_RdbSaveEntryFile(benchmark::State& state) {
+  fs::path path = fs::temp_directory_path() / "dfly_persistence_bench.rdb";
+  io::Result<io::WriteFile*> res = io::OpenWrite(path.string());
+  CHECK(res.has_value());
+  unique_ptr<io::WriteFile> file{res.value()};
+
+  SaveEntries(state, file.get());
+
+  CHECK(!file->Close());
+  fs::remove(path);
+}
+BENCHMARK(BM_RdbSaveEntryFile)->Arg(64)->Arg(1024)->Arg(16384);
+
+void BM_RdbSaveEntryDirectFile(benchmark::State& state) {
+  fs::path path = fs::temp_directory_path() / "dfly_persistence_bench_direct.rdb";
+  int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_DIRECT, 0644);
+  if (fd < 0) {  // tmpfs does not support O_DIRECT.
+    state.SkipWithError("O_DIRECT open failed");
+    return;
+  }
+
+  DirectFdSink fd_sink{fd};
+  AlignedBuffer buf{4096 * 8, &fd_sink};
+  SaveEntries(state, &buf);
+  CHECK(!buf.Flush());
+
+  close(fd);
+  fs::remove(path);
+}
+BENCHMARK(BM_RdbSaveEntryDirectFile)->Arg(64)->Arg(1024)->Arg(16384);
+
+journal::Entry MakeJournalEntry(TxId txid, const vector<string_view>& args) {
+  return {txid, journal::Op::COMMAND, 0, 1,
+          make_pair("SET", ArgSlice{args.data(), args.size()})};
+}
+
+void BM_JournalWriterNull(benchmark::State& state) {
+  absl::InsecureBitGen gen;
+  string value = RandomValue(&gen, state.range(0));
+  vector<string_view> args = {"key", value};
+
+  NullSink sink;
+  JournalWriter writer{&sink};
+
+  TxId txid = 0;
+  while (state.KeepRunning()) {
+    writer.Write(MakeJournalEntry(txid++, args));
+  }
+
+  state.SetItemsProcessed(state.iterations());
+  state.SetBytesProcessed(state.iterations() * value.size());
+}
+BENCHMARK(BM_JournalWriterNull)->Arg(64)->Arg(1024)->Arg(16384);
+
+void BM_JournalAddLogRecord(benchmark::State& state) {
+  // One big segment and on-demand fsync only: measure the append path, not
+  // rotation or the group commit timer (which needs a proactor).
+  absl::SetFlag(&FLAGS_journal_segment_size, 1ULL << 30);
+  absl::SetFlag(&FLAGS_journal_fsync_interval_ms, 0);
+
+  fs::path dir = fs::temp_directory_path() / "dfly_persistence_bench_journal";
+  fs::remove_all(dir);
+
+  absl::InsecureBitGen gen;
+  string value = RandomValue(&gen, state.range(0));
+  vector<string_view> args = {"key", value};
+
+  journal::JournalSlice slice;
+  slice.Init(0);
+  CHECK(!slice.Open(dir.string()));
+
+  TxId txid = 0;
+  while (state.KeepRunning()) {
+    slice.AddLogRecord(MakeJournalEntry(txid++, args), false);
+  }
+
+  CHECK(!slice.WaitFsync(slice.cur_lsn() - 1));
+  CHECK(!slice.Close());
+  fs::remove_all(dir);
+
+  state.SetItemsProcessed(state.iterations());
+  state.SetBytesProcessed(state.iterations() * value.size());
+}
+BENCHMARK(BM_JournalAddLogRecord)->Arg(64)->Arg(1024)->Arg(16384);
+
+}  // namespace
+
+}  // namespace dfly
@@ -26,6 +26,10 @@ const uint8_t RDB_OPCODE_COMPRESSED_ZSTD_BLOB_START = 201;
 const uint8_t RDB_OPCODE_COMPRESSED_LZ4_BLOB_START = 202;
 const uint8_t RDB_OPCODE_COMPRESSED_BLOB_END = 203;
 
+// A zstd dictionary trained by the producer on sampled stream data. It applies
+// to all subsequent compressed zstd blobs in the stream.
+const uint8_t RDB_OPCODE_COMPRESSED_ZSTD_DICT = 204;
+
 const uint8_t RDB_OPCODE_JOURNAL_BLOB = 210;
 
 // A full sync will continue to send information in journal blobs until the replica
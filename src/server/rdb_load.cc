@@ -217,6 +217,10 @@ class DecompressImpl {
   }
   virtual io::Result<base::IoBuf*> Decompress(std::string_view str) = 0;
 
+  // Sets the dictionary for subsequent blobs, see RDB_OPCODE_COMPRESSED_ZSTD_DICT.
+  virtual void SetDict(std::string dict) {
+  }
+
  protected:
   base::IoBuf uncompressed_mem_buf_;
 };
@@ -232,8 +236,13 @@ class ZstdDecompress : public DecompressImpl {
 
   io::Result<base::IoBuf*> Decompress(std::string_view str);
 
+  void SetDict(std::string dict) final {
+    dict_ = std::move(dict);
+  }
+
  private:
   ZSTD_DCtx* dctx_;
+  std::string dict_;
 };
 
 io::Result<base::IoBuf*> ZstdDecompress::Decompress(std::string_view str) {
@@ -255,8 +264,13 @@ io::Result<base::IoBuf*> ZstdDecompress::Decompress(std::string_view str) {
   if (dest.size() < uncomp_size) {
     return Unexpected(errc::out_of_memory);
   }
+  // Frames produced before the dictionary was trained do not reference it, so
+  // decompressing them with the dictionary loaded is also correct.
   size_t const d_size =
-      ZSTD_decompressDCtx(dctx_, dest.data(), dest.size(), str.data(), str.size());
+      dict_.empty()
+          ? ZSTD_decompressDCtx(dctx_, dest.data(), dest.size(), str.data(), str.size())
+          : ZSTD_decompress_usingDict(dctx_, dest.data(), dest.size(), str.data(), str.size(),
+                                      dict_.data(), dict_.size());
   if (d_size == 0 || d_size != uncomp_size) {
     LOG(ERROR) << "Invalid ZSTD compressed string";
     return Unexpected(errc::rdb_file_corrupted);
@@ -893,13 +907,26 @@ void RdbLoaderBase::OpaqueObjLoader::HandleBlob(string_view blob) {
       res->encoding = OBJ_ENCODING_INTSET;
     }
     pv_->ImportRObj(res);
-  } else if (rdb_type_ == RDB_TYPE_HASH_ZIPLIST) {
-    unsigned char* lp = lpNew(blob.size());
-    if (!ziplistPairsConvertAndValidateIntegrity((const uint8_t*)blob.data(), blob.size(), &lp)) {
-      LOG(ERROR) << "Zset ziplist integrity check failed.";
-      zfree(lp);
-      ec_ = RdbError(errc::rdb_file_corrupted);
-      return;
+  } else if (rdb_type_ == RDB_TYPE_HASH_ZIPLIST || rdb_type_ == RDB_TYPE_HASH_LISTPACK) {
+    unsigned char* lp;
+    if (rdb_type_ == RDB_TYPE_HASH_LISTPACK) {
+      // The blob is the listpack itself - no conversion needed.
+      lp = (unsigned char*)zmalloc(blob.size());
+      ::memcpy(lp, blob.data(), blob.size());
+      if (!lpValidateIntegrity(lp, blob.size(), 0, NULL, NULL) || lpLength(lp) % 2) {
+        LOG(ERROR) << "Hash listpack integrity check failed.";
+        zfree(lp);
+        ec_ = RdbError(errc::rdb_file_corrupted);
+        return;
+      }
+    } else {
+      lp = lpNew(blob.size());
+      if (!ziplistPairsConvertAndValidateIntegrity((const uint8_t*)blob.data(), blob.size(), &lp)) {
+        LOG(ERROR) << "Hash ziplist integrity check failed.";
+        zfree(lp);
+        ec_ = RdbError(errc::rdb_file_corrupted);
+        return;
+      }
     }
 
     if (lpLength(lp) == 0) {
@@ -917,13 +944,26 @@ void RdbLoaderBase::OpaqueObjLoader::HandleBlob(string_view blob) {
       pv_->InitRobj(OBJ_HASH, kEncodingListPack, lp);
     }
     return;
-  } else if (rdb_type_ == RDB_TYPE_ZSET_ZIPLIST) {
-    unsigned char* lp = lpNew(blob.size());
-    if (!ziplistPairsConvertAndValidateIntegrity((uint8_t*)blob.data(), blob.size(), &lp)) {
-      LOG(ERROR) << "Zset ziplist integrity check failed.";
-      zfree(lp);
-      ec_ = RdbError(errc::rdb_file_corrupted);
-      return;
+  } else if (rdb_type_ == RDB_TYPE_ZSET_ZIPLIST || rdb_type_ == RDB_TYPE_ZSET_LISTPACK) {
+    unsigned char* lp;
+    if (rdb_type_ == RDB_TYPE_ZSET_LISTPACK) {
+      // The blob is the listpack itself - no conversion needed.
+      lp = (unsigned char*)zmalloc(blob.size());
+      ::memcpy(lp, blob.data(), blob.size());
+      if (!lpValidateIntegrity(lp, blob.size(), 0, NULL, NULL) || lpLength(lp) % 2) {
+        LOG(ERROR) << "Zset listpack integrity check failed.";
+        zfree(lp);
+        ec_ = RdbError(errc::rdb_file_corrupted);
+        return;
+      }
+    } else {
+      lp = lpNew(blob.size());
+      if (!ziplistPairsConvertAndValidateIntegrity((uint8_t*)blob.data(), blob.size(), &lp)) {
+        LOG(ERROR) << "Zset ziplist integrity check failed.";
+        zfree(lp);
+        ec_ = RdbError(errc::rdb_file_corrupted);
+        return;
+      }
     }
 
     if (lpLength(lp) == 0) {
@@ -1240,7 +1280,8 @@ error_code RdbLoaderBase::ReadObj(int rdbtype, OpaqueObj* dest) {
       iores = ReadIntSet();
       break;
     case RDB_TYPE_HASH_ZIPLIST:
-      iores = ReadHZiplist();
+    case RDB_TYPE_HASH_LISTPACK:
+      iores = ReadHZiplist(rdbtype);
       break;
     case RDB_TYPE_HASH:
       iores = ReadHMap();
@@ -1250,7 +1291,8 @@ error_code RdbLoaderBase::ReadObj(int rdbtype, OpaqueObj* dest) {
       iores = ReadZSet(rdbtype);
       break;
     case RDB_TYPE_ZSET_ZIPLIST:
-      iores = ReadZSetZL();
+    case RDB_TYPE_ZSET_LISTPACK:
+      iores = ReadZSetZL(rdbtype);
       break;
     case RDB_TYPE_LIST_QUICKLIST:
     case RDB_TYPE_LIST_QUICKLIST_2:
@@ -1394,7 +1436,7 @@ auto RdbLoaderBase::ReadIntSet() -> io::Result<OpaqueObj> {
   return OpaqueObj{std::move(obj), RDB_TYPE_SET_INTSET};
 }
 
-auto RdbLoaderBase::ReadHZiplist() -> io::Result<OpaqueObj> {
+auto RdbLoaderBase::ReadHZiplist(int rdbtype) -> io::Result<OpaqueObj> {
   RdbVariant str_obj;
   error_code ec = ReadStringObj(&str_obj);
   if (ec)
@@ -1404,7 +1446,7 @@ auto RdbLoaderBase::ReadHZiplist() -> io::Result<OpaqueObj> {
     return Unexpected(errc::rdb_file_corrupted);
   }
 
-  return OpaqueObj{std::move(str_obj), RDB_TYPE_HASH_ZIPLIST};
+  return OpaqueObj{std::move(str_obj), rdbtype};
 }
 
 auto RdbLoaderBase::ReadHMap() -> io::Result<OpaqueObj> {
@@ -1470,7 +1512,7 @@ auto RdbLoaderBase::ReadZSet(int rdbtype) -> io::Result<OpaqueObj> {
   return OpaqueObj{std::move(load_trace), rdbtype};
 }
 
-auto RdbLoaderBase::ReadZSetZL() -> io::Result<OpaqueObj> {
+auto RdbLoaderBase::ReadZSetZL(int rdbtype) -> io::Result<OpaqueObj> {
   RdbVariant str_obj;
   error_code ec = ReadStringObj(&str_obj);
   if (ec)
@@ -1480,7 +1522,7 @@ auto RdbLoaderBase::ReadZSetZL() -> io::Result<OpaqueObj> {
     return Unexpected(errc::rdb_file_corrupted);
   }
 
-  return OpaqueObj{std::move(str_obj), RDB_TYPE_ZSET_ZIPLIST};
+  return OpaqueObj{std::move(str_obj), rdbtype};
 }
 
 auto RdbLoaderBase::ReadListQuicklist(int rdbtype) -> io::Result<OpaqueObj> {
@@ -1889,6 +1931,11 @@ error_code RdbLoader::Load(io::Source* src) {
       continue;
     }
 
+    if (type == RDB_OPCODE_COMPRESSED_ZSTD_DICT) {
+      RETURN_ON_ERR(HandleCompressionDict());
+      continue;
+    }
+
     if (type == RDB_OPCODE_COMPRESSED_BLOB_END) {
       RETURN_ON_ERR(HandleCompressedBlobFinish());
       continue;
@@ -2041,6 +2088,15 @@ error_code RdbLoaderBase::HandleCompressedBlobFinish() {
   return kOk;
 }
 
+error_code RdbLoaderBase::HandleCompressionDict() {
+  AllocateDecompressOnce(RDB_OPCODE_COMPRESSED_ZSTD_BLOB_START);
+
+  string dict;
+  SET_OR_RETURN(FetchGenericString(), dict);
+  decompress_impl_->SetDict(std::move(dict));
+  return kOk;
+}
+
 error_code RdbLoaderBase::HandleJournalBlob(Service* service) {
   // Read the number of entries in the journal blob.
   size_t num_entries;
@@ -2132,6 +2188,28 @@ error_code RdbLoader::HandleAux() {
     if (absl::SimpleAtoi(auxval, &haspreamble) && haspreamble) {
       VLOG(1) << "RDB has an AOF tail";
     }
+  } else if (auxkey == "shard-count") {
+    int64_t shard_cnt;
+    if (absl::SimpleAtoi(auxval, &shard_cnt) && shard_cnt > 0) {
+      shard_count_ = shard_cnt;
+    }
+  } else if (absl::StartsWith(auxkey, "db-size-")) {
+    // Total key count of a database, recorded in the summary file. The summary loads
+    // before any shard file, so reserving here means the restore performs no table
+    // growth while the shard files stream their entries in.
+    uint32_t dbid;
+    int64_t key_num;
+    if (absl::SimpleAtoi(auxkey.substr(strlen("db-size-")), &dbid) &&
+        absl::SimpleAtoi(auxval, &key_num) && key_num > 0 && dbid <= GetFlag(FLAGS_dbnum)) {
+      size_t per_shard = size_t(key_num) / shard_set->size();
+      if (per_shard >= 1024) {  // too small to be worth a hop.
+        for (ShardId i = 0; i < shard_set->size(); ++i) {
+          shard_set->Add(i, [dbid, per_shard] {
+            EngineShard::tlocal()->db_slice().Reserve(dbid, per_shard);
+          });
+        }
+      }
+    }
   } else if (auxkey == "redis-bits") {
     /* Just ignored. */
   } else {
@@ -2202,6 +2280,19 @@ void RdbLoader::LoadItemsBuffer(DbIndex db_ind, const ItemsBuf& ib) {
 void RdbLoader::ResizeDb(size_t key_num, size_t expire_num) {
   DCHECK_LT(key_num, 1U << 31);
   DCHECK_LT(expire_num, 1U << 31);
+
+  // The hint does not tell how the keys distribute between shards, so assume
+  // uniformity. Under-reserving is not a problem - the tables will grow as
+  // usual; the hint only saves the incremental rehashing on the way.
+  size_t per_shard = key_num / shard_set->size();
+  if (per_shard < 1024)  // too small to be worth a hop.
+    return;
+
+  for (ShardId i = 0; i < shard_set->size(); ++i) {
+    shard_set->Add(i, [dbid = cur_db_index_, per_shard] {
+      EngineShard::tlocal()->db_slice().Reserve(dbid, per_shard);
+    });
+  }
 }
 
 error_code RdbLoader::LoadKeyValPair(int type, ObjSettings* settings) {
@@ -125,16 +125,17 @@ class RdbLoaderBase {
 
   ::io::Result<OpaqueObj> ReadSet();
   ::io::Result<OpaqueObj> ReadIntSet();
-  ::io::Result<OpaqueObj> ReadHZiplist();
+  ::io::Result<OpaqueObj> ReadHZiplist(int rdbtype);
   ::io::Result<OpaqueObj> ReadHMap();
   ::io::Result<OpaqueObj> ReadZSet(int rdbtype);
-  ::io::Result<OpaqueObj> ReadZSetZL();
+  ::io::Result<OpaqueObj> ReadZSetZL(int rdbtype);
   ::io::Result<OpaqueObj> ReadListQuicklist(int rdbtype);
   ::io::Result<OpaqueObj> ReadStreams();
   ::io::Result<OpaqueObj> ReadJson();
 
   std::error_code HandleCompressedBlob(int op_type);
   std::error_code HandleCompressedBlobFinish();
+  std::error_code HandleCompressionDict();
   void AllocateDecompressOnce(int op_type);
 
   std::error_code HandleJournalBlob(Service* service);
@@ -185,6 +186,12 @@ class RdbLoader : protected RdbLoaderBase {
     return load_time_;
   }
 
+  // Number of shard files recorded in the summary file of a multi-file
+  // snapshot. Zero for single-file snapshots, shard files and older summaries.
+  uint32_t shard_count() const {
+    return shard_count_;
+  }
+
   // Return the offset that was received with a RDB_OPCODE_JOURNAL_OFFSET command,
   // or 0 if no offset was received.
   uint64_t journal_offset() const {
@@ -235,6 +242,7 @@ class RdbLoader : protected RdbLoaderBase {
 
   size_t keys_loaded_ = 0;
   double load_time_ = 0;
+  uint32_t shard_count_ = 0;
 
   DbIndex cur_db_index_ = 0;
 
@@ -8,6 +8,7 @@
 #include <absl/strings/str_cat.h>
 #include <absl/strings/str_format.h>
 #include <lz4frame.h>
+#include <zdict.h>
 #include <zstd.h>
 
 #include <jsoncons/json.hpp>
@@ -123,13 +124,13 @@ uint8_t RdbObjectType(unsigned type, unsigned compact_enc) {
       break;
     case OBJ_ZSET:
       if (compact_enc == OBJ_ENCODING_LISTPACK)
-        return RDB_TYPE_ZSET_ZIPLIST;  // we save using the old ziplist encoding.
+        return RDB_TYPE_ZSET_LISTPACK;  // the in-memory listpack is saved verbatim.
       else if (compact_enc == OBJ_ENCODING_SKIPLIST)
         return RDB_TYPE_ZSET_2;
       break;
     case OBJ_HASH:
       if (compact_enc == kEncodingListPack)
-        return RDB_TYPE_HASH_ZIPLIST;
+        return RDB_TYPE_HASH_LISTPACK;  // the in-memory listpack is saved verbatim.
       else if (compact_enc == kEncodingStrMap2)
         return RDB_TYPE_HASH;
       break;
@@ -155,6 +156,13 @@ class CompressorImpl {
   }
   virtual io::Result<io::Bytes> Compress(io::Bytes data) = 0;
 
+  // Returns a dictionary that was trained since the last call, or an empty
+  // string. The caller must emit it into the stream before the frame that was
+  // compressed with it.
+  virtual std::string TakePendingDict() {
+    return {};
+  }
+
  protected:
   int compression_level_ = 1;
   size_t compressed_size_total_ = 0;
@@ -162,6 +170,13 @@ class CompressorImpl {
   base::PODArray<uint8_t> compr_buf_;
 };
 
+// Dictionary training parameters. Small values barely compress on their own,
+// so we sample the first few megabytes of the serialized stream and train a
+// shared dictionary that all subsequent frames reference.
+constexpr size_t kZstdTrainBytes = 1u << 22;    // sample this much data before training.
+constexpr size_t kZstdSampleChunk = 4096;       // trainer sample granularity.
+constexpr size_t kZstdDictCapacity = 1u << 16;  // upper bound on the dictionary size.
+
 class ZstdCompressor : public CompressorImpl {
  public:
   ZstdCompressor() {
@@ -169,22 +184,69 @@ class ZstdCompressor : public CompressorImpl {
   }
   ~ZstdCompressor() {
     ZSTD_freeCCtx(cctx_);
+    if (cdict_)
+      ZSTD_freeCDict(cdict_);
   }
 
   io::Result<io::Bytes> Compress(io::Bytes data);
 
+  std::string TakePendingDict() final {
+    return std::exchange(pending_dict_, std::string{});
+  }
+
  private:
+  void TrainDict();
+
   ZSTD_CCtx* cctx_;
+  ZSTD_CDict* cdict_ = nullptr;
+  std::string sample_buf_, pending_dict_;
+  bool sampling_done_ = false;
   base::PODArray<uint8_t> compr_buf_;
 };
 
+void ZstdCompressor::TrainDict() {
+  sampling_done_ = true;
+
+  // Serialized frames do not preserve entry boundaries, so feed the sampled
+  // bytes to the trainer as fixed-size chunks.
+  vector<size_t> sample_sizes(sample_buf_.size() / kZstdSampleChunk, kZstdSampleChunk);
+
+  string dict(kZstdDictCapacity, '\0');
+  size_t dict_size = ZDICT_trainFromBuffer(dict.data(), dict.size(), sample_buf_.data(),
+                                           sample_sizes.data(), sample_sizes.size());
+  sample_buf_ = {};
+
+  if (ZDICT_isError(dict_size)) {
+    VLOG(1) << "zstd dictionary training failed: " << ZDICT_getErrorName(dict_size);
+    return;
+  }
+  dict.resize(dict_size);
+
+  cdict_ = ZSTD_createCDict(dict.data(), dict.size(), compression_level_);
+  if (cdict_) {
+    pending_dict_ = std::move(dict);
+  }
+}
+
 io::Result<io::Bytes> ZstdCompressor::Compress(io::Bytes data) {
+  if (!sampling_done_) {
+    sample_buf_.append(reinterpret_cast<const char*>(data.data()), data.size());
+    if (sample_buf_.size() >= kZstdTrainBytes)
+      TrainDict();
+  }
+
   size_t buf_size = ZSTD_compressBound(data.size());
   if (compr_buf_.capacity() < buf_size) {
     compr_buf_.reserve(buf_size);
   }
-  size_t compressed_size = ZSTD_compressCCtx(cctx_, compr_buf_.data(), compr_buf_.capacity(),
-                                             data.data(), data.size(), compression_level_);
+  size_t compressed_size;
+  if (cdict_) {
+    compressed_size = ZSTD_compress_usingCDict(cctx_, compr_buf_.data(), compr_buf_.capacity(),
+                                               data.data(), data.size(), cdict_);
+  } else {
+    compressed_size = ZSTD_compressCCtx(cctx_, compr_buf_.data(), compr_buf_.capacity(),
+                                        data.data(), data.size(), compression_level_);
+  }
 
   if (ZSTD_isError(compressed_size)) {
     return make_unexpected(error_code{int(compressed_size), generic_category()});
@@ -435,8 +497,9 @@ error_code RdbSerializer::SaveHSetObject(const PrimeValue& pv) {
   } else {
     CHECK_EQ(kEncodingListPack, pv.Encoding());
 
+    // The wire encoding of RDB_TYPE_HASH_LISTPACK is the in-memory listpack itself.
     uint8_t* lp = (uint8_t*)pv.RObjPtr();
-    RETURN_ON_ERR(SaveListPackAsZiplist(lp));
+    RETURN_ON_ERR(SaveString(string_view{reinterpret_cast<char*>(lp), lpBytes(lp)}));
   }
 
   return error_code{};
@@ -468,8 +531,9 @@ error_code RdbSerializer::SaveZSetObject(const PrimeValue& pv) {
     });
   } else {
     CHECK_EQ(pv.Encoding(), unsigned(OBJ_ENCODING_LISTPACK)) << "Unknown zset encoding";
+    // The wire encoding of RDB_TYPE_ZSET_LISTPACK is the in-memory listpack itself.
     uint8_t* lp = (uint8_t*)robj_wrapper->inner_obj();
-    RETURN_ON_ERR(SaveListPackAsZiplist(lp));
+    RETURN_ON_ERR(SaveString(string_view{reinterpret_cast<char*>(lp), lpBytes(lp)}));
   }
 
   return error_code{};
@@ -896,7 +960,8 @@ class RdbSaver::Impl {
   Impl(bool align_writes, unsigned producers_len, CompressionMode compression_mode,
        SaveMode save_mode, io::Sink* sink);
 
-  void StartSnapshotting(bool stream_journal, const Cancellation* cll, EngineShard* shard);
+  void StartSnapshotting(bool stream_journal, const Cancellation* cll, EngineShard* shard,
+                         std::optional<SlotSet> slots);
 
   void StopSnapshotting(EngineShard* shard);
 
@@ -935,6 +1000,9 @@ class RdbSaver::Impl {
   RdbSerializer meta_serializer_;
   SliceSnapshot::RecordChannel channel_;
   bool push_to_sink_with_order_ = false;
+  // Single shard modes stream the snapshot serializer straight into the sink,
+  // skipping the channel copy; the sink itself provides backpressure.
+  bool direct_stream_ = false;
   std::optional<AlignedBuffer> aligned_buf_;
   CompressionMode
       compression_mode_;  // Single entry compression is compatible with redis rdb snapshot
@@ -956,6 +1024,7 @@ RdbSaver::Impl::Impl(bool align_writes, unsigned producers_len, CompressionMode
   }
   if (sm == SaveMode::SINGLE_SHARD || sm == SaveMode::SINGLE_SHARD_WITH_SUMMARY) {
     push_to_sink_with_order_ = true;
+    direct_stream_ = true;
   }
 
   DCHECK(producers_len > 0 || channel_.IsClosing());
@@ -1011,6 +1080,16 @@ std::optional<SliceSnapshot::DbRecord> RdbSaver::Impl::RecordsPopper::InternalPo
 }
 
 error_code RdbSaver::Impl::ConsumeChannel(const Cancellation* cll) {
+  if (direct_stream_) {
+    // The snapshot writes into the sink by itself, it was only waiting for the
+    // header to be flushed (which our caller did). Unblock it and wait until it
+    // finished streaming.
+    auto& snapshot = shard_snapshots_[0];
+    error_code ec = snapshot->StreamDirect();
+    VLOG(1) << "Direct stream pushed bytes: " << snapshot->channel_bytes();
+    return ec;
+  }
+
   error_code io_error;
 
   size_t channel_bytes = 0;
@@ -1053,9 +1132,16 @@ error_code RdbSaver::Impl::ConsumeChannel(const Cancellation* cll) {
 }
 
 void RdbSaver::Impl::StartSnapshotting(bool stream_journal, const Cancellation* cll,
-                                       EngineShard* shard) {
+                                       EngineShard* shard, std::optional<SlotSet> slots) {
   auto& s = GetSnapshot(shard);
-  s.reset(new SliceSnapshot(&shard->db_slice(), &channel_, compression_mode_));
+  if (direct_stream_) {
+    s.reset(new SliceSnapshot(&shard->db_slice(), sink_, compression_mode_));
+  } else {
+    s.reset(new SliceSnapshot(&shard->db_slice(), &channel_, compression_mode_));
+  }
+
+  if (slots)
+    s->SetSlotFilter(std::move(*slots));
 
   s->Start(stream_journal, cll);
 }
@@ -1073,10 +1159,14 @@ void RdbSaver::Impl::Cancel() {
   if (snapshot)
     snapshot->Cancel();
 
-  dfly::SliceSnapshot::DbRecord rec;
-  while (channel_.Pop(rec)) {
+  if (!direct_stream_) {
+    dfly::SliceSnapshot::DbRecord rec;
+    while (channel_.Pop(rec)) {
+    }
   }
 
+  // In direct mode the fiber may be blocked mid-write, so the caller must have
+  // shut down the sink's socket before cancelling.
   snapshot->Join();
 }
 
@@ -1140,8 +1230,8 @@ RdbSaver::~RdbSaver() {
 }
 
 void RdbSaver::StartSnapshotInShard(bool stream_journal, const Cancellation* cll,
-                                    EngineShard* shard) {
-  impl_->StartSnapshotting(stream_journal, cll, shard);
+                                    EngineShard* shard, std::optional<SlotSet> slots) {
+  impl_->StartSnapshotting(stream_journal, cll, shard, std::move(slots));
 }
 
 void RdbSaver::StopSnapshotInShard(EngineShard* shard) {
@@ -1159,6 +1249,10 @@ error_code RdbSaver::SaveHeader(const StringVec& lua_scripts) {
   return error_code{};
 }
 
+error_code RdbSaver::FlushHeader() {
+  return impl_->serializer()->FlushToSink(impl_->sink());
+}
+
 error_code RdbSaver::SaveBody(const Cancellation* cll, RdbTypeFreqMap* freq_map) {
   RETURN_ON_ERR(impl_->serializer()->FlushToSink(impl_->sink()));
 
@@ -1199,6 +1293,42 @@ error_code RdbSaver::SaveAux(const StringVec& lua_scripts) {
 
   RETURN_ON_ERR(SaveAuxFieldStrInt("aof-preamble", aof_preamble));
 
+  // The summary file acts as the manifest of a multi-file snapshot: record how
+  // many shard files belong to it so that the loader can detect missing or
+  // stale segments.
+  if (save_mode_ == SaveMode::SUMMARY) {
+    RETURN_ON_ERR(SaveAuxFieldStrInt("shard-count", shard_set->size()));
+
+    // Record per-database key counts. The summary is loaded before any shard file,
+    // so the loader can reserve the prime tables up front and the restore performs
+    // no incremental table growth while inserting.
+    vector<vector<size_t>> shard_sizes(shard_set->size());
+    shard_set->RunBriefInParallel([&shard_sizes](EngineShard* es) {
+      auto& sizes = shard_sizes[es->shard_id()];
+      DbSlice& db_slice = es->db_slice();
+      sizes.resize(db_slice.db_array_size());
+      for (DbIndex i = 0; i < db_slice.db_array_size(); ++i) {
+        if (db_slice.IsDbValid(i))
+          sizes[i] = db_slice.GetTables(i).first->size();
+      }
+    });
+
+    size_t num_dbs = 0;
+    for (const auto& sizes : shard_sizes)
+      num_dbs = max(num_dbs, sizes.size());
+
+    for (size_t db = 0; db < num_dbs; ++db) {
+      size_t total = 0;
+      for (const auto& sizes : shard_sizes) {
+        if (db < sizes.size())
+          total += sizes[db];
+      }
+      if (total > 0) {
+        RETURN_ON_ERR(SaveAuxFieldStrInt(absl::StrCat("db-size-", db), total));
+      }
+    }
+  }
+
   // Save lua scripts only in rdb or summary file
   DCHECK(save_mode_ != SaveMode::SINGLE_SHARD || lua_scripts.empty());
   for (const string& s : lua_scripts) {
@@ -1277,9 +1407,28 @@ void RdbSerializer::CompressBlob() {
     return;
   }
 
+  // A trained dictionary must reach the stream before the first frame that was
+  // compressed with it.
+  string compression_dict = compressor_impl_->TakePendingDict();
+
   // Clear membuf and write the compressed blob to it
   mem_buf_.ConsumeInput(blob_size);
-  mem_buf_.Reserve(compressed_blob.length() + 1 + 9);  // reserve space for blob + opcode + len
+  // reserve space for dict + blob + opcodes + lens
+  mem_buf_.Reserve(compression_dict.size() + compressed_blob.length() + 2 + 18);
+
+  if (!compression_dict.empty()) {
+    auto dest = mem_buf_.AppendBuffer();
+    dest[0] = RDB_OPCODE_COMPRESSED_ZSTD_DICT;
+    mem_buf_.CommitWrite(1);
+
+    dest = mem_buf_.AppendBuffer();
+    unsigned enclen = WritePackedUInt(compression_dict.size(), dest);
+    mem_buf_.CommitWrite(enclen);
+
+    dest = mem_buf_.AppendBuffer();
+    memcpy(dest.data(), compression_dict.data(), compression_dict.size());
+    mem_buf_.CommitWrite(compression_dict.size());
+  }
 
   // First write opcode for compressed string
   auto dest = mem_buf_.AppendBuffer();
@@ -15,6 +15,7 @@ extern "C" {
 #include "base/io_buf.h"
 #include "base/pod_array.h"
 #include "io/io.h"
+#include "server/cluster/cluster_config.h"
 #include "server/common.h"
 #include "server/journal/serializer.h"
 #include "server/journal/types.h"
@@ -78,9 +79,11 @@ class RdbSaver {
 
   ~RdbSaver();
 
-  // Initiates the serialization in the shard's thread.
+  // Initiates the serialization in the shard's thread. If slots is set, only keys
+  // hashing into these cluster slots are serialized (used for slot migration).
   // TODO: to implement break functionality to allow stopping early.
-  void StartSnapshotInShard(bool stream_journal, const Cancellation* cll, EngineShard* shard);
+  void StartSnapshotInShard(bool stream_journal, const Cancellation* cll, EngineShard* shard,
+                            std::optional<SlotSet> slots = std::nullopt);
 
   // Stops serialization in journal streaming mode in the shard's thread.
   void StopSnapshotInShard(EngineShard* shard);
@@ -88,6 +91,11 @@ class RdbSaver {
   // Stores auxiliary (meta) values and lua scripts.
   std::error_code SaveHeader(const StringVec& lua_scripts);
 
+  // Flushes the data written so far (i.e. the header) into the sink. Used
+  // instead of SaveBody by flows that stream their body from a shared snapshot
+  // pass, see SnapshotFanout.
+  std::error_code FlushHeader();
+
   // Writes the RDB file into sink. Waits for the serialization to finish.
   // Fills freq_map with the histogram of rdb types.
   // freq_map can optionally be null.
@@ -95,6 +95,17 @@ TEST_F(RdbTest, Crc) {
   c2 = crc64(0, to_byte(s.data() + 4), 4);
   c3 = crc64(c2, to_byte(s.data()), 4);
   EXPECT_NE(c, c3);
+
+  // Long inputs take the carry-less multiplication path on supporting CPUs; it must
+  // agree with the table-driven result regardless of how the input is split.
+  string blob(100001, '\0');
+  for (size_t i = 0; i < blob.size(); ++i)
+    blob[i] = i * 13;
+  c = crc64(0, to_byte(blob.data()), blob.size());
+  c2 = 0;
+  for (size_t i = 0; i < blob.size(); i += 23)
+    c2 = crc64(c2, to_byte(blob.data() + i), min(blob.size() - i, size_t(23)));
+  EXPECT_EQ(c, c2);
 }
 
 TEST_F(RdbTest, LoadEmpty) {
@@ -199,6 +210,23 @@ TEST_F(RdbTest, RdbLoaderOnReadCompressedDataShouldNotEnterEnsureReadFlow) {
   ASSERT_EQ(resp, "OK");
 }
 
+TEST_F(RdbTest, ZstdDictCompressionSaveAndReload) {
+  SetFlag(&FLAGS_compression_mode, 2);
+
+  // Enough data so that each shard serializer passes the dictionary training
+  // threshold and emits dictionary-compressed frames.
+  Run({"debug", "populate", "20000", "key", "1024"});
+  ASSERT_EQ(20000, CheckedInt({"dbsize"}));
+
+  RespExpr resp = Run({"save", "df"});
+  ASSERT_EQ(resp, "OK");
+
+  auto save_info = service_->server_family().GetLastSaveInfo();
+  resp = Run({"debug", "load", save_info->file_name});
+  ASSERT_EQ(resp, "OK");
+  ASSERT_EQ(20000, CheckedInt({"dbsize"}));
+}
+
 TEST_F(RdbTest, Reload) {
   absl::FlagSaver fs;
 
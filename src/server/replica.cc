@@ -148,6 +148,7 @@ std::error_code Replica::TakeOver(std::string_view timeout) {
 }
 
 void Replica::MainReplicationFb() {
+  ThisFiber::SetName("replica_main");
   VLOG(1) << "Main replication fiber started";
   // Switch shard states to replication.
   SetShardStates(true);
@@ -281,6 +282,11 @@ std::error_code Replica::HandleCapaDflyResp() {
     return make_error_code(errc::bad_message);
   }
 
+  // A different master (or a restarted one) has a fresh journal, so the LSNs we saved
+  // for a partial sync do not refer to it.
+  if (master_context_.master_repl_id != ToSV(LastResponseArgs()[0].GetBuf())) {
+    last_journal_lsns_.reset();
+  }
   master_context_.master_repl_id = ToSV(LastResponseArgs()[0].GetBuf());
   master_context_.dfly_session_id = ToSV(LastResponseArgs()[1].GetBuf());
   num_df_flows_ = param_num_flows;
@@ -440,16 +446,23 @@ error_code Replica::InitiateDflySync() {
   // Make sure we're in LOADING state.
   CHECK(service_.SwitchState(GlobalState::ACTIVE, GlobalState::LOADING) == GlobalState::LOADING);
 
-  // Flush dbs.
-  JournalExecutor{&service_}.FlushAll();
+  // Only attempt a partial sync when we have the last applied LSN of every flow from a
+  // previous stable sync with this master, and the master understands the request.
+  bool try_partial = last_journal_lsns_.has_value() &&
+                     last_journal_lsns_->size() == num_df_flows_ &&
+                     master_context_.version >= DflyVersion::VER2;
 
-  // Start full sync flows.
+  // Start full sync flows. For a partial sync attempt each flow presents its last LSN
+  // and the master answers per flow whether its journal backlog still covers it.
   state_mask_.fetch_or(R_SYNCING);
   {
     auto partition = Partition(num_df_flows_);
     auto shard_cb = [&](unsigned index, auto*) {
       for (auto id : partition[index]) {
-        auto ec = shard_flows_[id]->StartFullSyncFlow(sync_block, &cntx_);
+        std::optional<LSN> lsn;
+        if (try_partial)
+          lsn = (*last_journal_lsns_)[id];
+        auto ec = shard_flows_[id]->StartFullSyncFlow(sync_block, &cntx_, lsn);
         if (ec)
           cntx_.ReportError(ec);
       }
@@ -460,15 +473,36 @@ error_code Replica::InitiateDflySync() {
     lock_guard lk{flows_op_mu_};
     shard_set->pool()->AwaitFiberOnAll(std::move(shard_cb));
   }
+  last_journal_lsns_.reset();  // One shot: a denied attempt falls back to a full sync.
 
   RETURN_ON_ERR(cntx_.GetError());
 
+  size_t partial_cnt = 0;
+  for (const auto& flow : shard_flows_)
+    partial_cnt += flow->IsPartialSync();
+  bool partial_sync = partial_cnt == num_df_flows_;
+
+  if (partial_cnt > 0 && !partial_sync) {
+    // Partial and full flows can not be mixed: full flows need the dbs flushed while
+    // partial flows resume from the current state. Drop the connections and restart the
+    // whole sync, this time requesting a full sync for all flows.
+    return cntx_.ReportError(make_error_code(errc::state_not_recoverable),
+                             "partial sync denied for some flows, retrying as full sync");
+  }
+
+  if (!partial_sync) {
+    // Flush dbs. Only needed before loading a fresh snapshot - a partial sync resumes
+    // the journal stream on top of the currently applied state.
+    JournalExecutor{&service_}.FlushAll();
+  }
+
   // Send DFLY SYNC.
   if (auto ec = SendNextPhaseRequest("SYNC"); ec) {
     return cntx_.ReportError(ec);
   }
 
-  LOG(INFO) << absl::StrCat("Started full sync with ", server().Description());
+  LOG(INFO) << absl::StrCat("Started ", partial_sync ? "partial" : "full", " sync with ",
+                            server().Description());
 
   // Wait for all flows to receive full sync cut.
   // In case of an error, this is unblocked by the error handler.
@@ -487,7 +521,8 @@ error_code Replica::InitiateDflySync() {
   // Joining flows and resetting state is done by cleanup.
 
   double seconds = double(absl::ToInt64Milliseconds(absl::Now() - start_time)) / 1000;
-  LOG(INFO) << "Full sync finished in " << strings::HumanReadableElapsedTime(seconds);
+  LOG(INFO) << (partial_sync ? "Partial" : "Full") << " sync finished in "
+            << strings::HumanReadableElapsedTime(seconds);
   return cntx_.GetError();
 }
 
@@ -582,6 +617,13 @@ error_code Replica::ConsumeDflyStream() {
   }
   JoinAllFlows();
 
+  // Remember where every flow stopped. On reconnect we present these LSNs to the
+  // master to attempt a partial sync from its journal backlog instead of a full
+  // snapshot.
+  last_journal_lsns_.emplace();
+  for (const auto& flow : shard_flows_)
+    last_journal_lsns_->push_back(flow->JournalExecutedCount());
+
   LOG(INFO) << "Exit stable sync";
   // The only option to unblock is to cancel the context.
   CHECK(cntx_.GetError());
@@ -615,7 +657,8 @@ error_code Replica::SendNextPhaseRequest(string_view kind) {
   return std::error_code{};
 }
 
-error_code DflyShardReplica::StartFullSyncFlow(BlockingCounter sb, Context* cntx) {
+error_code DflyShardReplica::StartFullSyncFlow(BlockingCounter sb, Context* cntx,
+                                               std::optional<LSN> lsn) {
   DCHECK(!master_context_.master_repl_id.empty() && !master_context_.dfly_session_id.empty());
 
   RETURN_ON_ERR(ConnectAndAuth(absl::GetFlag(FLAGS_master_connect_timeout_ms) * 1ms, &cntx_));
@@ -625,6 +668,9 @@ error_code DflyShardReplica::StartFullSyncFlow(BlockingCounter sb, Context* cntx
 
   auto cmd = StrCat("DFLY FLOW ", master_context_.master_repl_id, " ",
                     master_context_.dfly_session_id, " ", flow_id_);
+  // Try to negotiate a partial sync if we have a last known lsn.
+  if (lsn.has_value())
+    absl::StrAppend(&cmd, " ", *lsn);
 
   ResetParser(/*server_mode=*/false);
   leftover_buf_.emplace(128);
@@ -638,14 +684,27 @@ error_code DflyShardReplica::StartFullSyncFlow(BlockingCounter sb, Context* cntx
 
   string_view flow_directive = ToSV(LastResponseArgs()[0].GetBuf());
   string eof_token;
-  PC_RETURN_ON_BAD_RESPONSE(flow_directive == "FULL");
-  eof_token = ToSV(LastResponseArgs()[1].GetBuf());
+  if (flow_directive == "FULL") {
+    eof_token = ToSV(LastResponseArgs()[1].GetBuf());
+  } else if (lsn.has_value() && flow_directive == "PARTIAL") {
+    is_partial_sync_ = true;
+  } else {
+    PC_RETURN_ON_BAD_RESPONSE(false);
+  }
 
   leftover_buf_->ConsumeInput(read_resp->left_in_buffer);
 
-  // We can not discard io_buf because it may contain data
-  // besides the response we parsed. Therefore we pass it further to ReplicateDFFb.
-  sync_fb_ = MakeFiber(&DflyShardReplica::FullSyncDflyFb, this, std::move(eof_token), sb, cntx);
+  if (is_partial_sync_) {
+    // The master resumes streaming journal entries from *lsn right away; there is no
+    // snapshot phase, so this flow received its cut. Any bytes already read past the
+    // FLOW response stay in leftover_buf_ and are consumed by the stable sync fiber.
+    journal_rec_executed_.store(*lsn, std::memory_order_relaxed);
+    sb.Dec();
+  } else {
+    // We can not discard io_buf because it may contain data
+    // besides the response we parsed. Therefore we pass it further to ReplicateDFFb.
+    sync_fb_ = MakeFiber(&DflyShardReplica::FullSyncDflyFb, this, std::move(eof_token), sb, cntx);
+  }
 
   return error_code{};
 }
@@ -657,14 +716,13 @@ error_code DflyShardReplica::StartStableSyncFlow(Context* cntx) {
 
   CHECK(Sock()->IsOpen());
   sync_fb_ = MakeFiber(&DflyShardReplica::StableSyncDflyReadFb, this, cntx);
-  if (use_multi_shard_exe_sync_) {
-    execution_fb_ = MakeFiber(&DflyShardReplica::StableSyncDflyExecFb, this, cntx);
-  }
+  execution_fb_ = MakeFiber(&DflyShardReplica::StableSyncDflyExecFb, this, cntx);
 
   return std::error_code{};
 }
 
 void DflyShardReplica::FullSyncDflyFb(const string& eof_token, BlockingCounter bc, Context* cntx) {
+  ThisFiber::SetName(absl::StrCat("replica_full_sync", flow_id_));
   DCHECK(leftover_buf_);
   io::PrefixSource ps{leftover_buf_->InputBuffer(), Sock()};
 
@@ -711,6 +769,7 @@ void DflyShardReplica::FullSyncDflyFb(const string& eof_token, BlockingCounter b
 }
 
 void DflyShardReplica::StableSyncDflyReadFb(Context* cntx) {
+  ThisFiber::SetName(absl::StrCat("replica_stable_read", flow_id_));
   // Check leftover from full sync.
   io::Bytes prefix{};
   if (leftover_buf_ && leftover_buf_->InputLen() > 0) {
@@ -740,11 +799,9 @@ void DflyShardReplica::StableSyncDflyReadFb(Context* cntx) {
     last_io_time_ = Proactor()->GetMonotonicTimeNs();
 
     if (!tx_data->is_ping) {
-      if (use_multi_shard_exe_sync_) {
-        InsertTxDataToShardResource(std::move(*tx_data));
-      } else {
-        ExecuteTxWithNoShardSync(std::move(*tx_data), cntx);
-      }
+      // Hand off to the execution fiber so parsing the socket stream overlaps with
+      // applying transactions. The bounded queue above provides backpressure.
+      InsertTxDataToShardResource(std::move(*tx_data));
     } else {
       force_ping_ = true;
       journal_rec_executed_.fetch_add(1, std::memory_order_relaxed);
@@ -755,6 +812,7 @@ void DflyShardReplica::StableSyncDflyReadFb(Context* cntx) {
 }
 
 void Replica::RedisStreamAcksFb() {
+  ThisFiber::SetName("replica_acks");
   constexpr size_t kAckRecordMaxInterval = 1024;
   std::chrono::duration ack_time_max_interval =
       1ms * absl::GetFlag(FLAGS_replication_acks_interval);
@@ -778,6 +836,7 @@ void Replica::RedisStreamAcksFb() {
 }
 
 void DflyShardReplica::StableSyncDflyAcksFb(Context* cntx) {
+  ThisFiber::SetName(absl::StrCat("replica_stable_ack", flow_id_));
   constexpr size_t kAckRecordMaxInterval = 1024;
   std::chrono::duration ack_time_max_interval =
       1ms * absl::GetFlag(FLAGS_replication_acks_interval);
@@ -822,19 +881,6 @@ DflyShardReplica::~DflyShardReplica() {
   JoinFlow();
 }
 
-void DflyShardReplica::ExecuteTxWithNoShardSync(TransactionData&& tx_data, Context* cntx) {
-  if (cntx->IsCancelled()) {
-    return;
-  }
-
-  bool was_insert = false;
-  if (tx_data.IsGlobalCmd()) {
-    was_insert = InsertTxToSharedMap(tx_data);
-  }
-
-  ExecuteTx(std::move(tx_data), was_insert, cntx);
-}
-
 bool DflyShardReplica::InsertTxToSharedMap(const TransactionData& tx_data) {
   std::lock_guard lk{multi_shard_exe_->map_mu};
 
@@ -848,8 +894,11 @@ bool DflyShardReplica::InsertTxToSharedMap(const TransactionData& tx_data) {
 }
 
 void DflyShardReplica::InsertTxDataToShardResource(TransactionData&& tx_data) {
+  // Transactions that synchronize across flows are registered in the shared map
+  // already at read time, so sibling flows that reached the execution step are
+  // not blocked behind this flow's queue.
   bool was_insert = false;
-  if (tx_data.shard_cnt > 1) {
+  if (use_multi_shard_exe_sync_ ? tx_data.shard_cnt > 1 : tx_data.IsGlobalCmd()) {
     was_insert = InsertTxToSharedMap(tx_data);
   }
 
@@ -858,6 +907,7 @@ void DflyShardReplica::InsertTxDataToShardResource(TransactionData&& tx_data) {
 }
 
 void DflyShardReplica::StableSyncDflyExecFb(Context* cntx) {
+  ThisFiber::SetName(absl::StrCat("replica_stable_exec", flow_id_));
   while (!cntx->IsCancelled()) {
     waker_.await([&]() { return (!trans_data_queue_.empty() || cntx->IsCancelled()); });
     if (cntx->IsCancelled()) {
@@ -6,6 +6,7 @@
 #include <absl/container/inlined_vector.h>
 
 #include <boost/fiber/barrier.hpp>
+#include <optional>
 #include <queue>
 #include <variant>
 
@@ -164,6 +165,11 @@ class Replica : ProtocolClient {
   // Guard operations where flows might be in a mixed state (transition/setup)
   Mutex flows_op_mu_;
 
+  // The per-flow journal LSNs we applied before the last disconnect from a stable
+  // sync. Presented to the master on reconnect to attempt a partial sync instead of
+  // re-loading a full snapshot. Engaged only after reaching stable sync at least once.
+  std::optional<std::vector<LSN>> last_journal_lsns_;
+
   // repl_offs - till what offset we've already read from the master.
   // ack_offs_ last acknowledged offset.
   size_t repl_offs_ = 0, ack_offs_ = 0;
@@ -216,7 +222,10 @@ class DflyShardReplica : public ProtocolClient {
   void JoinFlow();
 
   // Start replica initialized as dfly flow.
-  std::error_code StartFullSyncFlow(BlockingCounter block, Context* cntx);
+  // A provided lsn is our last applied journal LSN: it asks the master for a partial
+  // sync from that point, which the master may grant (PARTIAL) or deny (FULL).
+  std::error_code StartFullSyncFlow(BlockingCounter block, Context* cntx,
+                                    std::optional<LSN> lsn);
 
   // Transition into stable state mode as dfly flow.
   std::error_code StartStableSyncFlow(Context* cntx);
@@ -225,21 +234,29 @@ class DflyShardReplica : public ProtocolClient {
   void FullSyncDflyFb(const std::string& eof_token, BlockingCounter block, Context* cntx);
 
   // Single flow stable state sync fiber spawned by StartStableSyncFlow.
+  // Reads and groups the journal stream and pushes transactions onto
+  // trans_data_queue_, so parsing overlaps with execution.
   void StableSyncDflyReadFb(Context* cntx);
 
   void StableSyncDflyAcksFb(Context* cntx);
 
+  // Applies transactions popped from trans_data_queue_.
   void StableSyncDflyExecFb(Context* cntx);
 
   void ExecuteTx(TransactionData&& tx_data, bool inserted_by_me, Context* cntx);
   void InsertTxDataToShardResource(TransactionData&& tx_data);
-  void ExecuteTxWithNoShardSync(TransactionData&& tx_data, Context* cntx);
   bool InsertTxToSharedMap(const TransactionData& tx_data);
 
   uint32_t FlowId() const;
 
   uint64_t JournalExecutedCount() const;
 
+  // Whether the master granted this flow a partial sync, i.e. it resumes the journal
+  // stream from our last LSN and there is no snapshot phase.
+  bool IsPartialSync() const {
+    return is_partial_sync_;
+  }
+
  private:
   Service& service_;
   MasterContext master_context_;
@@ -268,6 +285,7 @@ class DflyShardReplica : public ProtocolClient {
   size_t ack_offs_ = 0;
 
   bool force_ping_ = false;
+  bool is_partial_sync_ = false;
   Fiber execution_fb_;
 
   std::shared_ptr<MultiShardExecution> multi_shard_exe_;
@@ -236,8 +236,8 @@ io::Result<string, GenericError> ScriptMgr::Insert(string_view body, Interpreter
       body = *async_body;
   }
 
-  string result;
-  Interpreter::AddResult add_result = interpreter->AddFunction(sha, body, &result);
+  string result, bytecode;
+  Interpreter::AddResult add_result = interpreter->AddFunction(sha, body, &result, &bytecode);
   if (add_result == Interpreter::COMPILE_ERR)
     return nonstd::make_unexpected(GenericError{move(result)});
 
@@ -249,6 +249,8 @@ io::Result<string, GenericError> ScriptMgr::Insert(string_view body, Interpreter
     if (body != orig_body)
       it->second.orig_body = CharBufFromSV(orig_body);
   }
+  if (it->second.bytecode.empty())
+    it->second.bytecode = move(bytecode);
 
   UpdateScriptCaches(sha, it->second);
 
@@ -261,7 +263,7 @@ optional<ScriptMgr::ScriptData> ScriptMgr::Find(std::string_view sha) const {
 
   lock_guard lk{mu_};
   if (auto it = db_.find(sha); it != db_.end() && it->second.body)
-    return ScriptData{it->second, it->second.body.get(), {}};
+    return ScriptData{it->second, it->second.body.get(), {}, it->second.bytecode};
 
   return std::nullopt;
 }
@@ -274,7 +276,8 @@ vector<pair<string, ScriptMgr::ScriptData>> ScriptMgr::GetAll() const {
   for (const auto& [sha, data] : db_) {
     string body = data.body ? string{data.body.get()} : string{};
     string orig_body = data.orig_body ? string{data.orig_body.get()} : string{};
-    res.emplace_back(string{sha.data(), sha.size()}, ScriptData{data, move(body), move(orig_body)});
+    res.emplace_back(string{sha.data(), sha.size()},
+                     ScriptData{data, move(body), move(orig_body), data.bytecode});
   }
 
   return res;
@@ -303,6 +306,11 @@ GenericError ScriptMgr::ScriptParams::ApplyFlags(string_view config, ScriptParam
       continue;
     }
 
+    if (flag == "single-shard") {
+      params->single_shard = true;
+      continue;
+    }
+
     if (flag == "no-writes") {  // Used by Redis.
       // TODO: lock read-only.
       continue;
@@ -22,17 +22,20 @@ class ScriptMgr {
   struct ScriptParams {
     bool atomic = true;            // Whether script must run atomically.
     bool undeclared_keys = false;  // Whether script accesses undeclared keys.
+    bool single_shard = false;     // Whether all declared keys map to a single shard.
 
     // Return GenericError if some flag was invalid.
     // Valid flags are:
     // - allow-undeclared-keys -> undeclared_keys=true
     // - disable-atomicity     -> atomic=false
+    // - single-shard          -> single_shard=true
     static GenericError ApplyFlags(std::string_view flags, ScriptParams* params);
   };
 
   struct ScriptData : public ScriptParams {
     std::string body;       // script source code present in lua interpreter
     std::string orig_body;  // original code, before removing header and adding async
+    std::string bytecode;   // compiled chunk, loadable without parsing the source
   };
 
   struct ScriptKey : public std::array<char, 40> {
@@ -70,6 +73,7 @@ class ScriptMgr {
   struct InternalScriptData : public ScriptParams {
     std::unique_ptr<char[]> body{};
     std::unique_ptr<char[]> orig_body{};
+    std::string bytecode{};  // may contain NUL bytes, so not a char buffer
   };
 
   ScriptParams default_params_;
@@ -4,6 +4,8 @@
 
 #include "server/search/doc_index.h"
 
+#include <absl/strings/numbers.h>
+
 #include <memory>
 
 #include "base/logging.h"
@@ -20,31 +22,9 @@ using namespace std;
 
 namespace {
 
-template <typename F>
-void TraverseAllMatching(const DocIndex& index, const OpArgs& op_args, F&& f) {
-  auto& db_slice = op_args.shard->db_slice();
-  DCHECK(db_slice.IsDbValid(op_args.db_cntx.db_index));
-  auto [prime_table, _] = db_slice.GetTables(op_args.db_cntx.db_index);
-
-  string scratch;
-  auto cb = [&](PrimeTable::iterator it) {
-    const PrimeValue& pv = it->second;
-    if (pv.ObjType() != index.GetObjCode())
-      return;
-
-    string_view key = it->first.GetSlice(&scratch);
-    if (key.rfind(index.prefix, 0) != 0)
-      return;
-
-    auto accessor = GetAccessor(op_args.db_cntx, pv);
-    f(key, accessor.get());
-  };
-
-  PrimeTable::Cursor cursor;
-  do {
-    cursor = prime_table->Traverse(cursor, cb);
-  } while (cursor);
-}
+// Traversal segments to index per build step. Keeps a single step short enough not to
+// stall the shard fiber, yet covers small tables in one call.
+constexpr unsigned kMaxBuildTraverses = 256;
 
 }  // namespace
 
@@ -97,6 +77,10 @@ string_view ShardDocIndex::DocKeyIndex::Get(DocId id) const {
   return keys_[id];
 }
 
+bool ShardDocIndex::DocKeyIndex::Contains(string_view key) const {
+  return ids_.count(key) > 0;
+}
+
 uint8_t DocIndex::GetObjCode() const {
   return type == JSON ? OBJ_JSON : OBJ_HASH;
 }
@@ -109,9 +93,48 @@ ShardDocIndex::ShardDocIndex(shared_ptr<DocIndex> index)
     : base_{index}, indices_{index->schema}, key_index_{} {
 }
 
-void ShardDocIndex::Init(const OpArgs& op_args) {
-  auto cb = [this](string_view key, BaseAccessor* doc) { indices_.Add(key_index_.Add(key), doc); };
-  TraverseAllMatching(*base_, op_args, cb);
+void ShardDocIndex::StartBuild(const OpArgs& op_args) {
+  db_index_ = op_args.db_cntx.db_index;
+  BuildStep(op_args);
+}
+
+bool ShardDocIndex::BuildStep(const OpArgs& op_args) {
+  DCHECK(!built_);
+
+  auto& db_slice = op_args.shard->db_slice();
+  if (!db_slice.IsDbValid(op_args.db_cntx.db_index)) {  // never activated - nothing to index.
+    built_ = true;
+    return true;
+  }
+  auto [prime_table, _] = db_slice.GetTables(op_args.db_cntx.db_index);
+
+  string scratch;
+  auto cb = [&](PrimeTable::iterator it) {
+    const PrimeValue& pv = it->second;
+    if (pv.ObjType() != base_->GetObjCode())
+      return;
+
+    string_view key = it->first.GetSlice(&scratch);
+    if (key.rfind(base_->prefix, 0) != 0)
+      return;
+
+    // Concurrent writes reach the index through the document change hooks before the
+    // traversal does, so the key may be indexed already.
+    if (key_index_.Contains(key))
+      return;
+
+    auto accessor = GetAccessor(op_args.db_cntx, pv);
+    indices_.Add(key_index_.Add(key), accessor.get());
+  };
+
+  for (unsigned i = 0; i < kMaxBuildTraverses; i++) {
+    build_cursor_ = prime_table->Traverse(build_cursor_, cb);
+    if (!build_cursor_) {
+      built_ = true;
+      break;
+    }
+  }
+  return built_;
 }
 
 void ShardDocIndex::AddDoc(string_view key, const DbContext& db_cntx, const PrimeValue& pv) {
@@ -120,6 +143,10 @@ void ShardDocIndex::AddDoc(string_view key, const DbContext& db_cntx, const Prim
 }
 
 void ShardDocIndex::RemoveDoc(string_view key, const DbContext& db_cntx, const PrimeValue& pv) {
+  // An ongoing build may not have reached this document yet.
+  if (!built_ && !key_index_.Contains(key))
+    return;
+
   auto accessor = GetAccessor(db_cntx, pv);
   DocId id = key_index_.Remove(key);
   indices_.Remove(id, accessor.get());
@@ -148,7 +175,69 @@ SearchResult ShardDocIndex::Search(const OpArgs& op_args, const SearchParams& pa
     out[i] = SerializedSearchDoc{string{key}, std::move(doc_data), score};
   }
 
-  return SearchResult{std::move(out), search_results.ids.size()};
+  return SearchResult{std::move(out), search_results.ids.size(), built_};
+}
+
+AggregateResult ShardDocIndex::Aggregate(const OpArgs& op_args, const AggregateParams& params,
+                                         search::SearchAlgorithm* search_algo) const {
+  auto& db_slice = op_args.shard->db_slice();
+  auto search_results = search_algo->Search(&indices_);
+
+  AggregateResult out;
+  string group_key;
+  for (auto id : search_results.ids) {
+    auto key = key_index_.Get(id);
+    auto it = db_slice.Find(op_args.db_cntx, key, base_->GetObjCode());
+    CHECK(it) << "Expected key: " << key << " to exist";
+
+    SearchDocData doc = GetAccessor(op_args.db_cntx, (*it)->second)->Serialize(base_->schema);
+
+    group_key.clear();
+    for (const auto& field : params.group_fields) {
+      if (auto fit = doc.find(field); fit != doc.end())
+        group_key += fit->second;
+      group_key += '\0';
+    }
+
+    auto& partials = out[group_key];
+    partials.resize(params.reducers.size());
+    for (size_t i = 0; i < params.reducers.size(); i++) {
+      const auto& reducer = params.reducers[i];
+      auto& partial = partials[i];
+
+      if (reducer.func == AggregateParams::Reducer::COUNT) {
+        partial.count++;
+        continue;
+      }
+
+      auto fit = doc.find(reducer.field);
+      double val;
+      if (fit == doc.end() || !absl::SimpleAtod(fit->second, &val))
+        continue;  // missing and non-numeric values do not contribute.
+
+      switch (reducer.func) {
+        case AggregateParams::Reducer::SUM:
+        case AggregateParams::Reducer::AVG:
+          partial.value += val;
+          break;
+        case AggregateParams::Reducer::MIN:
+          partial.value = partial.count ? min(partial.value, val) : val;
+          break;
+        case AggregateParams::Reducer::MAX:
+          partial.value = partial.count ? max(partial.value, val) : val;
+          break;
+        default:
+          break;
+      }
+      partial.count++;
+    }
+  }
+
+  return out;
+}
+
+string ShardDocIndex::Explain(search::SearchAlgorithm* search_algo) const {
+  return search_algo->ExplainQuery(&indices_);
 }
 
 ShardDocIndex* ShardDocIndices::GetIndex(string_view name) {
@@ -160,7 +249,10 @@ void ShardDocIndices::InitIndex(const OpArgs& op_args, std::string_view name,
                                 shared_ptr<DocIndex> index_ptr) {
   auto shard_index = make_unique<ShardDocIndex>(index_ptr);
   auto [it, _] = indices_.emplace(name, move(shard_index));
-  it->second->Init(op_args);
+
+  // Small tables are fully indexed by the first step, larger ones continue from the
+  // heartbeat while the index serves queries on the partial state.
+  it->second->StartBuild(op_args);
 
   op_args.shard->db_slice().SetDocDeletionCallback(
       [this](string_view key, const DbContext& cntx, const PrimeValue& pv) {
@@ -182,4 +274,14 @@ void ShardDocIndices::RemoveDoc(string_view key, const DbContext& db_cntx, const
   }
 }
 
+void ShardDocIndices::RunBuildSteps(EngineShard* shard, uint64_t now_ms) {
+  for (auto& [_, index] : indices_) {
+    if (index->IsBuilt())
+      continue;
+
+    DbContext db_cntx{index->db_index(), now_ms};
+    index->BuildStep(OpArgs{shard, nullptr, db_cntx});
+  }
+}
+
 }  // namespace dfly
@@ -5,6 +5,7 @@
 #pragma once
 
 #include <absl/container/flat_hash_map.h>
+#include <absl/container/inlined_vector.h>
 
 #include <memory>
 #include <string>
@@ -30,6 +31,10 @@ struct SerializedSearchDoc {
 struct SearchResult {
   std::vector<SerializedSearchDoc> docs;
   size_t total_hits;
+
+  // False if the index was still being built when the search ran, so the
+  // result may be incomplete.
+  bool index_complete = true;
 };
 
 struct SearchParams {
@@ -41,6 +46,32 @@ struct SearchParams {
   search::FtVector knn_vector;
 };
 
+// A GROUPBY/REDUCE pipeline of FT.AGGREGATE. Reduction runs shard-locally over the
+// matched documents; only the per-group partials travel to the coordinator.
+struct AggregateParams {
+  struct Reducer {
+    enum Func { COUNT, SUM, MIN, MAX, AVG };
+
+    Func func;
+    std::string field;     // source field, empty for COUNT.
+    std::string out_name;  // name of the result property in the reply.
+  };
+
+  std::vector<std::string> group_fields;
+  std::vector<Reducer> reducers;
+};
+
+// Partial aggregate of one reducer over one group: an accumulated value and the number
+// of values folded into it. Enough to merge any of the supported reduce functions.
+struct ReducerPartial {
+  double value = 0;
+  uint64_t count = 0;
+};
+
+// Group key (the group field values joined with '\0') -> one partial per reducer.
+using AggregateResult =
+    absl::flat_hash_map<std::string, absl::InlinedVector<ReducerPartial, 4>>;
+
 // Stores basic info about a document index.
 struct DocIndex {
   enum DataType { HASH, JSON };
@@ -65,6 +96,7 @@ class ShardDocIndex {
     DocId Add(std::string_view key);
     DocId Remove(std::string_view key);
     std::string_view Get(DocId id) const;
+    bool Contains(std::string_view key) const;
 
    private:
     absl::flat_hash_map<std::string, DocId> ids_;
@@ -80,8 +112,29 @@ class ShardDocIndex {
   SearchResult Search(const OpArgs& op_args, const SearchParams& params,
                       search::SearchAlgorithm* search_algo) const;
 
-  // Initialize index. Traverses all matching documents and assigns ids.
-  void Init(const OpArgs& op_args);
+  // Group and reduce all matched documents of this shard, returning the partial
+  // aggregates for the coordinator to merge.
+  AggregateResult Aggregate(const OpArgs& op_args, const AggregateParams& params,
+                            search::SearchAlgorithm* search_algo) const;
+
+  // Render the query plan for this shard's indices.
+  std::string Explain(search::SearchAlgorithm* search_algo) const;
+
+  // Begin building the index over the caller's database and run the first build step.
+  void StartBuild(const OpArgs& op_args);
+
+  // Index the next batch of matching documents: traverses a bounded number of prime table
+  // buckets from the stored cursor, so large tables are covered incrementally without
+  // freezing the shard. Returns true once the traversal has completed.
+  bool BuildStep(const OpArgs& op_args);
+
+  bool IsBuilt() const {
+    return built_;
+  }
+
+  DbIndex db_index() const {
+    return db_index_;
+  }
 
   // Return whether base index matches
   bool Matches(std::string_view key, unsigned obj_code) const;
@@ -93,6 +146,10 @@ class ShardDocIndex {
   std::shared_ptr<const DocIndex> base_;
   search::FieldIndices indices_;
   DocKeyIndex key_index_;
+
+  DbIndex db_index_ = 0;
+  PrimeTable::Cursor build_cursor_;
+  bool built_ = false;
 };
 
 // Stores shard doc indices by name on a specific shard.
@@ -106,6 +163,9 @@ class ShardDocIndices {
   void AddDoc(std::string_view key, const DbContext& db_cnt, const PrimeValue& pv);
   void RemoveDoc(std::string_view key, const DbContext& db_cnt, const PrimeValue& pv);
 
+  // Continue unfinished index builds, called from the shard heartbeat.
+  void RunBuildSteps(EngineShard* shard, uint64_t now_ms);
+
  private:
   absl::flat_hash_map<std::string, std::unique_ptr<ShardDocIndex>> indices_;
 };
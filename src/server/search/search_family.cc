@@ -5,6 +5,9 @@
 #include "server/search/search_family.h"
 
 #include <absl/strings/ascii.h>
+#include <absl/strings/match.h>
+#include <absl/strings/str_cat.h>
+#include <absl/strings/strip.h>
 
 #include <atomic>
 #include <jsoncons/json.hpp>
@@ -56,16 +59,32 @@ optional<search::Schema> ParseSchemaOrReply(CmdArgList args, ConnectionContext*
       return nullopt;
     }
 
-    // Skip {algorithm} {dim} flags
-    if (it->second == search::Schema::VECTOR)
+    auto type = it->second;
+
+    // The algorithm argument selects the index backing the vector field,
+    // the {dim} flag is skipped.
+    if (type == search::Schema::VECTOR) {
+      if (i + 1 < args.size()) {
+        ToUpper(&args[i + 1]);
+        if (ArgS(args, i + 1) == "HNSW")
+          type = search::Schema::VECTOR_HNSW;
+      }
       i += 2;
+    }
+
+    // An optional TRIGRAM argument enables infix search for the text field.
+    if (type == search::Schema::TEXT && i + 1 < args.size() &&
+        absl::EqualsIgnoreCase(ArgS(args, i + 1), "TRIGRAM")) {
+      type = search::Schema::TEXT_TRIGRAM;
+      i++;
+    }
 
     // Skip all trailing ignored parameters
     while (i + 2 < args.size() && kIgnoredOptions.count(ArgS(args, i + 1)) > 0) {
       i += 2;
     }
 
-    schema.fields[field] = it->second;
+    schema.fields[field] = type;
   }
 
   return schema;
@@ -108,6 +127,158 @@ optional<SearchParams> ParseSearchParamsOrReply(CmdArgList args, ConnectionConte
   return SearchParams{limit_offset, limit_total, move(knn_vector)};
 }
 
+optional<AggregateParams::Reducer::Func> ParseReducerFunc(string_view name) {
+  using Reducer = AggregateParams::Reducer;
+  static const unordered_map<string_view, Reducer::Func> kFuncs = {{"COUNT"sv, Reducer::COUNT},
+                                                                   {"SUM"sv, Reducer::SUM},
+                                                                   {"MIN"sv, Reducer::MIN},
+                                                                   {"MAX"sv, Reducer::MAX},
+                                                                   {"AVG"sv, Reducer::AVG}};
+  auto it = kFuncs.find(name);
+  return it != kFuncs.end() ? optional{it->second} : nullopt;
+}
+
+optional<AggregateParams> ParseAggregateParamsOrReply(CmdArgList args, ConnectionContext* cntx) {
+  AggregateParams params;
+
+  size_t i = 0;
+  while (i < args.size()) {
+    ToUpper(&args[i]);
+    string_view tok = ArgS(args, i);
+
+    // [GROUPBY count field [field ...]]
+    if (tok == "GROUPBY") {
+      uint32_t num_fields;
+      if (i + 1 >= args.size() || !absl::SimpleAtoi(ArgS(args, i + 1), &num_fields) ||
+          i + 2 + num_fields > args.size()) {
+        (*cntx)->SendError(kSyntaxErr);
+        return nullopt;
+      }
+      for (uint32_t j = 0; j < num_fields; j++) {
+        string_view field = ArgS(args, i + 2 + j);
+        absl::ConsumePrefix(&field, "@");
+        params.group_fields.emplace_back(field);
+      }
+      i += 2 + num_fields;
+      continue;
+    }
+
+    // [REDUCE func nargs [field] [AS name]]
+    if (tok == "REDUCE") {
+      if (i + 2 >= args.size()) {
+        (*cntx)->SendError(kSyntaxErr);
+        return nullopt;
+      }
+
+      ToUpper(&args[i + 1]);
+      string_view func_name = ArgS(args, i + 1);
+      auto func = ParseReducerFunc(func_name);
+      if (!func) {
+        (*cntx)->SendError("Unsupported reducer: " + string{func_name});
+        return nullopt;
+      }
+
+      AggregateParams::Reducer reducer;
+      reducer.func = *func;
+
+      // COUNT takes no arguments, the remaining functions take the source field.
+      uint32_t num_args;
+      uint32_t expected_args = reducer.func == AggregateParams::Reducer::COUNT ? 0 : 1;
+      if (!absl::SimpleAtoi(ArgS(args, i + 2), &num_args) || num_args != expected_args ||
+          i + 3 + num_args > args.size()) {
+        (*cntx)->SendError(kSyntaxErr);
+        return nullopt;
+      }
+      i += 3;
+
+      if (num_args > 0) {
+        string_view field = ArgS(args, i++);
+        absl::ConsumePrefix(&field, "@");
+        reducer.field = field;
+      }
+
+      if (i + 1 < args.size() && absl::EqualsIgnoreCase(ArgS(args, i), "AS")) {
+        reducer.out_name = ArgS(args, i + 1);
+        i += 2;
+      } else if (reducer.field.empty()) {
+        reducer.out_name = absl::AsciiStrToLower(func_name);
+      } else {
+        reducer.out_name = absl::StrCat(absl::AsciiStrToLower(func_name), "(", reducer.field, ")");
+      }
+
+      params.reducers.push_back(std::move(reducer));
+      continue;
+    }
+
+    (*cntx)->SendError(kSyntaxErr);
+    return nullopt;
+  }
+
+  if (params.group_fields.empty() && params.reducers.empty()) {
+    (*cntx)->SendError(kSyntaxErr);
+    return nullopt;
+  }
+
+  return params;
+}
+
+// Folds a shard partial of one reducer into the coordinator total of its group.
+void MergePartial(AggregateParams::Reducer::Func func, const ReducerPartial& src,
+                  ReducerPartial* dst) {
+  using Reducer = AggregateParams::Reducer;
+  switch (func) {
+    case Reducer::COUNT:
+    case Reducer::SUM:
+    case Reducer::AVG:
+      dst->value += src.value;
+      break;
+    case Reducer::MIN:
+      if (src.count > 0)
+        dst->value = dst->count > 0 ? min(dst->value, src.value) : src.value;
+      break;
+    case Reducer::MAX:
+      if (src.count > 0)
+        dst->value = dst->count > 0 ? max(dst->value, src.value) : src.value;
+      break;
+  }
+  dst->count += src.count;
+}
+
+void ReplyAggregateResults(const AggregateParams& params, const AggregateResult& merged,
+                           ConnectionContext* cntx) {
+  facade::SinkReplyBuilder::ReplyAggregator agg{cntx->reply_builder()};
+
+  (*cntx)->StartArray(merged.size() + 1);
+  (*cntx)->SendLong(merged.size());
+
+  for (const auto& [key, partials] : merged) {
+    (*cntx)->StartCollection(params.group_fields.size() + params.reducers.size(),
+                             RedisReplyBuilder::MAP);
+
+    // The group key is the field values joined with '\0', in group_fields order.
+    size_t offset = 0;
+    for (const auto& field : params.group_fields) {
+      size_t end = key.find('\0', offset);
+      (*cntx)->SendBulkString(field);
+      (*cntx)->SendBulkString(string_view{key}.substr(offset, end - offset));
+      offset = end + 1;
+    }
+
+    for (size_t i = 0; i < params.reducers.size(); i++) {
+      const auto& reducer = params.reducers[i];
+      const auto& partial = partials[i];
+
+      (*cntx)->SendBulkString(reducer.out_name);
+      if (reducer.func == AggregateParams::Reducer::COUNT)
+        (*cntx)->SendBulkString(absl::StrCat(partial.count));
+      else if (reducer.func == AggregateParams::Reducer::AVG)
+        (*cntx)->SendBulkString(absl::StrCat(partial.count ? partial.value / partial.count : 0));
+      else
+        (*cntx)->SendBulkString(absl::StrCat(partial.value));
+    }
+  }
+}
+
 void SendSerializedDoc(const SerializedSearchDoc& doc, ConnectionContext* cntx) {
   (*cntx)->SendBulkString(doc.key);
   (*cntx)->StartCollection(doc.values.size(), RedisReplyBuilder::MAP);
@@ -260,19 +431,98 @@ void SearchFamily::FtSearch(CmdArgList args, ConnectionContext* cntx) {
   if (index_not_found.load())
     return (*cntx)->SendError(string{index_name} + ": no such index");
 
+  // The reply format has no slot for a completeness marker, so an ongoing background
+  // build is only logged. Partial results are still served.
+  for (const auto& res : docs) {
+    if (!res.index_complete) {
+      VLOG(1) << "Serving partial results: index " << index_name << " is still being built";
+      break;
+    }
+  }
+
   if (auto knn_limit = search_algo.HasKnn(); knn_limit)
     ReplyKnn(*knn_limit, *params, absl::MakeSpan(docs), cntx);
   else
     ReplyWithResults(*params, absl::MakeSpan(docs), cntx);
 }
 
+void SearchFamily::FtAggregate(CmdArgList args, ConnectionContext* cntx) {
+  string_view index_name = ArgS(args, 0);
+  string_view query_str = ArgS(args, 1);
+
+  auto params = ParseAggregateParamsOrReply(args.subspan(2), cntx);
+  if (!params.has_value())
+    return;
+
+  search::SearchAlgorithm search_algo;
+  if (!search_algo.Init(query_str, {}))
+    return (*cntx)->SendError("Query syntax error");
+
+  atomic<bool> index_not_found{false};
+  vector<AggregateResult> partials(shard_set->size());
+
+  cntx->transaction->ScheduleSingleHop([&](Transaction* t, EngineShard* es) {
+    if (auto* index = es->search_indices()->GetIndex(index_name); index)
+      partials[es->shard_id()] = index->Aggregate(t->GetOpArgs(es), *params, &search_algo);
+    else
+      index_not_found.store(true, memory_order_relaxed);
+    return OpStatus::OK;
+  });
+
+  if (index_not_found.load())
+    return (*cntx)->SendError(string{index_name} + ": no such index");
+
+  // Merge the shard partials group by group. The first shard seen contributes its
+  // partials wholesale, the rest are folded in per reducer.
+  AggregateResult merged;
+  for (auto& shard_result : partials) {
+    for (auto& [key, shard_partials] : shard_result) {
+      auto [it, inserted] = merged.try_emplace(key, std::move(shard_partials));
+      if (inserted)
+        continue;
+      for (size_t i = 0; i < params->reducers.size(); i++)
+        MergePartial(params->reducers[i].func, shard_partials[i], &it->second[i]);
+    }
+  }
+
+  ReplyAggregateResults(*params, merged, cntx);
+}
+
+void SearchFamily::FtExplain(CmdArgList args, ConnectionContext* cntx) {
+  string_view index_name = ArgS(args, 0);
+  string_view query_str = ArgS(args, 1);
+
+  search::SearchAlgorithm search_algo;
+  if (!search_algo.Init(query_str, {}))
+    return (*cntx)->SendError("Query syntax error");
+
+  atomic<bool> index_not_found{false};
+  vector<string> plans(shard_set->size());
+
+  cntx->transaction->ScheduleSingleHop([&](Transaction* t, EngineShard* es) {
+    if (auto* index = es->search_indices()->GetIndex(index_name); index)
+      plans[es->shard_id()] = index->Explain(&search_algo);
+    else
+      index_not_found.store(true, memory_order_relaxed);
+    return OpStatus::OK;
+  });
+
+  if (index_not_found.load())
+    return (*cntx)->SendError(string{index_name} + ": no such index");
+
+  // Shards differ only in the scale of their estimates, so one plan is representative.
+  (*cntx)->SendBulkString(plans.front());
+}
+
 #define HFUNC(x) SetHandler(&SearchFamily::x)
 
 void SearchFamily::Register(CommandRegistry* registry) {
   using CI = CommandId;
 
   *registry << CI{"FT.CREATE", CO::GLOBAL_TRANS, -2, 0, 0, 0}.HFUNC(FtCreate)
-            << CI{"FT.SEARCH", CO::GLOBAL_TRANS, -3, 0, 0, 0}.HFUNC(FtSearch);
+            << CI{"FT.SEARCH", CO::GLOBAL_TRANS, -3, 0, 0, 0}.HFUNC(FtSearch)
+            << CI{"FT.AGGREGATE", CO::GLOBAL_TRANS, -5, 0, 0, 0}.HFUNC(FtAggregate)
+            << CI{"FT.EXPLAIN", CO::GLOBAL_TRANS, 3, 0, 0, 0}.HFUNC(FtExplain);
 }
 
 }  // namespace dfly
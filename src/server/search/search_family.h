@@ -18,6 +18,8 @@ class ConnectionContext;
 class SearchFamily {
   static void FtCreate(CmdArgList args, ConnectionContext* cntx);
   static void FtSearch(CmdArgList args, ConnectionContext* cntx);
+  static void FtAggregate(CmdArgList args, ConnectionContext* cntx);
+  static void FtExplain(CmdArgList args, ConnectionContext* cntx);
 
  public:
   static void Register(CommandRegistry* registry);
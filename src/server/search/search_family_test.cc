@@ -208,6 +208,52 @@ TEST_F(SearchFamilyTest, TestLimit) {
   EXPECT_THAT(resp, ArrLen(3 * 2 + 1));
 }
 
+TEST_F(SearchFamilyTest, Aggregate) {
+  for (unsigned i = 0; i < 10; i++) {
+    Run({"hset", absl::StrCat("p:", i), "word", i % 2 ? "odd" : "even", "value", absl::StrCat(i)});
+  }
+  EXPECT_EQ(
+      Run({"ft.create", "i1", "PREFIX", "1", "p:", "SCHEMA", "word", "TAG", "value", "NUMERIC"}),
+      "OK");
+
+  auto resp = Run({"ft.aggregate", "i1", "*", "GROUPBY", "1", "@word", "REDUCE", "COUNT", "0",
+                   "AS", "cnt", "REDUCE", "SUM", "1", "@value", "AS", "total"});
+  ASSERT_THAT(resp, ArrLen(3));
+  EXPECT_THAT(resp.GetVec()[0], IntArg(2));
+
+  // The groups arrive in hash order, so identify each row by its group value.
+  for (size_t i = 1; i <= 2; i++) {
+    auto row = resp.GetVec()[i].GetVec();
+    ASSERT_EQ(6u, row.size());
+    EXPECT_EQ("word", row[0].GetString());
+    EXPECT_EQ("cnt", row[2].GetString());
+    EXPECT_EQ("total", row[4].GetString());
+
+    EXPECT_EQ("5", row[3].GetString());
+    if (row[1].GetString() == "even") {
+      EXPECT_EQ("20", row[5].GetString());
+    } else {
+      EXPECT_EQ("odd", row[1].GetString());
+      EXPECT_EQ("25", row[5].GetString());
+    }
+  }
+
+  // GROUPBY 0 reduces all matched documents into a single row.
+  resp = Run({"ft.aggregate", "i1", "@value:[5 9]", "GROUPBY", "0", "REDUCE", "AVG", "1",
+              "@value", "REDUCE", "MAX", "1", "@value"});
+  ASSERT_THAT(resp, ArrLen(2));
+  auto row = resp.GetVec()[1].GetVec();
+  ASSERT_EQ(4u, row.size());
+  EXPECT_EQ("avg(value)", row[0].GetString());
+  EXPECT_EQ("7", row[1].GetString());
+  EXPECT_EQ("max(value)", row[2].GetString());
+  EXPECT_EQ("9", row[3].GetString());
+
+  EXPECT_THAT(Run({"ft.aggregate", "i1", "*", "REDUCE", "FIRST_VALUE", "1", "@word"}),
+              ErrArg("Unsupported reducer"));
+  EXPECT_THAT(Run({"ft.aggregate", "i1", "*", "SORTBY", "1", "@word"}), ErrArg("syntax error"));
+}
+
 TEST_F(SearchFamilyTest, SimpleUpdates) {
   EXPECT_EQ(Run({"ft.create", "i1", "schema", "title", "text", "visits", "numeric"}), "OK");
 
@@ -0,0 +1,102 @@
+// Copyright 2023, DragonflyDB authors.  All rights reserved.
+// See LICENSE for licensing terms.
+//
+
+#include <absl/strings/str_cat.h>
+
+#include "base/gtest.h"
+#include "server/test_utils.h"
+
+// In-process benchmarks for the command hot path: parsing, transaction scheduling and reply
+// building, without networking. Run with --benchmark_filter=all (see base/gtest.h).
+//
+// The fixtures reuse the BaseFamilyTest machinery, so commands flow through
+// Service::DispatchCommand exactly like in the unit tests.
+
+namespace dfly {
+
+using namespace std;
+
+namespace {
+
+// Exposes the protected BaseFamilyTest interface for use outside of TEST_F bodies.
+class ServerBench : public BaseFamilyTest {
+ public:
+  ServerBench() {
+    SetUpTestSuite();
+    SetUp();
+  }
+
+  ~ServerBench() {
+    TearDown();
+  }
+
+  using BaseFamilyTest::Run;
+};
+
+void BM_Set(benchmark::State& state) {
+  ServerBench bench;
+
+  while (state.KeepRunning()) {
+    bench.Run({"set", "key", "value"});
+  }
+}
+BENCHMARK(BM_Set);
+
+void BM_Get(benchmark::State& state) {
+  ServerBench bench;
+  bench.Run({"set", "key", "value"});
+
+  while (state.KeepRunning()) {
+    bench.Run({"get", "key"});
+  }
+}
+BENCHMARK(BM_Get);
+
+void BM_MGet(benchmark::State& state) {
+  ServerBench bench;
+
+  vector<string> keys;
+  for (int64_t i = 0; i < state.range(0); ++i) {
+    keys.push_back(absl::StrCat("key", i));
+    bench.Run({"set", keys.back(), "value"});
+  }
+
+  vector<string> cmd = {"mget"};
+  cmd.insert(cmd.end(), keys.begin(), keys.end());
+
+  while (state.KeepRunning()) {
+    bench.Run(absl::MakeSpan(cmd));
+  }
+}
+BENCHMARK(BM_MGet)->Arg(10)->Arg(100);
+
+void BM_ZAdd(benchmark::State& state) {
+  ServerBench bench;
+
+  uint64_t score = 0;
+  while (state.KeepRunning()) {
+    bench.Run({"zadd", "zkey", absl::StrCat(score++), "member"});
+  }
+}
+BENCHMARK(BM_ZAdd);
+
+// Approximates a pipeline by running a MULTI/EXEC batch of sets, which exercises the
+// squashed execution path.
+void BM_MultiExec(benchmark::State& state) {
+  ServerBench bench;
+
+  while (state.KeepRunning()) {
+    bench.Run({"multi"});
+    for (int64_t i = 0; i < state.range(0); ++i) {
+      bench.Run({"set", absl::StrCat("key", i), "value"});
+    }
+    bench.Run({"exec"});
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_MultiExec)->Arg(10)->Arg(100);
+
+}  // namespace
+
+}  // namespace dfly
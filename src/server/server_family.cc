@@ -6,19 +6,23 @@
 
 #include <absl/cleanup/cleanup.h>
 #include <absl/random/random.h>  // for master_id_ generation.
+#include <absl/strings/ascii.h>
 #include <absl/strings/match.h>
 #include <absl/strings/str_join.h>
 #include <absl/strings/str_replace.h>
 #include <absl/strings/strip.h>
+#include <liburing.h>
 #include <sys/resource.h>
 
 #include <algorithm>
 #include <chrono>
+#include <deque>
 #include <filesystem>
 #include <optional>
 
 extern "C" {
 #include "redis/redis_aux.h"
+#include "redis/zmalloc.h"
 }
 
 #include "base/flags.h"
@@ -26,6 +30,7 @@ extern "C" {
 #include "facade/dragonfly_connection.h"
 #include "io/file_util.h"
 #include "io/proc_reader.h"
+#include "server/columnar_export.h"
 #include "server/command_registry.h"
 #include "server/conn_context.h"
 #include "server/debugcmd.h"
@@ -33,7 +38,11 @@ extern "C" {
 #include "server/engine_shard_set.h"
 #include "server/error.h"
 #include "server/generic_family.h"
+#include "server/io_utils.h"
+#include "server/journal/executor.h"
 #include "server/journal/journal.h"
+#include "server/journal/serializer.h"
+#include "server/keyspace_events.h"
 #include "server/main_service.h"
 #include "server/memory_cmd.h"
 #include "server/rdb_load.h"
@@ -59,15 +68,30 @@ ABSL_FLAG(string, requirepass, "",
           "If empty can also be set with DFLY_PASSWORD environment variable.");
 ABSL_FLAG(string, save_schedule, "",
           "glob spec for the UTC time to save a snapshot which matches HH:MM 24h time");
+ABSL_FLAG(uint32_t, cloud_upload_inflight_mb, 32,
+          "Upper bound on snapshot bytes buffered in memory while uploading to cloud "
+          "storage. Larger values keep the upload busy when parts are slow to land, "
+          "at the cost of memory.");
 ABSL_FLAG(bool, df_snapshot_format, true,
           "if true, save in dragonfly-specific snapshotting format");
+ABSL_FLAG(string, journal_dir, "",
+          "directory to persist journal segment files to. Empty disables journal persistence");
+ABSL_FLAG(bool, journal_replay, false,
+          "if true, journal segments found in journal_dir are replayed on startup after "
+          "the snapshot has been loaded");
 ABSL_FLAG(int, epoll_file_threads, 0,
           "thread size for file workers when running in epoll mode, default is hardware concurrent "
           "threads");
+ABSL_FLAG(uint32_t, metrics_cache_time_ms, 0,
+          "if positive, INFO and the metrics endpoint serve an aggregated stats snapshot that is "
+          "at most this many milliseconds old instead of polling every thread on each call. "
+          "0 disables caching");
 
 ABSL_DECLARE_FLAG(uint32_t, port);
 ABSL_DECLARE_FLAG(bool, cache_mode);
 ABSL_DECLARE_FLAG(uint32_t, hz);
+ABSL_DECLARE_FLAG(bool, use_large_pages);
+ABSL_DECLARE_FLAG(uint32_t, proactor_idle_governor_qps);
 
 namespace dfly {
 
@@ -250,6 +274,94 @@ class LinuxWriteWrapper : public io::Sink {
   off_t offset_ = 0;
 };
 
+// Decouples snapshot serialization from cloud uploads. WriteSome only copies into an
+// in-memory part buffer; full parts are handed to a background fiber that streams them
+// into the wrapped S3 write file, where each flush becomes one part of the multipart
+// upload. The producer blocks only once --cloud_upload_inflight_mb worth of parts wait
+// in the queue, so serialization overlaps upload latency instead of stalling on every
+// part, and memory stays bounded when the network is the bottleneck.
+class AsyncCloudSink : public io::Sink {
+ public:
+  // Takes ownership over the upstream file.
+  AsyncCloudSink(io::WriteFile* upstream, size_t part_size, size_t max_inflight_bytes)
+      : upstream_(upstream), part_size_(part_size), max_inflight_bytes_(max_inflight_bytes) {
+    upload_fb_ = MakeFiber([this] { UploadFb(); });
+  }
+
+  io::Result<size_t> WriteSome(const iovec* v, uint32_t len) final;
+
+  error_code Close();
+
+ private:
+  void UploadFb();
+
+  unique_ptr<io::WriteFile> upstream_;
+  size_t part_size_, max_inflight_bytes_;
+
+  string cur_part_;
+  deque<string> pending_;
+  size_t pending_bytes_ = 0;
+  bool producer_done_ = false;
+  error_code upload_ec_;
+  EventCount waker_;
+  Fiber upload_fb_;
+};
+
+io::Result<size_t> AsyncCloudSink::WriteSome(const iovec* v, uint32_t len) {
+  if (upload_ec_)
+    return nonstd::make_unexpected(upload_ec_);
+
+  size_t written = 0;
+  for (uint32_t i = 0; i < len; ++i) {
+    cur_part_.append(reinterpret_cast<const char*>(v[i].iov_base), v[i].iov_len);
+    written += v[i].iov_len;
+  }
+
+  if (cur_part_.size() >= part_size_) {
+    waker_.await([this] { return pending_bytes_ < max_inflight_bytes_ || upload_ec_; });
+    pending_bytes_ += cur_part_.size();
+    pending_.push_back(std::move(cur_part_));
+    cur_part_.clear();
+    waker_.notify();
+  }
+
+  return written;
+}
+
+void AsyncCloudSink::UploadFb() {
+  while (true) {
+    waker_.await([this] { return !pending_.empty() || producer_done_; });
+    if (pending_.empty())
+      break;
+
+    string part = std::move(pending_.front());
+    pending_.pop_front();
+
+    error_code ec;
+    if (!upload_ec_)
+      ec = upstream_->Write(io::Buffer(part));
+
+    pending_bytes_ -= part.size();
+    if (ec && !upload_ec_)
+      upload_ec_ = ec;
+    waker_.notify();
+  }
+}
+
+error_code AsyncCloudSink::Close() {
+  if (!cur_part_.empty() && !upload_ec_) {
+    pending_bytes_ += cur_part_.size();
+    pending_.push_back(std::move(cur_part_));
+    cur_part_.clear();
+  }
+  producer_done_ = true;
+  waker_.notify();
+  upload_fb_.Join();
+
+  error_code close_ec = upstream_->Close();
+  return upload_ec_ ? upload_ec_ : close_ec;
+}
+
 class RdbSnapshot {
  public:
   RdbSnapshot(FiberQueueThreadPool* fq_tp) : fq_tp_(fq_tp) {
@@ -278,6 +390,7 @@ class RdbSnapshot {
  private:
   bool started_ = false;
   bool is_linux_file_ = false;
+  bool is_cloud_ = false;
   FiberQueueThreadPool* fq_tp_ = nullptr;
   cloud::AWS* aws_ = nullptr;
 
@@ -320,7 +433,10 @@ GenericError RdbSnapshot::Start(SaveMode save_mode, const std::string& path,
     if (!res) {
       return GenericError(res.error(), "Couldn't open file for writing");
     }
-    io_sink_.reset(*res);
+    constexpr size_t kCloudPartSize = 8_MB;
+    io_sink_.reset(new AsyncCloudSink(*res, kCloudPartSize,
+                                      size_t(GetFlag(FLAGS_cloud_upload_inflight_mb)) << 20));
+    is_cloud_ = true;
   } else {
     if (fq_tp_) {  // EPOLL
       auto res = util::OpenFiberWriteFile(path, fq_tp_);
@@ -353,6 +469,9 @@ error_code RdbSnapshot::Close() {
   if (is_linux_file_) {
     return static_cast<LinuxWriteWrapper*>(io_sink_.get())->Close();
   }
+  if (is_cloud_) {
+    return static_cast<AsyncCloudSink*>(io_sink_.get())->Close();
+  }
   return static_cast<io::WriteFile*>(io_sink_.get())->Close();
 }
 
@@ -404,21 +523,171 @@ GenericError ValidateFilename(const fs::path& filename, bool new_version) {
   return {};
 }
 
+// Feature set of the io_uring rings on the running kernel. The rings themselves are
+// created inside helio, so this is gathered once for observability (INFO SERVER) only.
+struct UringFeatures {
+  bool probed = false;
+  bool sqpoll = false;
+  string features;
+};
+
+UringFeatures ProbeUringFeatures() {
+  UringFeatures res;
+
+  io_uring ring;
+  io_uring_params params;
+  memset(&params, 0, sizeof(params));
+  if (io_uring_queue_init_params(8, &ring, &params) < 0)
+    return res;
+  io_uring_queue_exit(&ring);
+  res.probed = true;
+
+  vector<string_view> names;
+  auto add_feat = [&](uint32_t bit, string_view name) {
+    if (params.features & bit)
+      names.push_back(name);
+  };
+
+  add_feat(IORING_FEAT_SINGLE_MMAP, "single_mmap");
+  add_feat(IORING_FEAT_NODROP, "nodrop");
+  add_feat(IORING_FEAT_SUBMIT_STABLE, "submit_stable");
+  add_feat(IORING_FEAT_FAST_POLL, "fast_poll");
+#ifdef IORING_FEAT_SQPOLL_NONFIXED
+  add_feat(IORING_FEAT_SQPOLL_NONFIXED, "sqpoll_nonfixed");
+#endif
+#ifdef IORING_FEAT_EXT_ARG
+  add_feat(IORING_FEAT_EXT_ARG, "ext_arg");
+#endif
+#ifdef IORING_FEAT_NATIVE_WORKERS
+  add_feat(IORING_FEAT_NATIVE_WORKERS, "native_workers");
+#endif
+#ifdef IORING_FEAT_RSRC_TAGS
+  add_feat(IORING_FEAT_RSRC_TAGS, "rsrc_tags");
+#endif
+  res.features = absl::StrJoin(names, ",");
+
+  // SQPOLL needs elevated privileges on kernels before 5.11, so try it explicitly.
+  memset(&params, 0, sizeof(params));
+  params.flags = IORING_SETUP_SQPOLL;
+  if (io_uring_queue_init_params(8, &ring, &params) == 0) {
+    io_uring_queue_exit(&ring);
+    res.sqpoll = true;
+  }
+
+  return res;
+}
+
 void SlowLog(CmdArgList args, ConnectionContext* cntx) {
   ToUpper(&args[0]);
   string_view sub_cmd = ArgS(args, 0);
 
-  if (sub_cmd == "LEN") {
-    return (*cntx)->SendLong(0);
+  if (sub_cmd == "HELP") {
+    string_view help_arr[] = {
+        "SLOWLOG <subcommand> [<arg>]",
+        "GET [<count>]",
+        "    Return the <count> newest slow log entries (default: 10, -1 for all).",
+        "LEN",
+        "    Return the number of entries in the slow log.",
+        "RESET",
+        "    Clear the slow log.",
+        "HELP",
+        "    Prints this help.",
+    };
+    return (*cntx)->SendSimpleStrArr(help_arr);
   }
 
-  if (sub_cmd == "GET") {
-    return (*cntx)->SendEmptyArray();
+  if (sub_cmd == "LEN" && args.size() == 1) {
+    atomic_uint32_t len{0};
+    shard_set->pool()->AwaitFiberOnAll(
+        [&len](auto*) { len.fetch_add(ServerState::tlocal()->slow_log().size()); });
+    return (*cntx)->SendLong(len.load());
+  }
+
+  if (sub_cmd == "RESET" && args.size() == 1) {
+    shard_set->pool()->AwaitFiberOnAll([](auto*) { ServerState::tlocal()->ResetSlowLog(); });
+    return (*cntx)->SendOk();
+  }
+
+  if (sub_cmd == "GET" && args.size() <= 2) {
+    int64_t count = 10;
+    if (args.size() == 2 && (!absl::SimpleAtoi(ArgS(args, 1), &count) || count < -1)) {
+      return (*cntx)->SendError(kInvalidIntErr);
+    }
+
+    // Copy out each ring on its owning thread since entries are written there without locks.
+    vector<vector<ServerState::SlowLogEntry>> per_thread(shard_set->pool()->size());
+    shard_set->pool()->AwaitFiberOnAll([&per_thread](unsigned index, auto*) {
+      per_thread[index] = ServerState::tlocal()->slow_log();
+    });
+
+    vector<ServerState::SlowLogEntry> merged;
+    for (auto& entries : per_thread) {
+      merged.insert(merged.end(), make_move_iterator(entries.begin()),
+                    make_move_iterator(entries.end()));
+    }
+
+    // Newest entries first, ids are process-wide monotonic.
+    sort(merged.begin(), merged.end(), [](const auto& l, const auto& r) { return l.id > r.id; });
+    if (count >= 0 && size_t(count) < merged.size())
+      merged.resize(count);
+
+    (*cntx)->StartArray(merged.size());
+    for (const auto& entry : merged) {
+      (*cntx)->StartArray(6);
+      (*cntx)->SendLong(entry.id);
+      (*cntx)->SendLong(entry.unix_ts);
+      (*cntx)->SendLong(entry.duration_usec);
+      (*cntx)->StartArray(entry.args.size());
+      for (const auto& arg : entry.args)
+        (*cntx)->SendBulkString(arg);
+      (*cntx)->SendBulkString(entry.client_addr);
+      (*cntx)->SendBulkString(entry.client_name);
+    }
+    return;
   }
 
   (*cntx)->SendError(UnknownSubCmd(sub_cmd, "SLOWLOG"), kSyntaxErrType);
 }
 
+// Replays journal segment files written by a previous run on top of the restored
+// snapshot. Segment names embed the slice index and the zero-padded start LSN, so
+// sorting them lexicographically (StatFiles returns them sorted) yields the LSN
+// order within each slice. Returns the number of entries applied.
+size_t ReplayJournalSegments(Service* service, const string& dir) {
+  string glob = (fs::path{dir} / "journal-*.seg").string();
+  io::Result<io::StatShortVec> files = io::StatFiles(glob);
+  if (!files || files->empty())
+    return 0;
+
+  JournalExecutor ex{service};
+  size_t entries = 0;
+
+  for (const auto& fstat : *files) {
+    auto res = io::OpenRead(fstat.name, io::ReadonlyFile::Options{});
+    if (!res) {
+      LOG(ERROR) << "Error opening journal segment " << fstat.name << " "
+                 << res.error().message();
+      continue;
+    }
+
+    io::FileSource fs{res.value()};
+    JournalReader reader{&fs, 0};
+    size_t file_entries = 0;
+    while (true) {
+      auto ent = reader.ReadEntry();
+      if (!ent)  // EOF, or a torn tail write of the last run.
+        break;
+      if (ent->cmd.cmd_args.empty())  // PING/EXEC markers carry no command.
+        continue;
+      ex.Execute(ent->dbid, ent->cmd);
+      ++file_entries;
+    }
+    VLOG(1) << "Replayed " << file_entries << " entries from " << fstat.name;
+    entries += file_entries;
+  }
+  return entries;
+}
+
 }  // namespace
 
 std::optional<SnapshotSpec> ParseSaveSchedule(string_view time) {
@@ -539,27 +808,82 @@ void ServerFamily::Init(util::AcceptServer* acceptor, std::vector<facade::Listen
     load_result_ = Load(load_path);
   }
 
+  if (KeyspaceEvents::Enabled()) {
+    shard_set->pool()->AwaitFiberOnAll([this](auto*) {
+      if (EngineShard::tlocal() != nullptr) {
+        // Notifications are consumed from the journal, so it must run even before any
+        // replica attaches or persistence starts.
+        journal_->StartInThread();
+        KeyspaceEvents::StartInThread(journal_);
+      }
+    });
+  }
+
+  string journal_dir = GetFlag(FLAGS_journal_dir);
+  if (!journal_dir.empty()) {
+    journal_start_fb_ =
+        service_.proactor_pool().GetNextProactor()->LaunchFiber([this, journal_dir] {
+          // The journal can be replayed and reopened only after the snapshot load
+          // is done with the keyspace.
+          if (load_result_.valid())
+            load_result_.wait();
+
+          if (GetFlag(FLAGS_journal_replay)) {
+            size_t replayed = ReplayJournalSegments(&service_, journal_dir);
+            if (replayed > 0)
+              LOG(INFO) << "Replayed " << replayed << " journal entries from " << journal_dir;
+          }
+
+          shard_set->pool()->AwaitFiberOnAll([this, &journal_dir](auto*) {
+            error_code ec = journal_->OpenInThread(true, journal_dir);
+            LOG_IF(ERROR, ec) << "Failed to open journal in " << journal_dir << " " << ec.message();
+          });
+        });
+  }
+
   string save_time = GetFlag(FLAGS_save_schedule);
   if (!save_time.empty()) {
     std::optional<SnapshotSpec> spec = ParseSaveSchedule(save_time);
     if (spec) {
-      snapshot_schedule_fb_ = service_.proactor_pool().GetNextProactor()->LaunchFiber(
-          [save_spec = std::move(spec.value()), this] { SnapshotScheduling(save_spec); });
+      StartSnapshotSchedule(std::move(spec.value()));
     } else {
       LOG(WARNING) << "Invalid snapshot time specifier " << save_time;
     }
   }
 }
 
+void ServerFamily::StartSnapshotSchedule(SnapshotSpec spec) {
+  lock_guard lk(schedule_mu_);
+
+  if (snapshot_schedule_fb_.IsJoinable()) {
+    schedule_done_.Notify();
+    snapshot_schedule_fb_.Join();
+  }
+
+  schedule_done_ = Done{};
+  snapshot_schedule_fb_ = service_.proactor_pool().GetNextProactor()->LaunchFiber(
+      [save_spec = std::move(spec), this] { SnapshotScheduling(save_spec); });
+}
+
+void ServerFamily::StopSnapshotSchedule() {
+  lock_guard lk(schedule_mu_);
+
+  schedule_done_.Notify();
+  if (snapshot_schedule_fb_.IsJoinable()) {
+    snapshot_schedule_fb_.Join();
+  }
+}
+
 void ServerFamily::Shutdown() {
   VLOG(1) << "ServerFamily::Shutdown";
 
   if (load_result_.valid())
     load_result_.wait();
 
-  schedule_done_.Notify();
-  if (snapshot_schedule_fb_.IsJoinable()) {
-    snapshot_schedule_fb_.Join();
+  StopSnapshotSchedule();
+
+  if (journal_start_fb_.IsJoinable()) {
+    journal_start_fb_.Join();
   }
 
   if (save_on_shutdown_ && !absl::GetFlag(FLAGS_dbfilename).empty()) {
@@ -650,6 +974,37 @@ Future<std::error_code> ServerFamily::Load(const std::string& load_path) {
 
   auto aggregated_result = std::make_shared<AggregateLoadResult>();
 
+  if (paths.size() > 1) {
+    // Multi-file snapshot. Load the summary first: it is the manifest of the
+    // snapshot and records how many shard files a complete one consists of,
+    // which protects against picking up stale shard files left over from a
+    // previous save taken with a different shard count.
+    uint32_t expected_shards = 0;
+    std::error_code load_ec;
+    pool.GetNextProactor()->Await([&] {
+      auto load_result = LoadRdb(paths.front(), &expected_shards);
+      if (load_result.has_value())
+        aggregated_result->keys_read.fetch_add(*load_result);
+      else
+        load_ec = load_result.error();
+    });
+
+    // Older summary files do not record the shard count - skip the check.
+    if (!load_ec && expected_shards > 0 && expected_shards + 1 != paths.size()) {
+      LOG(ERROR) << "Summary file lists " << expected_shards << " shard files but "
+                 << paths.size() - 1 << " were found";
+      load_ec = make_error_code(errc::invalid_argument);
+    }
+
+    if (load_ec) {
+      // Do not load shard files of an inconsistent snapshot.
+      aggregated_result->first_error = load_ec;
+      paths.clear();
+    } else {
+      paths.erase(paths.begin());
+    }
+  }
+
   for (auto& path : paths) {
     // For single file, choose thread that does not handle shards if possible.
     // This will balance out the CPU during the load.
@@ -721,7 +1076,7 @@ void ServerFamily::SnapshotScheduling(const SnapshotSpec& spec) {
   }
 }
 
-io::Result<size_t> ServerFamily::LoadRdb(const std::string& rdb_file) {
+io::Result<size_t> ServerFamily::LoadRdb(const std::string& rdb_file, uint32_t* shard_count) {
   error_code ec;
   io::ReadonlyFileOrError res;
 
@@ -733,12 +1088,17 @@ io::Result<size_t> ServerFamily::LoadRdb(const std::string& rdb_file) {
 
   if (res) {
     io::FileSource fs(*res);
+    // Prefetch the file on a separate fiber so rdb decoding overlaps disk reads.
+    ReadAheadSource ras(&fs);
 
     RdbLoader loader{&service_};
-    ec = loader.Load(&fs);
+    ec = loader.Load(&ras);
     if (!ec) {
       VLOG(1) << "Done loading RDB from " << rdb_file << ", keys loaded: " << loader.keys_loaded();
       VLOG(1) << "Loading finished after " << strings::HumanReadableElapsedTime(loader.load_time());
+      if (shard_count) {
+        *shard_count = loader.shard_count();
+      }
       return loader.keys_loaded();
     }
   } else {
@@ -817,6 +1177,13 @@ void PrintPrometheusMetrics(const Metrics& m, StringResponse* resp) {
                             &resp->body());
   AppendMetricWithoutLabels("client_read_buffer_bytes", "", m.conn_stats.read_buf_capacity,
                             MetricType::GAUGE, &resp->body());
+  AppendMetricWithoutLabels("dispatch_queue_bytes", "", m.conn_stats.dispatch_queue_bytes,
+                            MetricType::GAUGE, &resp->body());
+  AppendMetricWithoutLabels("total_connection_memory_bytes", "",
+                            m.conn_stats.read_buf_capacity + m.conn_stats.dispatch_queue_bytes +
+                                m.conn_stats.pipeline_cache_capacity +
+                                m.conn_stats.reply_buff_cache_capacity,
+                            MetricType::GAUGE, &resp->body());
   AppendMetricWithoutLabels("blocked_clients", "", m.conn_stats.num_blocked_clients,
                             MetricType::GAUGE, &resp->body());
 
@@ -891,6 +1258,65 @@ void PrintPrometheusMetrics(const Metrics& m, StringResponse* resp) {
   absl::StrAppend(&resp->body(), db_key_expire_metrics);
 }
 
+// Prints per-shard metrics with a "shard" label. All the shard-local numbers are collected
+// with a single cross-shard hop per scrape.
+void PrintPerShardMetrics(StringResponse* resp) {
+  struct ShardMetrics {
+    size_t key_count = 0;
+    size_t used_memory = 0;
+    size_t tx_queue_len = 0;
+    SliceEvents events;
+    size_t tiered_reads = 0;
+    size_t tiered_writes = 0;
+  };
+
+  vector<ShardMetrics> shards(shard_set->size());
+
+  shard_set->RunBriefInParallel([&](EngineShard* shard) {
+    ShardMetrics& dest = shards[shard->shard_id()];
+
+    DbSlice::Stats slice_stats = shard->db_slice().GetStats();
+    for (const auto& db_stats : slice_stats.db_stats) {
+      dest.key_count += db_stats.key_count;
+    }
+    dest.events = slice_stats.events;
+    dest.used_memory = shard->UsedMemory();
+    dest.tx_queue_len = shard->txq()->size();
+
+    if (shard->tiered_storage()) {
+      TieredStats tiered = shard->tiered_storage()->GetStats();
+      dest.tiered_reads = tiered.tiered_reads;
+      dest.tiered_writes = tiered.tiered_writes;
+    }
+  });
+
+  auto append = [&](string_view name, string_view help, MetricType type, auto getter) {
+    AppendMetricHeader(name, help, type, &resp->body());
+    for (size_t sid = 0; sid < shards.size(); ++sid) {
+      AppendMetricValue(name, getter(shards[sid]), {"shard"}, {StrCat(sid)}, &resp->body());
+    }
+  };
+
+  append("shard_keys", "Keys per shard", MetricType::GAUGE,
+         [](const auto& s) { return s.key_count; });
+  append("shard_used_memory_bytes", "Heap bytes used by shard", MetricType::GAUGE,
+         [](const auto& s) { return s.used_memory; });
+  append("shard_tx_queue_len", "Pending transactions in the shard queue", MetricType::GAUGE,
+         [](const auto& s) { return s.tx_queue_len; });
+  append("shard_keyspace_hits_total", "Keyspace hits per shard", MetricType::COUNTER,
+         [](const auto& s) { return s.events.hits; });
+  append("shard_keyspace_misses_total", "Keyspace misses per shard", MetricType::COUNTER,
+         [](const auto& s) { return s.events.misses; });
+  append("shard_expired_keys_total", "Expired keys per shard", MetricType::COUNTER,
+         [](const auto& s) { return s.events.expired_keys; });
+  append("shard_evicted_keys_total", "Evicted keys per shard", MetricType::COUNTER,
+         [](const auto& s) { return s.events.evicted_keys; });
+  append("shard_tiered_reads_total", "Tiered storage reads per shard", MetricType::COUNTER,
+         [](const auto& s) { return s.tiered_reads; });
+  append("shard_tiered_writes_total", "Tiered storage writes per shard", MetricType::COUNTER,
+         [](const auto& s) { return s.tiered_writes; });
+}
+
 void ServerFamily::ConfigureMetrics(util::HttpListenerBase* http_base) {
   // The naming of the metrics should be compatible with redis_exporter, see
   // https://github.com/oliver006/redis_exporter/blob/master/exporter/exporter.go#L111
@@ -898,6 +1324,9 @@ void ServerFamily::ConfigureMetrics(util::HttpListenerBase* http_base) {
   auto cb = [this](const util::http::QueryArgs& args, util::HttpContext* send) {
     StringResponse resp = util::http::MakeStringResponse(boost::beast::http::status::ok);
     PrintPrometheusMetrics(this->GetMetrics(), &resp);
+    if (shard_set) {
+      PrintPerShardMetrics(&resp);
+    }
 
     return send->Invoke(std::move(resp));
   };
@@ -1246,16 +1675,11 @@ shared_ptr<const LastSaveInfo> ServerFamily::GetLastSaveInfo() const {
 }
 
 void ServerFamily::DbSize(CmdArgList args, ConnectionContext* cntx) {
-  atomic_ulong num_keys{0};
-
-  shard_set->RunBriefInParallel(
-      [&](EngineShard* shard) {
-        auto db_size = shard->db_slice().DbSize(cntx->conn_state.db_index);
-        num_keys.fetch_add(db_size, memory_order_relaxed);
-      },
-      [](ShardId) { return true; });
+  // Served from the per-db counters that shard threads keep up to date, so frequent
+  // per-db accounting queries do not dispatch to the shard fibers at all.
+  auto stats = EngineShardSet::GetCachedDbStats(cntx->conn_state.db_index);
 
-  return (*cntx)->SendLong(num_keys.load(memory_order_relaxed));
+  return (*cntx)->SendLong(stats.key_count);
 }
 
 void ServerFamily::BreakOnShutdown() {
@@ -1384,6 +1808,42 @@ void ServerFamily::Client(CmdArgList args, ConnectionContext* cntx) {
     return (*cntx)->SendBulkString(result);
   }
 
+  if (sub_cmd == "TRACKING" && args.size() == 2) {
+    ToUpper(&args[1]);
+    string_view state = ArgS(args, 1);
+    bool enable = false;
+    if (state == "ON") {
+      enable = true;
+    } else if (state != "OFF") {
+      return (*cntx)->SendError(kSyntaxErr);
+    }
+
+    // The invalidation messages are RESP3 push frames, there is nothing valid we could
+    // send to a RESP2 client.
+    if (!(*cntx)->IsResp3())
+      return (*cntx)->SendError(
+          "Client tracking is currently supported only for RESP3 connections");
+
+    auto& tracking_info = cntx->conn_state.tracking_info;
+    if (enable == bool(tracking_info))  // no-op
+      return (*cntx)->SendOk();
+
+    if (enable) {
+      tracking_info.reset(new ConnectionState::TrackingInfo);
+      tracking_info->thread_id = ProactorBase::GetIndex();
+      // Shards dispatch invalidation messages to thread_id, so pin the connection to its
+      // current thread the way subscriptions do.
+      cntx->subscriptions++;
+    } else {
+      shard_set->RunBriefInParallel(
+          [cntx](EngineShard* shard) { shard->db_slice().UnregisterConnectionTracking(cntx); });
+      tracking_info->borrow_token.Wait();
+      tracking_info.reset();
+      cntx->subscriptions--;
+    }
+    return (*cntx)->SendOk();
+  }
+
   LOG_FIRST_N(ERROR, 10) << "Subcommand " << sub_cmd << " not supported";
   return (*cntx)->SendError(UnknownSubCmd(sub_cmd, "CLIENT"), kSyntaxErrType);
 }
@@ -1452,6 +1912,26 @@ void ServerFamily::Save(CmdArgList args, ConnectionContext* cntx) {
       new_version = true;
     } else if (sub_cmd == "RDB") {
       new_version = false;
+    } else if (sub_cmd == "SCHEDULE") {
+      // SAVE SCHEDULE <hh:mm>|OFF - replace or stop the snapshot schedule at
+      // runtime, e.g. to move saves into traffic troughs without a restart.
+      if (args.size() != 2) {
+        return (*cntx)->SendError(kSyntaxErr);
+      }
+
+      string_view spec_str = ArgS(args, 1);
+      if (absl::EqualsIgnoreCase(spec_str, "OFF")) {
+        StopSnapshotSchedule();
+        return (*cntx)->SendOk();
+      }
+
+      std::optional<SnapshotSpec> spec = ParseSaveSchedule(spec_str);
+      if (!spec) {
+        return (*cntx)->SendError("invalid snapshot time specifier", kSyntaxErrType);
+      }
+
+      StartSnapshotSchedule(std::move(spec.value()));
+      return (*cntx)->SendOk();
     } else {
       return (*cntx)->SendError(UnknownSubCmd(sub_cmd, "SAVE"), kSyntaxErrType);
     }
@@ -1470,6 +1950,82 @@ void ServerFamily::Save(CmdArgList args, ConnectionContext* cntx) {
   }
 }
 
+// EXPORT <basename> [MATCH <glob>] - point-in-time columnar dump of the selected
+// database for analytics pipelines, replacing full SCAN sweeps. Each shard writes
+// <basename>-NNNN.dfe under --dir in parallel; see columnar_export.h for the file
+// format. The exporters start inside a global transaction hop, so the cut is
+// consistent across shards, while the serialization itself runs in background
+// fibers that yield to foreground traffic. Replies with the number of exported rows.
+void ServerFamily::Export(CmdArgList args, ConnectionContext* cntx) {
+  string_view basename = ArgS(args, 0);
+  string pattern;
+
+  if (args.size() == 3) {
+    ToUpper(&args[1]);
+    if (ArgS(args, 1) != "MATCH") {
+      return (*cntx)->SendError(kSyntaxErr);
+    }
+    pattern = ArgS(args, 2);
+  } else if (args.size() != 1) {
+    return (*cntx)->SendError(kSyntaxErr);
+  }
+
+  fs::path dir_path(GetFlag(FLAGS_dir));
+  if (!dir_path.empty()) {
+    if (auto ec = CreateDirs(dir_path); ec) {
+      return (*cntx)->SendError(StrCat("create-dir: ", ec.message()));
+    }
+  }
+
+  DbIndex db_index = cntx->db_index();
+  vector<unique_ptr<ColumnarExporter>> exporters(shard_set->size());
+  AggregateGenericError ec;
+
+  // Open the files and fix the export cut on all shards within one scheduled hop,
+  // exactly like DoSave starts its shard snapshots.
+  auto cb = [&](Transaction* t, EngineShard* shard) {
+    fs::path path = dir_path;
+    path /= StrCat(basename, "-", absl::Dec(shard->shard_id(), absl::kZeroPad4), ".dfe");
+
+    io::Result<io::WriteFile*> res = fq_threadpool_
+                                         ? util::OpenFiberWriteFile(path.string(),
+                                                                    fq_threadpool_.get())
+                                         : io::OpenWrite(path.string());
+    if (!res) {
+      ec = GenericError(res.error(), path.string());
+      return OpStatus::OK;
+    }
+
+    auto& exporter = exporters[shard->shard_id()];
+    exporter.reset(new ColumnarExporter(&shard->db_slice(), db_index, pattern,
+                                        unique_ptr<io::WriteFile>(*res)));
+    exporter->Start();
+    return OpStatus::OK;
+  };
+  cntx->transaction->ScheduleSingleHop(std::move(cb));
+
+  // Wait for the traversal fibers; the current fiber blocks until all shards finished.
+  uint64_t total_rows = 0;
+  Mutex mu;
+  shard_set->RunBlockingInParallel([&](EngineShard* shard) {
+    auto& exporter = exporters[shard->shard_id()];
+    if (!exporter)
+      return;
+    error_code local_ec = exporter->Finish();
+
+    lock_guard lk(mu);
+    total_rows += exporter->rows();
+    if (local_ec) {
+      ec = local_ec;
+    }
+  });
+
+  if (GenericError err = *ec; err) {
+    return (*cntx)->SendError(err.Format());
+  }
+  (*cntx)->SendLong(total_rows);
+}
+
 static void MergeInto(const DbSlice::Stats& src, Metrics* dest) {
   if (src.db_stats.size() > dest->db.size())
     dest->db.resize(src.db_stats.size());
@@ -1479,9 +2035,20 @@ static void MergeInto(const DbSlice::Stats& src, Metrics* dest) {
 
   dest->events += src.events;
   dest->small_string_bytes += src.small_string_bytes;
+  dest->lz4_compressed_bytes += src.lz4_compressed_bytes;
+  dest->lz4_raw_bytes += src.lz4_raw_bytes;
 }
 
 Metrics ServerFamily::GetMetrics() const {
+  const uint64_t cache_ns = uint64_t(GetFlag(FLAGS_metrics_cache_time_ms)) * 1'000'000;
+  const uint64_t now_ns = absl::GetCurrentTimeNanos();
+
+  if (cache_ns > 0) {
+    lock_guard lk(metrics_mu_);
+    if (cached_metrics_ && now_ns - cached_metrics_time_ns_ < cache_ns)
+      return *cached_metrics_;
+  }
+
   Metrics result;
 
   Mutex mu;
@@ -1496,11 +2063,13 @@ Metrics ServerFamily::GetMetrics() const {
     result.conn_stats += ss->connection_stats;
     result.qps += uint64_t(ss->MovingSum6());
     result.ooo_tx_transaction_cnt += ss->stats.ooo_tx_cnt;
+    result.tx_schedule_cancel_cnt += ss->stats.tx_schedule_cancel_cnt;
 
     if (shard) {
       MergeInto(shard->db_slice().GetStats(), &result);
 
       result.heap_used_bytes += shard->UsedMemory();
+      result.pending_flush_keys += shard->db_slice().pending_flush_keys();
       if (shard->tiered_storage()) {
         result.tiered_stats += shard->tiered_storage()->GetStats();
       }
@@ -1521,6 +2090,12 @@ Metrics ServerFamily::GetMetrics() const {
     result.replication_metrics = dfly_cmd_->GetReplicasRoleInfo();
   }
 
+  if (cache_ns > 0) {
+    lock_guard lk(metrics_mu_);
+    cached_metrics_ = result;
+    cached_metrics_time_ns_ = now_ns;
+  }
+
   return result;
 }
 
@@ -1564,6 +2139,13 @@ void ServerFamily::Info(CmdArgList args, ConnectionContext* cntx) {
     append("redis_mode", "standalone");
     append("arch_bits", 64);
     append("multiplexing_api", multiplex_api);
+    if (kind == ProactorBase::IOURING) {
+      static const UringFeatures uring_features = ProbeUringFeatures();
+      if (uring_features.probed) {
+        append("io_uring_features", uring_features.features);
+        append("io_uring_sqpoll", uring_features.sqpoll ? 1 : 0);
+      }
+    }
     append("tcp_port", GetFlag(FLAGS_port));
 
     size_t uptime = m.uptime;
@@ -1582,6 +2164,13 @@ void ServerFamily::Info(CmdArgList args, ConnectionContext* cntx) {
     ADD_HEADER("# Clients");
     append("connected_clients", m.conn_stats.num_conns);
     append("client_read_buffer_bytes", m.conn_stats.read_buf_capacity);
+    append("dispatch_queue_bytes", m.conn_stats.dispatch_queue_bytes);
+    append("pipeline_cache_bytes", m.conn_stats.pipeline_cache_capacity);
+    append("reply_buffer_cache_bytes", m.conn_stats.reply_buff_cache_capacity);
+    // All the facade-side buffer memory together - not governed by maxmemory.
+    append("total_connection_memory_bytes",
+           m.conn_stats.read_buf_capacity + m.conn_stats.dispatch_queue_bytes +
+               m.conn_stats.pipeline_cache_capacity + m.conn_stats.reply_buff_cache_capacity);
     append("blocked_clients", m.conn_stats.num_blocked_clients);
   }
 
@@ -1602,6 +2191,14 @@ void ServerFamily::Info(CmdArgList args, ConnectionContext* cntx) {
                              << sdata_res.error().message();
     }
 
+    if (GetFlag(FLAGS_use_large_pages) && sdata_res.has_value() && sdata_res->vm_rss > 0) {
+      // Scanning /proc/self/smaps is not cheap, hence gated on the flag.
+      char huge_field[] = "AnonHugePages:";
+      size_t huge_bytes = zmalloc_get_smap_bytes_by_field(huge_field, -1);
+      append("anon_huge_pages_bytes", huge_bytes);
+      append("huge_pages_coverage", static_cast<double>(huge_bytes) / sdata_res->vm_rss);
+    }
+
     // Blob - all these cases where the key/objects are represented by a single blob allocated on
     // heap. For example, strings or intsets. members of lists, sets, zsets etc
     // are not accounted for to avoid complex computations. In some cases, when number of members
@@ -1610,13 +2207,21 @@ void ServerFamily::Info(CmdArgList args, ConnectionContext* cntx) {
     append("table_used_memory", total.table_mem_usage);
     append("num_buckets", total.bucket_count);
     append("num_entries", total.key_count);
+    append("pending_flush_keys", m.pending_flush_keys);
     append("inline_keys", total.inline_keys);
     append("strval_bytes", total.strval_memory_usage);
     append("updateval_amount", total.update_value_amount);
     append("listpack_blobs", total.listpack_blob_cnt);
     append("listpack_bytes", total.listpack_bytes);
     append("small_string_bytes", m.small_string_bytes);
+    if (m.lz4_raw_bytes > 0) {
+      append("value_compression_bytes", m.lz4_compressed_bytes);
+      append("value_compression_raw_bytes", m.lz4_raw_bytes);
+      append("value_compression_ratio",
+             static_cast<double>(m.lz4_raw_bytes) / m.lz4_compressed_bytes);
+    }
     append("pipeline_cache_bytes", m.conn_stats.pipeline_cache_capacity);
+    append("reply_buff_cache_bytes", m.conn_stats.reply_buff_cache_capacity);
     append("maxmemory", max_memory_limit);
     append("maxmemory_human", HumanReadableNumBytes(max_memory_limit));
     if (GetFlag(FLAGS_cache_mode)) {
@@ -1635,6 +2240,10 @@ void ServerFamily::Info(CmdArgList args, ConnectionContext* cntx) {
     append("total_commands_processed", m.conn_stats.command_cnt);
     append("instantaneous_ops_per_sec", m.qps);
     append("total_pipelined_commands", m.conn_stats.pipelined_cmd_cnt);
+    append("pipeline_cache_hits", m.conn_stats.pipeline_cache_hit_cnt);
+    append("pipeline_cache_misses", m.conn_stats.pipeline_cache_miss_cnt);
+    append("reply_buff_cache_hits", m.conn_stats.reply_buff_cache_hit_cnt);
+    append("reply_buff_cache_misses", m.conn_stats.reply_buff_cache_miss_cnt);
     append("total_net_input_bytes", m.conn_stats.io_read_bytes);
     append("total_net_output_bytes", m.conn_stats.io_write_bytes);
     append("instantaneous_input_kbps", -1);
@@ -1642,6 +2251,7 @@ void ServerFamily::Info(CmdArgList args, ConnectionContext* cntx) {
     append("rejected_connections", -1);
     append("expired_keys", m.events.expired_keys);
     append("evicted_keys", m.events.evicted_keys);
+    append("demoted_keys", m.events.demoted_keys);
     append("hard_evictions", m.events.hard_evictions);
     append("garbage_checked", m.events.garbage_checked);
     append("garbage_collected", m.events.garbage_collected);
@@ -1658,6 +2268,13 @@ void ServerFamily::Info(CmdArgList args, ConnectionContext* cntx) {
     append("defrag_attempt_total", m.shard_stats.defrag_attempt_total);
     append("defrag_realloc_total", m.shard_stats.defrag_realloc_total);
     append("defrag_task_invocation_total", m.shard_stats.defrag_task_invocation_total);
+    // Scheduler behavior: how often single-hop transactions bypassed the tx queue entirely
+    // (quick runs), ran eagerly out of order, or had to cancel and retry scheduling.
+    append("tx_quick_runs", m.shard_stats.quick_runs);
+    append("tx_ooo_runs", m.shard_stats.ooo_runs);
+    append("tx_ooo_transactions", m.ooo_tx_transaction_cnt);
+    append("tx_schedule_cancel", m.tx_schedule_cancel_cnt);
+    append("tx_queue_len_max", m.shard_stats.txq_len_max);
   }
 
   if (should_enter("TIERED", true)) {
@@ -1666,10 +2283,15 @@ void ServerFamily::Info(CmdArgList args, ConnectionContext* cntx) {
     append("tiered_bytes", total.tiered_size);
     append("tiered_reads", m.tiered_stats.tiered_reads);
     append("tiered_writes", m.tiered_stats.tiered_writes);
+    append("tiered_read_cache_hits", m.tiered_stats.read_cache_hits);
     append("tiered_reserved", m.tiered_stats.storage_reserved);
     append("tiered_capacity", m.tiered_stats.storage_capacity);
     append("tiered_aborted_write_total", m.tiered_stats.aborted_write_cnt);
     append("tiered_flush_skip_total", m.tiered_stats.flush_skip_cnt);
+    append("tiered_defrag_relocations", m.tiered_stats.defrag_relocations);
+    append("tiered_pending_io_ops", m.tiered_stats.pending_io_ops);
+    append("tiered_max_pending_io_ops", m.tiered_stats.max_pending_io_ops);
+    append("tiered_write_latency_usec", m.tiered_stats.write_latency_usec);
   }
 
   if (should_enter("PERSISTENCE", true)) {
@@ -1748,6 +2370,37 @@ void ServerFamily::Info(CmdArgList args, ConnectionContext* cntx) {
 
     append_sorted("unknown_", unknown_cmd);
     append_sorted("cmd_", m.conn_stats.cmd_count_map);
+
+    // Fold the per-thread flat counter arrays; the hot path only bumps plain thread-local
+    // counters, so the cross-thread work happens here, only when the section is requested.
+    vector<ServerState::CmdStat> total;
+    Mutex stats_mu;
+    service_.proactor_pool().AwaitFiberOnAll([&](ProactorBase*) {
+      const auto& local = ServerState::tlocal()->cmd_stats();
+      lock_guard lk(stats_mu);
+      if (total.size() < local.size())
+        total.resize(local.size());
+      for (size_t i = 0; i < local.size(); ++i) {
+        total[i].calls += local[i].calls;
+        total[i].usec += local[i].usec;
+      }
+    });
+
+    if (registry_) {
+      vector<pair<string, ServerState::CmdStat>> display;
+      registry_->Traverse([&](string_view name, const CommandId& cid) {
+        uint32_t idx = cid.stats_index();
+        if (idx < total.size() && total[idx].calls > 0)
+          display.emplace_back(absl::AsciiStrToLower(name), total[idx]);
+      });
+      sort(display.begin(), display.end());
+
+      for (const auto& [name, stat] : display) {
+        append(StrCat("cmdstat_", name),
+               StrCat("calls=", stat.calls, ",usec=", stat.usec,
+                      ",usec_per_call=", double(stat.usec) / double(stat.calls)));
+      }
+    }
   }
 
   if (should_enter("ERRORSTATS", true)) {
@@ -1782,6 +2435,15 @@ void ServerFamily::Info(CmdArgList args, ConnectionContext* cntx) {
     append("used_cpu_user_children", StrCat(cu.ru_utime.tv_sec, ".", cu.ru_utime.tv_usec));
     append("used_cpu_sys_main_thread", StrCat(tu.ru_stime.tv_sec, ".", tu.ru_stime.tv_usec));
     append("used_cpu_user_main_thread", StrCat(tu.ru_utime.tv_sec, ".", tu.ru_utime.tv_usec));
+
+    if (GetFlag(FLAGS_proactor_idle_governor_qps) > 0) {
+      // One entry per IO thread, in thread order.
+      vector<const char*> regimes(shard_set->pool()->size());
+      shard_set->pool()->AwaitFiberOnAll([&regimes](unsigned index, auto*) {
+        regimes[index] = ServerState::tlocal()->idle_regime_name();
+      });
+      append("thread_idle_regimes", absl::StrJoin(regimes, ","));
+    }
   }
 
   if (should_enter("CLUSTER")) {
@@ -2066,6 +2728,7 @@ void ServerFamily::ReplConf(CmdArgList args, ConnectionContext* cntx) {
       }
       VLOG(1) << "Received client ACK=" << ack;
       cntx->replication_flow->last_acked_lsn = ack;
+      dfly_cmd_->NotifyReplicaAck();
       return;
     } else {
       VLOG(1) << cmd << " " << arg << " " << args.size();
@@ -2125,6 +2788,60 @@ void ServerFamily::Sync(CmdArgList args, ConnectionContext* cntx) {
   SyncGeneric("", 0, cntx);
 }
 
+void ServerFamily::Wait(CmdArgList args, ConnectionContext* cntx) {
+  uint32_t num_replicas;
+  uint64_t timeout_ms;
+  if (!absl::SimpleAtoi(ArgS(args, 0), &num_replicas) ||
+      !absl::SimpleAtoi(ArgS(args, 1), &timeout_ms)) {
+    return (*cntx)->SendError(kInvalidIntErr);
+  }
+
+  if (!ServerState::tlocal()->is_master)
+    return (*cntx)->SendLong(0);
+
+  (*cntx)->SendLong(dfly_cmd_->WaitReplicas(num_replicas, timeout_ms));
+}
+
+void ServerFamily::HotKeys(CmdArgList args, ConnectionContext* cntx) {
+  Mutex mu;
+  absl::flat_hash_map<string, uint64_t> agg;
+  atomic_bool enabled{false};
+
+  DbIndex db_index = cntx->db_index();
+  shard_set->RunBlockingInParallel([&](EngineShard* shard) {
+    const DbSlice& db_slice = shard->db_slice();
+    if (!db_slice.IsDbValid(db_index))
+      return;
+
+    const TopKeys& top_keys = db_slice.databases()[db_index]->top_keys;
+    if (!top_keys.IsEnabled())
+      return;
+
+    enabled = true;
+    auto shard_top = top_keys.GetTopKeys();
+
+    lock_guard lk(mu);
+    for (auto& k_v : shard_top) {
+      agg[k_v.first] += k_v.second;
+    }
+  });
+
+  if (!enabled) {
+    return (*cntx)->SendError("HOTKEYS requires --enable_top_keys_tracking");
+  }
+
+  // Reply with key/count pairs, hottest first. Counts are approximate hit counts since the
+  // tracking started (HeavyKeeper estimates), not an exact QPS.
+  vector<pair<string, uint64_t>> hot(agg.begin(), agg.end());
+  sort(hot.begin(), hot.end(), [](const auto& l, const auto& r) { return l.second > r.second; });
+
+  (*cntx)->StartArray(hot.size() * 2);
+  for (const auto& k_v : hot) {
+    (*cntx)->SendBulkString(k_v.first);
+    (*cntx)->SendLong(k_v.second);
+  }
+}
+
 void ServerFamily::Psync(CmdArgList args, ConnectionContext* cntx) {
   SyncGeneric("?", 0, cntx);  // full sync, ignore the request.
 }
@@ -2195,6 +2912,7 @@ void ServerFamily::Dfly(CmdArgList args, ConnectionContext* cntx) {
 #define HFUNC(x) SetHandler(HandlerFunc(this, &ServerFamily::x))
 
 void ServerFamily::Register(CommandRegistry* registry) {
+  registry_ = registry;  // kept for INFO COMMANDSTATS to map stats indices back to names.
   constexpr auto kReplicaOpts = CO::LOADING | CO::ADMIN | CO::GLOBAL_TRANS;
   constexpr auto kMemOpts = CO::LOADING | CO::READONLY | CO::FAST | CO::NOSCRIPT;
 
@@ -2204,6 +2922,7 @@ void ServerFamily::Register(CommandRegistry* registry) {
             << CI{"CONFIG", CO::ADMIN, -2, 0, 0, 0}.HFUNC(Config)
             << CI{"DBSIZE", CO::READONLY | CO::FAST | CO::LOADING, 1, 0, 0, 0}.HFUNC(DbSize)
             << CI{"DEBUG", CO::ADMIN | CO::LOADING, -2, 0, 0, 0}.HFUNC(Debug)
+            << CI{"EXPORT", CO::ADMIN | CO::GLOBAL_TRANS, -2, 0, 0, 0}.HFUNC(Export)
             << CI{"FLUSHDB", CO::WRITE | CO::GLOBAL_TRANS, 1, 0, 0, 0}.HFUNC(FlushDb)
             << CI{"FLUSHALL", CO::WRITE | CO::GLOBAL_TRANS, -1, 0, 0, 0}.HFUNC(FlushAll)
             << CI{"INFO", CO::LOADING, -1, 0, 0, 0}.HFUNC(Info)
@@ -2220,6 +2939,8 @@ void ServerFamily::Register(CommandRegistry* registry) {
             << CI{"REPLCONF", CO::ADMIN | CO::LOADING, -1, 0, 0, 0}.HFUNC(ReplConf)
             << CI{"ROLE", CO::LOADING | CO::FAST | CO::NOSCRIPT, 1, 0, 0, 0}.HFUNC(Role)
             << CI{"SLOWLOG", CO::ADMIN | CO::FAST, -2, 0, 0, 0}.SetHandler(SlowLog)
+            << CI{"HOTKEYS", CO::READONLY | CO::NOSCRIPT, 1, 0, 0, 0}.HFUNC(HotKeys)
+            << CI{"WAIT", CO::NOSCRIPT, 3, 0, 0, 0}.HFUNC(Wait)
             << CI{"SCRIPT", CO::NOSCRIPT | CO::NO_KEY_JOURNAL, -2, 0, 0, 0}.HFUNC(Script)
             << CI{"DFLY", CO::ADMIN | CO::GLOBAL_TRANS | CO::HIDDEN, -2, 0, 0, 0}.HFUNC(Dfly);
 }
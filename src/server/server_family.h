@@ -58,7 +58,13 @@ struct Metrics {
   size_t heap_used_bytes = 0;
   size_t heap_comitted_bytes = 0;
   size_t small_string_bytes = 0;
+  size_t pending_flush_keys = 0;  // keys of flushed tables still awaiting background teardown.
+
+  // At-rest value compression accounting, see --value_compression_threshold.
+  size_t lz4_compressed_bytes = 0;
+  size_t lz4_raw_bytes = 0;
   uint64_t ooo_tx_transaction_cnt = 0;
+  uint64_t tx_schedule_cancel_cnt = 0;
   uint32_t traverse_ttl_per_sec = 0;
   uint32_t delete_ttl_per_sec = 0;
   bool is_master = true;
@@ -173,9 +179,11 @@ class ServerFamily {
   void DbSize(CmdArgList args, ConnectionContext* cntx);
   void Debug(CmdArgList args, ConnectionContext* cntx);
   void Dfly(CmdArgList args, ConnectionContext* cntx);
+  void Export(CmdArgList args, ConnectionContext* cntx);
   void Memory(CmdArgList args, ConnectionContext* cntx);
   void FlushDb(CmdArgList args, ConnectionContext* cntx);
   void FlushAll(CmdArgList args, ConnectionContext* cntx);
+  void HotKeys(CmdArgList args, ConnectionContext* cntx);
   void Info(CmdArgList args, ConnectionContext* cntx);
   void Hello(CmdArgList args, ConnectionContext* cntx);
   void LastSave(CmdArgList args, ConnectionContext* cntx);
@@ -188,15 +196,26 @@ class ServerFamily {
   void Save(CmdArgList args, ConnectionContext* cntx);
   void Script(CmdArgList args, ConnectionContext* cntx);
   void Sync(CmdArgList args, ConnectionContext* cntx);
+  void Wait(CmdArgList args, ConnectionContext* cntx);
 
   void SyncGeneric(std::string_view repl_master_id, uint64_t offs, ConnectionContext* cntx);
 
   // Returns the number of loaded keys if successfull.
-  io::Result<size_t> LoadRdb(const std::string& rdb_file);
+  // Loads a single snapshot file. If shard_count is provided, it is filled with
+  // the shard-count recorded in the file (see RdbLoader::shard_count()).
+  io::Result<size_t> LoadRdb(const std::string& rdb_file, uint32_t* shard_count = nullptr);
 
   void SnapshotScheduling(const SnapshotSpec& time);
 
+  // Start/stop the fiber running SnapshotScheduling. Serialized by
+  // schedule_mu_ since the schedule can be replaced at runtime via
+  // SAVE SCHEDULE.
+  void StartSnapshotSchedule(SnapshotSpec spec);
+  void StopSnapshotSchedule();
+
   Fiber snapshot_schedule_fb_;
+  // Replays and reopens the persistent journal once the initial load finished.
+  Fiber journal_start_fb_;
   Future<std::error_code> load_result_;
 
   uint32_t stats_caching_task_ = 0;
@@ -209,6 +228,7 @@ class ServerFamily {
   mutable Mutex replicaof_mu_, save_mu_;
   std::shared_ptr<Replica> replica_ ABSL_GUARDED_BY(replicaof_mu_);
 
+  CommandRegistry* registry_ = nullptr;  // Not owned, set in Register().
   std::unique_ptr<ScriptMgr> script_mgr_;
   std::unique_ptr<journal::Journal> journal_;
   std::unique_ptr<DflyCmd> dfly_cmd_;
@@ -225,6 +245,13 @@ class ServerFamily {
   // be --dbfilename.
   bool save_on_shutdown_{true};
 
+  // Short-lived cache for GetMetrics(), so that high-frequency INFO polling does not
+  // fan a fiber to every proactor on each call. Guarded by metrics_mu_.
+  mutable Mutex metrics_mu_;
+  mutable std::optional<Metrics> cached_metrics_;
+  mutable uint64_t cached_metrics_time_ns_ = 0;
+
+  Mutex schedule_mu_;
   Done schedule_done_;
   std::unique_ptr<FiberQueueThreadPool> fq_threadpool_;
   std::unique_ptr<util::cloud::AWS> aws_;
@@ -4,8 +4,13 @@
 
 #include "server/server_state.h"
 
+#include <absl/strings/str_cat.h>
+#include <absl/time/clock.h>
 #include <mimalloc.h>
 
+#include <atomic>
+#include <utility>
+
 extern "C" {
 #include "redis/zmalloc.h"
 }
@@ -17,6 +22,14 @@ extern "C" {
 
 ABSL_FLAG(uint32_t, interpreter_per_thread, 10, "Lua interpreters per thread");
 
+ABSL_FLAG(uint32_t, slowlog_max_len, 128,
+          "Maximum number of entries kept in the slow log of each thread");
+
+ABSL_FLAG(uint32_t, proactor_idle_governor_qps, 0,
+          "If positive, a proactor thread keeps busy-polling while its recent command rate "
+          "is at least this many commands per second, polls shallowly down to a tenth of "
+          "that rate and sleeps normally below it. 0 disables the governor.");
+
 namespace dfly {
 
 __thread ServerState* ServerState::state_ = nullptr;
@@ -64,9 +77,19 @@ void ServerState::Init(uint32_t thread_index) {
   state_ = new ServerState();
   state_->gstate_ = GlobalState::ACTIVE;
   state_->thread_index_ = thread_index;
+
+  // Init may also run outside of a proactor thread in tests, where there is nothing to govern.
+  util::ProactorBase* pb = util::ProactorBase::me();
+  if (pb && absl::GetFlag(FLAGS_proactor_idle_governor_qps) > 0) {
+    state_->idle_task_ = pb->AddOnIdleTask([] { return state_->UpdateIdleRegime(); });
+    state_->idle_task_registered_ = true;
+  }
 }
 
 void ServerState::Destroy() {
+  if (state_->idle_task_registered_) {
+    util::ProactorBase::me()->RemoveOnIdleTask(state_->idle_task_);
+  }
   delete state_;
   state_ = nullptr;
 }
@@ -89,6 +112,82 @@ bool ServerState::AllowInlineScheduling() const {
   return true;
 }
 
+void ServerState::RecordTxTrace(uint64_t tx_id, std::string_view name, const char* phase) {
+  TxTraceEvent event{tx_id, uint64_t(absl::GetCurrentTimeNanos()), std::string(name), phase};
+
+  if (tx_trace_.size() < kTxTraceCapacity) {
+    tx_trace_.push_back(std::move(event));
+  } else {
+    tx_trace_[tx_trace_next_ % kTxTraceCapacity] = std::move(event);
+  }
+  ++tx_trace_next_;
+}
+
+std::vector<ServerState::TxTraceEvent> ServerState::DrainTxTrace() {
+  tx_trace_next_ = 0;
+  return std::exchange(tx_trace_, {});
+}
+
+void ServerState::RecordSlowLog(facade::CmdArgList args, uint64_t duration_usec,
+                                std::string client_addr, std::string client_name) {
+  // Matches the redis truncation limits so clients parsing SLOWLOG GET see familiar shapes.
+  constexpr size_t kMaxArgs = 32;
+  constexpr size_t kMaxArgLen = 128;
+
+  // The only cross-thread state of the slow log. Touched solely here, i.e. only for
+  // commands that already took at least --slowlog_log_slower_than to run.
+  static std::atomic_uint64_t next_id{0};
+
+  size_t max_len = absl::GetFlag(FLAGS_slowlog_max_len);
+  if (max_len == 0)
+    return;
+
+  SlowLogEntry entry;
+  entry.id = next_id.fetch_add(1, std::memory_order_relaxed);
+  entry.unix_ts = absl::GetCurrentTimeNanos() / 1'000'000'000ULL;
+  entry.duration_usec = duration_usec;
+  entry.client_addr = std::move(client_addr);
+  entry.client_name = std::move(client_name);
+
+  size_t copy_cnt = std::min(args.size(), kMaxArgs);
+  entry.args.reserve(copy_cnt + (args.size() > kMaxArgs));
+  for (size_t i = 0; i < copy_cnt; ++i) {
+    std::string_view arg = facade::ToSV(args[i]);
+    if (arg.size() > kMaxArgLen) {
+      entry.args.push_back(absl::StrCat(arg.substr(0, kMaxArgLen), "... (",
+                                        arg.size() - kMaxArgLen, " more bytes)"));
+    } else {
+      entry.args.emplace_back(arg);
+    }
+  }
+  if (args.size() > kMaxArgs) {
+    entry.args.push_back(absl::StrCat("... (", args.size() - kMaxArgs, " more arguments)"));
+  }
+
+  if (slow_log_.size() < max_len) {
+    slow_log_.push_back(std::move(entry));
+  } else {
+    slow_log_[slow_log_next_ % max_len] = std::move(entry);
+  }
+  ++slow_log_next_;
+}
+
+uint32_t ServerState::UpdateIdleRegime() {
+  uint32_t spin_qps = absl::GetFlag(FLAGS_proactor_idle_governor_qps);
+  uint32_t qps = MovingSum6() / 6;
+
+  if (qps >= spin_qps) {
+    idle_regime_name_ = "spin";
+    return util::ProactorBase::kOnIdleMaxLevel;
+  }
+  if (qps >= (spin_qps + 9) / 10) {
+    idle_regime_name_ = "shallow";
+    return util::ProactorBase::kOnIdleMaxLevel / 2;
+  }
+  idle_regime_name_ = "deep";
+  return 0;
+}
+
 Interpreter* ServerState::BorrowInterpreter() {
   return interpreter_mgr_.Get();
 }
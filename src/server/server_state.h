@@ -90,6 +90,32 @@ class ServerState {  // public struct - to allow initialization.
  public:
   struct Stats {
     uint64_t ooo_tx_cnt = 0;
+
+    // How many times a scheduling attempt failed in some shard and had to be cancelled and
+    // retried with a newer txid. Grows under contended hot-key workloads.
+    uint64_t tx_schedule_cancel_cnt = 0;
+  };
+
+  // A single phase timestamp of a sampled transaction, recorded on the thread where the
+  // phase ran. See --tx_trace_sample_rate and DEBUG TRACE.
+  struct TxTraceEvent {
+    uint64_t tx_id;
+    uint64_t ts_ns;
+    std::string name;   // command name
+    const char* phase;  // string literal, e.g. "schedule" or "hop-start"
+  };
+
+  // An entry of the slow command log: a command whose dispatch took longer than
+  // --slowlog_log_slower_than. Entries live in a fixed-size per-thread ring written
+  // only by this thread's connection fibers, so recording needs no synchronization;
+  // SLOWLOG GET copies the rings out on their owning threads and merges them.
+  struct SlowLogEntry {
+    uint64_t id;             // unique, process-wide monotonic.
+    uint64_t unix_ts;        // seconds, when the command finished.
+    uint64_t duration_usec;  // total dispatch time, including all hops.
+    std::vector<std::string> args;  // command with arguments, possibly truncated.
+    std::string client_addr;
+    std::string client_name;
   };
 
   static ServerState* tlocal() {
@@ -174,6 +200,58 @@ class ServerState {  // public struct - to allow initialization.
     call_latency_histos_[sha].Add(latency_usec);
   }
 
+  // Appends an event to the thread-local trace ring buffer, overwriting the oldest record
+  // once kTxTraceCapacity events accumulated.
+  void RecordTxTrace(uint64_t tx_id, std::string_view name, const char* phase);
+
+  // Returns the accumulated trace events and resets the buffer.
+  std::vector<TxTraceEvent> DrainTxTrace();
+
+  // Appends an entry to the thread-local slow log ring, overwriting the oldest one once
+  // --slowlog_max_len entries accumulated. Long arguments are truncated before copying.
+  // Must be called from this thread.
+  void RecordSlowLog(facade::CmdArgList args, uint64_t duration_usec, std::string client_addr,
+                     std::string client_name);
+
+  const std::vector<SlowLogEntry>& slow_log() const {
+    return slow_log_;
+  }
+
+  void ResetSlowLog() {
+    slow_log_.clear();
+    slow_log_next_ = 0;
+  }
+
+  struct CmdStat {
+    uint64_t calls = 0;
+    uint64_t usec = 0;
+  };
+
+  // Bumps the thread-local counters of the command with the given dense index
+  // (CommandId::stats_index()). Plain per-thread writes - no shared cache lines involved.
+  // INFO COMMANDSTATS folds the arrays of all threads on demand.
+  void RecordCmdStat(uint32_t index, uint64_t duration_usec) {
+    if (index >= cmd_stats_.size())
+      cmd_stats_.resize(index + 1);
+    cmd_stats_[index].calls++;
+    cmd_stats_[index].usec += duration_usec;
+  }
+
+  const std::vector<CmdStat>& cmd_stats() const {
+    return cmd_stats_;
+  }
+
+  // Invoked by the proactor whenever this thread has no ready work. Picks a polling regime
+  // from the recent command rate of this thread and returns the on-idle level: a high level
+  // keeps the proactor busy-polling instead of entering the kernel wait, so a loaded thread
+  // reacts to the next request without paying wakeup latency. See --proactor_idle_governor_qps.
+  uint32_t UpdateIdleRegime();
+
+  // The polling regime chosen by the last UpdateIdleRegime() call, reported in INFO.
+  const char* idle_regime_name() const {
+    return idle_regime_name_;
+  }
+
   void SetScriptParams(const ScriptMgr::ScriptKey& key, ScriptMgr::ScriptParams params) {
     cached_script_params_[key] = params;
   }
@@ -198,12 +276,18 @@ class ServerState {  // public struct - to allow initialization.
  public:
   Stats stats;
 
+  // Net bytes allocated on this thread's data heap per command name. Filled only when
+  // --cmd_alloc_tracking is enabled, aggregated by MEMORY STATS.
+  absl::flat_hash_map<std::string, int64_t> cmd_alloc_bytes;
+
   bool is_master = true;
   std::string remote_client_id_;  // for cluster support
 
   facade::ConnectionStats connection_stats;
 
  private:
+  static constexpr size_t kTxTraceCapacity = 4096;
+
   int64_t live_transactions_ = 0;
   mi_heap_t* data_heap_;
   journal::Journal* journal_ = nullptr;
@@ -223,6 +307,18 @@ class ServerState {  // public struct - to allow initialization.
   absl::flat_hash_map<std::string, base::Histogram> call_latency_histos_;
   uint32_t thread_index_ = 0;
 
+  std::vector<TxTraceEvent> tx_trace_;  // circular once it reaches kTxTraceCapacity.
+  size_t tx_trace_next_ = 0;
+
+  std::vector<SlowLogEntry> slow_log_;  // circular once it reaches --slowlog_max_len.
+  size_t slow_log_next_ = 0;
+
+  std::vector<CmdStat> cmd_stats_;  // indexed by CommandId::stats_index().
+
+  const char* idle_regime_name_ = "deep";  // string literal, written by UpdateIdleRegime.
+  uint32_t idle_task_ = 0;
+  bool idle_task_registered_ = false;
+
   static __thread ServerState* state_;
 };
 
@@ -4,6 +4,11 @@
 
 #include "server/set_family.h"
 
+#include <absl/hash/hash.h>
+#include <absl/random/random.h>
+
+#include <memory>
+
 extern "C" {
 #include "redis/intset.h"
 #include "redis/object.h"
@@ -334,17 +339,87 @@ void DiffStrSet(const DbContext& db_context, const SetType& st,
   }
 }
 
-void InterStrSet(const DbContext& db_context, const vector<SetType>& vec, StringVec* result) {
+// Minimal probed set size for which InterStrSet builds a bloom pre-filter.
+constexpr uint32_t kBloomProbeThreshold = 1024;
+
+// Probabilistic pre-filter for repeated membership probes into a large dense set
+// during intersection. A negative answer is definite, so most non-members are
+// rejected with two bit tests instead of a full bucket lookup; positives are
+// confirmed with IsInSet. Sized at roughly 8 bits per member which gives ~5%
+// false positive rate with two probe positions.
+class BloomFilter {
+ public:
+  explicit BloomFilter(StringSet* ss) {
+    size_t nbits = 1024;
+    while (nbits < ss->Size() * 8)
+      nbits *= 2;
+    bits_.resize(nbits / 64);
+    mask_ = nbits - 1;
+    for (sds ptr : *ss) {
+      auto [h1, h2] = Hash(string_view{ptr, sdslen(ptr)});
+      SetBit(h1);
+      SetBit(h2);
+    }
+  }
+
+  bool MayContain(string_view member) const {
+    auto [h1, h2] = Hash(member);
+    return TestBit(h1) && TestBit(h2);
+  }
+
+ private:
+  // Derives two probe positions from a single hash, Kirsch-Mitzenmacher style.
+  static pair<uint64_t, uint64_t> Hash(string_view member) {
+    uint64_t h = absl::Hash<string_view>{}(member);
+    return {h, h + (((h >> 32) | (h << 32)) | 1)};
+  }
+
+  void SetBit(uint64_t h) {
+    h &= mask_;
+    bits_[h >> 6] |= 1ull << (h & 63);
+  }
+
+  bool TestBit(uint64_t h) const {
+    h &= mask_;
+    return (bits_[h >> 6] >> (h & 63)) & 1;
+  }
+
+  vector<uint64_t> bits_;
+  uint64_t mask_;
+};
+
+// limit - stop after that many members were added to result (0 - no limit).
+void InterStrSet(const DbContext& db_context, const vector<SetType>& vec, unsigned limit,
+                 StringVec* result) {
   if (IsDenseEncoding(vec.front())) {
     StringSet* ss = (StringSet*)vec.front().first;
     ss->set_time(MemberTimeSeconds(db_context.time_now_ms));
+
+    // Pre-filter probes into large dense sets. Only worthwhile when the number
+    // of probes (the size of the smallest set) is comparable to the probed set
+    // size, otherwise the O(n) filter build dominates the saved lookups.
+    vector<unique_ptr<BloomFilter>> filters(vec.size());
+    for (size_t j = 1; j < vec.size(); ++j) {
+      if (IsDenseEncoding(vec[j]) && vec[j].first != ss) {
+        StringSet* probed = (StringSet*)vec[j].first;
+        if (probed->Size() >= kBloomProbeThreshold && ss->Size() * 4 >= probed->Size())
+          filters[j].reset(new BloomFilter(probed));
+      }
+    }
+
     for (const sds ptr : *ss) {
+      if (limit && result->size() >= limit)
+        return;
+
       std::string_view str{ptr, sdslen(ptr)};
       size_t j = 1;
       for (j = 1; j < vec.size(); ++j) {
-        if (vec[j].first != ss && !IsInSet(db_context, vec[j], str)) {
+        if (vec[j].first == ss)
+          continue;
+        if (filters[j] && !filters[j]->MayContain(str))
+          break;
+        if (!IsInSet(db_context, vec[j], str))
           break;
-        }
       }
 
       if (j == vec.size()) {
@@ -357,6 +432,9 @@ void InterStrSet(const DbContext& db_context, const vector<SetType>& vec, String
     dictIterator* di = dictGetIterator(ds);
     dictEntry* de = nullptr;
     while ((de = dictNext(di))) {
+      if (limit && result->size() >= limit)
+        break;
+
       size_t j = 1;
       sds key = (sds)de->key;
       string_view member{key, sdslen(key)};
@@ -375,6 +453,53 @@ void InterStrSet(const DbContext& db_context, const vector<SetType>& vec, String
   }
 }
 
+// Intersects two sorted intsets with a galloping merge: for each member of the
+// smaller set the matching position in the larger one is bounded by an
+// exponential search that resumes from the previous match, costing
+// O(n*log(m/n)) overall instead of n independent binary searches.
+// limit - stop after that many members were added to result (0 - no limit).
+void InterIntSets(intset* lhs, intset* rhs, unsigned limit, StringVec* result) {
+  if (intsetLen(lhs) > intsetLen(rhs))
+    swap(lhs, rhs);
+
+  uint32_t rhs_len = intsetLen(rhs);
+  uint32_t lo = 0;
+  int64_t needle, val;
+
+  for (uint32_t i = 0; intsetGet(lhs, i, &needle); ++i) {
+    if (lo >= rhs_len || (limit && result->size() >= limit))
+      return;
+
+    // Exponential search bounds the window that contains the first value
+    // >= needle, a binary search then narrows it down.
+    uint32_t bound = 1;
+    while (lo + bound < rhs_len) {
+      intsetGet(rhs, lo + bound, &val);
+      if (val >= needle)
+        break;
+      bound *= 2;
+    }
+
+    uint32_t right = lo + bound < rhs_len ? lo + bound : rhs_len;
+    while (lo < right) {
+      uint32_t mid = (lo + right) / 2;
+      intsetGet(rhs, mid, &val);
+      if (val < needle)
+        lo = mid + 1;
+      else
+        right = mid;
+    }
+
+    if (lo < rhs_len) {
+      intsetGet(rhs, lo, &val);
+      if (val == needle) {
+        result->push_back(absl::StrCat(needle));
+        ++lo;
+      }
+    }
+  }
+}
+
 StringVec PopStrSet(const DbContext& db_context, unsigned count, const SetType& st) {
   StringVec result;
 
@@ -382,9 +507,11 @@ StringVec PopStrSet(const DbContext& db_context, unsigned count, const SetType&
     StringSet* ss = (StringSet*)st.first;
     ss->set_time(MemberTimeSeconds(db_context.time_now_ms));
 
-    // TODO: this loop is inefficient because Pop searches again and again an occupied bucket.
-    for (unsigned i = 0; i < count && !ss->Empty(); ++i) {
-      result.push_back(ss->Pop().value());
+    // Sample the members first and erase them by value, so that we do not rescan
+    // the occupied prefix of the bucket array for every popped member.
+    ss->Sample(count, [&result](sds ptr) { result.emplace_back(ptr, sdslen(ptr)); });
+    for (const auto& member : result) {
+      CHECK(ss->Erase(member));
     }
   } else {
     DCHECK_EQ(st.second, kEncodingStrMap);
@@ -866,7 +993,11 @@ OpResult<StringVec> OpDiff(const OpArgs& op_args, ArgSlice keys) {
 }
 
 // Read-only OpInter op on sets.
-OpResult<StringVec> OpInter(const Transaction* t, EngineShard* es, bool remove_first) {
+// limit - return at most that many members (0 - no limit). Only valid when the
+// transaction spans a single shard, since a partial per-shard intersection can
+// not be limited before the cross-shard merge.
+OpResult<StringVec> OpInter(const Transaction* t, EngineShard* es, bool remove_first,
+                            unsigned limit = 0) {
   ArgSlice keys = t->GetShardArgs(es->shard_id());
   if (remove_first) {
     keys.remove_prefix(1);
@@ -887,9 +1018,9 @@ OpResult<StringVec> OpInter(const Transaction* t, EngineShard* es, bool remove_f
     }
 
     container_utils::IterateSet(find_res.value()->second,
-                                [&result](container_utils::ContainerEntry ce) {
+                                [&result, limit](container_utils::ContainerEntry ce) {
                                   result.push_back(ce.ToString());
-                                  return true;
+                                  return !(limit && result.size() >= limit);
                                 });
     return result;
   }
@@ -924,11 +1055,19 @@ OpResult<StringVec> OpInter(const Transaction* t, EngineShard* es, bool remove_f
 
   int encoding = sets.front().second;
   if (encoding == kEncodingIntSet) {
+    if (sets.size() == 2 && sets[1].second == kEncodingIntSet) {
+      InterIntSets((intset*)sets[0].first, (intset*)sets[1].first, limit, &result);
+      return result;
+    }
+
     int ii = 0;
     intset* is = (intset*)sets.front().first;
     int64_t intele;
 
     while (intsetGet(is, ii++, &intele)) {
+      if (limit && result.size() >= limit)
+        break;
+
       size_t j = 1;
       for (j = 1; j < sets.size(); j++) {
         if (sets[j].first != is && !IsInSet(t->GetDbContext(), sets[j], intele))
@@ -941,7 +1080,7 @@ OpResult<StringVec> OpInter(const Transaction* t, EngineShard* es, bool remove_f
       }
     }
   } else {
-    InterStrSet(t->GetDbContext(), sets, &result);
+    InterStrSet(t->GetDbContext(), sets, limit, &result);
   }
 
   return result;
@@ -1015,6 +1154,93 @@ OpResult<StringVec> OpPop(const OpArgs& op_args, string_view key, unsigned count
   return result;
 }
 
+// count - how many members to return. If distinct is false the members are drawn
+// independently and may repeat.
+OpResult<StringVec> OpRandMember(const OpArgs& op_args, string_view key, unsigned count,
+                                 bool distinct) {
+  auto& db_slice = op_args.shard->db_slice();
+  OpResult<PrimeIterator> find_res = db_slice.Find(op_args.db_cntx, key, OBJ_SET);
+  if (!find_res)
+    return find_res.status();
+
+  StringVec result;
+  if (count == 0)
+    return result;
+
+  PrimeIterator it = find_res.value();
+  size_t slen = it->second.Size();
+
+  // Asking for at least the whole set of distinct members returns the whole set.
+  if (distinct && count >= slen) {
+    PrimeValue& pv = it->second;
+    if (IsDenseEncoding(pv)) {
+      StringSet* ss = (StringSet*)pv.RObjPtr();
+      ss->set_time(MemberTimeSeconds(op_args.db_cntx.time_now_ms));
+    }
+
+    container_utils::IterateSet(pv, [&result](container_utils::ContainerEntry ce) {
+      result.push_back(ce.ToString());
+      return true;
+    });
+    return result;
+  }
+
+  SetType st{it->second.RObjPtr(), it->second.Encoding()};
+  absl::InsecureBitGen gen;
+
+  if (st.second == kEncodingIntSet) {
+    intset* is = (intset*)st.first;
+    int64_t val = 0;
+    if (distinct) {
+      // count < slen here, and intsets are small - rejection converges quickly.
+      absl::flat_hash_set<uint32_t> picked;
+      while (picked.size() < count) {
+        picked.insert(absl::Uniform<uint32_t>(gen, 0, slen));
+      }
+      for (uint32_t idx : picked) {
+        intsetGet(is, idx, &val);
+        result.push_back(absl::StrCat(val));
+      }
+    } else {
+      for (unsigned i = 0; i < count; ++i) {
+        intsetGet(is, absl::Uniform<uint32_t>(gen, 0, slen), &val);
+        result.push_back(absl::StrCat(val));
+      }
+    }
+  } else if (IsDenseEncoding(st)) {
+    StringSet* ss = (StringSet*)st.first;
+    ss->set_time(MemberTimeSeconds(op_args.db_cntx.time_now_ms));
+
+    auto collect = [&result](sds ptr) { result.emplace_back(ptr, sdslen(ptr)); };
+    if (distinct) {
+      ss->Sample(count, collect);
+    } else {
+      // Every call restarts from a fresh random bucket, so members may repeat.
+      while (result.size() < count && ss->Sample(1, collect) > 0) {
+      }
+    }
+  } else {
+    DCHECK_EQ(st.second, kEncodingStrMap);
+    dict* ds = (dict*)st.first;
+    if (distinct) {
+      std::vector<dictEntry*> entries(count);
+      unsigned picked = dictGetSomeKeys(ds, entries.data(), count);
+      for (unsigned i = 0; i < picked; ++i) {
+        sds mem = (sds)entries[i]->key;
+        result.emplace_back(mem, sdslen(mem));
+      }
+    } else {
+      for (unsigned i = 0; i < count; ++i) {
+        dictEntry* de = dictGetRandomKey(ds);
+        sds mem = (sds)de->key;
+        result.emplace_back(mem, sdslen(mem));
+      }
+    }
+  }
+
+  return result;
+}
+
 OpResult<StringVec> OpScan(const OpArgs& op_args, string_view key, uint64_t* cursor,
                            const ScanOpts& scan_op) {
   OpResult<PrimeIterator> find_res = op_args.shard->db_slice().Find(op_args.db_cntx, key, OBJ_SET);
@@ -1217,6 +1443,43 @@ void SPop(CmdArgList args, ConnectionContext* cntx) {
   (*cntx)->SendError(result.status());
 }
 
+void SRandMember(CmdArgList args, ConnectionContext* cntx) {
+  string_view key = ArgS(args, 0);
+  unsigned count = 1;
+  bool distinct = true;
+  if (args.size() > 1) {
+    string_view arg = ArgS(args, 1);
+    int32_t count_arg = 0;
+    if (!absl::SimpleAtoi(arg, &count_arg)) {
+      (*cntx)->SendError(kInvalidIntErr);
+      return;
+    }
+    distinct = count_arg >= 0;
+    count = distinct ? count_arg : -uint32_t(count_arg);
+  }
+
+  auto cb = [&](Transaction* t, EngineShard* shard) {
+    return OpRandMember(t->GetOpArgs(shard), key, count, distinct);
+  };
+
+  OpResult<StringVec> result = cntx->transaction->ScheduleSingleHopT(std::move(cb));
+  if (result || result.status() == OpStatus::KEY_NOTFOUND) {
+    if (args.size() == 1) {  // SRANDMEMBER key
+      if (result.status() == OpStatus::KEY_NOTFOUND || result->empty()) {
+        (*cntx)->SendNull();
+      } else {
+        DCHECK_EQ(1u, result->size());
+        (*cntx)->SendBulkString(result->front());
+      }
+    } else {  // SRANDMEMBER key count
+      (*cntx)->SendStringArr(*result);
+    }
+    return;
+  }
+
+  (*cntx)->SendError(result.status());
+}
+
 void SDiff(CmdArgList args, ConnectionContext* cntx) {
   ResultStringVec result_set(shard_set->size(), OpStatus::SKIPPED);
   string_view src_key = ArgS(args, 0);
@@ -1341,6 +1604,44 @@ void SInter(CmdArgList args, ConnectionContext* cntx) {
   }
 }
 
+void SInterCard(CmdArgList args, ConnectionContext* cntx) {
+  unsigned num_keys;
+  if (!absl::SimpleAtoi(ArgS(args, 0), &num_keys)) {
+    return (*cntx)->SendError(OpStatus::SYNTAX_ERR);
+  }
+
+  uint64_t limit = 0;
+  if (args.size() == (1 + num_keys + 2) && ArgS(args, 1 + num_keys) == "LIMIT") {
+    if (!absl::SimpleAtoi(ArgS(args, 1 + num_keys + 1), &limit)) {
+      return (*cntx)->SendError("limit value is not a positive integer", kSyntaxErrType);
+    }
+  } else if (args.size() != 1 + num_keys) {
+    return (*cntx)->SendError(kSyntaxErr);
+  }
+
+  ResultStringVec result_set(shard_set->size(), OpStatus::SKIPPED);
+
+  auto cb = [&](Transaction* t, EngineShard* shard) {
+    // The limit can short-circuit the intersection only when all the keys are
+    // routed to a single shard, otherwise a full per-shard result is needed
+    // for the cross-shard merge below.
+    unsigned shard_limit = t->GetUniqueShardCnt() == 1 ? limit : 0;
+    result_set[shard->shard_id()] = OpInter(t, shard, false, shard_limit);
+    return OpStatus::OK;
+  };
+
+  cntx->transaction->ScheduleSingleHop(std::move(cb));
+  OpResult<SvArray> result = InterResultVec(result_set, cntx->transaction->GetUniqueShardCnt());
+  if (!result) {
+    return (*cntx)->SendError(result.status());
+  }
+
+  uint64_t card = result->size();
+  if (limit && card > limit)
+    card = limit;
+  (*cntx)->SendLong(card);
+}
+
 void SInterStore(CmdArgList args, ConnectionContext* cntx) {
   ResultStringVec result_set(shard_set->size(), OpStatus::SKIPPED);
   string_view dest_key = ArgS(args, 0);
@@ -1570,6 +1871,7 @@ void SetFamily::Register(CommandRegistry* registry) {
             << CI{"SDIFFSTORE", CO::WRITE | CO::DENYOOM | CO::NO_AUTOJOURNAL, -3, 1, -1, 1}.HFUNC(
                    SDiffStore)
             << CI{"SINTER", CO::READONLY, -2, 1, -1, 1}.HFUNC(SInter)
+            << CI{"SINTERCARD", CO::READONLY | CO::VARIADIC_KEYS, -3, 2, 2, 1}.HFUNC(SInterCard)
             << CI{"SINTERSTORE", CO::WRITE | CO::DENYOOM | CO::NO_AUTOJOURNAL, -3, 1, -1, 1}.HFUNC(
                    SInterStore)
             << CI{"SMEMBERS", CO::READONLY, 2, 1, 1, 1}.HFUNC(SMembers)
@@ -1579,6 +1881,7 @@ void SetFamily::Register(CommandRegistry* registry) {
             << CI{"SREM", CO::WRITE | CO::FAST | CO::DENYOOM, -3, 1, 1, 1}.HFUNC(SRem)
             << CI{"SCARD", CO::READONLY | CO::FAST, 2, 1, 1, 1}.HFUNC(SCard)
             << CI{"SPOP", CO::WRITE | CO::FAST | CO::NO_AUTOJOURNAL, -2, 1, 1, 1}.HFUNC(SPop)
+            << CI{"SRANDMEMBER", CO::READONLY, -2, 1, 1, 1}.HFUNC(SRandMember)
             << CI{"SUNION", CO::READONLY, -2, 1, -1, 1}.HFUNC(SUnion)
             << CI{"SUNIONSTORE", CO::WRITE | CO::DENYOOM | CO::NO_AUTOJOURNAL, -3, 1, -1, 1}.HFUNC(
                    SUnionStore)
@@ -94,6 +94,29 @@ TEST_F(SetFamilyTest, SInter) {
   EXPECT_THAT(resp, IntArg(0));
 }
 
+TEST_F(SetFamilyTest, SInterCard) {
+  Run({"sadd", "s1", "a", "b", "c", "d"});
+  Run({"sadd", "s2", "c", "d", "e"});
+
+  EXPECT_THAT(Run({"sintercard", "2", "s1", "s2"}), IntArg(2));
+  EXPECT_THAT(Run({"sintercard", "2", "s1", "s2", "LIMIT", "1"}), IntArg(1));
+  EXPECT_THAT(Run({"sintercard", "2", "s1", "s2", "LIMIT", "10"}), IntArg(2));
+  EXPECT_THAT(Run({"sintercard", "1", "s1"}), IntArg(4));
+  EXPECT_THAT(Run({"sintercard", "2", "s1", "nosuchkey"}), IntArg(0));
+
+  // intset encoded sets take the galloping intersection path.
+  Run({"sadd", "i1", "1", "2", "3", "50", "100", "200"});
+  Run({"sadd", "i2", "2", "50", "200", "300"});
+  EXPECT_THAT(Run({"sintercard", "2", "i1", "i2"}), IntArg(3));
+  EXPECT_THAT(Run({"sintercard", "2", "i1", "i2", "LIMIT", "2"}), IntArg(2));
+  auto resp = Run({"sinter", "i1", "i2"});
+  EXPECT_THAT(resp.GetVec(), UnorderedElementsAre("2", "50", "200"));
+
+  EXPECT_THAT(Run({"sintercard", "2", "s1", "s2", "LIMIT", "bla"}),
+              ErrArg("limit value is not a positive integer"));
+  EXPECT_THAT(Run({"sintercard", "2", "s1"}), ErrArg("syntax error"));
+}
+
 TEST_F(SetFamilyTest, SMove) {
   auto resp = Run({"sadd", "a", "1", "2", "3", "4"});
   Run({"sadd", "b", "3", "5", "6", "2"});
@@ -132,6 +155,50 @@ TEST_F(SetFamilyTest, SPop) {
   EXPECT_THAT(resp.GetVec(), IsSubsetOf({"a", "b", "c"}));
 }
 
+TEST_F(SetFamilyTest, SRandMember) {
+  auto resp = Run({"srandmember", "x"});
+  EXPECT_THAT(resp, ArgType(RespExpr::NIL));
+
+  // String encoded sets.
+  Run({"sadd", "x", "a", "b", "c"});
+  resp = Run({"srandmember", "x"});
+  EXPECT_THAT(resp, ArgType(RespExpr::STRING));
+  EXPECT_THAT(resp, testing::AnyOf("a", "b", "c"));
+
+  resp = Run({"srandmember", "x", "2"});
+  ASSERT_THAT(resp, ArrLen(2));
+  EXPECT_THAT(resp.GetVec(), IsSubsetOf({"a", "b", "c"}));
+  EXPECT_NE(resp.GetVec()[0], resp.GetVec()[1]);
+
+  // A distinct count larger than the set returns the whole set.
+  resp = Run({"srandmember", "x", "10"});
+  ASSERT_THAT(resp, ArrLen(3));
+  EXPECT_THAT(resp.GetVec(), UnorderedElementsAre("a", "b", "c"));
+
+  // A negative count may repeat members and returns exactly |count| of them.
+  resp = Run({"srandmember", "x", "-10"});
+  ASSERT_THAT(resp, ArrLen(10));
+  EXPECT_THAT(resp.GetVec(), IsSubsetOf({"a", "b", "c"}));
+
+  // Intset encoded sets.
+  Run({"sadd", "y", "1", "2", "3"});
+  resp = Run({"srandmember", "y", "2"});
+  ASSERT_THAT(resp, ArrLen(2));
+  EXPECT_THAT(resp.GetVec(), IsSubsetOf({"1", "2", "3"}));
+  EXPECT_NE(resp.GetVec()[0], resp.GetVec()[1]);
+
+  resp = Run({"srandmember", "y", "-5"});
+  ASSERT_THAT(resp, ArrLen(5));
+  EXPECT_THAT(resp.GetVec(), IsSubsetOf({"1", "2", "3"}));
+
+  // SRANDMEMBER does not modify the set.
+  resp = Run({"scard", "x"});
+  EXPECT_THAT(resp, IntArg(3));
+
+  resp = Run({"srandmember", "x", "bla"});
+  EXPECT_THAT(resp, ErrArg("not an integer"));
+}
+
 TEST_F(SetFamilyTest, SMIsMember) {
   Run({"sadd", "foo", "a"});
   Run({"sadd", "foo", "b"});
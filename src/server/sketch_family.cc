@@ -0,0 +1,687 @@
+// Copyright 2023, DragonflyDB authors.  All rights reserved.
+// See LICENSE for licensing terms.
+//
+
+#include "server/sketch_family.h"
+
+#include <absl/random/random.h>
+#include <absl/strings/numbers.h>
+#include <absl/strings/str_cat.h>
+#include <xxhash.h>
+
+#include <cmath>
+#include <cstring>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "base/logging.h"
+#include "facade/error.h"
+#include "server/command_registry.h"
+#include "server/conn_context.h"
+#include "server/engine_shard_set.h"
+#include "server/error.h"
+#include "server/transaction.h"
+
+namespace dfly {
+
+using namespace std;
+using namespace facade;
+
+namespace {
+
+constexpr uint32_t kCmsMagic = 0x4b534d43;   // "CMSK"
+constexpr uint32_t kTopkMagic = 0x4b504f54;  // "TOPK"
+
+constexpr uint32_t kMaxSketchWidth = 1 << 20;
+constexpr uint32_t kMaxSketchDepth = 64;
+
+// Count-min sketch layout: header followed by width*depth uint64 counters in
+// row-major order. Kept little-endian in memory; the blob is only interpreted
+// by this file so the layout can stay native.
+struct CmsHeader {
+  uint32_t magic;
+  uint32_t width;
+  uint32_t depth;
+  uint32_t reserved;
+  uint64_t total;  // sum of all increments, reported by CMS.INFO.
+};
+
+static_assert(sizeof(CmsHeader) == 24, "");
+
+// HeavyKeeper layout: header, width*depth cells, then heap_entries serialized
+// entries of the form {uint64 count, uint32 len, char item[len]}.
+struct TopkHeader {
+  uint32_t magic;
+  uint32_t k;
+  uint32_t width;
+  uint32_t depth;
+  uint32_t decay_milli;  // decay base scaled by 1000, e.g. 900 for 0.9.
+  uint32_t heap_entries;
+};
+
+struct TopkCell {
+  uint64_t fingerprint;
+  uint64_t count;
+};
+
+static_assert(sizeof(TopkHeader) == 24, "");
+static_assert(sizeof(TopkCell) == 16, "");
+
+size_t CmsBlobSize(uint32_t width, uint32_t depth) {
+  return sizeof(CmsHeader) + size_t(width) * depth * sizeof(uint64_t);
+}
+
+bool ValidCms(string_view blob) {
+  if (blob.size() < sizeof(CmsHeader))
+    return false;
+  CmsHeader hdr;
+  memcpy(&hdr, blob.data(), sizeof(hdr));
+  return hdr.magic == kCmsMagic && hdr.width > 0 && hdr.depth > 0 &&
+         blob.size() == CmsBlobSize(hdr.width, hdr.depth);
+}
+
+uint64_t SketchHash(string_view item, uint64_t seed) {
+  return XXH3_64bits_withSeed(item.data(), item.size(), seed);
+}
+
+// In-memory representation of the TopK blob, parsed on every operation and
+// serialized back when mutated. Heap entries are not ordered; k is small so
+// linear scans are fine.
+struct TopkSketch {
+  uint32_t k = 0;
+  uint32_t width = 0;
+  uint32_t depth = 0;
+  uint32_t decay_milli = 0;
+  vector<TopkCell> cells;
+  vector<pair<string, uint64_t>> heap;  // item -> estimated count.
+};
+
+optional<TopkSketch> ParseTopk(string_view blob) {
+  if (blob.size() < sizeof(TopkHeader))
+    return nullopt;
+
+  TopkHeader hdr;
+  memcpy(&hdr, blob.data(), sizeof(hdr));
+  if (hdr.magic != kTopkMagic || hdr.width == 0 || hdr.depth == 0 || hdr.k == 0)
+    return nullopt;
+
+  size_t num_cells = size_t(hdr.width) * hdr.depth;
+  size_t offset = sizeof(TopkHeader) + num_cells * sizeof(TopkCell);
+  if (blob.size() < offset || hdr.heap_entries > hdr.k)
+    return nullopt;
+
+  TopkSketch sketch;
+  sketch.k = hdr.k;
+  sketch.width = hdr.width;
+  sketch.depth = hdr.depth;
+  sketch.decay_milli = hdr.decay_milli;
+  sketch.cells.resize(num_cells);
+  memcpy(sketch.cells.data(), blob.data() + sizeof(TopkHeader), num_cells * sizeof(TopkCell));
+
+  for (uint32_t i = 0; i < hdr.heap_entries; ++i) {
+    uint64_t count;
+    uint32_t len;
+    if (blob.size() < offset + sizeof(count) + sizeof(len))
+      return nullopt;
+    memcpy(&count, blob.data() + offset, sizeof(count));
+    offset += sizeof(count);
+    memcpy(&len, blob.data() + offset, sizeof(len));
+    offset += sizeof(len);
+    if (blob.size() < offset + len)
+      return nullopt;
+    sketch.heap.emplace_back(string{blob.substr(offset, len)}, count);
+    offset += len;
+  }
+
+  return offset == blob.size() ? make_optional(std::move(sketch)) : nullopt;
+}
+
+string SerializeTopk(const TopkSketch& sketch) {
+  TopkHeader hdr{kTopkMagic, sketch.k,          sketch.width,
+                 sketch.depth, sketch.decay_milli, uint32_t(sketch.heap.size())};
+
+  string blob;
+  size_t heap_bytes = 0;
+  for (const auto& [item, count] : sketch.heap) {
+    heap_bytes += sizeof(uint64_t) + sizeof(uint32_t) + item.size();
+  }
+  blob.reserve(sizeof(hdr) + sketch.cells.size() * sizeof(TopkCell) + heap_bytes);
+
+  blob.append((const char*)&hdr, sizeof(hdr));
+  blob.append((const char*)sketch.cells.data(), sketch.cells.size() * sizeof(TopkCell));
+  for (const auto& [item, count] : sketch.heap) {
+    uint32_t len = item.size();
+    blob.append((const char*)&count, sizeof(count));
+    blob.append((const char*)&len, sizeof(len));
+    blob.append(item);
+  }
+  return blob;
+}
+
+// Touches the HeavyKeeper cells with the item and returns the estimated count.
+// Cells holding other items decay with probability decay^count and are taken
+// over once their count reaches zero.
+uint64_t TopkTouch(TopkSketch* sketch, string_view item, absl::InsecureBitGen* gen) {
+  const uint64_t fp = SketchHash(item, 0);
+  const double decay = sketch->decay_milli / 1000.0;
+  uint64_t est = 0;
+
+  for (uint32_t a = 0; a < sketch->depth; ++a) {
+    uint64_t bucket = SketchHash(item, a + 1) % sketch->width;
+    TopkCell& cell = sketch->cells[size_t(a) * sketch->width + bucket];
+
+    if (cell.count == 0) {
+      cell.fingerprint = fp;
+      cell.count = 1;
+      est = max<uint64_t>(est, 1);
+    } else if (cell.fingerprint == fp) {
+      ++cell.count;
+      est = max(est, cell.count);
+    } else {
+      double prob = pow(decay, double(cell.count));
+      if (absl::Uniform(*gen, 0.0, 1.0) < prob) {
+        if (--cell.count == 0) {
+          cell.fingerprint = fp;
+          cell.count = 1;
+          est = max<uint64_t>(est, 1);
+        }
+      }
+    }
+  }
+  return est;
+}
+
+uint64_t TopkEstimate(const TopkSketch& sketch, string_view item) {
+  const uint64_t fp = SketchHash(item, 0);
+  uint64_t est = 0;
+  for (uint32_t a = 0; a < sketch.depth; ++a) {
+    uint64_t bucket = SketchHash(item, a + 1) % sketch.width;
+    const TopkCell& cell = sketch.cells[size_t(a) * sketch.width + bucket];
+    if (cell.fingerprint == fp)
+      est = max(est, cell.count);
+  }
+  return est;
+}
+
+// Updates the top-k entry list with (item, est). Returns the expelled item if
+// a weaker entry had to make room, nullopt otherwise.
+optional<string> TopkUpdateHeap(TopkSketch* sketch, string_view item, uint64_t est) {
+  for (auto& [entry, count] : sketch->heap) {
+    if (entry == item) {
+      count = max(count, est);
+      return nullopt;
+    }
+  }
+
+  if (sketch->heap.size() < sketch->k) {
+    sketch->heap.emplace_back(string{item}, est);
+    return nullopt;
+  }
+
+  auto min_it = sketch->heap.begin();
+  for (auto it = next(sketch->heap.begin()); it != sketch->heap.end(); ++it) {
+    if (it->second < min_it->second)
+      min_it = it;
+  }
+
+  if (est <= min_it->second)
+    return nullopt;
+
+  string expelled = std::move(min_it->first);
+  *min_it = {string{item}, est};
+  return expelled;
+}
+
+OpStatus OpTopkReserve(const OpArgs& op_args, string_view key, uint32_t k, uint32_t width,
+                       uint32_t depth, uint32_t decay_milli) {
+  auto& db_slice = op_args.shard->db_slice();
+  auto [it, inserted] = db_slice.AddOrFind(op_args.db_cntx, key);
+  if (!inserted)
+    return OpStatus::KEY_EXISTS;
+
+  TopkSketch sketch;
+  sketch.k = k;
+  sketch.width = width;
+  sketch.depth = depth;
+  sketch.decay_milli = decay_milli;
+  sketch.cells.resize(size_t(width) * depth);
+
+  it->second.SetString(SerializeTopk(sketch));
+  db_slice.PostUpdate(op_args.db_cntx.db_index, it, key, false);
+  return OpStatus::OK;
+}
+
+// For each item returns the expelled entry, or an empty string if nothing was
+// pushed out of the top-k list.
+OpResult<vector<optional<string>>> OpTopkAdd(const OpArgs& op_args, string_view key,
+                                             CmdArgList items) {
+  auto& db_slice = op_args.shard->db_slice();
+  OpResult<PrimeIterator> find_res = db_slice.Find(op_args.db_cntx, key, OBJ_STRING);
+  if (!find_res)
+    return find_res.status();
+
+  PrimeIterator it = find_res.value();
+  string blob;
+  it->second.GetString(&blob);
+
+  optional<TopkSketch> sketch = ParseTopk(blob);
+  if (!sketch)
+    return OpStatus::INVALID_VALUE;
+
+  absl::InsecureBitGen gen;
+  vector<optional<string>> res;
+  res.reserve(items.size());
+  for (auto item_arg : items) {
+    string_view item = facade::ToSV(item_arg);
+    uint64_t est = TopkTouch(&*sketch, item, &gen);
+    res.push_back(TopkUpdateHeap(&*sketch, item, est));
+  }
+
+  db_slice.PreUpdate(op_args.db_cntx.db_index, it);
+  it->second.SetString(SerializeTopk(*sketch));
+  db_slice.PostUpdate(op_args.db_cntx.db_index, it, key, true);
+
+  return res;
+}
+
+OpResult<TopkSketch> OpTopkRead(const OpArgs& op_args, string_view key) {
+  OpResult<PrimeIterator> find_res = op_args.shard->db_slice().Find(op_args.db_cntx, key, OBJ_STRING);
+  if (!find_res)
+    return find_res.status();
+
+  string blob;
+  find_res.value()->second.GetString(&blob);
+  optional<TopkSketch> sketch = ParseTopk(blob);
+  if (!sketch)
+    return OpStatus::INVALID_VALUE;
+  return std::move(*sketch);
+}
+
+OpStatus OpCmsInit(const OpArgs& op_args, string_view key, uint32_t width, uint32_t depth) {
+  auto& db_slice = op_args.shard->db_slice();
+  auto [it, inserted] = db_slice.AddOrFind(op_args.db_cntx, key);
+  if (!inserted)
+    return OpStatus::KEY_EXISTS;
+
+  string blob(CmsBlobSize(width, depth), '\0');
+  CmsHeader hdr{kCmsMagic, width, depth, 0, 0};
+  memcpy(blob.data(), &hdr, sizeof(hdr));
+
+  it->second.SetString(blob);
+  db_slice.PostUpdate(op_args.db_cntx.db_index, it, key, false);
+  return OpStatus::OK;
+}
+
+// pairs - (item, increment) tuples. Returns the updated estimate per item.
+OpResult<vector<uint64_t>> OpCmsIncrBy(const OpArgs& op_args, string_view key,
+                                       const vector<pair<string_view, uint64_t>>& pairs) {
+  auto& db_slice = op_args.shard->db_slice();
+  OpResult<PrimeIterator> find_res = db_slice.Find(op_args.db_cntx, key, OBJ_STRING);
+  if (!find_res)
+    return find_res.status();
+
+  PrimeIterator it = find_res.value();
+  string blob;
+  it->second.GetString(&blob);
+  if (!ValidCms(blob))
+    return OpStatus::INVALID_VALUE;
+
+  CmsHeader hdr;
+  memcpy(&hdr, blob.data(), sizeof(hdr));
+  uint64_t* counters = (uint64_t*)(blob.data() + sizeof(CmsHeader));
+
+  vector<uint64_t> res;
+  res.reserve(pairs.size());
+  for (const auto& [item, incr] : pairs) {
+    uint64_t est = UINT64_MAX;
+    for (uint32_t r = 0; r < hdr.depth; ++r) {
+      uint64_t idx = SketchHash(item, r + 1) % hdr.width;
+      uint64_t& cnt = counters[size_t(r) * hdr.width + idx];
+      cnt += incr;
+      est = min(est, cnt);
+    }
+    hdr.total += incr;
+    res.push_back(est);
+  }
+  memcpy(blob.data(), &hdr, sizeof(hdr));
+
+  db_slice.PreUpdate(op_args.db_cntx.db_index, it);
+  it->second.SetString(blob);
+  db_slice.PostUpdate(op_args.db_cntx.db_index, it, key, true);
+
+  return res;
+}
+
+OpResult<vector<uint64_t>> OpCmsQuery(const OpArgs& op_args, string_view key, CmdArgList items) {
+  OpResult<PrimeIterator> find_res = op_args.shard->db_slice().Find(op_args.db_cntx, key, OBJ_STRING);
+  if (!find_res)
+    return find_res.status();
+
+  string blob;
+  find_res.value()->second.GetString(&blob);
+  if (!ValidCms(blob))
+    return OpStatus::INVALID_VALUE;
+
+  CmsHeader hdr;
+  memcpy(&hdr, blob.data(), sizeof(hdr));
+  const uint64_t* counters = (const uint64_t*)(blob.data() + sizeof(CmsHeader));
+
+  vector<uint64_t> res;
+  res.reserve(items.size());
+  for (auto item_arg : items) {
+    string_view item = facade::ToSV(item_arg);
+    uint64_t est = UINT64_MAX;
+    for (uint32_t r = 0; r < hdr.depth; ++r) {
+      uint64_t idx = SketchHash(item, r + 1) % hdr.width;
+      est = min(est, counters[size_t(r) * hdr.width + idx]);
+    }
+    res.push_back(est);
+  }
+  return res;
+}
+
+OpResult<CmsHeader> OpCmsInfo(const OpArgs& op_args, string_view key) {
+  OpResult<PrimeIterator> find_res = op_args.shard->db_slice().Find(op_args.db_cntx, key, OBJ_STRING);
+  if (!find_res)
+    return find_res.status();
+
+  string blob;
+  find_res.value()->second.GetString(&blob);
+  if (!ValidCms(blob))
+    return OpStatus::INVALID_VALUE;
+
+  CmsHeader hdr;
+  memcpy(&hdr, blob.data(), sizeof(hdr));
+  return hdr;
+}
+
+void SendSketchError(const OpStatus status, ConnectionContext* cntx) {
+  switch (status) {
+    case OpStatus::WRONG_TYPE:
+      (*cntx)->SendError(kWrongTypeErr);
+      break;
+    case OpStatus::INVALID_VALUE:
+      (*cntx)->SendError(SketchFamily::kInvalidSketchErr);
+      break;
+    case OpStatus::KEY_NOTFOUND:
+      (*cntx)->SendError("key does not exist");
+      break;
+    case OpStatus::KEY_EXISTS:
+      (*cntx)->SendError("key already exists");
+      break;
+    default:
+      (*cntx)->SendError(status);
+      break;
+  }
+}
+
+void TopKReserve(CmdArgList args, ConnectionContext* cntx) {
+  string_view key = ArgS(args, 0);
+
+  uint32_t k = 0;
+  if (!absl::SimpleAtoi(ArgS(args, 1), &k) || k == 0)
+    return (*cntx)->SendError(kInvalidIntErr);
+
+  uint32_t width = 8, depth = 7;
+  double decay = 0.9;
+  if (args.size() > 2) {
+    if (args.size() != 5)
+      return (*cntx)->SendError(kSyntaxErr);
+    if (!absl::SimpleAtoi(ArgS(args, 2), &width) || width == 0 || width > kMaxSketchWidth ||
+        !absl::SimpleAtoi(ArgS(args, 3), &depth) || depth == 0 || depth > kMaxSketchDepth)
+      return (*cntx)->SendError(kInvalidIntErr);
+    if (!absl::SimpleAtod(ArgS(args, 4), &decay) || decay <= 0 || decay >= 1)
+      return (*cntx)->SendError("decay must be in (0, 1)", kSyntaxErrType);
+  }
+
+  auto cb = [&](Transaction* t, EngineShard* shard) {
+    return OpTopkReserve(t->GetOpArgs(shard), key, k, width, depth, uint32_t(decay * 1000));
+  };
+
+  OpStatus status = cntx->transaction->ScheduleSingleHop(std::move(cb));
+  if (status == OpStatus::OK)
+    (*cntx)->SendOk();
+  else
+    SendSketchError(status, cntx);
+}
+
+void TopKAdd(CmdArgList args, ConnectionContext* cntx) {
+  string_view key = ArgS(args, 0);
+  args.remove_prefix(1);
+
+  auto cb = [&](Transaction* t, EngineShard* shard) {
+    return OpTopkAdd(t->GetOpArgs(shard), key, args);
+  };
+
+  OpResult<vector<optional<string>>> res = cntx->transaction->ScheduleSingleHopT(std::move(cb));
+  if (!res)
+    return SendSketchError(res.status(), cntx);
+
+  (*cntx)->StartArray(res->size());
+  for (const auto& expelled : *res) {
+    if (expelled)
+      (*cntx)->SendBulkString(*expelled);
+    else
+      (*cntx)->SendNull();
+  }
+}
+
+void TopKCount(CmdArgList args, ConnectionContext* cntx) {
+  string_view key = ArgS(args, 0);
+  args.remove_prefix(1);
+
+  auto cb = [&](Transaction* t, EngineShard* shard) {
+    return OpTopkRead(t->GetOpArgs(shard), key);
+  };
+
+  OpResult<TopkSketch> res = cntx->transaction->ScheduleSingleHopT(std::move(cb));
+  if (!res)
+    return SendSketchError(res.status(), cntx);
+
+  (*cntx)->StartArray(args.size());
+  for (auto item_arg : args) {
+    (*cntx)->SendLong(TopkEstimate(*res, facade::ToSV(item_arg)));
+  }
+}
+
+void TopKQuery(CmdArgList args, ConnectionContext* cntx) {
+  string_view key = ArgS(args, 0);
+  args.remove_prefix(1);
+
+  auto cb = [&](Transaction* t, EngineShard* shard) {
+    return OpTopkRead(t->GetOpArgs(shard), key);
+  };
+
+  OpResult<TopkSketch> res = cntx->transaction->ScheduleSingleHopT(std::move(cb));
+  if (!res)
+    return SendSketchError(res.status(), cntx);
+
+  (*cntx)->StartArray(args.size());
+  for (auto item_arg : args) {
+    string_view item = facade::ToSV(item_arg);
+    bool found = false;
+    for (const auto& [entry, count] : res->heap) {
+      if (entry == item) {
+        found = true;
+        break;
+      }
+    }
+    (*cntx)->SendLong(found ? 1 : 0);
+  }
+}
+
+void TopKList(CmdArgList args, ConnectionContext* cntx) {
+  string_view key = ArgS(args, 0);
+
+  auto cb = [&](Transaction* t, EngineShard* shard) {
+    return OpTopkRead(t->GetOpArgs(shard), key);
+  };
+
+  OpResult<TopkSketch> res = cntx->transaction->ScheduleSingleHopT(std::move(cb));
+  if (!res)
+    return SendSketchError(res.status(), cntx);
+
+  sort(res->heap.begin(), res->heap.end(),
+       [](const auto& l, const auto& r) { return l.second > r.second; });
+
+  (*cntx)->StartArray(res->heap.size());
+  for (const auto& [entry, count] : res->heap) {
+    (*cntx)->SendBulkString(entry);
+  }
+}
+
+void TopKInfo(CmdArgList args, ConnectionContext* cntx) {
+  string_view key = ArgS(args, 0);
+
+  auto cb = [&](Transaction* t, EngineShard* shard) {
+    return OpTopkRead(t->GetOpArgs(shard), key);
+  };
+
+  OpResult<TopkSketch> res = cntx->transaction->ScheduleSingleHopT(std::move(cb));
+  if (!res)
+    return SendSketchError(res.status(), cntx);
+
+  (*cntx)->StartArray(8);
+  (*cntx)->SendBulkString("k");
+  (*cntx)->SendLong(res->k);
+  (*cntx)->SendBulkString("width");
+  (*cntx)->SendLong(res->width);
+  (*cntx)->SendBulkString("depth");
+  (*cntx)->SendLong(res->depth);
+  (*cntx)->SendBulkString("decay");
+  (*cntx)->SendBulkString(absl::StrCat(res->decay_milli / 1000.0));
+}
+
+void CmsInitByDim(CmdArgList args, ConnectionContext* cntx) {
+  string_view key = ArgS(args, 0);
+
+  uint32_t width = 0, depth = 0;
+  if (!absl::SimpleAtoi(ArgS(args, 1), &width) || width == 0 || width > kMaxSketchWidth ||
+      !absl::SimpleAtoi(ArgS(args, 2), &depth) || depth == 0 || depth > kMaxSketchDepth)
+    return (*cntx)->SendError(kInvalidIntErr);
+
+  auto cb = [&](Transaction* t, EngineShard* shard) {
+    return OpCmsInit(t->GetOpArgs(shard), key, width, depth);
+  };
+
+  OpStatus status = cntx->transaction->ScheduleSingleHop(std::move(cb));
+  if (status == OpStatus::OK)
+    (*cntx)->SendOk();
+  else
+    SendSketchError(status, cntx);
+}
+
+void CmsInitByProb(CmdArgList args, ConnectionContext* cntx) {
+  string_view key = ArgS(args, 0);
+
+  double error = 0, probability = 0;
+  if (!absl::SimpleAtod(ArgS(args, 1), &error) || error <= 0 || error >= 1 ||
+      !absl::SimpleAtod(ArgS(args, 2), &probability) || probability <= 0 || probability >= 1)
+    return (*cntx)->SendError("error and probability must be in (0, 1)", kSyntaxErrType);
+
+  uint32_t width = uint32_t(ceil(2.0 / error));
+  uint32_t depth = uint32_t(ceil(log(1.0 / probability)));
+  if (depth == 0)
+    depth = 1;
+  if (width > kMaxSketchWidth || depth > kMaxSketchDepth)
+    return (*cntx)->SendError(kInvalidIntErr);
+
+  auto cb = [&](Transaction* t, EngineShard* shard) {
+    return OpCmsInit(t->GetOpArgs(shard), key, width, depth);
+  };
+
+  OpStatus status = cntx->transaction->ScheduleSingleHop(std::move(cb));
+  if (status == OpStatus::OK)
+    (*cntx)->SendOk();
+  else
+    SendSketchError(status, cntx);
+}
+
+void CmsIncrBy(CmdArgList args, ConnectionContext* cntx) {
+  string_view key = ArgS(args, 0);
+
+  if (args.size() < 3 || args.size() % 2 == 0)
+    return (*cntx)->SendError(kSyntaxErr);
+
+  vector<pair<string_view, uint64_t>> pairs;
+  for (size_t i = 1; i < args.size(); i += 2) {
+    uint64_t incr;
+    if (!absl::SimpleAtoi(ArgS(args, i + 1), &incr))
+      return (*cntx)->SendError(kInvalidIntErr);
+    pairs.emplace_back(ArgS(args, i), incr);
+  }
+
+  auto cb = [&](Transaction* t, EngineShard* shard) {
+    return OpCmsIncrBy(t->GetOpArgs(shard), key, pairs);
+  };
+
+  OpResult<vector<uint64_t>> res = cntx->transaction->ScheduleSingleHopT(std::move(cb));
+  if (!res)
+    return SendSketchError(res.status(), cntx);
+
+  (*cntx)->StartArray(res->size());
+  for (uint64_t est : *res) {
+    (*cntx)->SendLong(est);
+  }
+}
+
+void CmsQuery(CmdArgList args, ConnectionContext* cntx) {
+  string_view key = ArgS(args, 0);
+  args.remove_prefix(1);
+
+  auto cb = [&](Transaction* t, EngineShard* shard) {
+    return OpCmsQuery(t->GetOpArgs(shard), key, args);
+  };
+
+  OpResult<vector<uint64_t>> res = cntx->transaction->ScheduleSingleHopT(std::move(cb));
+  if (!res)
+    return SendSketchError(res.status(), cntx);
+
+  (*cntx)->StartArray(res->size());
+  for (uint64_t est : *res) {
+    (*cntx)->SendLong(est);
+  }
+}
+
+void CmsInfo(CmdArgList args, ConnectionContext* cntx) {
+  string_view key = ArgS(args, 0);
+
+  auto cb = [&](Transaction* t, EngineShard* shard) {
+    return OpCmsInfo(t->GetOpArgs(shard), key);
+  };
+
+  OpResult<CmsHeader> res = cntx->transaction->ScheduleSingleHopT(std::move(cb));
+  if (!res)
+    return SendSketchError(res.status(), cntx);
+
+  (*cntx)->StartArray(6);
+  (*cntx)->SendBulkString("width");
+  (*cntx)->SendLong(res->width);
+  (*cntx)->SendBulkString("depth");
+  (*cntx)->SendLong(res->depth);
+  (*cntx)->SendBulkString("count");
+  (*cntx)->SendLong(res->total);
+}
+
+}  // namespace
+
+void SketchFamily::Register(CommandRegistry* registry) {
+  using CI = CommandId;
+
+  *registry << CI{"TOPK.RESERVE", CO::WRITE | CO::DENYOOM, -3, 1, 1, 1}.SetHandler(TopKReserve)
+            << CI{"TOPK.ADD", CO::WRITE | CO::DENYOOM, -3, 1, 1, 1}.SetHandler(TopKAdd)
+            << CI{"TOPK.COUNT", CO::READONLY, -3, 1, 1, 1}.SetHandler(TopKCount)
+            << CI{"TOPK.QUERY", CO::READONLY, -3, 1, 1, 1}.SetHandler(TopKQuery)
+            << CI{"TOPK.LIST", CO::READONLY, 2, 1, 1, 1}.SetHandler(TopKList)
+            << CI{"TOPK.INFO", CO::READONLY, 2, 1, 1, 1}.SetHandler(TopKInfo)
+            << CI{"CMS.INITBYDIM", CO::WRITE | CO::DENYOOM, 4, 1, 1, 1}.SetHandler(CmsInitByDim)
+            << CI{"CMS.INITBYPROB", CO::WRITE | CO::DENYOOM, 4, 1, 1, 1}.SetHandler(CmsInitByProb)
+            << CI{"CMS.INCRBY", CO::WRITE | CO::DENYOOM, -4, 1, 1, 1}.SetHandler(CmsIncrBy)
+            << CI{"CMS.QUERY", CO::READONLY, -3, 1, 1, 1}.SetHandler(CmsQuery)
+            << CI{"CMS.INFO", CO::READONLY, 2, 1, 1, 1}.SetHandler(CmsInfo);
+}
+
+const char SketchFamily::kInvalidSketchErr[] = "Key is not a valid sketch string value.";
+
+}  // namespace dfly
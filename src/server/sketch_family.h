@@ -0,0 +1,25 @@
+// Copyright 2023, DragonflyDB authors.  All rights reserved.
+// See LICENSE for licensing terms.
+//
+
+#pragma once
+
+/// @brief Implements the probabilistic sketch command families:
+///     TOPK.RESERVE, TOPK.ADD, TOPK.COUNT, TOPK.QUERY, TOPK.LIST, TOPK.INFO
+///     CMS.INITBYDIM, CMS.INITBYPROB, CMS.INCRBY, CMS.QUERY, CMS.INFO
+/// Both sketches are stored as string values with a magic header, similarly to
+/// how HllFamily keeps hyperloglog registers inside strings, so they persist
+/// and replicate like any other string.
+namespace dfly {
+class CommandRegistry;
+
+class SketchFamily {
+ public:
+  /// @brief Register the function that would be called to operate on user commands.
+  /// @param registry The location to which the handling functions would be registered.
+  static void Register(CommandRegistry* registry);
+
+  static const char kInvalidSketchErr[];
+};
+
+}  // namespace dfly
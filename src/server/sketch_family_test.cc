@@ -0,0 +1,114 @@
+// Copyright 2023, DragonflyDB authors.  All rights reserved.
+// See LICENSE for licensing terms.
+//
+
+#include "server/sketch_family.h"
+
+#include "base/gtest.h"
+#include "base/logging.h"
+#include "facade/facade_test.h"
+#include "server/command_registry.h"
+#include "server/test_utils.h"
+
+using namespace testing;
+using namespace std;
+using namespace util;
+
+namespace dfly {
+
+class SketchFamilyTest : public BaseFamilyTest {
+ protected:
+};
+
+TEST_F(SketchFamilyTest, TopKBasic) {
+  EXPECT_EQ(Run({"topk.reserve", "key", "3"}), "OK");
+  EXPECT_THAT(Run({"topk.reserve", "key", "3"}), ErrArg("key already exists"));
+
+  auto resp = Run({"topk.add", "key", "a", "b", "a"});
+  ASSERT_THAT(resp, ArrLen(3));
+
+  EXPECT_EQ(CheckedInt({"topk.count", "key", "a"}), 2);
+  EXPECT_EQ(CheckedInt({"topk.count", "key", "b"}), 1);
+  EXPECT_EQ(CheckedInt({"topk.count", "key", "missing"}), 0);
+
+  resp = Run({"topk.query", "key", "a", "missing"});
+  ASSERT_THAT(resp, ArrLen(2));
+  EXPECT_THAT(resp.GetVec(), ElementsAre(IntArg(1), IntArg(0)));
+}
+
+TEST_F(SketchFamilyTest, TopKList) {
+  EXPECT_EQ(Run({"topk.reserve", "key", "2", "8", "7", "0.9"}), "OK");
+  for (unsigned i = 0; i < 10; ++i)
+    Run({"topk.add", "key", "heavy"});
+  for (unsigned i = 0; i < 5; ++i)
+    Run({"topk.add", "key", "medium"});
+  Run({"topk.add", "key", "light"});
+
+  auto resp = Run({"topk.list", "key"});
+  ASSERT_THAT(resp, ArrLen(2));
+  EXPECT_EQ(resp.GetVec()[0], "heavy");
+  EXPECT_EQ(resp.GetVec()[1], "medium");
+
+  resp = Run({"topk.info", "key"});
+  ASSERT_THAT(resp, ArrLen(8));
+  EXPECT_THAT(resp.GetVec(), ElementsAre("k", IntArg(2), "width", IntArg(8), "depth", IntArg(7),
+                                         "decay", "0.9"));
+}
+
+TEST_F(SketchFamilyTest, TopKErrors) {
+  EXPECT_THAT(Run({"topk.add", "missing", "a"}), ErrArg("key does not exist"));
+  EXPECT_THAT(Run({"topk.reserve", "key", "3", "8", "7"}), ErrArg("syntax error"));
+  EXPECT_THAT(Run({"topk.reserve", "key", "3", "8", "7", "1.5"}), ErrArg("decay"));
+
+  Run({"set", "str", "..."});
+  EXPECT_THAT(Run({"topk.add", "str", "a"}), ErrArg(SketchFamily::kInvalidSketchErr));
+
+  Run({"zadd", "zs", "1", "a"});
+  EXPECT_THAT(Run({"topk.count", "zs", "a"}),
+              ErrArg("Operation against a key holding the wrong kind of value"));
+}
+
+TEST_F(SketchFamilyTest, CmsBasic) {
+  EXPECT_EQ(Run({"cms.initbydim", "key", "100", "5"}), "OK");
+  EXPECT_THAT(Run({"cms.initbydim", "key", "100", "5"}), ErrArg("key already exists"));
+
+  auto resp = Run({"cms.incrby", "key", "a", "10", "b", "3"});
+  ASSERT_THAT(resp, ArrLen(2));
+  EXPECT_THAT(resp.GetVec(), ElementsAre(IntArg(10), IntArg(3)));
+
+  EXPECT_EQ(CheckedInt({"cms.incrby", "key", "a", "5"}), 15);
+
+  // A 100x5 sketch does not collide on two items, so the estimates are exact.
+  resp = Run({"cms.query", "key", "a", "b", "missing"});
+  ASSERT_THAT(resp, ArrLen(3));
+  EXPECT_THAT(resp.GetVec(), ElementsAre(IntArg(15), IntArg(3), IntArg(0)));
+
+  resp = Run({"cms.info", "key"});
+  ASSERT_THAT(resp, ArrLen(6));
+  EXPECT_THAT(resp.GetVec(),
+              ElementsAre("width", IntArg(100), "depth", IntArg(5), "count", IntArg(18)));
+}
+
+TEST_F(SketchFamilyTest, CmsInitByProb) {
+  EXPECT_EQ(Run({"cms.initbyprob", "key", "0.01", "0.01"}), "OK");
+
+  auto resp = Run({"cms.info", "key"});
+  ASSERT_THAT(resp, ArrLen(6));
+  // width = ceil(2 / 0.01), depth = ceil(ln(1 / 0.01)).
+  EXPECT_THAT(resp.GetVec(),
+              ElementsAre("width", IntArg(200), "depth", IntArg(5), "count", IntArg(0)));
+}
+
+TEST_F(SketchFamilyTest, CmsErrors) {
+  EXPECT_THAT(Run({"cms.incrby", "missing", "a", "1"}), ErrArg("key does not exist"));
+  EXPECT_THAT(Run({"cms.query", "missing", "a"}), ErrArg("key does not exist"));
+  EXPECT_THAT(Run({"cms.initbyprob", "key", "2", "0.01"}), ErrArg("must be in"));
+
+  Run({"cms.initbydim", "key", "100", "5"});
+  EXPECT_THAT(Run({"cms.incrby", "key", "a", "1", "b"}), ErrArg("syntax error"));
+
+  Run({"set", "str", "..."});
+  EXPECT_THAT(Run({"cms.query", "str", "a"}), ErrArg(SketchFamily::kInvalidSketchErr));
+}
+
+}  // namespace dfly
@@ -12,12 +12,23 @@ extern "C" {
 #include <absl/strings/match.h>
 #include <absl/strings/str_cat.h>
 
+#include "base/flags.h"
 #include "base/logging.h"
 #include "server/db_slice.h"
 #include "server/engine_shard_set.h"
 #include "server/journal/journal.h"
 #include "server/rdb_extensions.h"
 #include "server/rdb_save.h"
+#include "server/tiered_storage.h"
+
+ABSL_FLAG(uint32_t, serialization_flush_threshold, 1u << 18,  // 256KB
+          "How many bytes to accumulate in the serializer before flushing them further. "
+          "With multi-entry compression this is also the size of a compressed frame, so larger "
+          "values compress better at the cost of more memory buffered per shard.");
+
+ABSL_FLAG(uint32_t, snapshot_txq_throttle_len, 4,
+          "Pause snapshot serialization while more transactions than this are pending in the "
+          "shard queue, giving the cpu back to foreground traffic. 0 disables the throttle.");
 
 namespace dfly {
 
@@ -27,6 +38,15 @@ using namespace chrono_literals;
 
 SliceSnapshot::SliceSnapshot(DbSlice* slice, RecordChannel* dest, CompressionMode compression_mode)
     : db_slice_(slice), dest_(dest), compression_mode_(compression_mode) {
+  flush_threshold_ = absl::GetFlag(FLAGS_serialization_flush_threshold);
+  throttle_txq_len_ = absl::GetFlag(FLAGS_snapshot_txq_throttle_len);
+  db_array_ = slice->databases();
+}
+
+SliceSnapshot::SliceSnapshot(DbSlice* slice, io::Sink* sink, CompressionMode compression_mode)
+    : db_slice_(slice), dest_(nullptr), direct_sink_(sink), compression_mode_(compression_mode) {
+  flush_threshold_ = absl::GetFlag(FLAGS_serialization_flush_threshold);
+  throttle_txq_len_ = absl::GetFlag(FLAGS_snapshot_txq_throttle_len);
   db_array_ = slice->databases();
 }
 
@@ -53,6 +73,8 @@ void SliceSnapshot::Start(bool stream_journal, const Cancellation* cll) {
   snapshot_fb_ = MakeFiber([this, stream_journal, cll] {
     IterateBucketsFb(cll);
     db_slice_->UnregisterOnChange(snapshot_version_);
+    FlushPendingExternal();
+    PushSerializedToChannel(true);
     if (cll->IsCancelled()) {
       Cancel();
     } else if (!stream_journal) {
@@ -71,6 +93,7 @@ void SliceSnapshot::Stop() {
     journal->UnregisterOnChange(journal_cb_id_);
   }
 
+  FlushPendingExternal();
   PushSerializedToChannel(true);
   CloseRecordChannel();
 }
@@ -86,6 +109,10 @@ void SliceSnapshot::Cancel() {
     db_slice_->shard_owner()->journal()->UnregisterOnChange(cb_id);
   }
 
+  // Unblock fibers waiting for the header in direct mode; their writes will
+  // fail against the shut down sink and be recorded in direct_ec_.
+  direct_gate_.Notify();
+
   CloseRecordChannel();
 }
 
@@ -125,6 +152,15 @@ void SliceSnapshot::IterateBucketsFb(const Cancellation* cll) {
     PrimeTable* pt = &db_array_[db_indx]->prime;
     current_db_ = db_indx;
 
+    if (pt->size() > 0) {
+      // Emit a table size hint so that the loader can reserve its tables upfront
+      // instead of growing them incrementally while the file loads.
+      CHECK(!serializer_->SelectDb(db_indx));
+      CHECK(!serializer_->WriteOpcode(RDB_OPCODE_RESIZEDB));
+      CHECK(!serializer_->SaveLen(pt->size()));
+      CHECK(!serializer_->SaveLen(db_array_[db_indx]->expire.size()));
+    }
+
     VLOG(1) << "Start traversing " << pt->size() << " items for index " << db_indx;
     do {
       if (cll->IsCancelled())
@@ -133,8 +169,11 @@ void SliceSnapshot::IterateBucketsFb(const Cancellation* cll) {
       PrimeTable::Cursor next =
           pt->Traverse(cursor, absl::bind_front(&SliceSnapshot::BucketSaveCb, this));
       cursor = next;
+      FlushPendingExternal();
       PushSerializedToChannel(false);
 
+      ThrottleIfNeeded();
+
       if (stats_.loop_serialized >= last_yield + 100) {
         DVLOG(2) << "Before sleep " << ThisFiber::GetName();
         ThisFiber::Yield();
@@ -148,16 +187,40 @@ void SliceSnapshot::IterateBucketsFb(const Cancellation* cll) {
     } while (cursor);
 
     DVLOG(2) << "after loop " << ThisFiber::GetName();
+    FlushPendingExternal();
     PushSerializedToChannel(true);
   }  // for (dbindex)
 
   CHECK(!serialize_bucket_running_);
+  FlushPendingExternal();  // entries deferred by late change callbacks.
   CHECK(!serializer_->SendFullSyncCut());
   PushSerializedToChannel(true);
 
   // serialized + side_saved must be equal to the total saved.
-  VLOG(1) << "Exit SnapshotSerializer (loop_serialized/side_saved/cbcalls): "
-          << stats_.loop_serialized << "/" << stats_.side_saved << "/" << stats_.savecb_calls;
+  VLOG(1) << "Exit SnapshotSerializer (loop_serialized/side_saved/unchanged/cbcalls): "
+          << stats_.loop_serialized << "/" << stats_.side_saved << "/" << stats_.skipped_unchanged
+          << "/" << stats_.savecb_calls << ", throttled " << stats_.throttle_usec << "us";
+}
+
+void SliceSnapshot::ThrottleIfNeeded() {
+  if (throttle_txq_len_ == 0)
+    return;
+
+  // Snapshotting is a background job: while the shard transaction queue is
+  // congested, back off in growing steps so foreground latency recovers. The
+  // total pause per batch is bounded so the snapshot keeps progressing even
+  // under sustained overload.
+  constexpr chrono::microseconds kMaxPause = 10ms;
+
+  TxQueue* txq = db_slice_->shard_owner()->txq();
+  chrono::microseconds step = 100us, total{0};
+  while (txq->size() > throttle_txq_len_ && total < kMaxPause) {
+    ThisFiber::SleepFor(step);
+    total += step;
+    if (step < 1600us)
+      step += step;
+  }
+  stats_.throttle_usec += total.count();
 }
 
 bool SliceSnapshot::BucketSaveCb(PrimeIterator it) {
@@ -186,6 +249,15 @@ unsigned SliceSnapshot::SerializeBucket(DbIndex db_index, PrimeTable::bucket_ite
   FiberAtomicGuard fg;
   DCHECK_LT(it.GetVersion(), snapshot_version_);
 
+  if (it.GetVersion() < delta_from_version_) {
+    // The bucket has not changed since the base snapshot, so its contents at
+    // snapshot time are already covered by the base and do not belong to the
+    // delta. Mark it as covered so that later mutations are chased as usual.
+    it.SetVersion(snapshot_version_);
+    ++stats_.skipped_unchanged;
+    return 0;
+  }
+
   // traverse physical bucket and write it into string file.
   serialize_bucket_running_ = true;
   it.SetVersion(snapshot_version_);
@@ -204,19 +276,66 @@ unsigned SliceSnapshot::SerializeBucket(DbIndex db_index, PrimeTable::bucket_ite
 // from SerializeBucket which should execute atomically.
 void SliceSnapshot::SerializeEntry(DbIndex db_indx, const PrimeKey& pk, const PrimeValue& pv,
                                    optional<uint64_t> expire, RdbSerializer* serializer) {
+  if (slot_filter_) {
+    string tmp;
+    if (!slot_filter_->contains(ClusterConfig::KeySlot(pk.GetSlice(&tmp))))
+      return;
+  }
+
   time_t expire_time = expire.value_or(0);
   if (!expire && pv.HasExpire()) {
     auto eit = db_array_[db_indx]->expire.Find(pk);
     expire_time = db_slice_->ExpireTime(eit);
   }
 
+  if (pv.IsExternal()) {
+    // The disk read would suspend the fiber, so pin the range and defer the read to
+    // FlushPendingExternal. The pin keeps the snapshot-time bytes valid even if the
+    // entry is overwritten before the read happens.
+    auto [offset, size] = pv.GetExternalSlice();
+    db_slice_->shard_owner()->tiered_storage()->Pin(offset);
+    string tmp;
+    pending_external_.push_back(
+        PendingExternal{db_indx, string{pk.GetSlice(&tmp)}, uint64_t(expire_time), offset, size});
+    return;
+  }
+
   io::Result<uint8_t> res = serializer->SaveEntry(pk, pv, expire_time, db_indx);
   CHECK(res);
   ++type_freq_map_[*res];
 }
 
+void SliceSnapshot::FlushPendingExternal() {
+  if (pending_external_.empty())
+    return;
+
+  TieredStorage* tiered = db_slice_->shard_owner()->tiered_storage();
+  string blob;
+  while (!pending_external_.empty()) {
+    PendingExternal pending = std::move(pending_external_.back());
+    pending_external_.pop_back();
+
+    blob.resize(pending.size);
+    // Bypass read cache admission: a snapshot pass touches every cold value once and
+    // should not evict the interactively read ones.
+    error_code ec = tiered->Read(pending.offset, pending.size, blob.data(), false);
+    CHECK(!ec) << "Failed to read tiered value for snapshot: " << ec;
+    tiered->Unpin(pending.offset);
+
+    PrimeKey pk{string_view{pending.key}};
+    PrimeValue pv{string_view{blob}};
+    io::Result<uint8_t> res = serializer_->SaveEntry(pk, pv, pending.expire_ms, pending.db_index);
+    CHECK(res);
+    ++type_freq_map_[*res];
+    ++stats_.tiered_serialized;
+  }
+}
+
 bool SliceSnapshot::PushSerializedToChannel(bool force) {
-  if (!force && serializer_->SerializedLen() < 4096)
+  if (direct_sink_)
+    return PushSerializedToSink(force);
+
+  if (!force && serializer_->SerializedLen() < flush_threshold_)
     return false;
 
   io::StringFile sfile;
@@ -237,6 +356,41 @@ bool SliceSnapshot::PushSerializedToChannel(bool force) {
   return true;
 }
 
+bool SliceSnapshot::PushSerializedToSink(bool force) {
+  if (!force && serializer_->SerializedLen() < flush_threshold_)
+    return false;
+
+  // Hold body bytes back until the owner has written the header.
+  direct_gate_.Wait();
+
+  lock_guard lk(direct_mu_);
+  if (direct_ec_)  // the sink is broken, no point in writing further.
+    return false;
+
+  size_t serialized = serializer_->SerializedLen();
+  if (serialized == 0)
+    return false;
+  stats_.channel_bytes += serialized;
+
+  // The sink is the replica socket (or the target file): the fiber suspends
+  // here while it is not writable, pacing serialization to the consumer.
+  direct_ec_ = serializer_->FlushToSink(direct_sink_);
+
+  VLOG(2) << "PushSerializedToSink " << serialized << " bytes";
+  return true;
+}
+
+std::error_code SliceSnapshot::StreamDirect() {
+  DCHECK(direct_sink_);
+
+  direct_gate_.Notify();
+  direct_done_.Wait();
+  Join();
+
+  lock_guard lk(direct_mu_);
+  return direct_ec_;
+}
+
 void SliceSnapshot::OnDbChange(DbIndex db_index, const DbSlice::ChangeReq& req) {
   FiberAtomicGuard fg;
   PrimeTable* table = db_slice_->GetTables(db_index).first;
@@ -279,7 +433,10 @@ void SliceSnapshot::CloseRecordChannel() {
   // Make sure we close the channel only once with a CAS check.
   bool expected = false;
   if (closed_chan_.compare_exchange_strong(expected, true)) {
-    dest_->StartClosing();
+    if (dest_)
+      dest_->StartClosing();
+    else
+      direct_done_.Notify();
   }
 }
 
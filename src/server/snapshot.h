@@ -9,6 +9,7 @@
 
 #include "base/pod_array.h"
 #include "io/file.h"
+#include "server/cluster/cluster_config.h"
 #include "server/db_slice.h"
 #include "server/rdb_save.h"
 #include "server/table.h"
@@ -55,15 +56,52 @@ class SliceSnapshot {
   using RecordChannel = SimpleChannel<DbRecord, base::mpmc_bounded_queue<DbRecord>>;
 
   SliceSnapshot(DbSlice* slice, RecordChannel* dest, CompressionMode compression_mode);
+
+  // Direct-sink mode: serialized data is flushed straight into sink instead of
+  // being copied through a record channel. The writing fiber suspends while the
+  // sink (i.e. the replica socket) is not writable, which provides natural
+  // backpressure. Body writes are held back until StreamDirect() is called, so
+  // the owner can emit the header into the sink first.
+  SliceSnapshot(DbSlice* slice, io::Sink* sink, CompressionMode compression_mode);
+
   ~SliceSnapshot();
 
   // Initialize snapshot, start bucket iteration fiber, register listeners.
   // In journal streaming mode it needs to be stopped by either Stop or Cancel.
   void Start(bool stream_journal, const Cancellation* cll);
 
+  // Restricts the snapshot to buckets whose version advanced past from_version,
+  // i.e. to the changes done after an earlier snapshot taken by this process
+  // (its snapshot_version() is the watermark). Must be called before Start.
+  // Deletions that happened after the base snapshot are not reflected, so a
+  // delta alone can not be merged onto a base without replaying the journal.
+  void SetDeltaFromVersion(uint64_t from_version) {
+    delta_from_version_ = from_version;
+  }
+
+  // Restricts the snapshot to keys hashing into the given cluster slots, both in the
+  // initial pass and in the change callbacks, so a slot migration streams only the
+  // moved fraction of the shard. Must be called before Start. Journal entries in
+  // streaming mode are not filtered - the consumer filters them at apply time.
+  void SetSlotFilter(SlotSet slots) {
+    slot_filter_ = std::move(slots);
+  }
+
+  // Direct-sink mode: unblock body writes (the header must have been flushed to
+  // the sink by now) and wait until streaming finished - the counterpart of
+  // draining the record channel. Returns the first sink write error, if any.
+  std::error_code StreamDirect();
+
   // Stop snapshot. Only needs to be called for journal streaming mode.
   void Stop();
 
+  // Force-flush whatever is pending in the serializer to the output. Called at
+  // a quiescent point by owners that cut per-consumer streams off a shared pass
+  // (see SnapshotFanout) without stopping it.
+  void FlushPending() {
+    PushSerializedToChannel(true);
+  }
+
   // Wait for iteration fiber to stop.
   void Join();
 
@@ -88,6 +126,11 @@ class SliceSnapshot {
   void SerializeEntry(DbIndex db_index, const PrimeKey& pk, const PrimeValue& pv,
                       std::optional<uint64_t> expire, RdbSerializer* serializer);
 
+  // Reads and serializes entries whose value is offloaded to tiered storage. SerializeEntry
+  // defers them because SSD reads suspend the fiber, which is forbidden inside the atomic
+  // bucket serialization. May suspend on io.
+  void FlushPendingExternal();
+
   // DbChange listener
   void OnDbChange(DbIndex db_index, const DbSlice::ChangeReq& req);
 
@@ -97,11 +140,18 @@ class SliceSnapshot {
   // Close dest channel if not closed yet.
   void CloseRecordChannel();
 
-  // Push serializer's internal buffer to channel.
+  // Push serializer's internal buffer to channel (or the sink in direct mode).
   // Push regardless of buffer size if force is true.
   // Return if pushed.
   bool PushSerializedToChannel(bool force);
 
+  // Direct mode body of PushSerializedToChannel.
+  bool PushSerializedToSink(bool force);
+
+  // Back off while the shard's transaction queue is longer than
+  // --snapshot_txq_throttle_len, trading snapshot speed for foreground latency.
+  void ThrottleIfNeeded();
+
  public:
   uint64_t snapshot_version() const {
     return snapshot_version_;
@@ -119,9 +169,17 @@ class SliceSnapshot {
   DbSlice* db_slice_;
   DbTableArray db_array_;
 
-  RecordChannel* dest_;
+  RecordChannel* dest_;                  // null in direct-sink mode.
   std::atomic_bool closed_chan_{false};  // true if dest_->StartClosing was already called
 
+  // Direct-sink mode state. The mutex serializes flushes from the snapshot
+  // fiber and from journal change callbacks.
+  io::Sink* direct_sink_ = nullptr;
+  Mutex direct_mu_;
+  Done direct_gate_;  // signalled once body writes may go to the sink.
+  Done direct_done_;  // signalled once streaming finished, see CloseRecordChannel.
+  std::error_code direct_ec_;
+
   DbIndex current_db_;
 
   std::unique_ptr<RdbSerializer> serializer_;
@@ -131,17 +189,37 @@ class SliceSnapshot {
   Fiber snapshot_fb_;  // IterateEntriesFb
 
   CompressionMode compression_mode_;
+  uint32_t flush_threshold_;      // cached FLAGS_serialization_flush_threshold.
+  uint32_t throttle_txq_len_;     // cached FLAGS_snapshot_txq_throttle_len.
   RdbTypeFreqMap type_freq_map_;
 
   // version upper bound for entries that should be saved (not included).
   uint64_t snapshot_version_ = 0;
+  // version lower bound for delta snapshots, see SetDeltaFromVersion().
+  uint64_t delta_from_version_ = 0;
+  // set of slots to serialize, see SetSlotFilter().
+  std::optional<SlotSet> slot_filter_;
   uint32_t journal_cb_id_ = 0;
   uint64_t rec_id_ = 0;
 
+  // Entries with offloaded values, pinned in tiered storage until FlushPendingExternal
+  // reads them. Pinning keeps the bytes valid even if the entry is overwritten or deleted
+  // before the deferred read happens.
+  struct PendingExternal {
+    DbIndex db_index;
+    std::string key;
+    uint64_t expire_ms;
+    size_t offset, size;
+  };
+  std::vector<PendingExternal> pending_external_;
+
   struct Stats {
     size_t channel_bytes = 0;
     size_t loop_serialized = 0, skipped = 0, side_saved = 0;
+    size_t skipped_unchanged = 0;  // buckets excluded from a delta snapshot.
+    size_t tiered_serialized = 0;  // offloaded values serialized via FlushPendingExternal.
     size_t savecb_calls = 0;
+    size_t throttle_usec = 0;  // time spent paused by ThrottleIfNeeded.
   } stats_;
 };
 
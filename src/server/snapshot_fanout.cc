@@ -0,0 +1,289 @@
+// Copyright 2023, DragonflyDB authors.  All rights reserved.
+// See LICENSE for licensing terms.
+//
+
+#include "server/snapshot_fanout.h"
+
+#include <absl/strings/str_cat.h>
+
+#include <filesystem>
+
+extern "C" {
+#include "redis/rdb.h"
+}
+
+#include "base/flags.h"
+#include "base/logging.h"
+#include "server/engine_shard_set.h"
+#include "server/journal/journal.h"
+#include "server/rdb_save.h"
+#include "server/snapshot.h"
+
+ABSL_FLAG(bool, replica_snapshot_fanout, false,
+          "Serve concurrent replica full syncs from a single shared snapshot pass per shard. "
+          "The pass spills its frames to a file under --dir and every syncing replica streams "
+          "that file at its own pace, so N simultaneous bootstraps cost one dataset traversal "
+          "at the price of writing the snapshot to disk.");
+
+ABSL_DECLARE_FLAG(std::string, dir);
+ABSL_DECLARE_FLAG(int, compression_mode);
+
+namespace dfly {
+
+using namespace std;
+using namespace util;
+namespace fs = std::filesystem;
+
+namespace {
+
+// The fan-out active on this shard thread, if any. Flows keep it alive via
+// shared ownership; the weak reference only serves discovery by later syncs.
+thread_local std::weak_ptr<SnapshotFanout> tl_fanout;
+
+// Distinguishes spill files when a new pass starts while the previous one is
+// still being torn down.
+thread_local uint32_t tl_spill_seq = 0;
+
+// Same flag mapping RdbSaver applies to single shard replication saves.
+CompressionMode SpillCompressionMode() {
+  switch (absl::GetFlag(FLAGS_compression_mode)) {
+    case 3:
+      return CompressionMode::MULTY_ENTRY_LZ4;
+    case 2:
+      return CompressionMode::MULTY_ENTRY_ZSTD;
+    case 1:
+      return CompressionMode::SINGLE_ENTRY;
+    default:
+      return CompressionMode::NONE;
+  }
+}
+
+}  // namespace
+
+// Sink the shared snapshot flushes into: appends to the spill file, commits
+// the new size and wakes up tailing consumers.
+class SnapshotFanout::SpillSink : public io::Sink {
+ public:
+  explicit SpillSink(SnapshotFanout* owner) : owner_(owner) {
+  }
+
+  io::Result<size_t> WriteSome(const iovec* v, uint32_t len) final {
+    io::Result<size_t> res = owner_->write_file_->WriteSome(v, len);
+    if (res) {
+      owner_->spill_size_ += *res;
+    } else if (!owner_->spill_ec_) {
+      owner_->spill_ec_ = res.error();
+    }
+    owner_->waker_.notifyAll();
+    return res;
+  }
+
+ private:
+  SnapshotFanout* owner_;
+};
+
+struct SnapshotFanout::Consumer {
+  // Engaged by Detach: where this consumer's body ends in the spill and the
+  // journal lsn its stable sync streamer resumes from.
+  std::optional<size_t> cut_bytes;
+  LSN cut_lsn = 0;
+
+  bool cancelled = false;
+};
+
+SnapshotFanout::SnapshotFanout() {
+}
+
+SnapshotFanout::~SnapshotFanout() {
+  DCHECK(consumers_.empty());
+}
+
+bool SnapshotFanout::Enabled() {
+  return absl::GetFlag(FLAGS_replica_snapshot_fanout);
+}
+
+std::shared_ptr<SnapshotFanout> SnapshotFanout::Attach(EngineShard* shard, uint32_t* consumer_id) {
+  shared_ptr<SnapshotFanout> fanout = tl_fanout.lock();
+  if (!fanout || fanout->closed_) {
+    fanout.reset(new SnapshotFanout());
+    if (!fanout->Open(shard))
+      return nullptr;
+    tl_fanout = fanout;
+  }
+
+  *consumer_id = fanout->next_consumer_id_++;
+  fanout->consumers_.emplace(*consumer_id, make_unique<Consumer>());
+
+  VLOG(1) << "Attached consumer " << *consumer_id << " to snapshot fan-out " << fanout->path_;
+  return fanout;
+}
+
+bool SnapshotFanout::Open(EngineShard* shard) {
+  journal_ = shard->journal();
+  DCHECK(journal_);
+
+  fs::path dir = absl::GetFlag(FLAGS_dir);
+  path_ =
+      (dir / absl::StrCat("full-sync-", shard->shard_id(), "-", tl_spill_seq++, ".spill")).string();
+
+  io::Result<io::WriteFile*> wres = io::OpenWrite(path_);
+  if (!wres) {
+    LOG(ERROR) << "Could not open snapshot spill file " << path_ << ": " << wres.error().message();
+    return false;
+  }
+  write_file_.reset(*wres);
+
+  io::Result<io::ReadonlyFile*> rres = io::OpenRead(path_, io::ReadonlyFile::Options{});
+  if (!rres) {
+    LOG(ERROR) << "Could not open snapshot spill file " << path_ << ": " << rres.error().message();
+    write_file_->Close();
+    write_file_.reset();
+    return false;
+  }
+  read_file_.reset(*rres);
+
+  sink_ = make_unique<SpillSink>(this);
+  snapshot_.reset(new SliceSnapshot(&shard->db_slice(), sink_.get(), SpillCompressionMode()));
+  snapshot_->Start(true, &cll_);
+
+  // The spill holds no header, so unblock the snapshot's body writes right away.
+  // StreamDirect also surfaces flush errors raised outside the sink itself.
+  stream_fb_ = MakeFiber([this] {
+    error_code ec = snapshot_->StreamDirect();
+    if (ec && !spill_ec_)
+      spill_ec_ = ec;
+    waker_.notifyAll();
+  });
+
+  VLOG(1) << "Started shared snapshot pass spilling to " << path_;
+  return true;
+}
+
+std::error_code SnapshotFanout::StreamBody(uint32_t consumer_id, io::Sink* dest) {
+  auto it = consumers_.find(consumer_id);
+  CHECK(it != consumers_.end());
+  Consumer* consumer = it->second.get();
+
+  constexpr size_t kReadChunk = 1u << 16;
+  std::unique_ptr<uint8_t[]> buf(new uint8_t[kReadChunk]);
+  size_t offset = 0;
+  error_code ec;
+
+  while (!ec) {
+    waker_.await([&] {
+      return offset < spill_size_ || consumer->cut_bytes || consumer->cancelled || bool(spill_ec_);
+    });
+
+    if (consumer->cancelled) {
+      ec = make_error_code(errc::operation_canceled);
+      break;
+    }
+    if (spill_ec_) {
+      ec = spill_ec_;
+      break;
+    }
+
+    // The cut point is final once set; until then stream up to whatever the
+    // shared pass committed so far. Byte boundaries carry no meaning for the
+    // replica, only the cut has to fall on a serialized frame.
+    size_t limit = consumer->cut_bytes.value_or(spill_size_);
+    while (!ec && offset < limit && !consumer->cancelled) {
+      iovec v{buf.get(), std::min(kReadChunk, limit - offset)};
+      io::Result<size_t> res = read_file_->Read(offset, &v, 1);
+      if (!res) {
+        ec = res.error();
+        break;
+      }
+      CHECK_GT(*res, 0u);  // we never read past the committed spill size.
+      ec = dest->Write(io::Bytes{buf.get(), *res});
+      offset += *res;
+    }
+
+    if (!ec && consumer->cut_bytes && offset == *consumer->cut_bytes)
+      break;
+  }
+
+  if (!ec && consumer->cut_bytes) {
+    // The flow's private tail: its journal cut and the rdb epilog with a zero
+    // checksum, mirroring how RdbSaver ends a private pass. The eof token is
+    // written by the owning fiber.
+    RdbSerializer ser{CompressionMode::NONE};
+    uint8_t checksum[8] = {0};
+    ec = ser.SendJournalOffset(consumer->cut_lsn);
+    if (!ec)
+      ec = ser.WriteOpcode(RDB_OPCODE_EOF);
+    if (!ec)
+      ec = ser.WriteRaw(checksum);
+    if (!ec)
+      ec = ser.FlushToSink(dest);
+  }
+
+  RemoveConsumer(consumer_id);
+  return ec;
+}
+
+void SnapshotFanout::Detach(uint32_t consumer_id) {
+  auto it = consumers_.find(consumer_id);
+  if (it == consumers_.end())  // StreamBody already failed and removed it.
+    return;
+
+  // Wait for the shared bucket iteration to finish - the same wait a private
+  // pass performs when stopped - and flush journal entries still buffered below
+  // the flush threshold. The caller's guard blocks journal writes, so the spill
+  // end captured below is a stable frame boundary.
+  snapshot_->Join();
+  snapshot_->FlushPending();
+
+  it->second->cut_bytes = spill_size_;
+  it->second->cut_lsn = journal_->GetLsn();
+  waker_.notifyAll();
+}
+
+void SnapshotFanout::CancelConsumer(uint32_t consumer_id) {
+  auto it = consumers_.find(consumer_id);
+  if (it == consumers_.end())  // StreamBody already finished and removed it.
+    return;
+
+  it->second->cancelled = true;
+  waker_.notifyAll();
+}
+
+void SnapshotFanout::RemoveConsumer(uint32_t consumer_id) {
+  auto it = consumers_.find(consumer_id);
+  CHECK(it != consumers_.end());
+  bool clean = it->second->cut_bytes.has_value() && !it->second->cancelled;
+  consumers_.erase(it);
+
+  if (!consumers_.empty())
+    return;
+
+  // The last consumer is gone: stop the shared pass. Mark the fan-out closed
+  // first so that a sync arriving while we block below starts a fresh one.
+  closed_ = true;
+
+  if (clean) {
+    // Iteration was joined by Detach. Stop unregisters the journal listener and
+    // flushes its own tail into the spill, which no consumer reads anymore.
+    snapshot_->Stop();
+  } else {
+    cll_.Cancel();
+    snapshot_->Cancel();
+    snapshot_->Join();
+  }
+  stream_fb_.JoinIfNeeded();
+  snapshot_.reset();
+
+  read_file_->Close();
+  read_file_.reset();
+  write_file_->Close();
+  write_file_.reset();
+
+  error_code fs_ec;
+  fs::remove(path_, fs_ec);
+  LOG_IF(WARNING, fs_ec) << "Could not remove snapshot spill file " << path_ << ": "
+                         << fs_ec.message();
+
+  VLOG(1) << "Snapshot fan-out " << path_ << " stopped";
+}
+
+}  // namespace dfly
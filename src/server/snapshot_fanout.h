@@ -0,0 +1,106 @@
+// Copyright 2023, DragonflyDB authors.  All rights reserved.
+// See LICENSE for licensing terms.
+//
+
+#pragma once
+
+#include <absl/container/flat_hash_map.h>
+
+#include <memory>
+#include <optional>
+#include <string>
+
+#include "io/file.h"
+#include "io/io.h"
+#include "server/common.h"
+
+namespace dfly {
+
+class EngineShard;
+class SliceSnapshot;
+
+namespace journal {
+class Journal;
+}  // namespace journal
+
+// Shares one snapshot serialization pass of a shard between all replicas that
+// full-sync concurrently. The pass appends its frames to a spill file under
+// --dir and every attached flow streams that file to its own socket at its own
+// pace, so N simultaneous replica bootstraps cost a single dataset traversal.
+// A slow replica simply lags behind inside the file - the producer never
+// blocks on a consumer.
+//
+// The spill holds only the shared body: the per-flow rdb header stays with the
+// flow (scripts may change between two replicas attaching), and so do the tail
+// markers. When a flow transitions to stable sync it is detached under the
+// STARTSTABLE transaction guard: its stream is cut at the current spill end,
+// followed by the flow's own journal offset and the rdb epilog, exactly like a
+// private snapshot pass would end. The shared pass stops once the last
+// consumer detached.
+//
+// All methods run on the owning shard's thread.
+class SnapshotFanout {
+ public:
+  ~SnapshotFanout();
+
+  // Whether --replica_snapshot_fanout is enabled.
+  static bool Enabled();
+
+  // Returns the shard's active fan-out, starting a fresh shared pass (and spill
+  // file) if there is none. The shard's journal must already be started. Fills
+  // consumer_id with the handle for the other calls. Returns null if the spill
+  // file could not be opened, in which case the caller falls back to a private
+  // snapshot pass.
+  static std::shared_ptr<SnapshotFanout> Attach(EngineShard* shard, uint32_t* consumer_id);
+
+  // Streams the shared body into dest: the spill file from offset 0 up to the
+  // cut point set by Detach, followed by the consumer's journal offset and the
+  // rdb epilog. Tails the spill while the shared pass appends to it. Blocks
+  // until detached or cancelled; runs in the flow's full sync fiber.
+  std::error_code StreamBody(uint32_t consumer_id, io::Sink* dest);
+
+  // Cuts the consumer's stream at the current spill end and journal lsn. Must
+  // run with journal writes blocked (under the STARTSTABLE transaction guard):
+  // the cut is then a frame boundary and no entry can slip in between the
+  // captured lsn and the streamer the caller starts next. Waits for the shared
+  // bucket iteration to finish, like stopping a private pass would.
+  void Detach(uint32_t consumer_id);
+
+  // Unblocks the consumer's StreamBody without a clean cut. Used on
+  // cancellation paths, after shutting down the destination socket.
+  void CancelConsumer(uint32_t consumer_id);
+
+  // Erases a consumer that never entered StreamBody (e.g. its header write
+  // failed); StreamBody removes its consumer by itself. The last consumer to
+  // leave stops the shared pass and removes the spill file.
+  void RemoveConsumer(uint32_t consumer_id);
+
+ private:
+  class SpillSink;
+  struct Consumer;
+
+  SnapshotFanout();
+
+  // Opens the spill file and starts the shared snapshot pass.
+  bool Open(EngineShard* shard);
+
+  std::unique_ptr<SpillSink> sink_;
+  std::unique_ptr<io::WriteFile> write_file_;
+  std::unique_ptr<io::ReadonlyFile> read_file_;
+  std::string path_;
+
+  std::unique_ptr<SliceSnapshot> snapshot_;
+  Fiber stream_fb_;  // unblocks the snapshot's direct-sink gate, see Open().
+  Cancellation cll_;
+  journal::Journal* journal_ = nullptr;
+
+  absl::flat_hash_map<uint32_t, std::unique_ptr<Consumer>> consumers_;
+  uint32_t next_consumer_id_ = 0;
+
+  size_t spill_size_ = 0;      // bytes committed to the spill file.
+  std::error_code spill_ec_;   // first spill write error, fails all consumers.
+  EventCount waker_;           // notified when any of the above change.
+  bool closed_ = false;        // the pass stopped; new syncs start a fresh one.
+};
+
+}  // namespace dfly
@@ -329,26 +329,36 @@ int StreamAppendItem(stream* s, CmdArgList fields, streamID* added_id, streamID*
   }
 
   /* Add the new entry. */
-  raxIterator ri;
-  raxStart(&ri, s->rax_tree);
-  raxSeek(&ri, "$", NULL, 0);
-
   size_t lp_bytes = 0;      /* Total bytes in the tail listpack. */
   unsigned char* lp = NULL; /* Tail listpack pointer. */
 
-  if (!raxEOF(&ri)) {
-    /* Get a reference to the tail node listpack. */
-    lp = (uint8_t*)ri.data;
-    lp_bytes = lpBytes(lp);
-  }
-  raxStop(&ri);
-
   /* We have to add the key into the radix tree in lexicographic order,
    * to do so we consider the ID as a single 128 bit number written in
    * big endian, so that the most significant bytes are the first ones. */
   uint8_t rax_key[16]; /* Key in the radix tree containing the listpack.*/
   streamID master_id;  /* ID of the master entry in the listpack. */
 
+  /* Appends dominate stream workloads, so the tail node is cached in the stream
+   * struct. On a hit we skip seeking the end of the radix tree altogether. */
+  unsigned char* stored_lp = NULL; /* Tail pointer as currently stored in the rax. */
+  if (s->tail_valid) {
+    lp = stored_lp = s->tail_lp;
+    memcpy(rax_key, s->tail_rax_key, sizeof(rax_key));
+    lp_bytes = lpBytes(lp);
+  } else {
+    raxIterator ri;
+    raxStart(&ri, s->rax_tree);
+    raxSeek(&ri, "$", NULL, 0);
+    if (!raxEOF(&ri)) {
+      /* Get a reference to the tail node listpack. */
+      serverAssert(ri.key_len == sizeof(rax_key));
+      lp = stored_lp = (uint8_t*)ri.data;
+      memcpy(rax_key, ri.key, sizeof(rax_key));
+      lp_bytes = lpBytes(lp);
+    }
+    raxStop(&ri);
+  }
+
   /* Create a new listpack and radix tree node if needed. Note that when
    * a new listpack is created, we populate it with a "master entry". This
    * is just a set of fields that is taken as references in order to compress
@@ -397,8 +407,8 @@ int StreamAppendItem(stream* s, CmdArgList fields, streamID* added_id, streamID*
       if (count >= kStreamNodeMaxEntries) {
         /* Shrink extra pre-allocated memory */
         lp = lpShrinkToFit(lp);
-        if (ri.data != lp)
-          raxInsert(s->rax_tree, ri.key, ri.key_len, lp, NULL);
+        if (stored_lp != lp)
+          raxInsert(s->rax_tree, (unsigned char*)&rax_key, sizeof(rax_key), lp, NULL);
         lp = NULL;
       }
     }
@@ -428,13 +438,11 @@ int StreamAppendItem(stream* s, CmdArgList fields, streamID* added_id, streamID*
     }
     lp = lpAppendInteger(lp, 0); /* Master entry zero terminator. */
     raxInsert(s->rax_tree, (unsigned char*)&rax_key, sizeof(rax_key), lp, NULL);
+    stored_lp = lp;
     /* The first entry we insert, has obviously the same fields of the
      * master entry. */
     flags |= STREAM_ITEM_FLAG_SAMEFIELDS;
   } else {
-    serverAssert(ri.key_len == sizeof(rax_key));
-    memcpy(rax_key, ri.key, sizeof(rax_key));
-
     /* Read the master ID from the radix tree key. */
     streamDecodeID(rax_key, &master_id);
     unsigned char* lp_ele = lpFirst(lp);
@@ -512,8 +520,14 @@ int StreamAppendItem(stream* s, CmdArgList fields, streamID* added_id, streamID*
   lp = lpAppendInteger(lp, lp_count);
 
   /* Insert back into the tree in order to update the listpack pointer. */
-  if (ri.data != lp)
+  if (stored_lp != lp)
     raxInsert(s->rax_tree, (unsigned char*)&rax_key, sizeof(rax_key), lp, NULL);
+
+  /* Remember the tail node for the next append. */
+  s->tail_lp = lp;
+  memcpy(s->tail_rax_key, rax_key, sizeof(rax_key));
+  s->tail_valid = 1;
+
   s->length++;
   s->entries_added++;
   s->last_id = id;
@@ -8,6 +8,7 @@ extern "C" {
 #include "redis/object.h"
 }
 
+#include <absl/container/fixed_array.h>
 #include <absl/container/inlined_vector.h>
 #include <double-conversion/string-to-double.h>
 
@@ -17,6 +18,7 @@ extern "C" {
 #include <cstdint>
 #include <tuple>
 
+#include "base/flags.h"
 #include "base/logging.h"
 #include "redis/util.h"
 #include "server/command_registry.h"
@@ -29,6 +31,11 @@ extern "C" {
 #include "server/transaction.h"
 #include "util/varz.h"
 
+ABSL_FLAG(bool, mget_dirty_read, false,
+          "If true, MGET reads each shard directly without scheduling a transaction or acquiring "
+          "key locks. Reduces latency for read-mostly workloads, but keys fetched by a single "
+          "MGET are not guaranteed to be mutually consistent.");
+
 namespace dfly {
 
 namespace {
@@ -139,10 +146,24 @@ OpResult<string> OpGetRange(const OpArgs& op_args, string_view key, int32_t star
   if (size_t(end) >= strlen)
     end = strlen - 1;
 
+  size_t len = size_t(end) - size_t(start) + 1;
+
+  if (co.IsExternal()) {
+    // Pull only the addressed range from the backing file instead of materializing the
+    // whole blob just to copy a slice out of it.
+    auto [offset, size] = co.GetExternalSlice();
+    DCHECK_LE(size_t(start) + len, size);
+
+    string res(len, '\0');
+    error_code ec = op_args.shard->tiered_storage()->ReadRange(offset, start, len, res.data());
+    CHECK(!ec) << "TBD: " << ec;
+    return res;
+  }
+
   string tmp;
   string_view slice = GetSlice(op_args.shard, co, &tmp);
 
-  return string(slice.substr(start, end - start + 1));
+  return string(slice.substr(start, len));
 };
 
 size_t ExtendExisting(const OpArgs& op_args, PrimeIterator it, string_view key, string_view val,
@@ -192,8 +213,12 @@ OpResult<bool> ExtendOrSkip(const OpArgs& op_args, string_view key, string_view
   return ExtendExisting(op_args, *it_res, key, val, prepend);
 }
 
+// If pinned_external is provided and the value is offloaded, the disk read is skipped:
+// the (offset, size) of the value is returned there instead, pinned in TieredStorage, and
+// the caller is responsible to read it after the hop and to unpin it.
 OpResult<string> OpGet(const OpArgs& op_args, string_view key, bool del_hit = false,
-                       const DbSlice::ExpireParams& exp_params = {}) {
+                       const DbSlice::ExpireParams& exp_params = {},
+                       optional<pair<size_t, size_t>>* pinned_external = nullptr) {
   /*Get primeIterator and ExpireIterator at the same time*/
   auto [it, it_expire] = op_args.shard->db_slice().FindExt(op_args.db_cntx, key);
 
@@ -217,7 +242,15 @@ OpResult<string> OpGet(const OpArgs& op_args, string_view key, bool del_hit = fa
   }
 
   /*Get value before expire*/
-  string ret_val = GetString(op_args.shard, pv);
+  string ret_val;
+  if (pinned_external && pv.IsExternal()) {
+    // Pin the range instead of reading it here, so the SSD access does not hold up
+    // the transaction queue behind this hop.
+    *pinned_external = pv.GetExternalSlice();
+    op_args.shard->tiered_storage()->Pin(pinned_external->value().first);
+  } else {
+    ret_val = GetString(op_args.shard, pv);
+  }
 
   if (exp_params.IsDefined()) {
     DVLOG(1) << "Expire: " << key;
@@ -517,6 +550,20 @@ OpResult<optional<string>> SetCmd::Set(const SetParams& params, string_view key,
 
   VLOG(2) << "Set " << key << "(" << db_slice.shard_id() << ") ";
 
+  if (params.expected_ver) {
+    // Memcached CAS: only overwrite an existing entry whose version is unchanged since the
+    // client fetched it with gets/gats. We rely on the dash bucket versions that are bumped
+    // on every update, so a cas may spuriously fail when a neighboring entry in the same
+    // bucket changed - safe, since the client retries with a fresh gets.
+    auto [it, e_it] = db_slice.FindExt(op_args_.db_cntx, key);
+    if (!IsValid(it))
+      return OpStatus::KEY_NOTFOUND;
+    if (it.GetVersion() != params.expected_ver)
+      return OpStatus::KEY_EXISTS;
+
+    return std::move(result_builder).Return(SetExisting(params, it, e_it, key, value));
+  }
+
   if (params.IsConditionalSet()) {
     const auto [it, expire_it] = db_slice.FindExt(op_args_.db_cntx, key);
     if (IsValid(it)) {
@@ -682,6 +729,7 @@ void StringFamily::Set(CmdArgList args, ConnectionContext* cntx) {
 
   SetCmd::SetParams sparams;
   sparams.memcache_flags = cntx->conn_state.memcache_flag;
+  sparams.expected_ver = cntx->conn_state.memcache_cas;
 
   int64_t int_arg;
   SinkReplyBuilder* builder = cntx->reply_builder();
@@ -766,6 +814,15 @@ void StringFamily::Set(CmdArgList args, ConnectionContext* cntx) {
     return builder->SendError(kOutOfMemory);
   }
 
+  // Memcached CAS outcomes, reachable only when expected_ver was set by DispatchMC.
+  if (result == OpStatus::KEY_NOTFOUND || result == OpStatus::KEY_EXISTS) {
+    DCHECK(cntx->protocol() == facade::Protocol::MEMCACHE);
+    auto* mc_builder = static_cast<facade::MCReplyBuilder*>(builder);
+    if (result == OpStatus::KEY_NOTFOUND)
+      return mc_builder->SendNotFound();
+    return mc_builder->SendSimpleString("EXISTS");
+  }
+
   CHECK_EQ(result, OpStatus::SKIPPED);  // in case of NX option
 
   builder->SendSetSkipped();
@@ -807,12 +864,48 @@ void StringFamily::Get(CmdArgList args, ConnectionContext* cntx) {
 
   string_view key = ArgS(args, 0);
 
-  auto cb = [&](Transaction* t, EngineShard* shard) { return OpGet(t->GetOpArgs(shard), key); };
+  // If the client enabled CLIENT TRACKING, register the key on the shard so that a later
+  // write pushes an invalidation message. Squashed pipeline commands have no owner
+  // connection to push to and are skipped.
+  const bool do_track = cntx->conn_state.tracking_info && cntx->owner() != nullptr;
+
+  // Filled if the value is offloaded: the hop above only pins its range, and the actual
+  // disk read runs below, outside the transaction queue.
+  optional<pair<size_t, size_t>> external;
+
+  auto cb = [&](Transaction* t, EngineShard* shard) {
+    auto res = OpGet(t->GetOpArgs(shard), key, false, {}, &external);
+    if (do_track)
+      shard->db_slice().TrackKey(t->GetDbIndex(), key, cntx);
+    return res;
+  };
 
   DVLOG(1) << "Before Get::ScheduleSingleHopT " << key;
   Transaction* trans = cntx->transaction;
   OpResult<string> result = trans->ScheduleSingleHopT(std::move(cb));
 
+  if (result && external) {
+    size_t offset = external->first;
+    size_t len = external->second;
+    result->resize(len);
+
+    // The read must be submitted from the shard thread owning the backing file. Only the
+    // submission runs on the shard queue - it does not suspend, so other transactions on
+    // that shard proceed while this fiber waits for the io completion.
+    error_code ec;
+    Done done;
+    shard_set->Add(Shard(key, shard_set->size()), [&] {
+      TieredStorage* tiered = EngineShard::tlocal()->tiered_storage();
+      tiered->ReadAsync(offset, len, result->data(), [&, tiered](error_code res_ec) {
+        tiered->Unpin(offset);
+        ec = res_ec;
+        done.Notify();
+      });
+    });
+    done.Wait();
+    CHECK(!ec) << "TBD: " << ec;
+  }
+
   if (result) {
     DVLOG(1) << "GET " << trans->DebugId() << ": " << key << " " << result.value();
     (*cntx)->SendBulkString(*result);
@@ -933,8 +1026,9 @@ void StringFamily::GetEx(CmdArgList args, ConnectionContext* cntx) {
     auto op_args = t->GetOpArgs(shard);
     auto result = OpGet(op_args, key, false, exp_params);
 
-    // Replicate GETEX as PEXPIREAT or PERSIST
-    if (result.ok() && shard->journal()) {
+    // Replicate GETEX as PEXPIREAT or PERSIST. A plain GETEX without options
+    // does not touch the expiry and must not be journaled at all.
+    if (result.ok() && exp_params.IsDefined() && shard->journal()) {
       if (exp_params.persist) {
         RecordJournal(op_args, "PERSIST", {key});
       } else {
@@ -1139,18 +1233,40 @@ void StringFamily::MGet(CmdArgList args, ConnectionContext* cntx) {
   bool fetch_mcflag = cntx->protocol() == Protocol::MEMCACHE;
   bool fetch_mcver =
       fetch_mcflag && (dfly_cntx->conn_state.memcache_flag & ConnectionState::FETCH_CAS_VER);
+  optional<uint32_t> touch_exp_sec =
+      fetch_mcflag ? dfly_cntx->conn_state.memcache_touch_sec : nullopt;
+
+  if (absl::GetFlag(FLAGS_mget_dirty_read)) {
+    // Relaxed mode: we do not schedule a transaction and fetch from each shard directly via its
+    // task queue, so every shard answers at whatever version it currently has. The transaction
+    // object is only used for its per-shard key partitioning.
+    DbContext db_cntx{.db_index = cntx->conn_state.db_index, .time_now_ms = GetCurrentTimeMs()};
+    BlockingCounter bc{0};
+    for (ShardId sid = 0; sid < shard_count; ++sid) {
+      if (!transaction->IsActive(sid))
+        continue;
 
-  auto cb = [&](Transaction* t, EngineShard* shard) {
-    ShardId sid = shard->shard_id();
-    mget_resp[sid] = OpMGet(fetch_mcflag, fetch_mcver, t, shard);
-    return OpStatus::OK;
-  };
+      bc.Add(1);
+      shard_set->Add(sid, [&, sid, bc]() mutable {
+        mget_resp[sid] = OpMGet(fetch_mcflag, fetch_mcver, touch_exp_sec,
+                                OpArgs{EngineShard::tlocal(), transaction, db_cntx});
+        bc.Dec();
+      });
+    }
+    bc.Wait();
+  } else {
+    auto cb = [&](Transaction* t, EngineShard* shard) {
+      mget_resp[shard->shard_id()] =
+          OpMGet(fetch_mcflag, fetch_mcver, touch_exp_sec, t->GetOpArgs(shard));
+      return OpStatus::OK;
+    };
 
-  // MGet requires locking as well. For example, if coordinator A applied W(x) and then W(y)
-  // it necessarily means that whoever observed y, must observe x.
-  // Without locking, mget x y could read stale x but latest y.
-  OpStatus result = transaction->ScheduleSingleHop(std::move(cb));
-  CHECK_EQ(OpStatus::OK, result);
+    // MGet requires locking as well. For example, if coordinator A applied W(x) and then W(y)
+    // it necessarily means that whoever observed y, must observe x.
+    // Without locking, mget x y could read stale x but latest y.
+    OpStatus result = transaction->ScheduleSingleHop(std::move(cb));
+    CHECK_EQ(OpStatus::OK, result);
+  }
 
   // reorder the responses back according to the order of their corresponding keys.
   vector<SinkReplyBuilder::OptResp> res(args.size());
@@ -1321,25 +1437,54 @@ void StringFamily::SetRange(CmdArgList args, ConnectionContext* cntx) {
   }
 }
 
-auto StringFamily::OpMGet(bool fetch_mcflag, bool fetch_mcver, const Transaction* t,
-                          EngineShard* shard) -> MGetResponse {
-  auto args = t->GetShardArgs(shard->shard_id());
+auto StringFamily::OpMGet(bool fetch_mcflag, bool fetch_mcver, optional<uint32_t> touch_exp_sec,
+                          const OpArgs& op_args) -> MGetResponse {
+  EngineShard* shard = op_args.shard;
+  auto args = op_args.tx->GetShardArgs(shard->shard_id());
   DCHECK(!args.empty());
 
   MGetResponse response(args.size());
 
   auto& db_slice = shard->db_slice();
+
+  // Resolve all keys with a single prefetch-pipelined pass over the prime table.
+  absl::FixedArray<pair<PrimeIterator, ExpireIterator>, 8> lookup(args.size());
+  db_slice.FindExtBatch(op_args.db_cntx, args, absl::MakeSpan(lookup));
+
   for (size_t i = 0; i < args.size(); ++i) {
-    OpResult<PrimeIterator> it_res = db_slice.Find(t->GetDbContext(), args[i], OBJ_STRING);
-    if (!it_res)
+    const PrimeIterator& it = lookup[i].first;
+    if (!IsValid(it) || it->second.ObjType() != OBJ_STRING)
       continue;
 
-    const PrimeIterator& it = *it_res;
+    if (touch_exp_sec) {
+      // Memcached GAT/GATS: refresh the expiry before reading; 0 removes it.
+      DbSlice::ExpireParams exp_params;
+      if (*touch_exp_sec == 0) {
+        exp_params.persist = true;
+      } else {
+        exp_params.value = *touch_exp_sec;
+      }
+
+      auto exp_res = db_slice.UpdateExpire(op_args.db_cntx, it, lookup[i].second, exp_params);
+      if (!exp_res || *exp_res == -1)  // the touch expired the entry.
+        continue;
+
+      // Replicate the touch the same way GETEX does.
+      if (shard->journal()) {
+        if (exp_params.persist) {
+          RecordJournal(op_args, "PERSIST", {args[i]});
+        } else {
+          auto abs_time_str = absl::StrCat(*exp_res);
+          RecordJournal(op_args, "PEXPIREAT", {args[i], abs_time_str});
+        }
+      }
+    }
+
     auto& dest = response[i].emplace();
 
     dest.value = GetString(shard, it->second);
     if (fetch_mcflag) {
-      dest.mc_flag = db_slice.GetMCFlag(t->GetDbIndex(), it->first);
+      dest.mc_flag = db_slice.GetMCFlag(op_args.db_cntx.db_index, it->first);
       if (fetch_mcver) {
         dest.mc_ver = it.GetVersion();
       }
@@ -39,6 +39,10 @@ class SetCmd {
     uint16_t memcache_flags = 0;
     // Relative value based on now. 0 means no expiration.
     uint64_t expire_after_ms = 0;
+
+    // Memcached CAS: when positive, the set succeeds only if the entry exists and its
+    // version equals this value (as returned by gets/gats).
+    uint64_t expected_ver = 0;
     mutable std::optional<std::string>* prev_val = nullptr;  // GETSET option
 
     constexpr bool IsConditionalSet() const {
@@ -104,8 +108,11 @@ class StringFamily {
   };
 
   using MGetResponse = std::vector<std::optional<GetResp>>;
-  static MGetResponse OpMGet(bool fetch_mcflag, bool fetch_mcver, const Transaction* t,
-                             EngineShard* shard);
+
+  // touch_exp_sec, when engaged, updates the expiry of each fetched key (memcached GAT/GATS);
+  // 0 removes the expiry.
+  static MGetResponse OpMGet(bool fetch_mcflag, bool fetch_mcver,
+                             std::optional<uint32_t> touch_exp_sec, const OpArgs& op_args);
 };
 
 }  // namespace dfly
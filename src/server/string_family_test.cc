@@ -4,6 +4,7 @@
 
 #include "server/string_family.h"
 
+#include "base/flags.h"
 #include "base/gtest.h"
 #include "base/logging.h"
 #include "facade/facade_test.h"
@@ -14,6 +15,8 @@
 #include "server/test_utils.h"
 #include "server/transaction.h"
 
+ABSL_DECLARE_FLAG(bool, mget_dirty_read);
+
 using namespace testing;
 using namespace std;
 using namespace util;
@@ -228,6 +231,24 @@ TEST_F(StringFamilyTest, MGetSet) {
   set_fb.Join();
 }
 
+TEST_F(StringFamilyTest, MGetDirtyRead) {
+  absl::SetFlag(&FLAGS_mget_dirty_read, true);
+
+  Run({"mset", "x", "0", "y", "0", "a", "0", "b", "0"});
+  ASSERT_EQ(2, GetDebugInfo().shards_count);
+
+  // Without scheduling a transaction each shard still serves its current values.
+  auto resp = Run({"mget", "x", "y", "a", "b"});
+  ASSERT_EQ(RespExpr::ARRAY, resp.type);
+  EXPECT_THAT(ToIntArr(resp), ElementsAre(0, 0, 0, 0));
+
+  resp = Run({"mget", "x", "unknown"});
+  ASSERT_THAT(resp, ArrLen(2));
+  EXPECT_THAT(resp.GetVec(), ElementsAre("0", ArgType(RespExpr::NIL)));
+
+  absl::SetFlag(&FLAGS_mget_dirty_read, false);
+}
+
 TEST_F(StringFamilyTest, MSetGet) {
   Run({"mset", "x", "0", "y", "0", "a", "0", "b", "0"});
   ASSERT_EQ(2, GetDebugInfo().shards_count);
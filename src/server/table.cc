@@ -10,6 +10,10 @@
 ABSL_FLAG(bool, enable_top_keys_tracking, false,
           "Enables / disables tracking of hot keys debugging feature");
 
+ABSL_FLAG(bool, expire_timer_wheel, false,
+          "If true, indexes short TTLs in a per-shard timer wheel so that they are deleted "
+          "precisely when due, instead of waiting for the sampling scan to find them");
+
 namespace dfly {
 
 #define ADD(x) (x) += o.x
@@ -49,6 +53,21 @@ DbTable::DbTable(PMR_NS::memory_resource* mr)
   if (ClusterConfig::IsClusterEnabled()) {
     slots_stats.resize(ClusterConfig::kMaxSlotNum + 1);
   }
+  if (absl::GetFlag(FLAGS_expire_timer_wheel)) {
+    expire_wheel.reset(new ExpireWheel);
+  }
+}
+
+bool ExpireWheel::Add(std::string_view key, uint64_t at_ms, uint64_t now_ms) {
+  if (at_ms <= now_ms)
+    return false;
+
+  uint64_t slot = at_ms / kSlotSpanMs;
+  if (slot - now_ms / kSlotSpanMs >= kSlots)  // beyond the horizon.
+    return false;
+
+  slots_[slot % kSlots].emplace_back(key);
+  return true;
 }
 
 DbTable::~DbTable() {
@@ -60,6 +79,35 @@ void DbTable::Clear() {
   expire.Clear();
   mcflag.Clear();
   stats = DbTableStats{};
+  if (expire_wheel) {
+    expire_wheel.reset(new ExpireWheel);
+  }
+  access_clock.clear();
+}
+
+void DbTable::RecordAccess(std::string_view key, uint32_t now_min) {
+  uint64_t fp = PrimeKey::HashCode(key);
+
+  auto it = access_clock.find(fp);
+  if (it == access_clock.end()) {
+    if (access_clock.size() >= kAccessClockMaxEntries)
+      return;
+    access_clock.emplace(fp, now_min & ((1u << kAccessMinBits) - 1));
+    return;
+  }
+
+  uint32_t freq = it->second >> kAccessMinBits;
+  if (freq < 255)
+    ++freq;
+  it->second = (freq << kAccessMinBits) | (now_min & ((1u << kAccessMinBits) - 1));
+}
+
+std::optional<std::pair<uint32_t, uint8_t>> DbTable::GetAccessInfo(std::string_view key) const {
+  auto it = access_clock.find(PrimeKey::HashCode(key));
+  if (it == access_clock.end())
+    return std::nullopt;
+  return std::make_pair(it->second & ((1u << kAccessMinBits) - 1),
+                        uint8_t(it->second >> kAccessMinBits));
 }
 
 void DbTable::Release(IntentLock::Mode mode, std::string_view key, unsigned count) {
@@ -5,9 +5,16 @@
 #pragma once
 
 #include <absl/container/flat_hash_map.h>
+#include <absl/container/flat_hash_set.h>
 
+#include <array>
 #include <boost/smart_ptr/intrusive_ptr.hpp>
 #include <boost/smart_ptr/intrusive_ref_counter.hpp>
+#include <memory>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
 
 #include "core/expire_period.h"
 #include "core/intent_lock.h"
@@ -65,6 +72,47 @@ struct DbTableStats {
 
 using LockTable = absl::flat_hash_map<std::string, IntentLock>;
 
+// Optional per-shard index over soon-to-expire keys, enabled with --expire_timer_wheel.
+// A key whose deadline falls within the wheel horizon registers in the slot covering it;
+// the periodic expiry tick drains the slots that fully passed and deletes exactly those
+// keys, instead of discovering them by sampling the expire table. Entries are hints:
+// the deadline is re-validated against the expire table on drain, so stale entries
+// (deleted keys, changed TTLs) are skipped.
+class ExpireWheel {
+ public:
+  // ~1s slots covering a ~16s horizon - sized for rate-limiter style keys that live a
+  // few seconds. Longer TTLs are left to the sampling scan.
+  static constexpr uint64_t kSlotSpanMs = 1024;
+  static constexpr size_t kSlots = 16;
+
+  // Registers key if at_ms falls within the wheel horizon, returns false otherwise.
+  bool Add(std::string_view key, uint64_t at_ms, uint64_t now_ms);
+
+  // Calls cb(key) for every entry in the slots that fully passed and clears them.
+  // cb may re-register keys via Add.
+  template <typename Cb> void PopDue(uint64_t now_ms, Cb cb) {
+    uint64_t cur = now_ms / kSlotSpanMs;  // the current, still partial slot is not drained.
+    if (cur <= last_slot_)
+      return;
+    if (cur - last_slot_ > kSlots)
+      last_slot_ = cur - kSlots;
+
+    for (uint64_t s = last_slot_; s < cur; ++s) {
+      // Swap the bucket out so that Add calls from cb (which may wrap into the same
+      // physical slot) do not invalidate the iteration.
+      std::vector<std::string> bucket;
+      bucket.swap(slots_[s % kSlots]);
+      for (std::string& key : bucket)
+        cb(std::move(key));
+    }
+    last_slot_ = cur;
+  }
+
+ private:
+  std::array<std::vector<std::string>, kSlots> slots_;
+  uint64_t last_slot_ = 0;  // slots below this index were drained.
+};
+
 // A single Db table that represents a table that can be chosen with "SELECT" command.
 struct DbTable : boost::intrusive_ref_counter<DbTable, boost::thread_unsafe_counter> {
   PrimeTable prime;
@@ -77,6 +125,10 @@ struct DbTable : boost::intrusive_ref_counter<DbTable, boost::thread_unsafe_coun
   // Stores a list of dependant connections for each watched key.
   absl::flat_hash_map<std::string, std::vector<ConnectionState::ExecInfo*>> watched_keys;
 
+  // Stores the connections that cached each key client-side (CLIENT TRACKING), so that a
+  // write can push an invalidation message to them. Size-bounded by DbSlice::TrackKey.
+  absl::flat_hash_map<std::string, absl::flat_hash_set<ConnectionContext*>> tracked_keys;
+
   mutable DbTableStats stats;
   std::vector<SlotStats> slots_stats;
   ExpireTable::Cursor expire_cursor;
@@ -84,6 +136,26 @@ struct DbTable : boost::intrusive_ref_counter<DbTable, boost::thread_unsafe_coun
 
   TopKeys top_keys;
 
+  // Set iff --expire_timer_wheel.
+  std::unique_ptr<ExpireWheel> expire_wheel;
+
+  // Sampled last-access clock: key fingerprint -> (hit counter << kAccessMinBits) | minutes.
+  // Fed by DbSlice::FindExtInternal when --access_clock_sampling is enabled and queried by
+  // OBJECT IDLETIME/FREQ and DEBUG ACCESSHIST. PrimeValue has no spare bits for an access
+  // time (sizeof(CompactObj) == 18 is load bearing), hence the sidecar map. Fingerprint
+  // collisions merge entries - acceptable for a sampled diagnostic.
+  static constexpr unsigned kAccessMinBits = 24;
+  static constexpr size_t kAccessClockMaxEntries = 1u << 20;
+  absl::flat_hash_map<uint64_t, uint32_t> access_clock;
+
+  // Records a sampled hit: stamps the current minute and bumps the saturating hit counter.
+  // New keys are dropped once kAccessClockMaxEntries is reached.
+  void RecordAccess(std::string_view key, uint32_t now_min);
+
+  // Returns (minutes timestamp of the last sampled access, hit counter), or nullopt if the
+  // key was never sampled.
+  std::optional<std::pair<uint32_t, uint8_t>> GetAccessInfo(std::string_view key) const;
+
   explicit DbTable(PMR_NS::memory_resource* mr);
   ~DbTable();
 
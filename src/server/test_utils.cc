@@ -66,6 +66,10 @@ void TestConnection::SendPubMessageAsync(PubMessage pmsg) {
   messages.push_back(move(pmsg));
 }
 
+void TestConnection::SendInvalidationMessageAsync(InvalidationMessage msg) {
+  invalidation_messages.push_back(move(msg));
+}
+
 class BaseFamilyTest::TestConnWrapper {
  public:
   TestConnWrapper(Protocol proto);
@@ -290,6 +294,27 @@ auto BaseFamilyTest::RunMC(MP::CmdType cmd_type, std::string_view key) -> MCResp
   return conn->SplitLines();
 }
 
+auto BaseFamilyTest::RunCasMC(uint64_t cas_unique, std::string_view key, std::string_view value)
+    -> MCResponse {
+  if (!ProactorBase::IsProactorThread()) {
+    return pp_->at(0)->Await([&] { return this->RunCasMC(cas_unique, key, value); });
+  }
+
+  MP::Command cmd;
+  cmd.type = MP::CAS;
+  cmd.key = key;
+  cmd.cas_unique = cas_unique;
+  cmd.bytes_len = value.size();
+
+  TestConnWrapper* conn = AddFindConn(Protocol::MEMCACHE, GetId());
+
+  auto* context = conn->cmd_cntx();
+
+  service_->DispatchMC(cmd, value, context);
+
+  return conn->SplitLines();
+}
+
 auto BaseFamilyTest::GetMC(MP::CmdType cmd_type, std::initializer_list<std::string_view> list)
     -> MCResponse {
   CHECK_GT(list.size(), 0u);
@@ -422,6 +447,23 @@ const facade::Connection::PubMessage& BaseFamilyTest::GetPublishedMessage(string
   return it->second->GetPubMessage(index);
 }
 
+size_t BaseFamilyTest::InvalidationMessagesLen(string_view conn_id) const {
+  auto it = connections_.find(conn_id);
+  if (it == connections_.end())
+    return 0;
+
+  return it->second->conn()->invalidation_messages.size();
+}
+
+const facade::Connection::InvalidationMessage& BaseFamilyTest::GetInvalidationMessage(
+    string_view conn_id, size_t index) const {
+  auto it = connections_.find(conn_id);
+  CHECK(it != connections_.end());
+  auto& invalidation_messages = it->second->conn()->invalidation_messages;
+  CHECK_LT(index, invalidation_messages.size());
+  return invalidation_messages[index];
+}
+
 ConnectionContext::DebugInfo BaseFamilyTest::GetDebugInfo(const std::string& id) const {
   auto it = connections_.find(id);
   CHECK(it != connections_.end());
@@ -23,6 +23,8 @@ class TestConnection : public facade::Connection {
 
   void SendPubMessageAsync(PubMessage pmsg) final;
 
+  void SendInvalidationMessageAsync(InvalidationMessage msg) final;
+
   bool IsAdmin() const override {
     return is_admin_;
   }
@@ -31,6 +33,7 @@ class TestConnection : public facade::Connection {
   }
 
   std::vector<PubMessage> messages;
+  std::vector<InvalidationMessage> invalidation_messages;
 
  private:
   io::StringSink* sink_;
@@ -69,6 +72,9 @@ class BaseFamilyTest : public ::testing::Test {
   MCResponse RunMC(MemcacheParser::CmdType cmd_type, std::string_view key = std::string_view{});
   MCResponse GetMC(MemcacheParser::CmdType cmd_type, std::initializer_list<std::string_view> list);
 
+  // Runs the memcached CAS store command with the given expected version.
+  MCResponse RunCasMC(uint64_t cas_unique, std::string_view key, std::string_view value);
+
   int64_t CheckedInt(std::initializer_list<std::string_view> list) {
     return CheckedInt(ArgSlice{list.begin(), list.size()});
   }
@@ -98,10 +104,14 @@ class BaseFamilyTest : public ::testing::Test {
 
   std::string GetId() const;
   size_t SubscriberMessagesLen(std::string_view conn_id) const;
+  size_t InvalidationMessagesLen(std::string_view conn_id) const;
 
   const facade::Connection::PubMessage& GetPublishedMessage(std::string_view conn_id,
                                                             size_t index) const;
 
+  const facade::Connection::InvalidationMessage& GetInvalidationMessage(std::string_view conn_id,
+                                                                        size_t index) const;
+
   static unsigned NumLocked();
 
   void SetTestFlag(std::string_view flag_name, std::string_view new_value);
@@ -10,14 +10,31 @@ extern "C" {
 
 #include <mimalloc.h>
 
+#include <cstring>
+#include <list>
+
 #include "base/flags.h"
 #include "base/logging.h"
+#include "core/simple_lru_counter.h"
 #include "server/db_slice.h"
 #include "server/engine_shard_set.h"
 
 ABSL_FLAG(uint32_t, tiered_storage_max_pending_writes, 32,
           "Maximal number of pending writes per thread");
 
+ABSL_FLAG(uint64_t, tiered_read_cache_bytes, 1u << 22,  // 4MB
+          "Capacity of the per-shard RAM cache in front of the tiered storage file. "
+          "0 disables the cache.");
+
+ABSL_FLAG(bool, tiered_sequential_writes, false,
+          "If true, offsets for offloaded values are handed out sequentially from 1MB "
+          "regions, turning the unload stream into sequential writes at the cost of more "
+          "fragmentation after deletions.");
+
+ABSL_FLAG(uint32_t, tiered_defrag_page_fill_threshold, 0,
+          "Offloaded values residing on allocator pages whose fill percentage is below this "
+          "are rewritten into fresh pages by a background fiber. 0 disables compaction.");
+
 namespace dfly {
 
 using namespace std;
@@ -276,7 +293,95 @@ void TieredStorage::InflightWriteRequest::Undo(PerDb::BinRecord* bin_record, DbS
   }
 }
 
+// RAM cache in front of the backing file, keyed by the disk offset that
+// uniquely identifies an offloaded blob until it is freed. Admission follows
+// the TinyLFU scheme: read frequencies are tracked in a SimpleLruCounter
+// window and a missed blob is admitted only if it was read more often than
+// the victims it would evict, so one-off scans do not flush the hot set.
+class TieredStorage::ReadCache {
+ public:
+  explicit ReadCache(size_t max_bytes) : max_bytes_(max_bytes), freq_(kFreqWindowLen) {
+  }
+
+  // Copies the cached blob into dest and returns true on a hit.
+  bool Get(size_t offset, size_t len, char* dest) {
+    return GetRange(offset, 0, len, dest);
+  }
+
+  // Copies blob[skip, skip+len) of the blob stored at offset into dest on a hit.
+  bool GetRange(size_t offset, size_t skip, size_t len, char* dest) {
+    auto it = entries_.find(offset);
+    if (it == entries_.end())
+      return false;
+
+    const string& blob = it->second->second;
+    if (skip + len > blob.size())
+      return false;
+
+    memcpy(dest, blob.data() + skip, len);
+    lru_.splice(lru_.begin(), lru_, it->second);
+    return true;
+  }
+
+  // Possibly inserts a blob that was just read from disk.
+  void Admit(size_t offset, size_t len, const char* data) {
+    if (len > max_bytes_)
+      return;
+
+    uint64_t freq = Frequency(offset) + 1;
+    freq_.Put(absl::StrCat(offset), freq);
+
+    // Evict colder entries until the blob fits. If some victim was read at
+    // least as often as the candidate, the candidate is not admitted.
+    while (used_bytes_ + len > max_bytes_) {
+      const auto& [victim_offset, victim_blob] = lru_.back();
+      if (Frequency(victim_offset) >= freq)
+        return;
+
+      used_bytes_ -= victim_blob.size();
+      entries_.erase(victim_offset);
+      lru_.pop_back();
+    }
+
+    auto lit = lru_.emplace(lru_.begin(), offset, string(data, len));
+    entries_.emplace(offset, lit);
+    used_bytes_ += len;
+  }
+
+  // Drops the blob; must be called before its disk space is reused.
+  void Invalidate(size_t offset) {
+    auto it = entries_.find(offset);
+    if (it == entries_.end())
+      return;
+
+    used_bytes_ -= it->second->second.size();
+    lru_.erase(it->second);
+    entries_.erase(it);
+  }
+
+ private:
+  // How many offsets the frequency window remembers.
+  static constexpr size_t kFreqWindowLen = 1024;
+
+  uint64_t Frequency(size_t offset) const {
+    return freq_.Get(absl::StrCat(offset)).value_or(0);
+  }
+
+  using LruList = list<pair<size_t, string>>;  // (offset, blob), mru first.
+
+  size_t max_bytes_;
+  size_t used_bytes_ = 0;
+  LruList lru_;
+  absl::flat_hash_map<size_t, LruList::iterator> entries_;
+  SimpleLruCounter freq_;
+};
+
 TieredStorage::TieredStorage(DbSlice* db_slice) : db_slice_(*db_slice) {
+  size_t cache_bytes = GetFlag(FLAGS_tiered_read_cache_bytes);
+  if (cache_bytes > 0) {
+    read_cache_.reset(new ReadCache(cache_bytes));
+  }
+  sequential_writes_ = GetFlag(FLAGS_tiered_sequential_writes);
 }
 
 TieredStorage::~TieredStorage() {
@@ -293,18 +398,102 @@ error_code TieredStorage::Open(const string& base) {
     if (io_mgr_.Span()) {  // Add initial storage.
       alloc_.AddStorage(0, io_mgr_.Span());
     }
+    if (GetFlag(FLAGS_tiered_defrag_page_fill_threshold) > 0) {
+      defrag_fb_ = util::MakeFiber(&TieredStorage::DefragFb, this);
+    }
   }
   return ec;
 }
 
-std::error_code TieredStorage::Read(size_t offset, size_t len, char* dest) {
+std::error_code TieredStorage::Read(size_t offset, size_t len, char* dest, bool cache_result) {
   stats_.tiered_reads++;
   DVLOG(1) << "Read " << offset << " " << len;
 
-  return io_mgr_.Read(offset, io::MutableBytes{reinterpret_cast<uint8_t*>(dest), len});
+  if (read_cache_ && read_cache_->Get(offset, len, dest)) {
+    stats_.read_cache_hits++;
+    return {};
+  }
+
+  error_code ec = io_mgr_.Read(offset, io::MutableBytes{reinterpret_cast<uint8_t*>(dest), len});
+  if (!ec && cache_result && read_cache_) {
+    read_cache_->Admit(offset, len, dest);
+  }
+  return ec;
+}
+
+std::error_code TieredStorage::ReadRange(size_t offset, size_t skip, size_t len, char* dest) {
+  stats_.tiered_reads++;
+  DVLOG(1) << "ReadRange " << offset << "+" << skip << " " << len;
+
+  if (read_cache_ && read_cache_->GetRange(offset, skip, len, dest)) {
+    stats_.read_cache_hits++;
+    return {};
+  }
+
+  // Partial blobs are not admitted: the cache tracks whole values keyed by their start
+  // offset, and Invalidate() would leave sub-range entries behind.
+  return io_mgr_.Read(offset + skip, io::MutableBytes{reinterpret_cast<uint8_t*>(dest), len});
+}
+
+std::error_code TieredStorage::ReadAsync(size_t offset, size_t len, char* dest, ReadCb cb) {
+  stats_.tiered_reads++;
+  DVLOG(1) << "ReadAsync " << offset << " " << len;
+
+  if (read_cache_ && read_cache_->Get(offset, len, dest)) {
+    stats_.read_cache_hits++;
+    cb(error_code{});
+    return {};
+  }
+
+  auto io_cb = [this, offset, len, dest, cb = move(cb)](int io_res) {
+    if (io_res < 0) {
+      cb(error_code{-io_res, system_category()});
+      return;
+    }
+    if (read_cache_) {
+      read_cache_->Admit(offset, len, dest);
+    }
+    cb(error_code{});
+  };
+
+  return io_mgr_.ReadAsync(offset, io::MutableBytes{reinterpret_cast<uint8_t*>(dest), len},
+                           move(io_cb));
+}
+
+void TieredStorage::Pin(size_t offset) {
+  pinned_[offset].count++;
+}
+
+void TieredStorage::Unpin(size_t offset) {
+  auto it = pinned_.find(offset);
+  CHECK(it != pinned_.end());
+
+  if (--it->second.count > 0)
+    return;
+
+  size_t deferred_len = it->second.deferred_len;
+  pinned_.erase(it);
+
+  if (deferred_len) {  // the entry was freed while we were reading it.
+    Free(offset, deferred_len);
+  }
 }
 
 void TieredStorage::Free(size_t offset, size_t len) {
+  // The offset may be recycled by a later write, so the cached copy dies here.
+  if (read_cache_) {
+    read_cache_->Invalidate(offset);
+  }
+
+  auto pin_it = pinned_.find(offset);
+  if (pin_it != pinned_.end()) {
+    // A read of this range is still in flight. Defer releasing it until the last Unpin,
+    // otherwise the range could be reallocated and overwritten mid-read.
+    DCHECK_EQ(0u, pin_it->second.deferred_len);
+    pin_it->second.deferred_len = len;
+    return;
+  }
+
   if (offset % kBlockLen == 0) {
     alloc_.Free(offset, len);
   } else {
@@ -321,14 +510,112 @@ void TieredStorage::Free(size_t offset, size_t len) {
 }
 
 void TieredStorage::Shutdown() {
+  defrag_done_.Notify();
+  defrag_fb_.JoinIfNeeded();
   io_mgr_.Shutdown();
 }
 
+void TieredStorage::DefragFb() {
+  util::ThisFiber::SetName("tiered_defrag");
+  const unsigned fill_threshold = GetFlag(FLAGS_tiered_defrag_page_fill_threshold);
+  constexpr unsigned kMaxTraverses = 20;
+  constexpr unsigned kMaxVictims = 64;
+  constexpr auto kScanPeriod = 1s;
+
+  uint64_t cursor_val = 0;
+  string tmp;
+
+  while (!defrag_done_.WaitFor(kScanPeriod)) {
+    if (!db_slice_.IsDbValid(0))
+      continue;
+
+    // First pass: collect victim keys without preempting, like EngineShard::DoDefrag.
+    vector<string> victims;
+    PrimeTable* prime_table = db_slice_.GetTables(0).first;
+    PrimeTable::Cursor cur = cursor_val;
+    unsigned traverses_count = 0;
+
+    do {
+      cur = prime_table->Traverse(cur, [&](PrimeIterator it) {
+        if (!it->second.IsExternal())
+          return;
+
+        size_t offset = it->second.GetExternalSlice().first;
+        if (alloc_.PageFill(offset) < fill_threshold) {
+          victims.push_back(string(it->first.GetSlice(&tmp)));
+        }
+      });
+      traverses_count++;
+    } while (traverses_count < kMaxTraverses && cur && victims.size() < kMaxVictims);
+    cursor_val = cur.value();
+
+    // Second pass: relocate, this may suspend on io.
+    for (const string& key : victims) {
+      if (defrag_done_.WaitFor(0ms))
+        return;
+      if (RelocateItem(0, key))
+        stats_.defrag_relocations++;
+    }
+  }
+}
+
+bool TieredStorage::RelocateItem(DbIndex db_index, string_view key) {
+  DbContext db_cntx{db_index, GetCurrentTimeMs()};
+
+  auto [it, exp_it] = db_slice_.FindExt(db_cntx, key);
+  if (!IsValid(it) || !it->second.IsExternal())
+    return false;
+
+  pair<size_t, size_t> ext = it->second.GetExternalSlice();
+  size_t offset = ext.first;
+  size_t size = ext.second;
+
+  // The pin defers releasing the range (by PreUpdate below) until after the hole punch,
+  // so the allocator can not hand it out to a concurrent write meanwhile.
+  Pin(offset);
+
+  string value(size, '\0');
+  error_code ec = Read(offset, size, value.data());
+  if (ec) {
+    Unpin(offset);
+    return false;
+  }
+
+  // The read suspends, so re-validate that the entry did not change meanwhile.
+  tie(it, exp_it) = db_slice_.FindExt(db_cntx, key);
+  if (!IsValid(it) || !it->second.IsExternal() || it->second.GetExternalSlice().first != offset) {
+    Unpin(offset);
+    return false;
+  }
+
+  db_slice_.PreUpdate(db_index, it);  // frees the external range, deferred by the pin.
+  it->second.SetString(value);
+  db_slice_.PostUpdate(db_index, it, key, true);
+
+  // Rewrite into a fresh page through the regular offload path.
+  ScheduleOffload(db_index, it);
+
+  if (offset % kBlockLen == 0) {
+    // The blocks were owned exclusively by this value - return them to the filesystem.
+    io_mgr_.PunchHoleAsync(offset, ExternalAllocator::GoodSize(size),
+                           [this, offset](int) { Unpin(offset); });
+  } else {
+    Unpin(offset);
+  }
+
+  return true;
+}
+
 TieredStats TieredStorage::GetStats() const {
   TieredStats res = stats_;
   res.storage_capacity = alloc_.capacity();
   res.storage_reserved = alloc_.allocated_bytes();
 
+  const IoMgr::Stats& io_stats = io_mgr_.GetStats();
+  res.pending_io_ops = io_stats.pending_ops;
+  res.max_pending_io_ops = io_stats.max_pending_ops;
+  res.write_latency_usec = io_stats.write_latency_usec;
+
   return res;
 }
 
@@ -359,6 +646,11 @@ void TieredStorage::FinishIoRequest(int io_res, InflightWriteRequest* req) {
   VLOG_IF(2, num_active_requests_ == 0) << "Finished active requests";
 }
 
+bool TieredStorage::CanScheduleOffload() const {
+  return num_active_requests_ < GetFlag(FLAGS_tiered_storage_max_pending_writes) &&
+         alloc_.allocated_bytes() < alloc_.capacity();
+}
+
 error_code TieredStorage::ScheduleOffload(DbIndex db_index, PrimeIterator it) {
   CHECK_EQ(OBJ_STRING, it->second.ObjType());
   DCHECK(!it->second.IsExternal());
@@ -448,7 +740,7 @@ bool IsObjFitToUnload(const PrimeValue& pv) {
 void TieredStorage::WriteSingle(DbIndex db_index, PrimeIterator it, size_t blob_len) {
   DCHECK(!it->second.HasIoPending());
 
-  int64_t res = alloc_.Malloc(blob_len);
+  int64_t res = sequential_writes_ ? alloc_.MallocSequential(blob_len) : alloc_.Malloc(blob_len);
   if (res < 0) {
     InitiateGrow(-res);
     return;
@@ -502,7 +794,7 @@ void TieredStorage::WriteSingle(DbIndex db_index, PrimeIterator it, size_t blob_
 bool TieredStorage::FlushPending(DbIndex db_index, unsigned bin_index) {
   PerDb* db = db_arr_[db_index];
 
-  int64_t res = alloc_.Malloc(kBlockLen);
+  int64_t res = sequential_writes_ ? alloc_.MallocSequential(kBlockLen) : alloc_.Malloc(kBlockLen);
   if (res < 0) {
     InitiateGrow(-res);
     return false;
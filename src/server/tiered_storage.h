@@ -24,11 +24,33 @@ class TieredStorage {
 
   std::error_code Open(const std::string& path);
 
-  std::error_code Read(size_t offset, size_t len, char* dest);
+  using ReadCb = std::function<void(std::error_code)>;
+
+  // If cache_result is false the read bypasses read cache admission - bulk scans
+  // (e.g. snapshotting) should not evict interactively read values.
+  std::error_code Read(size_t offset, size_t len, char* dest, bool cache_result = true);
+
+  // Reads [skip, skip+len) of the blob stored at offset. Serves from the read cache when
+  // the whole blob is resident, otherwise issues a disk read of just the addressed range.
+  std::error_code ReadRange(size_t offset, size_t skip, size_t len, char* dest);
+
+  // Like Read but does not suspend the calling fiber: cb runs in the shard thread once
+  // the data is in dest. A caller must keep dest alive and the range pinned until then.
+  std::error_code ReadAsync(size_t offset, size_t len, char* dest, ReadCb cb);
+
+  // Keeps the range starting at offset allocated even if its owning entry is deleted or
+  // overwritten meanwhile - Free on a pinned range is deferred until the last Unpin.
+  // Allows reading an offloaded value outside the transaction hop that found it.
+  void Pin(size_t offset);
+  void Unpin(size_t offset);
 
   // Schedules unloading of the item, pointed by the iterator.
   std::error_code ScheduleOffload(DbIndex db_index, PrimeIterator it);
 
+  // Returns true if a new offload can be scheduled right now: the io queue is not
+  // saturated and the backing storage has spare capacity.
+  bool CanScheduleOffload() const;
+
   void CancelIo(DbIndex db_index, PrimeIterator it);
 
   static bool EligibleForOffload(std::string_view val) {
@@ -43,11 +65,22 @@ class TieredStorage {
 
  private:
   class InflightWriteRequest;
+  class ReadCache;
 
   void WriteSingle(DbIndex db_index, PrimeIterator it, size_t blob_len);
 
   bool FlushPending(DbIndex db_index, unsigned bin_index);
 
+  // Background compaction: incrementally scans the prime table for offloaded values
+  // that reside on sparse allocator pages and rewrites them into fresh ones,
+  // so that the vacated pages can be reused or returned to the filesystem.
+  void DefragFb();
+
+  // Rewrites the value of key into a fresh location if it is still offloaded.
+  // Punches a hole over vacated whole blocks. Returns true if the value was relocated.
+  // May suspend on io.
+  bool RelocateItem(DbIndex db_index, std::string_view key);
+
   void InitiateGrow(size_t size);
 
   void FinishIoRequest(int io_res, InflightWriteRequest* req);
@@ -57,6 +90,12 @@ class TieredStorage {
   IoMgr io_mgr_;
   ExternalAllocator alloc_;
 
+  // RAM cache in front of io_mgr_ reads, null if disabled.
+  std::unique_ptr<ReadCache> read_cache_;
+
+  // If true, offsets are handed out append-style, see --tiered_sequential_writes.
+  bool sequential_writes_ = false;
+
   size_t submitted_io_writes_ = 0;
   size_t submitted_io_write_size_ = 0;
   uint32_t num_active_requests_ = 0;
@@ -68,6 +107,15 @@ class TieredStorage {
 
   absl::flat_hash_map<uint32_t, uint8_t> page_refcnt_;
 
+  struct PinInfo {
+    uint32_t count = 0;
+    size_t deferred_len = 0;  // set if Free arrived while the range was pinned.
+  };
+  absl::flat_hash_map<size_t, PinInfo> pinned_;  // offset -> pin state.
+
+  Fiber defrag_fb_;
+  Done defrag_done_;  // signalled on shutdown.
+
   TieredStats stats_;
 };
 
@@ -5,8 +5,11 @@
 #include "server/transaction.h"
 
 #include <absl/strings/match.h>
+#include <absl/time/clock.h>
 
+#include "base/flags.h"
 #include "base/logging.h"
+#include "core/mi_memory_resource.h"
 #include "server/blocking_controller.h"
 #include "server/command_registry.h"
 #include "server/db_slice.h"
@@ -14,10 +17,20 @@
 #include "server/journal/journal.h"
 #include "server/server_state.h"
 
+ABSL_FLAG(uint32_t, tx_trace_sample_rate, 0,
+          "If positive, every Nth transaction records timestamps of its scheduling and "
+          "execution phases. The records are dumped with DEBUG TRACE.");
+
+ABSL_FLAG(bool, cmd_alloc_tracking, false,
+          "If true, attributes data heap allocations to the command being executed. "
+          "The per-command totals are exposed via MEMORY STATS. Adds a small overhead "
+          "to every allocation on the shard threads.");
+
 namespace dfly {
 
 using namespace std;
 using namespace util;
+using absl::GetFlag;
 using absl::StrCat;
 
 thread_local Transaction::TLTmpSpace Transaction::tmp_space;
@@ -28,6 +41,31 @@ atomic_uint64_t op_seq{1};
 
 [[maybe_unused]] constexpr size_t kTransSize = sizeof(Transaction);
 
+// Installs a thread-local allocation sink for the duration of a command callback, so that
+// data heap allocations are attributed to the command by name. Active only when
+// --cmd_alloc_tracking is set. The attribution is approximate: if the callback preempts,
+// allocations made by other fibers on this thread are counted as well.
+class CmdAllocTracker {
+ public:
+  explicit CmdAllocTracker(const CommandId* cid) : cid_(cid) {
+    if (GetFlag(FLAGS_cmd_alloc_tracking))
+      MiMemoryResource::SetAllocationSink(&delta_);
+    else
+      cid_ = nullptr;
+  }
+
+  ~CmdAllocTracker() {
+    if (cid_) {
+      MiMemoryResource::SetAllocationSink(nullptr);
+      ServerState::tlocal()->cmd_alloc_bytes[cid_->name()] += delta_;
+    }
+  }
+
+ private:
+  const CommandId* cid_;
+  int64_t delta_ = 0;
+};
+
 }  // namespace
 
 IntentLock::Mode Transaction::Mode() const {
@@ -111,6 +149,12 @@ void Transaction::BuildShardIndex(KeyIndex key_index, bool rev_mapping,
   }
 
   for (unsigned i = key_index.start; i < key_index.end; ++i) {
+    // Prefetch upcoming keys so the shard-hash computations below overlap their
+    // cache misses instead of serializing on them.
+    constexpr unsigned kPrefetchDist = 4;
+    if (i + kPrefetchDist < key_index.end)
+      __builtin_prefetch(ArgS(args, i + kPrefetchDist).data(), 0, 1);
+
     uint32_t sid = Shard(ArgS(args, i), shard_data_.size());
     add(sid, i);
 
@@ -309,6 +353,12 @@ void Transaction::InitByKeys(KeyIndex key_index) {
 }
 
 OpStatus Transaction::InitByArgs(DbIndex index, CmdArgList args) {
+  if (uint32_t rate = GetFlag(FLAGS_tx_trace_sample_rate); rate > 0) {
+    static atomic_uint64_t trace_seq{0};
+    trace_ = trace_seq.fetch_add(1, memory_order_relaxed) % rate == 0;
+    RecordTraceEvent("init");
+  }
+
   InitBase(index, args);
 
   if ((cid_->opt_mask() & CO::GLOBAL_TRANS) > 0) {
@@ -384,6 +434,21 @@ void Transaction::StartMultiLockedAhead(DbIndex dbid, CmdArgList keys) {
   ScheduleInternal();
 }
 
+void Transaction::StartMultiSingleShard(DbIndex dbid, CmdArgList keys) {
+  DCHECK(multi_);
+  DCHECK(shard_data_.empty());  // Make sure default InitByArgs didn't run.
+
+  // Runs as LOCK_AHEAD, but the caller guarantees that all keys belong to one shard,
+  // so ScheduleInternal takes the inline single-shard path without the cross-shard
+  // scheduling rendezvous.
+  multi_->mode = LOCK_AHEAD;
+  InitBase(dbid, keys);
+  InitByKeys(KeyIndex::Range(0, keys.size()));
+  CHECK_EQ(1u, unique_shard_cnt_);
+
+  ScheduleInternal();
+}
+
 void Transaction::StartMultiNonAtomic() {
   DCHECK(multi_);
   multi_->mode = NON_ATOMIC;
@@ -416,6 +481,14 @@ void Transaction::MultiSwitchCmd(const CommandId* cid) {
     multi_->role = DEFAULT;
 }
 
+void Transaction::RecordTraceEvent(const char* phase) const {
+  if (!trace_)
+    return;
+
+  if (ServerState* ss = ServerState::tlocal(); ss)
+    ss->RecordTxTrace(trans_id(this), Name(), phase);
+}
+
 string Transaction::DebugId() const {
   DCHECK_GT(use_count_.load(memory_order_relaxed), 0u);
 
@@ -459,10 +532,13 @@ bool Transaction::RunInShard(EngineShard* shard, bool txq_ooo) {
     DCHECK(sd.local_mask & OUT_OF_ORDER);
   }
 
+  RecordTraceEvent("hop-start");
+
   /*************************************************************************/
   // Actually running the callback.
   // If you change the logic here, also please change the logic
   try {
+    CmdAllocTracker alloc_tracker(cid_);
     OpStatus status = OpStatus::OK;
 
     // if a transaction is suspended, we still run it because of brpoplpush/blmove case
@@ -489,6 +565,8 @@ bool Transaction::RunInShard(EngineShard* shard, bool txq_ooo) {
 
   /*************************************************************************/
 
+  RecordTraceEvent("hop-end");
+
   if (is_concluding)  // Check last hop
     LogAutoJournalOnShard(shard);
 
@@ -558,6 +636,8 @@ void Transaction::ScheduleInternal() {
   DCHECK_EQ(0u, txid_);
   DCHECK_EQ(0, coordinator_state_ & (COORD_SCHED | COORD_OOO));
 
+  RecordTraceEvent("schedule");
+
   bool span_all = IsGlobal();
 
   uint32_t num_shards;
@@ -599,7 +679,17 @@ void Transaction::ScheduleInternal() {
       success.fetch_add(is_success, memory_order_relaxed);
       lock_granted_cnt.fetch_add(is_granted, memory_order_relaxed);
     };
-    shard_set->RunBriefInParallel(std::move(cb), is_active);
+
+    // ScheduleInShard does not preempt, so when a single-shard transaction is scheduled
+    // from the thread that owns its shard we can run it right here instead of paying for a
+    // hop to the shard queue and back.
+    if (!span_all && unique_shard_cnt_ == 1 && coordinator_index_ == unique_shard_id_ &&
+        ServerState::tlocal()->AllowInlineScheduling()) {
+      DVLOG(2) << "Inline scheduling " << DebugId();
+      cb(EngineShard::tlocal());
+    } else {
+      shard_set->RunBriefInParallel(std::move(cb), is_active);
+    }
 
     bool ooo_disabled = IsGlobal() || (IsAtomicMulti() && multi_->mode != LOCK_AHEAD);
 
@@ -617,6 +707,7 @@ void Transaction::ScheduleInternal() {
     }
 
     VLOG(2) << "Cancelling " << DebugId();
+    ServerState::tlocal()->stats.tx_schedule_cancel_cnt++;
 
     atomic_bool should_poll_execution{false};
     auto cancel = [&](EngineShard* shard) {
@@ -729,6 +820,10 @@ OpStatus Transaction::ScheduleSingleHop(RunnableType cb) {
     CHECK(!cb_ptr_);  // we should have reset it within the callback.
   }
   cb_ptr_ = nullptr;
+
+  // The closest transaction-visible point to flushing the reply.
+  RecordTraceEvent("conclude");
+
   return local_result_;
 }
 
@@ -815,6 +910,9 @@ void Transaction::Execute(RunnableType cb, bool conclude) {
   DVLOG(1) << "Wait on Exec " << DebugId() << " completed";
 
   cb_ptr_ = nullptr;
+
+  if (conclude)
+    RecordTraceEvent("conclude");
 }
 
 // Runs in coordinator thread.
@@ -844,47 +942,74 @@ void Transaction::ExecuteAsync() {
   // IsArmedInShard in other threads.
   run_count_.store(unique_shard_cnt_, memory_order_release);
 
-  // We verify seq lock has the same generation number. See below for more info.
-  auto cb = [seq, this] {
-    EngineShard* shard = EngineShard::tlocal();
-
-    bool is_armed = IsArmedInShard(shard->shard_id());
-    // First we check that this shard should run a callback by checking IsArmedInShard.
-    if (is_armed) {
-      uint32_t seq_after = seqlock_.load(memory_order_relaxed);
-
-      DVLOG(3) << "PollExecCb " << DebugId() << " sid(" << shard->shard_id() << ") "
-               << run_count_.load(memory_order_relaxed);
-
-      // We also make sure that for mult-operation transactions like Multi/Eval
-      // this callback runs on a correct operation. We want to avoid a situation
-      // where the first operation is executed and the second operation is armed and
-      // now this callback from the previous operation finally runs and calls PollExecution.
-      // It is usually ok, but for single shard operations we abuse index 0 in shard_data_
-      // Therefore we may end up with a situation where this old callback runs on shard 7,
-      // accessing shard_data_[0] that now represents shard 5 for the next operation.
-      // seqlock provides protection for that so each cb will only run on the operation it has
-      // been tasked with.
-      // We also must first check is_armed and only then seqlock. The first check ensures that
-      // the coordinator thread crossed
-      // "run_count_.store(unique_shard_cnt_, memory_order_release);" barrier and our seqlock_
-      // is valid.
-      if (seq_after == seq) {
-        // shard->PollExecution(this) does not necessarily execute this transaction.
-        // Therefore, everything that should be handled during the callback execution
-        // should go into RunInShard.
-        shard->PollExecution("exec_cb", this);
-      } else {
-        VLOG(1) << "Skipping PollExecution " << DebugId() << " sid(" << shard->shard_id() << ")";
-      }
+  // IsArmedInShard is the protector of non-thread safe data.
+  // Submission goes through the per-shard poll inbox - an allocation-free intrusive queue that
+  // is drained in batches with a single shard queue wakeup (see EngineShardSet::SubmitPollNode).
+  // A node still in flight means a stale submission of a previous operation has not been drained
+  // yet (it will fail the seqlock check there); the hop then falls back to a plain closure
+  // dispatch so that the shard is still guaranteed to be polled for this operation.
+  IterateActiveShards([seq, this](PerShardData& sd, auto i) {
+    if (!sd.poll_node.in_flight.exchange(true, memory_order_acq_rel)) {
+      sd.poll_node.trans = this;
+      sd.poll_node.seq = seq;
+      shard_set->SubmitPollNode(i, &sd.poll_node);
+    } else {
+      shard_set->Add(i, [seq, this] {
+        TxPollNode node{};  // detached stand-in, poll logic is shared with the inbox path.
+        node.trans = this;
+        node.seq = seq;
+        node.in_flight.store(true, memory_order_relaxed);
+        RunPolledNode(&node);
+      });
     }
+  });
+}
 
-    DVLOG(3) << "ptr_release " << DebugId() << " " << seq;
-    intrusive_ptr_release(this);  // against use_count_.fetch_add above.
-  };
+// Runs in the shard thread.
+void Transaction::RunPolledNode(TxPollNode* node) {
+  Transaction* trans = node->trans;
+  uint32_t seq = node->seq;
+
+  // Release the node for re-submission only after copying its fields: right after this store a
+  // coordinator may win it again and overwrite them.
+  node->in_flight.store(false, memory_order_release);
+
+  EngineShard* shard = EngineShard::tlocal();
+
+  bool is_armed = trans->IsArmedInShard(shard->shard_id());
+  // First we check that this shard should run a callback by checking IsArmedInShard.
+  if (is_armed) {
+    uint32_t seq_after = trans->seqlock_.load(memory_order_relaxed);
+
+    DVLOG(3) << "PollExecCb " << trans->DebugId() << " sid(" << shard->shard_id() << ") "
+             << trans->run_count_.load(memory_order_relaxed);
+
+    // We also make sure that for mult-operation transactions like Multi/Eval
+    // this callback runs on a correct operation. We want to avoid a situation
+    // where the first operation is executed and the second operation is armed and
+    // now this callback from the previous operation finally runs and calls PollExecution.
+    // It is usually ok, but for single shard operations we abuse index 0 in shard_data_
+    // Therefore we may end up with a situation where this old callback runs on shard 7,
+    // accessing shard_data_[0] that now represents shard 5 for the next operation.
+    // seqlock provides protection for that so each cb will only run on the operation it has
+    // been tasked with.
+    // We also must first check is_armed and only then seqlock. The first check ensures that
+    // the coordinator thread crossed
+    // "run_count_.store(unique_shard_cnt_, memory_order_release);" barrier and our seqlock_
+    // is valid.
+    if (seq_after == seq) {
+      // shard->PollExecution(this) does not necessarily execute this transaction.
+      // Therefore, everything that should be handled during the callback execution
+      // should go into RunInShard.
+      shard->PollExecution("exec_cb", trans);
+    } else {
+      VLOG(1) << "Skipping PollExecution " << trans->DebugId() << " sid(" << shard->shard_id()
+              << ")";
+    }
+  }
 
-  // IsArmedInShard is the protector of non-thread safe data.
-  IterateActiveShards([&cb](PerShardData& sd, auto i) { shard_set->Add(i, cb); });
+  DVLOG(3) << "ptr_release " << trans->DebugId() << " " << seq;
+  intrusive_ptr_release(trans);  // against use_count_.fetch_add in ExecuteAsync.
 }
 
 void Transaction::RunQuickie(EngineShard* shard) {
@@ -901,8 +1026,11 @@ void Transaction::RunQuickie(EngineShard* shard) {
   DVLOG(1) << "RunQuickSingle " << DebugId() << " " << shard->shard_id();
   DCHECK(cb_ptr_) << DebugId() << " " << shard->shard_id();
 
+  RecordTraceEvent("hop-start");
+
   // Calling the callback in somewhat safe way
   try {
+    CmdAllocTracker alloc_tracker(cid_);
     local_result_ = (*cb_ptr_)(this, shard);
   } catch (std::bad_alloc&) {
     LOG_FIRST_N(ERROR, 16) << " out of memory";
@@ -911,6 +1039,8 @@ void Transaction::RunQuickie(EngineShard* shard) {
     LOG(FATAL) << "Unexpected exception " << e.what();
   }
 
+  RecordTraceEvent("hop-end");
+
   LogAutoJournalOnShard(shard);
 
   sd.is_armed.store(false, memory_order_relaxed);
@@ -978,6 +1108,7 @@ bool Transaction::ScheduleUniqueShard(EngineShard* shard) {
   // we can do it because only a single thread writes into txid_ and sd.
   txid_ = op_seq.fetch_add(1, memory_order_relaxed);
   sd.pq_pos = shard->txq()->Insert(this);
+  SetEnqueueTimeNs(absl::GetCurrentTimeNanos());
 
   DCHECK_EQ(0, sd.local_mask & KEYLOCK_ACQUIRED);
 
@@ -1051,6 +1182,7 @@ pair<bool, bool> Transaction::ScheduleInShard(EngineShard* shard) {
   TxQueue::Iterator it = txq->Insert(this);
   DCHECK_EQ(TxQueue::kEnd, sd.pq_pos);
   sd.pq_pos = it;
+  SetEnqueueTimeNs(absl::GetCurrentTimeNanos());
 
   DVLOG(1) << "Insert into tx-queue, sid(" << sid << ") " << DebugId() << ", qlen " << txq->size();
 
@@ -1438,6 +1570,8 @@ OpResult<KeyIndex> DetermineKeys(const CommandId* cid, CmdArgList args) {
     unsigned num_keys_index;
     if (absl::StartsWith(name, "EVAL"))
       num_keys_index = 1;
+    else if (name == "BLMPOP" || name == "BZMPOP")
+      num_keys_index = 1;  // the timeout precedes the key count.
     else
       num_keys_index = key_index.bonus ? *key_index.bonus + 1 : 0;
 
@@ -1449,7 +1583,13 @@ OpResult<KeyIndex> DetermineKeys(const CommandId* cid, CmdArgList args) {
       return OpStatus::INVALID_INT;
     }
 
-    if (name == "ZUNION" && num_custom_keys == 0) {
+    if ((name == "ZUNION" || name == "SINTERCARD") && num_custom_keys == 0) {
+      return OpStatus::SYNTAX_ERR;
+    }
+
+    // The multi-key pops must name at least one key.
+    if ((name == "LMPOP" || name == "BLMPOP" || name == "ZMPOP" || name == "BZMPOP") &&
+        num_custom_keys == 0) {
       return OpStatus::SYNTAX_ERR;
     }
 
@@ -205,6 +205,10 @@ class Transaction {
   // Start multi in LOCK_AHEAD mode with given keys.
   void StartMultiLockedAhead(DbIndex dbid, CmdArgList keys);
 
+  // Start multi in LOCK_AHEAD mode with keys the caller verified to map to a single
+  // shard, allowing scheduling to run inline on the owning thread.
+  void StartMultiSingleShard(DbIndex dbid, CmdArgList keys);
+
   // Start multi in NON_ATOMIC mode.
   void StartMultiNonAtomic();
 
@@ -255,6 +259,16 @@ class Transaction {
     return txid_;
   }
 
+  // Timestamp (ns) of the last insertion into a shard tx queue, used by latency stats.
+  // Approximate for multi-shard transactions since each shard overwrites it.
+  uint64_t GetEnqueueTimeNs() const {
+    return enqueue_ts_ns_.load(std::memory_order_relaxed);
+  }
+
+  void SetEnqueueTimeNs(uint64_t ts) {
+    enqueue_ts_ns_.store(ts, std::memory_order_relaxed);
+  }
+
   IntentLock::Mode Mode() const;  // Based on command mask
 
   std::string_view Name() const;  // Based on command name
@@ -263,6 +277,12 @@ class Transaction {
     return unique_shard_cnt_;
   }
 
+  // Valid only when GetUniqueShardCnt() == 1.
+  ShardId GetUniqueShard() const {
+    DCHECK_EQ(1u, unique_shard_cnt_);
+    return unique_shard_id_;
+  }
+
   bool IsMulti() const {
     return bool(multi_);
   }
@@ -306,6 +326,11 @@ class Transaction {
                          bool multi_commands, bool allow_await) const;
   void FinishLogJournalOnShard(EngineShard* shard, uint32_t shard_cnt) const;
 
+  // Runs in the shard thread when its poll inbox is drained. Executes the same logic as the
+  // per-hop callback dispatched by ExecuteAsync: polls the owning transaction if it is still
+  // armed for the operation the node was submitted for, and drops the submission reference.
+  static void RunPolledNode(TxPollNode* node);
+
  private:
   // Holds number of locks for each IntentLock::Mode: shared and exlusive.
   struct LockCnt {
@@ -330,11 +355,16 @@ class Transaction {
 
     PerShardData() = default;
 
-    // this is the only variable that is accessed by both shard and coordinator threads.
+    // these two are the only variables that are accessed by both shard and coordinator threads.
     std::atomic_bool is_armed{false};
 
-    // We pad with some memory so that atomic loads won't cause false sharing betweem threads.
-    char pad[46];  // to make sure PerShardData is 64 bytes and takes full cacheline.
+    // Hook into the per-shard poll inbox through which ExecuteAsync submits hops
+    // (see EngineShardSet::SubmitPollNode).
+    TxPollNode poll_node;
+
+    // We pad with some memory so that atomic loads won't cause false sharing betweem threads:
+    // the fields above stay in the first cacheline, the shard-local fields below in the second.
+    char pad[80];  // to make sure PerShardData is 128 bytes and takes full cachelines.
 
     uint32_t arg_start = 0;  // Indices into args_ array.
     uint32_t arg_count = 0;
@@ -351,7 +381,7 @@ class Transaction {
     uint16_t wake_key_pos = UINT16_MAX;
   };
 
-  static_assert(sizeof(PerShardData) == 64);  // cacheline
+  static_assert(sizeof(PerShardData) == 128);  // two cachelines
 
   // State of a multi transaction.
   struct MultiData {
@@ -476,6 +506,10 @@ class Transaction {
   // Returns the previous value of run count.
   uint32_t DecreaseRunCnt();
 
+  // Records a phase timestamp into the calling thread's trace buffer if this transaction
+  // was sampled for tracing (--tx_trace_sample_rate). Dumped via DEBUG TRACE.
+  void RecordTraceEvent(const char* phase) const;
+
   uint32_t GetUseCount() const {
     return use_count_.load(std::memory_order_relaxed);
   }
@@ -541,9 +575,11 @@ class Transaction {
 
   TxId txid_{0};
   bool global_{false};
+  bool trace_{false};  // Whether this transaction was sampled for phase tracing.
   DbIndex db_index_{0};
   uint64_t time_now_ms_{0};
 
+  std::atomic<uint64_t> enqueue_ts_ns_{0};     // see GetEnqueueTimeNs().
   std::atomic<uint32_t> wakeup_requested_{0};  // whether tx was woken up
   std::atomic_uint32_t use_count_{0}, run_count_{0}, seqlock_{0};
 
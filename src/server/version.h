@@ -25,8 +25,14 @@ enum class DflyVersion {
   // - Sends version back on REPLCONF capa dragonfly
   VER1,
 
+  // Versions 1.6<=
+  // - Supports partial replica resyncs: the replica may append its last journal LSN
+  //   to DFLY FLOW and the master answers PARTIAL when its in-memory journal backlog
+  //   still covers that LSN.
+  VER2,
+
   // Always points to the latest version
-  CURRENT_VER = VER1,
+  CURRENT_VER = VER2,
 };
 
 }  // namespace dfly
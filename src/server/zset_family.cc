@@ -5,6 +5,7 @@
 #include "server/zset_family.h"
 
 extern "C" {
+#include "redis/geo.h"
 #include "redis/geohash.h"
 #include "redis/geohash_helper.h"
 #include "redis/listpack.h"
@@ -41,6 +42,10 @@ static const char kLexRangeErr[] = "min or max not valid string range item";
 constexpr string_view kGeoAlphabet = "0123456789bcdefghjkmnpqrstuvwxyz"sv;
 
 constexpr unsigned kMaxListPackValue = 64;
+
+// ZADD batches of at least this many pairs landing on an empty key take the bulk-build
+// path that constructs the skiplist bottom-up from a pre-sorted batch.
+constexpr size_t kBulkBuildThreshold = 128;
 using MScoreResponse = std::vector<std::optional<double>>;
 
 using ScoredMember = std::pair<std::string, double>;
@@ -133,15 +138,23 @@ struct ZParams {
   bool override = false;
 };
 
-void OutputScoredArrayResult(const OpResult<ScoredArray>& result,
-                             const ZSetFamily::RangeParams& params, ConnectionContext* cntx) {
+// CH is not a ZADD_IN_* bit, we only use it to parse the token and move it to ZParams::ch.
+constexpr uint32_t kZAddChFlag = 1u << 16;
+
+// Sends a scored array that was already serialized into RESP by the shard callback
+// (see SerializeScoredArray), so the connection fiber sends the chunk as is instead of
+// making a second formatting pass over a potentially huge result.
+void OutputSerializedArrayResult(const OpResult<string>& result, ConnectionContext* cntx) {
   if (result.status() == OpStatus::WRONG_TYPE) {
     return (*cntx)->SendError(kWrongTypeErr);
   }
 
   LOG_IF(WARNING, !result && result.status() != OpStatus::KEY_NOTFOUND)
       << "Unexpected status " << result.status();
-  (*cntx)->SendScoredArray(result.value(), params.with_scores);
+
+  if (!result)  // Missing keys are formatted as an empty array.
+    return (*cntx)->SendEmptyArray();
+  (*cntx)->SendSerialized(result.value());
 }
 
 OpResult<PrimeIterator> FindZEntry(const ZParams& zparams, const OpArgs& op_args, string_view key,
@@ -930,6 +943,35 @@ OpResult<AddResult> OpAdd(const OpArgs& op_args, const ZParams& zparams, string_
   AddResult aresult;
   detail::RobjWrapper* robj_wrapper = res_it.value()->second.GetRobjWrapper();
 
+  // Bulk path: a large unconditional batch landing on an empty key is sorted once and
+  // bulk-built into a skiplist, instead of descending per member (and instead of growing
+  // a listpack only to convert it midway). Conditional flags need per-member answers, so
+  // they take the regular path.
+  if (zparams.flags == 0 && members.size() >= kBulkBuildThreshold && robj_wrapper->Size() == 0) {
+    // Deduplicate members - the last occurrence wins, as with sequential inserts.
+    absl::flat_hash_map<string_view, double> uniques(members.size());
+    bool has_nan = false;
+    for (const auto& m : members) {
+      uniques.insert_or_assign(m.second, m.first);
+      has_nan |= isnan(m.first);
+    }
+
+    if (!has_nan) {
+      vector<pair<double, string_view>> batch;
+      batch.reserve(uniques.size());
+      for (const auto& [member, score] : uniques)
+        batch.emplace_back(score, member);
+      sort(batch.begin(), batch.end());
+
+      unique_ptr<detail::SortedMap> zs = detail::SortedMap::FromSortedBatch(batch);
+      aresult.num_updated = zs->Size();
+      res_it.value()->second.InitRobj(OBJ_ZSET, OBJ_ENCODING_SKIPLIST, zs.release());
+
+      op_args.shard->db_slice().PostUpdate(op_args.db_cntx.db_index, *res_it, key);
+      return aresult;
+    }
+  }
+
   for (size_t j = 0; j < members.size(); j++) {
     const auto& m = members[j];
     tmp_str = sdscpylen(tmp_str, m.second.data(), m.second.size());
@@ -1284,6 +1326,79 @@ auto OpPopCount(const ZSetFamily::ZRangeSpec& range_spec, const OpArgs& op_args,
   return iv.PopResult();
 }
 
+// Parses the common tail of ZMPOP/BZMPOP: numkeys key [key ...] <MIN|MAX> [COUNT count].
+bool ParseZMPopArgs(CmdArgList args, bool* is_max, uint32_t* count) {
+  uint32_t num_keys;
+  if (!absl::SimpleAtoi(ArgS(args, 0), &num_keys) || num_keys == 0 ||
+      args.size() < size_t(num_keys) + 2)
+    return false;
+
+  ToUpper(&args[num_keys + 1]);
+  string_view cmd = ArgS(args, num_keys + 1);
+  if (cmd == "MIN") {
+    *is_max = false;
+  } else if (cmd == "MAX") {
+    *is_max = true;
+  } else {
+    return false;
+  }
+
+  *count = 1;
+  if (args.size() > size_t(num_keys) + 2) {
+    ToUpper(&args[num_keys + 2]);
+    if (args.size() != size_t(num_keys) + 4 || ArgS(args, num_keys + 2) != "COUNT" ||
+        !absl::SimpleAtoi(ArgS(args, num_keys + 3), count) || *count == 0)
+      return false;
+  }
+  return true;
+}
+
+// Called as a callback from the multi-key pop flow after the key to pop from was chosen.
+// Pops up to `count` elements and journals the equivalent single-key pop, since a replica
+// may distribute the candidate keys over its shards differently.
+ScoredArray OpZMPop(Transaction* t, EngineShard* shard, std::string_view key, bool is_max,
+                    uint32_t count) {
+  ZSetFamily::RangeParams range_params;
+  range_params.reverse = is_max;
+  range_params.with_scores = true;
+  ZSetFamily::ZRangeSpec range_spec;
+  range_spec.params = range_params;
+  range_spec.interval = ZSetFamily::TopNScored(count);
+
+  OpArgs op_args = t->GetOpArgs(shard);
+  OpResult<ScoredArray> res = OpPopCount(range_spec, op_args, key);
+  CHECK(res) << t->DebugId() << " " << key;  // the chosen key must exist and hold a zset.
+
+  if (op_args.shard->journal()) {
+    string command = is_max ? "ZPOPMAX" : "ZPOPMIN";
+    string count_str = absl::StrCat(res->size());
+    RecordJournal(op_args, command, ArgSlice{key, count_str}, 1);
+  }
+  return std::move(res.value());
+}
+
+// ZMPOP and BZMPOP reply with [key, [[member, score] ...]] or a null array when nothing
+// was popped.
+void ReplyZMPop(const OpResult<string>& popped_key, const ScoredArray& popped_array,
+                ConnectionContext* cntx) {
+  if (popped_key) {
+    (*cntx)->StartArray(2);
+    (*cntx)->SendBulkString(*popped_key);
+    (*cntx)->StartArray(popped_array.size());
+    for (const auto& [member, score] : popped_array) {
+      (*cntx)->StartArray(2);
+      (*cntx)->SendBulkString(member);
+      (*cntx)->SendDouble(score);
+    }
+    return;
+  }
+
+  if (popped_key.status() == OpStatus::WRONG_TYPE) {
+    return (*cntx)->SendError(kWrongTypeErr);
+  }
+  (*cntx)->SendNullArray();
+}
+
 auto OpRange(const ZSetFamily::ZRangeSpec& range_spec, const OpArgs& op_args, string_view key)
     -> OpResult<ScoredArray> {
   OpResult<PrimeIterator> res_it = op_args.shard->db_slice().Find(op_args.db_cntx, key, OBJ_ZSET);
@@ -1555,32 +1670,20 @@ OpResult<StringVec> OpScan(const OpArgs& op_args, std::string_view key, uint64_t
     uint32_t count = scan_op.limit;
     detail::SortedMap* zs = (detail::SortedMap*)pv.RObjPtr();
 
-    dict* ht = zs->GetDict();
     long maxiterations = count * 10;
 
-    struct ScanArgs {
-      char* sbuf;
-      StringVec* res;
-      const ScanOpts* scan_op;
-    } sargs = {buf, &res, &scan_op};
-
-    auto scanCb = [](void* privdata, const dictEntry* de) {
-      ScanArgs* sargs = (ScanArgs*)privdata;
-
-      sds key = (sds)de->key;
-      if (!sargs->scan_op->Matches(key)) {
+    auto scanCb = [&](string_view member, double score) {
+      if (!scan_op.Matches(member)) {
         return;
       }
 
-      double score = *(double*)dictGetVal(de);
-
-      sargs->res->emplace_back(key, sdslen(key));
-      char* str = RedisReplyBuilder::FormatDouble(score, sargs->sbuf, sizeof(buf));
-      sargs->res->emplace_back(str);
+      res.emplace_back(member);
+      char* str = RedisReplyBuilder::FormatDouble(score, buf, sizeof(buf));
+      res.emplace_back(str);
     };
 
     do {
-      *cursor = dictScan(ht, *cursor, scanCb, NULL, &sargs);
+      *cursor = zs->Scan(*cursor, scanCb);
     } while (*cursor && maxiterations-- && res.size() < count);
   }
 
@@ -1617,6 +1720,291 @@ void ZAddGeneric(string_view key, const ZParams& zparams, ScoredMemberSpan memb_
   }
 }
 
+/* ====================================================================
+ * GEO search
+ * ==================================================================== */
+
+const char kFromTypeErr[] =
+    "exactly one of FROMMEMBER or FROMLONLAT can be specified for GEOSEARCH";
+const char kByTypeErr[] = "exactly one of BYRADIUS and BYBOX can be specified for GEOSEARCH";
+const char kAscDescErr[] = "ASC and DESC options at the same time are not compatible";
+const char kMemberNotFoundErr[] = "could not decode requested zset member";
+const char kInvalidUnitErr[] = "unsupported unit provided. please use M, KM, FT, MI";
+
+struct GeoPoint {
+  double longitude = 0;
+  double latitude = 0;
+  double dist = 0;
+  double score = 0;
+  std::string member;
+};
+
+using GeoArray = std::vector<GeoPoint>;
+
+struct GeoSearchQuery {
+  GeoShape shape{};
+
+  // Set by FROMMEMBER, the center is then resolved on the shard thread. Empty for FROMLONLAT,
+  // in which case shape.xy holds the center already.
+  string_view from_member;
+
+  enum Sorting { kUnsorted, kAsc, kDesc } sorting = kUnsorted;
+  uint32_t count = 0;
+  bool any = false;  // COUNT .. ANY - stop at the first count matches, in no particular order.
+
+  bool with_coord = false;
+  bool with_dist = false;
+  bool with_hash = false;
+  bool store_dist = false;  // GEOSEARCHSTORE: store the distance instead of the geohash score.
+};
+
+std::optional<double> ExtractUnit(string_view unit) {
+  if (unit == "M")
+    return 1;
+  if (unit == "KM")
+    return 1000;
+  if (unit == "FT")
+    return 0.3048;
+  if (unit == "MI")
+    return 1609.34;
+  return nullopt;
+}
+
+// Parses the search clauses shared by GEOSEARCH and GEOSEARCHSTORE, starting at args[i].
+// Sends an error and returns false if the query is malformed.
+bool ParseGeoSearchQuery(CmdArgList args, size_t i, bool is_store, GeoSearchQuery* q,
+                         ConnectionContext* cntx) {
+  bool from_set = false;
+  bool by_set = false;
+
+  for (; i < args.size(); ++i) {
+    ToUpper(&args[i]);
+
+    string_view cur_arg = ArgS(args, i);
+    if (cur_arg == "FROMMEMBER") {
+      if (from_set || i + 1 >= args.size()) {
+        (*cntx)->SendError(from_set ? kFromTypeErr : kSyntaxErr);
+        return false;
+      }
+      from_set = true;
+      q->from_member = ArgS(args, ++i);
+    } else if (cur_arg == "FROMLONLAT") {
+      if (from_set || i + 2 >= args.size()) {
+        (*cntx)->SendError(from_set ? kFromTypeErr : kSyntaxErr);
+        return false;
+      }
+      from_set = true;
+      pair<double, double> longlat;
+      if (!ParseLongLat(ArgS(args, i + 1), ArgS(args, i + 2), &longlat)) {
+        string err = absl::StrCat("-ERR invalid longitude,latitude pair ", ArgS(args, i + 1), ",",
+                                  ArgS(args, i + 2));
+        (*cntx)->SendError(err, kSyntaxErrType);
+        return false;
+      }
+      q->shape.xy[0] = longlat.first;
+      q->shape.xy[1] = longlat.second;
+      i += 2;
+    } else if (cur_arg == "BYRADIUS") {
+      if (by_set || i + 2 >= args.size()) {
+        (*cntx)->SendError(by_set ? kByTypeErr : kSyntaxErr);
+        return false;
+      }
+      by_set = true;
+      q->shape.type = CIRCULAR_TYPE;
+      if (!ParseDouble(ArgS(args, i + 1), &q->shape.t.radius) || q->shape.t.radius < 0 ||
+          isnan(q->shape.t.radius)) {
+        (*cntx)->SendError("need numeric radius", kSyntaxErrType);
+        return false;
+      }
+      ToUpper(&args[i + 2]);
+      auto unit = ExtractUnit(ArgS(args, i + 2));
+      if (!unit) {
+        (*cntx)->SendError(kInvalidUnitErr);
+        return false;
+      }
+      q->shape.conversion = *unit;
+      i += 2;
+    } else if (cur_arg == "BYBOX") {
+      if (by_set || i + 3 >= args.size()) {
+        (*cntx)->SendError(by_set ? kByTypeErr : kSyntaxErr);
+        return false;
+      }
+      by_set = true;
+      q->shape.type = RECTANGLE_TYPE;
+      if (!ParseDouble(ArgS(args, i + 1), &q->shape.t.r.width) ||
+          !ParseDouble(ArgS(args, i + 2), &q->shape.t.r.height) || q->shape.t.r.width < 0 ||
+          q->shape.t.r.height < 0 || isnan(q->shape.t.r.width) || isnan(q->shape.t.r.height)) {
+        (*cntx)->SendError("need numeric width and height", kSyntaxErrType);
+        return false;
+      }
+      ToUpper(&args[i + 3]);
+      auto unit = ExtractUnit(ArgS(args, i + 3));
+      if (!unit) {
+        (*cntx)->SendError(kInvalidUnitErr);
+        return false;
+      }
+      q->shape.conversion = *unit;
+      i += 3;
+    } else if (cur_arg == "ASC" || cur_arg == "DESC") {
+      if (q->sorting != GeoSearchQuery::kUnsorted) {
+        (*cntx)->SendError(kAscDescErr);
+        return false;
+      }
+      q->sorting = (cur_arg == "ASC") ? GeoSearchQuery::kAsc : GeoSearchQuery::kDesc;
+    } else if (cur_arg == "COUNT") {
+      if (i + 1 >= args.size() || !SimpleAtoi(ArgS(args, i + 1), &q->count) || q->count == 0) {
+        (*cntx)->SendError("COUNT must be > 0", kSyntaxErrType);
+        return false;
+      }
+      ++i;
+      if (i + 1 < args.size()) {
+        ToUpper(&args[i + 1]);
+        if (ArgS(args, i + 1) == "ANY") {
+          q->any = true;
+          ++i;
+        }
+      }
+    } else if (!is_store && cur_arg == "WITHCOORD") {
+      q->with_coord = true;
+    } else if (!is_store && cur_arg == "WITHDIST") {
+      q->with_dist = true;
+    } else if (!is_store && cur_arg == "WITHHASH") {
+      q->with_hash = true;
+    } else if (is_store && cur_arg == "STOREDIST") {
+      q->store_dist = true;
+    } else {
+      (*cntx)->SendError(kSyntaxErr);
+      return false;
+    }
+  }
+
+  if (!from_set) {
+    (*cntx)->SendError(kFromTypeErr);
+    return false;
+  }
+  if (!by_set) {
+    (*cntx)->SendError(kByTypeErr);
+    return false;
+  }
+  return true;
+}
+
+// Searches the geoset key for members within q->shape. Decomposes the search area into the
+// center geohash cell plus its eight neighbors, fetches each cell with a sorted set score
+// range query, and keeps the members that pass the exact shape test.
+// INVALID_VALUE means the FROMMEMBER member could not be resolved to a position.
+OpResult<GeoArray> OpGeoSearch(const OpArgs& op_args, string_view key, GeoSearchQuery* q) {
+  auto& db_slice = op_args.shard->db_slice();
+  OpResult<PrimeIterator> res_it = db_slice.Find(op_args.db_cntx, key, OBJ_ZSET);
+  if (!res_it)
+    return res_it.status();
+
+  if (!q->from_member.empty()) {
+    detail::RobjWrapper* robj_wrapper = res_it.value()->second.GetRobjWrapper();
+    sds& tmp_str = op_args.shard->tmp_str1;
+    tmp_str = sdscpylen(tmp_str, q->from_member.data(), q->from_member.size());
+
+    auto score = GetZsetScore(robj_wrapper, tmp_str);
+    if (!score || !decodeGeohash(*score, q->shape.xy))
+      return OpStatus::INVALID_VALUE;
+  }
+
+  GeoHashRadius area = geohashCalculateAreasByShapeWGS84(&q->shape);
+  GeoHashBits cells[9] = {area.hash,
+                          area.neighbors.north,
+                          area.neighbors.south,
+                          area.neighbors.east,
+                          area.neighbors.west,
+                          area.neighbors.north_east,
+                          area.neighbors.north_west,
+                          area.neighbors.south_east,
+                          area.neighbors.south_west};
+
+  GeoArray ga;
+  unsigned last_processed = 0;
+  for (unsigned i = 0; i < ABSL_ARRAYSIZE(cells); ++i) {
+    if (HASHISZERO(cells[i]))
+      continue;
+
+    // With huge radii (5000km and more) adjacent neighbors collapse into the same cell,
+    // producing duplicated elements. Skip a cell equal to the previously processed one.
+    if (last_processed && cells[i].bits == cells[last_processed].bits &&
+        cells[i].step == cells[last_processed].step)
+      continue;
+
+    // All the elements inside the cell have their 52-bit geohash score in
+    // [align52(hash), align52(hash + 1)).
+    GeoHashFix52Bits min_score = geohashAlign52Bits(cells[i]);
+    GeoHashBits next_cell = cells[i];
+    next_cell.bits++;
+    GeoHashFix52Bits max_score = geohashAlign52Bits(next_cell);
+
+    ZSetFamily::ZRangeSpec range_spec;
+    range_spec.params.interval_type = ZSetFamily::RangeParams::SCORE;
+    range_spec.params.with_scores = true;
+    range_spec.interval = ZSetFamily::ScoreInterval{ZSetFamily::Bound{double(min_score)},
+                                                    ZSetFamily::Bound{double(max_score), true}};
+
+    OpResult<ScoredArray> candidates = OpRange(range_spec, op_args, key);
+    DCHECK(candidates);
+
+    for (auto& [member, score] : *candidates) {
+      double xy[2];
+      double dist = 0;
+      if (geoWithinShape(&q->shape, score, xy, &dist) == C_OK) {
+        ga.push_back(GeoPoint{xy[0], xy[1], dist, score, std::move(member)});
+        if (q->any && q->count && ga.size() >= q->count)
+          break;
+      }
+    }
+    if (q->any && q->count && ga.size() >= q->count)
+      break;
+
+    last_processed = i;
+  }
+
+  auto by_dist_asc = [](const GeoPoint& a, const GeoPoint& b) { return a.dist < b.dist; };
+  if (q->count && !q->any) {
+    // COUNT without ANY returns the nearest matches, so order by distance before trimming.
+    std::sort(ga.begin(), ga.end(), by_dist_asc);
+    if (ga.size() > q->count)
+      ga.resize(q->count);
+    if (q->sorting == GeoSearchQuery::kDesc)
+      std::reverse(ga.begin(), ga.end());
+  } else if (q->sorting == GeoSearchQuery::kAsc) {
+    std::sort(ga.begin(), ga.end(), by_dist_asc);
+  } else if (q->sorting == GeoSearchQuery::kDesc) {
+    std::sort(ga.begin(), ga.end(),
+              [](const GeoPoint& a, const GeoPoint& b) { return a.dist > b.dist; });
+  }
+
+  return ga;
+}
+
+void GeoSearchReply(const GeoSearchQuery& q, const GeoArray& ga, ConnectionContext* cntx) {
+  bool with_attribs = q.with_coord || q.with_dist || q.with_hash;
+
+  (*cntx)->StartArray(ga.size());
+  for (const auto& p : ga) {
+    if (!with_attribs) {
+      (*cntx)->SendBulkString(p.member);
+      continue;
+    }
+
+    (*cntx)->StartArray(1 + q.with_dist + q.with_hash + q.with_coord);
+    (*cntx)->SendBulkString(p.member);
+    if (q.with_dist)
+      (*cntx)->SendDouble(p.dist / q.shape.conversion);
+    if (q.with_hash)
+      (*cntx)->SendLong(static_cast<long>(p.score));
+    if (q.with_coord) {
+      (*cntx)->StartArray(2);
+      (*cntx)->SendDouble(p.longitude);
+      (*cntx)->SendDouble(p.latitude);
+    }
+  }
+}
+
 }  // namespace
 
 void ZSetFamily::BZPopMin(CmdArgList args, ConnectionContext* cntx) {
@@ -1627,32 +2015,72 @@ void ZSetFamily::BZPopMax(CmdArgList args, ConnectionContext* cntx) {
   BZPopMinMax(args, cntx, true);
 }
 
+void ZSetFamily::ZMPop(CmdArgList args, ConnectionContext* cntx) {
+  bool is_max;
+  uint32_t count;
+  if (!ParseZMPopArgs(args, &is_max, &count)) {
+    return (*cntx)->SendError(kSyntaxErr);
+  }
+
+  ScoredArray popped_array;
+  auto cb = [is_max, count, &popped_array](Transaction* t, EngineShard* shard,
+                                           std::string_view key) {
+    popped_array = OpZMPop(t, shard, key, is_max, count);
+  };
+
+  OpResult<string> popped_key =
+      container_utils::RunCbOnFirstNonEmpty(cntx->transaction, OBJ_ZSET, std::move(cb));
+  ReplyZMPop(popped_key, popped_array, cntx);
+}
+
+void ZSetFamily::BZMPop(CmdArgList args, ConnectionContext* cntx) {
+  float timeout;
+  if (!absl::SimpleAtof(ArgS(args, 0), &timeout)) {
+    return (*cntx)->SendError("timeout is not a float or out of range");
+  }
+  if (timeout < 0) {
+    return (*cntx)->SendError("timeout is negative");
+  }
+
+  bool is_max;
+  uint32_t count;
+  if (!ParseZMPopArgs(args.subspan(1), &is_max, &count)) {
+    return (*cntx)->SendError(kSyntaxErr);
+  }
+
+  VLOG(1) << "BZMPop timeout(" << timeout << ")";
+
+  ScoredArray popped_array;
+  auto cb = [is_max, count, &popped_array](Transaction* t, EngineShard* shard,
+                                           std::string_view key) {
+    popped_array = OpZMPop(t, shard, key, is_max, count);
+  };
+
+  cntx->conn_state.is_blocking = true;
+  OpResult<string> popped_key = container_utils::RunCbOnFirstNonEmptyBlocking(
+      cntx->transaction, OBJ_ZSET, std::move(cb), unsigned(timeout * 1000));
+  cntx->conn_state.is_blocking = false;
+
+  if (popped_key.status() == OpStatus::TIMED_OUT) {
+    return (*cntx)->SendNullArray();
+  }
+  ReplyZMPop(popped_key, popped_array, cntx);
+}
+
 void ZSetFamily::ZAdd(CmdArgList args, ConnectionContext* cntx) {
   string_view key = ArgS(args, 0);
 
+  static constexpr ArgFlagSpec kZAddFlags[] = {{"XX", ZADD_IN_XX},  {"NX", ZADD_IN_NX},
+                                               {"GT", ZADD_IN_GT},  {"LT", ZADD_IN_LT},
+                                               {"CH", kZAddChFlag}, {"INCR", ZADD_IN_INCR}};
+
   ZParams zparams;
   size_t i = 1;
-  for (; i < args.size() - 1; ++i) {
-    ToUpper(&args[i]);
 
-    string_view cur_arg = ArgS(args, i);
-
-    if (cur_arg == "XX") {
-      zparams.flags |= ZADD_IN_XX;  // update only
-    } else if (cur_arg == "NX") {
-      zparams.flags |= ZADD_IN_NX;  // add new only.
-    } else if (cur_arg == "GT") {
-      zparams.flags |= ZADD_IN_GT;
-    } else if (cur_arg == "LT") {
-      zparams.flags |= ZADD_IN_LT;
-    } else if (cur_arg == "CH") {
-      zparams.ch = true;
-    } else if (cur_arg == "INCR") {
-      zparams.flags |= ZADD_IN_INCR;
-    } else {
-      break;
-    }
-  }
+  // The last argument can not be a flag - score/member pairs must follow.
+  ParseArgFlags(kZAddFlags, args.subspan(0, args.size() - 1), &i, &zparams.flags);
+  zparams.ch = (zparams.flags & kZAddChFlag) != 0;
+  zparams.flags &= ~kZAddChFlag;
 
   if ((args.size() - i) % 2 != 0) {
     (*cntx)->SendError(kSyntaxErr);
@@ -2303,12 +2731,19 @@ void ZSetFamily::ZRangeGeneric(CmdArgList args, RangeParams range_params, Connec
     }
   }
 
-  auto cb = [&](Transaction* t, EngineShard* shard) {
-    return OpRange(range_spec, t->GetOpArgs(shard), key);
+  // Serialize on the shard thread so that huge ranges are traversed only once and the
+  // connection fiber does not need to copy the members again.
+  bool is_resp3 = (*cntx)->IsResp3();
+  auto cb = [&](Transaction* t, EngineShard* shard) -> OpResult<string> {
+    OpResult<ScoredArray> arr = OpRange(range_spec, t->GetOpArgs(shard), key);
+    if (!arr)
+      return arr.status();
+    return RedisReplyBuilder::SerializeScoredArray(arr.value(), range_params.with_scores,
+                                                   is_resp3);
   };
 
-  OpResult<ScoredArray> result = cntx->transaction->ScheduleSingleHopT(std::move(cb));
-  OutputScoredArrayResult(result, range_params, cntx);
+  OpResult<string> result = cntx->transaction->ScheduleSingleHopT(std::move(cb));
+  OutputSerializedArrayResult(result, cntx);
 }
 
 void ZSetFamily::ZRankGeneric(CmdArgList args, bool reverse, ConnectionContext* cntx) {
@@ -2370,47 +2805,59 @@ void ZSetFamily::ZPopMinMax(CmdArgList args, bool reverse, ConnectionContext* cn
 
   range_spec.interval = sc;
 
-  auto cb = [&](Transaction* t, EngineShard* shard) {
-    return OpPopCount(range_spec, t->GetOpArgs(shard), key);
+  bool is_resp3 = (*cntx)->IsResp3();
+  auto cb = [&](Transaction* t, EngineShard* shard) -> OpResult<string> {
+    OpResult<ScoredArray> arr = OpPopCount(range_spec, t->GetOpArgs(shard), key);
+    if (!arr)
+      return arr.status();
+    return RedisReplyBuilder::SerializeScoredArray(arr.value(), range_params.with_scores,
+                                                   is_resp3);
   };
 
-  OpResult<ScoredArray> result = cntx->transaction->ScheduleSingleHopT(std::move(cb));
-  OutputScoredArrayResult(result, range_params, cntx);
+  OpResult<string> result = cntx->transaction->ScheduleSingleHopT(std::move(cb));
+  OutputSerializedArrayResult(result, cntx);
 }
 
 void ZSetFamily::GeoAdd(CmdArgList args, ConnectionContext* cntx) {
   string_view key = ArgS(args, 0);
 
-  // TODO: to handle options and multiple elements
-  ZParams zparams;
+  static constexpr ArgFlagSpec kGeoAddFlags[] = {
+      {"XX", ZADD_IN_XX}, {"NX", ZADD_IN_NX}, {"CH", kZAddChFlag}};
 
-  string_view longitude = ArgS(args, 1);
-  string_view latitude = ArgS(args, 2);
-  string_view member = ArgS(args, 3);
+  ZParams zparams;
+  size_t i = 1;
+  ParseArgFlags(kGeoAddFlags, args.subspan(0, args.size() - 1), &i, &zparams.flags);
+  zparams.ch = (zparams.flags & kZAddChFlag) != 0;
+  zparams.flags &= ~kZAddChFlag;
 
-  // TODO: to remove this check once the TODO above is handled.
-  if (args.size() != 4) {
+  if (args.size() == i || (args.size() - i) % 3 != 0) {
     return (*cntx)->SendError(kSyntaxErr);
   }
 
-  // TODO: the code handles only a single tripple of long,lat,member.
-  //       it has to be extended to handle multiple elements.
-  pair<double, double> longlat;
-  for (int i = 0; i < 1; i++) {
+  if ((zparams.flags & (ZADD_IN_NX | ZADD_IN_XX)) == (ZADD_IN_NX | ZADD_IN_XX)) {
+    return (*cntx)->SendError(kNxXxErr);
+  }
+
+  absl::InlinedVector<ScoredMemberView, 4> members;
+  for (; i < args.size(); i += 3) {
+    string_view longitude = ArgS(args, i);
+    string_view latitude = ArgS(args, i + 1);
+    string_view member = ArgS(args, i + 2);
+
+    pair<double, double> longlat;
     if (!ParseLongLat(longitude, latitude, &longlat)) {
       string err = absl::StrCat("-ERR invalid longitude,latitude pair ", longitude, ",", latitude);
 
       return (*cntx)->SendError(err, kSyntaxErrType);
     }
-  }
 
-  /* Turn the coordinates into the score of the element. */
-  GeoHashBits hash;
-  geohashEncodeWGS84(longlat.first, longlat.second, GEO_STEP_MAX, &hash);
-  GeoHashFix52Bits bits = geohashAlign52Bits(hash);
+    /* Turn the coordinates into the score of the element. */
+    GeoHashBits hash;
+    geohashEncodeWGS84(longlat.first, longlat.second, GEO_STEP_MAX, &hash);
+    GeoHashFix52Bits bits = geohashAlign52Bits(hash);
 
-  absl::InlinedVector<ScoredMemberView, 4> members;
-  members.emplace_back(bits, member);
+    members.emplace_back(bits, member);
+  }
   ZAddGeneric(key, zparams, absl::Span{members.data(), members.size()}, cntx);
 }
 
@@ -2445,6 +2892,179 @@ void ZSetFamily::GeoHash(CmdArgList args, ConnectionContext* cntx) {
   }
 }
 
+void ZSetFamily::GeoPos(CmdArgList args, ConnectionContext* cntx) {
+  string_view key = ArgS(args, 0);
+
+  absl::InlinedVector<string_view, 8> members(args.size() - 1);
+  for (size_t i = 1; i < args.size(); ++i) {
+    members[i - 1] = ArgS(args, i);
+  }
+
+  auto cb = [&](Transaction* t, EngineShard* shard) {
+    return OpMScore(t->GetOpArgs(shard), key, members);
+  };
+
+  OpResult<MScoreResponse> result = cntx->transaction->ScheduleSingleHopT(std::move(cb));
+
+  if (result.status() == OpStatus::WRONG_TYPE) {
+    return (*cntx)->SendError(kWrongTypeErr);
+  }
+
+  // A missing key replies as if none of the members had a position.
+  if (result.status() == OpStatus::KEY_NOTFOUND) {
+    result = MScoreResponse(members.size());
+  }
+
+  (*cntx)->StartArray(result->size());
+  for (const auto& p : result.value()) {
+    double xy[2];
+    if (p && decodeGeohash(*p, xy)) {
+      (*cntx)->StartArray(2);
+      (*cntx)->SendDouble(xy[0]);
+      (*cntx)->SendDouble(xy[1]);
+    } else {
+      (*cntx)->SendNull();
+    }
+  }
+}
+
+void ZSetFamily::GeoDist(CmdArgList args, ConnectionContext* cntx) {
+  string_view key = ArgS(args, 0);
+
+  double conversion = 1;
+  if (args.size() == 4) {
+    ToUpper(&args[3]);
+    auto unit = ExtractUnit(ArgS(args, 3));
+    if (!unit) {
+      return (*cntx)->SendError(kInvalidUnitErr);
+    }
+    conversion = *unit;
+  } else if (args.size() != 3) {
+    return (*cntx)->SendError(kSyntaxErr);
+  }
+
+  array<string_view, 2> members = {ArgS(args, 1), ArgS(args, 2)};
+
+  auto cb = [&](Transaction* t, EngineShard* shard) {
+    return OpMScore(t->GetOpArgs(shard), key, ArgSlice{members.data(), members.size()});
+  };
+
+  OpResult<MScoreResponse> result = cntx->transaction->ScheduleSingleHopT(std::move(cb));
+
+  if (result.status() == OpStatus::WRONG_TYPE) {
+    return (*cntx)->SendError(kWrongTypeErr);
+  }
+
+  double xyxy[4];
+  if (result.status() == OpStatus::KEY_NOTFOUND || !result->at(0) || !result->at(1) ||
+      !decodeGeohash(*result->at(0), xyxy) || !decodeGeohash(*result->at(1), xyxy + 2)) {
+    return (*cntx)->SendNull();
+  }
+
+  (*cntx)->SendDouble(geohashGetDistance(xyxy[0], xyxy[1], xyxy[2], xyxy[3]) / conversion);
+}
+
+void ZSetFamily::GeoSearch(CmdArgList args, ConnectionContext* cntx) {
+  string_view key = ArgS(args, 0);
+
+  GeoSearchQuery query;
+  if (!ParseGeoSearchQuery(args, 1, false, &query, cntx))
+    return;
+
+  auto cb = [&](Transaction* t, EngineShard* shard) {
+    return OpGeoSearch(t->GetOpArgs(shard), key, &query);
+  };
+
+  OpResult<GeoArray> result = cntx->transaction->ScheduleSingleHopT(std::move(cb));
+
+  switch (result.status()) {
+    case OpStatus::OK:
+      return GeoSearchReply(query, result.value(), cntx);
+    case OpStatus::KEY_NOTFOUND:
+      return GeoSearchReply(query, GeoArray{}, cntx);
+    case OpStatus::INVALID_VALUE:
+      return (*cntx)->SendError(kMemberNotFoundErr);
+    default:
+      return (*cntx)->SendError(result.status());
+  }
+}
+
+void ZSetFamily::GeoSearchStore(CmdArgList args, ConnectionContext* cntx) {
+  string_view dest_key = ArgS(args, 0);
+  string_view src_key = ArgS(args, 1);
+
+  GeoSearchQuery query;
+  if (!ParseGeoSearchQuery(args, 2, true, &query, cntx))
+    return;
+
+  ShardId src_shard = Shard(src_key, shard_set->size());
+  ShardId dest_shard = Shard(dest_key, shard_set->size());
+
+  OpResult<GeoArray> search_result = OpStatus::SKIPPED;
+  vector<ScoredMemberView> smvec;
+
+  // An empty result (or a missing source key) clears the destination via override.
+  auto fill_smvec = [&] {
+    if (!search_result)
+      return;
+    smvec.reserve(search_result->size());
+    for (const auto& p : *search_result) {
+      smvec.emplace_back(query.store_dist ? p.dist / query.shape.conversion : p.score, p.member);
+    }
+  };
+
+  auto store = [&](Transaction* t, EngineShard* shard) {
+    ZParams zparams;
+    zparams.override = true;
+    OpAdd(t->GetOpArgs(shard), zparams, dest_key, ScoredMemberSpan{smvec});
+  };
+
+  cntx->transaction->Schedule();
+
+  if (src_shard == dest_shard) {
+    // Both keys hash to the same shard - search and store run in a single hop.
+    auto cb = [&](Transaction* t, EngineShard* shard) {
+      if (shard->shard_id() == src_shard) {
+        search_result = OpGeoSearch(t->GetOpArgs(shard), src_key, &query);
+        if (search_result || search_result.status() == OpStatus::KEY_NOTFOUND) {
+          fill_smvec();
+          store(t, shard);
+        }
+      }
+      return OpStatus::OK;
+    };
+    cntx->transaction->Execute(std::move(cb), true);
+  } else {
+    auto search_cb = [&](Transaction* t, EngineShard* shard) {
+      if (shard->shard_id() == src_shard) {
+        search_result = OpGeoSearch(t->GetOpArgs(shard), src_key, &query);
+      }
+      return OpStatus::OK;
+    };
+    cntx->transaction->Execute(std::move(search_cb), false);
+
+    bool do_store = search_result || search_result.status() == OpStatus::KEY_NOTFOUND;
+    fill_smvec();
+
+    auto store_cb = [&](Transaction* t, EngineShard* shard) {
+      if (do_store && shard->shard_id() == dest_shard) {
+        store(t, shard);
+      }
+      return OpStatus::OK;
+    };
+    cntx->transaction->Execute(std::move(store_cb), true);
+  }
+
+  if (!search_result && search_result.status() != OpStatus::KEY_NOTFOUND) {
+    if (search_result.status() == OpStatus::INVALID_VALUE) {
+      return (*cntx)->SendError(kMemberNotFoundErr);
+    }
+    return (*cntx)->SendError(search_result.status());
+  }
+
+  (*cntx)->SendLong(smvec.size());
+}
+
 #define HFUNC(x) SetHandler(&ZSetFamily::x)
 
 void ZSetFamily::Register(CommandRegistry* registry) {
@@ -2456,6 +3076,13 @@ void ZSetFamily::Register(CommandRegistry* registry) {
              .HFUNC(BZPopMin)
       << CI{"BZPOPMAX", CO::WRITE | CO::NOSCRIPT | CO::BLOCKING | CO::NO_AUTOJOURNAL, -3, 1, -2, 1}
              .HFUNC(BZPopMax)
+      << CI{"ZMPOP", CO::WRITE | CO::VARIADIC_KEYS | CO::REVERSE_MAPPING | CO::NO_AUTOJOURNAL, -4,
+            2, 2, 1}
+             .HFUNC(ZMPop)
+      << CI{"BZMPOP",
+            CO::WRITE | CO::NOSCRIPT | CO::BLOCKING | CO::VARIADIC_KEYS | CO::NO_AUTOJOURNAL, -5, 3,
+            3, 1}
+             .HFUNC(BZMPop)
       << CI{"ZCARD", CO::FAST | CO::READONLY, 2, 1, 1, 1}.HFUNC(ZCard)
       << CI{"ZCOUNT", CO::FAST | CO::READONLY, 4, 1, 1, 1}.HFUNC(ZCount)
       << CI{"ZDIFF", CO::READONLY | CO::VARIADIC_KEYS, -3, 2, 2, 1}.HFUNC(ZDiff)
@@ -2487,7 +3114,11 @@ void ZSetFamily::Register(CommandRegistry* registry) {
 
       // GEO functions
       << CI{"GEOADD", CO::FAST | CO::WRITE | CO::DENYOOM, -5, 1, 1, 1}.HFUNC(GeoAdd)
-      << CI{"GEOHASH", CO::FAST | CO::READONLY, -2, 1, 1, 1}.HFUNC(GeoHash);
+      << CI{"GEOHASH", CO::FAST | CO::READONLY, -2, 1, 1, 1}.HFUNC(GeoHash)
+      << CI{"GEOPOS", CO::FAST | CO::READONLY, -2, 1, 1, 1}.HFUNC(GeoPos)
+      << CI{"GEODIST", CO::READONLY, -4, 1, 1, 1}.HFUNC(GeoDist)
+      << CI{"GEOSEARCH", CO::READONLY, -7, 1, 1, 1}.HFUNC(GeoSearch)
+      << CI{"GEOSEARCHSTORE", CO::WRITE | CO::DENYOOM, -8, 1, 2, 1}.HFUNC(GeoSearchStore);
 }
 
 }  // namespace dfly
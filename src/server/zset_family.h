@@ -54,6 +54,8 @@ class ZSetFamily {
 
   static void BZPopMin(CmdArgList args, ConnectionContext* cntx);
   static void BZPopMax(CmdArgList args, ConnectionContext* cntx);
+  static void ZMPop(CmdArgList args, ConnectionContext* cntx);
+  static void BZMPop(CmdArgList args, ConnectionContext* cntx);
 
   static void ZAdd(CmdArgList args, ConnectionContext* cntx);
   static void ZCard(CmdArgList args, ConnectionContext* cntx);
@@ -94,6 +96,10 @@ class ZSetFamily {
 
   static void GeoAdd(CmdArgList args, ConnectionContext* cntx);
   static void GeoHash(CmdArgList args, ConnectionContext* cntx);
+  static void GeoPos(CmdArgList args, ConnectionContext* cntx);
+  static void GeoDist(CmdArgList args, ConnectionContext* cntx);
+  static void GeoSearch(CmdArgList args, ConnectionContext* cntx);
+  static void GeoSearchStore(CmdArgList args, ConnectionContext* cntx);
 };
 
 }  // namespace dfly
@@ -468,6 +468,29 @@ TEST_F(ZSetFamilyTest, ZAddBug148) {
   EXPECT_THAT(resp, IntArg(1));
 }
 
+TEST_F(ZSetFamilyTest, ZAddBulk) {
+  // Large enough to take the bulk-build path on a fresh key.
+  vector<string> args = {"zadd", "zbulk"};
+  for (unsigned i = 0; i < 200; ++i) {
+    args.push_back(absl::StrCat(i / 2));  // duplicate scores.
+    args.push_back(absl::StrCat("member:", 1000 + i));
+  }
+  // Repeated member - the last score must win.
+  args.push_back("500");
+  args.push_back("member:1000");
+
+  RespExpr resp = Run(absl::MakeSpan(args));
+  EXPECT_THAT(resp, IntArg(200));
+  EXPECT_THAT(Run({"zcard", "zbulk"}), IntArg(200));
+  EXPECT_EQ(Run({"zscore", "zbulk", "member:1000"}), "500");
+  EXPECT_THAT(Run({"zrank", "zbulk", "member:1001"}), IntArg(0));
+  EXPECT_THAT(Run({"zrank", "zbulk", "member:1000"}), IntArg(199));
+
+  auto sub = Run({"zrange", "zbulk", "0", "2"});
+  ASSERT_THAT(sub, ArrLen(3));
+  EXPECT_THAT(sub.GetVec(), ElementsAre("member:1001", "member:1002", "member:1003"));
+}
+
 TEST_F(ZSetFamilyTest, ZPopMin) {
   auto resp = Run({"zadd", "key", "1", "a", "2", "b", "3", "c", "4", "d", "5", "e", "6", "f"});
   EXPECT_THAT(resp, IntArg(6));
@@ -532,6 +555,49 @@ TEST_F(ZSetFamilyTest, ZAddPopCrash) {
   EXPECT_THAT(resp.GetVec(), ElementsAre("element:0", "0"));
 }
 
+TEST_F(ZSetFamilyTest, ZMPop) {
+  auto resp = Run({"zmpop", "2", "x", "y", "MIN"});
+  EXPECT_THAT(resp, ArgType(RespExpr::NIL_ARRAY));
+
+  resp = Run({"zmpop", "2", "x", "y", "SIDEWAYS"});
+  EXPECT_THAT(resp, ErrArg("syntax error"));
+
+  Run({"zadd", "y", "1", "a", "2", "b", "3", "c"});
+
+  // The first non-empty key in argument order wins, regardless of its shard.
+  resp = Run({"zmpop", "2", "x", "y", "MIN"});
+  ASSERT_THAT(resp, ArrLen(2));
+  EXPECT_EQ(resp.GetVec()[0], "y");
+  EXPECT_THAT(resp.GetVec()[1].GetVec()[0].GetVec(), ElementsAre("a", "1"));
+
+  resp = Run({"zmpop", "1", "y", "MAX", "COUNT", "2"});
+  ASSERT_THAT(resp, ArrLen(2));
+  ASSERT_THAT(resp.GetVec()[1], ArrLen(2));
+  EXPECT_THAT(resp.GetVec()[1].GetVec()[0].GetVec(), ElementsAre("c", "3"));
+  EXPECT_THAT(resp.GetVec()[1].GetVec()[1].GetVec(), ElementsAre("b", "2"));
+
+  EXPECT_EQ(0, CheckedInt({"exists", "y"}));
+}
+
+TEST_F(ZSetFamilyTest, BZMPop) {
+  RespExpr resp = Run({"bzmpop", "0.01", "2", "x", "y", "MIN"});
+  EXPECT_THAT(resp, ArgType(RespExpr::NIL_ARRAY));
+
+  RespExpr pop_resp;
+  auto pop_fb = pp_->at(0)->LaunchFiber(Launch::dispatch, [&] {
+    pop_resp = Run({"bzmpop", "0", "2", "x", "y", "MAX", "COUNT", "2"});
+  });
+
+  WaitUntilLocked(0, "x");
+  pp_->at(1)->Await([&] { Run({"zadd", "y", "1", "a", "2", "b", "3", "c"}); });
+  pop_fb.Join();
+
+  ASSERT_THAT(pop_resp, ArrLen(2));
+  EXPECT_EQ(pop_resp.GetVec()[0], "y");
+  ASSERT_THAT(pop_resp.GetVec()[1], ArrLen(2));
+  EXPECT_THAT(pop_resp.GetVec()[1].GetVec()[0].GetVec(), ElementsAre("c", "3"));
+}
+
 TEST_F(ZSetFamilyTest, Resp3) {
   Run({"hello", "3"});
   Run({"zadd", "x", "1", "a", "2", "b"});
@@ -653,4 +719,127 @@ TEST_F(ZSetFamilyTest, GeoAdd) {
   EXPECT_THAT(resp, RespArray(ElementsAre("sqc8b49rny0", "sqdtr74hyu0")));
 }
 
+TEST_F(ZSetFamilyTest, GeoAddOptions) {
+  EXPECT_EQ(2, CheckedInt({"geoadd", "Sicily", "13.361389", "38.115556", "Palermo", "15.087269",
+                           "37.502669", "Catania"}));
+
+  // XX only updates already existing members.
+  EXPECT_EQ(0, CheckedInt({"geoadd", "Sicily", "XX", "13.5", "38.0", "Palermo", "13.583333",
+                           "37.316667", "Agrigento"}));
+  auto resp = Run({"geopos", "Sicily", "Agrigento"});
+  EXPECT_THAT(resp, ArgType(RespExpr::NIL));
+
+  // NX does not touch the existing position of Palermo.
+  EXPECT_EQ(1, CheckedInt({"geoadd", "Sicily", "NX", "1", "1", "Palermo", "13.583333", "37.316667",
+                           "Agrigento"}));
+
+  // CH counts updated members as well.
+  EXPECT_EQ(1, CheckedInt({"geoadd", "Sicily", "CH", "15.1", "37.6", "Catania"}));
+
+  resp = Run({"geoadd", "Sicily", "NX", "XX", "1", "1", "a"});
+  EXPECT_THAT(resp, ErrArg("XX and NX"));
+
+  resp = Run({"geoadd", "Sicily", "CH", "13.3", "38.1"});
+  EXPECT_THAT(resp, ErrArg("syntax error"));
+}
+
+TEST_F(ZSetFamilyTest, GeoPosDist) {
+  EXPECT_EQ(2, CheckedInt({"geoadd", "Sicily", "13.361389", "38.115556", "Palermo", "15.087269",
+                           "37.502669", "Catania"}));
+
+  auto resp = Run({"geopos", "Sicily", "Palermo", "nonexisting"});
+  ASSERT_THAT(resp, ArrLen(2));
+  const auto& arr = resp.GetVec();
+  ASSERT_THAT(arr[0], ArrLen(2));
+  EXPECT_NEAR(13.361389, stod(arr[0].GetVec()[0].GetString()), 1e-5);
+  EXPECT_NEAR(38.115556, stod(arr[0].GetVec()[1].GetString()), 1e-5);
+  EXPECT_THAT(arr[1], ArgType(RespExpr::NIL));
+
+  resp = Run({"geopos", "nokey", "Palermo"});
+  EXPECT_THAT(resp, ArgType(RespExpr::NIL));
+
+  resp = Run({"geodist", "Sicily", "Palermo", "Catania"});
+  EXPECT_NEAR(166274.15, stod(resp.GetString()), 1.0);
+
+  resp = Run({"geodist", "Sicily", "Palermo", "Catania", "km"});
+  EXPECT_NEAR(166.27, stod(resp.GetString()), 0.01);
+
+  resp = Run({"geodist", "Sicily", "Palermo", "nonexisting"});
+  EXPECT_THAT(resp, ArgType(RespExpr::NIL));
+
+  resp = Run({"geodist", "Sicily", "Palermo", "Catania", "miles"});
+  EXPECT_THAT(resp, ErrArg("unsupported unit"));
+}
+
+TEST_F(ZSetFamilyTest, GeoSearch) {
+  EXPECT_EQ(3, CheckedInt({"geoadd", "Sicily", "13.361389", "38.115556", "Palermo", "15.087269",
+                           "37.502669", "Catania", "13.583333", "37.316667", "Agrigento"}));
+
+  auto resp =
+      Run({"geosearch", "Sicily", "FROMLONLAT", "15", "37", "BYRADIUS", "200", "km", "ASC"});
+  EXPECT_THAT(resp, RespArray(ElementsAre("Catania", "Agrigento", "Palermo")));
+
+  resp = Run({"geosearch", "Sicily", "FROMLONLAT", "15", "37", "BYRADIUS", "200", "km", "DESC"});
+  EXPECT_THAT(resp, RespArray(ElementsAre("Palermo", "Agrigento", "Catania")));
+
+  // COUNT without ANY returns the nearest matches.
+  resp = Run({"geosearch", "Sicily", "FROMLONLAT", "15", "37", "BYRADIUS", "200", "km", "COUNT",
+              "2"});
+  EXPECT_THAT(resp, RespArray(ElementsAre("Catania", "Agrigento")));
+
+  resp = Run({"geosearch", "Sicily", "FROMLONLAT", "15", "37", "BYRADIUS", "200", "km", "COUNT",
+              "2", "ANY"});
+  EXPECT_THAT(resp, ArrLen(2));
+
+  resp = Run({"geosearch", "Sicily", "FROMMEMBER", "Palermo", "BYBOX", "400", "400", "km", "ASC"});
+  EXPECT_THAT(resp, RespArray(ElementsAre("Palermo", "Agrigento", "Catania")));
+
+  resp = Run({"geosearch", "Sicily", "FROMMEMBER", "Palermo", "BYRADIUS", "100", "km", "ASC",
+              "WITHCOORD", "WITHDIST", "WITHHASH"});
+  ASSERT_THAT(resp, ArrLen(2));
+  const auto& entry = resp.GetVec()[0].GetVec();
+  ASSERT_EQ(4u, entry.size());
+  EXPECT_EQ("Palermo", entry[0].GetString());
+  EXPECT_EQ(0, stod(entry[1].GetString()));
+  EXPECT_THAT(entry[2], IntArg(3479099956230698));
+  EXPECT_THAT(entry[3], ArrLen(2));
+
+  resp = Run({"geosearch", "nokey", "FROMLONLAT", "15", "37", "BYRADIUS", "200", "km"});
+  EXPECT_THAT(resp, ArrLen(0));
+
+  resp = Run({"geosearch", "Sicily", "FROMMEMBER", "nonexisting", "BYRADIUS", "200", "km"});
+  EXPECT_THAT(resp, ErrArg("could not decode requested zset member"));
+
+  resp = Run({"geosearch", "Sicily", "FROMLONLAT", "15", "37", "ASC", "BYRADIUS", "200",
+              "BYBOX", "4"});
+  EXPECT_THAT(resp, ErrArg("unsupported unit"));
+}
+
+TEST_F(ZSetFamilyTest, GeoSearchStore) {
+  EXPECT_EQ(3, CheckedInt({"geoadd", "Sicily", "13.361389", "38.115556", "Palermo", "15.087269",
+                           "37.502669", "Catania", "13.583333", "37.316667", "Agrigento"}));
+
+  EXPECT_EQ(3, CheckedInt({"geosearchstore", "dest", "Sicily", "FROMLONLAT", "15", "37", "BYRADIUS",
+                           "200", "km"}));
+  EXPECT_EQ(3, CheckedInt({"zcard", "dest"}));
+  auto resp = Run({"zscore", "dest", "Palermo"});
+  EXPECT_EQ(resp, "3479099956230698");
+
+  // STOREDIST overrides the previous content with distances as scores.
+  EXPECT_EQ(2, CheckedInt({"geosearchstore", "dest", "Sicily", "FROMMEMBER", "Palermo", "BYRADIUS",
+                           "100", "km", "STOREDIST"}));
+  EXPECT_EQ(2, CheckedInt({"zcard", "dest"}));
+  resp = Run({"zscore", "dest", "Palermo"});
+  EXPECT_EQ(0, stod(resp.GetString()));
+
+  // An empty result removes the destination key.
+  EXPECT_EQ(0, CheckedInt({"geosearchstore", "dest", "Sicily", "FROMLONLAT", "0", "0", "BYRADIUS",
+                           "1", "m"}));
+  EXPECT_EQ(0, CheckedInt({"exists", "dest"}));
+
+  resp = Run({"geosearchstore", "dest", "Sicily", "FROMLONLAT", "15", "37", "BYRADIUS", "200",
+              "km", "WITHCOORD"});
+  EXPECT_THAT(resp, ErrArg("syntax error"));
+}
+
 }  // namespace dfly
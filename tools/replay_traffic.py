@@ -0,0 +1,126 @@
+#!/usr/bin/env python3
+"""
+Replays traffic captured with --traffic_capture_file against a target instance.
+
+The server writes one capture file per thread (base path plus thread index); pass
+all of them and they are merged by timestamp. By default commands are paced at
+the original inter-arrival times; --speed scales the pacing (2 = twice as fast,
+0 = replay as fast as possible). Latencies are reported per command.
+
+File framing (all integers little-endian), kept in sync with main_service.cc:
+    magic "DFTCAP01"
+    per record: u64 timestamp-usec, u32 db-index, u32 num-args,
+                u32 len per argument, raw argument bytes back to back.
+
+To install: pip install -r requirements.txt
+"""
+
+import argparse
+import asyncio
+import struct
+import time
+
+import aioredis
+
+MAGIC = b"DFTCAP01"
+
+
+def read_capture(path):
+    records = []
+    with open(path, "rb") as f:
+        if f.read(8) != MAGIC:
+            raise ValueError(f"{path}: not a traffic capture file")
+        while True:
+            header = f.read(16)
+            if len(header) < 16:
+                break
+            ts_usec, db_index, num_args = struct.unpack("<QLL", header)
+            lens = struct.unpack(f"<{num_args}L", f.read(4 * num_args))
+            args = [f.read(l) for l in lens]
+            records.append((ts_usec, db_index, args))
+    return records
+
+
+def percentile(sorted_vals, pct):
+    idx = min(len(sorted_vals) - 1, int(len(sorted_vals) * pct / 100))
+    return sorted_vals[idx]
+
+
+class Histograms:
+    def __init__(self):
+        self.per_cmd = {}
+
+    def add(self, cmd, latency_usec):
+        self.per_cmd.setdefault(cmd, []).append(latency_usec)
+
+    def report(self):
+        print(f"{'command':<20} {'count':>10} {'avg':>8} {'p50':>8} {'p99':>8} {'max':>8}  (usec)")
+        for cmd in sorted(self.per_cmd):
+            lat = sorted(self.per_cmd[cmd])
+            print(
+                f"{cmd:<20} {len(lat):>10} {sum(lat) // len(lat):>8} "
+                f"{percentile(lat, 50):>8} {percentile(lat, 99):>8} {lat[-1]:>8}"
+            )
+
+
+async def replay(records, args, histos):
+    client = aioredis.from_url(
+        f"redis://{args.host}:{args.port}", encoding=None, decode_responses=False
+    )
+    start_wall = time.monotonic()
+    start_capture = records[0][0]
+    errors = 0
+
+    for ts_usec, _db_index, cmd_args in records:
+        if args.speed > 0:
+            due = (ts_usec - start_capture) / 1e6 / args.speed
+            delay = due - (time.monotonic() - start_wall)
+            if delay > 0:
+                await asyncio.sleep(delay)
+
+        begin = time.monotonic()
+        try:
+            await client.execute_command(*cmd_args)
+        except aioredis.ResponseError:
+            errors += 1
+        histos.add(cmd_args[0].decode().upper(), int((time.monotonic() - begin) * 1e6))
+
+    await client.close()
+    return errors
+
+
+async def main():
+    parser = argparse.ArgumentParser(description=__doc__,
+                                     formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("files", nargs="+", help="capture files, one per server thread")
+    parser.add_argument("--host", default="localhost")
+    parser.add_argument("--port", type=int, default=6379)
+    parser.add_argument("--speed", type=float, default=1.0,
+                        help="pacing factor relative to the capture, 0 replays at full speed")
+    parser.add_argument("--clients", type=int, default=8,
+                        help="number of connections the records are spread over")
+    args = parser.parse_args()
+
+    records = []
+    for path in args.files:
+        records.extend(read_capture(path))
+    records.sort(key=lambda rec: rec[0])
+    if not records:
+        print("nothing to replay")
+        return
+
+    duration_sec = (records[-1][0] - records[0][0]) / 1e6
+    print(f"replaying {len(records)} commands spanning {duration_sec:.1f}s "
+          f"against {args.host}:{args.port}")
+
+    histos = Histograms()
+    shards = [records[i::args.clients] for i in range(args.clients)]
+    results = await asyncio.gather(*(replay(s, args, histos) for s in shards if s))
+
+    histos.report()
+    if sum(results):
+        print(f"{sum(results)} commands returned errors")
+
+
+if __name__ == "__main__":
+    asyncio.run(main())